@@ -44,6 +44,7 @@
 #define OMX_ROLE_AUDIO_RENDERER_ICECAST_AAC    "audio_renderer.icecast.aac"
 #define OMX_ROLE_AUDIO_RENDERER_ICECAST_VORBIS "audio_renderer.icecast.vorbis"
 #define OMX_ROLE_AUDIO_RENDERER_ICECAST_OPUS   "audio_renderer.icecast.opus"
+#define OMX_ROLE_AUDIO_PROCESSOR_PCM_RESAMPLER "audio_processor.pcm.resampler"
 
 #define OMX_TIZONIA_PORTSTATUS_AWAITBUFFERSRETURN   0x00000004
 
@@ -77,6 +78,16 @@
 #define OMX_TizoniaIndexParamChromecastSession       OMX_IndexVendorStartUnused + 21 /**< reference: OMX_TIZONIA_PARAM_CHROMECASTSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioPlexSession        OMX_IndexVendorStartUnused + 22 /**< reference: OMX_TIZONIA_AUDIO_PARAM_PLEXSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioPlexPlaylist       OMX_IndexVendorStartUnused + 23 /**< reference: OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE */
+#define OMX_TizoniaIndexParamAudioResampler          OMX_IndexVendorStartUnused + 24 /**< reference: OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE */
+#define OMX_TizoniaIndexConfigAudioMixerRamp         OMX_IndexVendorStartUnused + 25 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE */
+#define OMX_TizoniaIndexConfigAudioMixerDuck         OMX_IndexVendorStartUnused + 26 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE */
+#define OMX_TizoniaIndexConfigAudioLoudness          OMX_IndexVendorStartUnused + 27 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE */
+#define OMX_TizoniaIndexParamAudioSampleFormat       OMX_IndexVendorStartUnused + 28 /**< reference: OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE */
+#define OMX_TizoniaIndexParamAudioMp3Encoder         OMX_IndexVendorStartUnused + 29 /**< reference: OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE */
+#define OMX_TizoniaIndexConfigAudioRendererLatency   OMX_IndexVendorStartUnused + 30 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE */
+#define OMX_TizoniaIndexConfigAudioSourceBufferHealth OMX_IndexVendorStartUnused + 31 /**< reference: OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE */
+#define OMX_TizoniaIndexConfigIcecastMountStats     OMX_IndexVendorStartUnused + 32 /**< reference: OMX_TIZONIA_ICECASTMOUNTSTATSTYPE */
+#define OMX_TizoniaIndexParamHttpSegmenter          OMX_IndexVendorStartUnused + 33 /**< reference: OMX_TIZONIA_HTTPSEGMENTERTYPE */
 
 /**
  * OMX_AUDIO_CODINGTYPE extensions
@@ -529,4 +540,227 @@ typedef struct OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE {
     OMX_U8 cPlaylistName[OMX_MAX_STRINGNAME_SIZE];
 } OMX_TIZONIA_AUDIO_PARAM_PLEXPLAYLISTTYPE;
 
+/**
+ * PCM resampler component
+ *
+ */
+typedef enum OMX_TIZONIA_AUDIO_RESAMPLERQUALITYTYPE {
+    OMX_AUDIO_ResamplerQualityLow = 0, /**< 16 taps, ~60 dB stop-band. */
+    OMX_AUDIO_ResamplerQualityMedium,  /**< 32 taps, ~80 dB stop-band (Default). */
+    OMX_AUDIO_ResamplerQualityHigh,    /**< 64 taps, ~100 dB stop-band. */
+    OMX_AUDIO_ResamplerQualityBest,    /**< 128 taps, ~120 dB stop-band. */
+    OMX_AUDIO_ResamplerQualityKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_AUDIO_ResamplerQualityVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_AUDIO_ResamplerQualityMax = 0x7FFFFFFF
+} OMX_TIZONIA_AUDIO_RESAMPLERQUALITYTYPE;
+
+/**
+ * 32-bit PCM is treated as float by most Tizonia components (e.g. the vorbis
+ * and opusfile decoders); the resampler needs to be told explicitly when a
+ * port carries 32-bit integer samples.
+ */
+typedef enum OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE {
+    OMX_AUDIO_SampleFormatAuto = 0, /**< 16-bit: S16, 32-bit: F32 (Default). */
+    OMX_AUDIO_SampleFormatS16,
+    OMX_AUDIO_SampleFormatS32,
+    OMX_AUDIO_SampleFormatF32,
+    OMX_AUDIO_SampleFormatKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_AUDIO_SampleFormatVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_AUDIO_SampleFormatMax = 0x7FFFFFFF
+} OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE;
+
+/**
+ * The sample format carried by a PCM port; it complements the nBitPerSample
+ * field of the port's OMX_AUDIO_PARAM_PCMMODETYPE.
+ */
+typedef struct OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE eFormat;
+} OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE;
+
+typedef struct OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_TIZONIA_AUDIO_RESAMPLERQUALITYTYPE eQuality;
+    OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE eInputFormat;
+    OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE eOutputFormat;
+} OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE;
+
+/**
+ * PCM mixer component
+ *
+ * Per-input gain is set with the standard OMX_IndexConfigAudioVolume and
+ * OMX_IndexConfigAudioMute configs on each input port. The structures below
+ * are also per input port.
+ */
+
+/**
+ * Time taken by an input to reach a new gain (after a volume, mute or ducking
+ * change).
+ */
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nDurationMs;
+} OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE;
+
+/**
+ * While an input marked as 'ducker' is producing audio, every other input is
+ * attenuated by nAttenuationmB millibels (a value <= 0).
+ */
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bDucker;
+    OMX_S32 nAttenuationmB;
+} OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE;
+
+/**
+ * Loudness normalisation (PCM renderers)
+ *
+ * Gains are expressed relative to the ReplayGain reference level (-18 LUFS),
+ * i.e. a tag value of 0 mB brings a track to -18 LUFS; the renderer shifts
+ * them by the difference between nTargetmLUFS and that reference. Peaks are
+ * linear sample peaks in Q16 (65536 = full scale). When the gain the mode asks
+ * for is not available, the renderer measures the integrated loudness (EBU
+ * R128 / ITU-R BS.1770) of the stream as it plays.
+ */
+typedef enum OMX_TIZONIA_AUDIO_LOUDNESSMODETYPE {
+    OMX_AUDIO_LoudnessOff = 0,  /**< No normalisation (Default). */
+    OMX_AUDIO_LoudnessTrack,    /**< Track gain, else album gain, else measure. */
+    OMX_AUDIO_LoudnessAlbum,    /**< Album gain, else track gain, else measure. */
+    OMX_AUDIO_LoudnessMeasure,  /**< Ignore the tags; always measure. */
+    OMX_AUDIO_LoudnessKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_AUDIO_LoudnessVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_AUDIO_LoudnessMax = 0x7FFFFFFF
+} OMX_TIZONIA_AUDIO_LOUDNESSMODETYPE;
+
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_TIZONIA_AUDIO_LOUDNESSMODETYPE eMode;
+    OMX_S32 nTargetmLUFS;       /**< Target loudness, e.g. -18000. */
+    OMX_BOOL bTrackGain;        /**< nTrackGainmB/nTrackPeak are valid. */
+    OMX_S32 nTrackGainmB;
+    OMX_U32 nTrackPeak;         /**< Q16; 0 if unknown. */
+    OMX_BOOL bAlbumGain;        /**< nAlbumGainmB/nAlbumPeak are valid. */
+    OMX_S32 nAlbumGainmB;
+    OMX_U32 nAlbumPeak;         /**< Q16; 0 if unknown. */
+} OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE;
+
+/**
+ * MP3 encoder component
+ *
+ * With nWorkers > 1 the encoder works in batch mode: the PCM stream is cut
+ * into segments of nSegmentFrames MP3 frames, which are encoded in parallel
+ * by nWorkers LAME instances and stitched back together in order. Segments
+ * overlap, so that every encoder is warmed up by the time its frames are
+ * used. This adds up to nWorkers segments of latency; it is meant for offline
+ * transcoding, not for live streams.
+ */
+typedef enum OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE {
+    OMX_AUDIO_Mp3RateControlCBR = 0, /**< nBitRate of the MP3 port (Default). */
+    OMX_AUDIO_Mp3RateControlABR,     /**< nBitRate of the MP3 port, on average. */
+    OMX_AUDIO_Mp3RateControlVBR,     /**< nVbrQuality. */
+    OMX_AUDIO_Mp3RateControlKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_AUDIO_Mp3RateControlVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_AUDIO_Mp3RateControlMax = 0x7FFFFFFF
+} OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE;
+
+typedef struct OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nQuality;           /**< LAME algorithm quality, 0 (best) - 9. Default: 2. */
+    OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE eRateControl;
+    OMX_U32 nVbrQuality;        /**< 0 (best) - 9. Default: 4. */
+    OMX_U32 nWorkers;           /**< 0: one per CPU, 1: no batch mode (Default). */
+    OMX_U32 nSegmentFrames;     /**< Batch mode segment length. Default: 400. */
+} OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE;
+
+/**
+ * Audio renderer latency (PCM renderers)
+ *
+ * The buffering targets are requested from the sound server when the stream
+ * is created. They can be changed in any state; if the stream is already
+ * running, the new targets are applied to it straight away. A value of 0
+ * lets the server choose. nLatencyUs and nUnderruns
+ * are read-only; they report the current stream latency and the number of
+ * underruns since the component was last moved to Executing.
+ */
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nTargetLatencyUs;   /**< Total buffering, e.g. 100000. */
+    OMX_U32 nMinRequestUs;      /**< Smallest refill request, e.g. 25000. */
+    OMX_U32 nPrebufferUs;       /**< Data needed before playback starts. */
+    OMX_U32 nLatencyUs;         /**< Read-only. */
+    OMX_U32 nUnderruns;         /**< Read-only. */
+} OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE;
+
+/**
+ * Audio source buffer health (network sources)
+ *
+ * All fields are read-only. For live streams, the amount of data kept ahead
+ * of the decoder follows the measured network jitter; nTargetMs is the
+ * current target, and is 0 while the stream's length or rate is unknown.
+ * nUnderruns and nReconnects count the times the decoder was starved and the
+ * times the stream was reconnected to, since the current stream started.
+ */
+typedef struct OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nLevelBytes;        /**< Data buffered. */
+    OMX_U32 nLevelMs;           /**< Data buffered, at the nominal bitrate. */
+    OMX_U32 nTargetMs;
+    OMX_U32 nJitterMs;          /**< Network jitter estimate. */
+    OMX_U32 nUnderruns;
+    OMX_U32 nReconnects;
+} OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE;
+
+/**
+ * Icecast-like renderer's mount point statistics
+ *
+ * All fields are read-only. nListeners is the number of clients currently
+ * connected, and nMaxListeners the number of clients the mount point accepts.
+ * The other fields accumulate since the component was last initialised:
+ * nRejected counts the clients turned away (listener limit reached, or wrong
+ * mount point), and nUnderruns the times a listener ran out of data while
+ * streaming in real time.
+ */
+typedef struct OMX_TIZONIA_ICECASTMOUNTSTATSTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nListeners;
+    OMX_U32 nPeakListeners;
+    OMX_U32 nMaxListeners;
+    OMX_U32 nRejected;
+    OMX_U64 nBytesSent;
+    OMX_U32 nUnderruns;
+} OMX_TIZONIA_ICECASTMOUNTSTATSTYPE;
+
+/**
+ * HTTP renderer's segmenting output mode (HTTP Live Streaming)
+ *
+ * When bEnabled is set, the renderer cuts the stream into segments of
+ * nSegmentDurationMs milliseconds and serves them from memory, together
+ * with a playlist that lists the nWindowSegments most recent ones, instead
+ * of streaming it to each listener.
+ */
+typedef struct OMX_TIZONIA_HTTPSEGMENTERTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bEnabled;
+    OMX_U32 nSegmentDurationMs;
+    OMX_U32 nWindowSegments;
+} OMX_TIZONIA_HTTPSEGMENTERTYPE;
+
 #endif /* OMX_TizoniaExt_h */
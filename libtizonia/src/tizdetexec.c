@@ -0,0 +1,582 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizdetexec.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Deterministic executor (test mode)
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <tizplatform.h>
+
+#include "tizdetexec.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.detexec"
+#endif
+
+#define DETEXEC_RCFILE_SECTION "ilcore"
+#define DETEXEC_MAX_SLOTS 64
+#define DETEXEC_LABEL_LEN 64
+#define DETEXEC_REPLAY_TIMEOUT_SEC 10
+#define DETEXEC_LABEL_RESUME "resume"
+#define DETEXEC_DEFAULT_LOG "/tmp/tizonia-detexec.log"
+
+typedef enum detexec_mode detexec_mode_t;
+enum detexec_mode
+{
+  EDetExecOff = 0,
+  EDetExecRecord,
+  EDetExecReplay
+};
+
+struct tiz_detexec_slot
+{
+  OMX_U32 id;
+  char cname[OMX_MAX_STRINGNAME_SIZE];
+  OMX_S32 pending;    /* Messages posted but not yet at the gate */
+  OMX_BOOL waiting;   /* At the gate, waiting for the turn */
+  OMX_BOOL suspended; /* Gave up the turn to block on another component */
+  OMX_BOOL resuming;  /* Unblocked, but not yet back at the gate */
+  OMX_S32 tid;
+  const char * p_label;
+};
+
+typedef struct detexec_entry detexec_entry_t;
+struct detexec_entry
+{
+  OMX_U32 id;
+  char label[DETEXEC_LABEL_LEN];
+};
+
+typedef struct detexec detexec_t;
+struct detexec
+{
+  detexec_mode_t mode;
+  uint64_t seed;
+  uint64_t prng;
+  uint64_t seq;
+  FILE * p_log;
+  char log_path[PATH_MAX];
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  tiz_detexec_slot_t * p_slots[DETEXEC_MAX_SLOTS];
+  OMX_U32 nslots;
+  OMX_U32 next_id;
+  tiz_detexec_slot_t * p_holder;
+  detexec_entry_t * p_entries;
+  size_t nentries;
+  size_t next_entry;
+};
+
+static pthread_once_t g_detexec_once = PTHREAD_ONCE_INIT;
+static detexec_t g_detexec = {.mode = EDetExecOff,
+                              .mutex = PTHREAD_MUTEX_INITIALIZER,
+                              .cond = PTHREAD_COND_INITIALIZER};
+
+static const char *
+get_setting (const char * ap_env, const char * ap_key)
+{
+  const char * p_value = getenv (ap_env);
+  return p_value ? p_value
+                 : tiz_rcfile_get_value (DETEXEC_RCFILE_SECTION, ap_key);
+}
+
+/* xorshift64*; the executor must not share the libc generator with the code
+   under test */
+static inline uint64_t
+prng_next (const uint64_t a_state)
+{
+  uint64_t x = a_state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  return x;
+}
+
+static inline uint64_t
+prng_value (const uint64_t a_state)
+{
+  return a_state * 2685821657736338717ULL;
+}
+
+static OMX_BOOL
+load_replay_log (detexec_t * ap_x)
+{
+  FILE * p_file = NULL;
+  char line[2 * OMX_MAX_STRINGNAME_SIZE];
+  size_t capacity = 0;
+
+  assert (ap_x);
+
+  if (!(p_file = fopen (ap_x->log_path, "r")))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to open replay log [%s] (%s)",
+               ap_x->log_path, strerror (errno));
+      return OMX_FALSE;
+    }
+
+  while (fgets (line, sizeof (line), p_file))
+    {
+      unsigned long long seq = 0;
+      unsigned int id = 0;
+      char cname[OMX_MAX_STRINGNAME_SIZE];
+      char label[DETEXEC_LABEL_LEN];
+
+      if ('#' == line[0])
+        {
+          if (1 == sscanf (line, "# seed %llu", &seq))
+            {
+              ap_x->seed = seq;
+            }
+          continue;
+        }
+
+      if (4 != sscanf (line, "%llu %u %127s %63s", &seq, &id, cname, label))
+        {
+          continue;
+        }
+
+      if (ap_x->nentries == capacity)
+        {
+          detexec_entry_t * p_new = NULL;
+          capacity = capacity ? capacity * 2 : 1024;
+          if (!(p_new = tiz_mem_realloc (ap_x->p_entries,
+                                         capacity * sizeof (detexec_entry_t))))
+            {
+              break;
+            }
+          ap_x->p_entries = p_new;
+        }
+
+      ap_x->p_entries[ap_x->nentries].id = id;
+      snprintf (ap_x->p_entries[ap_x->nentries].label, DETEXEC_LABEL_LEN, "%s",
+                label);
+      ap_x->nentries++;
+    }
+
+  (void) fclose (p_file);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Replaying [%zu] grants from [%s]",
+           ap_x->nentries, ap_x->log_path);
+  return OMX_TRUE;
+}
+
+static void
+init_detexec (void)
+{
+  const char * p_mode
+    = get_setting ("TIZONIA_DETEXEC_MODE", "deterministic-executor");
+  const char * p_seed
+    = get_setting ("TIZONIA_DETEXEC_SEED", "deterministic-executor-seed");
+  const char * p_log
+    = get_setting ("TIZONIA_DETEXEC_LOG", "deterministic-executor-log");
+
+  if (!p_mode)
+    {
+      return;
+    }
+
+  snprintf (g_detexec.log_path, sizeof (g_detexec.log_path), "%s",
+            (p_log && strlen (p_log) > 0) ? p_log : DETEXEC_DEFAULT_LOG);
+  g_detexec.seed = p_seed ? strtoull (p_seed, NULL, 10) : 1;
+
+  if (0 == strncasecmp (p_mode, "record", 6))
+    {
+      if (!(g_detexec.p_log = fopen (g_detexec.log_path, "w")))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create log [%s] (%s)",
+                   g_detexec.log_path, strerror (errno));
+          return;
+        }
+      fprintf (g_detexec.p_log,
+               "# tizonia deterministic executor log\n# seed %llu\n",
+               (unsigned long long) g_detexec.seed);
+      (void) fflush (g_detexec.p_log);
+      g_detexec.mode = EDetExecRecord;
+    }
+  else if (0 == strncasecmp (p_mode, "replay", 6))
+    {
+      if (!load_replay_log (&g_detexec))
+        {
+          return;
+        }
+      g_detexec.mode = EDetExecReplay;
+    }
+  else
+    {
+      return;
+    }
+
+  /* A zero state would make xorshift return zeroes forever */
+  g_detexec.prng = g_detexec.seed ? g_detexec.seed : 0x9E3779B97F4A7C15ULL;
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Deterministic executor [%s] seed [%llu]",
+           EDetExecRecord == g_detexec.mode ? "record" : "replay",
+           (unsigned long long) g_detexec.seed);
+}
+
+static inline detexec_t *
+get_detexec (void)
+{
+  (void) pthread_once (&g_detexec_once, init_detexec);
+  return EDetExecOff != g_detexec.mode ? &g_detexec : NULL;
+}
+
+/* Every component is either idle (nothing posted), waiting at the gate, or
+   blocked on another component. Only then is the set of candidates for the
+   next turn independent of thread timing */
+static OMX_BOOL
+is_quiescent (const detexec_t * ap_x)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < ap_x->nslots; ++i)
+    {
+      const tiz_detexec_slot_t * p_slot = ap_x->p_slots[i];
+      if (p_slot->waiting || p_slot->suspended)
+        {
+          continue;
+        }
+      if (p_slot->resuming || p_slot->pending > 0)
+        {
+          return OMX_FALSE;
+        }
+    }
+  return OMX_TRUE;
+}
+
+/*@null@*/ static tiz_detexec_slot_t *
+choose_next (const detexec_t * ap_x)
+{
+  OMX_U32 i = 0;
+  OMX_U32 nwaiting = 0;
+  OMX_U32 choice = 0;
+
+  if (EDetExecReplay == ap_x->mode)
+    {
+      const detexec_entry_t * p_entry = NULL;
+      if (ap_x->next_entry < ap_x->nentries)
+        {
+          p_entry = &(ap_x->p_entries[ap_x->next_entry]);
+          for (i = 0; i < ap_x->nslots; ++i)
+            {
+              tiz_detexec_slot_t * p_slot = ap_x->p_slots[i];
+              if (p_slot->waiting && p_slot->id == p_entry->id
+                  && 0 == strncmp (p_slot->p_label, p_entry->label,
+                                   DETEXEC_LABEL_LEN))
+                {
+                  return p_slot;
+                }
+            }
+          return NULL;
+        }
+      /* Past the end of the log: carry on with seeded choices */
+    }
+
+  if (!is_quiescent (ap_x))
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < ap_x->nslots; ++i)
+    {
+      nwaiting += ap_x->p_slots[i]->waiting ? 1 : 0;
+    }
+
+  if (0 == nwaiting)
+    {
+      return NULL;
+    }
+
+  choice = (OMX_U32) (prng_value (prng_next (ap_x->prng)) % nwaiting);
+  for (i = 0; i < ap_x->nslots; ++i)
+    {
+      if (ap_x->p_slots[i]->waiting && 0 == choice--)
+        {
+          return ap_x->p_slots[i];
+        }
+    }
+
+  return NULL;
+}
+
+static void
+grant (detexec_t * ap_x, tiz_detexec_slot_t * ap_slot)
+{
+  ap_x->p_holder = ap_slot;
+  ap_slot->waiting = OMX_FALSE;
+  ap_slot->tid = tiz_thread_id ();
+
+  if (EDetExecReplay == ap_x->mode && ap_x->next_entry < ap_x->nentries)
+    {
+      ap_x->next_entry++;
+    }
+  else
+    {
+      ap_x->prng = prng_next (ap_x->prng);
+    }
+
+  if (ap_x->p_log)
+    {
+      fprintf (ap_x->p_log, "%llu %u %s %s\n", (unsigned long long) ap_x->seq,
+               (unsigned int) ap_slot->id, ap_slot->cname, ap_slot->p_label);
+      /* Keep the log complete even if the test crashes */
+      (void) fflush (ap_x->p_log);
+    }
+  ap_x->seq++;
+}
+
+static void
+wait_turn (detexec_t * ap_x, tiz_detexec_slot_t * ap_slot,
+           const char * ap_label)
+{
+  ap_slot->waiting = OMX_TRUE;
+  ap_slot->suspended = OMX_FALSE;
+  ap_slot->resuming = OMX_FALSE;
+  ap_slot->p_label = ap_label ? ap_label : "";
+  (void) pthread_cond_broadcast (&(ap_x->cond));
+
+  while (ap_x->p_holder != ap_slot)
+    {
+      if (!ap_x->p_holder)
+        {
+          tiz_detexec_slot_t * p_next = choose_next (ap_x);
+          if (p_next == ap_slot)
+            {
+              grant (ap_x, ap_slot);
+              break;
+            }
+          else if (p_next)
+            {
+              (void) pthread_cond_broadcast (&(ap_x->cond));
+            }
+        }
+
+      if (EDetExecReplay == ap_x->mode)
+        {
+          struct timespec ts;
+          (void) clock_gettime (CLOCK_REALTIME, &ts);
+          ts.tv_sec += DETEXEC_REPLAY_TIMEOUT_SEC;
+          if (ETIMEDOUT
+              == pthread_cond_timedwait (&(ap_x->cond), &(ap_x->mutex), &ts))
+            {
+              TIZ_LOG (TIZ_PRIORITY_ERROR,
+                       "Replay diverged at grant [%zu] of [%zu]; continuing "
+                       "with seed [%llu]",
+                       ap_x->next_entry, ap_x->nentries,
+                       (unsigned long long) ap_x->seed);
+              ap_x->mode = EDetExecRecord;
+            }
+        }
+      else
+        {
+          (void) pthread_cond_wait (&(ap_x->cond), &(ap_x->mutex));
+        }
+    }
+}
+
+OMX_BOOL
+tiz_detexec_enabled (void)
+{
+  return get_detexec () ? OMX_TRUE : OMX_FALSE;
+}
+
+tiz_detexec_slot_t *
+tiz_detexec_register (const char * ap_cname)
+{
+  detexec_t * p_x = get_detexec ();
+  tiz_detexec_slot_t * p_slot = NULL;
+
+  if (!p_x)
+    {
+      return NULL;
+    }
+
+  if (!(p_slot = tiz_mem_calloc (1, sizeof (tiz_detexec_slot_t))))
+    {
+      return NULL;
+    }
+
+  snprintf (p_slot->cname, sizeof (p_slot->cname), "%s",
+            ap_cname ? ap_cname : "");
+
+  (void) pthread_mutex_lock (&(p_x->mutex));
+  if (p_x->nslots < DETEXEC_MAX_SLOTS)
+    {
+      p_slot->id = p_x->next_id++;
+      p_x->p_slots[p_x->nslots++] = p_slot;
+    }
+  else
+    {
+      tiz_mem_free (p_slot);
+      p_slot = NULL;
+    }
+  (void) pthread_mutex_unlock (&(p_x->mutex));
+
+  return p_slot;
+}
+
+void
+tiz_detexec_unregister (tiz_detexec_slot_t * ap_slot)
+{
+  detexec_t * p_x = get_detexec ();
+  OMX_U32 i = 0;
+
+  if (!p_x || !ap_slot)
+    {
+      return;
+    }
+
+  (void) pthread_mutex_lock (&(p_x->mutex));
+  for (i = 0; i < p_x->nslots; ++i)
+    {
+      if (p_x->p_slots[i] == ap_slot)
+        {
+          /* Keep registration order; it is what the seeded choice is based
+             on */
+          memmove (&(p_x->p_slots[i]), &(p_x->p_slots[i + 1]),
+                   (p_x->nslots - i - 1) * sizeof (tiz_detexec_slot_t *));
+          p_x->nslots--;
+          break;
+        }
+    }
+  if (p_x->p_holder == ap_slot)
+    {
+      p_x->p_holder = NULL;
+    }
+  (void) pthread_cond_broadcast (&(p_x->cond));
+  (void) pthread_mutex_unlock (&(p_x->mutex));
+
+  tiz_mem_free (ap_slot);
+}
+
+void
+tiz_detexec_msg_posted (tiz_detexec_slot_t * ap_slot)
+{
+  detexec_t * p_x = get_detexec ();
+  if (p_x && ap_slot)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      ap_slot->pending++;
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+}
+
+void
+tiz_detexec_msg_cancelled (tiz_detexec_slot_t * ap_slot)
+{
+  detexec_t * p_x = get_detexec ();
+  if (p_x && ap_slot)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      ap_slot->pending--;
+      (void) pthread_cond_broadcast (&(p_x->cond));
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+}
+
+void
+tiz_detexec_acquire (tiz_detexec_slot_t * ap_slot, const char * ap_label)
+{
+  detexec_t * p_x = get_detexec ();
+  if (p_x && ap_slot)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      ap_slot->pending--;
+      wait_turn (p_x, ap_slot, ap_label);
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+}
+
+void
+tiz_detexec_release (tiz_detexec_slot_t * ap_slot,
+                     tiz_detexec_slot_t * ap_unblocked)
+{
+  detexec_t * p_x = get_detexec ();
+  if (p_x && ap_slot)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      if (p_x->p_holder == ap_slot)
+        {
+          p_x->p_holder = NULL;
+        }
+      if (ap_unblocked && ap_unblocked->suspended)
+        {
+          /* The blocked thread is about to be woken up; hold the next grant
+             until it is back at the gate */
+          ap_unblocked->suspended = OMX_FALSE;
+          ap_unblocked->resuming = OMX_TRUE;
+        }
+      (void) pthread_cond_broadcast (&(p_x->cond));
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+}
+
+tiz_detexec_slot_t *
+tiz_detexec_suspend (void)
+{
+  detexec_t * p_x = get_detexec ();
+  tiz_detexec_slot_t * p_slot = NULL;
+
+  if (p_x)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      if (p_x->p_holder && p_x->p_holder->tid == tiz_thread_id ())
+        {
+          p_slot = p_x->p_holder;
+          p_slot->suspended = OMX_TRUE;
+          p_x->p_holder = NULL;
+          (void) pthread_cond_broadcast (&(p_x->cond));
+        }
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+
+  return p_slot;
+}
+
+void
+tiz_detexec_resume (tiz_detexec_slot_t * ap_slot)
+{
+  detexec_t * p_x = get_detexec ();
+  if (p_x && ap_slot)
+    {
+      (void) pthread_mutex_lock (&(p_x->mutex));
+      wait_turn (p_x, ap_slot, DETEXEC_LABEL_RESUME);
+      (void) pthread_mutex_unlock (&(p_x->mutex));
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizdetexec.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Deterministic executor (test mode)
+ *
+ * In this mode, scheduler threads only dispatch messages when the executor
+ * gives them the turn, one component at a time. The executor waits until
+ * every component is either idle or waiting for the turn, and then picks the
+ * next component using a seeded pseudo-random generator. Events from the
+ * event loop reach the components as scheduler messages, so they are
+ * serialised too.
+ *
+ * Every grant is written to a log. In replay mode, the executor reads a log
+ * and hands out the turn in exactly the same order.
+ *
+ * Settings ([ilcore] section of tizonia.conf, or environment variables,
+ * which take precedence):
+ *
+ * - deterministic-executor (TIZONIA_DETEXEC_MODE): off, record or replay
+ * - deterministic-executor-seed (TIZONIA_DETEXEC_SEED)
+ * - deterministic-executor-log (TIZONIA_DETEXEC_LOG)
+ */
+
+#ifndef TIZDETEXEC_H
+#define TIZDETEXEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct tiz_detexec_slot tiz_detexec_slot_t;
+
+/**
+ * Returns OMX_TRUE if the deterministic executor is enabled.
+ */
+OMX_BOOL
+tiz_detexec_enabled (void);
+
+/**
+ * Register a component with the executor. Components are identified in the
+ * log by their registration order, so graphs must be instantiated in the
+ * same order when replaying.
+ *
+ * @return A slot, or NULL if the executor is disabled.
+ */
+/*@null@*/ tiz_detexec_slot_t *
+tiz_detexec_register (const char * ap_cname);
+
+/**
+ * Unregister a component. Its scheduler thread must have exited.
+ */
+void
+tiz_detexec_unregister (/*@null@*/ tiz_detexec_slot_t * ap_slot);
+
+/**
+ * Account for a message that is about to be enqueued on a component's
+ * scheduler queue. Must be called before the message is enqueued.
+ */
+void
+tiz_detexec_msg_posted (/*@null@*/ tiz_detexec_slot_t * ap_slot);
+
+/**
+ * Undo tiz_detexec_msg_posted when the message could not be enqueued.
+ */
+void
+tiz_detexec_msg_cancelled (/*@null@*/ tiz_detexec_slot_t * ap_slot);
+
+/**
+ * Block the calling scheduler thread until it is given the turn to dispatch
+ * a message it has dequeued.
+ *
+ * @param ap_label The message class name (static storage duration).
+ */
+void
+tiz_detexec_acquire (/*@null@*/ tiz_detexec_slot_t * ap_slot,
+                     const char * ap_label);
+
+/**
+ * Give the turn back.
+ *
+ * @param ap_unblocked The slot of the scheduler thread that was blocked on
+ * the message just dispatched (see tiz_detexec_suspend), or NULL.
+ */
+void
+tiz_detexec_release (/*@null@*/ tiz_detexec_slot_t * ap_slot,
+                     /*@null@*/ tiz_detexec_slot_t * ap_unblocked);
+
+/**
+ * Called before the calling thread blocks waiting for another component to
+ * dispatch a message. If the calling thread holds the turn, the turn is
+ * given up until tiz_detexec_resume is called. The returned slot must travel
+ * with the message and be passed to tiz_detexec_release once the message has
+ * been dispatched.
+ *
+ * @return The calling thread's slot if it held the turn, NULL otherwise.
+ */
+/*@null@*/ tiz_detexec_slot_t *
+tiz_detexec_suspend (void);
+
+/**
+ * Take the turn back after tiz_detexec_suspend.
+ */
+void
+tiz_detexec_resume (/*@null@*/ tiz_detexec_slot_t * ap_slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZDETEXEC_H */
@@ -45,6 +45,8 @@
 #include "tizkernel.h"
 #include "tizkernel_decls.h"
 #include "tizkernel_internal.h"
+#include "tizltrace.h"
+#include "tizstats.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -1702,6 +1704,11 @@ krn_claim_buffer (const void * ap_obj, const OMX_U32 a_pid, const OMX_U32 a_pos,
       /* ... and delete it from the list */
       tiz_vector_erase (p_list, a_pos, 1);
 
+      tiz_ltrace_record (handleOf (p_obj), ETIZLTraceClaimBuffer, a_pid,
+                         p_hdr, NULL);
+      tiz_stats_buffer_claimed (tiz_get_stats (handleOf (p_obj)), a_pid,
+                                OMX_DirInput == pdir ? p_hdr->nFilledLen : 0);
+
       /* Now increment by one the claimed buffers count on this port */
       (void) TIZ_PORT_INC_CLAIMED_COUNT (p_port);
 
@@ -1790,6 +1797,12 @@ krn_release_buffer (const void * ap_obj, const OMX_U32 a_pid,
 
   assert (tiz_vector_length (p_list) < tiz_port_buffer_count (p_port));
 
+  tiz_ltrace_record (handleOf (p_obj), ETIZLTraceReleaseBuffer, a_pid, ap_hdr,
+                     NULL);
+  tiz_stats_buffer_released (
+    tiz_get_stats (handleOf (p_obj)), a_pid,
+    OMX_DirOutput == tiz_port_dir (p_port) ? ap_hdr->nFilledLen : 0);
+
   return enqueue_callback_msg (p_obj, ap_hdr, a_pid, tiz_port_dir (p_port));
 }
 
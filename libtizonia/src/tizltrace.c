@@ -0,0 +1,421 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizltrace.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Buffer and message latency tracing
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+
+#include <tizplatform.h>
+
+#include "tizltrace.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.ltrace"
+#endif
+
+#define LTRACE_RCFILE_SECTION "ilcore"
+#define LTRACE_DEFAULT_RING_SIZE 16384
+#define LTRACE_MAX_RING_SIZE (1024 * 1024)
+#define LTRACE_THREAD_NAME_LEN 16
+
+typedef struct ltrace_record ltrace_record_t;
+struct ltrace_record
+{
+  uint64_t ts_ns;
+  OMX_HANDLETYPE p_hdl;
+  const void * p_obj;
+  const char * p_label;
+  OMX_U32 pid;
+  tiz_ltrace_event_t event;
+};
+
+typedef struct ltrace_ring ltrace_ring_t;
+struct ltrace_ring
+{
+  ltrace_ring_t * p_next;
+  OMX_S32 tid;
+  char thread_name[LTRACE_THREAD_NAME_LEN + 1];
+  uint64_t count; /* Total number of records ever written */
+  ltrace_record_t records[]; /* Sized from the configuration */
+};
+
+typedef struct ltrace_comp ltrace_comp_t;
+struct ltrace_comp
+{
+  OMX_HANDLETYPE p_hdl;
+  char name[OMX_MAX_STRINGNAME_SIZE];
+  uint64_t begin_ns;
+  uint64_t end_ns;
+};
+
+typedef struct ltrace ltrace_t;
+struct ltrace
+{
+  OMX_BOOL enabled;
+  size_t ring_size;
+  char file_path[PATH_MAX];
+  pthread_key_t key;
+  pthread_mutex_t mutex;
+  ltrace_ring_t * p_ring_lst;
+  ltrace_comp_t * p_comps;
+  size_t ncomps;
+  size_t comps_capacity;
+};
+
+static pthread_once_t g_ltrace_once = PTHREAD_ONCE_INIT;
+static ltrace_t g_ltrace = {.enabled = OMX_FALSE,
+                            .mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static const char * g_ltrace_event_names[ETIZLTraceMax]
+  = {"EmptyThisBuffer", "FillThisBuffer", "claim", "release",
+     "BufferDone",      "enqueue",        "dequeue"};
+
+static inline uint64_t
+now_ns (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ((uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec);
+}
+
+static void
+dump_at_exit (void)
+{
+  (void) tiz_ltrace_dump (NULL);
+}
+
+static void
+init_ltrace (void)
+{
+  const char * p_enabled
+    = tiz_rcfile_get_value (LTRACE_RCFILE_SECTION, "latency-tracing-enabled");
+
+  if (p_enabled && 0 == strncasecmp (p_enabled, "true", 4))
+    {
+      const char * p_file
+        = tiz_rcfile_get_value (LTRACE_RCFILE_SECTION, "latency-tracing-file");
+      const char * p_size = tiz_rcfile_get_value (LTRACE_RCFILE_SECTION,
+                                                  "latency-tracing-ring-size");
+      long ring_size = p_size ? strtol (p_size, NULL, 10) : 0;
+
+      g_ltrace.ring_size
+        = (ring_size > 0 && ring_size <= LTRACE_MAX_RING_SIZE)
+            ? (size_t) ring_size
+            : LTRACE_DEFAULT_RING_SIZE;
+
+      if (p_file && strlen (p_file) > 0)
+        {
+          snprintf (g_ltrace.file_path, sizeof (g_ltrace.file_path), "%s",
+                    p_file);
+        }
+      else
+        {
+          snprintf (g_ltrace.file_path, sizeof (g_ltrace.file_path),
+                    "/tmp/tizonia-%d-ltrace.json", (int) getpid ());
+        }
+
+      if (0 == pthread_key_create (&g_ltrace.key, NULL))
+        {
+          g_ltrace.enabled = OMX_TRUE;
+          (void) atexit (dump_at_exit);
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "Latency tracing enabled : ring size [%zu] file [%s]",
+                   g_ltrace.ring_size, g_ltrace.file_path);
+        }
+    }
+}
+
+/*@null@*/ static ltrace_ring_t *
+get_ring (void)
+{
+  ltrace_ring_t * p_ring = pthread_getspecific (g_ltrace.key);
+
+  if (!p_ring)
+    {
+      /* Rings are never released; they must survive their threads so that
+         they can be dumped at exit */
+      p_ring = tiz_mem_calloc (1, sizeof (ltrace_ring_t)
+                                    + g_ltrace.ring_size
+                                        * sizeof (ltrace_record_t));
+      if (p_ring)
+        {
+          p_ring->tid = tiz_thread_id ();
+          (void) prctl (PR_GET_NAME, p_ring->thread_name, 0, 0, 0);
+          (void) pthread_mutex_lock (&g_ltrace.mutex);
+          p_ring->p_next = g_ltrace.p_ring_lst;
+          g_ltrace.p_ring_lst = p_ring;
+          (void) pthread_mutex_unlock (&g_ltrace.mutex);
+          (void) pthread_setspecific (g_ltrace.key, p_ring);
+        }
+    }
+
+  return p_ring;
+}
+
+static const char *
+find_cname (const OMX_HANDLETYPE ap_hdl, const uint64_t a_ts_ns)
+{
+  size_t i = g_ltrace.ncomps;
+  while (i-- > 0)
+    {
+      const ltrace_comp_t * p_comp = &(g_ltrace.p_comps[i]);
+      if (p_comp->p_hdl == ap_hdl && p_comp->begin_ns <= a_ts_ns
+          && (0 == p_comp->end_ns || a_ts_ns <= p_comp->end_ns))
+        {
+          return p_comp->name;
+        }
+    }
+  return "unknown";
+}
+
+static void
+write_record (FILE * ap_file, const int a_pid, const ltrace_ring_t * ap_ring,
+              const ltrace_record_t * ap_rec)
+{
+  const char * p_cname = find_cname (ap_rec->p_hdl, ap_rec->ts_ns);
+  const double ts_us = (double) ap_rec->ts_ns / 1000.0;
+
+  assert (ap_file);
+  assert (ap_ring);
+  assert (ap_rec);
+
+  switch (ap_rec->event)
+    {
+      case ETIZLTraceEmptyThisBuffer:
+      case ETIZLTraceFillThisBuffer:
+      case ETIZLTraceBufferDone:
+        {
+          /* A buffer's stay in a component is an async slice that begins
+             with the Empty/FillThisBuffer call and ends with the buffer's
+             callback (or its delivery to the tunneled component) */
+          fprintf (ap_file,
+                   ",\n{\"name\":\"%s\",\"cat\":\"buffer\",\"ph\":\"%s\","
+                   "\"id\":\"%p\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+                   "\"args\":{\"api\":\"%s\",\"port\":%u}}",
+                   p_cname,
+                   ETIZLTraceBufferDone == ap_rec->event ? "e" : "b",
+                   ap_rec->p_obj, ts_us, a_pid, (int) ap_ring->tid,
+                   g_ltrace_event_names[ap_rec->event],
+                   (unsigned int) ap_rec->pid);
+        }
+        break;
+      case ETIZLTraceClaimBuffer:
+      case ETIZLTraceReleaseBuffer:
+        {
+          fprintf (ap_file,
+                   ",\n{\"name\":\"%s\",\"cat\":\"buffer\",\"ph\":\"n\","
+                   "\"id\":\"%p\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,"
+                   "\"args\":{\"api\":\"%s\",\"port\":%u}}",
+                   p_cname, ap_rec->p_obj, ts_us, a_pid, (int) ap_ring->tid,
+                   g_ltrace_event_names[ap_rec->event],
+                   (unsigned int) ap_rec->pid);
+        }
+        break;
+      case ETIZLTraceMsgEnqueue:
+      case ETIZLTraceMsgDequeue:
+        {
+          /* The time a message spends in the scheduler's queue */
+          fprintf (ap_file,
+                   ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\","
+                   "\"id\":\"%p\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                   ap_rec->p_label ? ap_rec->p_label : "msg", p_cname,
+                   ETIZLTraceMsgEnqueue == ap_rec->event ? "b" : "e",
+                   ap_rec->p_obj, ts_us, a_pid, (int) ap_ring->tid);
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+OMX_BOOL
+tiz_ltrace_enabled (void)
+{
+  (void) pthread_once (&g_ltrace_once, init_ltrace);
+  return g_ltrace.enabled;
+}
+
+void
+tiz_ltrace_component_begin (const OMX_HANDLETYPE ap_hdl, const char * ap_cname)
+{
+  if (!tiz_ltrace_enabled () || !ap_hdl || !ap_cname)
+    {
+      return;
+    }
+
+  (void) pthread_mutex_lock (&g_ltrace.mutex);
+  if (g_ltrace.ncomps == g_ltrace.comps_capacity)
+    {
+      size_t new_capacity
+        = g_ltrace.comps_capacity ? 2 * g_ltrace.comps_capacity : 16;
+      ltrace_comp_t * p_comps = tiz_mem_realloc (
+        g_ltrace.p_comps, new_capacity * sizeof (ltrace_comp_t));
+      if (p_comps)
+        {
+          g_ltrace.p_comps = p_comps;
+          g_ltrace.comps_capacity = new_capacity;
+        }
+    }
+
+  if (g_ltrace.ncomps < g_ltrace.comps_capacity)
+    {
+      ltrace_comp_t * p_comp = &(g_ltrace.p_comps[g_ltrace.ncomps++]);
+      p_comp->p_hdl = ap_hdl;
+      snprintf (p_comp->name, sizeof (p_comp->name), "%s", ap_cname);
+      p_comp->begin_ns = now_ns ();
+      p_comp->end_ns = 0;
+    }
+  (void) pthread_mutex_unlock (&g_ltrace.mutex);
+}
+
+void
+tiz_ltrace_component_end (const OMX_HANDLETYPE ap_hdl)
+{
+  size_t i = 0;
+
+  if (!tiz_ltrace_enabled () || !ap_hdl)
+    {
+      return;
+    }
+
+  (void) pthread_mutex_lock (&g_ltrace.mutex);
+  for (i = 0; i < g_ltrace.ncomps; ++i)
+    {
+      if (g_ltrace.p_comps[i].p_hdl == ap_hdl
+          && 0 == g_ltrace.p_comps[i].end_ns)
+        {
+          g_ltrace.p_comps[i].end_ns = now_ns ();
+        }
+    }
+  (void) pthread_mutex_unlock (&g_ltrace.mutex);
+}
+
+void
+tiz_ltrace_record (const OMX_HANDLETYPE ap_hdl,
+                   const tiz_ltrace_event_t a_event, const OMX_U32 a_pid,
+                   const void * ap_obj, const char * ap_label)
+{
+  ltrace_ring_t * p_ring = NULL;
+
+  assert (a_event < ETIZLTraceMax);
+
+  if (!tiz_ltrace_enabled () || !(p_ring = get_ring ()))
+    {
+      return;
+    }
+
+  {
+    ltrace_record_t * p_rec
+      = &(p_ring->records[p_ring->count % g_ltrace.ring_size]);
+    p_rec->ts_ns = now_ns ();
+    p_rec->p_hdl = ap_hdl;
+    p_rec->p_obj = ap_obj;
+    p_rec->p_label = ap_label;
+    p_rec->pid = a_pid;
+    p_rec->event = a_event;
+    p_ring->count++;
+  }
+}
+
+OMX_ERRORTYPE
+tiz_ltrace_dump (const char * ap_file_path)
+{
+  FILE * p_file = NULL;
+  const ltrace_ring_t * p_ring = NULL;
+  const int pid = (int) getpid ();
+
+  if (!tiz_ltrace_enabled ())
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  if (!ap_file_path)
+    {
+      ap_file_path = g_ltrace.file_path;
+    }
+
+  if (!(p_file = fopen (ap_file_path, "w")))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to open [%s]", ap_file_path);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  (void) pthread_mutex_lock (&g_ltrace.mutex);
+
+  fprintf (p_file,
+           "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+           "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+           "\"args\":{\"name\":\"tizonia\"}}",
+           pid);
+
+  for (p_ring = g_ltrace.p_ring_lst; p_ring; p_ring = p_ring->p_next)
+    {
+      /* Oldest record first; the ring may have wrapped around */
+      uint64_t first = p_ring->count > g_ltrace.ring_size
+                         ? p_ring->count - g_ltrace.ring_size
+                         : 0;
+      uint64_t i = 0;
+
+      fprintf (p_file,
+               ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+               "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+               pid, (int) p_ring->tid, p_ring->thread_name);
+
+      for (i = first; i < p_ring->count; ++i)
+        {
+          write_record (p_file, pid, p_ring,
+                        &(p_ring->records[i % g_ltrace.ring_size]));
+        }
+    }
+
+  fprintf (p_file, "\n]}\n");
+
+  (void) pthread_mutex_unlock (&g_ltrace.mutex);
+
+  (void) fclose (p_file);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Latency trace written to [%s]",
+           ap_file_path);
+
+  return OMX_ErrorNone;
+}
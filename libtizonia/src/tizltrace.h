@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizltrace.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Buffer and message latency tracing
+ *
+ * Timestamps buffer headers and scheduler messages as they move through the
+ * components of a graph. Records are kept in per-thread ring buffers and
+ * written out in Chrome trace JSON format (loadable in chrome://tracing or
+ * the Perfetto UI). Tracing is always compiled in, but it is disabled unless
+ * 'latency-tracing-enabled = true' is found in the [ilcore] section of
+ * tizonia.conf.
+ */
+
+#ifndef TIZLTRACE_H
+#define TIZLTRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef enum tiz_ltrace_event tiz_ltrace_event_t;
+enum tiz_ltrace_event
+{
+  ETIZLTraceEmptyThisBuffer = 0,
+  ETIZLTraceFillThisBuffer,
+  ETIZLTraceClaimBuffer,
+  ETIZLTraceReleaseBuffer,
+  ETIZLTraceBufferDone,
+  ETIZLTraceMsgEnqueue,
+  ETIZLTraceMsgDequeue,
+  ETIZLTraceMax
+};
+
+/**
+ * Returns OMX_TRUE if latency tracing has been enabled in the configuration
+ * file.
+ */
+OMX_BOOL
+tiz_ltrace_enabled (void);
+
+/**
+ * Associate a component name with a component handle, for the lifetime of
+ * the component. Records that carry this handle are labelled with this name
+ * in the trace output.
+ */
+void
+tiz_ltrace_component_begin (const OMX_HANDLETYPE ap_hdl,
+                            const char * ap_cname);
+
+/**
+ * Mark the end of a component's lifetime.
+ */
+void
+tiz_ltrace_component_end (const OMX_HANDLETYPE ap_hdl);
+
+/**
+ * Record an event in the calling thread's ring buffer. This is a no-op when
+ * tracing is disabled.
+ *
+ * @param ap_hdl The component handle.
+ * @param a_event The event type.
+ * @param a_pid The port index, if any.
+ * @param ap_obj The buffer header or message being traced; used to correlate
+ * the begin and end of a buffer's or message's stay in the component.
+ * @param ap_label A string with static storage duration (e.g. a message
+ * class name), or NULL.
+ */
+void
+tiz_ltrace_record (const OMX_HANDLETYPE ap_hdl,
+                   const tiz_ltrace_event_t a_event, const OMX_U32 a_pid,
+                   const void * ap_obj, const char * ap_label);
+
+/**
+ * Write the contents of all the ring buffers to a file in Chrome trace JSON
+ * format. This is called automatically at process exit when tracing is
+ * enabled.
+ *
+ * @param ap_file_path The output file, or NULL to use the configured path.
+ */
+OMX_ERRORTYPE
+tiz_ltrace_dump (const char * ap_file_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZLTRACE_H */
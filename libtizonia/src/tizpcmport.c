@@ -31,6 +31,7 @@
 #endif
 
 #include <assert.h>
+#include <stdbool.h>
 
 #include <tizplatform.h>
 
@@ -43,6 +44,22 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.pcmport"
 #endif
 
+static bool
+pcmport_sample_format_fits (const OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE a_format,
+                            const OMX_U32 a_bits_per_sample)
+{
+  switch (a_format)
+    {
+      case OMX_AUDIO_SampleFormatS16:
+        return 16 == a_bits_per_sample;
+      case OMX_AUDIO_SampleFormatS32:
+      case OMX_AUDIO_SampleFormatF32:
+        return 32 == a_bits_per_sample;
+      default:
+        return true;
+    };
+}
+
 static OMX_ERRORTYPE
 pcmport_SetParameter_common (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
                              OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
@@ -122,6 +139,35 @@ pcmport_SetParameter_common (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
               p_obj->pcmmode_.eChannelMapping[i]
                 = p_pcmmode->eChannelMapping[i];
             }
+
+          /* An explicit sample format does not survive a change of sample
+           * width */
+          if (!pcmport_sample_format_fits (p_obj->sampleformat_.eFormat,
+                                           p_obj->pcmmode_.nBitPerSample))
+            {
+              p_obj->sampleformat_.eFormat = OMX_AUDIO_SampleFormatAuto;
+            }
+        }
+        break;
+
+      case OMX_TizoniaIndexParamAudioSampleFormat:
+        {
+          const OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE * p_format
+            = (OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE *) ap_struct;
+
+          if (p_format->eFormat > OMX_AUDIO_SampleFormatF32
+              || !pcmport_sample_format_fits (p_format->eFormat,
+                                              p_obj->pcmmode_.nBitPerSample))
+            {
+              TIZ_ERROR (ap_hdl,
+                         "[OMX_ErrorBadParameter] : PORT [%d] "
+                         "SetParameter [%s]... Sample format [%d] does not "
+                         "match bits per sample [%d]",
+                         tiz_port_dir (p_obj), tiz_idx_to_str (a_index),
+                         p_format->eFormat, p_obj->pcmmode_.nBitPerSample);
+              return OMX_ErrorBadParameter;
+            }
+          p_obj->sampleformat_.eFormat = p_format->eFormat;
         }
         break;
 
@@ -156,6 +202,8 @@ pcmport_ctor (void * ap_obj, va_list * app)
     tiz_port_register_index (p_obj, OMX_IndexConfigAudioVolume));
   tiz_check_omx_ret_null (
     tiz_port_register_index (p_obj, OMX_IndexConfigAudioMute));
+  tiz_check_omx_ret_null (
+    tiz_port_register_index (p_obj, OMX_TizoniaIndexParamAudioSampleFormat));
 
   /* Initialize the OMX_AUDIO_PARAM_PCMMODETYPE structure */
   if ((p_pcmmode = va_arg (*app, OMX_AUDIO_PARAM_PCMMODETYPE *)))
@@ -176,6 +224,13 @@ pcmport_ctor (void * ap_obj, va_list * app)
                  p_obj->pcmmode_.nSamplingRate);
     }
 
+  /* 32-bit ports carry floats unless told otherwise */
+  p_obj->sampleformat_.nSize
+    = sizeof (OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE);
+  p_obj->sampleformat_.nVersion.nVersion = OMX_VERSION;
+  p_obj->sampleformat_.nPortIndex = p_base->portdef_.nPortIndex;
+  p_obj->sampleformat_.eFormat = OMX_AUDIO_SampleFormatAuto;
+
   /* Initialize the OMX_AUDIO_CONFIG_VOLUMETYPE structure */
   if ((p_volume = va_arg (*app, OMX_AUDIO_CONFIG_VOLUMETYPE *)))
     {
@@ -233,6 +288,14 @@ pcmport_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
           break;
         }
 
+      case OMX_TizoniaIndexParamAudioSampleFormat:
+        {
+          OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE * p_format
+            = (OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE *) ap_struct;
+          p_format->eFormat = p_obj->sampleformat_.eFormat;
+          break;
+        }
+
       default:
         {
           /* Try the parent's indexes */
@@ -285,6 +348,13 @@ pcmport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
         }
         break;
 
+      case OMX_TizoniaIndexParamAudioSampleFormat:
+        {
+          rc = pcmport_SetParameter_common (ap_obj, ap_hdl, a_index,
+                                            ap_struct);
+        }
+        break;
+
       default:
         {
           /* Try the parent's indexes */
@@ -407,8 +477,10 @@ pcmport_SetParameter_internal (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   switch (a_index)
     {
       case OMX_IndexParamAudioPcm:
+      case OMX_TizoniaIndexParamAudioSampleFormat:
         {
-          rc = pcmport_SetParameter_common (ap_obj, ap_hdl, a_index, ap_struct);
+          rc = pcmport_SetParameter_common (ap_obj, ap_hdl, a_index,
+                                            ap_struct);
         }
         break;
       default:
@@ -33,6 +33,10 @@
 #include <assert.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <OMX_Types.h>
 #include <OMX_TizoniaExt.h>
@@ -40,6 +44,7 @@
 #include <tizplatform.h>
 
 #include "tizutils.h"
+#include "tizscheduler.h"
 #include "tizport-macros.h"
 #include "tizport.h"
 #include "tizport_decls.h"
@@ -181,6 +186,21 @@ default_free_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv, void * ap_args)
   tiz_mem_free (ap_buf);
 }
 
+/* Page locks don't nest, so a buffer only pins the pages that lie entirely
+   within it. A page shared with a neighbouring buffer is left alone;
+   otherwise freeing one buffer would unpin part of the other. Returns the
+   length of the range, or 0 if the buffer doesn't span a whole page */
+static size_t
+get_buffer_pages (const OMX_U8 * ap_buf, const OMX_U32 a_size,
+                  void ** app_start)
+{
+  const uintptr_t page = (uintptr_t) sysconf (_SC_PAGESIZE);
+  const uintptr_t start = ((uintptr_t) ap_buf + page - 1) & ~(page - 1);
+  const uintptr_t end = ((uintptr_t) ap_buf + a_size) & ~(page - 1);
+  *app_start = (void *) start;
+  return end > start ? (size_t) (end - start) : 0;
+}
+
 static OMX_ERRORTYPE
 alloc_buffer (void * ap_obj, OMX_U32 * ap_size, OMX_U8 ** app_buf,
               OMX_PTR * app_portPrivate)
@@ -188,6 +208,8 @@ alloc_buffer (void * ap_obj, OMX_U32 * ap_size, OMX_U8 ** app_buf,
   tiz_port_t * p_obj = ap_obj;
   OMX_U8 * p_buf = NULL;
   OMX_U32 alloc_size = 0;
+  void * p_lock = NULL;
+  size_t lock_len = 0;
 
   assert (ap_size > 0);
   assert (app_buf);
@@ -206,6 +228,17 @@ alloc_buffer (void * ap_obj, OMX_U32 * ap_size, OMX_U8 ** app_buf,
 
   TIZ_TRACE (handleOf (p_obj), "size [%u] pBuffer [%p]", *ap_size, p_buf);
 
+  /* Pin the buffer to avoid page faults in the data path. The pages are
+     unlocked again in free_buffer */
+  if (OMX_TRUE == tiz_comp_mlock_buffers_enabled (handleOf (p_obj))
+      && (lock_len = get_buffer_pages (p_buf, alloc_size, &p_lock))
+      && 0 != mlock (p_lock, lock_len))
+    {
+      TIZ_NOTICE (handleOf (p_obj),
+                  "mlock failed on PORT [%d] (%s); buffer not locked",
+                  p_obj->pid_, strerror (errno));
+    }
+
   /* Verify 1.1.2 behaviour */
   if (OMX_TRUE == p_obj->announce_bufs_)
     {
@@ -219,11 +252,22 @@ alloc_buffer (void * ap_obj, OMX_U32 * ap_size, OMX_U8 ** app_buf,
 }
 
 static void
-free_buffer (void * ap_obj, OMX_PTR ap_buf, OMX_PTR /*@null@*/ ap_portPrivate)
+free_buffer (void * ap_obj, OMX_PTR ap_buf, const OMX_U32 a_size,
+             OMX_PTR /*@null@*/ ap_portPrivate)
 {
   tiz_port_t * p_obj = ap_obj;
   TIZ_TRACE (handleOf (ap_obj), "ap_buf[%p]", ap_buf);
   assert (ap_buf);
+  if (OMX_TRUE == tiz_comp_mlock_buffers_enabled (handleOf (p_obj)))
+    {
+      void * p_lock = NULL;
+      const size_t lock_len = get_buffer_pages (ap_buf, a_size, &p_lock);
+      if (lock_len > 0 && 0 != munlock (p_lock, lock_len))
+        {
+          TIZ_NOTICE (handleOf (p_obj), "munlock failed on PORT [%d] (%s)",
+                      p_obj->pid_, strerror (errno));
+        }
+    }
   p_obj->opts_.mem_hooks.pf_free (ap_buf, ap_portPrivate,
                                   p_obj->opts_.mem_hooks.p_args);
 }
@@ -1136,7 +1180,7 @@ port_AllocateBuffer (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   /* register this buffer header... */
   if (OMX_ErrorNone != register_header (p_obj, p_hdr, OMX_TRUE, NULL))
     {
-      free_buffer (p_obj, p_buf, p_port_priv);
+      free_buffer (p_obj, p_buf, buf_size, p_port_priv);
       tiz_mem_free (p_hdr);
       return OMX_ErrorInsufficientResources;
     }
@@ -1187,7 +1231,7 @@ port_FreeBuffer (const void * ap_obj, OMX_HANDLETYPE ap_hdl, OMX_U32 a_pid,
       OMX_PTR p_port_priv = OMX_DirInput == p_obj->portdef_.eDir
                               ? ap_hdr->pInputPortPrivate
                               : ap_hdr->pOutputPortPrivate;
-      free_buffer (p_obj, ap_hdr->pBuffer, p_port_priv);
+      free_buffer (p_obj, ap_hdr->pBuffer, ap_hdr->nAllocLen, p_port_priv);
     }
 
   p_unreg_hdr = unregister_header (p_obj, hdr_pos);
@@ -1715,7 +1759,7 @@ port_populate (const void * ap_obj)
 
       if ((OMX_ErrorNone != rc) || NULL == p_hdr)
         {
-          free_buffer (p_obj, p_buf, p_port_priv);
+          free_buffer (p_obj, p_buf, nbytes, p_port_priv);
 
           if (OMX_ErrorInsufficientResources == rc)
             {
@@ -1746,7 +1790,7 @@ port_populate (const void * ap_obj)
       /* register this buffer header... */
       if (OMX_ErrorNone != register_header (p_obj, p_hdr, OMX_FALSE, NULL))
         {
-          free_buffer (p_obj, p_buf, p_port_priv);
+          free_buffer (p_obj, p_buf, nbytes, p_port_priv);
 
           return OMX_ErrorInsufficientResources;
         }
@@ -1786,6 +1830,7 @@ port_depopulate (const void * ap_obj)
   OMX_U32 nbufs = 0, i = 0;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
   OMX_U8 * p_buf = NULL;
+  OMX_U32 nbytes = 0;
   OMX_PTR p_port_priv = NULL;
 
   nbufs = tiz_vector_length (p_obj->p_hdrs_info_);
@@ -1802,6 +1847,7 @@ port_depopulate (const void * ap_obj)
       if (p_hdr)
         {
           p_buf = p_hdr->pBuffer;
+          nbytes = p_hdr->nAllocLen;
           p_port_priv = OMX_DirInput == p_obj->portdef_.eDir
                           ? p_hdr->pInputPortPrivate
                           : p_hdr->pOutputPortPrivate;
@@ -1817,7 +1863,7 @@ port_depopulate (const void * ap_obj)
           /* At this point, the actual buffer header should no longer exist... */
           p_hdr = NULL;
 
-          free_buffer (p_obj, p_buf, p_port_priv);
+          free_buffer (p_obj, p_buf, nbytes, p_port_priv);
         }
     }
 
@@ -2068,7 +2114,7 @@ port_populate_header (const void * ap_obj, OMX_BUFFERHEADERTYPE * ap_hdr)
       p_port_priv = OMX_DirInput == p_obj->portdef_.eDir
                       ? ap_hdr->pInputPortPrivate
                       : ap_hdr->pOutputPortPrivate;
-      free_buffer (p_obj, ap_hdr->pBuffer, p_port_priv);
+      free_buffer (p_obj, ap_hdr->pBuffer, ap_hdr->nAllocLen, p_port_priv);
       ap_hdr->pBuffer = NULL;
       ap_hdr->nAllocLen = 0;
     }
@@ -2124,7 +2170,7 @@ port_depopulate_header (const void * ap_obj, OMX_BUFFERHEADERTYPE * ap_hdr)
                   ? ap_hdr->pInputPortPrivate
                   : ap_hdr->pOutputPortPrivate;
 
-  free_buffer (p_obj, ap_hdr->pBuffer, p_port_priv);
+  free_buffer (p_obj, ap_hdr->pBuffer, ap_hdr->nAllocLen, p_port_priv);
   ap_hdr->pBuffer = NULL;
   ap_hdr->nAllocLen = 0;
   ap_hdr->nFilledLen = 0;
@@ -31,7 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include <OMX_Core.h>
 #include <OMX_Component.h>
@@ -47,6 +49,9 @@
 #include "tizport.h"
 #include "tizobjsys.h"
 #include "tizscheduler.h"
+#include "tizltrace.h"
+#include "tizstats.h"
+#include "tizdetexec.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -134,6 +139,12 @@ struct tiz_scheduler
   tiz_sem_t sem;
   tiz_queue_t * p_queue;
   tiz_soa_t * p_soa;
+  tiz_soa_t * p_msg_soa; /* Thread-safe; shared by the IL client threads (or
+                            the event loop thread) that allocate messages and
+                            the scheduler thread that releases them */
+  tiz_stats_comp_t * p_stats; /* NULL when shm statistics are disabled */
+  OMX_BOOL mlock_buffers;
+  tiz_detexec_slot_t * p_detexec; /* NULL unless in deterministic test mode */
   tiz_os_t * p_objsys;
   OMX_S32 error;
   tiz_srv_group_t child;
@@ -355,6 +366,8 @@ struct tiz_sched_msg
   OMX_HANDLETYPE p_hdl;
   OMX_BOOL will_block;
   OMX_BOOL may_block;
+  tiz_detexec_slot_t * p_detexec_blocked; /* Deterministic executor slot of
+                                             a blocked scheduler thread */
   tiz_sched_msg_class_t class;
   union
   {
@@ -766,12 +779,22 @@ store_hooks (tiz_map_t ** app_map, OMX_U32 a_pid, const void * ap_hooks,
 }
 
 static inline OMX_ERRORTYPE
-send_msg_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
+send_msg_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg,
+                   tiz_detexec_slot_t * ap_blocked)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_msg);
   assert (ap_sched);
   ap_msg->will_block = OMX_TRUE;
-  tiz_check_omx_ret_oom (tiz_queue_send (ap_sched->p_queue, ap_msg));
+  ap_msg->p_detexec_blocked = ap_blocked;
+  tiz_detexec_msg_posted (ap_sched->p_detexec);
+  if (OMX_ErrorNone != (rc = tiz_queue_send (ap_sched->p_queue, ap_msg)))
+    {
+      tiz_detexec_msg_cancelled (ap_sched->p_detexec);
+      return OMX_ErrorInsufficientResources;
+    }
+  tiz_stats_queue_depth (ap_sched->p_stats,
+                         tiz_queue_length (ap_sched->p_queue));
   tiz_check_omx_ret_oom (tiz_sem_wait (&(ap_sched->sem)));
   return ap_sched->error;
 }
@@ -779,10 +802,19 @@ send_msg_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 static inline OMX_ERRORTYPE
 send_msg_non_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_msg);
   assert (ap_sched);
   ap_msg->will_block = OMX_FALSE;
-  return tiz_queue_send (ap_sched->p_queue, ap_msg);
+  tiz_detexec_msg_posted (ap_sched->p_detexec);
+  if (OMX_ErrorNone != (rc = tiz_queue_send (ap_sched->p_queue, ap_msg)))
+    {
+      tiz_detexec_msg_cancelled (ap_sched->p_detexec);
+      return rc;
+    }
+  tiz_stats_queue_depth (ap_sched->p_stats,
+                         tiz_queue_length (ap_sched->p_queue));
+  return OMX_ErrorNone;
 }
 
 static inline OMX_ERRORTYPE
@@ -794,6 +826,9 @@ send_msg (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
   assert (ap_sched);
   assert (ap_msg);
 
+  tiz_ltrace_record (ap_sched->child.p_hdl, ETIZLTraceMsgEnqueue, 0, ap_msg,
+                     tiz_sched_msg_to_str (ap_msg->class));
+
   if (tid == ap_sched->thread_id && ap_msg->class != ETIZSchedMsgPluggableEvent)
     {
       TIZ_WARN (ap_sched->child.p_hdl,
@@ -811,9 +846,24 @@ send_msg (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
         }
       else
         {
-          tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->mutex)));
-          rc = send_msg_blocking (ap_sched, ap_msg);
-          tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->mutex)));
+          /* If this is another component's scheduler thread, the turn is
+             given up before anything here can block it: the mutex may be
+             held by a client that is waiting for a component that needs
+             the turn */
+          tiz_detexec_slot_t * p_blocked = tiz_detexec_suspend ();
+          if (OMX_ErrorNone == (rc = tiz_mutex_lock (&(ap_sched->mutex))))
+            {
+              rc = send_msg_blocking (ap_sched, ap_msg, p_blocked);
+              if (OMX_ErrorNone != tiz_mutex_unlock (&(ap_sched->mutex)))
+                {
+                  rc = OMX_ErrorInsufficientResources;
+                }
+            }
+          else
+            {
+              rc = OMX_ErrorInsufficientResources;
+            }
+          tiz_detexec_resume (p_blocked);
         }
     }
 
@@ -1668,8 +1718,8 @@ init_scheduler_message (OMX_HANDLETYPE ap_hdl,
   assert (ap_hdl);
   assert (a_msg_class < ETIZSchedMsgMax);
 
-  if (!(p_msg
-        = (tiz_sched_msg_t *) tiz_mem_calloc (1, sizeof (tiz_sched_msg_t))))
+  if (!(p_msg = (tiz_sched_msg_t *) tiz_soa_calloc (
+          get_sched (ap_hdl)->p_msg_soa, sizeof (tiz_sched_msg_t))))
     {
       TIZ_ERROR (ap_hdl,
                  "[OMX_ErrorInsufficientResources] : "
@@ -1948,7 +1998,7 @@ sched_SetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
       if (!(p_msg_sconf->p_struct
             = tiz_mem_calloc (1, (*(OMX_U32 *) ap_struct))))
         {
-          tiz_mem_free (p_msg);
+          tiz_soa_free (p_sched->p_msg_soa, p_msg);
           TIZ_ERROR (ap_hdl,
                      "[OMX_ErrorInsufficientResources] : "
                      "(While allocating memory for config struct)");
@@ -2172,6 +2222,10 @@ sched_EmptyThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
 
   p_sched = get_sched (ap_hdl);
 
+  tiz_ltrace_record (ap_hdl, ETIZLTraceEmptyThisBuffer,
+                     ap_hdr->nInputPortIndex, ap_hdr, NULL);
+  tiz_stats_buffer_received (p_sched->p_stats, ap_hdr->nInputPortIndex);
+
   TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, ETIZSchedMsgEmptyThisBuffer);
 
   assert (p_msg);
@@ -2199,6 +2253,10 @@ sched_FillThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
 
   p_sched = get_sched (ap_hdl);
 
+  tiz_ltrace_record (ap_hdl, ETIZLTraceFillThisBuffer,
+                     ap_hdr->nOutputPortIndex, ap_hdr, NULL);
+  tiz_stats_buffer_received (p_sched->p_stats, ap_hdr->nOutputPortIndex);
+
   TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, ETIZSchedMsgFillThisBuffer);
 
   assert (p_msg);
@@ -2317,6 +2375,10 @@ dispatch_msg (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   TIZ_TRACE (ap_sched->child.p_hdl, "msg [%p] class [%s]", ap_msg,
              tiz_sched_msg_to_str (ap_msg->class));
 
+  tiz_ltrace_record (ap_sched->child.p_hdl, ETIZLTraceMsgDequeue, 0, ap_msg,
+                     tiz_sched_msg_to_str (ap_msg->class));
+  tiz_stats_msg (ap_sched->p_stats);
+
   signal_client = ap_msg->will_block;
 
   rc = tiz_sched_msg_to_fnt_tbl[ap_msg->class](ap_sched, ap_state, ap_msg);
@@ -2324,7 +2386,7 @@ dispatch_msg (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   /* Return error to client */
   ap_sched->error = rc;
 
-  tiz_mem_free (ap_msg);
+  tiz_soa_free (ap_sched->p_msg_soa, ap_msg);
 
   return signal_client;
 }
@@ -2389,25 +2451,47 @@ schedule_servants (tiz_scheduler_t * ap_sched, const tiz_sched_state_t ap_state)
   /*     } */
 }
 
+static const char *
+get_comp_setting (const tiz_scheduler_t * ap_sched, const char * ap_key)
+{
+  char fqd_key[OMX_MAX_STRINGNAME_SIZE];
+  assert (ap_sched);
+  assert (ap_key);
+  /* OMX.component.name.key */
+  (void) snprintf (fqd_key, OMX_MAX_STRINGNAME_SIZE, "%s.%s", ap_sched->cname,
+                   ap_key);
+  return tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, fqd_key);
+}
+
 static void *
 il_sched_thread_func (void * p_arg)
 {
   tiz_scheduler_t * p_sched = (tiz_scheduler_t *) (p_arg);
   OMX_PTR p_data = NULL;
   OMX_BOOL signal_client = OMX_FALSE;
+  tiz_detexec_slot_t * p_unblocked = NULL;
 
   assert (p_sched);
 
   p_sched->thread_id = tiz_thread_id ();
+  tiz_thread_apply_settings (p_sched->cname);
   tiz_check_omx_ret_null (tiz_sem_post (&(p_sched->sem)));
 
   for (;;)
     {
       tiz_check_omx_ret_null (tiz_queue_receive (p_sched->p_queue, &p_data));
+      tiz_stats_sched_loop (p_sched->p_stats);
 
       assert (p_data);
+      tiz_detexec_acquire (
+        p_sched->p_detexec,
+        tiz_sched_msg_to_str (((tiz_sched_msg_t *) p_data)->class));
+      p_unblocked = ((tiz_sched_msg_t *) p_data)->p_detexec_blocked;
       signal_client
         = dispatch_msg (p_sched, &(p_sched->state), (tiz_sched_msg_t *) p_data);
+      /* The turn is given back before waking the client up, so that the
+         executor knows the client is about to come back for it */
+      tiz_detexec_release (p_sched->p_detexec, p_unblocked);
 
       if (OMX_TRUE == signal_client)
         {
@@ -2456,6 +2540,13 @@ delete_scheduler (tiz_scheduler_t * ap_sched)
   (void) tiz_sem_destroy (&(ap_sched->sem));
   tiz_queue_destroy (ap_sched->p_queue);
   ap_sched->p_queue = NULL;
+  tiz_soa_destroy (ap_sched->p_msg_soa);
+  ap_sched->p_msg_soa = NULL;
+  tiz_ltrace_component_end (ap_sched->child.p_hdl);
+  tiz_stats_comp_free (ap_sched->p_stats);
+  ap_sched->p_stats = NULL;
+  tiz_detexec_unregister (ap_sched->p_detexec);
+  ap_sched->p_detexec = NULL;
   tiz_mem_free (ap_sched);
 }
 
@@ -2479,6 +2570,7 @@ instantiate_scheduler (OMX_HANDLETYPE ap_hdl, const char * ap_cname)
   tiz_check_omx_ret_null (tiz_sem_init (&(p_sched->sem), 0));
   tiz_check_omx_ret_null (
     tiz_queue_init (&(p_sched->p_queue), SCHED_QUEUE_MAX_ITEMS));
+  tiz_check_omx_ret_null (tiz_soa_init_mt (&(p_sched->p_msg_soa)));
 
   p_sched->child.p_fsm = NULL;
   p_sched->child.p_ker = NULL;
@@ -2497,6 +2589,17 @@ instantiate_scheduler (OMX_HANDLETYPE ap_hdl, const char * ap_cname)
   strncpy (p_sched->cname, ap_cname, len);
   p_sched->cname[len] = '\0';
 
+  tiz_ltrace_component_begin (ap_hdl, p_sched->cname);
+  p_sched->p_stats = tiz_stats_comp_alloc (p_sched->cname);
+  p_sched->p_detexec = tiz_detexec_register (p_sched->cname);
+
+  {
+    const char * p_mlock = get_comp_setting (p_sched, "mlock_buffers");
+    p_sched->mlock_buffers
+      = (p_mlock && 0 == strncasecmp (p_mlock, "true", 4)) ? OMX_TRUE
+                                                           : OMX_FALSE;
+  }
+
   ((OMX_COMPONENTTYPE *) ap_hdl)->pComponentPrivate = p_sched;
 
   return p_sched;
@@ -3077,6 +3180,22 @@ tiz_get_prc (const OMX_HANDLETYPE ap_hdl)
   return p_sched->child.p_prc;
 }
 
+void *
+tiz_get_stats (const OMX_HANDLETYPE ap_hdl)
+{
+  tiz_scheduler_t * p_sched = get_sched (ap_hdl);
+  assert (p_sched);
+  return p_sched->p_stats;
+}
+
+OMX_BOOL
+tiz_comp_mlock_buffers_enabled (const OMX_HANDLETYPE ap_hdl)
+{
+  tiz_scheduler_t * p_sched = get_sched (ap_hdl);
+  assert (p_sched);
+  return p_sched->mlock_buffers;
+}
+
 void *
 tiz_get_type (const OMX_HANDLETYPE ap_hdl, const char * ap_type_name)
 {
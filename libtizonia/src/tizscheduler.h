@@ -441,6 +441,26 @@ tiz_get_krn (const OMX_HANDLETYPE ap_hdl);
 void *
 tiz_get_prc (const OMX_HANDLETYPE ap_hdl);
 
+/**
+ * Retrieve the component's shared-memory statistics slot.
+ * @ingroup tizscheduler
+ * @param ap_hdl The OpenMAX IL handle.
+ * @return The statistics slot (a tiz_stats_comp_t), or NULL if shm
+ * statistics are disabled.
+ */
+void *
+tiz_get_stats (const OMX_HANDLETYPE ap_hdl);
+
+/**
+ * Find out whether the component's port buffers are to be locked in memory
+ * ('OMX.component.name.mlock_buffers' setting in tizonia.conf).
+ * @ingroup tizscheduler
+ * @param ap_hdl The OpenMAX IL handle.
+ * @return OMX_TRUE if buffers should be locked, OMX_FALSE otherwise.
+ */
+OMX_BOOL
+tiz_comp_mlock_buffers_enabled (const OMX_HANDLETYPE ap_hdl);
+
 /**
  * Retrieve the component's servant 'scheduler' object.
  * @ingroup tizscheduler
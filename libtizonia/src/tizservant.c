@@ -35,6 +35,7 @@
 #include "tizutils.h"
 #include "tizservant.h"
 #include "tizservant_decls.h"
+#include "tizltrace.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -610,6 +611,10 @@ srv_issue_buf_callback (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr,
   assert (p_srv);
   assert (p_srv->p_cbacks_);
   assert (p_srv->p_cbacks_->EventHandler);
+
+  tiz_ltrace_record (handleOf (ap_obj), ETIZLTraceBufferDone, pid, p_hdr,
+                     NULL);
+
   if (ap_tcomp)
     {
       if (OMX_DirInput == dir)
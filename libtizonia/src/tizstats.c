@@ -0,0 +1,296 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizstats.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Shared-memory component statistics
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+
+#include <tizplatform.h>
+
+#include "tizscheduler.h"
+#include "tizstats.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.stats"
+#endif
+
+#define STATS_RCFILE_SECTION "ilcore"
+
+/* Readers only need eventually-consistent values; relaxed ordering keeps the
+   cost of an update to a single locked instruction */
+#define STATS_ADD(var, val) \
+  ((void) __atomic_add_fetch (&(var), (val), __ATOMIC_RELAXED))
+#define STATS_SUB(var, val) \
+  ((void) __atomic_sub_fetch (&(var), (val), __ATOMIC_RELAXED))
+#define STATS_STORE(var, val) \
+  __atomic_store_n (&(var), (val), __ATOMIC_RELAXED)
+#define STATS_LOAD(var) __atomic_load_n (&(var), __ATOMIC_RELAXED)
+
+typedef struct stats stats_t;
+struct stats
+{
+  tiz_stats_segment_t * p_seg;
+  char shm_name[64];
+  pthread_mutex_t mutex;
+};
+
+static pthread_once_t g_stats_once = PTHREAD_ONCE_INIT;
+static stats_t g_stats = {.p_seg = NULL, .mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static void
+unlink_segment (void)
+{
+  if (g_stats.p_seg && g_stats.p_seg->pid == (uint32_t) getpid ())
+    {
+      (void) shm_unlink (g_stats.shm_name);
+    }
+}
+
+static void
+init_stats (void)
+{
+  const char * p_enabled
+    = tiz_rcfile_get_value (STATS_RCFILE_SECTION, "shm-stats-enabled");
+  int fd = -1;
+  void * p_addr = MAP_FAILED;
+
+  if (!p_enabled || 0 != strncasecmp (p_enabled, "true", 4))
+    {
+      return;
+    }
+
+  snprintf (g_stats.shm_name, sizeof (g_stats.shm_name), "%s%d",
+            TIZ_STATS_SHM_PREFIX, (int) getpid ());
+
+  if ((fd = shm_open (g_stats.shm_name, O_CREAT | O_RDWR | O_TRUNC, 0644)) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "shm_open [%s] failed", g_stats.shm_name);
+      return;
+    }
+
+  if (0 == ftruncate (fd, sizeof (tiz_stats_segment_t)))
+    {
+      p_addr = mmap (NULL, sizeof (tiz_stats_segment_t),
+                     PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+  (void) close (fd);
+
+  if (MAP_FAILED == p_addr)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to map [%s]", g_stats.shm_name);
+      (void) shm_unlink (g_stats.shm_name);
+      return;
+    }
+
+  g_stats.p_seg = p_addr;
+  (void) memset (g_stats.p_seg, 0, sizeof (tiz_stats_segment_t));
+  g_stats.p_seg->version = TIZ_STATS_VERSION;
+  g_stats.p_seg->pid = (uint32_t) getpid ();
+  g_stats.p_seg->max_components = TIZ_STATS_MAX_COMPONENTS;
+  g_stats.p_seg->max_ports = TIZ_STATS_MAX_PORTS;
+  g_stats.p_seg->start_time = (uint64_t) time (NULL);
+  (void) prctl (PR_GET_NAME, g_stats.p_seg->proc_name, 0, 0, 0);
+  /* The magic number is published last; readers ignore segments without
+     it */
+  __atomic_store_n (&(g_stats.p_seg->magic), TIZ_STATS_MAGIC,
+                    __ATOMIC_RELEASE);
+
+  (void) atexit (unlink_segment);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Statistics segment [%s] created",
+           g_stats.shm_name);
+}
+
+static tiz_stats_port_t *
+get_port (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid)
+{
+  if (!ap_comp)
+    {
+      return NULL;
+    }
+  if (a_pid >= TIZ_STATS_MAX_PORTS)
+    {
+      if (0 == __atomic_fetch_add (&(ap_comp->untracked_events), 1,
+                                   __ATOMIC_RELAXED))
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "[%s] : port [%u] and above are not tracked "
+                   "(max ports [%d])",
+                   ap_comp->name, (unsigned int) a_pid, TIZ_STATS_MAX_PORTS);
+        }
+      return NULL;
+    }
+  return &(ap_comp->ports[a_pid]);
+}
+
+tiz_stats_comp_t *
+tiz_stats_comp_alloc (const char * ap_cname)
+{
+  tiz_stats_comp_t * p_comp = NULL;
+  int i = 0;
+
+  (void) pthread_once (&g_stats_once, init_stats);
+
+  if (!g_stats.p_seg)
+    {
+      return NULL;
+    }
+
+  (void) pthread_mutex_lock (&g_stats.mutex);
+  for (i = 0; i < TIZ_STATS_MAX_COMPONENTS; ++i)
+    {
+      if (0 == STATS_LOAD (g_stats.p_seg->comps[i].in_use))
+        {
+          p_comp = &(g_stats.p_seg->comps[i]);
+          (void) memset (p_comp, 0, sizeof (tiz_stats_comp_t));
+          snprintf (p_comp->name, sizeof (p_comp->name), "%s",
+                    ap_cname ? ap_cname : "");
+          __atomic_store_n (&(p_comp->in_use), 1, __ATOMIC_RELEASE);
+          break;
+        }
+    }
+  (void) pthread_mutex_unlock (&g_stats.mutex);
+
+  if (!p_comp)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] : no statistics slots left",
+               ap_cname);
+    }
+
+  return p_comp;
+}
+
+void
+tiz_stats_comp_free (tiz_stats_comp_t * ap_comp)
+{
+  if (ap_comp)
+    {
+      __atomic_store_n (&(ap_comp->in_use), 0, __ATOMIC_RELEASE);
+    }
+}
+
+void
+tiz_stats_queue_depth (tiz_stats_comp_t * ap_comp, const OMX_S32 a_depth)
+{
+  if (ap_comp && a_depth >= 0)
+    {
+      STATS_STORE (ap_comp->queue_depth, (uint64_t) a_depth);
+      if ((uint64_t) a_depth > STATS_LOAD (ap_comp->queue_depth_max))
+        {
+          /* Racy but monotonic enough for a high-water mark */
+          STATS_STORE (ap_comp->queue_depth_max, (uint64_t) a_depth);
+        }
+    }
+}
+
+void
+tiz_stats_sched_loop (tiz_stats_comp_t * ap_comp)
+{
+  if (ap_comp)
+    {
+      STATS_ADD (ap_comp->sched_loops, 1);
+    }
+}
+
+void
+tiz_stats_msg (tiz_stats_comp_t * ap_comp)
+{
+  if (ap_comp)
+    {
+      STATS_ADD (ap_comp->msgs, 1);
+    }
+}
+
+void
+tiz_stats_buffer_received (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid)
+{
+  tiz_stats_port_t * p_port = get_port (ap_comp, a_pid);
+  if (p_port)
+    {
+      STATS_ADD (p_port->buffers_received, 1);
+    }
+}
+
+void
+tiz_stats_buffer_claimed (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid,
+                          const OMX_U32 a_bytes)
+{
+  tiz_stats_port_t * p_port = get_port (ap_comp, a_pid);
+  if (p_port)
+    {
+      STATS_ADD (p_port->buffers_in_flight, 1);
+      STATS_ADD (p_port->bytes, a_bytes);
+    }
+}
+
+void
+tiz_stats_buffer_released (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid,
+                           const OMX_U32 a_bytes)
+{
+  tiz_stats_port_t * p_port = get_port (ap_comp, a_pid);
+  if (p_port)
+    {
+      STATS_SUB (p_port->buffers_in_flight, 1);
+      STATS_ADD (p_port->buffers_returned, 1);
+      STATS_ADD (p_port->bytes, a_bytes);
+    }
+}
+
+void
+tiz_stats_underrun (const OMX_HANDLETYPE ap_hdl)
+{
+  tiz_stats_comp_t * p_comp = ap_hdl ? tiz_get_stats (ap_hdl) : NULL;
+  if (p_comp)
+    {
+      STATS_ADD (p_comp->underruns, 1);
+    }
+}
+
+void
+tiz_stats_overrun (const OMX_HANDLETYPE ap_hdl)
+{
+  tiz_stats_comp_t * p_comp = ap_hdl ? tiz_get_stats (ap_hdl) : NULL;
+  if (p_comp)
+    {
+      STATS_ADD (p_comp->overruns, 1);
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizstats.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Shared-memory component statistics
+ *
+ * When 'shm-stats-enabled = true' is found in the [ilcore] section of
+ * tizonia.conf, each process publishes a POSIX shared memory segment named
+ * '/tizonia-stats.<pid>' with one slot of counters per live component. The
+ * counters are updated with relaxed atomic operations and can be read by an
+ * external monitor (see tools/tizonia-shm-top).
+ */
+
+#ifndef TIZSTATS_H
+#define TIZSTATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/* The segment layout below is shared with out-of-process readers. Bump
+   TIZ_STATS_VERSION whenever it changes. All fields are naturally aligned
+   64-bit quantities or fixed-size character arrays, so that the layout does
+   not depend on the compiler's padding rules. */
+#define TIZ_STATS_SHM_PREFIX "/tizonia-stats."
+#define TIZ_STATS_MAGIC 0x54495a53 /* 'TIZS' */
+#define TIZ_STATS_VERSION 2
+#define TIZ_STATS_MAX_COMPONENTS 32
+#define TIZ_STATS_MAX_PORTS 8
+#define TIZ_STATS_NAME_LEN 128
+#define TIZ_STATS_PROC_NAME_LEN 32
+
+typedef struct tiz_stats_port tiz_stats_port_t;
+struct tiz_stats_port
+{
+  uint64_t buffers_in_flight; /* Buffers currently claimed by the processor */
+  uint64_t buffers_received;  /* Empty/FillThisBuffer calls on this port */
+  uint64_t buffers_returned;  /* Buffers released by the processor */
+  uint64_t bytes;             /* Bytes consumed (input) or produced (output) */
+};
+
+typedef struct tiz_stats_comp tiz_stats_comp_t;
+struct tiz_stats_comp
+{
+  uint64_t in_use;
+  char name[TIZ_STATS_NAME_LEN];
+  uint64_t queue_depth;     /* Scheduler queue length at last enqueue */
+  uint64_t queue_depth_max; /* High-water mark of the scheduler queue */
+  uint64_t sched_loops;     /* Scheduler loop iterations */
+  uint64_t msgs;            /* Scheduler messages dispatched */
+  uint64_t underruns;
+  uint64_t overruns;
+  uint64_t untracked_events; /* Buffer events on ports beyond the last slot */
+  tiz_stats_port_t ports[TIZ_STATS_MAX_PORTS];
+};
+
+typedef struct tiz_stats_segment tiz_stats_segment_t;
+struct tiz_stats_segment
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pid;
+  uint32_t max_components;
+  uint32_t max_ports;
+  uint32_t reserved;
+  uint64_t start_time; /* Seconds since the epoch */
+  char proc_name[TIZ_STATS_PROC_NAME_LEN];
+  tiz_stats_comp_t comps[TIZ_STATS_MAX_COMPONENTS];
+};
+
+/**
+ * Reserve a slot in the process's statistics segment for a new component.
+ * The segment is created on first use.
+ *
+ * @return The component's slot, or NULL if statistics are disabled or no
+ * more slots are available.
+ */
+/*@null@*/ tiz_stats_comp_t *
+tiz_stats_comp_alloc (const char * ap_cname);
+
+/**
+ * Release a component's slot.
+ */
+void
+tiz_stats_comp_free (/*@null@*/ tiz_stats_comp_t * ap_comp);
+
+/* The following may be called with a NULL slot; they are no-ops in that
+   case */
+
+void
+tiz_stats_queue_depth (tiz_stats_comp_t * ap_comp, const OMX_S32 a_depth);
+
+void
+tiz_stats_sched_loop (tiz_stats_comp_t * ap_comp);
+
+void
+tiz_stats_msg (tiz_stats_comp_t * ap_comp);
+
+void
+tiz_stats_buffer_received (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid);
+
+void
+tiz_stats_buffer_claimed (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid,
+                          const OMX_U32 a_bytes);
+
+void
+tiz_stats_buffer_released (tiz_stats_comp_t * ap_comp, const OMX_U32 a_pid,
+                           const OMX_U32 a_bytes);
+
+/* Component-facing helpers */
+
+/**
+ * Count an underrun (e.g. an ALSA xrun or a PulseAudio underflow) in the
+ * component's statistics slot.
+ */
+void
+tiz_stats_underrun (const OMX_HANDLETYPE ap_hdl);
+
+/**
+ * Count an overrun (data lost because no buffers were available) in the
+ * component's statistics slot.
+ */
+void
+tiz_stats_overrun (const OMX_HANDLETYPE ap_hdl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSTATS_H */
@@ -0,0 +1,286 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_detexec.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Deterministic executor unit tests
+ *
+ * Three fake components, each one a thread with a mailbox, go through the
+ * same acquire/release/suspend/resume sequence as the scheduler. Component
+ * 0 makes a blocking call into component 1 for every message it
+ * dispatches. The executor reads its mode once per process, so every run
+ * happens in a child process.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "tizdetexec.h"
+
+#define DETEXEC_TEST_NCOMPS 3
+#define DETEXEC_TEST_NMSGS 50
+#define DETEXEC_TEST_QUEUE_LEN (2 * DETEXEC_TEST_NMSGS)
+/* Every component dispatches its own messages; component 1 also dispatches
+   component 0's calls */
+#define DETEXEC_TEST_NGRANTS ((DETEXEC_TEST_NCOMPS + 1) * DETEXEC_TEST_NMSGS)
+#define DETEXEC_TEST_LABEL_OWN "Own"
+#define DETEXEC_TEST_LABEL_CALL "Call"
+
+typedef struct detexec_test_msg detexec_test_msg_t;
+struct detexec_test_msg
+{
+  tiz_detexec_slot_t * p_blocked;
+  bool * p_done; /* NULL unless the sender is blocked on this message */
+};
+
+typedef struct detexec_test_comp detexec_test_comp_t;
+struct detexec_test_comp
+{
+  int id;
+  tiz_detexec_slot_t * p_slot;
+  pthread_t thread;
+  detexec_test_msg_t msgs[DETEXEC_TEST_QUEUE_LEN];
+  int head;
+  int tail;
+  int nmsgs;
+  unsigned int jitter_seed;
+};
+
+static pthread_mutex_t g_detexec_test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_detexec_test_cond = PTHREAD_COND_INITIALIZER;
+static detexec_test_comp_t g_detexec_test_comps[DETEXEC_TEST_NCOMPS];
+/* One character per dispatch: the component's letter, in upper case for
+   component 0's calls */
+static char g_detexec_test_order[DETEXEC_TEST_NGRANTS + 1];
+static int g_detexec_test_norder = 0;
+
+static void
+detexec_test_post (detexec_test_comp_t * ap_comp,
+                   tiz_detexec_slot_t * ap_blocked, bool * ap_done)
+{
+  tiz_detexec_msg_posted (ap_comp->p_slot);
+  pthread_mutex_lock (&g_detexec_test_mutex);
+  assert (ap_comp->head < DETEXEC_TEST_QUEUE_LEN);
+  ap_comp->msgs[ap_comp->head].p_blocked = ap_blocked;
+  ap_comp->msgs[ap_comp->head].p_done = ap_done;
+  ap_comp->head++;
+  pthread_cond_broadcast (&g_detexec_test_cond);
+  pthread_mutex_unlock (&g_detexec_test_mutex);
+}
+
+static void
+detexec_test_call (detexec_test_comp_t * ap_comp)
+{
+  bool done = false;
+  /* Same sequence as the scheduler's send_msg for blocking messages */
+  tiz_detexec_slot_t * p_blocked = tiz_detexec_suspend ();
+  detexec_test_post (ap_comp, p_blocked, &done);
+  pthread_mutex_lock (&g_detexec_test_mutex);
+  while (!done)
+    {
+      pthread_cond_wait (&g_detexec_test_cond, &g_detexec_test_mutex);
+    }
+  pthread_mutex_unlock (&g_detexec_test_mutex);
+  tiz_detexec_resume (p_blocked);
+}
+
+static void *
+detexec_test_comp_thread (void * ap_arg)
+{
+  detexec_test_comp_t * p_comp = ap_arg;
+  int i = 0;
+
+  for (i = 0; i < p_comp->nmsgs; ++i)
+    {
+      detexec_test_msg_t msg;
+
+      /* Let the threads reach the gate in a different order on every run */
+      usleep (rand_r (&(p_comp->jitter_seed)) % 500);
+
+      pthread_mutex_lock (&g_detexec_test_mutex);
+      while (p_comp->tail == p_comp->head)
+        {
+          pthread_cond_wait (&g_detexec_test_cond, &g_detexec_test_mutex);
+        }
+      msg = p_comp->msgs[p_comp->tail++];
+      pthread_mutex_unlock (&g_detexec_test_mutex);
+
+      tiz_detexec_acquire (p_comp->p_slot, msg.p_done
+                                             ? DETEXEC_TEST_LABEL_CALL
+                                             : DETEXEC_TEST_LABEL_OWN);
+
+      pthread_mutex_lock (&g_detexec_test_mutex);
+      assert (g_detexec_test_norder < DETEXEC_TEST_NGRANTS);
+      g_detexec_test_order[g_detexec_test_norder++]
+        = (char) ((msg.p_done ? 'A' : 'a') + p_comp->id);
+      pthread_mutex_unlock (&g_detexec_test_mutex);
+
+      if (0 == p_comp->id)
+        {
+          detexec_test_call (&(g_detexec_test_comps[1]));
+        }
+
+      tiz_detexec_release (p_comp->p_slot, msg.p_blocked);
+
+      if (msg.p_done)
+        {
+          pthread_mutex_lock (&g_detexec_test_mutex);
+          *(msg.p_done) = true;
+          pthread_cond_broadcast (&g_detexec_test_cond);
+          pthread_mutex_unlock (&g_detexec_test_mutex);
+        }
+    }
+
+  return NULL;
+}
+
+static void
+detexec_test_child (const char * ap_mode, const char * ap_seed,
+                    const char * ap_log, const char * ap_out)
+{
+  FILE * p_file = NULL;
+  int i = 0;
+  int j = 0;
+
+  setenv ("TIZONIA_DETEXEC_MODE", ap_mode, 1);
+  setenv ("TIZONIA_DETEXEC_SEED", ap_seed, 1);
+  setenv ("TIZONIA_DETEXEC_LOG", ap_log, 1);
+
+  if (!tiz_detexec_enabled ())
+    {
+      _exit (EXIT_FAILURE);
+    }
+
+  for (i = 0; i < DETEXEC_TEST_NCOMPS; ++i)
+    {
+      detexec_test_comp_t * p_comp = &(g_detexec_test_comps[i]);
+      char cname[OMX_MAX_STRINGNAME_SIZE];
+      snprintf (cname, sizeof (cname), "OMX.Aratelia.check.detexec%d", i);
+      p_comp->id = i;
+      p_comp->nmsgs = (1 == i ? 2 : 1) * DETEXEC_TEST_NMSGS;
+      p_comp->jitter_seed = (unsigned int) (getpid () + time (NULL) + i);
+      if (!(p_comp->p_slot = tiz_detexec_register (cname)))
+        {
+          _exit (EXIT_FAILURE);
+        }
+      for (j = 0; j < DETEXEC_TEST_NMSGS; ++j)
+        {
+          detexec_test_post (p_comp, NULL, NULL);
+        }
+    }
+
+  for (i = 0; i < DETEXEC_TEST_NCOMPS; ++i)
+    {
+      pthread_create (&(g_detexec_test_comps[i].thread), NULL,
+                      detexec_test_comp_thread, &(g_detexec_test_comps[i]));
+    }
+
+  for (i = 0; i < DETEXEC_TEST_NCOMPS; ++i)
+    {
+      pthread_join (g_detexec_test_comps[i].thread, NULL);
+      tiz_detexec_unregister (g_detexec_test_comps[i].p_slot);
+    }
+
+  if (!(p_file = fopen (ap_out, "w")))
+    {
+      _exit (EXIT_FAILURE);
+    }
+  fputs (g_detexec_test_order, p_file);
+  fclose (p_file);
+  _exit (EXIT_SUCCESS);
+}
+
+static void
+detexec_test_run (const char * ap_mode, const char * ap_seed,
+                  const char * ap_log, const char * ap_out, char * ap_order)
+{
+  FILE * p_file = NULL;
+  size_t len = 0;
+  int status = 0;
+  pid_t pid = fork ();
+
+  fail_if (pid < 0);
+  if (0 == pid)
+    {
+      detexec_test_child (ap_mode, ap_seed, ap_log, ap_out);
+    }
+
+  fail_if (pid != waitpid (pid, &status, 0));
+  fail_if (!WIFEXITED (status) || EXIT_SUCCESS != WEXITSTATUS (status));
+
+  fail_if (!(p_file = fopen (ap_out, "r")));
+  len = fread (ap_order, 1, DETEXEC_TEST_NGRANTS, p_file);
+  ap_order[len] = '\0';
+  fclose (p_file);
+  fail_if (DETEXEC_TEST_NGRANTS != len);
+}
+
+START_TEST (test_detexec_record_is_seeded)
+{
+  char dir[] = "/tmp/check_detexec.XXXXXX";
+  char log[PATH_MAX];
+  char out[PATH_MAX];
+  char first[DETEXEC_TEST_NGRANTS + 1];
+  char second[DETEXEC_TEST_NGRANTS + 1];
+
+  fail_if (!mkdtemp (dir));
+  snprintf (log, sizeof (log), "%s/detexec.log", dir);
+  snprintf (out, sizeof (out), "%s/order", dir);
+
+  detexec_test_run ("record", "3", log, out, first);
+  detexec_test_run ("record", "3", log, out, second);
+
+  fail_if (0 != strcmp (first, second), "[%s] != [%s]", first, second);
+
+  unlink (log);
+  unlink (out);
+  rmdir (dir);
+}
+END_TEST
+
+START_TEST (test_detexec_replay_matches_record)
+{
+  char dir[] = "/tmp/check_detexec.XXXXXX";
+  char log[PATH_MAX];
+  char out[PATH_MAX];
+  char recorded[DETEXEC_TEST_NGRANTS + 1];
+  char replayed[DETEXEC_TEST_NGRANTS + 1];
+
+  fail_if (!mkdtemp (dir));
+  snprintf (log, sizeof (log), "%s/detexec.log", dir);
+  snprintf (out, sizeof (out), "%s/order", dir);
+
+  detexec_test_run ("record", "7", log, out, recorded);
+  /* The seed passed to the replay is ignored, since the log's "# seed" line
+     overrides it; the replay reproduces the order recorded in the log */
+  detexec_test_run ("replay", "11", log, out, replayed);
+
+  fail_if (0 != strcmp (recorded, replayed), "[%s] != [%s]", recorded,
+           replayed);
+
+  unlink (log);
+  unlink (out);
+  rmdir (dir);
+}
+END_TEST
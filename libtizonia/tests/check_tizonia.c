@@ -51,6 +51,7 @@
 #include "tizkernel.h"
 
 #include "check_tizonia.h"
+#include "./check_detexec.c"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -2076,11 +2077,29 @@ tiz_suite (void)
   return s;
 }
 
+Suite *
+tiz_detexec_suite (void)
+{
+  TCase *tc_detexec;
+  Suite *s = suite_create ("libtizonia-detexec");
+
+  tc_detexec = tcase_create ("detexec");
+  tcase_set_timeout (tc_detexec, 30);
+  tcase_add_test (tc_detexec, test_detexec_record_is_seeded);
+  tcase_add_test (tc_detexec, test_detexec_replay_matches_record);
+  suite_add_tcase (s, tc_detexec);
+
+  return s;
+}
+
 int
 main (void)
 {
   int number_failed;
-  SRunner *sr = srunner_create (tiz_suite ());
+  /* The executor's mode is read once per process; its suite goes first so
+     that nothing has read it before the children that set it are forked */
+  SRunner *sr = srunner_create (tiz_detexec_suite ());
+  srunner_add_suite (sr, tiz_suite ());
 
   tiz_log_init();
 
@@ -63,6 +63,7 @@
 #endif
 
 #define TIZ_EVENT_LOOP_THREAD_NAME "evloop"
+#define TIZ_EVENT_LOOP_SETTINGS_PREFIX "tizonia.event_loop"
 
 struct tiz_event_io
 {
@@ -324,11 +325,37 @@ init_event_loop_msg (tiz_event_loop_t * ap_event_loop,
 /*@end@*/
 /* NOTE: Stop ignoring splint warnings in this section  */
 
+static OMX_ERRORTYPE
+send_event_loop_msg (tiz_event_loop_msg_t * ap_msg)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_msg);
+
+  /* The message has been allocated and filled in outside of the critical
+     section; the mutex only protects the queue */
+  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
+  rc = tiz_pqueue_send (gp_event_loop->p_pq, ap_msg, ap_msg->priority);
+  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+
+  if (OMX_ErrorNone == rc)
+    {
+      ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
+    }
+  else
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : Failed to insert into the queue",
+               tiz_err_to_str (rc));
+      tiz_soa_free (gp_event_loop->p_soa, ap_msg);
+    }
+
+  return rc;
+}
+
 static OMX_ERRORTYPE
 enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
                 const tiz_event_loop_msg_class_t a_class)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_io_t * p_msg_io = NULL;
 
@@ -337,29 +364,12 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
           || ETIZEventLoopMsgIoStop == a_class
           || ETIZEventLoopMsgIoDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-    "Failed to initialise the event loop");
-
-  assert (p_msg);
-  p_msg_io = &(p_msg->io);
-  p_msg_io->p_ev_io = ap_ev_io;
-  p_msg_io->id = a_id;
-  tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
-    "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
-
-  /* All good */
-  rc = OMX_ErrorNone;
-
- end:
-
-  if (OMX_ErrorNone != rc)
+  if ((p_msg = init_event_loop_msg (gp_event_loop, (a_class))))
     {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+      p_msg_io = &(p_msg->io);
+      p_msg_io->p_ev_io = ap_ev_io;
+      p_msg_io->id = a_id;
+      (void) send_event_loop_msg (p_msg);
     }
 
   return OMX_ErrorNone;
@@ -369,7 +379,6 @@ static OMX_ERRORTYPE
 enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
                    const tiz_event_loop_msg_class_t a_class)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
 
@@ -379,39 +388,22 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
           || ETIZEventLoopMsgTimerRestart == a_class
           || ETIZEventLoopMsgTimerDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-    "Failed to initialise the event loop");
+  if (!(p_msg = init_event_loop_msg (gp_event_loop, (a_class))))
+    {
+      return OMX_ErrorUndefined;
+    }
 
-  assert (p_msg);
   p_msg_timer = &(p_msg->timer);
   p_msg_timer->p_ev_timer = ap_ev_timer;
   p_msg_timer->id = a_id;
-  tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
-    "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
 
-  /* All good */
-  rc = OMX_ErrorNone;
-
- end:
-
-  if (OMX_ErrorNone != rc)
-    {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-    }
-
-  return rc;
+  return send_event_loop_msg (p_msg);
 }
 
 static OMX_ERRORTYPE
 enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
                   const tiz_event_loop_msg_class_t a_class)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
 
@@ -420,28 +412,12 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
           || ETIZEventLoopMsgStatStop == a_class
           || ETIZEventLoopMsgStatDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null ((p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-                        "Failed to initialise the event loop");
-
-  assert (p_msg);
-  p_msg_stat = &(p_msg->stat);
-  p_msg_stat->p_ev_stat = ap_ev_stat;
-  p_msg_stat->id = a_id;
-  tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
-    "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
-
-  /* All good */
-  rc = OMX_ErrorNone;
-
- end:
-
-  if (OMX_ErrorNone != rc)
+  if ((p_msg = init_event_loop_msg (gp_event_loop, (a_class))))
     {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+      p_msg_stat = &(p_msg->stat);
+      p_msg_stat->p_ev_stat = ap_ev_stat;
+      p_msg_stat->id = a_id;
+      (void) send_event_loop_msg (p_msg);
     }
 
   return OMX_ErrorNone;
@@ -1020,6 +996,9 @@ event_loop_thread_func (void * p_arg)
 
   (void) tiz_thread_setname (&(p_event_loop->thread),
                              (const OMX_STRING) TIZ_EVENT_LOOP_THREAD_NAME);
+  /* The event loop is shared by all the components in the process, so it
+     has its own settings */
+  tiz_thread_apply_settings (TIZ_EVENT_LOOP_SETTINGS_PREFIX);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "Entering the dispatcher...");
   tiz_sem_post (&(p_event_loop->sem));
@@ -1125,8 +1104,9 @@ init_event_loop_thread (void)
       tiz_goto_end_on_omx_err (tiz_sem_init (&(gp_event_loop->sem), 0),
                            "Error initializing sem.");
 
-      /* Init the small object allocator */
-      tiz_goto_end_on_omx_err (tiz_soa_init (&(gp_event_loop->p_soa)),
+      /* Init the small object allocator; messages are allocated by the
+         client threads and released by the event loop thread */
+      tiz_goto_end_on_omx_err (tiz_soa_init_mt (&(gp_event_loop->p_soa)),
                            "Error initializing the small object allocator.");
 
       /* Init the priority queue */
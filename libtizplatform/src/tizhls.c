@@ -0,0 +1,608 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizhls.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - HLS segmenter
+ *
+ * Published segments live in a small array, oldest first, that holds the
+ * playlist window plus a couple of spare segments, so that a client that has
+ * just fetched the previous playlist can still get them. The array and the
+ * clients each hold a reference to a segment; whoever drops the last one
+ * frees it.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.hls"
+#endif
+
+#define HLS_SPARE_SEGMENTS 2
+#define HLS_SEGMENT_EXT ".mp3"
+#define HLS_SEGMENT_INITIAL_CAPACITY (16 * 1024)
+#define HLS_MP3_HEADER_BYTES 4
+#define HLS_PTS_OWNER "com.apple.streaming.transportStreamTimestamp"
+/* ID3v2 header + PRIV frame header + owner string and its NUL + 8-byte PTS */
+#define HLS_ID3_PRIV_BYTES (sizeof (HLS_PTS_OWNER) + 8)
+#define HLS_ID3_TAG_BYTES (10 + 10 + HLS_ID3_PRIV_BYTES)
+
+struct tiz_hls_segment
+{
+  OMX_U32 seq_;
+  unsigned char * p_data_;
+  size_t len_;
+  size_t cap_;
+  OMX_U64 samples_;
+  OMX_U32 rate_;
+  bool discontinuity_;
+  OMX_U32 refs_;
+};
+
+struct tiz_hls
+{
+  char * p_name_;
+  OMX_U32 target_ms_;
+  OMX_U32 window_;
+  tiz_hls_segment_t ** pp_segs_;
+  OMX_U32 nsegs_;
+  OMX_U32 next_seq_;
+  OMX_U32 disc_evicted_;
+  tiz_hls_segment_t * p_cur_;
+  bool pending_disc_;
+  bool synced_;
+  OMX_U32 rate_;
+  OMX_U32 channels_;
+  OMX_U64 pts_;
+  OMX_U64 pts_base_;
+  OMX_U64 base_samples_;
+  unsigned char * p_in_;
+  size_t in_len_;
+  size_t in_cap_;
+  char * p_playlist_;
+  bool dirty_;
+};
+
+typedef struct hls_frame hls_frame_t;
+struct hls_frame
+{
+  size_t len;
+  OMX_U32 rate;
+  OMX_U32 channels;
+  OMX_U32 samples;
+};
+
+static bool
+parse_frame_header (const unsigned char * ap_hdr, hls_frame_t * ap_frame)
+{
+  static const OMX_U32 mpeg1_kbps[16]
+    = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+  static const OMX_U32 mpeg2_kbps[16]
+    = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+  static const OMX_U32 mpeg1_rates[3] = {44100, 48000, 32000};
+  OMX_U32 version, layer, bitrate_idx, rate_idx, kbps;
+  bool mpeg1;
+
+  assert (ap_hdr);
+  assert (ap_frame);
+
+  if (ap_hdr[0] != 0xFF || (ap_hdr[1] & 0xE0) != 0xE0)
+    {
+      return false;
+    }
+
+  version = (ap_hdr[1] >> 3) & 0x03;
+  layer = (ap_hdr[1] >> 1) & 0x03;
+  bitrate_idx = ap_hdr[2] >> 4;
+  rate_idx = (ap_hdr[2] >> 2) & 0x03;
+
+  /* Layer III only; reserved version, free format and bad indexes are out */
+  if (version == 1 || layer != 1 || bitrate_idx == 0 || bitrate_idx == 15
+      || rate_idx == 3)
+    {
+      return false;
+    }
+
+  mpeg1 = (version == 3);
+  kbps = mpeg1 ? mpeg1_kbps[bitrate_idx] : mpeg2_kbps[bitrate_idx];
+  /* MPEG 2 halves the MPEG 1 rates, MPEG 2.5 quarters them */
+  ap_frame->rate
+    = mpeg1_rates[rate_idx] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+  ap_frame->samples = mpeg1 ? 1152 : 576;
+  ap_frame->channels = ((ap_hdr[3] >> 6) == 3) ? 1 : 2;
+  ap_frame->len = (ap_frame->samples / 8) * kbps * 1000 / ap_frame->rate
+                  + ((ap_hdr[2] >> 1) & 0x01);
+  return true;
+}
+
+static bool
+grow (unsigned char ** app_buf, size_t * ap_cap, const size_t a_needed)
+{
+  size_t cap = *ap_cap ? *ap_cap : HLS_SEGMENT_INITIAL_CAPACITY;
+  unsigned char * p_buf = NULL;
+  if (a_needed <= *ap_cap)
+    {
+      return true;
+    }
+  while (cap < a_needed)
+    {
+      cap *= 2;
+    }
+  p_buf = tiz_mem_realloc (*app_buf, cap);
+  if (!p_buf)
+    {
+      return false;
+    }
+  *app_buf = p_buf;
+  *ap_cap = cap;
+  return true;
+}
+
+static void
+write_syncsafe (unsigned char * ap_dst, const OMX_U32 a_value)
+{
+  ap_dst[0] = (a_value >> 21) & 0x7F;
+  ap_dst[1] = (a_value >> 14) & 0x7F;
+  ap_dst[2] = (a_value >> 7) & 0x7F;
+  ap_dst[3] = a_value & 0x7F;
+}
+
+static void
+write_timestamp_tag (unsigned char * ap_dst, const OMX_U64 a_pts)
+{
+  unsigned char * p = ap_dst;
+  OMX_U64 pts = a_pts & 0x1FFFFFFFFULL; /* 33 bits, as in MPEG-2 PES */
+  int i = 0;
+
+  memcpy (p, "ID3\x04\x00\x00", 6);
+  write_syncsafe (p + 6, HLS_ID3_TAG_BYTES - 10);
+  p += 10;
+  memcpy (p, "PRIV", 4);
+  write_syncsafe (p + 4, HLS_ID3_PRIV_BYTES);
+  p[8] = p[9] = 0;
+  p += 10;
+  memcpy (p, HLS_PTS_OWNER, sizeof (HLS_PTS_OWNER));
+  p += sizeof (HLS_PTS_OWNER);
+  for (i = 7; i >= 0; --i)
+    {
+      *p++ = (pts >> (i * 8)) & 0xFF;
+    }
+}
+
+static void
+put_segment (tiz_hls_segment_t * ap_seg)
+{
+  assert (ap_seg);
+  assert (ap_seg->refs_ > 0);
+  if (--ap_seg->refs_ == 0)
+    {
+      tiz_mem_free (ap_seg->p_data_);
+      tiz_mem_free (ap_seg);
+    }
+}
+
+static OMX_ERRORTYPE
+open_segment (tiz_hls_t * ap_hls, const OMX_U32 a_rate)
+{
+  tiz_hls_segment_t * p_seg = NULL;
+  assert (ap_hls);
+  assert (!ap_hls->p_cur_);
+
+  p_seg = tiz_mem_calloc (1, sizeof (tiz_hls_segment_t));
+  if (!p_seg || !grow (&p_seg->p_data_, &p_seg->cap_, HLS_ID3_TAG_BYTES))
+    {
+      tiz_mem_free (p_seg);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_seg->seq_ = ap_hls->next_seq_++;
+  p_seg->rate_ = a_rate;
+  p_seg->discontinuity_ = ap_hls->pending_disc_;
+  p_seg->refs_ = 1;
+  write_timestamp_tag (p_seg->p_data_, ap_hls->pts_);
+  p_seg->len_ = HLS_ID3_TAG_BYTES;
+  ap_hls->pending_disc_ = false;
+  ap_hls->p_cur_ = p_seg;
+  return OMX_ErrorNone;
+}
+
+static void
+close_segment (tiz_hls_t * ap_hls)
+{
+  tiz_hls_segment_t * p_seg = NULL;
+  assert (ap_hls);
+
+  p_seg = ap_hls->p_cur_;
+  if (!p_seg)
+    {
+      return;
+    }
+
+  if (ap_hls->nsegs_ == ap_hls->window_ + HLS_SPARE_SEGMENTS)
+    {
+      if (ap_hls->pp_segs_[0]->discontinuity_)
+        {
+          ap_hls->disc_evicted_++;
+        }
+      put_segment (ap_hls->pp_segs_[0]);
+      memmove (ap_hls->pp_segs_, ap_hls->pp_segs_ + 1,
+               (ap_hls->nsegs_ - 1) * sizeof (tiz_hls_segment_t *));
+      ap_hls->nsegs_--;
+    }
+  ap_hls->pp_segs_[ap_hls->nsegs_++] = p_seg;
+  /* Timestamps count from the last rate change, so that they don't drift */
+  ap_hls->base_samples_ += p_seg->samples_;
+  ap_hls->pts_
+    = ap_hls->pts_base_ + ap_hls->base_samples_ * 90000 / p_seg->rate_;
+  ap_hls->p_cur_ = NULL;
+  ap_hls->dirty_ = true;
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "[%s] segment [%lu] : [%zu] bytes [%llu] samples",
+           ap_hls->p_name_, p_seg->seq_, p_seg->len_,
+           (unsigned long long) p_seg->samples_);
+}
+
+static OMX_ERRORTYPE
+add_frame (tiz_hls_t * ap_hls, const unsigned char * ap_frame,
+           const hls_frame_t * ap_info)
+{
+  tiz_hls_segment_t * p_seg = NULL;
+  assert (ap_hls);
+  assert (ap_frame);
+  assert (ap_info);
+
+  if (ap_hls->rate_
+      && (ap_info->rate != ap_hls->rate_
+          || ap_info->channels != ap_hls->channels_))
+    {
+      close_segment (ap_hls);
+      ap_hls->pending_disc_ = true;
+      if (ap_info->rate != ap_hls->rate_)
+        {
+          ap_hls->pts_base_ = ap_hls->pts_;
+          ap_hls->base_samples_ = 0;
+        }
+    }
+  ap_hls->rate_ = ap_info->rate;
+  ap_hls->channels_ = ap_info->channels;
+
+  if (!ap_hls->p_cur_)
+    {
+      tiz_check_omx (open_segment (ap_hls, ap_info->rate));
+    }
+
+  p_seg = ap_hls->p_cur_;
+  if (!grow (&p_seg->p_data_, &p_seg->cap_, p_seg->len_ + ap_info->len))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+  memcpy (p_seg->p_data_ + p_seg->len_, ap_frame, ap_info->len);
+  p_seg->len_ += ap_info->len;
+  p_seg->samples_ += ap_info->samples;
+
+  if (p_seg->samples_ * 1000 >= (OMX_U64) ap_hls->target_ms_ * p_seg->rate_)
+    {
+      close_segment (ap_hls);
+    }
+  return OMX_ErrorNone;
+}
+
+/* Consume the whole frames found in the input buffer. Until a frame has been
+ * accepted, or after garbage, a header only counts if another one follows the
+ * frame it describes. */
+static OMX_ERRORTYPE
+segment_input (tiz_hls_t * ap_hls)
+{
+  const unsigned char * p_in = NULL;
+  size_t pos = 0;
+  size_t avail = 0;
+  hls_frame_t frame;
+  hls_frame_t next;
+  assert (ap_hls);
+
+  p_in = ap_hls->p_in_;
+  avail = ap_hls->in_len_;
+  while (avail - pos >= HLS_MP3_HEADER_BYTES)
+    {
+      if (!parse_frame_header (p_in + pos, &frame))
+        {
+          ap_hls->synced_ = false;
+          pos++;
+          continue;
+        }
+      if (!ap_hls->synced_)
+        {
+          if (avail - pos < frame.len + HLS_MP3_HEADER_BYTES)
+            {
+              break;
+            }
+          if (!parse_frame_header (p_in + pos + frame.len, &next)
+              || next.rate != frame.rate)
+            {
+              pos++;
+              continue;
+            }
+        }
+      if (avail - pos < frame.len)
+        {
+          break;
+        }
+      tiz_check_omx (add_frame (ap_hls, p_in + pos, &frame));
+      ap_hls->synced_ = true;
+      pos += frame.len;
+    }
+
+  ap_hls->in_len_ = avail - pos;
+  memmove (ap_hls->p_in_, p_in + pos, ap_hls->in_len_);
+  return OMX_ErrorNone;
+}
+
+static OMX_U32
+rounded_seconds (const tiz_hls_segment_t * ap_seg)
+{
+  return (OMX_U32) ((ap_seg->samples_ * 2 + ap_seg->rate_)
+                    / (2 * (OMX_U64) ap_seg->rate_));
+}
+
+static char *
+make_playlist (const tiz_hls_t * ap_hls)
+{
+  const OMX_U32 listed = MIN (ap_hls->nsegs_, ap_hls->window_);
+  const OMX_U32 first = ap_hls->nsegs_ - listed;
+  const size_t cap = 256 + listed * (64 + strlen (ap_hls->p_name_));
+  OMX_U32 target_s = (ap_hls->target_ms_ + 999) / 1000;
+  OMX_U32 disc_seq = ap_hls->disc_evicted_;
+  /* With nothing published yet, the sequence starts at the segment to come */
+  OMX_U32 media_seq
+    = ap_hls->p_cur_ ? ap_hls->p_cur_->seq_ : ap_hls->next_seq_;
+  char * p_list = NULL;
+  size_t len = 0;
+  OMX_U32 i = 0;
+
+  for (i = 0; i < ap_hls->nsegs_; ++i)
+    {
+      if (i < first && ap_hls->pp_segs_[i]->discontinuity_)
+        {
+          disc_seq++;
+        }
+      if (i >= first)
+        {
+          target_s = MAX (target_s, rounded_seconds (ap_hls->pp_segs_[i]));
+        }
+    }
+  if (listed > 0)
+    {
+      media_seq = ap_hls->pp_segs_[first]->seq_;
+    }
+
+  p_list = tiz_mem_alloc (cap);
+  if (p_list)
+    {
+      len += snprintf (p_list + len, cap - len,
+                       "#EXTM3U\n"
+                       "#EXT-X-VERSION:3\n"
+                       "#EXT-X-TARGETDURATION:%lu\n"
+                       "#EXT-X-MEDIA-SEQUENCE:%lu\n"
+                       "#EXT-X-DISCONTINUITY-SEQUENCE:%lu\n",
+                       target_s, media_seq, disc_seq);
+      for (i = first; i < ap_hls->nsegs_; ++i)
+        {
+          const tiz_hls_segment_t * p_seg = ap_hls->pp_segs_[i];
+          len += snprintf (p_list + len, cap - len,
+                           "%s#EXTINF:%.3f,\n%s-%lu" HLS_SEGMENT_EXT "\n",
+                           p_seg->discontinuity_ ? "#EXT-X-DISCONTINUITY\n"
+                                                 : "",
+                           (double) p_seg->samples_ / p_seg->rate_,
+                           ap_hls->p_name_, p_seg->seq_);
+        }
+      assert (len < cap);
+    }
+  return p_list;
+}
+
+OMX_ERRORTYPE
+tiz_hls_init (tiz_hls_ptr_t * app_hls, const char * ap_name,
+              const OMX_U32 a_target_ms, const OMX_U32 a_window)
+{
+  tiz_hls_t * p_hls = NULL;
+
+  assert (app_hls);
+  assert (ap_name);
+
+  if (a_target_ms == 0 || a_window == 0)
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  p_hls = tiz_mem_calloc (1, sizeof (tiz_hls_t));
+  if (p_hls)
+    {
+      const size_t name_len = strlen (ap_name) + 1;
+      p_hls->p_name_ = tiz_mem_alloc (name_len);
+      if (p_hls->p_name_)
+        {
+          memcpy (p_hls->p_name_, ap_name, name_len);
+        }
+      p_hls->pp_segs_ = tiz_mem_calloc (a_window + HLS_SPARE_SEGMENTS,
+                                        sizeof (tiz_hls_segment_t *));
+      p_hls->target_ms_ = a_target_ms;
+      p_hls->window_ = a_window;
+      p_hls->dirty_ = true;
+      if (!p_hls->p_name_ || !p_hls->pp_segs_)
+        {
+          tiz_hls_destroy (p_hls);
+          p_hls = NULL;
+        }
+    }
+
+  *app_hls = p_hls;
+  return p_hls ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
+}
+
+void
+tiz_hls_destroy (tiz_hls_t * ap_hls)
+{
+  if (ap_hls)
+    {
+      OMX_U32 i = 0;
+      for (i = 0; i < ap_hls->nsegs_; ++i)
+        {
+          put_segment (ap_hls->pp_segs_[i]);
+        }
+      if (ap_hls->p_cur_)
+        {
+          put_segment (ap_hls->p_cur_);
+        }
+      tiz_mem_free (ap_hls->pp_segs_);
+      tiz_mem_free (ap_hls->p_in_);
+      tiz_mem_free (ap_hls->p_playlist_);
+      tiz_mem_free (ap_hls->p_name_);
+      tiz_mem_free (ap_hls);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_hls_write (tiz_hls_t * ap_hls, const void * ap_data, const size_t a_nbytes)
+{
+  assert (ap_hls);
+  assert (ap_data || a_nbytes == 0);
+
+  if (a_nbytes == 0)
+    {
+      return OMX_ErrorNone;
+    }
+  if (!grow (&ap_hls->p_in_, &ap_hls->in_cap_, ap_hls->in_len_ + a_nbytes))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+  memcpy (ap_hls->p_in_ + ap_hls->in_len_, ap_data, a_nbytes);
+  ap_hls->in_len_ += a_nbytes;
+  return segment_input (ap_hls);
+}
+
+OMX_ERRORTYPE
+tiz_hls_flush (tiz_hls_t * ap_hls)
+{
+  assert (ap_hls);
+  close_segment (ap_hls);
+  return OMX_ErrorNone;
+}
+
+const char *
+tiz_hls_playlist (tiz_hls_t * ap_hls)
+{
+  assert (ap_hls);
+  if (ap_hls->dirty_ || !ap_hls->p_playlist_)
+    {
+      char * p_list = make_playlist (ap_hls);
+      if (p_list)
+        {
+          tiz_mem_free (ap_hls->p_playlist_);
+          ap_hls->p_playlist_ = p_list;
+          ap_hls->dirty_ = false;
+        }
+    }
+  return ap_hls->p_playlist_;
+}
+
+OMX_U64
+tiz_hls_duration_ms (const tiz_hls_t * ap_hls)
+{
+  OMX_U64 ms = 0;
+  assert (ap_hls);
+  ms = ap_hls->pts_ / 90;
+  if (ap_hls->p_cur_)
+    {
+      ms += ap_hls->p_cur_->samples_ * 1000 / ap_hls->p_cur_->rate_;
+    }
+  return ms;
+}
+
+tiz_hls_segment_t *
+tiz_hls_get_segment (tiz_hls_t * ap_hls, const char * ap_uri)
+{
+  const char * p_leaf = NULL;
+  const size_t name_len = ap_hls ? strlen (ap_hls->p_name_) : 0;
+  char * p_end = NULL;
+  unsigned long seq = 0;
+  OMX_U32 i = 0;
+
+  assert (ap_hls);
+  assert (ap_uri);
+
+  p_leaf = strrchr (ap_uri, '/');
+  p_leaf = p_leaf ? p_leaf + 1 : ap_uri;
+  if (strncmp (p_leaf, ap_hls->p_name_, name_len) != 0
+      || p_leaf[name_len] != '-' || p_leaf[name_len + 1] < '0'
+      || p_leaf[name_len + 1] > '9')
+    {
+      return NULL;
+    }
+  seq = strtoul (p_leaf + name_len + 1, &p_end, 10);
+  if (strcmp (p_end, HLS_SEGMENT_EXT) != 0)
+    {
+      return NULL;
+    }
+
+  for (i = 0; i < ap_hls->nsegs_; ++i)
+    {
+      if (ap_hls->pp_segs_[i]->seq_ == seq)
+        {
+          ap_hls->pp_segs_[i]->refs_++;
+          return ap_hls->pp_segs_[i];
+        }
+    }
+  return NULL;
+}
+
+void
+tiz_hls_put_segment (tiz_hls_segment_t * ap_seg)
+{
+  if (ap_seg)
+    {
+      put_segment (ap_seg);
+    }
+}
+
+const void *
+tiz_hls_segment_data (const tiz_hls_segment_t * ap_seg)
+{
+  assert (ap_seg);
+  return ap_seg->p_data_;
+}
+
+size_t
+tiz_hls_segment_len (const tiz_hls_segment_t * ap_seg)
+{
+  assert (ap_seg);
+  return ap_seg->len_;
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizhls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - HLS segmenter
+ *
+ *
+ */
+
+#ifndef TIZHLS_H
+#define TIZHLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizhls HLS segmenter
+ *
+ * Cuts an MPEG audio Layer III elementary stream into a rolling window of
+ * in-memory segments and keeps an HTTP Live Streaming media playlist that
+ * lists them. Segments are packed audio: the MP3 frames of the segment,
+ * preceded by an ID3 tag that carries the segment's presentation timestamp.
+ *
+ * Segments are only cut at frame boundaries, at the first one past the
+ * target duration. A change of sample rate or channel count also closes the
+ * current segment and flags the next one as a discontinuity.
+ *
+ * The segmenter is not thread-safe; the owner serialises all calls.
+ *
+ * @ingroup libtizplatform
+ */
+
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * HLS segmenter opaque handle.
+ * @ingroup tizhls
+ */
+typedef struct tiz_hls tiz_hls_t;
+typedef /*@null@ */ tiz_hls_t * tiz_hls_ptr_t;
+
+/**
+ * Segment opaque handle.
+ * @ingroup tizhls
+ */
+typedef struct tiz_hls_segment tiz_hls_segment_t;
+typedef /*@null@ */ tiz_hls_segment_t * tiz_hls_segment_ptr_t;
+
+/**
+ * Create a segmenter.
+ *
+ * @ingroup tizhls
+ *
+ * @param app_hls A pointer to the new segmenter handle (output).
+ * @param ap_name The prefix of the segment names, '<name>-<sequence>.mp3'.
+ * @param a_target_ms The target duration of a segment, in milliseconds.
+ * @param a_window The number of segments listed in the playlist.
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter if the duration or
+ * the window are zero, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_hls_init (tiz_hls_ptr_t * app_hls, const char * ap_name,
+              const OMX_U32 a_target_ms, const OMX_U32 a_window);
+
+/**
+ * Destroy a segmenter. Segments still referenced by a caller stay valid until
+ * they are released.
+ *
+ * @ingroup tizhls
+ */
+void
+tiz_hls_destroy (tiz_hls_t * ap_hls);
+
+/**
+ * Feed stream data to the segmenter. The data may be split anywhere; bytes
+ * that don't belong to a Layer III frame are skipped.
+ *
+ * @ingroup tizhls
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_hls_write (tiz_hls_t * ap_hls, const void * ap_data,
+               const size_t a_nbytes);
+
+/**
+ * Close the segment in progress, if it holds any frames, and publish it.
+ *
+ * @ingroup tizhls
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_hls_flush (tiz_hls_t * ap_hls);
+
+/**
+ * @ingroup tizhls
+ * @return The current media playlist, valid until the next call on the
+ * segmenter, or NULL if it can't be allocated.
+ */
+const char *
+tiz_hls_playlist (tiz_hls_t * ap_hls);
+
+/**
+ * @ingroup tizhls
+ * @return The duration of the audio accepted so far, in milliseconds,
+ * including the segment in progress.
+ */
+OMX_U64
+tiz_hls_duration_ms (const tiz_hls_t * ap_hls);
+
+/**
+ * Look up a published segment by name and take a reference to it. Segments
+ * that have just left the playlist remain available for a little longer.
+ *
+ * @ingroup tizhls
+ *
+ * @param ap_hls The segmenter.
+ * @param ap_uri The segment name; anything up to the last '/' is ignored.
+ *
+ * @return The segment, or NULL if there is none by that name.
+ */
+tiz_hls_segment_t *
+tiz_hls_get_segment (tiz_hls_t * ap_hls, const char * ap_uri);
+
+/**
+ * Release a reference obtained with tiz_hls_get_segment.
+ *
+ * @ingroup tizhls
+ */
+void
+tiz_hls_put_segment (tiz_hls_segment_t * ap_seg);
+
+/**
+ * @ingroup tizhls
+ * @return The bytes of a segment.
+ */
+const void *
+tiz_hls_segment_data (const tiz_hls_segment_t * ap_seg);
+
+/**
+ * @ingroup tizhls
+ * @return The length of a segment, in bytes.
+ */
+size_t
+tiz_hls_segment_len (const tiz_hls_segment_t * ap_seg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZHLS_H */
@@ -659,6 +659,26 @@ static const tiz_idx_str_t tiz_idx_to_str_tbl[] = {
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioPlexSession"},
   {OMX_TizoniaIndexParamAudioPlexPlaylist,
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioPlexPlaylist"},
+  {OMX_TizoniaIndexParamAudioResampler,
+   (const OMX_STRING) "OMX_TizoniaIndexParamAudioResampler"},
+  {OMX_TizoniaIndexConfigAudioMixerRamp,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioMixerRamp"},
+  {OMX_TizoniaIndexConfigAudioMixerDuck,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioMixerDuck"},
+  {OMX_TizoniaIndexConfigAudioLoudness,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioLoudness"},
+  {OMX_TizoniaIndexParamAudioSampleFormat,
+   (const OMX_STRING) "OMX_TizoniaIndexParamAudioSampleFormat"},
+  {OMX_TizoniaIndexParamAudioMp3Encoder,
+   (const OMX_STRING) "OMX_TizoniaIndexParamAudioMp3Encoder"},
+  {OMX_TizoniaIndexConfigAudioRendererLatency,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioRendererLatency"},
+  {OMX_TizoniaIndexConfigAudioSourceBufferHealth,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigAudioSourceBufferHealth"},
+  {OMX_TizoniaIndexConfigIcecastMountStats,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigIcecastMountStats"},
+  {OMX_TizoniaIndexParamHttpSegmenter,
+   (const OMX_STRING) "OMX_TizoniaIndexParamHttpSegmenter"},
   {OMX_IndexKhronosExtensions, (const OMX_STRING) "OMX_IndexKhronosExtensions"},
   {OMX_IndexVendorStartUnused, (const OMX_STRING) "OMX_IndexVendorStartUnused"},
   {OMX_IndexMax, (const OMX_STRING) "OMX_IndexMax"}};
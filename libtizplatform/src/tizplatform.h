@@ -56,6 +56,9 @@
 #include "tizprintf.h"
 #include "tizshufflelst.h"
 #include "tizurltransfer.h"
+#include "tizshmring.h"
+#include "tizurlcache.h"
+#include "tizhls.h"
 
 /** @} */
 
@@ -0,0 +1,712 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared-memory ring buffer
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shmring"
+#endif
+
+#define SHMRING_MAGIC 0x54495a52 /* 'TIZR' */
+#define SHMRING_VERSION 2
+#define SHMRING_CACHELINE 64
+#define SHMRING_ALIGN 8
+/* How long to wait for the creator of a segment to initialise it */
+#define SHMRING_ATTACH_TIMEOUT_MS 1000
+/* The producer doesn't bother waking up for less room than this */
+#define SHMRING_MIN_CHUNK 512
+
+/* Records: an 8-byte header followed by the payload, padded to 8 bytes.
+   Since the capacity is a power of two and every record starts at a
+   multiple of 8, a record header never wraps around the end of the data
+   area; payloads may. */
+enum
+{
+  SHMRING_REC_DATA = 1,
+  SHMRING_REC_FORMAT,
+  SHMRING_REC_EOS
+};
+
+typedef struct shmring_rec shmring_rec_t;
+struct shmring_rec
+{
+  uint32_t type;
+  uint32_t len;
+};
+
+/* Segment layout. head and tail are free-running byte counters. Each end
+   only ever writes its own cache line. */
+typedef struct shmring_hdr shmring_hdr_t;
+struct shmring_hdr
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t users;
+  uint32_t opens; /* attachments since the segment was created */
+  /* Producer */
+  uint64_t head __attribute__ ((aligned (SHMRING_CACHELINE)));
+  uint32_t data_seq; /* futex word, bumped after each record */
+  uint32_t data_waiters;
+  /* Consumer */
+  uint64_t tail __attribute__ ((aligned (SHMRING_CACHELINE)));
+  uint32_t space_seq; /* futex word, bumped after records are consumed */
+  uint32_t space_waiters;
+} __attribute__ ((aligned (SHMRING_CACHELINE)));
+
+struct tiz_shmring
+{
+  shmring_hdr_t * p_hdr;
+  uint8_t * p_data;
+  size_t map_len;
+  uint32_t mask;
+  uint32_t rd_off; /* bytes of the current data record already consumed */
+  bool shared;     /* false for process-private rings */
+  char name[NAME_MAX];
+};
+
+typedef bool (*shmring_cond_f) (const tiz_shmring_t * ap_ring,
+                                const size_t a_arg);
+
+static inline uint32_t
+rec_size (const uint32_t a_len)
+{
+  return (uint32_t) sizeof (shmring_rec_t)
+         + ((a_len + SHMRING_ALIGN - 1) & ~(SHMRING_ALIGN - 1));
+}
+
+static inline size_t
+round_up_pow2 (size_t a_val)
+{
+  size_t pow2 = TIZ_SHMRING_MIN_CAPACITY;
+  while (pow2 < a_val && pow2 < ((size_t) 1 << 30))
+    {
+      pow2 <<= 1;
+    }
+  return pow2;
+}
+
+static inline long
+futex (uint32_t * ap_addr, const int a_op, const uint32_t a_val,
+       const struct timespec * ap_timeout)
+{
+  return syscall (SYS_futex, ap_addr, a_op, a_val, ap_timeout, NULL, 0);
+}
+
+static inline void
+notify (uint32_t * ap_seq, uint32_t * ap_waiters)
+{
+  (void) __atomic_add_fetch (ap_seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (ap_waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+      (void) futex (ap_seq, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+static inline int64_t
+now_ms (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Wait until a_pf_cond holds, sleeping on ap_seq. The other end bumps
+   ap_seq after changing the state a_pf_cond looks at, and only makes the
+   wake-up call when *ap_waiters is non-zero. Reading the sequence number
+   before testing the condition closes the window between the test and the
+   sleep: if the other end has moved on in-between, FUTEX_WAIT returns
+   straight away. */
+static bool
+wait_for (tiz_shmring_t * ap_ring, uint32_t * ap_seq, uint32_t * ap_waiters,
+          shmring_cond_f a_pf_cond, const size_t a_arg, const int a_timeout_ms)
+{
+  const int64_t deadline = a_timeout_ms > 0 ? now_ms () + a_timeout_ms : 0;
+
+  for (;;)
+    {
+      const uint32_t seq = __atomic_load_n (ap_seq, __ATOMIC_ACQUIRE);
+      struct timespec rel;
+      struct timespec * p_rel = NULL;
+
+      if (a_pf_cond (ap_ring, a_arg))
+        {
+          return true;
+        }
+      if (0 == a_timeout_ms)
+        {
+          return false;
+        }
+      if (a_timeout_ms > 0)
+        {
+          const int64_t remaining = deadline - now_ms ();
+          if (remaining <= 0)
+            {
+              return false;
+            }
+          rel.tv_sec = remaining / 1000;
+          rel.tv_nsec = (remaining % 1000) * 1000000;
+          p_rel = &rel;
+        }
+      (void) __atomic_add_fetch (ap_waiters, 1, __ATOMIC_SEQ_CST);
+      (void) futex (ap_seq, FUTEX_WAIT, seq, p_rel);
+      (void) __atomic_sub_fetch (ap_waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static inline size_t
+free_space (const tiz_shmring_t * ap_ring)
+{
+  const uint64_t head
+    = __atomic_load_n (&(ap_ring->p_hdr->head), __ATOMIC_RELAXED);
+  const uint64_t tail
+    = __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_ACQUIRE);
+  return ap_ring->p_hdr->capacity - (size_t) (head - tail);
+}
+
+static bool
+has_space (const tiz_shmring_t * ap_ring, const size_t a_nbytes)
+{
+  return free_space (ap_ring) >= a_nbytes;
+}
+
+static bool
+has_record (const tiz_shmring_t * ap_ring, const size_t TIZ_UNUSED (a_arg))
+{
+  return __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_RELAXED)
+         != __atomic_load_n (&(ap_ring->p_hdr->head), __ATOMIC_ACQUIRE);
+}
+
+static void
+copy_in (tiz_shmring_t * ap_ring, const uint64_t a_pos, const void * ap_src,
+         const size_t a_nbytes)
+{
+  const size_t off = (size_t) (a_pos & ap_ring->mask);
+  const size_t first = MIN (a_nbytes, ap_ring->p_hdr->capacity - off);
+  memcpy (ap_ring->p_data + off, ap_src, first);
+  memcpy (ap_ring->p_data, (const uint8_t *) ap_src + first, a_nbytes - first);
+}
+
+static void
+copy_out (const tiz_shmring_t * ap_ring, const uint64_t a_pos, void * ap_dst,
+          const size_t a_nbytes)
+{
+  const size_t off = (size_t) (a_pos & ap_ring->mask);
+  const size_t first = MIN (a_nbytes, ap_ring->p_hdr->capacity - off);
+  memcpy (ap_dst, ap_ring->p_data + off, first);
+  memcpy ((uint8_t *) ap_dst + first, ap_ring->p_data, a_nbytes - first);
+}
+
+/* The caller must have made sure there is room for the record */
+static void
+push_record (tiz_shmring_t * ap_ring, const uint32_t a_type,
+             const void * ap_payload, const uint32_t a_len)
+{
+  shmring_hdr_t * p_hdr = ap_ring->p_hdr;
+  const uint64_t head = __atomic_load_n (&(p_hdr->head), __ATOMIC_RELAXED);
+  shmring_rec_t rec;
+  rec.type = a_type;
+  rec.len = a_len;
+  copy_in (ap_ring, head, &rec, sizeof (rec));
+  if (a_len > 0)
+    {
+      copy_in (ap_ring, head + sizeof (rec), ap_payload, a_len);
+    }
+  __atomic_store_n (&(p_hdr->head), head + rec_size (a_len), __ATOMIC_RELEASE);
+  notify (&(p_hdr->data_seq), &(p_hdr->data_waiters));
+}
+
+static OMX_ERRORTYPE
+push_marker (tiz_shmring_t * ap_ring, const uint32_t a_type,
+             const void * ap_payload, const uint32_t a_len,
+             const int a_timeout_ms)
+{
+  assert (ap_ring);
+  if (!wait_for (ap_ring, &(ap_ring->p_hdr->space_seq),
+                 &(ap_ring->p_hdr->space_waiters), has_space,
+                 rec_size (a_len), a_timeout_ms))
+    {
+      return OMX_ErrorNotReady;
+    }
+  push_record (ap_ring, a_type, ap_payload, a_len);
+  return OMX_ErrorNone;
+}
+
+static inline shmring_rec_t
+peek_record (const tiz_shmring_t * ap_ring)
+{
+  shmring_rec_t rec;
+  copy_out (ap_ring,
+            __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_RELAXED),
+            &rec, sizeof (rec));
+  return rec;
+}
+
+static inline void
+drop_record (tiz_shmring_t * ap_ring, const shmring_rec_t * ap_rec)
+{
+  const uint64_t tail
+    = __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_RELAXED);
+  ap_ring->rd_off = 0;
+  __atomic_store_n (&(ap_ring->p_hdr->tail), tail + rec_size (ap_rec->len),
+                    __ATOMIC_RELEASE);
+}
+
+static bool
+wait_for_segment (const int a_fd, struct stat * ap_st)
+{
+  const int64_t deadline = now_ms () + SHMRING_ATTACH_TIMEOUT_MS;
+  /* The creator may not have sized the segment yet */
+  while (0 == fstat (a_fd, ap_st)
+         && ap_st->st_size <= (off_t) sizeof (shmring_hdr_t))
+    {
+      if (now_ms () > deadline)
+        {
+          return false;
+        }
+      (void) usleep (1000);
+    }
+  return ap_st->st_size > (off_t) sizeof (shmring_hdr_t);
+}
+
+static bool
+wait_for_magic (const shmring_hdr_t * ap_hdr)
+{
+  const int64_t deadline = now_ms () + SHMRING_ATTACH_TIMEOUT_MS;
+  while (SHMRING_MAGIC != __atomic_load_n (&(ap_hdr->magic), __ATOMIC_ACQUIRE))
+    {
+      if (now_ms () > deadline)
+        {
+          return false;
+        }
+      (void) usleep (1000);
+    }
+  return true;
+}
+
+static void
+init_segment (tiz_shmring_t * ap_ring, void * ap_addr, const size_t a_capacity)
+{
+  ap_ring->p_hdr = ap_addr;
+  ap_ring->p_data = (uint8_t *) (ap_ring->p_hdr + 1);
+  /* The mapping is zero-filled. The magic number is published last */
+  ap_ring->p_hdr->version = SHMRING_VERSION;
+  ap_ring->p_hdr->capacity = (uint32_t) a_capacity;
+  __atomic_store_n (&(ap_ring->p_hdr->magic), SHMRING_MAGIC, __ATOMIC_RELEASE);
+}
+
+static OMX_ERRORTYPE
+map_private (tiz_shmring_t * ap_ring, const size_t a_capacity)
+{
+  void * p_addr = MAP_FAILED;
+
+  ap_ring->map_len = sizeof (shmring_hdr_t) + a_capacity;
+  p_addr = mmap (NULL, ap_ring->map_len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == p_addr)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : mmap failed (%s)", ap_ring->name,
+               strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  init_segment (ap_ring, p_addr, a_capacity);
+  ap_ring->mask = ap_ring->p_hdr->capacity - 1;
+  ap_ring->p_hdr->users = 1;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+map_segment (tiz_shmring_t * ap_ring, const size_t a_capacity)
+{
+  bool creator = true;
+  struct stat st;
+  void * p_addr = MAP_FAILED;
+  int fd = shm_open (ap_ring->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+  if (fd >= 0)
+    {
+      ap_ring->map_len = sizeof (shmring_hdr_t) + a_capacity;
+      if (0 != ftruncate (fd, (off_t) ap_ring->map_len))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : ftruncate failed (%s)",
+                   ap_ring->name, strerror (errno));
+          (void) close (fd);
+          (void) shm_unlink (ap_ring->name);
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+  else if (EEXIST == errno
+           && (fd = shm_open (ap_ring->name, O_RDWR, 0)) >= 0)
+    {
+      creator = false;
+      if (!wait_for_segment (fd, &st))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : segment not initialised",
+                   ap_ring->name);
+          (void) close (fd);
+          return OMX_ErrorBadParameter;
+        }
+      ap_ring->map_len = (size_t) st.st_size;
+    }
+  else
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : shm_open failed (%s)",
+               ap_ring->name, strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_addr = mmap (NULL, ap_ring->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 fd, 0);
+  (void) close (fd);
+
+  if (MAP_FAILED == p_addr)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : mmap failed (%s)", ap_ring->name,
+               strerror (errno));
+      if (creator)
+        {
+          (void) shm_unlink (ap_ring->name);
+        }
+      return OMX_ErrorInsufficientResources;
+    }
+
+  ap_ring->p_hdr = p_addr;
+  ap_ring->p_data = (uint8_t *) (ap_ring->p_hdr + 1);
+
+  if (creator)
+    {
+      /* ftruncate has zero-filled the segment */
+      init_segment (ap_ring, p_addr, a_capacity);
+    }
+  else if (!wait_for_magic (ap_ring->p_hdr)
+           || SHMRING_VERSION != ap_ring->p_hdr->version
+           || ap_ring->map_len
+                != sizeof (shmring_hdr_t) + ap_ring->p_hdr->capacity
+           || 0 != (ap_ring->p_hdr->capacity & (ap_ring->p_hdr->capacity - 1)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : not a compatible ring",
+               ap_ring->name);
+      (void) munmap (p_addr, ap_ring->map_len);
+      ap_ring->p_hdr = NULL;
+      return OMX_ErrorBadParameter;
+    }
+
+  ap_ring->mask = ap_ring->p_hdr->capacity - 1;
+  (void) __atomic_add_fetch (&(ap_ring->p_hdr->opens), 1, __ATOMIC_ACQ_REL);
+  (void) __atomic_add_fetch (&(ap_ring->p_hdr->users), 1, __ATOMIC_ACQ_REL);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_open (tiz_shmring_ptr_t * app_ring, const char * ap_name,
+                  const size_t a_capacity)
+{
+  tiz_shmring_t * p_ring = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t capacity = 0;
+
+  assert (app_ring);
+
+  if (ap_name
+      && ('\0' == ap_name[0] || strchr (ap_name, '/')
+          || strlen (TIZ_SHMRING_PREFIX) + strlen (ap_name) >= NAME_MAX))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  if (!(p_ring = tiz_mem_calloc (1, sizeof (tiz_shmring_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  capacity = round_up_pow2 (MAX (a_capacity, TIZ_SHMRING_MIN_CAPACITY));
+  p_ring->shared = (NULL != ap_name);
+  snprintf (p_ring->name, sizeof (p_ring->name), "%s%s", TIZ_SHMRING_PREFIX,
+            ap_name ? ap_name : "(private)");
+
+  if (OMX_ErrorNone
+      != (rc = (p_ring->shared ? map_segment (p_ring, capacity)
+                               : map_private (p_ring, capacity))))
+    {
+      tiz_mem_free (p_ring);
+      p_ring = NULL;
+    }
+  else
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] : attached (capacity %u)",
+               p_ring->name, p_ring->p_hdr->capacity);
+    }
+
+  *app_ring = p_ring;
+  return rc;
+}
+
+void
+tiz_shmring_close (tiz_shmring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      shmring_hdr_t * p_hdr = ap_ring->p_hdr;
+      assert (p_hdr);
+      /* Let anyone blocked on the other end re-check its condition */
+      (void) __atomic_add_fetch (&(p_hdr->data_seq), 1, __ATOMIC_SEQ_CST);
+      (void) futex (&(p_hdr->data_seq), FUTEX_WAKE, INT_MAX, NULL);
+      (void) __atomic_add_fetch (&(p_hdr->space_seq), 1, __ATOMIC_SEQ_CST);
+      (void) futex (&(p_hdr->space_seq), FUTEX_WAKE, INT_MAX, NULL);
+      /* A producer that is done before the consumer has attached must not
+         take the segment, and the data in it, away; the segment goes once
+         both ends have been and gone */
+      if (0 == __atomic_sub_fetch (&(p_hdr->users), 1, __ATOMIC_ACQ_REL)
+          && ap_ring->shared
+          && __atomic_load_n (&(p_hdr->opens), __ATOMIC_ACQUIRE) >= 2)
+        {
+          (void) shm_unlink (ap_ring->name);
+        }
+      (void) munmap (p_hdr, ap_ring->map_len);
+      tiz_mem_free (ap_ring);
+    }
+}
+
+size_t
+tiz_shmring_capacity (const tiz_shmring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->p_hdr->capacity;
+}
+
+size_t
+tiz_shmring_used (const tiz_shmring_t * ap_ring)
+{
+  uint64_t tail = 0;
+  assert (ap_ring);
+  /* tail first: head can only have moved further by the time it is read */
+  tail = __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_ACQUIRE);
+  return (size_t) (__atomic_load_n (&(ap_ring->p_hdr->head), __ATOMIC_ACQUIRE)
+                   - tail);
+}
+
+size_t
+tiz_shmring_writable (const tiz_shmring_t * ap_ring)
+{
+  size_t room = 0;
+  size_t nrecs = 0;
+  assert (ap_ring);
+  room = free_space (ap_ring);
+  /* tiz_shmring_write splits the data into records of at most a quarter of
+     the capacity; each one costs a header plus up to 7 bytes of padding */
+  nrecs = room / (ap_ring->p_hdr->capacity / 4) + 1;
+  return room > nrecs * (sizeof (shmring_rec_t) + SHMRING_ALIGN)
+           ? room - nrecs * (sizeof (shmring_rec_t) + SHMRING_ALIGN)
+           : 0;
+}
+
+size_t
+tiz_shmring_write (tiz_shmring_t * ap_ring, const void * ap_data,
+                   const size_t a_nbytes, const int a_timeout_ms)
+{
+  shmring_hdr_t * p_hdr = NULL;
+  const uint8_t * p_src = ap_data;
+  size_t written = 0;
+  size_t max_chunk = 0;
+
+  assert (ap_ring);
+  assert (ap_data || 0 == a_nbytes);
+
+  p_hdr = ap_ring->p_hdr;
+  /* Keep records well below the capacity, so that the consumer can free
+     up space while the producer fills the rest */
+  max_chunk = p_hdr->capacity / 4;
+
+  while (written < a_nbytes)
+    {
+      const size_t want = MIN (a_nbytes - written, max_chunk);
+      size_t room = 0;
+      size_t chunk = 0;
+      if (!wait_for (ap_ring, &(p_hdr->space_seq), &(p_hdr->space_waiters),
+                     has_space, rec_size (MIN (want, SHMRING_MIN_CHUNK)),
+                     a_timeout_ms))
+        {
+          break;
+        }
+      room = (free_space (ap_ring) - sizeof (shmring_rec_t))
+             & ~((size_t) SHMRING_ALIGN - 1);
+      chunk = MIN (want, room);
+      push_record (ap_ring, SHMRING_REC_DATA, p_src + written,
+                   (uint32_t) chunk);
+      written += chunk;
+    }
+
+  return written;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_write_format (tiz_shmring_t * ap_ring,
+                          const tiz_shmring_format_t * ap_format,
+                          const int a_timeout_ms)
+{
+  assert (ap_format);
+  return push_marker (ap_ring, SHMRING_REC_FORMAT, ap_format,
+                      sizeof (tiz_shmring_format_t), a_timeout_ms);
+}
+
+OMX_ERRORTYPE
+tiz_shmring_write_eos (tiz_shmring_t * ap_ring, const int a_timeout_ms)
+{
+  return push_marker (ap_ring, SHMRING_REC_EOS, NULL, 0, a_timeout_ms);
+}
+
+tiz_shmring_event_t
+tiz_shmring_next (tiz_shmring_t * ap_ring, const int a_timeout_ms)
+{
+  assert (ap_ring);
+
+  if (wait_for (ap_ring, &(ap_ring->p_hdr->data_seq),
+                &(ap_ring->p_hdr->data_waiters), has_record, 0, a_timeout_ms))
+    {
+      const shmring_rec_t rec = peek_record (ap_ring);
+      switch (rec.type)
+        {
+          case SHMRING_REC_DATA:
+            return ETIZShmRingEventData;
+          case SHMRING_REC_FORMAT:
+            return ETIZShmRingEventFormat;
+          case SHMRING_REC_EOS:
+            return ETIZShmRingEventEos;
+          default:
+            assert (0);
+            break;
+        };
+    }
+  return ETIZShmRingEventNone;
+}
+
+size_t
+tiz_shmring_read (tiz_shmring_t * ap_ring, void * ap_data,
+                  const size_t a_nbytes)
+{
+  uint8_t * p_dst = ap_data;
+  size_t nread = 0;
+  bool consumed = false;
+
+  assert (ap_ring);
+  assert (ap_data || 0 == a_nbytes);
+
+  while (nread < a_nbytes && has_record (ap_ring, 0))
+    {
+      const shmring_rec_t rec = peek_record (ap_ring);
+      const uint64_t tail
+        = __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_RELAXED);
+      size_t chunk = 0;
+
+      if (SHMRING_REC_DATA != rec.type)
+        {
+          break;
+        }
+
+      chunk = MIN (rec.len - ap_ring->rd_off, a_nbytes - nread);
+      copy_out (ap_ring, tail + sizeof (shmring_rec_t) + ap_ring->rd_off,
+                p_dst + nread, chunk);
+      nread += chunk;
+      ap_ring->rd_off += (uint32_t) chunk;
+
+      if (ap_ring->rd_off == rec.len)
+        {
+          drop_record (ap_ring, &rec);
+          consumed = true;
+        }
+    }
+
+  /* One wake-up call for all the records consumed */
+  if (consumed)
+    {
+      notify (&(ap_ring->p_hdr->space_seq), &(ap_ring->p_hdr->space_waiters));
+    }
+
+  return nread;
+}
+
+static OMX_ERRORTYPE
+pop_marker (tiz_shmring_t * ap_ring, const uint32_t a_type, void * ap_payload,
+            const size_t a_len)
+{
+  shmring_rec_t rec;
+
+  assert (ap_ring);
+
+  if (!has_record (ap_ring, 0) || a_type != (rec = peek_record (ap_ring)).type)
+    {
+      return OMX_ErrorIncorrectStateOperation;
+    }
+
+  if (ap_payload)
+    {
+      memset (ap_payload, 0, a_len);
+      copy_out (ap_ring,
+                __atomic_load_n (&(ap_ring->p_hdr->tail), __ATOMIC_RELAXED)
+                  + sizeof (shmring_rec_t),
+                ap_payload, MIN (a_len, rec.len));
+    }
+  drop_record (ap_ring, &rec);
+  notify (&(ap_ring->p_hdr->space_seq), &(ap_ring->p_hdr->space_waiters));
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_read_format (tiz_shmring_t * ap_ring,
+                         tiz_shmring_format_t * ap_format)
+{
+  assert (ap_format);
+  return pop_marker (ap_ring, SHMRING_REC_FORMAT, ap_format,
+                     sizeof (tiz_shmring_format_t));
+}
+
+OMX_ERRORTYPE
+tiz_shmring_read_eos (tiz_shmring_t * ap_ring)
+{
+  return pop_marker (ap_ring, SHMRING_REC_EOS, NULL, 0);
+}
@@ -0,0 +1,247 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared-memory ring buffer
+ *
+ *
+ */
+
+#ifndef TIZSHMRING_H
+#define TIZSHMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizshmring Shared-memory ring buffer
+ *
+ * A single-producer, single-consumer ring buffer that lives in a POSIX
+ * shared memory segment, so that the two ends can be in the same process or
+ * in different ones. The ring carries a byte stream interleaved with format
+ * and end-of-stream markers, in the order in which they were written.
+ *
+ * Neither end takes a lock: the producer only advances the write position
+ * and the consumer only advances the read position. A side that has to wait
+ * (for data, or for space when the ring is full) sleeps on a futex, and is
+ * only woken up by the other side when it has announced that it is waiting.
+ * A full ring therefore throttles the producer.
+ *
+ * A ring can also be private to the process that opens it, in which case it
+ * is just a lock-free queue between two of its threads.
+ *
+ * This is the transport used by the 'inproc' reader and writer components.
+ *
+ * @ingroup libtizplatform
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/** Segments are named TIZ_SHMRING_PREFIX<name> */
+#define TIZ_SHMRING_PREFIX "/tizonia-ring."
+#define TIZ_SHMRING_MIN_CAPACITY 4096
+#define TIZ_SHMRING_DEFAULT_CAPACITY (1024 * 1024)
+
+/**
+ * Shared-memory ring opaque handle.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shmring tiz_shmring_t;
+typedef /*@null@ */ tiz_shmring_t * tiz_shmring_ptr_t;
+
+/**
+ * What comes next in the ring.
+ * @ingroup tizshmring
+ */
+typedef enum tiz_shmring_event {
+  ETIZShmRingEventNone = 0, /**< Nothing (yet) */
+  ETIZShmRingEventData,     /**< Data, see tiz_shmring_read */
+  ETIZShmRingEventFormat,   /**< Format change, see tiz_shmring_read_format */
+  ETIZShmRingEventEos,      /**< End of stream, see tiz_shmring_read_eos */
+  ETIZShmRingEventMax
+} tiz_shmring_event_t;
+
+/**
+ * Description of the data that follows a format marker. Unknown values are
+ * left as zero.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shmring_format tiz_shmring_format_t;
+struct tiz_shmring_format
+{
+  uint32_t domain;          /**< OMX_PORTDOMAINTYPE */
+  uint32_t encoding;        /**< e.g. OMX_AUDIO_CODINGTYPE */
+  uint32_t sample_rate;     /**< PCM only */
+  uint32_t channels;        /**< PCM only */
+  uint32_t bits_per_sample; /**< PCM only */
+  uint32_t big_endian;      /**< PCM only */
+};
+
+/**
+ * Attach to the ring named ap_name, creating it if it does not exist yet.
+ * Either end may be the first one to call this function.
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param ap_name The ring's name (without TIZ_SHMRING_PREFIX), or NULL to
+ * create a process-private ring, whose two ends share the same handle.
+ * @param a_capacity The size of the data area, used only when the ring is
+ * created. It is rounded up to a power of two, and at least
+ * TIZ_SHMRING_MIN_CAPACITY.
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter if the name is not
+ * valid or an incompatible segment exists under that name,
+ * OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_shmring_open (tiz_shmring_ptr_t * app_ring, const char * ap_name,
+                  const size_t a_capacity);
+
+/**
+ * Detach from the ring. Waiters on the other end are woken up. The segment
+ * is removed when the last end detaches, but only once both ends have
+ * attached: a producer may write the whole stream and close the ring before
+ * the consumer opens it, and the data stays there until it is read. A
+ * segment that never sees its second end is left behind, and is picked up
+ * by the next tiz_shmring_open with the same name.
+ *
+ * @ingroup tizshmring
+ */
+void
+tiz_shmring_close (tiz_shmring_t * ap_ring);
+
+/**
+ * @ingroup tizshmring
+ * @return The size of the ring's data area.
+ */
+size_t
+tiz_shmring_capacity (const tiz_shmring_t * ap_ring);
+
+/**
+ * @ingroup tizshmring
+ * @return The number of bytes in use, record headers included. Either end may
+ * call this, but the value may be stale by the time it is used.
+ */
+size_t
+tiz_shmring_used (const tiz_shmring_t * ap_ring);
+
+/* Producer API */
+
+/**
+ * @ingroup tizshmring
+ * @return The number of data bytes that the next call to tiz_shmring_write
+ * is guaranteed to accept without waiting.
+ */
+size_t
+tiz_shmring_writable (const tiz_shmring_t * ap_ring);
+
+/**
+ * Copy data into the ring. When the ring is full, wait for the consumer to
+ * make room for up to a_timeout_ms milliseconds (-1 waits forever, 0 does
+ * not wait).
+ *
+ * @ingroup tizshmring
+ * @return The number of bytes written. This is less than a_nbytes if the
+ * timeout expired.
+ */
+size_t
+tiz_shmring_write (tiz_shmring_t * ap_ring, const void * ap_data,
+                   const size_t a_nbytes, const int a_timeout_ms);
+
+/**
+ * Announce the format of the data that follows.
+ *
+ * @ingroup tizshmring
+ * @return OMX_ErrorNone on success, OMX_ErrorNotReady if the timeout expired
+ * before there was room in the ring.
+ */
+OMX_ERRORTYPE
+tiz_shmring_write_format (tiz_shmring_t * ap_ring,
+                          const tiz_shmring_format_t * ap_format,
+                          const int a_timeout_ms);
+
+/**
+ * Mark the end of the stream.
+ *
+ * @ingroup tizshmring
+ * @return OMX_ErrorNone on success, OMX_ErrorNotReady if the timeout expired
+ * before there was room in the ring.
+ */
+OMX_ERRORTYPE
+tiz_shmring_write_eos (tiz_shmring_t * ap_ring, const int a_timeout_ms);
+
+/* Consumer API */
+
+/**
+ * Find out what comes next in the ring, waiting for up to a_timeout_ms
+ * milliseconds (-1 waits forever, 0 does not wait) if the ring is empty.
+ *
+ * @ingroup tizshmring
+ * @return The type of the next item, or ETIZShmRingEventNone if the timeout
+ * expired.
+ */
+tiz_shmring_event_t
+tiz_shmring_next (tiz_shmring_t * ap_ring, const int a_timeout_ms);
+
+/**
+ * Copy data out of the ring, without waiting. Reading stops at the first
+ * format or end-of-stream marker.
+ *
+ * @ingroup tizshmring
+ * @return The number of bytes read.
+ */
+size_t
+tiz_shmring_read (tiz_shmring_t * ap_ring, void * ap_data,
+                  const size_t a_nbytes);
+
+/**
+ * Consume a format marker. tiz_shmring_next must have returned
+ * ETIZShmRingEventFormat.
+ *
+ * @ingroup tizshmring
+ * @return OMX_ErrorNone on success, OMX_ErrorIncorrectStateOperation if the
+ * next item is not a format marker.
+ */
+OMX_ERRORTYPE
+tiz_shmring_read_format (tiz_shmring_t * ap_ring,
+                         tiz_shmring_format_t * ap_format);
+
+/**
+ * Consume an end-of-stream marker. tiz_shmring_next must have returned
+ * ETIZShmRingEventEos.
+ *
+ * @ingroup tizshmring
+ * @return OMX_ErrorNone on success, OMX_ErrorIncorrectStateOperation if the
+ * next item is not an end-of-stream marker.
+ */
+OMX_ERRORTYPE
+tiz_shmring_read_eos (tiz_shmring_t * ap_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHMRING_H */
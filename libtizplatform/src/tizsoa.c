@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -45,6 +46,18 @@
 #define SOA_SLICE_ALIGN 8
 #define SOA_CHUNK_SZ 4096
 
+/* The slice's size field also carries the id of the thread cache that
+   handed out the slice (zero when no thread cache was involved). This is
+   only used to account for cross-thread frees */
+#define SOA_SLICE_SIZE_MASK 0xFFFF
+#define SOA_SLICE_OWNER_SHIFT 16
+#define SOA_MAX_TCACHE_ID 0xFFFF
+
+/* Number of free slices per size class that each thread may keep, and the
+   number of slices moved in each refill/flush of a thread's magazine */
+#define SOA_MAGAZINE_SZ 32
+#define SOA_MAGAZINE_BATCH (SOA_MAGAZINE_SZ / 2)
+
 static const int32_t chunk_class_tbl[] = {
   0, 0, 0, 0, 0,                                 /* 32 bytes */
   1, 1, 1, 1,                                    /* 64 bytes */
@@ -87,6 +100,39 @@ get_slice_ptr (void * p_usr)
   return ((slice_t *) ((uint8_t *) p_usr - SLICE_PREAMBLE_SZ));
 }
 
+static inline size_t
+get_slice_size (const slice_t * p_slice)
+{
+  return (p_slice->size & SOA_SLICE_SIZE_MASK);
+}
+
+static inline size_t
+get_slice_owner (const slice_t * p_slice)
+{
+  return (p_slice->size >> SOA_SLICE_OWNER_SHIFT);
+}
+
+typedef struct tcache_stats tcache_stats_t;
+struct tcache_stats
+{
+  int32_t objects;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t flushes;
+  uint64_t xfrees;
+};
+
+typedef struct tcache tcache_t;
+struct tcache
+{
+  tcache_t * p_next;
+  tiz_soa_t * p_soa;
+  size_t id;
+  slice_t * p_mag[TIZ_SOA_NUM_CHUNK_CLASSES][SOA_MAGAZINE_SZ];
+  int32_t n_mag[TIZ_SOA_NUM_CHUNK_CLASSES];
+  tcache_stats_t stats;
+};
+
 struct tiz_soa
 {
   slice_t * p_slice_store[TIZ_SOA_NUM_CHUNK_CLASSES];
@@ -94,6 +140,14 @@ struct tiz_soa
   chunk_t * p_chunk_lst;
   int32_t n_chunks;
   int32_t n_allocated_objects;
+  /* The following are only used by thread-safe allocators */
+  OMX_BOOL mt;
+  OMX_BOOL tls;
+  pthread_key_t key;
+  tiz_mutex_t mutex;
+  tcache_t * p_tcache_lst;
+  size_t last_tcache_id;
+  tcache_stats_t retired;
 };
 
 /*@null@*/ static slice_t *
@@ -142,6 +196,241 @@ alloc_chunk (tiz_soa_t * p_soa, int32_t chunk_class)
   return p_slice;
 }
 
+/*@null@*/ static slice_t *
+store_get (tiz_soa_t * p_soa, int32_t chunk_class)
+{
+  slice_t * p_slice = NULL;
+
+  assert (p_soa != NULL);
+
+  p_slice = p_soa->p_slice_store[chunk_class];
+
+  if (NULL == p_slice)
+    {
+      p_slice = alloc_chunk (p_soa, chunk_class);
+    }
+  else
+    {
+      p_soa->p_slice_store[chunk_class] = p_slice->p_next_free;
+    }
+
+  if (p_slice)
+    {
+      p_slice->p_chunk->n_allocated_slices += 1;
+    }
+
+  return p_slice;
+}
+
+static void
+store_put (tiz_soa_t * p_soa, slice_t * p_slice, int32_t chunk_class)
+{
+  assert (p_soa != NULL);
+  assert (p_slice != NULL);
+  assert (p_slice->p_chunk != NULL);
+
+  p_slice->p_chunk->n_allocated_slices -= 1;
+  p_slice->p_next_free = p_soa->p_slice_store[chunk_class];
+  p_soa->p_slice_store[chunk_class] = p_slice;
+}
+
+static void
+tcache_refill (tcache_t * p_tc, int32_t chunk_class)
+{
+  tiz_soa_t * p_soa = NULL;
+  slice_t * p_slice = NULL;
+
+  assert (p_tc != NULL);
+  p_soa = p_tc->p_soa;
+  assert (p_soa != NULL);
+
+  (void) tiz_mutex_lock (&(p_soa->mutex));
+  while (p_tc->n_mag[chunk_class] < SOA_MAGAZINE_BATCH
+         && (p_slice = store_get (p_soa, chunk_class)))
+    {
+      p_tc->p_mag[chunk_class][p_tc->n_mag[chunk_class]++] = p_slice;
+    }
+  (void) tiz_mutex_unlock (&(p_soa->mutex));
+}
+
+/* NOTE: The caller must hold the allocator's mutex */
+static void
+tcache_flush_locked (tcache_t * p_tc, int32_t chunk_class,
+                     int32_t a_num_slices)
+{
+  assert (p_tc != NULL);
+  assert (a_num_slices <= p_tc->n_mag[chunk_class]);
+
+  while (a_num_slices-- > 0)
+    {
+      store_put (p_tc->p_soa,
+                 p_tc->p_mag[chunk_class][--p_tc->n_mag[chunk_class]],
+                 chunk_class);
+    }
+  p_tc->stats.flushes += 1;
+}
+
+static void
+tcache_retire_locked (tcache_t * p_tc)
+{
+  tiz_soa_t * p_soa = NULL;
+  tcache_t ** pp_tc = NULL;
+
+  assert (p_tc != NULL);
+  p_soa = p_tc->p_soa;
+  assert (p_soa != NULL);
+
+  for (pp_tc = &(p_soa->p_tcache_lst); *pp_tc != NULL;
+       pp_tc = &((*pp_tc)->p_next))
+    {
+      if (*pp_tc == p_tc)
+        {
+          *pp_tc = p_tc->p_next;
+          break;
+        }
+    }
+
+  p_soa->retired.objects += p_tc->stats.objects;
+  p_soa->retired.hits += p_tc->stats.hits;
+  p_soa->retired.misses += p_tc->stats.misses;
+  p_soa->retired.flushes += p_tc->stats.flushes;
+  p_soa->retired.xfrees += p_tc->stats.xfrees;
+}
+
+/* Thread-specific data destructor; returns the exiting thread's slices to
+   the shared store */
+static void
+tcache_destroy (void * ap_tc)
+{
+  tcache_t * p_tc = ap_tc;
+  if (p_tc)
+    {
+      tiz_soa_t * p_soa = p_tc->p_soa;
+      int32_t i = 0;
+      assert (p_soa != NULL);
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      for (i = 0; i < TIZ_SOA_NUM_CHUNK_CLASSES; ++i)
+        {
+          if (p_tc->n_mag[i] > 0)
+            {
+              tcache_flush_locked (p_tc, i, p_tc->n_mag[i]);
+            }
+        }
+      tcache_retire_locked (p_tc);
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+      tiz_mem_free (p_tc);
+    }
+}
+
+/*@null@*/ static tcache_t *
+get_tcache (tiz_soa_t * p_soa)
+{
+  tcache_t * p_tc = NULL;
+
+  assert (p_soa != NULL);
+
+  if (!p_soa->tls)
+    {
+      return NULL;
+    }
+
+  if (NULL == (p_tc = pthread_getspecific (p_soa->key)))
+    {
+      if ((p_tc = tiz_mem_calloc (1, sizeof (tcache_t))))
+        {
+          p_tc->p_soa = p_soa;
+          (void) tiz_mutex_lock (&(p_soa->mutex));
+          p_soa->last_tcache_id
+            = (p_soa->last_tcache_id % SOA_MAX_TCACHE_ID) + 1;
+          p_tc->id = p_soa->last_tcache_id;
+          p_tc->p_next = p_soa->p_tcache_lst;
+          p_soa->p_tcache_lst = p_tc;
+          (void) tiz_mutex_unlock (&(p_soa->mutex));
+
+          if (0 != pthread_setspecific (p_soa->key, p_tc))
+            {
+              (void) tiz_mutex_lock (&(p_soa->mutex));
+              tcache_retire_locked (p_tc);
+              (void) tiz_mutex_unlock (&(p_soa->mutex));
+              tiz_mem_free (p_tc);
+              p_tc = NULL;
+            }
+        }
+    }
+
+  return p_tc;
+}
+
+/*@null@*/ static slice_t *
+mt_get_slice (tiz_soa_t * p_soa, int32_t chunk_class, size_t * ap_owner)
+{
+  slice_t * p_slice = NULL;
+  tcache_t * p_tc = get_tcache (p_soa);
+
+  assert (ap_owner != NULL);
+
+  if (p_tc)
+    {
+      if (p_tc->n_mag[chunk_class] > 0)
+        {
+          p_tc->stats.hits += 1;
+        }
+      else
+        {
+          p_tc->stats.misses += 1;
+          tcache_refill (p_tc, chunk_class);
+        }
+
+      if (p_tc->n_mag[chunk_class] > 0)
+        {
+          p_slice = p_tc->p_mag[chunk_class][--p_tc->n_mag[chunk_class]];
+          p_tc->stats.objects += 1;
+          *ap_owner = p_tc->id;
+        }
+    }
+  else
+    {
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      if ((p_slice = store_get (p_soa, chunk_class)))
+        {
+          p_soa->n_allocated_objects += 1;
+        }
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+
+  return p_slice;
+}
+
+static void
+mt_put_slice (tiz_soa_t * p_soa, slice_t * p_slice, int32_t chunk_class)
+{
+  tcache_t * p_tc = get_tcache (p_soa);
+
+  if (p_tc)
+    {
+      if (get_slice_owner (p_slice) != p_tc->id)
+        {
+          p_tc->stats.xfrees += 1;
+        }
+      p_tc->stats.objects -= 1;
+
+      if (SOA_MAGAZINE_SZ == p_tc->n_mag[chunk_class])
+        {
+          (void) tiz_mutex_lock (&(p_soa->mutex));
+          tcache_flush_locked (p_tc, chunk_class, SOA_MAGAZINE_BATCH);
+          (void) tiz_mutex_unlock (&(p_soa->mutex));
+        }
+      p_tc->p_mag[chunk_class][p_tc->n_mag[chunk_class]++] = p_slice;
+    }
+  else
+    {
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      store_put (p_soa, p_slice, chunk_class);
+      p_soa->n_allocated_objects -= 1;
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+}
+
 OMX_ERRORTYPE
 tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa)
 {
@@ -160,15 +449,61 @@ tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa)
   return rc;
 }
 
+OMX_ERRORTYPE
+tiz_soa_init_mt (/*@null@ */ tiz_soa_ptr_t * app_soa)
+{
+  tiz_soa_t * p_soa = NULL;
+
+  assert (app_soa);
+
+  tiz_check_omx (tiz_soa_init (&p_soa));
+  assert (p_soa);
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_soa->mutex)))
+    {
+      tiz_mem_free (p_soa);
+      *app_soa = NULL;
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_soa->mt = OMX_TRUE;
+  if (0 == pthread_key_create (&(p_soa->key), tcache_destroy))
+    {
+      p_soa->tls = OMX_TRUE;
+    }
+  else
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "Thread-specific storage unavailable; "
+               "thread caches disabled");
+    }
+
+  *app_soa = p_soa;
+
+  return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE
 tiz_soa_reserve_chunk (tiz_soa_t * p_soa, int32_t chunk_class)
 {
+  slice_t * p_slice = NULL;
+
   assert (p_soa != NULL);
   assert (chunk_class < TIZ_SOA_NUM_CHUNK_CLASSES);
 
-  return alloc_chunk (p_soa, chunk_class) == NULL
-           ? OMX_ErrorInsufficientResources
-           : OMX_ErrorNone;
+  if (p_soa->mt)
+    {
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+    }
+
+  p_slice = alloc_chunk (p_soa, chunk_class);
+
+  if (p_soa->mt)
+    {
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+
+  return p_slice == NULL ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
 }
 
 void
@@ -179,6 +514,28 @@ tiz_soa_destroy (tiz_soa_t * p_soa)
       chunk_t * p_chunk = NULL;
       chunk_t * p_next = NULL;
 
+      if (p_soa->mt)
+        {
+          tcache_t * p_tc = p_soa->p_tcache_lst;
+          tcache_t * p_next_tc = NULL;
+
+          /* No thread-specific destructors will run after this point; the
+             caches of the threads that are still alive are released here */
+          if (p_soa->tls)
+            {
+              (void) pthread_key_delete (p_soa->key);
+            }
+
+          while (p_tc != NULL)
+            {
+              p_next_tc = p_tc->p_next;
+              tiz_mem_free (p_tc);
+              p_tc = p_next_tc;
+            }
+
+          (void) tiz_mutex_destroy (&(p_soa->mutex));
+        }
+
       p_chunk = p_soa->p_chunk_lst;
 
       while (p_chunk != NULL)
@@ -206,23 +563,20 @@ tiz_soa_calloc (tiz_soa_t * p_soa, size_t size)
   {
     int32_t chunk_class = chunk_class_tbl[alloc_sz / SOA_SLICE_ALIGN];
     slice_t * p_slice = NULL;
+    size_t owner = 0;
 
-    p_slice = p_soa->p_slice_store[chunk_class];
-
-    if (NULL == p_slice)
+    if (p_soa->mt)
       {
-        p_slice = alloc_chunk (p_soa, chunk_class);
+        p_slice = mt_get_slice (p_soa, chunk_class, &owner);
       }
-    else
+    else if ((p_slice = store_get (p_soa, chunk_class)))
       {
-        p_soa->p_slice_store[chunk_class] = p_slice->p_next_free;
+        p_soa->n_allocated_objects += 1;
       }
 
     if (p_slice)
       {
-        p_slice->p_chunk->n_allocated_slices += 1;
-        p_soa->n_allocated_objects += 1;
-        p_slice->size = alloc_sz;
+        p_slice->size = alloc_sz | (owner << SOA_SLICE_OWNER_SHIFT);
         p_usr = get_usr_ptr (p_slice);
         (void) tiz_mem_set (p_usr, 0, size);
       }
@@ -241,17 +595,22 @@ tiz_soa_free (tiz_soa_t * p_soa, void * p_addr)
       slice_t * p_slice = get_slice_ptr (p_addr);
 
       assert (p_slice != NULL);
-      assert (p_slice->size <= SOA_MAX_SLICE_SIZE);
+      assert (get_slice_size (p_slice) <= SOA_MAX_SLICE_SIZE);
       {
-        chunk_t * p_chunk = p_slice->p_chunk;
-        int32_t chunk_class = chunk_class_tbl[p_slice->size / SOA_SLICE_ALIGN];
-
-        assert (p_chunk != NULL);
-
-        p_slice->p_chunk->n_allocated_slices -= 1;
-        p_soa->n_allocated_objects -= 1;
-        p_slice->p_next_free = p_soa->p_slice_store[chunk_class];
-        p_soa->p_slice_store[chunk_class] = p_slice;
+        int32_t chunk_class
+          = chunk_class_tbl[get_slice_size (p_slice) / SOA_SLICE_ALIGN];
+
+        assert (p_slice->p_chunk != NULL);
+
+        if (p_soa->mt)
+          {
+            mt_put_slice (p_soa, p_slice, chunk_class);
+          }
+        else
+          {
+            store_put (p_soa, p_slice, chunk_class);
+            p_soa->n_allocated_objects -= 1;
+          }
       }
     }
 }
@@ -261,18 +620,24 @@ tiz_soa_info (tiz_soa_t * p_soa, tiz_soa_info_t * p_info)
 {
   int32_t i = 0;
   chunk_t * p_chunk = NULL;
+  tcache_t * p_tc = NULL;
 
   assert (p_soa != NULL);
   assert (p_info != NULL);
 
   (void) tiz_mem_set (p_info, 0, sizeof (tiz_soa_info_t));
 
+  if (p_soa->mt)
+    {
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+    }
+
   p_info->chunks = p_soa->n_chunks;
   p_chunk = p_soa->p_chunk_lst;
 
   for (i = p_soa->n_chunks; i > 0; --i)
     {
-      p_info->slices[p_chunk->class] = p_chunk->n_allocated_slices;
+      p_info->slices[p_chunk->class] += p_chunk->n_allocated_slices;
       p_chunk = p_chunk->p_next;
     }
 
@@ -281,6 +646,35 @@ tiz_soa_info (tiz_soa_t * p_soa, tiz_soa_info_t * p_info)
   p_info->chunks = p_soa->n_chunks;
   p_info->objects = p_soa->n_allocated_objects;
 
+  if (p_soa->mt)
+    {
+      /* The counters of caches that belong to other threads are read without
+         synchronisation; figures are approximate while those threads are
+         allocating */
+      p_info->objects += p_soa->retired.objects;
+      p_info->tcache_hits = p_soa->retired.hits;
+      p_info->tcache_misses = p_soa->retired.misses;
+      p_info->tcache_flushes = p_soa->retired.flushes;
+      p_info->cross_thread_frees = p_soa->retired.xfrees;
+
+      for (p_tc = p_soa->p_tcache_lst; p_tc != NULL; p_tc = p_tc->p_next)
+        {
+          p_info->tcaches += 1;
+          p_info->objects += p_tc->stats.objects;
+          p_info->tcache_hits += p_tc->stats.hits;
+          p_info->tcache_misses += p_tc->stats.misses;
+          p_info->tcache_flushes += p_tc->stats.flushes;
+          p_info->cross_thread_frees += p_tc->stats.xfrees;
+          for (i = 0; i < TIZ_SOA_NUM_CHUNK_CLASSES; ++i)
+            {
+              /* Slices held in a magazine are not in use */
+              p_info->slices[i] -= p_tc->n_mag[i];
+            }
+        }
+
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+
   TIZ_LOG (TIZ_PRIORITY_TRACE, "objects [%d] chunks [%d]", p_info->objects,
            p_info->chunks);
 }
@@ -47,6 +47,15 @@ typedef /*@null@ */ tiz_soa_t * tiz_soa_ptr_t;
 OMX_ERRORTYPE
 tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa);
 
+/* Same as tiz_soa_init, but the resulting allocator may be shared between
+   threads without external locking. Each thread that uses it gets a small
+   per-size-class cache (a 'magazine') of free slices which is refilled from,
+   and returned to, the shared slice store in batches. If thread-local storage
+   can't be obtained, the allocator falls back to locking on every
+   operation. */
+OMX_ERRORTYPE
+tiz_soa_init_mt (/*@null@ */ tiz_soa_ptr_t * app_soa);
+
 void
 tiz_soa_destroy (tiz_soa_t * p_soa);
 
@@ -68,6 +77,17 @@ struct tiz_soa_info
   int32_t objects;
   /* Number of slices currently in use in each chunk class */
   int32_t slices[TIZ_SOA_NUM_CHUNK_CLASSES];
+  /* Thread cache statistics (only updated by tiz_soa_init_mt allocators) */
+  /* Number of thread caches currently alive */
+  int32_t tcaches;
+  /* Allocations served from a thread's magazine */
+  uint64_t tcache_hits;
+  /* Allocations that required a batch refill from the shared store */
+  uint64_t tcache_misses;
+  /* Batch returns of free slices to the shared store */
+  uint64_t tcache_flushes;
+  /* Slices freed by a thread other than the one that allocated them */
+  uint64_t cross_thread_frees;
 };
 
 void
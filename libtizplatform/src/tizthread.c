@@ -34,13 +34,22 @@
 
 #include "tizplatform.h"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <pthread.h>
 #include <assert.h>
 
+#ifdef HAVE_DBUS
+#include <sys/resource.h>
+#include <dbus/dbus.h>
+#endif
+
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.platform.thread"
@@ -55,6 +64,165 @@
 
 #define PTHREAD_SUCCESS 0
 
+#ifdef HAVE_DBUS
+
+#define RTKIT_SERVICE_NAME "org.freedesktop.RealtimeKit1"
+#define RTKIT_OBJECT_PATH "/org/freedesktop/RealtimeKit1"
+
+static int
+rtkit_get_int_property (DBusConnection * ap_conn, const char * ap_name,
+                        long long * ap_value)
+{
+  const char * p_iface = RTKIT_SERVICE_NAME;
+  DBusMessage * p_msg = NULL;
+  DBusMessage * p_reply = NULL;
+  DBusMessageIter iter;
+  DBusMessageIter sub;
+  DBusError error;
+  int rc = -1;
+
+  assert (ap_conn);
+  assert (ap_name);
+  assert (ap_value);
+
+  dbus_error_init (&error);
+
+  p_msg = dbus_message_new_method_call (RTKIT_SERVICE_NAME, RTKIT_OBJECT_PATH,
+                                        "org.freedesktop.DBus.Properties",
+                                        "Get");
+  if (p_msg
+      && dbus_message_append_args (p_msg, DBUS_TYPE_STRING, &p_iface,
+                                   DBUS_TYPE_STRING, &ap_name,
+                                   DBUS_TYPE_INVALID))
+    {
+      p_reply = dbus_connection_send_with_reply_and_block (ap_conn, p_msg, -1,
+                                                           &error);
+    }
+
+  if (p_reply && dbus_message_iter_init (p_reply, &iter)
+      && DBUS_TYPE_VARIANT == dbus_message_iter_get_arg_type (&iter))
+    {
+      dbus_message_iter_recurse (&iter, &sub);
+      if (DBUS_TYPE_INT32 == dbus_message_iter_get_arg_type (&sub))
+        {
+          dbus_int32_t value = 0;
+          dbus_message_iter_get_basic (&sub, &value);
+          *ap_value = value;
+          rc = 0;
+        }
+      else if (DBUS_TYPE_INT64 == dbus_message_iter_get_arg_type (&sub))
+        {
+          dbus_int64_t value = 0;
+          dbus_message_iter_get_basic (&sub, &value);
+          *ap_value = value;
+          rc = 0;
+        }
+    }
+
+  if (dbus_error_is_set (&error))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "rtkit [%s] : %s", ap_name, error.message);
+      dbus_error_free (&error);
+    }
+  if (p_reply)
+    {
+      dbus_message_unref (p_reply);
+    }
+  if (p_msg)
+    {
+      dbus_message_unref (p_msg);
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+rtkit_make_thread_realtime (OMX_S32 a_priority)
+{
+  DBusConnection * p_conn = NULL;
+  DBusMessage * p_msg = NULL;
+  DBusMessage * p_reply = NULL;
+  DBusError error;
+  long long max_prio = 0;
+  long long max_rttime = 0;
+  dbus_uint64_t tid = (dbus_uint64_t) tiz_thread_id ();
+  dbus_uint32_t prio = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  dbus_error_init (&error);
+
+  if (!(p_conn = dbus_bus_get_private (DBUS_BUS_SYSTEM, &error)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "rtkit : %s", error.message);
+      dbus_error_free (&error);
+      return OMX_ErrorInsufficientResources;
+    }
+  dbus_connection_set_exit_on_disconnect (p_conn, FALSE);
+
+  if (0 == rtkit_get_int_property (p_conn, "MaxRealtimePriority", &max_prio)
+      && a_priority > max_prio)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "rtkit : capping priority [%d] to [%lld]", a_priority,
+               max_prio);
+      a_priority = (OMX_S32) max_prio;
+    }
+  prio = (dbus_uint32_t) a_priority;
+
+  /* RealtimeKit refuses to promote threads of processes without a finite
+     RLIMIT_RTTIME within its own limit */
+  if (0 == rtkit_get_int_property (p_conn, "RTTimeUSecMax", &max_rttime)
+      && max_rttime > 0)
+    {
+      struct rlimit rl;
+      if (0 == getrlimit (RLIMIT_RTTIME, &rl)
+          && (RLIM_INFINITY == rl.rlim_max
+              || rl.rlim_max > (rlim_t) max_rttime))
+        {
+          rl.rlim_cur = rl.rlim_max = (rlim_t) max_rttime;
+          (void) setrlimit (RLIMIT_RTTIME, &rl);
+        }
+    }
+
+  p_msg = dbus_message_new_method_call (RTKIT_SERVICE_NAME, RTKIT_OBJECT_PATH,
+                                        RTKIT_SERVICE_NAME,
+                                        "MakeThreadRealtime");
+  if (p_msg
+      && dbus_message_append_args (p_msg, DBUS_TYPE_UINT64, &tid,
+                                   DBUS_TYPE_UINT32, &prio, DBUS_TYPE_INVALID))
+    {
+      p_reply = dbus_connection_send_with_reply_and_block (p_conn, p_msg, -1,
+                                                           &error);
+    }
+
+  if (p_reply && !dbus_set_error_from_message (&error, p_reply))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "rtkit : thread [%d] is now SCHED_RR priority [%u]",
+               (int) tid, (unsigned int) prio);
+      rc = OMX_ErrorNone;
+    }
+
+  if (dbus_error_is_set (&error))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "rtkit : %s", error.message);
+      dbus_error_free (&error);
+    }
+  if (p_reply)
+    {
+      dbus_message_unref (p_reply);
+    }
+  if (p_msg)
+    {
+      dbus_message_unref (p_msg);
+    }
+  dbus_connection_close (p_conn);
+  dbus_connection_unref (p_conn);
+
+  return rc;
+}
+
+#endif /* HAVE_DBUS */
+
 OMX_ERRORTYPE
 tiz_thread_create (tiz_thread_t * ap_thread, size_t a_stack_size,
                    OMX_U32 a_priority, OMX_PTR (*a_pf_routine) (OMX_PTR),
@@ -170,6 +338,172 @@ tiz_thread_id (void)
   return syscall (SYS_gettid);
 }
 
+OMX_ERRORTYPE
+tiz_thread_set_sched_policy (const tiz_thread_sched_policy_t a_policy,
+                             const OMX_S32 a_priority)
+{
+  struct sched_param param;
+  int policy = SCHED_OTHER;
+  int error = 0;
+
+  assert (a_policy < ETIZThreadSchedMax);
+
+  memset (&param, 0, sizeof (param));
+
+  if (ETIZThreadSchedOther != a_policy)
+    {
+      policy = ETIZThreadSchedFifo == a_policy ? SCHED_FIFO : SCHED_RR;
+      if (a_priority < sched_get_priority_min (policy)
+          || a_priority > sched_get_priority_max (policy))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "[OMX_ErrorBadParameter] : "
+                   "Priority [%d] out of range for policy [%d].",
+                   a_priority, policy);
+          return OMX_ErrorBadParameter;
+        }
+      param.sched_priority = a_priority;
+    }
+
+  if (PTHREAD_SUCCESS
+      == (error = pthread_setschedparam (pthread_self (), policy, &param)))
+    {
+      return OMX_ErrorNone;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE,
+           "Could not set the thread's scheduling policy (%s).",
+           strerror (error));
+
+#ifdef HAVE_DBUS
+  if (EPERM == error && SCHED_OTHER != policy)
+    {
+      return rtkit_make_thread_realtime (a_priority);
+    }
+#endif
+
+  return OMX_ErrorInsufficientResources;
+}
+
+OMX_ERRORTYPE
+tiz_thread_set_affinity (const char * ap_cpu_list)
+{
+  cpu_set_t cpus;
+  const char * p = ap_cpu_list;
+  int error = 0;
+
+  assert (ap_cpu_list);
+
+  CPU_ZERO (&cpus);
+
+  while (*p)
+    {
+      char * p_end = NULL;
+      unsigned long first = 0;
+      unsigned long last = 0;
+
+      first = last = strtoul (p, &p_end, 10);
+      if (p_end == p)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      p = p_end;
+      if ('-' == *p)
+        {
+          ++p;
+          last = strtoul (p, &p_end, 10);
+          if (p_end == p || last < first)
+            {
+              return OMX_ErrorBadParameter;
+            }
+          p = p_end;
+        }
+      if (last >= CPU_SETSIZE)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      for (; first <= last; ++first)
+        {
+          CPU_SET (first, &cpus);
+        }
+      while (' ' == *p || ',' == *p)
+        {
+          ++p;
+        }
+    }
+
+  if (0 == CPU_COUNT (&cpus))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  if (PTHREAD_SUCCESS
+      != (error = pthread_setaffinity_np (pthread_self (), sizeof (cpus),
+                                          &cpus)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "Could not set the thread's CPU affinity (%s). "
+               "Leaving with OMX_ErrorUndefined.",
+               strerror (error));
+      return OMX_ErrorUndefined;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static const char *
+get_thread_setting (const char * ap_prefix, const char * ap_key)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  (void) snprintf (key, sizeof (key), "%s.%s", ap_prefix, ap_key);
+  return tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+}
+
+void
+tiz_thread_apply_settings (const char * ap_prefix)
+{
+  const char * p_policy = NULL;
+  const char * p_cpus = NULL;
+
+  assert (ap_prefix);
+
+  /* When a setting can't be applied (e.g. no CAP_SYS_NICE and no
+     RealtimeKit), the thread runs with the default policy */
+  if ((p_policy = get_thread_setting (ap_prefix, "sched_policy")))
+    {
+      const char * p_prio = get_thread_setting (ap_prefix, "sched_priority");
+      const OMX_S32 prio = p_prio ? (OMX_S32) strtol (p_prio, NULL, 10) : 0;
+      tiz_thread_sched_policy_t policy = ETIZThreadSchedOther;
+
+      if (0 == strncasecmp (p_policy, "fifo", 4))
+        {
+          policy = ETIZThreadSchedFifo;
+        }
+      else if (0 == strncasecmp (p_policy, "rr", 2))
+        {
+          policy = ETIZThreadSchedRr;
+        }
+
+      if (OMX_ErrorNone != tiz_thread_set_sched_policy (policy, prio))
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "[%s] : Unable to apply sched_policy [%s] "
+                   "sched_priority [%d]; using the default policy",
+                   ap_prefix, p_policy, prio);
+        }
+    }
+
+  if ((p_cpus = get_thread_setting (ap_prefix, "cpu_affinity")))
+    {
+      if (OMX_ErrorNone != tiz_thread_set_affinity (p_cpus))
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "[%s] : Unable to apply cpu_affinity [%s]", ap_prefix,
+                   p_cpus);
+        }
+    }
+}
+
 OMX_ERRORTYPE
 tiz_thread_setname (tiz_thread_t * ap_thread, const OMX_STRING a_name)
 {
@@ -52,6 +52,17 @@ extern "C" {
  */
 typedef OMX_U32 tiz_thread_t;
 
+/**
+ * Thread scheduling policies
+ * @ingroup tizthread
+ */
+typedef enum tiz_thread_sched_policy {
+  ETIZThreadSchedOther = 0, /**< The default time-sharing policy */
+  ETIZThreadSchedFifo,      /**< SCHED_FIFO real-time policy */
+  ETIZThreadSchedRr,        /**< SCHED_RR real-time policy */
+  ETIZThreadSchedMax
+} tiz_thread_sched_policy_t;
+
 /**
  * Create a new thread, starting with execution of a_pf_routine getting
  * passed ap_arg.  The new hdl is stored in *ap_thread.
@@ -104,6 +115,56 @@ tiz_thread_exit (OMX_PTR a_status);
 OMX_S32
 tiz_thread_id (void);
 
+/**
+ * Change the scheduling policy and static priority of the calling thread.
+ *
+ * If a real-time policy is requested but the process is not allowed to use
+ * it (no CAP_SYS_NICE, or RLIMIT_RTPRIO too low) and Tizonia was built with
+ * D-Bus support, RealtimeKit is asked to promote the thread instead.
+ * RealtimeKit always grants SCHED_RR and caps the priority at its own
+ * maximum.
+ *
+ * @ingroup tizthread
+ *
+ * @param a_policy The scheduling policy.
+ * @param a_priority The static priority (ignored with ETIZThreadSchedOther).
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorBadParameter if the priority is
+ * out of range, or OMX_ErrorInsufficientResources if the thread could not be
+ * promoted.
+ */
+OMX_ERRORTYPE
+tiz_thread_set_sched_policy (const tiz_thread_sched_policy_t a_policy,
+                             const OMX_S32 a_priority);
+
+/**
+ * Restrict the calling thread to a set of CPUs.
+ *
+ * @ingroup tizthread
+ *
+ * @param ap_cpu_list A comma-separated list of CPU numbers or ranges, e.g.
+ * "0,2-3".
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorBadParameter if the list can't
+ * be parsed, or OMX_ErrorUndefined if the affinity could not be set.
+ */
+OMX_ERRORTYPE
+tiz_thread_set_affinity (const char * ap_cpu_list);
+
+/**
+ * Apply to the calling thread the scheduling settings found in the plugins
+ * section of the configuration file under ap_prefix, i.e.
+ * ap_prefix.sched_policy (other | fifo | rr), ap_prefix.sched_priority and
+ * ap_prefix.cpu_affinity. None of them are mandatory, and a setting that
+ * can't be applied is logged and ignored.
+ *
+ * @ingroup tizthread
+ *
+ * @param ap_prefix The key prefix, e.g. the component name.
+ */
+void
+tiz_thread_apply_settings (const char * ap_prefix);
+
 /**
  * Sleep for the specified number of micro seconds.
  *
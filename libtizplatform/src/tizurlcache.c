@@ -0,0 +1,635 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - On-disk URL cache
+ *
+ * Each entry is a pair of files named after a 64-bit FNV-1a hash of the URL:
+ * '<hash>.data' holds the prefix of the resource fetched so far and
+ * '<hash>.meta' holds the URL (to tell hash collisions apart), the length of
+ * the resource, its validator and the response's header block. The
+ * modification time of the data file is the entry's last use.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.urlcache"
+#endif
+
+#define URLCACHE_MAGIC "tizurlcache 1"
+#define URLCACHE_DATA_EXT ".data"
+#define URLCACHE_META_EXT ".meta"
+#define URLCACHE_MAX_META_BYTES (64 * 1024)
+
+struct tiz_urlcache
+{
+  char * p_dir_;
+  size_t max_bytes_;
+};
+
+struct tiz_urlcache_entry
+{
+  char * p_url_;
+  char * p_data_path_;
+  char * p_meta_path_;
+  int fd_;
+  size_t stored_;
+  size_t length_;
+  char * p_headers_;
+  char * p_validator_;
+};
+
+typedef struct urlcache_file urlcache_file_t;
+struct urlcache_file
+{
+  char name[32];
+  off_t bytes;
+  struct timespec mtime;
+};
+
+static uint64_t
+hash_url (const char * ap_url)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  assert (ap_url);
+  while (*ap_url)
+    {
+      hash ^= (unsigned char) *ap_url++;
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+static char *
+make_path (const char * ap_dir, const char * ap_name, const char * ap_ext)
+{
+  size_t len = strlen (ap_dir) + strlen (ap_name) + strlen (ap_ext) + 2;
+  char * p_path = tiz_mem_alloc (len);
+  if (p_path)
+    {
+      snprintf (p_path, len, "%s/%s%s", ap_dir, ap_name, ap_ext);
+    }
+  return p_path;
+}
+
+static char *
+dup_string (const char * ap_str)
+{
+  char * p_dup = NULL;
+  if (ap_str)
+    {
+      size_t len = strlen (ap_str) + 1;
+      if ((p_dup = tiz_mem_alloc (len)))
+        {
+          memcpy (p_dup, ap_str, len);
+        }
+    }
+  return p_dup;
+}
+
+static OMX_ERRORTYPE
+make_dirs (const char * ap_dir)
+{
+  char * p_path = dup_string (ap_dir);
+  char * p = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  tiz_check_null_ret_oom (p_path);
+  for (p = p_path + 1; *p; ++p)
+    {
+      if ('/' == *p)
+        {
+          *p = '\0';
+          (void) mkdir (p_path, 0700);
+          *p = '/';
+        }
+    }
+  if (0 != mkdir (p_path, 0700) && EEXIST != errno)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create [%s] (%s)", p_path,
+               strerror (errno));
+      rc = OMX_ErrorInsufficientResources;
+    }
+  tiz_mem_free (p_path);
+  return rc;
+}
+
+static int
+cmp_files_by_mtime (const void * ap_a, const void * ap_b)
+{
+  const urlcache_file_t * p_a = ap_a;
+  const urlcache_file_t * p_b = ap_b;
+  if (p_a->mtime.tv_sec != p_b->mtime.tv_sec)
+    {
+      return (p_a->mtime.tv_sec > p_b->mtime.tv_sec) ? 1 : -1;
+    }
+  return (p_a->mtime.tv_nsec > p_b->mtime.tv_nsec)
+         - (p_a->mtime.tv_nsec < p_b->mtime.tv_nsec);
+}
+
+static void
+remove_files (const tiz_urlcache_t * ap_cache, const char * ap_key)
+{
+  char * p_data = make_path (ap_cache->p_dir_, ap_key, URLCACHE_DATA_EXT);
+  char * p_meta = make_path (ap_cache->p_dir_, ap_key, URLCACHE_META_EXT);
+  if (p_data)
+    {
+      (void) unlink (p_data);
+    }
+  if (p_meta)
+    {
+      (void) unlink (p_meta);
+    }
+  tiz_mem_free (p_data);
+  tiz_mem_free (p_meta);
+}
+
+/* Evict the least recently used entries until the directory is within its
+   limit. Entries are listed by their data files; the size of an entry
+   includes its meta file. */
+static void
+evict (tiz_urlcache_t * ap_cache)
+{
+  urlcache_file_t * p_files = NULL;
+  size_t nfiles = 0;
+  size_t capacity = 0;
+  size_t total = 0;
+  size_t i = 0;
+  struct dirent * p_dirent = NULL;
+  DIR * p_dir = NULL;
+
+  assert (ap_cache);
+
+  if (!(p_dir = opendir (ap_cache->p_dir_)))
+    {
+      return;
+    }
+
+  while ((p_dirent = readdir (p_dir)))
+    {
+      const char * p_ext = strrchr (p_dirent->d_name, '.');
+      size_t key_len = p_ext ? (size_t) (p_ext - p_dirent->d_name) : 0;
+      struct stat st;
+      char * p_path = NULL;
+
+      if (!p_ext || 0 != strcmp (p_ext, URLCACHE_DATA_EXT) || !key_len
+          || key_len >= sizeof (p_files[0].name))
+        {
+          continue;
+        }
+
+      if (nfiles == capacity)
+        {
+          urlcache_file_t * p_new = NULL;
+          capacity = capacity ? capacity * 2 : 32;
+          if (!(p_new = tiz_mem_realloc (p_files,
+                                         capacity * sizeof (urlcache_file_t))))
+            {
+              break;
+            }
+          p_files = p_new;
+        }
+
+      memcpy (p_files[nfiles].name, p_dirent->d_name, key_len);
+      p_files[nfiles].name[key_len] = '\0';
+      p_files[nfiles].bytes = 0;
+      p_files[nfiles].mtime.tv_sec = 0;
+      p_files[nfiles].mtime.tv_nsec = 0;
+
+      if ((p_path = make_path (ap_cache->p_dir_, p_dirent->d_name, ""))
+          && 0 == stat (p_path, &st))
+        {
+          p_files[nfiles].bytes = st.st_size;
+          p_files[nfiles].mtime = st.st_mtim;
+        }
+      tiz_mem_free (p_path);
+      if ((p_path = make_path (ap_cache->p_dir_, p_files[nfiles].name,
+                               URLCACHE_META_EXT))
+          && 0 == stat (p_path, &st))
+        {
+          p_files[nfiles].bytes += st.st_size;
+        }
+      tiz_mem_free (p_path);
+
+      total += p_files[nfiles].bytes;
+      ++nfiles;
+    }
+  (void) closedir (p_dir);
+
+  if (total > ap_cache->max_bytes_)
+    {
+      qsort (p_files, nfiles, sizeof (urlcache_file_t), cmp_files_by_mtime);
+      for (i = 0; i < nfiles && total > ap_cache->max_bytes_; ++i)
+        {
+          TIZ_LOG (TIZ_PRIORITY_TRACE, "Evicting [%s] (%ld bytes)",
+                   p_files[i].name, (long) p_files[i].bytes);
+          remove_files (ap_cache, p_files[i].name);
+          total -= p_files[i].bytes;
+        }
+    }
+
+  tiz_mem_free (p_files);
+}
+
+static void
+clear_entry_info (tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  tiz_mem_free (ap_entry->p_headers_);
+  ap_entry->p_headers_ = NULL;
+  tiz_mem_free (ap_entry->p_validator_);
+  ap_entry->p_validator_ = NULL;
+  ap_entry->length_ = 0;
+  ap_entry->stored_ = 0;
+}
+
+/* Forget whatever the entry held */
+static void
+discard_entry (tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  clear_entry_info (ap_entry);
+  (void) unlink (ap_entry->p_meta_path_);
+  if (ap_entry->fd_ >= 0)
+    {
+      (void) ftruncate (ap_entry->fd_, 0);
+    }
+}
+
+static char *
+read_meta_file (const char * ap_path)
+{
+  char * p_buf = NULL;
+  struct stat st;
+  int fd = -1;
+
+  if ((fd = open (ap_path, O_RDONLY)) < 0)
+    {
+      return NULL;
+    }
+
+  if (0 == fstat (fd, &st) && st.st_size > 0
+      && st.st_size <= URLCACHE_MAX_META_BYTES
+      && (p_buf = tiz_mem_alloc (st.st_size + 1)))
+    {
+      if (read (fd, p_buf, st.st_size) == st.st_size)
+        {
+          p_buf[st.st_size] = '\0';
+        }
+      else
+        {
+          tiz_mem_free (p_buf);
+          p_buf = NULL;
+        }
+    }
+  (void) close (fd);
+  return p_buf;
+}
+
+/* Returns a pointer to the value of a "<name> <value>\n" line, nul-terminated
+   in place, and advances the cursor past the line */
+static char *
+next_meta_field (char ** app_cursor, const char * ap_name)
+{
+  size_t name_len = strlen (ap_name);
+  char * p_line = *app_cursor;
+  char * p_eol = strchr (p_line, '\n');
+
+  if (!p_eol || 0 != strncmp (p_line, ap_name, name_len)
+      || ' ' != p_line[name_len])
+    {
+      return NULL;
+    }
+  *p_eol = '\0';
+  *app_cursor = p_eol + 1;
+  return p_line + name_len + 1;
+}
+
+static bool
+load_meta (tiz_urlcache_entry_t * ap_entry)
+{
+  char * p_buf = NULL;
+  char * p_cursor = NULL;
+  char * p_length = NULL;
+  char * p_validator = NULL;
+  char * p_url = NULL;
+  bool loaded = false;
+
+  assert (ap_entry);
+
+  if (!(p_buf = read_meta_file (ap_entry->p_meta_path_)))
+    {
+      return false;
+    }
+
+  p_cursor = p_buf;
+  if (0 == strncmp (p_cursor, URLCACHE_MAGIC "\n", strlen (URLCACHE_MAGIC) + 1)
+      && (p_cursor += strlen (URLCACHE_MAGIC) + 1)
+      && (p_length = next_meta_field (&p_cursor, "length"))
+      && (p_validator = next_meta_field (&p_cursor, "validator"))
+      && (p_url = next_meta_field (&p_cursor, "url"))
+      && 0 == strcmp (p_url, ap_entry->p_url_))
+    {
+      ap_entry->length_ = strtoul (p_length, NULL, 10);
+      ap_entry->p_validator_
+        = (0 == strcmp (p_validator, "-") ? NULL : dup_string (p_validator));
+      ap_entry->p_headers_ = dup_string (p_cursor);
+      loaded = (ap_entry->length_ > 0 && ap_entry->p_headers_);
+    }
+
+  tiz_mem_free (p_buf);
+  return loaded;
+}
+
+static OMX_ERRORTYPE
+store_meta (tiz_urlcache_entry_t * ap_entry)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  char * p_tmp = NULL;
+  FILE * p_file = NULL;
+
+  assert (ap_entry);
+
+  /* Write to a temporary file first, so that a meta file is never seen half
+     written */
+  tiz_check_null_ret_oom (
+    (p_tmp = tiz_mem_alloc (strlen (ap_entry->p_meta_path_) + 5)));
+  sprintf (p_tmp, "%s.tmp", ap_entry->p_meta_path_);
+  if ((p_file = fopen (p_tmp, "w")))
+    {
+      int written = fprintf (
+        p_file, URLCACHE_MAGIC "\nlength %lu\nvalidator %s\nurl %s\n%s",
+        (unsigned long) ap_entry->length_,
+        ap_entry->p_validator_ ? ap_entry->p_validator_ : "-",
+        ap_entry->p_url_, ap_entry->p_headers_);
+      if (0 == fclose (p_file) && written > 0
+          && 0 == rename (p_tmp, ap_entry->p_meta_path_))
+        {
+          rc = OMX_ErrorNone;
+        }
+    }
+  if (OMX_ErrorNone != rc)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write [%s] (%s)",
+               ap_entry->p_meta_path_, strerror (errno));
+      (void) unlink (p_tmp);
+    }
+  tiz_mem_free (p_tmp);
+  return rc;
+}
+
+static void
+destroy_entry (tiz_urlcache_entry_t * ap_entry)
+{
+  if (ap_entry)
+    {
+      if (ap_entry->fd_ >= 0)
+        {
+          (void) close (ap_entry->fd_);
+        }
+      clear_entry_info (ap_entry);
+      tiz_mem_free (ap_entry->p_url_);
+      tiz_mem_free (ap_entry->p_data_path_);
+      tiz_mem_free (ap_entry->p_meta_path_);
+      tiz_mem_free (ap_entry);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_init (tiz_urlcache_ptr_t * app_cache, const char * ap_dir,
+                   const size_t a_max_bytes)
+{
+  tiz_urlcache_t * p_cache = NULL;
+
+  assert (app_cache);
+  assert (ap_dir);
+
+  tiz_check_omx (make_dirs (ap_dir));
+  tiz_check_null_ret_oom (
+    (p_cache = tiz_mem_calloc (1, sizeof (tiz_urlcache_t))));
+  if (!(p_cache->p_dir_ = dup_string (ap_dir)))
+    {
+      tiz_mem_free (p_cache);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_cache->max_bytes_ = a_max_bytes;
+  evict (p_cache);
+
+  *app_cache = p_cache;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urlcache_destroy (tiz_urlcache_t * ap_cache)
+{
+  if (ap_cache)
+    {
+      tiz_mem_free (ap_cache->p_dir_);
+      tiz_mem_free (ap_cache);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_open (tiz_urlcache_t * ap_cache, const char * ap_url,
+                   tiz_urlcache_entry_ptr_t * app_entry)
+{
+  tiz_urlcache_entry_t * p_entry = NULL;
+  char key[17];
+  struct stat st;
+
+  assert (ap_cache);
+  assert (ap_url);
+  assert (app_entry);
+
+  snprintf (key, sizeof (key), "%016" PRIx64, hash_url (ap_url));
+
+  tiz_check_null_ret_oom (
+    (p_entry = tiz_mem_calloc (1, sizeof (tiz_urlcache_entry_t))));
+  p_entry->fd_ = -1;
+  if (!(p_entry->p_url_ = dup_string (ap_url))
+      || !(p_entry->p_data_path_
+           = make_path (ap_cache->p_dir_, key, URLCACHE_DATA_EXT))
+      || !(p_entry->p_meta_path_
+           = make_path (ap_cache->p_dir_, key, URLCACHE_META_EXT))
+      || (p_entry->fd_ = open (p_entry->p_data_path_, O_RDWR | O_CREAT, 0600))
+           < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to open the entry for [%s]",
+               ap_url);
+      destroy_entry (p_entry);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (load_meta (p_entry) && 0 == fstat (p_entry->fd_, &st))
+    {
+      p_entry->stored_ = MIN ((size_t) st.st_size, p_entry->length_);
+    }
+  else
+    {
+      discard_entry (p_entry);
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : stored [%lu] of [%lu]", ap_url,
+           (unsigned long) p_entry->stored_, (unsigned long) p_entry->length_);
+
+  *app_entry = p_entry;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urlcache_close (tiz_urlcache_t * ap_cache, tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_cache);
+  if (ap_entry)
+    {
+      if (ap_entry->fd_ >= 0)
+        {
+          /* Mark it as the most recently used entry */
+          (void) futimens (ap_entry->fd_, NULL);
+        }
+      destroy_entry (ap_entry);
+      evict (ap_cache);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_reset (tiz_urlcache_entry_t * ap_entry, const char * ap_headers,
+                    const size_t a_length, const char * ap_validator)
+{
+  assert (ap_entry);
+  assert (ap_headers);
+  assert (a_length > 0);
+
+  discard_entry (ap_entry);
+  ap_entry->length_ = a_length;
+  ap_entry->p_headers_ = dup_string (ap_headers);
+  ap_entry->p_validator_ = dup_string (ap_validator);
+  if (!ap_entry->p_headers_ || (ap_validator && !ap_entry->p_validator_)
+      || OMX_ErrorNone != store_meta (ap_entry))
+    {
+      discard_entry (ap_entry);
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+void
+tiz_urlcache_discard (tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  discard_entry (ap_entry);
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_append (tiz_urlcache_entry_t * ap_entry, const void * ap_data,
+                     const size_t a_nbytes)
+{
+  size_t nbytes = 0;
+  assert (ap_entry);
+  assert (ap_data);
+
+  if (!ap_entry->length_)
+    {
+      /* Nothing is being cached for this entry */
+      return OMX_ErrorNone;
+    }
+
+  nbytes = MIN (a_nbytes, ap_entry->length_ - ap_entry->stored_);
+  if (nbytes > 0)
+    {
+      if (pwrite (ap_entry->fd_, ap_data, nbytes, ap_entry->stored_)
+          != (ssize_t) nbytes)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write [%s] (%s)",
+                   ap_entry->p_data_path_, strerror (errno));
+          discard_entry (ap_entry);
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_entry->stored_ += nbytes;
+    }
+  return OMX_ErrorNone;
+}
+
+size_t
+tiz_urlcache_read (tiz_urlcache_entry_t * ap_entry, const size_t a_offset,
+                   void * ap_data, const size_t a_nbytes)
+{
+  ssize_t nbytes = 0;
+  assert (ap_entry);
+  assert (ap_data);
+
+  if (a_offset >= ap_entry->stored_)
+    {
+      return 0;
+    }
+  nbytes = pread (ap_entry->fd_, ap_data,
+                  MIN (a_nbytes, ap_entry->stored_ - a_offset), a_offset);
+  return nbytes > 0 ? (size_t) nbytes : 0;
+}
+
+size_t
+tiz_urlcache_stored (const tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  return ap_entry->stored_;
+}
+
+size_t
+tiz_urlcache_length (const tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  return ap_entry->length_;
+}
+
+const char *
+tiz_urlcache_headers (const tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  return ap_entry->p_headers_;
+}
+
+const char *
+tiz_urlcache_validator (const tiz_urlcache_entry_t * ap_entry)
+{
+  assert (ap_entry);
+  return ap_entry->p_validator_;
+}
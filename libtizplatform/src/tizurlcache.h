@@ -0,0 +1,202 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - On-disk URL cache
+ *
+ *
+ */
+
+#ifndef TIZURLCACHE_H
+#define TIZURLCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup tizurlcache On-disk URL cache
+ *
+ * A bounded cache of HTTP resources kept in a directory on disk. An entry
+ * holds the bytes of a resource that have been fetched so far, always a
+ * prefix of it, together with the header block of the response they came
+ * from, so that a later transfer of the same URL can be replayed locally and
+ * only the missing part, if any, has to be requested from the server.
+ *
+ * Entries are named after a hash of their URL. The total size of the
+ * directory is kept under a configured limit by evicting the least recently
+ * used entries.
+ *
+ * @ingroup libtizplatform
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * On-disk URL cache opaque handle.
+ * @ingroup tizurlcache
+ */
+typedef struct tiz_urlcache tiz_urlcache_t;
+typedef /*@null@ */ tiz_urlcache_t * tiz_urlcache_ptr_t;
+
+/**
+ * Cache entry opaque handle.
+ * @ingroup tizurlcache
+ */
+typedef struct tiz_urlcache_entry tiz_urlcache_entry_t;
+typedef /*@null@ */ tiz_urlcache_entry_t * tiz_urlcache_entry_ptr_t;
+
+/**
+ * Open a cache in a directory, creating the directory if needed, and trim it
+ * down to its size limit.
+ *
+ * @ingroup tizurlcache
+ *
+ * @param app_cache A pointer to the new cache handle (output).
+ * @param ap_dir The cache directory.
+ * @param a_max_bytes The maximum number of bytes stored in the directory.
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources if the
+ * directory can't be created or the handle can't be allocated.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_init (tiz_urlcache_ptr_t * app_cache, const char * ap_dir,
+                   const size_t a_max_bytes);
+
+/**
+ * Close a cache. The entries stay on disk.
+ *
+ * @ingroup tizurlcache
+ */
+void
+tiz_urlcache_destroy (tiz_urlcache_t * ap_cache);
+
+/**
+ * Open the entry of a URL, creating an empty one if there is none.
+ *
+ * @ingroup tizurlcache
+ *
+ * @param ap_cache The cache.
+ * @param ap_url The URL.
+ * @param app_entry A pointer to the entry handle (output).
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_open (tiz_urlcache_t * ap_cache, const char * ap_url,
+                   tiz_urlcache_entry_ptr_t * app_entry);
+
+/**
+ * Close an entry, marking it as the most recently used one, and evict the
+ * least recently used entries while the cache is over its limit.
+ *
+ * @ingroup tizurlcache
+ */
+void
+tiz_urlcache_close (tiz_urlcache_t * ap_cache,
+                    tiz_urlcache_entry_t * ap_entry);
+
+/**
+ * Start an entry over, for a new response.
+ *
+ * @ingroup tizurlcache
+ *
+ * @param ap_entry The entry.
+ * @param ap_headers The response's header block, as received.
+ * @param a_length The length of the resource.
+ * @param ap_validator The response's ETag or Last-Modified value, or NULL.
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_reset (tiz_urlcache_entry_t * ap_entry, const char * ap_headers,
+                    const size_t a_length, const char * ap_validator);
+
+/**
+ * Empty an entry, e.g. because the resource has changed on the server. The
+ * entry stays open, and can be started over with tiz_urlcache_reset.
+ *
+ * @ingroup tizurlcache
+ */
+void
+tiz_urlcache_discard (tiz_urlcache_entry_t * ap_entry);
+
+/**
+ * Append bytes to the prefix stored in an entry.
+ *
+ * @ingroup tizurlcache
+ *
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources if the
+ * data could not be written, in which case the entry is discarded.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_append (tiz_urlcache_entry_t * ap_entry, const void * ap_data,
+                     const size_t a_nbytes);
+
+/**
+ * Read bytes from the prefix stored in an entry.
+ *
+ * @ingroup tizurlcache
+ *
+ * @return The number of bytes read.
+ */
+size_t
+tiz_urlcache_read (tiz_urlcache_entry_t * ap_entry, const size_t a_offset,
+                   void * ap_data, const size_t a_nbytes);
+
+/**
+ * @ingroup tizurlcache
+ * @return The number of bytes stored in an entry.
+ */
+size_t
+tiz_urlcache_stored (const tiz_urlcache_entry_t * ap_entry);
+
+/**
+ * @ingroup tizurlcache
+ * @return The length of the resource, or 0 if the entry is empty.
+ */
+size_t
+tiz_urlcache_length (const tiz_urlcache_entry_t * ap_entry);
+
+/**
+ * @ingroup tizurlcache
+ * @return The response's header block, or NULL if the entry is empty.
+ */
+const char *
+tiz_urlcache_headers (const tiz_urlcache_entry_t * ap_entry);
+
+/**
+ * @ingroup tizurlcache
+ * @return The response's validator, or NULL if it had none.
+ */
+const char *
+tiz_urlcache_validator (const tiz_urlcache_entry_t * ap_entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZURLCACHE_H */
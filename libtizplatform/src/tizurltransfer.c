@@ -32,8 +32,13 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
@@ -63,6 +68,33 @@ static int
 curl_timer_cback (CURLM * multi, long timeout_ms, void * userp);
 static inline OMX_ERRORTYPE
 stop_io_watcher (tiz_urltrans_t * ap_trans);
+static void
+report_connection_lost_event (tiz_urltrans_t * ap_trans);
+static void
+replay_cached_headers (tiz_urltrans_t * ap_trans);
+
+/* How many times in a row a dropped transfer is resumed without making any
+   progress, before the parent is told that the connection is lost */
+#define URLTRANS_MAX_RESUME_ATTEMPTS 3
+/* How much of a cached resource is replayed per curl timer tick */
+#define URLTRANS_CACHE_READ_BYTES (16 * 1024)
+#define URLTRANS_CACHE_TICK_BYTES (64 * 1024)
+#define URLTRANS_CACHE_DEFAULT_DIR "tizonia/urlcache"
+/* The adaptive jitter buffer of live streams: the default limits of its
+   target, the weight of the jitter estimate in it, and how long the estimate
+   takes to decay after the network settles down */
+#define URLTRANS_JITTER_DEFAULT_MIN_MS 5000
+#define URLTRANS_JITTER_DEFAULT_MAX_MS 30000
+#define URLTRANS_JITTER_FACTOR 2
+#define URLTRANS_JITTER_DECAY_MS 60000.0
+/* How long the parent may go without data, with the store empty, before it
+   counts as an underrun */
+#define URLTRANS_UNDERRUN_MS 250.0
+/* Reconnection to a live stream that drops: the attempts made before the
+   parent is told, and the bounds of the exponential backoff between them */
+#define URLTRANS_MAX_RECONNECT_ATTEMPTS 5
+#define URLTRANS_RECONNECT_MIN_DELAY 0.25
+#define URLTRANS_RECONNECT_MAX_DELAY 30.0
 
 /* These macros assume the existence of an "ap_trans" local variable */
 #define bail_on_curl_error(expr)                                           \
@@ -202,9 +234,204 @@ struct tiz_urltrans
   struct curl_slist * p_http_headers_;
   httpsrc_curl_state_id_t curl_state_;
   unsigned int curl_version_;
+  bool engine_acquired_;
   char curl_err[CURL_ERROR_SIZE];
+  /* The resource being transferred */
+  tiz_buffer_t * p_headers_; /* header block of the current response */
+  long status_;              /* status code of the current response */
+  bool is_icy_;
+  size_t content_length_; /* as announced by the current response */
+  size_t total_length_;   /* of the resource, or 0 if unknown */
+  size_t body_bytes_;     /* bytes of the resource delivered so far */
+  char validator_[256];   /* ETag or Last-Modified, used for If-Range */
+  /* Resuming with a range request after a dropped connection, or after
+     replaying the part of the resource found in the disk cache */
+  bool resuming_;
+  int resume_attempts_;
+  struct curl_slist * p_resume_headers_;
+  /* The disk cache */
+  tiz_urlcache_t * p_cache_;
+  tiz_urlcache_entry_t * p_cache_entry_;
+  bool revalidating_; /* asking the server whether the entry is current */
+  bool serving_from_cache_;
+  /* The jitter buffer, for live streams of a known rate */
+  bool live_; /* the resource has no length */
+  OMX_U32 bytes_per_sec_;
+  OMX_U32 jitter_min_ms_;
+  OMX_U32 jitter_max_ms_;
+  double jitter_ms_;
+  double deficit_ms_;      /* how far the network lags the stream's rate */
+  double last_arrival_ms_; /* 0 after a pause */
+  size_t last_chunk_bytes_;
+  double store_empty_ms_; /* when the store last ran dry */
+  bool rebuffering_;      /* holding data back until the target is reached */
+  OMX_U32 underruns_;
+  /* Reconnecting to live streams behind the parent's back */
+  bool reconnecting_; /* the parent has already seen the headers */
+  int reconnect_attempts_;
+  int lost_reports_;
+  OMX_U32 reconnects_;
+};
+
+/* Process-wide state shared by all the transfers. Each transfer keeps its own
+   multi handle, driven by its parent's event watchers on the parent's thread,
+   but the DNS cache and the TLS session cache live here, so that moving on to
+   a new URL on the same host skips the name lookup and resumes the TLS
+   session. Connections are not shared: libcurl does not support sharing a
+   connection cache between concurrent threads. Keep-alive connections are
+   kept by each transfer's multi handle, across tiz_urltrans_set_uri
+   calls. */
+typedef struct tiz_urltrans_engine tiz_urltrans_engine_t;
+struct tiz_urltrans_engine
+{
+  pthread_mutex_t mutex; /* Protects refs_ and the engine's setup/teardown */
+  int refs_;
+  CURLSH * p_share_;
+  unsigned int curl_version_;
+  pthread_mutex_t locks_[CURL_LOCK_DATA_LAST];
 };
 
+static tiz_urltrans_engine_t g_engine = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static void
+engine_lock_cback (CURL * p_curl, curl_lock_data data,
+                   curl_lock_access access, void * userptr)
+{
+  tiz_urltrans_engine_t * p_engine = userptr;
+  assert (p_engine);
+  assert (data < CURL_LOCK_DATA_LAST);
+  (void) pthread_mutex_lock (&(p_engine->locks_[data]));
+}
+
+static void
+engine_unlock_cback (CURL * p_curl, curl_lock_data data, void * userptr)
+{
+  tiz_urltrans_engine_t * p_engine = userptr;
+  assert (p_engine);
+  assert (data < CURL_LOCK_DATA_LAST);
+  (void) pthread_mutex_unlock (&(p_engine->locks_[data]));
+}
+
+static void
+engine_teardown (tiz_urltrans_engine_t * ap_engine)
+{
+  int i = 0;
+  assert (ap_engine);
+  if (ap_engine->p_share_)
+    {
+      (void) curl_share_cleanup (ap_engine->p_share_);
+      ap_engine->p_share_ = NULL;
+      for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+        {
+          (void) pthread_mutex_destroy (&(ap_engine->locks_[i]));
+        }
+    }
+  curl_global_cleanup ();
+}
+
+static OMX_ERRORTYPE
+engine_setup (tiz_urltrans_engine_t * ap_engine)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  curl_version_info_data * p_version_info = NULL;
+  CURLSHcode share_rc = CURLSHE_OK;
+  int i = 0;
+
+  assert (ap_engine);
+  assert (!ap_engine->p_share_);
+
+  if (CURLE_OK != curl_global_init (CURL_GLOBAL_ALL))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[OMX_ErrorInsufficientResources] : "
+                                   "curl_global_init failed");
+      return OMX_ErrorInsufficientResources;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_DEBUG, "%s", curl_version ());
+
+  p_version_info = curl_version_info (CURLVERSION_NOW);
+  if (p_version_info)
+    {
+      ap_engine->curl_version_ = p_version_info->version_num;
+    }
+
+  bail_on_oom ((ap_engine->p_share_ = curl_share_init ()));
+  for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+    {
+      (void) pthread_mutex_init (&(ap_engine->locks_[i]), NULL);
+    }
+
+  if (CURLSHE_OK != (share_rc = curl_share_setopt (
+                       ap_engine->p_share_, CURLSHOPT_LOCKFUNC,
+                       engine_lock_cback))
+      || CURLSHE_OK != (share_rc = curl_share_setopt (
+                          ap_engine->p_share_, CURLSHOPT_UNLOCKFUNC,
+                          engine_unlock_cback))
+      || CURLSHE_OK != (share_rc = curl_share_setopt (
+                          ap_engine->p_share_, CURLSHOPT_USERDATA, ap_engine))
+      || CURLSHE_OK != (share_rc = curl_share_setopt (ap_engine->p_share_,
+                                                      CURLSHOPT_SHARE,
+                                                      CURL_LOCK_DATA_DNS)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "[OMX_ErrorInsufficientResources] : error while using "
+               "curl share (%s)",
+               curl_share_strerror (share_rc));
+      goto end;
+    }
+
+  /* Not every TLS backend can share sessions; without it, transfers just do
+     full handshakes */
+  if (CURLSHE_OK
+      != (share_rc = curl_share_setopt (ap_engine->p_share_, CURLSHOPT_SHARE,
+                                        CURL_LOCK_DATA_SSL_SESSION)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "TLS sessions not shared (%s)",
+               curl_share_strerror (share_rc));
+    }
+
+  /* all ok */
+  rc = OMX_ErrorNone;
+
+end:
+
+  if (OMX_ErrorNone != rc)
+    {
+      engine_teardown (ap_engine);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+acquire_engine (void)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  (void) pthread_mutex_lock (&(g_engine.mutex));
+  if (0 == g_engine.refs_)
+    {
+      rc = engine_setup (&g_engine);
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      ++g_engine.refs_;
+    }
+  (void) pthread_mutex_unlock (&(g_engine.mutex));
+  return rc;
+}
+
+static void
+release_engine (void)
+{
+  (void) pthread_mutex_lock (&(g_engine.mutex));
+  assert (g_engine.refs_ > 0);
+  if (0 == --g_engine.refs_)
+    {
+      engine_teardown (&g_engine);
+    }
+  (void) pthread_mutex_unlock (&(g_engine.mutex));
+}
+
 /*@observer@*/ const char *
 httpsrc_curl_state_to_str (const httpsrc_curl_state_id_t a_state)
 {
@@ -279,6 +506,14 @@ httpsrc_curl_state_to_str (const httpsrc_curl_state_id_t a_state)
 #define URLTRANS_LOG_CBACK_END(ap_trans) \
   TRANS_LOG (ap_trans, TRANS_MSG_CBACK_END)
 
+static double
+now_ms (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
 static inline bool
 is_transfer_paused (tiz_urltrans_t * ap_trans)
 {
@@ -325,6 +560,8 @@ start_curl (tiz_urltrans_t * ap_trans)
   /* associate the processor with the curl handle */
   bail_on_curl_error (
     curl_easy_setopt (ap_trans->p_curl_, CURLOPT_PRIVATE, ap_trans));
+  bail_on_curl_error (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_SHARE, g_engine.p_share_));
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_USERAGENT,
                                         ap_trans->p_comp_name_));
   bail_on_curl_error (curl_easy_setopt (
@@ -360,8 +597,37 @@ start_curl (tiz_urltrans_t * ap_trans)
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
                                         ap_trans->p_uri_param_->contentURI));
 
-  bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_HTTPHEADER,
-                                        ap_trans->p_http_headers_));
+  if (ap_trans->revalidating_)
+    {
+      /* Only the status of the response matters */
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_NOBODY, 1));
+    }
+  else
+    {
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_HTTPGET, 1));
+    }
+
+  if (ap_trans->resuming_)
+    {
+      char range[32];
+      snprintf (range, sizeof (range), "%lu-",
+                (unsigned long) ap_trans->body_bytes_);
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_RANGE, range));
+      bail_on_curl_error (curl_easy_setopt (
+        ap_trans->p_curl_, CURLOPT_HTTPHEADER, ap_trans->p_resume_headers_));
+    }
+  else
+    {
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_RANGE, NULL));
+      bail_on_curl_error (curl_easy_setopt (
+        ap_trans->p_curl_, CURLOPT_HTTPHEADER,
+        ap_trans->revalidating_ ? ap_trans->p_resume_headers_
+                                : ap_trans->p_http_headers_));
+    }
 
   /* #ifdef _DEBUG */
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_VERBOSE, 1));
@@ -507,8 +773,10 @@ stop_curl_timer_watcher (tiz_urltrans_t * ap_trans)
   return rc;
 }
 
+/* The reconnect timer is one-shot; it is armed again, with a longer delay,
+   each time an attempt fails */
 static inline OMX_ERRORTYPE
-start_reconnect_timer_watcher (tiz_urltrans_t * ap_trans)
+start_reconnect_timer_watcher (tiz_urltrans_t * ap_trans, const double a_delay)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_trans);
@@ -518,12 +786,23 @@ start_reconnect_timer_watcher (tiz_urltrans_t * ap_trans)
     {
       ap_trans->awaiting_reconnect_timer_ev_ = true;
       rc = ap_trans->timer_cbacks_.pf_timer_start (
-        ap_trans->p_parent_, ap_trans->p_ev_reconnect_timer_,
-        ap_trans->reconnect_timeout_, ap_trans->reconnect_timeout_);
+        ap_trans->p_parent_, ap_trans->p_ev_reconnect_timer_, a_delay, 0.);
     }
   return rc;
 }
 
+static double
+reconnect_delay (const double a_base, const int a_attempt)
+{
+  double delay = a_base;
+  int i = 0;
+  for (i = 0; i < a_attempt && delay < URLTRANS_RECONNECT_MAX_DELAY; ++i)
+    {
+      delay *= 2;
+    }
+  return MIN (delay, URLTRANS_RECONNECT_MAX_DELAY);
+}
+
 static inline OMX_ERRORTYPE
 stop_reconnect_timer_watcher (tiz_urltrans_t * ap_trans)
 {
@@ -539,6 +818,17 @@ stop_reconnect_timer_watcher (tiz_urltrans_t * ap_trans)
   return rc;
 }
 
+/* Resources found in the disk cache are replayed a few chunks at a time, from
+   the curl timer, so that the parent's event loop keeps running */
+static inline OMX_ERRORTYPE
+schedule_cache_tick (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  (void) stop_curl_timer_watcher (ap_trans);
+  ap_trans->curl_timeout_ = 0;
+  return start_curl_timer_watcher (ap_trans);
+}
+
 static OMX_ERRORTYPE
 kickstart_curl_socket (tiz_urltrans_t * ap_trans, int * ap_running_handles)
 {
@@ -549,7 +839,7 @@ kickstart_curl_socket (tiz_urltrans_t * ap_trans, int * ap_running_handles)
       on_curl_multi_error_ret_omx_oom (curl_multi_socket_action (
         ap_trans->p_curl_multi_, CURL_SOCKET_TIMEOUT, 0, ap_running_handles));
     }
-  while (0 == ap_trans->curl_timeout_);
+  while (0 == ap_trans->curl_timeout_ && *ap_running_handles > 0);
 
   return OMX_ErrorNone;
 }
@@ -564,25 +854,23 @@ resume_curl (tiz_urltrans_t * ap_trans)
       int running_handles = 0;
 
       set_curl_state (ap_trans, ECurlStateTransfering);
+      if (ap_trans->serving_from_cache_)
+        {
+          return schedule_cache_tick (ap_trans);
+        }
       on_curl_error_ret_omx_oom (
         curl_easy_pause (ap_trans->p_curl_, CURLPAUSE_CONT));
-      if (ap_trans->curl_version_ < 0x072000)
+      if (ap_trans->curl_version_ < 0x072000 && ap_trans->sockfd_ > 0)
         {
-          /* USAGE WITH THE MULTI-SOCKET INTERFACE */
-          /* Before libcurl 7.32.0, when a specific handle was unpaused with
-             this function, there was no particular forced rechecking or
-             similar of the socket's state, which made the continuation of the
-             transfer get delayed until next multi-socket call invoke or even
-             longer. Alternatively, the user could forcibly call for example
-             curl_multi_socket_all(3) - with a rather hefty performance
-             penalty. */
-          /* Starting in libcurl 7.32.0, unpausing a transfer will schedule a
-             timeout trigger for that handle 1 millisecond into the future, so
-             that a curl_multi_socket_action( ... CURL_SOCKET_TIMEOUT) can be
-             used immediately afterwards to get the transfer going again as
-             desired.  */
-          on_curl_multi_error_ret_omx_oom (
-            curl_multi_socket_all (ap_trans->p_curl_multi_, &running_handles));
+          /* Before libcurl 7.32.0, unpausing a handle did not force a
+             re-check of its socket, and the transfer could stall until
+             something else woke up the multi handle. Rather than
+             curl_multi_socket_all(3), which walks every socket, poke only
+             this transfer's own socket. Since 7.32.0 unpausing schedules a
+             1 ms timeout, which kickstart_curl_socket below takes care of. */
+          on_curl_multi_error_ret_omx_oom (curl_multi_socket_action (
+            ap_trans->p_curl_multi_, ap_trans->sockfd_,
+            CURL_CSELECT_IN, &running_handles));
         }
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
     }
@@ -605,8 +893,20 @@ send_from_internal_buffer (tiz_urltrans_t * p_trans)
 {
   OMX_BUFFERHEADERTYPE * p_out = NULL;
   int nbytes_available = 0;
+  bool sent = false;
   assert (p_trans);
 
+  if (p_trans->rebuffering_)
+    {
+      if (!is_passed_buffer_high_watermark (p_trans))
+        {
+          /* The jitter buffer is being refilled */
+          return OMX_ErrorNone;
+        }
+      p_trans->rebuffering_ = false;
+      p_trans->internal_buffer_size_initial_ = 0;
+    }
+
   while (
     (nbytes_available = tiz_buffer_available (p_trans->p_store_)) > 0
     && (p_out = p_trans->buffer_cbacks_.pf_buf_emptied (p_trans->p_parent_))
@@ -621,6 +921,11 @@ send_from_internal_buffer (tiz_urltrans_t * p_trans)
       p_trans->buffer_cbacks_.pf_buf_filled (p_out, p_trans->p_parent_);
       (void) tiz_buffer_advance (p_trans->p_store_, nbytes_copied);
       p_out = NULL;
+      sent = true;
+    }
+  if (sent && p_trans->live_ && 0 == tiz_buffer_available (p_trans->p_store_))
+    {
+      p_trans->store_empty_ms_ = now_ms ();
     }
   return OMX_ErrorNone;
 }
@@ -632,22 +937,516 @@ reset_initial_buffer_size (tiz_urltrans_t * ap_trans)
   ap_trans->internal_buffer_size_initial_ = ap_trans->internal_buffer_size_;
 }
 
+static inline bool
+is_jitter_buffer_on (const tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  return (ap_trans->live_ && ap_trans->bytes_per_sec_ > 0);
+}
+
+static OMX_U32
+jitter_target_ms (const tiz_urltrans_t * ap_trans)
+{
+  double target = 0;
+  assert (ap_trans);
+  target
+    = ap_trans->jitter_min_ms_ + URLTRANS_JITTER_FACTOR * ap_trans->jitter_ms_;
+  return (OMX_U32) MIN (target, (double) ap_trans->jitter_max_ms_);
+}
+
+/* The store is paused at twice the target and resumed at the target, as with
+   a fixed size buffer */
+static void
+apply_jitter_target (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  assert (is_jitter_buffer_on (ap_trans));
+  ap_trans->internal_buffer_size_
+    = MAX (1, (int) ((double) jitter_target_ms (ap_trans)
+                     * ap_trans->bytes_per_sec_ / 1000));
+  if (ap_trans->rebuffering_ || ap_trans->internal_buffer_size_initial_ > 0)
+    {
+      reset_initial_buffer_size (ap_trans);
+    }
+}
+
+/* Estimate the network jitter from the arrival times of the chunks of a live
+   stream. The deficit is how far the transfer has fallen behind the stream's
+   own rate since curl was last unpaused; the estimate follows its peaks
+   quickly and decays slowly, and the target of the buffer follows the
+   estimate. A chunk that arrives after the parent has been starved for a
+   while is an underrun: the store is refilled up to the new target before
+   the parent gets any more data. */
+static void
+measure_arrival (tiz_urltrans_t * ap_trans, const size_t a_nbytes)
+{
+  const double now = now_ms ();
+
+  assert (ap_trans);
+
+  if (ap_trans->last_arrival_ms_ > 0)
+    {
+      const double gap = now - ap_trans->last_arrival_ms_;
+      const double expected = (double) ap_trans->last_chunk_bytes_ * 1000
+                              / ap_trans->bytes_per_sec_;
+      ap_trans->deficit_ms_ = MAX (0., ap_trans->deficit_ms_ + gap - expected);
+      if (ap_trans->deficit_ms_ > ap_trans->jitter_ms_)
+        {
+          ap_trans->jitter_ms_
+            += (ap_trans->deficit_ms_ - ap_trans->jitter_ms_) / 2;
+        }
+      else
+        {
+          ap_trans->jitter_ms_
+            -= ap_trans->jitter_ms_ * MIN (1., gap / URLTRANS_JITTER_DECAY_MS);
+        }
+
+      if (!ap_trans->rebuffering_
+          && 0 == tiz_buffer_available (ap_trans->p_store_)
+          && now - MAX (ap_trans->last_arrival_ms_, ap_trans->store_empty_ms_)
+               > URLTRANS_UNDERRUN_MS)
+        {
+          ++ap_trans->underruns_;
+          ap_trans->rebuffering_ = true;
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "Underrun after [%.0f] ms without data; jitter [%.0f] ms",
+                   now - MAX (ap_trans->last_arrival_ms_,
+                              ap_trans->store_empty_ms_),
+                   ap_trans->jitter_ms_);
+        }
+    }
+
+  ap_trans->last_arrival_ms_ = now;
+  ap_trans->last_chunk_bytes_ = a_nbytes;
+  apply_jitter_target (ap_trans);
+}
+
+static void
+close_cache_entry (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  if (ap_trans->p_cache_entry_)
+    {
+      tiz_urlcache_close (ap_trans->p_cache_, ap_trans->p_cache_entry_);
+      ap_trans->p_cache_entry_ = NULL;
+    }
+  ap_trans->serving_from_cache_ = false;
+}
+
+static void
+open_cache_entry (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  assert (!ap_trans->p_cache_entry_);
+  if (ap_trans->p_cache_
+      && OMX_ErrorNone
+           == tiz_urlcache_open (ap_trans->p_cache_,
+                                 (const char *) ap_trans->p_uri_param_
+                                   ->contentURI,
+                                 &(ap_trans->p_cache_entry_))
+      && tiz_urlcache_stored (ap_trans->p_cache_entry_) > 0)
+    {
+      const char * p_validator
+        = tiz_urlcache_validator (ap_trans->p_cache_entry_);
+      if (p_validator && *p_validator)
+        {
+          /* The entry is only replayed once the server has confirmed that
+             the resource has not changed since */
+          ap_trans->total_length_
+            = tiz_urlcache_length (ap_trans->p_cache_entry_);
+          snprintf (ap_trans->validator_, sizeof (ap_trans->validator_), "%s",
+                    p_validator);
+          ap_trans->revalidating_ = true;
+        }
+      else
+        {
+          /* No way to tell whether it is still current; it is fetched
+             again */
+          tiz_urlcache_discard (ap_trans->p_cache_entry_);
+        }
+    }
+}
+
+static void
+cache_data (tiz_urltrans_t * ap_trans, const void * ap_data,
+            const size_t a_nbytes)
+{
+  assert (ap_trans);
+  if (ap_trans->p_cache_entry_)
+    {
+      /* An entry only ever holds a prefix of the resource */
+      if (tiz_urlcache_stored (ap_trans->p_cache_entry_)
+            != ap_trans->body_bytes_
+          || OMX_ErrorNone
+               != tiz_urlcache_append (ap_trans->p_cache_entry_, ap_data,
+                                       a_nbytes))
+        {
+          close_cache_entry (ap_trans);
+        }
+    }
+}
+
+static void
+reset_resource (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  close_cache_entry (ap_trans);
+  if (ap_trans->p_headers_)
+    {
+      tiz_buffer_clear (ap_trans->p_headers_);
+    }
+  ap_trans->status_ = 0;
+  ap_trans->is_icy_ = false;
+  ap_trans->content_length_ = 0;
+  ap_trans->total_length_ = 0;
+  ap_trans->body_bytes_ = 0;
+  ap_trans->validator_[0] = '\0';
+  ap_trans->resuming_ = false;
+  ap_trans->revalidating_ = false;
+  ap_trans->resume_attempts_ = 0;
+  ap_trans->live_ = false;
+  ap_trans->jitter_ms_ = 0;
+  ap_trans->deficit_ms_ = 0;
+  ap_trans->last_arrival_ms_ = 0;
+  ap_trans->last_chunk_bytes_ = 0;
+  ap_trans->store_empty_ms_ = 0;
+  ap_trans->rebuffering_ = false;
+  ap_trans->underruns_ = 0;
+  ap_trans->reconnecting_ = false;
+  ap_trans->reconnect_attempts_ = 0;
+  ap_trans->lost_reports_ = 0;
+  ap_trans->reconnects_ = 0;
+}
+
+/* The headers of a request made on the condition that the resource is (or is
+   not) still the one the validator came from */
+static OMX_ERRORTYPE
+set_conditional_headers (tiz_urltrans_t * ap_trans, const char * ap_field)
+{
+  char condition[sizeof (ap_trans->validator_) + 32];
+
+  assert (ap_trans);
+  assert (ap_field);
+  assert (ap_trans->validator_[0]);
+
+  curl_slist_free_all (ap_trans->p_resume_headers_);
+  snprintf (condition, sizeof (condition), "%s: %s", ap_field,
+            ap_trans->validator_);
+  tiz_check_null_ret_oom ((ap_trans->p_resume_headers_ = curl_slist_append (
+                             NULL, "Icy-MetaData:0")));
+  tiz_check_null_ret_oom (
+    curl_slist_append (ap_trans->p_resume_headers_, condition));
+  return OMX_ErrorNone;
+}
+
+/* Restart the transfer with a range request for the part of the resource that
+   has not been delivered yet. Without a validator the part that is missing
+   can't be told to belong to the same resource, so this is never done
+   without one. */
+static OMX_ERRORTYPE
+resume_transfer (tiz_urltrans_t * ap_trans)
+{
+  int running_handles = 0;
+
+  assert (ap_trans);
+  assert (ap_trans->validator_[0]);
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Resuming [%s] at byte [%lu] of [%lu]",
+           ap_trans->p_uri_param_->contentURI,
+           (unsigned long) ap_trans->body_bytes_,
+           (unsigned long) ap_trans->total_length_);
+
+  (void) stop_curl_timer_watcher (ap_trans);
+  curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+  set_curl_state (ap_trans, ECurlStateStopped);
+
+  /* The server sends the whole resource if it has changed */
+  tiz_check_omx (set_conditional_headers (ap_trans, "If-Range"));
+  ap_trans->resuming_ = true;
+
+  tiz_check_omx (start_curl (ap_trans));
+  tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+  if (!running_handles)
+    {
+      ap_trans->curl_timeout_ = 0;
+      tiz_check_omx (start_curl_timer_watcher (ap_trans));
+    }
+  return OMX_ErrorNone;
+}
+
+/* Icecast and Shoutcast streams never end, so when one drops it is connected
+   to again without the parent knowing, while the parent keeps draining the
+   store. The attempts back off exponentially, and only when a few of them in
+   a row have failed is the parent told that the connection is lost. */
+static bool
+reconnect_transparently (tiz_urltrans_t * ap_trans)
+{
+  double delay = 0;
+
+  assert (ap_trans);
+
+  if (!ap_trans->live_ || !ap_trans->is_icy_ || 0 == ap_trans->body_bytes_
+      || ap_trans->reconnect_attempts_ >= URLTRANS_MAX_RECONNECT_ATTEMPTS)
+    {
+      return false;
+    }
+
+  delay = reconnect_delay (URLTRANS_RECONNECT_MIN_DELAY,
+                           ap_trans->reconnect_attempts_++);
+  TIZ_LOG (TIZ_PRIORITY_NOTICE,
+           "Lost [%s]; reconnecting in [%.2f] s with [%d] bytes buffered",
+           ap_trans->p_uri_param_->contentURI, delay,
+           tiz_buffer_available (ap_trans->p_store_));
+
+  (void) stop_curl_timer_watcher (ap_trans);
+  set_curl_state (ap_trans, ECurlStateStopped);
+  ap_trans->reconnecting_ = true;
+  /* Better to play what there is while the stream is away */
+  ap_trans->rebuffering_ = false;
+  ap_trans->internal_buffer_size_initial_ = 0;
+  send_from_internal_buffer (ap_trans);
+  return (OMX_ErrorNone == start_reconnect_timer_watcher (ap_trans, delay));
+}
+
+/* The server has answered the conditional request made for a disk cache
+   entry. The entry is replayed if the resource has not changed; otherwise it
+   is emptied and the resource is fetched again from the start. */
+static OMX_ERRORTYPE
+finish_revalidation (tiz_urltrans_t * ap_trans)
+{
+  int running_handles = 0;
+
+  assert (ap_trans);
+  assert (ap_trans->p_cache_entry_);
+
+  ap_trans->revalidating_ = false;
+  (void) stop_curl_timer_watcher (ap_trans);
+  curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+  set_curl_state (ap_trans, ECurlStateStopped);
+
+  if (304 == ap_trans->status_)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] : [%lu] of [%lu] bytes cached",
+               ap_trans->p_uri_param_->contentURI,
+               (unsigned long) tiz_urlcache_stored (ap_trans->p_cache_entry_),
+               (unsigned long) ap_trans->total_length_);
+      replay_cached_headers (ap_trans);
+      ap_trans->serving_from_cache_ = true;
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      return schedule_cache_tick (ap_trans);
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE,
+           "[%s] : cached copy not confirmed (status [%ld])",
+           ap_trans->p_uri_param_->contentURI, ap_trans->status_);
+  if (ap_trans->status_)
+    {
+      /* The server has answered; the entry is out of date. If the server
+         could not be reached, the entry stays until the new response
+         replaces it. */
+      tiz_urlcache_discard (ap_trans->p_cache_entry_);
+    }
+  ap_trans->total_length_ = 0;
+  ap_trans->validator_[0] = '\0';
+
+  tiz_check_omx (start_curl (ap_trans));
+  tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+  if (!running_handles)
+    {
+      ap_trans->curl_timeout_ = 0;
+      tiz_check_omx (start_curl_timer_watcher (ap_trans));
+    }
+  return OMX_ErrorNone;
+}
+
 static void
 report_connection_lost_event (tiz_urltrans_t * ap_trans)
 {
   bool auto_reconnect = false;
   assert (ap_trans);
+  if (ap_trans->revalidating_
+      && OMX_ErrorNone == finish_revalidation (ap_trans))
+    {
+      return;
+    }
+  if (ap_trans->body_bytes_ < ap_trans->total_length_
+      && ap_trans->validator_[0]
+      && ap_trans->resume_attempts_ < URLTRANS_MAX_RESUME_ATTEMPTS)
+    {
+      /* The connection dropped before the end of the resource; the parent
+         does not need to know about it */
+      ++ap_trans->resume_attempts_;
+      if (OMX_ErrorNone == resume_transfer (ap_trans))
+        {
+          return;
+        }
+    }
+  if (reconnect_transparently (ap_trans))
+    {
+      return;
+    }
+  close_cache_entry (ap_trans);
   stop_curl_timer_watcher (ap_trans);
   assert (ap_trans->info_cbacks_.pf_connection_lost);
   set_curl_state (ap_trans, ECurlStateStopped);
+  /* Whatever is left goes to the parent, and the headers of the next
+     connection too */
+  ap_trans->rebuffering_ = false;
+  ap_trans->reconnecting_ = false;
   send_from_internal_buffer (ap_trans);
   auto_reconnect
     = ap_trans->info_cbacks_.pf_connection_lost (ap_trans->p_parent_);
   reset_initial_buffer_size (ap_trans);
   if (auto_reconnect)
     {
-      (void) start_reconnect_timer_watcher (ap_trans);
+      const double delay = reconnect_delay (ap_trans->reconnect_timeout_,
+                                            ap_trans->lost_reports_++);
+      TIZ_PRINTF_RED ("\rFailed to connect to '%s'.",
+                      ap_trans->p_uri_param_->contentURI);
+      TIZ_PRINTF_RED ("Re-connecting in %.1f seconds.\n", delay);
+      (void) start_reconnect_timer_watcher (ap_trans, delay);
+    }
+}
+
+/* Returns false if the transfer has to be aborted */
+static bool
+on_headers_complete (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+
+  if (ap_trans->revalidating_
+      || (200 != ap_trans->status_ && 206 != ap_trans->status_))
+    {
+      /* e.g. a redirect, or an error that will end the transfer, or the
+         answer to a conditional request, which finish_revalidation deals
+         with */
+      return true;
+    }
+
+  if (ap_trans->resuming_)
+    {
+      if (200 == ap_trans->status_)
+        {
+          /* The resource has changed since (If-Range), or the server ignores
+             range requests. Either way the bytes already delivered can't be
+             joined to this response: the cached prefix goes, and the parent
+             is told that the connection is lost. */
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "[%s] : range not honoured after [%lu] bytes",
+                   ap_trans->p_uri_param_->contentURI,
+                   (unsigned long) ap_trans->body_bytes_);
+          if (ap_trans->p_cache_entry_)
+            {
+              tiz_urlcache_discard (ap_trans->p_cache_entry_);
+              close_cache_entry (ap_trans);
+            }
+          ap_trans->validator_[0] = '\0';
+          return false;
+        }
+    }
+  else if (ap_trans->reconnecting_)
+    {
+      /* The same live stream, picked up where it is now. Only the attempts
+         that get this far count as reconnections. */
+      ap_trans->reconnecting_ = false;
+      ++ap_trans->reconnects_;
     }
+  else
+    {
+      ap_trans->total_length_
+        = (200 == ap_trans->status_ && !ap_trans->is_icy_
+             ? ap_trans->content_length_
+             : 0);
+      if (ap_trans->p_cache_entry_)
+        {
+          /* Only resources with a known length and a validator are cached;
+             live streams are not, and neither are resources that could not
+             be revalidated */
+          if (!ap_trans->total_length_ || !ap_trans->validator_[0]
+              || tiz_buffer_push (ap_trans->p_headers_, "", 1) < 1
+              || OMX_ErrorNone
+                   != tiz_urlcache_reset (
+                        ap_trans->p_cache_entry_,
+                        tiz_buffer_get (ap_trans->p_headers_),
+                        ap_trans->total_length_, ap_trans->validator_))
+            {
+              close_cache_entry (ap_trans);
+            }
+        }
+      ap_trans->live_ = (0 == ap_trans->total_length_);
+      if (is_jitter_buffer_on (ap_trans))
+        {
+          /* The parent gets nothing until the buffer is primed */
+          ap_trans->rebuffering_ = true;
+          apply_jitter_target (ap_trans);
+        }
+    }
+  return true;
+}
+
+/* Returns false if the transfer has to be aborted */
+static bool
+parse_header (tiz_urltrans_t * ap_trans, const char * ap_header,
+              const size_t a_nbytes)
+{
+  char line[512];
+  size_t len = MIN (a_nbytes, sizeof (line) - 1);
+  const char * p_value = NULL;
+
+  assert (ap_trans);
+
+  memcpy (line, ap_header, len);
+  line[len] = '\0';
+  while (len > 0 && ('\r' == line[len - 1] || '\n' == line[len - 1]))
+    {
+      line[--len] = '\0';
+    }
+
+  if (0 == strncmp (line, "HTTP/", 5) || 0 == strncmp (line, "ICY ", 4))
+    {
+      /* The status line of a new response, maybe after a redirect */
+      p_value = strchr (line, ' ');
+      ap_trans->status_ = p_value ? strtol (p_value + 1, NULL, 10) : 0;
+      ap_trans->is_icy_ = ('I' == line[0]);
+      ap_trans->content_length_ = 0;
+      if (!ap_trans->resuming_ && !ap_trans->revalidating_)
+        {
+          ap_trans->validator_[0] = '\0';
+        }
+      tiz_buffer_clear (ap_trans->p_headers_);
+    }
+  else if (0 == len)
+    {
+      if (!on_headers_complete (ap_trans))
+        {
+          return false;
+        }
+    }
+  else if (!(p_value = strchr (line, ':')))
+    {
+      /* not a header field */
+    }
+  else if (0 == strncasecmp (line, "Content-Length:", 15))
+    {
+      ap_trans->content_length_ = strtoul (p_value + 1, NULL, 10);
+    }
+  else if (0 == strncasecmp (line, "icy-", 4))
+    {
+      ap_trans->is_icy_ = true;
+    }
+  else if (!ap_trans->resuming_ && !ap_trans->revalidating_
+           && ((0 == strncasecmp (line, "ETag:", 5)
+                && !strstr (p_value, "W/"))
+               || (0 == strncasecmp (line, "Last-Modified:", 14)
+                   && !ap_trans->validator_[0])))
+    {
+      /* Strong ETags are preferred over dates as If-Range validators */
+      snprintf (ap_trans->validator_, sizeof (ap_trans->validator_), "%s",
+                p_value + 1 + strspn (p_value + 1, " "));
+    }
+
+  (void) tiz_buffer_push (ap_trans->p_headers_, ap_header, a_nbytes);
+  return true;
 }
 
 /* This function gets called by libcurl as soon as it has received header
@@ -665,29 +1464,37 @@ curl_header_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
 {
   tiz_urltrans_t * p_trans = userdata;
   size_t nbytes = size * nmemb;
+  bool reconnecting = false;
   assert (p_trans);
   assert (p_trans->info_cbacks_.pf_header_avail);
   URLTRANS_LOG_CBACK_START (p_trans);
   stop_reconnect_timer_watcher (p_trans);
-  p_trans->info_cbacks_.pf_header_avail (p_trans->p_parent_, ptr, nbytes);
+  /* The end of the headers of a reconnection clears reconnecting_ */
+  reconnecting = p_trans->reconnecting_;
+  if (!parse_header (p_trans, ptr, nbytes))
+    {
+      nbytes = 0;
+    }
+  else if (!p_trans->resuming_ && !reconnecting && !p_trans->revalidating_)
+    {
+      /* The parent has already seen the headers of a resumed transfer, or of
+         a live stream that has been reconnected to, and it sees those of a
+         cache entry only once the entry is known to be current */
+      p_trans->info_cbacks_.pf_header_avail (p_trans->p_parent_, ptr, nbytes);
+    }
   URLTRANS_LOG_CBACK_END (p_trans);
   return nbytes;
 }
 
-/* This function gets called by libcurl as soon as there is data received that
-   needs to be saved. The size of the data pointed to by ptr is size multiplied
-   with nmemb, it will not be zero terminated. Return the number of bytes
-   actually taken care of. If that amount differs from the amount passed to
-   your function, it'll signal an error to the library. This will abort the
-   transfer and return CURLE_WRITE_ERROR.  */
+/* Hands data over to the parent, either straight into its buffers or through
+   the internal store. Returns CURL_WRITEFUNC_PAUSE if the data could not be
+   taken, in which case it has to be delivered again after the transfer is
+   resumed. */
 static size_t
-curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+deliver_data (tiz_urltrans_t * p_trans, void * ptr, size_t nbytes)
 {
-  tiz_urltrans_t * p_trans = userdata;
-  size_t nbytes = size * nmemb;
   size_t rc = nbytes;
   assert (p_trans);
-  URLTRANS_LOG_CBACK_START (p_trans);
 
   if (nbytes > 0)
     {
@@ -704,6 +1511,7 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
 
           rc = CURL_WRITEFUNC_PAUSE;
           set_curl_state (p_trans, ECurlStatePaused);
+          p_trans->last_arrival_ms_ = 0;
         }
       else
         {
@@ -712,6 +1520,7 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
             {
               /* Reset the cache size */
               p_trans->internal_buffer_size_initial_ = 0;
+              p_trans->rebuffering_ = false;
 
               send_from_internal_buffer (p_trans);
 
@@ -740,6 +1549,9 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
                                       tiz_buffer_available (p_trans->p_store_));
                   rc = CURL_WRITEFUNC_PAUSE;
                   set_curl_state (p_trans, ECurlStatePaused);
+                  /* The time spent paused is not network jitter */
+                  p_trans->last_arrival_ms_ = 0;
+                  p_trans->deficit_ms_ = 0;
                   /* Also stop the watchers */
                   stop_io_watcher (p_trans);
                   stop_curl_timer_watcher (p_trans);
@@ -761,10 +1573,109 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
         }
     }
 
+  return rc;
+}
+
+/* This function gets called by libcurl as soon as there is data received that
+   needs to be saved. The size of the data pointed to by ptr is size multiplied
+   with nmemb, it will not be zero terminated. Return the number of bytes
+   actually taken care of. If that amount differs from the amount passed to
+   your function, it'll signal an error to the library. This will abort the
+   transfer and return CURLE_WRITE_ERROR.  */
+static size_t
+curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  tiz_urltrans_t * p_trans = userdata;
+  size_t nbytes = size * nmemb;
+  size_t rc = nbytes;
+  assert (p_trans);
+  URLTRANS_LOG_CBACK_START (p_trans);
+
+  if (nbytes > 0)
+    {
+      if (is_jitter_buffer_on (p_trans))
+        {
+          measure_arrival (p_trans, nbytes);
+        }
+      if (CURL_WRITEFUNC_PAUSE == deliver_data (p_trans, ptr, nbytes))
+        {
+          /* libcurl will pass this same data again */
+          rc = CURL_WRITEFUNC_PAUSE;
+        }
+      else
+        {
+          cache_data (p_trans, ptr, nbytes);
+          p_trans->body_bytes_ += nbytes;
+          p_trans->resume_attempts_ = 0;
+          p_trans->reconnect_attempts_ = 0;
+          p_trans->lost_reports_ = 0;
+        }
+    }
+
   URLTRANS_LOG_CBACK_END (p_trans);
   return rc;
 }
 
+/* Deliver the next few chunks of the part of the resource found in the disk
+   cache. Once that is all delivered, the resource is either complete or the
+   rest of it is requested from the server. */
+static OMX_ERRORTYPE
+serve_from_cache (tiz_urltrans_t * ap_trans)
+{
+  char buf[URLTRANS_CACHE_READ_BYTES];
+  size_t served = 0;
+  size_t nbytes = 0;
+
+  assert (ap_trans);
+  assert (ap_trans->p_cache_entry_);
+
+  while (served < URLTRANS_CACHE_TICK_BYTES
+         && (nbytes = tiz_urlcache_read (ap_trans->p_cache_entry_,
+                                         ap_trans->body_bytes_, buf,
+                                         sizeof (buf)))
+              > 0)
+    {
+      if (CURL_WRITEFUNC_PAUSE == deliver_data (ap_trans, buf, nbytes))
+        {
+          /* tiz_urltrans_on_buffers_ready takes it from here */
+          return OMX_ErrorNone;
+        }
+      ap_trans->body_bytes_ += nbytes;
+      served += nbytes;
+    }
+
+  if (nbytes > 0)
+    {
+      return schedule_cache_tick (ap_trans);
+    }
+
+  ap_trans->serving_from_cache_ = false;
+  if (ap_trans->body_bytes_ < ap_trans->total_length_
+      && ap_trans->validator_[0])
+    {
+      return resume_transfer (ap_trans);
+    }
+  report_connection_lost_event (ap_trans);
+  return OMX_ErrorNone;
+}
+
+static void
+replay_cached_headers (tiz_urltrans_t * ap_trans)
+{
+  const char * p_header = NULL;
+  assert (ap_trans);
+  assert (ap_trans->p_cache_entry_);
+  p_header = tiz_urlcache_headers (ap_trans->p_cache_entry_);
+  while (p_header && *p_header)
+    {
+      const char * p_eol = strchr (p_header, '\n');
+      size_t len = p_eol ? (size_t) (p_eol - p_header) + 1 : strlen (p_header);
+      ap_trans->info_cbacks_.pf_header_avail (ap_trans->p_parent_, p_header,
+                                              len);
+      p_header += len;
+    }
+}
+
 /* #ifdef _DEBUG */
 /* Pass a pointer to a function that matches the following prototype: int
    curl_debug_callback (CURL *, curl_infotype, char *, size_t, void *);
@@ -903,17 +1814,6 @@ curl_timer_cback (CURLM * multi, long timeout_ms, void * userp)
   return 0;
 }
 
-static OMX_ERRORTYPE
-allocate_curl_global_resources (tiz_urltrans_t * ap_trans)
-{
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  bail_on_curl_error (curl_global_init (CURL_GLOBAL_ALL));
-  /* All well */
-  rc = OMX_ErrorNone;
-end:
-  return rc;
-}
-
 static OMX_ERRORTYPE
 allocate_temp_data_store (tiz_urltrans_t * ap_trans)
 {
@@ -977,20 +1877,14 @@ static OMX_ERRORTYPE
 allocate_curl_resources (tiz_urltrans_t * ap_trans)
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  curl_version_info_data * p_version_info = NULL;
 
   assert (!ap_trans->p_curl_);
   assert (!ap_trans->p_curl_multi_);
+  assert (!ap_trans->engine_acquired_);
 
-  tiz_check_omx (allocate_curl_global_resources (ap_trans));
-
-  TIZ_LOG (TIZ_PRIORITY_DEBUG, "%s", curl_version ());
-
-  p_version_info = curl_version_info (CURLVERSION_NOW);
-  if (p_version_info)
-    {
-      ap_trans->curl_version_ = p_version_info->version_num;
-    }
+  tiz_check_omx (acquire_engine ());
+  ap_trans->engine_acquired_ = true;
+  ap_trans->curl_version_ = g_engine.curl_version_;
 
   /* Init the curl easy handle */
   tiz_check_null_ret_oom ((ap_trans->p_curl_ = curl_easy_init ()));
@@ -1025,10 +1919,101 @@ destroy_curl_resources (tiz_urltrans_t * ap_trans)
   ap_trans->p_http_ok_aliases_ = NULL;
   curl_slist_free_all (ap_trans->p_http_headers_);
   ap_trans->p_http_headers_ = NULL;
+  curl_slist_free_all (ap_trans->p_resume_headers_);
+  ap_trans->p_resume_headers_ = NULL;
   curl_multi_cleanup (ap_trans->p_curl_multi_);
   ap_trans->p_curl_multi_ = NULL;
   curl_easy_cleanup (ap_trans->p_curl_);
   ap_trans->p_curl_ = NULL;
+  if (ap_trans->engine_acquired_)
+    {
+      /* The easy handle must be gone before the share object goes */
+      release_engine ();
+      ap_trans->engine_acquired_ = false;
+    }
+}
+
+/* The disk cache is configured per component, in the plugins section of
+   tizonia.conf; it is disabled unless a size is given. Failing to set it up
+   is not an error: the transfer just goes without it. */
+static void
+allocate_disk_cache (tiz_urltrans_t * ap_trans)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE + 32];
+  char dir[PATH_MAX];
+  const char * p_value = NULL;
+  long size_mb = 0;
+
+  assert (ap_trans);
+  assert (!ap_trans->p_cache_);
+
+  snprintf (key, sizeof (key), "%s.disk_cache_size_mb",
+            ap_trans->p_comp_name_);
+  if (!(p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key))
+      || (size_mb = strtol (p_value, NULL, 10)) <= 0)
+    {
+      return;
+    }
+
+  snprintf (key, sizeof (key), "%s.disk_cache_dir", ap_trans->p_comp_name_);
+  if ((p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key)))
+    {
+      snprintf (dir, sizeof (dir), "%s", p_value);
+    }
+  else if ((p_value = getenv ("XDG_CACHE_HOME")) && p_value[0])
+    {
+      snprintf (dir, sizeof (dir), "%s/" URLTRANS_CACHE_DEFAULT_DIR, p_value);
+    }
+  else if ((p_value = getenv ("HOME")))
+    {
+      snprintf (dir, sizeof (dir), "%s/.cache/" URLTRANS_CACHE_DEFAULT_DIR,
+                p_value);
+    }
+  else
+    {
+      return;
+    }
+
+  if (OMX_ErrorNone
+      != tiz_urlcache_init (&(ap_trans->p_cache_), dir,
+                            (size_t) size_mb * 1024 * 1024))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to use [%s] as disk cache", dir);
+      ap_trans->p_cache_ = NULL;
+    }
+}
+
+static OMX_U32
+jitter_limit_ms (const tiz_urltrans_t * ap_trans, const char * ap_key,
+                 const OMX_U32 a_default)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE + 32];
+  const char * p_value = NULL;
+  long value = 0;
+
+  assert (ap_trans);
+
+  snprintf (key, sizeof (key), "%s.%s", ap_trans->p_comp_name_, ap_key);
+  if ((p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key))
+      && (value = strtol (p_value, NULL, 10)) > 0)
+    {
+      return (OMX_U32) value;
+    }
+  return a_default;
+}
+
+/* The limits of the jitter buffer's target are configured per component, in
+   the plugins section of tizonia.conf */
+static void
+configure_jitter_buffer (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  ap_trans->jitter_min_ms_ = jitter_limit_ms (
+    ap_trans, "jitter_buffer_min_ms", URLTRANS_JITTER_DEFAULT_MIN_MS);
+  ap_trans->jitter_max_ms_
+    = MAX (ap_trans->jitter_min_ms_,
+           jitter_limit_ms (ap_trans, "jitter_buffer_max_ms",
+                            URLTRANS_JITTER_DEFAULT_MAX_MS));
 }
 
 OMX_ERRORTYPE
@@ -1089,15 +2074,28 @@ tiz_urltrans_init (tiz_urltrans_ptr_t * app_trans, void * ap_parent,
           p_trans->p_http_headers_ = NULL;
           p_trans->curl_state_ = ECurlStateStopped;
           p_trans->curl_version_ = 0;
+          p_trans->engine_acquired_ = false;
+          p_trans->p_headers_ = NULL;
+          p_trans->p_resume_headers_ = NULL;
+          p_trans->p_cache_ = NULL;
+          p_trans->p_cache_entry_ = NULL;
+          p_trans->bytes_per_sec_ = 0;
+          reset_resource (p_trans);
+          configure_jitter_buffer (p_trans);
 
           rc = allocate_temp_data_store (p_trans);
           goto_end_on_omx_error (rc, "Unable to alloc the data store");
 
+          rc = tiz_buffer_init (&(p_trans->p_headers_), 1024);
+          goto_end_on_omx_error (rc, "Unable to alloc the header store");
+
           rc = allocate_events (p_trans);
           goto_end_on_omx_error (rc, "Unable to alloc the timer events");
 
           rc = allocate_curl_resources (p_trans);
           goto_end_on_omx_error (rc, "Unable to alloc the timer events");
+
+          allocate_disk_cache (p_trans);
         }
 
     end:
@@ -1117,10 +2115,13 @@ tiz_urltrans_destroy (tiz_urltrans_t * ap_trans)
 {
   if (ap_trans)
     {
+      close_cache_entry (ap_trans);
+      tiz_urlcache_destroy (ap_trans->p_cache_);
+      tiz_buffer_destroy (ap_trans->p_headers_);
       destroy_temp_data_store (ap_trans);
       destroy_events (ap_trans);
       destroy_curl_resources (ap_trans);
-      curl_global_cleanup ();
+      free (ap_trans);
     }
 }
 
@@ -1133,6 +2134,7 @@ tiz_urltrans_set_uri (tiz_urltrans_t * ap_trans,
   URLTRANS_LOG_API_START (ap_trans);
   ap_trans->p_uri_param_ = ap_uri_param;
   curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+  reset_resource (ap_trans);
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
                                         ap_trans->p_uri_param_->contentURI));
   set_curl_state (ap_trans, ECurlStateStopped);
@@ -1160,6 +2162,23 @@ tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
   URLTRANS_LOG_API_START (ap_trans);
   ap_trans->internal_buffer_size_ = ap_trans->internal_buffer_size_initial_
     = a_nbytes;
+  if (is_jitter_buffer_on (ap_trans))
+    {
+      apply_jitter_target (ap_trans);
+    }
+}
+
+void
+tiz_urltrans_set_stream_rate (tiz_urltrans_t * ap_trans,
+                              const OMX_U32 a_bytes_per_sec)
+{
+  assert (ap_trans);
+  URLTRANS_LOG_API_START (ap_trans);
+  ap_trans->bytes_per_sec_ = a_bytes_per_sec;
+  if (is_jitter_buffer_on (ap_trans))
+    {
+      apply_jitter_target (ap_trans);
+    }
 }
 
 OMX_ERRORTYPE
@@ -1168,13 +2187,39 @@ tiz_urltrans_start (tiz_urltrans_t * ap_trans)
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
-  if (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans))
+  if (is_transfer_stopped (ap_trans))
+    {
+      /* A transfer from the start of the resource */
+      reset_resource (ap_trans);
+      open_cache_entry (ap_trans);
+      if (ap_trans->revalidating_)
+        {
+          /* A strong ETag is quoted; anything else is a date */
+          tiz_check_omx (set_conditional_headers (
+            ap_trans, '"' == ap_trans->validator_[0] ? "If-None-Match"
+                                                     : "If-Modified-Since"));
+        }
+    }
+  if (ap_trans->serving_from_cache_)
+    {
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      tiz_check_omx (schedule_cache_tick (ap_trans));
+    }
+  else if (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans))
     {
       int running_handles = 0;
       tiz_check_omx (start_curl (ap_trans));
       assert (ap_trans->p_curl_multi_);
       /* Kickstart curl to get one or more callbacks called. */
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+      if (!running_handles)
+        {
+          /* The whole transfer completed right here, which may happen over a
+             re-used connection. Let the curl timer report the end of it,
+             rather than calling the parent back from within this call. */
+          ap_trans->curl_timeout_ = 0;
+          tiz_check_omx (start_curl_timer_watcher (ap_trans));
+        }
     }
   URLTRANS_LOG_API_END (ap_trans);
   ASSERT_ASYNC_EVENTS (ap_trans);
@@ -1215,6 +2260,7 @@ tiz_urltrans_cancel (tiz_urltrans_t * ap_trans)
   URLTRANS_LOG_API_START (ap_trans);
   tiz_urltrans_pause (ap_trans);
   set_curl_state (ap_trans, ECurlStateStopped);
+  close_cache_entry (ap_trans);
   if (ap_trans->p_curl_multi_)
     {
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
@@ -1284,7 +2330,7 @@ tiz_urltrans_on_io_ready (tiz_urltrans_t * ap_trans, tiz_event_io_t * ap_ev_io,
             ap_trans->p_curl_multi_, ap_trans->sockfd_, curl_ev_bitmask,
             &running_handles));
         }
-      while (0 == ap_trans->curl_timeout_);
+      while (0 == ap_trans->curl_timeout_ && running_handles > 0);
 
       if (!running_handles)
         {
@@ -1318,7 +2364,11 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
   if (ap_trans->awaiting_curl_timer_ev_
       && ap_ev_timer == ap_trans->p_ev_curl_timer_)
     {
-      if (is_transfer_running (ap_trans))
+      if (is_transfer_running (ap_trans) && ap_trans->serving_from_cache_)
+        {
+          tiz_check_omx (serve_from_cache (ap_trans));
+        }
+      else if (is_transfer_running (ap_trans))
         {
           tiz_check_omx (
             kickstart_curl_socket (ap_trans, &running_handles));
@@ -1338,13 +2388,15 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
   else if (ap_trans->awaiting_reconnect_timer_ev_
            && ap_ev_timer == ap_trans->p_ev_reconnect_timer_)
     {
-      TIZ_PRINTF_RED ("\rFailed to connect to '%s'.",
-                      ap_trans->p_uri_param_->contentURI);
-      TIZ_PRINTF_RED ("Re-connecting in %.1f seconds.\n",
-                      ap_trans->reconnect_timeout_);
+      ap_trans->awaiting_reconnect_timer_ev_ = false;
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
       start_curl (ap_trans);
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+      if (!running_handles)
+        {
+          /* Failed already; the timer is armed again from here */
+          report_connection_lost_event (ap_trans);
+        }
     }
   URLTRANS_LOG_API_END (ap_trans);
   ASSERT_ASYNC_EVENTS (ap_trans);
@@ -1361,3 +2413,43 @@ tiz_urltrans_bytes_available (tiz_urltrans_t * ap_trans)
     }
   return 0;
 }
+
+void
+tiz_urltrans_get_buffer_health (const tiz_urltrans_t * ap_trans,
+                                tiz_urltrans_buffer_health_t * ap_health)
+{
+  OMX_U32 level = 0;
+  assert (ap_trans);
+  assert (ap_health);
+  level = (ap_trans->p_store_ ? tiz_buffer_available (ap_trans->p_store_) : 0);
+  ap_health->level_bytes = level;
+  ap_health->level_ms
+    = (ap_trans->bytes_per_sec_ > 0
+         ? (OMX_U32) ((double) level * 1000 / ap_trans->bytes_per_sec_)
+         : 0);
+  ap_health->target_ms
+    = (is_jitter_buffer_on (ap_trans) ? jitter_target_ms (ap_trans) : 0);
+  ap_health->jitter_ms = (OMX_U32) ap_trans->jitter_ms_;
+  ap_health->underruns = ap_trans->underruns_;
+  ap_health->reconnects = ap_trans->reconnects_;
+}
+
+void
+tiz_urltrans_get_buffer_health_config (
+  const tiz_urltrans_t * ap_trans,
+  OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE * ap_health)
+{
+  tiz_urltrans_buffer_health_t health;
+  assert (ap_health);
+  memset (&health, 0, sizeof (health));
+  if (ap_trans)
+    {
+      tiz_urltrans_get_buffer_health (ap_trans, &health);
+    }
+  ap_health->nLevelBytes = health.level_bytes;
+  ap_health->nLevelMs = health.level_ms;
+  ap_health->nTargetMs = health.target_ms;
+  ap_health->nJitterMs = health.jitter_ms;
+  ap_health->nUnderruns = health.underruns;
+  ap_health->nReconnects = health.reconnects;
+}
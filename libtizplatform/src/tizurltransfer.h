@@ -44,6 +44,7 @@ extern "C" {
  */
 
 #include <OMX_Component.h>
+#include <OMX_TizoniaExt.h>
 
 typedef struct tiz_urltrans tiz_urltrans_t;
 typedef /*@null@ */ tiz_urltrans_t * tiz_urltrans_ptr_t;
@@ -254,6 +255,30 @@ struct tiz_urltrans_event_timer_cbacks
   tiz_urltrans_event_timer_restart_f pf_timer_restart;
 };
 
+/**
+*@brief Buffer health information (typedef).
+*@ingroup tizurltransfer
+*/
+typedef struct tiz_urltrans_buffer_health tiz_urltrans_buffer_health_t;
+
+/**
+ * @brief Buffer health information.
+ * The state of the data kept ahead of the parent. The target and the jitter
+ * estimate are only maintained for live streams whose rate is known (see
+ * tiz_urltrans_set_stream_rate). The counters are reset when a new resource is
+ * started.
+ * @ingroup tizurltransfer
+ */
+struct tiz_urltrans_buffer_health
+{
+  OMX_U32 level_bytes;
+  OMX_U32 level_ms;
+  OMX_U32 target_ms;
+  OMX_U32 jitter_ms;
+  OMX_U32 underruns;
+  OMX_U32 reconnects;
+};
+
 /**
  * Initialize a new URI file transfer object.
  *
@@ -307,6 +332,10 @@ void
 tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
                                        const int a_nbytes);
 
+void
+tiz_urltrans_set_stream_rate (tiz_urltrans_t * ap_trans,
+                              const OMX_U32 a_bytes_per_sec);
+
 OMX_ERRORTYPE
 tiz_urltrans_start (tiz_urltrans_t * ap_trans);
 
@@ -336,6 +365,22 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
 OMX_U32
 tiz_urltrans_bytes_available (tiz_urltrans_t * ap_trans);
 
+void
+tiz_urltrans_get_buffer_health (const tiz_urltrans_t * ap_trans,
+                                tiz_urltrans_buffer_health_t * ap_health);
+
+/**
+ * Fill the buffer health config structure of a source component
+ * (OMX_TizoniaIndexConfigAudioSourceBufferHealth). A processor that has no
+ * transfer yet (ap_trans is NULL) reports zeros.
+ *
+ * @ingroup tizurltransfer
+ */
+void
+tiz_urltrans_get_buffer_health_config (
+  const tiz_urltrans_t * ap_trans,
+  OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE * ap_health);
+
 #ifdef __cplusplus
 }
 #endif
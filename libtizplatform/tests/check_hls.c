@@ -0,0 +1,365 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_hls.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  HLS segmenter API unit tests
+ *
+ *
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HLS_TEST_MAX_ENTRIES 16
+#define HLS_TEST_ID3_BYTES 73
+
+/* MPEG-1 Layer III, 128 kbit/s, joint stereo: 1152 samples per frame */
+#define HLS_TEST_FRAME_44K {0xFF, 0xFB, 0x90, 0x44}
+#define HLS_TEST_FRAME_48K {0xFF, 0xFB, 0x94, 0x44}
+
+typedef struct hls_test_entry hls_test_entry_t;
+struct hls_test_entry
+{
+  double duration;
+  bool discontinuity;
+  char uri[64];
+};
+
+typedef struct hls_test_playlist hls_test_playlist_t;
+struct hls_test_playlist
+{
+  int version;
+  int target;
+  int media_seq;
+  int disc_seq;
+  int nentries;
+  hls_test_entry_t entries[HLS_TEST_MAX_ENTRIES];
+};
+
+static bool
+hls_test_near (const double a_duration, const double a_expected)
+{
+  return (a_duration - a_expected < 0.001 && a_expected - a_duration < 0.001);
+}
+
+/* A strict parser for the subset of the media playlist syntax the segmenter
+ * is expected to produce */
+static bool
+hls_test_parse (const char * ap_text, hls_test_playlist_t * ap_list)
+{
+  const char * p_line = ap_text;
+  bool in_entry = false;
+  bool disc = false;
+  double duration = 0;
+  int nlines = 0;
+
+  memset (ap_list, 0, sizeof (*ap_list));
+  ap_list->version = ap_list->target = ap_list->media_seq = -1;
+  ap_list->disc_seq = 0;
+
+  while (p_line && *p_line)
+    {
+      const char * p_eol = strchr (p_line, '\n');
+      char line[128];
+      size_t len = 0;
+      if (!p_eol)
+        {
+          return false; /* every line is terminated */
+        }
+      len = p_eol - p_line;
+      if (len == 0 || len >= sizeof (line))
+        {
+          return false;
+        }
+      memcpy (line, p_line, len);
+      line[len] = '\0';
+      p_line = p_eol + 1;
+
+      if (nlines++ == 0)
+        {
+          if (strcmp (line, "#EXTM3U") != 0)
+            {
+              return false;
+            }
+        }
+      else if (sscanf (line, "#EXT-X-VERSION:%d", &ap_list->version) == 1
+               || sscanf (line, "#EXT-X-TARGETDURATION:%d", &ap_list->target)
+                    == 1
+               || sscanf (line, "#EXT-X-MEDIA-SEQUENCE:%d",
+                          &ap_list->media_seq)
+                    == 1
+               || sscanf (line, "#EXT-X-DISCONTINUITY-SEQUENCE:%d",
+                          &ap_list->disc_seq)
+                    == 1)
+        {
+          if (ap_list->nentries > 0 || in_entry)
+            {
+              return false; /* playlist tags come first */
+            }
+        }
+      else if (strcmp (line, "#EXT-X-DISCONTINUITY") == 0)
+        {
+          disc = true;
+        }
+      else if (sscanf (line, "#EXTINF:%lf,", &duration) == 1)
+        {
+          if (in_entry || line[len - 1] != ',')
+            {
+              return false;
+            }
+          in_entry = true;
+        }
+      else if (line[0] == '#')
+        {
+          return false;
+        }
+      else
+        {
+          hls_test_entry_t * p_entry = NULL;
+          if (!in_entry || ap_list->nentries == HLS_TEST_MAX_ENTRIES
+              || len >= sizeof (p_entry->uri))
+            {
+              return false;
+            }
+          p_entry = &ap_list->entries[ap_list->nentries++];
+          p_entry->duration = duration;
+          p_entry->discontinuity = disc;
+          strcpy (p_entry->uri, line);
+          in_entry = disc = false;
+        }
+    }
+
+  return (!in_entry && !disc && ap_list->version == 3 && ap_list->target > 0
+          && ap_list->media_seq >= 0);
+}
+
+static OMX_U64
+hls_test_pts (const tiz_hls_segment_t * ap_seg)
+{
+  const unsigned char * p_data = tiz_hls_segment_data (ap_seg);
+  const char owner[] = "com.apple.streaming.transportStreamTimestamp";
+  OMX_U64 pts = 0;
+  int i = 0;
+
+  fail_if (tiz_hls_segment_len (ap_seg) < HLS_TEST_ID3_BYTES);
+  fail_if (memcmp (p_data, "ID3\x04\x00\x00\x00\x00\x00\x3F", 10) != 0);
+  fail_if (memcmp (p_data + 10, "PRIV\x00\x00\x00\x35\x00\x00", 10) != 0);
+  fail_if (memcmp (p_data + 20, owner, sizeof (owner)) != 0);
+  for (i = 0; i < 8; ++i)
+    {
+      pts = (pts << 8) | p_data[20 + sizeof (owner) + i];
+    }
+  /* The audio starts right after the tag */
+  fail_if (p_data[HLS_TEST_ID3_BYTES] != 0xFF);
+  return pts;
+}
+
+/* Write a number of frames, in chunks of awkward sizes */
+static void
+hls_test_write_frames (tiz_hls_t * ap_hls, const unsigned char * ap_hdr,
+                       const size_t a_frame_len, const int a_nframes)
+{
+  unsigned char * p_buf = NULL;
+  size_t total = a_frame_len * a_nframes;
+  size_t pos = 0;
+  int i = 0;
+
+  p_buf = calloc (1, total);
+  fail_if (NULL == p_buf);
+  for (i = 0; i < a_nframes; ++i)
+    {
+      memcpy (p_buf + i * a_frame_len, ap_hdr, 4);
+    }
+  while (pos < total)
+    {
+      const size_t n = MIN (total - pos, (size_t) (pos % 997) + 1);
+      fail_if (OMX_ErrorNone != tiz_hls_write (ap_hls, p_buf + pos, n));
+      pos += n;
+    }
+  free (p_buf);
+}
+
+START_TEST (test_hls_init_and_destroy)
+{
+  tiz_hls_t * p_hls = NULL;
+  hls_test_playlist_t list;
+
+  fail_if (OMX_ErrorBadParameter != tiz_hls_init (&p_hls, "stream", 0, 3));
+  fail_if (OMX_ErrorBadParameter != tiz_hls_init (&p_hls, "stream", 2000, 0));
+
+  fail_if (OMX_ErrorNone != tiz_hls_init (&p_hls, "stream", 2000, 3));
+  fail_if (NULL == p_hls);
+
+  /* An empty but valid playlist before any audio arrives */
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (0 != list.nentries);
+  fail_if (2 != list.target);
+  fail_if (0 != list.media_seq);
+  fail_if (0 != tiz_hls_duration_ms (p_hls));
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "stream-0.mp3"));
+
+  /* Garbage alone produces nothing */
+  fail_if (OMX_ErrorNone != tiz_hls_write (p_hls, "\xFF\xFB garbage", 10));
+  fail_if (OMX_ErrorNone != tiz_hls_flush (p_hls));
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (0 != list.nentries);
+
+  tiz_hls_destroy (p_hls);
+}
+END_TEST
+
+START_TEST (test_hls_rolling_window)
+{
+  const unsigned char hdr[4] = HLS_TEST_FRAME_44K;
+  const double frame_s = 1152.0 / 44100;
+  tiz_hls_t * p_hls = NULL;
+  tiz_hls_segment_t * p_seg = NULL;
+  hls_test_playlist_t list;
+  OMX_U64 last_pts = 0;
+  int i = 0;
+
+  fail_if (OMX_ErrorNone != tiz_hls_init (&p_hls, "stream", 2500, 3));
+
+  /* Until the first segment is complete, the playlist is empty */
+  hls_test_write_frames (p_hls, hdr, 417, 50);
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (0 != list.nentries);
+  fail_if (0 != list.media_seq);
+  tiz_hls_destroy (p_hls);
+  fail_if (OMX_ErrorNone != tiz_hls_init (&p_hls, "stream", 2500, 3));
+
+  /* Leading junk, e.g. an ID3 tag, must be skipped */
+  fail_if (OMX_ErrorNone != tiz_hls_write (p_hls, "ID3\x03junk\xFF\xFF", 10));
+
+  /* 2.5 s is 95.7 frames, so segments are 96 frames long; 400 frames make
+     four of them and leave 16 frames in progress */
+  hls_test_write_frames (p_hls, hdr, 417, 400);
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (3 != list.target);
+  fail_if (1 != list.media_seq);
+  fail_if (3 != list.nentries);
+  fail_if (0 != list.disc_seq);
+  fail_if (llabs ((long long) tiz_hls_duration_ms (p_hls)
+                  - (long long) (400 * frame_s * 1000))
+           > 1);
+
+  for (i = 0; i < list.nentries; ++i)
+    {
+      char uri[80];
+      OMX_U64 pts = 0;
+      fail_if (!hls_test_near (list.entries[i].duration, 96 * frame_s));
+      fail_if ((int) (list.entries[i].duration + 0.5) > list.target);
+      fail_if (list.entries[i].discontinuity);
+
+      snprintf (uri, sizeof (uri), "stream-%d.mp3", list.media_seq + i);
+      fail_if (0 != strcmp (uri, list.entries[i].uri));
+
+      /* Segments are found by name, whatever the path */
+      snprintf (uri, sizeof (uri), "/radio/%s", list.entries[i].uri);
+      p_seg = tiz_hls_get_segment (p_hls, uri);
+      fail_if (NULL == p_seg);
+      fail_if (HLS_TEST_ID3_BYTES + 96 * 417
+               != tiz_hls_segment_len (p_seg));
+      pts = hls_test_pts (p_seg);
+      fail_if ((list.media_seq + i) * 96 * 1152 * 90000ULL / 44100 != pts);
+      fail_if (i > 0 && pts <= last_pts);
+      last_pts = pts;
+      tiz_hls_put_segment (p_seg);
+    }
+
+  /* The segment that just left the playlist is still served; bad names are
+     not */
+  p_seg = tiz_hls_get_segment (p_hls, "stream-0.mp3");
+  fail_if (NULL == p_seg);
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "stream-4.mp3"));
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "other-1.mp3"));
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "stream-1.ts"));
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "stream-.mp3"));
+
+  /* Keep producing until segment 0 is evicted; the reference keeps it
+     alive */
+  hls_test_write_frames (p_hls, hdr, 417, 96 * 4);
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (5 != list.media_seq);
+  fail_if (3 != list.nentries);
+  fail_if (NULL != tiz_hls_get_segment (p_hls, "stream-2.mp3"));
+  fail_if (0 != hls_test_pts (p_seg));
+  tiz_hls_put_segment (p_seg);
+
+  /* A flush publishes the short segment in progress */
+  fail_if (OMX_ErrorNone != tiz_hls_flush (p_hls));
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (6 != list.media_seq);
+  fail_if (!hls_test_near (list.entries[2].duration, 16 * frame_s));
+
+  tiz_hls_destroy (p_hls);
+}
+END_TEST
+
+START_TEST (test_hls_discontinuity)
+{
+  const unsigned char hdr44[4] = HLS_TEST_FRAME_44K;
+  const unsigned char hdr48[4] = HLS_TEST_FRAME_48K;
+  tiz_hls_t * p_hls = NULL;
+  tiz_hls_segment_t * p_seg = NULL;
+  hls_test_playlist_t list;
+  int i = 0;
+
+  fail_if (OMX_ErrorNone != tiz_hls_init (&p_hls, "live", 1000, 4));
+
+  /* 50 frames at 44.1 kHz: one full segment (39 frames) and a short one,
+     closed early by the switch to 48 kHz */
+  hls_test_write_frames (p_hls, hdr44, 417, 50);
+  hls_test_write_frames (p_hls, hdr48, 384, 84);
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (4 != list.nentries);
+  fail_if (0 != list.media_seq);
+  fail_if (0 != list.disc_seq);
+  fail_if (1 != list.target);
+  fail_if (list.entries[0].discontinuity || list.entries[1].discontinuity);
+  fail_if (!list.entries[2].discontinuity);
+  fail_if (list.entries[3].discontinuity);
+  fail_if (!hls_test_near (list.entries[1].duration, 11 * 1152.0 / 44100));
+  fail_if (!hls_test_near (list.entries[2].duration, 42 * 1152.0 / 48000));
+
+  /* The timestamps carry on across the switch */
+  p_seg = tiz_hls_get_segment (p_hls, list.entries[2].uri);
+  fail_if (NULL == p_seg);
+  fail_if (50 * 1152 * 90000ULL / 44100 != hls_test_pts (p_seg));
+  tiz_hls_put_segment (p_seg);
+
+  /* Once the discontinuous segment has slid out of the window, the
+     discontinuity sequence accounts for it */
+  hls_test_write_frames (p_hls, hdr48, 384, 42 * 3);
+  fail_if (!hls_test_parse (tiz_hls_playlist (p_hls), &list));
+  fail_if (3 != list.media_seq);
+  fail_if (1 != list.disc_seq);
+  for (i = 0; i < list.nentries; ++i)
+    {
+      fail_if (list.entries[i].discontinuity);
+    }
+
+  tiz_hls_destroy (p_hls);
+}
+END_TEST
@@ -0,0 +1,251 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Shared-memory ring buffer API unit tests
+ *
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define SHMRING_TEST_BYTES (8 * 1024 * 1024)
+
+static inline uint8_t
+shmring_test_byte (const size_t a_pos)
+{
+  return (uint8_t) ((a_pos * 31) ^ (a_pos >> 8));
+}
+
+static void *
+shmring_test_producer (void * ap_arg)
+{
+  tiz_shmring_t * p_ring = ap_arg;
+  uint8_t buf[3001];
+  size_t sent = 0;
+
+  while (sent < SHMRING_TEST_BYTES)
+    {
+      const size_t n = MIN (sizeof (buf), SHMRING_TEST_BYTES - sent);
+      size_t i = 0;
+      for (i = 0; i < n; ++i)
+        {
+          buf[i] = shmring_test_byte (sent + i);
+        }
+      fail_if (n != tiz_shmring_write (p_ring, buf, n, -1));
+      sent += n;
+    }
+  fail_if (OMX_ErrorNone != tiz_shmring_write_eos (p_ring, -1));
+  return NULL;
+}
+
+START_TEST (test_shmring_open_and_close)
+{
+  tiz_shmring_t * p_ring1 = NULL;
+  tiz_shmring_t * p_ring2 = NULL;
+
+  fail_if (OMX_ErrorBadParameter
+           != tiz_shmring_open (&p_ring1, "check/shmring", 0));
+  fail_if (NULL != p_ring1);
+
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_open (&p_ring1, "check_shmring", 5000));
+  fail_if (NULL == p_ring1);
+  fail_if (8192 != tiz_shmring_capacity (p_ring1));
+
+  /* The second end gets the existing segment, whatever capacity it asks
+     for */
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring2, "check_shmring", 0));
+  fail_if (8192 != tiz_shmring_capacity (p_ring2));
+
+  tiz_shmring_close (p_ring1);
+  tiz_shmring_close (p_ring2);
+}
+END_TEST
+
+START_TEST (test_shmring_markers_and_back_pressure)
+{
+  tiz_shmring_t * p_ring = NULL;
+  tiz_shmring_t * p_other = NULL;
+  tiz_shmring_format_t fmt_in = {1, 2, 44100, 2, 16, 0};
+  tiz_shmring_format_t fmt_out;
+  uint8_t data[TIZ_SHMRING_MIN_CAPACITY * 2];
+  size_t written = 0;
+
+  memset (data, 0xAB, sizeof (data));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, "check_shmring", 0));
+  /* Both ends use p_ring; the other end only attaches, so that the segment
+     is removed on close */
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_other, "check_shmring", 0));
+
+  /* Nothing there yet */
+  fail_if (ETIZShmRingEventNone != tiz_shmring_next (p_ring, 0));
+  fail_if (ETIZShmRingEventNone != tiz_shmring_next (p_ring, 10));
+
+  fail_if (OMX_ErrorNone != tiz_shmring_write_format (p_ring, &fmt_in, 0));
+  fail_if (100 != tiz_shmring_write (p_ring, data, 100, 0));
+  fail_if (OMX_ErrorNone != tiz_shmring_write_eos (p_ring, 0));
+
+  /* Markers are delivered in order, and data does not run past them */
+  fail_if (ETIZShmRingEventFormat != tiz_shmring_next (p_ring, 0));
+  fail_if (0 != tiz_shmring_read (p_ring, data, sizeof (data)));
+  fail_if (OMX_ErrorIncorrectStateOperation != tiz_shmring_read_eos (p_ring));
+  fail_if (OMX_ErrorNone != tiz_shmring_read_format (p_ring, &fmt_out));
+  fail_if (0 != memcmp (&fmt_in, &fmt_out, sizeof (fmt_in)));
+  fail_if (ETIZShmRingEventData != tiz_shmring_next (p_ring, 0));
+  fail_if (40 != tiz_shmring_read (p_ring, data, 40));
+  fail_if (60 != tiz_shmring_read (p_ring, data, sizeof (data)));
+  fail_if (ETIZShmRingEventEos != tiz_shmring_next (p_ring, 0));
+  fail_if (OMX_ErrorNone != tiz_shmring_read_eos (p_ring));
+  fail_if (ETIZShmRingEventNone != tiz_shmring_next (p_ring, 0));
+
+  /* A full ring holds the producer back */
+  written = tiz_shmring_write (p_ring, data, sizeof (data), 10);
+  fail_if (written == 0 || written >= TIZ_SHMRING_MIN_CAPACITY);
+  fail_if (0 != tiz_shmring_write (p_ring, data, sizeof (data), 0));
+  fail_if (OMX_ErrorNotReady != tiz_shmring_write_eos (p_ring, 10));
+  fail_if (written != tiz_shmring_read (p_ring, data, sizeof (data)));
+  fail_if (OMX_ErrorNone != tiz_shmring_write_eos (p_ring, 0));
+
+  tiz_shmring_close (p_ring);
+  tiz_shmring_close (p_other);
+}
+END_TEST
+
+START_TEST (test_shmring_producer_done_before_consumer)
+{
+  tiz_shmring_t * p_producer = NULL;
+  tiz_shmring_t * p_consumer = NULL;
+  uint8_t data[100];
+  int fd = -1;
+
+  memset (data, 0xCD, sizeof (data));
+
+  /* The whole stream is written, and the producer gone, before the consumer
+     shows up */
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_open (&p_producer, "check_shmring_late", 0));
+  fail_if (sizeof (data) != tiz_shmring_write (p_producer, data,
+                                               sizeof (data), 0));
+  fail_if (OMX_ErrorNone != tiz_shmring_write_eos (p_producer, 0));
+  tiz_shmring_close (p_producer);
+
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_open (&p_consumer, "check_shmring_late", 0));
+  fail_if (ETIZShmRingEventData != tiz_shmring_next (p_consumer, 0));
+  memset (data, 0, sizeof (data));
+  fail_if (sizeof (data) != tiz_shmring_read (p_consumer, data,
+                                              sizeof (data)));
+  fail_if (0xCD != data[0] || 0xCD != data[sizeof (data) - 1]);
+  fail_if (ETIZShmRingEventEos != tiz_shmring_next (p_consumer, 0));
+  fail_if (OMX_ErrorNone != tiz_shmring_read_eos (p_consumer));
+  tiz_shmring_close (p_consumer);
+
+  /* Both ends have been and gone */
+  fd = shm_open (TIZ_SHMRING_PREFIX "check_shmring_late", O_RDWR, 0);
+  fail_if (fd >= 0 || ENOENT != errno);
+}
+END_TEST
+
+START_TEST (test_shmring_producer_consumer)
+{
+  tiz_shmring_t * p_producer = NULL;
+  tiz_shmring_t * p_consumer = NULL;
+  pthread_t thread;
+  uint8_t buf[4999];
+  size_t received = 0;
+  bool eos = false;
+
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_open (&p_consumer, "check_shmring", 16384));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_open (&p_producer, "check_shmring", 0));
+  fail_if (0 != pthread_create (&thread, NULL, shmring_test_producer,
+                                p_producer));
+
+  while (!eos)
+    {
+      switch (tiz_shmring_next (p_consumer, -1))
+        {
+          case ETIZShmRingEventData:
+            {
+              const size_t n
+                = tiz_shmring_read (p_consumer, buf, sizeof (buf));
+              size_t i = 0;
+              fail_if (0 == n);
+              for (i = 0; i < n; ++i)
+                {
+                  fail_if (buf[i] != shmring_test_byte (received + i));
+                }
+              received += n;
+            }
+            break;
+          case ETIZShmRingEventEos:
+            fail_if (OMX_ErrorNone != tiz_shmring_read_eos (p_consumer));
+            eos = true;
+            break;
+          default:
+            fail_if (true);
+            break;
+        };
+    }
+
+  fail_if (0 != pthread_join (thread, NULL));
+  fail_if (SHMRING_TEST_BYTES != received);
+
+  tiz_shmring_close (p_producer);
+  tiz_shmring_close (p_consumer);
+}
+END_TEST
+
+START_TEST (test_shmring_private_and_writable)
+{
+  tiz_shmring_t * p_ring = NULL;
+  uint8_t buf[6000];
+  size_t writable = 0;
+
+  memset (buf, 0x5a, sizeof (buf));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, NULL, 16384));
+  fail_if (16384 != tiz_shmring_capacity (p_ring));
+  fail_if (0 != tiz_shmring_used (p_ring));
+
+  /* Whatever tiz_shmring_writable promises, a non-blocking write delivers */
+  while ((writable = tiz_shmring_writable (p_ring)) > 0)
+    {
+      const size_t n = MIN (writable, sizeof (buf));
+      fail_if (n != tiz_shmring_write (p_ring, buf, n, 0));
+    }
+  fail_if (tiz_shmring_used (p_ring) > 16384);
+  fail_if (tiz_shmring_used (p_ring) < 16384 - 64);
+
+  fail_if (ETIZShmRingEventData != tiz_shmring_next (p_ring, 0));
+  fail_if (sizeof (buf) != tiz_shmring_read (p_ring, buf, sizeof (buf)));
+  fail_if (tiz_shmring_writable (p_ring) < sizeof (buf) - 64);
+
+  tiz_shmring_close (p_ring);
+}
+END_TEST
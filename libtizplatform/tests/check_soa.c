@@ -26,6 +26,7 @@
  *
  */
 
+#include <assert.h>
 #include <malloc.h>
 
 #define MAX_CLASS0_OBJS 126
@@ -255,6 +256,93 @@ START_TEST (test_soa_reserve_life_cycle)
 }
 END_TEST
 
+#define MT_PRODUCED_OBJS 1000
+
+typedef struct soa_mt_test_data soa_mt_test_data_t;
+struct soa_mt_test_data
+{
+  tiz_soa_t *p_soa;
+  tiz_queue_t *p_queue;
+};
+
+static void *
+soa_mt_producer_thread_func (void *p_arg)
+{
+  soa_mt_test_data_t *p_data = p_arg;
+  void *p_obj = NULL;
+  int i = 0;
+
+  assert (p_data);
+
+  for (i=0; i<MT_PRODUCED_OBJS; i++)
+    {
+      p_obj = tiz_soa_calloc (p_data->p_soa, 40);
+      assert (p_obj);
+      (void) tiz_queue_send (p_data->p_queue, p_obj);
+    }
+
+  return NULL;
+}
+
+START_TEST (test_soa_mt_cross_thread_frees)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  soa_mt_test_data_t data;
+  tiz_thread_t thread;
+  void *p_obj = NULL;
+  void *p_result = NULL;
+  int i = 0;
+  tiz_soa_info_t info;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_soa_mt_cross_thread_frees - begin");
+
+  error = tiz_soa_init_mt (&data.p_soa);
+  fail_if (error != OMX_ErrorNone);
+
+  error = tiz_queue_init (&data.p_queue, MT_PRODUCED_OBJS);
+  fail_if (error != OMX_ErrorNone);
+
+  error = tiz_thread_create (&thread, 0, 0, soa_mt_producer_thread_func,
+                             &data);
+  fail_if (error != OMX_ErrorNone);
+
+  /* Free everything the producer allocates, from this thread */
+  for (i=0; i<MT_PRODUCED_OBJS; i++)
+    {
+      error = tiz_queue_receive (data.p_queue, &p_obj);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (p_obj == NULL);
+      tiz_soa_free (data.p_soa, p_obj);
+    }
+
+  /* The producer's cache is retired when the thread exits */
+  error = tiz_thread_join (&thread, &p_result);
+  fail_if (error != OMX_ErrorNone);
+
+  tiz_soa_info (data.p_soa, &info);
+  fail_if (info.tcaches != 1);
+  fail_if (info.objects != 0);
+  fail_if (info.cross_thread_frees != MT_PRODUCED_OBJS);
+  fail_if (info.tcache_hits + info.tcache_misses != MT_PRODUCED_OBJS);
+  fail_if (info.tcache_hits == 0);
+  fail_if (info.tcache_flushes == 0);
+
+  /* Slices freed on this thread are reused without a refill */
+  p_obj = tiz_soa_calloc (data.p_soa, 40);
+  fail_if (p_obj == NULL);
+  tiz_soa_info (data.p_soa, &info);
+  fail_if (info.objects != 1);
+  fail_if (info.slices[1] != 1);
+  fail_if (info.tcache_hits + info.tcache_misses != MT_PRODUCED_OBJS + 1);
+  tiz_soa_free (data.p_soa, p_obj);
+
+  tiz_queue_destroy (data.p_queue);
+  tiz_soa_destroy (data.p_soa);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_soa_mt_cross_thread_frees - end");
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
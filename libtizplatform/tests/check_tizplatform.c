@@ -51,6 +51,9 @@
 #include "./check_event.c"
 #include "./check_http_parser.c"
 #include "./check_map.c"
+#include "./check_shmring.c"
+#include "./check_urltrans.c"
+#include "./check_hls.c"
 
 #define EVENT_API_TEST_TIMEOUT 100
 
@@ -173,6 +176,7 @@ platform_soa_suite (void)
   tc_soa = tcase_create ("soa");
   tcase_add_test (tc_soa, test_soa_basic_life_cycle);
   tcase_add_test (tc_soa, test_soa_reserve_life_cycle);
+  tcase_add_test (tc_soa, test_soa_mt_cross_thread_frees);
   suite_add_tcase (s, tc_soa);
 
   return s;
@@ -227,6 +231,59 @@ platform_map_suite (void)
 
 }
 
+Suite *
+platform_shmring_suite (void)
+{
+  TCase  *tc_shmring;
+  Suite *s = suite_create ("shared-memory ring");
+
+  /* shmring API test cases */
+  tc_shmring = tcase_create ("shmring API");
+  tcase_add_test (tc_shmring, test_shmring_open_and_close);
+  tcase_add_test (tc_shmring, test_shmring_markers_and_back_pressure);
+  tcase_add_test (tc_shmring, test_shmring_producer_done_before_consumer);
+  tcase_add_test (tc_shmring, test_shmring_producer_consumer);
+  tcase_add_test (tc_shmring, test_shmring_private_and_writable);
+  suite_add_tcase (s, tc_shmring);
+
+  return s;
+}
+
+Suite *
+platform_urltrans_suite (void)
+{
+  TCase  *tc_urltrans;
+  Suite *s = suite_create ("url transfer");
+
+  /* urltrans API test cases */
+  tc_urltrans = tcase_create ("urltrans API");
+  tcase_set_timeout (tc_urltrans, 30);
+  tcase_add_test (tc_urltrans, test_urltrans_track_changes);
+  tcase_add_test (tc_urltrans, test_urltrans_shared_engine);
+  tcase_add_test (tc_urltrans, test_urltrans_resume_after_drop);
+  tcase_add_test (tc_urltrans, test_urltrans_disk_cache);
+  tcase_add_test (tc_urltrans, test_urltrans_live_reconnect);
+  suite_add_tcase (s, tc_urltrans);
+
+  return s;
+}
+
+Suite *
+platform_hls_suite (void)
+{
+  TCase  *tc_hls;
+  Suite *s = suite_create ("hls segmenter");
+
+  /* hls API test cases */
+  tc_hls = tcase_create ("hls API");
+  tcase_add_test (tc_hls, test_hls_init_and_destroy);
+  tcase_add_test (tc_hls, test_hls_rolling_window);
+  tcase_add_test (tc_hls, test_hls_discontinuity);
+  suite_add_tcase (s, tc_hls);
+
+  return s;
+}
+
 int
 main (void)
 {
@@ -246,6 +303,9 @@ main (void)
   srunner_add_suite (sr, platform_soa_suite ());
   srunner_add_suite (sr, platform_http_parser_suite ());
   srunner_add_suite (sr, platform_map_suite ());
+  srunner_add_suite (sr, platform_shmring_suite ());
+  srunner_add_suite (sr, platform_urltrans_suite ());
+  srunner_add_suite (sr, platform_hls_suite ());
 /*   srunner_add_suite (sr, platform_event_suite ()); */
   srunner_run_all (sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed (sr);
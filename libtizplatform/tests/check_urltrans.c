@@ -0,0 +1,1023 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_urltrans.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  URL transfer API unit tests
+ *
+ * A local HTTP/1.1 server feeds a number of "tracks" to a single transfer
+ * object, moved from one to the next with tiz_urltrans_set_uri, the way the
+ * http source processors do it. The transfer's watchers are driven by a
+ * small poll loop that stands in for a servant's event loop.
+ *
+ * The server honours range requests and conditional requests, and can be
+ * told to drop the connection part way through a response or to change its
+ * tracks, to exercise resumption and the disk cache.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#define URLTRANS_TEST_TRACKS 20
+#define URLTRANS_TEST_TRACK_BYTES (256 * 1024)
+#define URLTRANS_TEST_MAX_CLIENTS 8
+#define URLTRANS_TEST_DROP_BYTES 100000
+#define URLTRANS_TEST_CACHE_COMP "OMX.Aratelia.check.urlcache"
+#define URLTRANS_TEST_LIVE_COMP "OMX.Aratelia.check.urllive"
+#define URLTRANS_TEST_LIVE_RATE 32000 /* bytes per second */
+#define URLTRANS_TEST_LIVE_STALL_MS 1000
+
+/* The contents of every track */
+static inline OMX_U8
+urltrans_test_byte (const size_t a_offset)
+{
+  return (OMX_U8) (a_offset * 7 + a_offset / 251);
+}
+
+/*
+ * The HTTP server
+ */
+
+typedef struct urltrans_test_server urltrans_test_server_t;
+struct urltrans_test_server
+{
+  int listen_fd;
+  int port;
+  int connections;
+  int requests;
+  int range_requests;
+  int version;         /* of the tracks, as found in their ETag */
+  bool change_on_drop; /* a new version after each dropped connection */
+  size_t drop_after;   /* close the connection after this many body bytes */
+  size_t live_offset;      /* of the live stream, across connections */
+  size_t live_stall_at;    /* stall once, after this many bytes */
+  size_t live_close_after; /* close the first connection after this many */
+  int refuse_reconnects;   /* connections closed as soon as accepted */
+  volatile bool stop;
+  pthread_t thread;
+};
+
+static void
+urltrans_test_sleep (const long a_ms)
+{
+  struct timespec ts;
+  ts.tv_sec = a_ms / 1000;
+  ts.tv_nsec = (a_ms % 1000) * 1000000L;
+  (void) nanosleep (&ts, NULL);
+}
+
+/* A live stream, sent in a burst at first and then at its nominal rate, as
+   Icecast does; the first connection stalls once and is closed after a
+   while */
+static bool
+urltrans_test_serve_live (urltrans_test_server_t * ap_srv, const int a_fd)
+{
+  OMX_U8 chunk[URLTRANS_TEST_LIVE_RATE / 20];
+  char head[256];
+  size_t sent = 0;
+  size_t i = 0;
+
+  snprintf (head, sizeof (head),
+            "HTTP/1.0 200 OK\r\nContent-Type: audio/mpeg\r\n"
+            "icy-br: %d\r\nicy-name: check\r\n\r\n",
+            URLTRANS_TEST_LIVE_RATE * 8 / 1000);
+  if (send (a_fd, head, strlen (head), MSG_NOSIGNAL) <= 0)
+    {
+      return false;
+    }
+
+  while (!ap_srv->stop
+         && (0 == ap_srv->live_close_after || sent < ap_srv->live_close_after))
+    {
+      if (ap_srv->live_stall_at > 0 && sent >= ap_srv->live_stall_at)
+        {
+          ap_srv->live_stall_at = 0;
+          urltrans_test_sleep (URLTRANS_TEST_LIVE_STALL_MS);
+        }
+      for (i = 0; i < sizeof (chunk); ++i)
+        {
+          chunk[i] = urltrans_test_byte (ap_srv->live_offset + i);
+        }
+      if (send (a_fd, chunk, sizeof (chunk), MSG_NOSIGNAL)
+          != (ssize_t) sizeof (chunk))
+        {
+          return false;
+        }
+      sent += sizeof (chunk);
+      ap_srv->live_offset += sizeof (chunk);
+      if (sent >= URLTRANS_TEST_LIVE_RATE / 2)
+        {
+          urltrans_test_sleep (50);
+        }
+    }
+
+  ap_srv->live_close_after = 0;
+  return false;
+}
+
+static bool
+urltrans_test_serve_request (urltrans_test_server_t * ap_srv, const int a_fd,
+                             char * ap_req, size_t * ap_len)
+{
+  static OMX_U8 body[URLTRANS_TEST_TRACK_BYTES];
+  const char * p_range = NULL;
+  const char * p_cond = NULL;
+  char * p_end = NULL;
+  char etag[32];
+  char head[512];
+  size_t start = 0;
+  size_t nbytes = 0;
+  ssize_t n = 0;
+
+  if (!body[1])
+    {
+      for (n = 0; n < URLTRANS_TEST_TRACK_BYTES; ++n)
+        {
+          body[n] = urltrans_test_byte (n);
+        }
+    }
+
+  while (!(p_end = strstr (ap_req, "\r\n\r\n")))
+    {
+      n = recv (a_fd, ap_req + *ap_len, 4095 - *ap_len, 0);
+      if (n <= 0)
+        {
+          return false;
+        }
+      *ap_len += n;
+      ap_req[*ap_len] = '\0';
+    }
+
+  *p_end = '\0';
+  ++ap_srv->requests;
+  if (0 == strncmp (ap_req, "GET /live", 9))
+    {
+      return urltrans_test_serve_live (ap_srv, a_fd);
+    }
+  snprintf (etag, sizeof (etag), "\"track%d\"", ap_srv->version);
+  p_range = strstr (ap_req, "Range: bytes=");
+  if (p_range && (p_cond = strstr (ap_req, "If-Range: "))
+      && 0 != strncmp (p_cond + 10, etag, strlen (etag)))
+    {
+      /* The track has changed; it is sent whole */
+      p_range = NULL;
+    }
+  if (p_range)
+    {
+      start = strtoul (p_range + 13, NULL, 10);
+      fail_if (start >= URLTRANS_TEST_TRACK_BYTES);
+      ++ap_srv->range_requests;
+    }
+  p_cond = strstr (ap_req, "If-None-Match: ");
+  p_cond = (p_cond && 0 == strncmp (p_cond + 15, etag, strlen (etag))
+              ? p_cond
+              : NULL);
+
+  if (0 == strncmp (ap_req, "HEAD ", 5))
+    {
+      nbytes = 0;
+    }
+  else
+    {
+      nbytes = URLTRANS_TEST_TRACK_BYTES - start;
+    }
+
+  /* Drop the request just served, keep anything pipelined after it */
+  p_end += 4;
+  *ap_len -= (p_end - ap_req);
+  memmove (ap_req, p_end, *ap_len + 1);
+
+  if (p_cond)
+    {
+      snprintf (head, sizeof (head),
+                "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n", etag);
+      nbytes = 0;
+    }
+  else if (p_range)
+    {
+      snprintf (head, sizeof (head),
+                "HTTP/1.1 206 Partial Content\r\nContent-Type: audio/mpeg\r\n"
+                "ETag: %s\r\nContent-Range: bytes %lu-%d/%d\r\n"
+                "Content-Length: %lu\r\n\r\n",
+                etag, (unsigned long) start, URLTRANS_TEST_TRACK_BYTES - 1,
+                URLTRANS_TEST_TRACK_BYTES,
+                (unsigned long) (URLTRANS_TEST_TRACK_BYTES - start));
+    }
+  else
+    {
+      snprintf (head, sizeof (head),
+                "HTTP/1.1 200 OK\r\nContent-Type: audio/mpeg\r\n"
+                "ETag: %s\r\nAccept-Ranges: bytes\r\n"
+                "Content-Length: %d\r\n\r\n",
+                etag, URLTRANS_TEST_TRACK_BYTES);
+    }
+
+  if (ap_srv->drop_after > 0 && nbytes > ap_srv->drop_after)
+    {
+      /* Send part of the body, then close the connection */
+      (void) send (a_fd, head, strlen (head), MSG_NOSIGNAL);
+      (void) send (a_fd, body + start, ap_srv->drop_after, MSG_NOSIGNAL);
+      if (ap_srv->change_on_drop)
+        {
+          ++ap_srv->version;
+        }
+      return false;
+    }
+
+  if (0 == nbytes)
+    {
+      return send (a_fd, head, strlen (head), MSG_NOSIGNAL) > 0;
+    }
+
+  return (send (a_fd, head, strlen (head), MSG_NOSIGNAL) > 0
+          && send (a_fd, body + start, nbytes, MSG_NOSIGNAL)
+               == (ssize_t) nbytes);
+}
+
+static void *
+urltrans_test_server_thread (void * ap_arg)
+{
+  urltrans_test_server_t * p_srv = ap_arg;
+  struct pollfd fds[URLTRANS_TEST_MAX_CLIENTS + 1];
+  char reqs[URLTRANS_TEST_MAX_CLIENTS + 1][4096];
+  size_t lens[URLTRANS_TEST_MAX_CLIENTS + 1];
+  int nfds = 1;
+  int i = 0;
+
+  fds[0].fd = p_srv->listen_fd;
+  fds[0].events = POLLIN;
+
+  while (!p_srv->stop)
+    {
+      if (poll (fds, nfds, 50) <= 0)
+        {
+          continue;
+        }
+      if ((fds[0].revents & POLLIN) && nfds <= URLTRANS_TEST_MAX_CLIENTS)
+        {
+          fds[nfds].fd = accept (p_srv->listen_fd, NULL, NULL);
+          fds[nfds].events = POLLIN;
+          fds[nfds].revents = 0;
+          lens[nfds] = 0;
+          reqs[nfds][0] = '\0';
+          ++p_srv->connections;
+          if (p_srv->refuse_reconnects > 0 && p_srv->live_offset > 0)
+            {
+              --p_srv->refuse_reconnects;
+              close (fds[nfds].fd);
+            }
+          else
+            {
+              ++nfds;
+            }
+        }
+      for (i = 1; i < nfds; ++i)
+        {
+          if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+              && !urltrans_test_serve_request (p_srv, fds[i].fd, reqs[i],
+                                               &lens[i]))
+            {
+              close (fds[i].fd);
+              fds[i] = fds[nfds - 1];
+              memcpy (reqs[i], reqs[nfds - 1], sizeof (reqs[i]));
+              lens[i] = lens[nfds - 1];
+              --nfds;
+              --i;
+            }
+        }
+    }
+
+  for (i = 1; i < nfds; ++i)
+    {
+      close (fds[i].fd);
+    }
+  return NULL;
+}
+
+static void
+urltrans_test_server_start (urltrans_test_server_t * ap_srv)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof (addr);
+
+  memset (ap_srv, 0, sizeof (*ap_srv));
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  ap_srv->listen_fd = socket (AF_INET, SOCK_STREAM, 0);
+  fail_if (ap_srv->listen_fd < 0);
+  fail_if (0
+           != bind (ap_srv->listen_fd, (struct sockaddr *) &addr,
+                    sizeof (addr)));
+  fail_if (0 != listen (ap_srv->listen_fd, 8));
+  fail_if (0
+           != getsockname (ap_srv->listen_fd, (struct sockaddr *) &addr,
+                           &addr_len));
+  ap_srv->port = ntohs (addr.sin_port);
+  fail_if (0
+           != pthread_create (&ap_srv->thread, NULL,
+                              urltrans_test_server_thread, ap_srv));
+}
+
+static void
+urltrans_test_server_stop (urltrans_test_server_t * ap_srv)
+{
+  ap_srv->stop = true;
+  pthread_join (ap_srv->thread, NULL);
+  close (ap_srv->listen_fd);
+}
+
+/*
+ * The transfer's parent: watchers and callbacks
+ */
+
+typedef struct urltrans_test_io urltrans_test_io_t;
+struct urltrans_test_io
+{
+  int fd;
+  tiz_event_io_event_t event;
+  bool active;
+};
+
+typedef struct urltrans_test_timer urltrans_test_timer_t;
+struct urltrans_test_timer
+{
+  double after;
+  double deadline;
+  bool active;
+};
+
+typedef struct urltrans_test_parent urltrans_test_parent_t;
+struct urltrans_test_parent
+{
+  tiz_urltrans_t * p_trans;
+  urltrans_test_io_t * p_io;
+  urltrans_test_timer_t * timers[2];
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_U8 data[32 * 1024];
+  size_t bytes;
+  size_t stop_at; /* end the run once this many bytes have been received */
+  size_t rate;    /* consume in real time, at this many bytes per second */
+  double started;
+  int responses;
+  bool header_seen;
+  bool corrupt;
+  int lost;
+  bool done;
+};
+
+static double
+urltrans_test_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_init (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
+                       tiz_event_io_event_t a_event, bool only_once)
+{
+  urltrans_test_parent_t * p_parent = ap_obj;
+  urltrans_test_io_t * p_io = calloc (1, sizeof (urltrans_test_io_t));
+  fail_if (!p_io);
+  p_io->fd = a_fd;
+  p_io->event = a_event;
+  p_parent->p_io = p_io;
+  *app_ev_io = (tiz_event_io_t *) p_io;
+  return OMX_ErrorNone;
+}
+
+static void
+urltrans_test_io_destroy (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  urltrans_test_parent_t * p_parent = ap_obj;
+  if (ap_ev_io && p_parent->p_io == (urltrans_test_io_t *) ap_ev_io)
+    {
+      p_parent->p_io = NULL;
+    }
+  free (ap_ev_io);
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_start (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((urltrans_test_io_t *) ap_ev_io)->active = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_stop (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((urltrans_test_io_t *) ap_ev_io)->active = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_init (void * ap_obj, tiz_event_timer_t ** app_ev_timer)
+{
+  urltrans_test_parent_t * p_parent = ap_obj;
+  urltrans_test_timer_t * p_timer
+    = calloc (1, sizeof (urltrans_test_timer_t));
+  fail_if (!p_timer);
+  p_parent->timers[p_parent->timers[0] ? 1 : 0] = p_timer;
+  *app_ev_timer = (tiz_event_timer_t *) p_timer;
+  return OMX_ErrorNone;
+}
+
+static void
+urltrans_test_timer_destroy (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  urltrans_test_parent_t * p_parent = ap_obj;
+  int i = 0;
+  for (i = 0; i < 2; ++i)
+    {
+      if (p_parent->timers[i] == (urltrans_test_timer_t *) ap_ev_timer)
+        {
+          p_parent->timers[i] = NULL;
+        }
+    }
+  free (ap_ev_timer);
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_start (void * ap_obj, tiz_event_timer_t * ap_ev_timer,
+                           const double a_after, const double a_repeat)
+{
+  urltrans_test_timer_t * p_timer = (urltrans_test_timer_t *) ap_ev_timer;
+  p_timer->after = a_after;
+  p_timer->deadline = urltrans_test_now () + a_after;
+  p_timer->active = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_stop (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  ((urltrans_test_timer_t *) ap_ev_timer)->active = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_restart (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  urltrans_test_timer_t * p_timer = (urltrans_test_timer_t *) ap_ev_timer;
+  return urltrans_test_timer_start (ap_obj, ap_ev_timer, p_timer->after, 0);
+}
+
+static void
+urltrans_test_buf_filled (OMX_BUFFERHEADERTYPE * ap_hdr, OMX_PTR ap_arg)
+{
+  urltrans_test_parent_t * p_parent = ap_arg;
+  OMX_U32 i = 0;
+  for (i = 0; i < ap_hdr->nFilledLen; ++i)
+    {
+      if (ap_hdr->pBuffer[i] != urltrans_test_byte (p_parent->bytes + i))
+        {
+          p_parent->corrupt = true;
+        }
+    }
+  p_parent->bytes += ap_hdr->nFilledLen;
+  ap_hdr->nFilledLen = 0;
+  if (p_parent->stop_at > 0 && p_parent->bytes >= p_parent->stop_at)
+    {
+      p_parent->done = true;
+    }
+}
+
+static OMX_BUFFERHEADERTYPE *
+urltrans_test_buf_emptied (OMX_PTR ap_arg)
+{
+  urltrans_test_parent_t * p_parent = ap_arg;
+  if (p_parent->stop_at > 0 && p_parent->bytes >= p_parent->stop_at)
+    {
+      /* Let the transfer's store fill up */
+      return NULL;
+    }
+  if (p_parent->rate > 0)
+    {
+      const double now = urltrans_test_now ();
+      if (0 == p_parent->started)
+        {
+          p_parent->started = now;
+        }
+      if (p_parent->bytes > (now - p_parent->started) * p_parent->rate)
+        {
+          /* Like a decoder feeding a renderer */
+          return NULL;
+        }
+    }
+  return &(p_parent->hdr);
+}
+
+static void
+urltrans_test_header_avail (OMX_PTR ap_arg, const void * ap_ptr,
+                            const size_t a_nbytes)
+{
+  urltrans_test_parent_t * p_parent = ap_arg;
+  p_parent->header_seen = true;
+  if (a_nbytes <= 2)
+    {
+      /* The end of the header block */
+      ++p_parent->responses;
+    }
+}
+
+static bool
+urltrans_test_data_avail (OMX_PTR ap_arg, const void * ap_ptr,
+                          const size_t a_nbytes)
+{
+  return false;
+}
+
+static bool
+urltrans_test_connection_lost (OMX_PTR ap_arg)
+{
+  urltrans_test_parent_t * p_parent = ap_arg;
+  ++p_parent->lost;
+  p_parent->done = true;
+  return false;
+}
+
+/* Run the transfer until the current track is complete */
+static void
+urltrans_test_run (urltrans_test_parent_t * ap_parent)
+{
+  const double give_up = urltrans_test_now () + 10.0;
+
+  while (!ap_parent->done)
+    {
+      struct pollfd pfd;
+      double now = urltrans_test_now ();
+      double wait = (ap_parent->rate > 0 ? 0.01 : 0.1);
+      int nfds = 0;
+      int i = 0;
+
+      fail_if (now > give_up);
+
+      if (ap_parent->rate > 0)
+        {
+          /* The buffers come back as they are consumed */
+          fail_if (OMX_ErrorNone
+                   != tiz_urltrans_on_buffers_ready (ap_parent->p_trans));
+        }
+
+      for (i = 0; i < 2; ++i)
+        {
+          urltrans_test_timer_t * p_timer = ap_parent->timers[i];
+          if (p_timer && p_timer->active)
+            {
+              wait = MIN (wait, MAX (0., p_timer->deadline - now));
+            }
+        }
+
+      if (ap_parent->p_io && ap_parent->p_io->active)
+        {
+          pfd.fd = ap_parent->p_io->fd;
+          pfd.events = (ap_parent->p_io->event & TIZ_EVENT_READ ? POLLIN : 0)
+                       | (ap_parent->p_io->event & TIZ_EVENT_WRITE ? POLLOUT
+                                                                   : 0);
+          pfd.revents = 0;
+          nfds = 1;
+        }
+
+      if (poll (&pfd, nfds, (int) (wait * 1000)) > 0)
+        {
+          /* The io watchers are one-shot */
+          ap_parent->p_io->active = false;
+          fail_if (OMX_ErrorNone
+                   != tiz_urltrans_on_io_ready (
+                        ap_parent->p_trans, (tiz_event_io_t *) ap_parent->p_io,
+                        pfd.fd, ap_parent->p_io->event));
+          continue;
+        }
+
+      now = urltrans_test_now ();
+      for (i = 0; i < 2 && !ap_parent->done; ++i)
+        {
+          urltrans_test_timer_t * p_timer = ap_parent->timers[i];
+          if (p_timer && p_timer->active && p_timer->deadline <= now)
+            {
+              p_timer->active = false;
+              fail_if (OMX_ErrorNone
+                       != tiz_urltrans_on_timer_ready (
+                            ap_parent->p_trans,
+                            (tiz_event_timer_t *) p_timer));
+            }
+        }
+    }
+}
+
+static void
+urltrans_test_init_parent_with_name (urltrans_test_parent_t * ap_parent,
+                                     OMX_PARAM_CONTENTURITYPE * ap_uri,
+                                     const char * ap_comp_name)
+{
+  const tiz_urltrans_buffer_cbacks_t buffer_cbacks
+    = {urltrans_test_buf_filled, urltrans_test_buf_emptied};
+  const tiz_urltrans_info_cbacks_t info_cbacks
+    = {urltrans_test_header_avail, urltrans_test_data_avail,
+       urltrans_test_connection_lost};
+  const tiz_urltrans_event_io_cbacks_t io_cbacks
+    = {urltrans_test_io_init, urltrans_test_io_destroy, urltrans_test_io_start,
+       urltrans_test_io_stop};
+  const tiz_urltrans_event_timer_cbacks_t timer_cbacks
+    = {urltrans_test_timer_init, urltrans_test_timer_destroy,
+       urltrans_test_timer_start, urltrans_test_timer_stop,
+       urltrans_test_timer_restart};
+
+  memset (ap_parent, 0, sizeof (*ap_parent));
+  ap_parent->hdr.pBuffer = ap_parent->data;
+  ap_parent->hdr.nAllocLen = sizeof (ap_parent->data);
+
+  fail_if (OMX_ErrorNone
+           != tiz_urltrans_init (&(ap_parent->p_trans), ap_parent, ap_uri,
+                                 (OMX_STRING) ap_comp_name,
+                                 URLTRANS_TEST_TRACK_BYTES, 1.0, buffer_cbacks,
+                                 info_cbacks, io_cbacks, timer_cbacks));
+  fail_if (!ap_parent->p_trans);
+  tiz_urltrans_set_internal_buffer_size (ap_parent->p_trans, 8192);
+}
+
+static void
+urltrans_test_init_parent (urltrans_test_parent_t * ap_parent,
+                           OMX_PARAM_CONTENTURITYPE * ap_uri)
+{
+  urltrans_test_init_parent_with_name (ap_parent, ap_uri,
+                                       "OMX.Aratelia.check.urltrans");
+}
+
+/* Transfer a track from the start, until the connection is reported lost or
+   'stop_at' bytes are received */
+static void
+urltrans_test_fetch (urltrans_test_parent_t * ap_parent,
+                     OMX_PARAM_CONTENTURITYPE * ap_uri, const int a_port,
+                     const char * ap_track, const size_t a_stop_at)
+{
+  snprintf ((char *) ap_uri->contentURI, 128, "http://127.0.0.1:%d/%s",
+            a_port, ap_track);
+  tiz_urltrans_set_uri (ap_parent->p_trans, ap_uri);
+  ap_parent->done = false;
+  ap_parent->header_seen = false;
+  ap_parent->corrupt = false;
+  ap_parent->lost = 0;
+  ap_parent->bytes = 0;
+  ap_parent->stop_at = a_stop_at;
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (ap_parent->p_trans));
+  urltrans_test_run (ap_parent);
+  fail_if (!ap_parent->header_seen);
+  fail_if (ap_parent->corrupt);
+}
+
+/* Transfer a track from the start, until it ends or 'stop_at' bytes are
+   received */
+static void
+urltrans_test_play (urltrans_test_parent_t * ap_parent,
+                    OMX_PARAM_CONTENTURITYPE * ap_uri, const int a_port,
+                    const char * ap_track, const size_t a_stop_at)
+{
+  urltrans_test_fetch (ap_parent, ap_uri, a_port, ap_track, a_stop_at);
+  if (a_stop_at > 0)
+    {
+      tiz_urltrans_cancel (ap_parent->p_trans);
+      tiz_urltrans_flush_buffer (ap_parent->p_trans);
+    }
+  else
+    {
+      fail_if (URLTRANS_TEST_TRACK_BYTES != ap_parent->bytes);
+      fail_if (1 != ap_parent->lost);
+    }
+}
+
+START_TEST (test_urltrans_track_changes)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_parent_t parent;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+  double first_track = 0;
+  double other_tracks = 0;
+  int i = 0;
+
+  urltrans_test_server_start (&srv);
+
+  p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 128);
+  fail_if (!p_uri);
+  snprintf ((char *) p_uri->contentURI, 128, "http://127.0.0.1:%d/track0",
+            srv.port);
+  urltrans_test_init_parent (&parent, p_uri);
+
+  for (i = 0; i < URLTRANS_TEST_TRACKS; ++i)
+    {
+      const double start = urltrans_test_now ();
+      if (i > 0)
+        {
+          snprintf ((char *) p_uri->contentURI, 128,
+                    "http://127.0.0.1:%d/track%d", srv.port, i);
+          tiz_urltrans_set_uri (parent.p_trans, p_uri);
+        }
+      parent.done = false;
+      parent.header_seen = false;
+      parent.bytes = 0;
+      fail_if (OMX_ErrorNone != tiz_urltrans_start (parent.p_trans));
+      urltrans_test_run (&parent);
+      fail_if (!parent.header_seen);
+      fail_if (URLTRANS_TEST_TRACK_BYTES != parent.bytes);
+      if (0 == i)
+        {
+          first_track = urltrans_test_now () - start;
+        }
+      else
+        {
+          other_tracks += urltrans_test_now () - start;
+        }
+    }
+
+  /* Every track after the first one goes over the same keep-alive
+     connection */
+  fail_if (1 != srv.connections);
+
+  fprintf (stderr,
+           "urltrans: first track %.3f ms, track change (average of %d) "
+           "%.3f ms, %d connection(s)\n",
+           first_track * 1000, URLTRANS_TEST_TRACKS - 1,
+           other_tracks * 1000 / (URLTRANS_TEST_TRACKS - 1), srv.connections);
+
+  tiz_urltrans_destroy (parent.p_trans);
+  free (p_uri);
+  urltrans_test_server_stop (&srv);
+}
+END_TEST
+
+START_TEST (test_urltrans_shared_engine)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_parent_t parent1;
+  urltrans_test_parent_t parent2;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+
+  urltrans_test_server_start (&srv);
+
+  p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 128);
+  fail_if (!p_uri);
+  snprintf ((char *) p_uri->contentURI, 128, "http://127.0.0.1:%d/track",
+            srv.port);
+
+  /* Two transfers alive at the same time, then the first one goes away while
+     the second one keeps using the process-wide state */
+  urltrans_test_init_parent (&parent1, p_uri);
+  urltrans_test_init_parent (&parent2, p_uri);
+
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (parent1.p_trans));
+  urltrans_test_run (&parent1);
+  fail_if (URLTRANS_TEST_TRACK_BYTES != parent1.bytes);
+  tiz_urltrans_destroy (parent1.p_trans);
+
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (parent2.p_trans));
+  urltrans_test_run (&parent2);
+  fail_if (URLTRANS_TEST_TRACK_BYTES != parent2.bytes);
+  tiz_urltrans_destroy (parent2.p_trans);
+
+  /* And the engine can be brought up again */
+  urltrans_test_init_parent (&parent1, p_uri);
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (parent1.p_trans));
+  urltrans_test_run (&parent1);
+  fail_if (URLTRANS_TEST_TRACK_BYTES != parent1.bytes);
+  tiz_urltrans_destroy (parent1.p_trans);
+
+  free (p_uri);
+  urltrans_test_server_stop (&srv);
+}
+END_TEST
+
+START_TEST (test_urltrans_resume_after_drop)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_parent_t parent;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+
+  urltrans_test_server_start (&srv);
+  srv.drop_after = URLTRANS_TEST_DROP_BYTES;
+
+  p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 128);
+  fail_if (!p_uri);
+  snprintf ((char *) p_uri->contentURI, 128, "http://127.0.0.1:%d/track",
+            srv.port);
+  urltrans_test_init_parent (&parent, p_uri);
+
+  /* The track arrives complete and in order, over three connections, and the
+     parent only hears about the end of it */
+  urltrans_test_play (&parent, p_uri, srv.port, "track", 0);
+  fail_if (3 != srv.requests);
+  fail_if (2 != srv.range_requests);
+
+  tiz_urltrans_destroy (parent.p_trans);
+  free (p_uri);
+  urltrans_test_server_stop (&srv);
+}
+END_TEST
+
+START_TEST (test_urltrans_live_reconnect)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_parent_t parent;
+  tiz_urltrans_buffer_health_t health;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+
+  urltrans_test_server_start (&srv);
+  srv.live_stall_at = URLTRANS_TEST_LIVE_RATE;
+  srv.live_close_after = 2 * URLTRANS_TEST_LIVE_RATE;
+  srv.refuse_reconnects = 2;
+
+  p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 128);
+  fail_if (!p_uri);
+  snprintf ((char *) p_uri->contentURI, 128, "http://127.0.0.1:%d/live",
+            srv.port);
+
+  /* The jitter buffer's limits, 250 ms and 1 s, are in the test rc file */
+  urltrans_test_init_parent_with_name (&parent, p_uri,
+                                       URLTRANS_TEST_LIVE_COMP);
+  tiz_urltrans_set_stream_rate (parent.p_trans, URLTRANS_TEST_LIVE_RATE);
+  parent.hdr.nAllocLen = 2048;
+  parent.rate = URLTRANS_TEST_LIVE_RATE;
+  parent.stop_at = 3 * URLTRANS_TEST_LIVE_RATE;
+
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (parent.p_trans));
+  urltrans_test_run (&parent);
+  tiz_urltrans_get_buffer_health (parent.p_trans, &health);
+
+  /* The stream arrives complete and in order over a connection that stalls
+     and is closed, two that are refused and a good one. The parent sees the
+     headers once, and never hears about the reconnection, which is counted
+     once however many attempts it took. */
+  fail_if (parent.corrupt);
+  fail_if (0 != parent.lost);
+  fail_if (1 != parent.responses);
+  fail_if (4 != srv.connections);
+  fail_if (1 != health.reconnects);
+
+  /* The stall starves the parent, and the buffer grows */
+  fail_if (health.underruns < 1);
+  fail_if (health.jitter_ms == 0);
+  fail_if (health.target_ms <= 250);
+
+  fprintf (stderr,
+           "urltrans: live stream jitter %u ms, target %u ms, "
+           "%u underrun(s), %u reconnection(s)\n",
+           (unsigned int) health.jitter_ms, (unsigned int) health.target_ms,
+           (unsigned int) health.underruns, (unsigned int) health.reconnects);
+
+  tiz_urltrans_destroy (parent.p_trans);
+  free (p_uri);
+  urltrans_test_server_stop (&srv);
+}
+END_TEST
+
+static void
+urltrans_test_clear_cache_dir (const char * ap_dir)
+{
+  DIR * p_dir = opendir (ap_dir);
+  struct dirent * p_dirent = NULL;
+  char path[PATH_MAX];
+
+  while (p_dir && (p_dirent = readdir (p_dir)))
+    {
+      if ('.' != p_dirent->d_name[0])
+        {
+          snprintf (path, sizeof (path), "%s/%s", ap_dir, p_dirent->d_name);
+          (void) unlink (path);
+        }
+    }
+  if (p_dir)
+    {
+      closedir (p_dir);
+    }
+}
+
+START_TEST (test_urltrans_disk_cache)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_parent_t parent;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+  const char * p_dir = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    URLTRANS_TEST_CACHE_COMP ".disk_cache_dir");
+  int requests = 0;
+  double start = 0;
+
+  /* The cache is configured in the test rc file */
+  fail_if (!p_dir);
+  urltrans_test_clear_cache_dir (p_dir);
+
+  urltrans_test_server_start (&srv);
+  srv.drop_after = URLTRANS_TEST_DROP_BYTES;
+
+  p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 128);
+  fail_if (!p_uri);
+  snprintf ((char *) p_uri->contentURI, 128, "http://127.0.0.1:%d/a",
+            srv.port);
+  urltrans_test_init_parent_with_name (&parent, p_uri,
+                                       URLTRANS_TEST_CACHE_COMP);
+
+  /* The first time, the track comes from the server, resumed after each
+     drop */
+  urltrans_test_play (&parent, p_uri, srv.port, "a", 0);
+  fail_if (3 != srv.requests);
+
+  /* A repeat is served from disk, headers included, once the server has
+     confirmed that the track has not changed */
+  requests = srv.requests;
+  start = urltrans_test_now ();
+  urltrans_test_play (&parent, p_uri, srv.port, "a", 0);
+  fail_if (requests + 1 != srv.requests);
+  fprintf (stderr, "urltrans: track replayed from the disk cache in %.3f ms\n",
+           (urltrans_test_now () - start) * 1000);
+
+  /* A track abandoned part way through; the next time around, the part
+     already fetched is served from disk and the rest with a range request */
+  srv.drop_after = 0;
+  urltrans_test_play (&parent, p_uri, srv.port, "b", 64 * 1024);
+  requests = srv.requests;
+  urltrans_test_play (&parent, p_uri, srv.port, "b", 0);
+  fail_if (requests + 2 != srv.requests);
+  fail_if (3 != srv.range_requests);
+
+  /* The cache holds 1 MiB, that is, three of these tracks and their
+     metadata. The least recently used ones, 'a' first, make room for the
+     others. */
+  urltrans_test_play (&parent, p_uri, srv.port, "c", 0);
+  urltrans_test_play (&parent, p_uri, srv.port, "d", 0);
+  urltrans_test_play (&parent, p_uri, srv.port, "e", 0);
+  requests = srv.requests;
+  urltrans_test_play (&parent, p_uri, srv.port, "e", 0);
+  fail_if (requests + 1 != srv.requests);
+  urltrans_test_play (&parent, p_uri, srv.port, "a", 0);
+  fail_if (requests + 2 != srv.requests);
+
+  /* A track that has changed since it was cached is fetched again, whole,
+     and cached again */
+  ++srv.version;
+  requests = srv.requests;
+  urltrans_test_play (&parent, p_uri, srv.port, "a", 0);
+  fail_if (requests + 2 != srv.requests);
+  fail_if (3 != srv.range_requests);
+  urltrans_test_play (&parent, p_uri, srv.port, "a", 0);
+  fail_if (requests + 3 != srv.requests);
+
+  /* A track that changes while it is being resumed is not joined to the
+     part already delivered; the parent is told the connection is lost, and
+     nothing is left in the cache */
+  srv.drop_after = URLTRANS_TEST_DROP_BYTES;
+  srv.change_on_drop = true;
+  urltrans_test_fetch (&parent, p_uri, srv.port, "f", 0);
+  fail_if (1 != parent.lost);
+  fail_if (URLTRANS_TEST_DROP_BYTES != parent.bytes);
+  fail_if (3 != srv.range_requests);
+  srv.drop_after = 0;
+  srv.change_on_drop = false;
+  requests = srv.requests;
+  urltrans_test_play (&parent, p_uri, srv.port, "f", 0);
+  fail_if (requests + 1 != srv.requests);
+
+  tiz_urltrans_destroy (parent.p_trans);
+  free (p_uri);
+  urltrans_test_server_stop (&srv);
+  urltrans_test_clear_cache_dir (p_dir);
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
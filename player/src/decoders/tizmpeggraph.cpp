@@ -106,4 +106,8 @@ void graph::mpegdecops::do_configure ()
           handles_[2], 0,
           boost::bind (&tiz::probe::get_pcm_codec_info, probe_ptr_, _1)),
       "Unable to set OMX_IndexParamAudioPcm");
+  // The decoder may be configured to output 32-bit samples
+  G_OPS_BAIL_IF_ERROR (
+      tiz::graph::util::copy_pcm_sample_format (handles_[1], 1, handles_[2], 0),
+      "Unable to set the PCM sample format on the renderer");
 }
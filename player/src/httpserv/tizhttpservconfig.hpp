@@ -48,11 +48,20 @@ namespace tiz
                       const std::vector< std::string > &bitrate_mode_list,
                       const std::string &station_name,
                       const std::string &station_genre,
-                      const bool &icy_metadata_enabled)
+                      const bool &icy_metadata_enabled,
+                      const std::string &mount_name = std::string ("/"),
+                      const std::string &source_format = std::string ("mp3"),
+                      const int bitrate_kbps = 0,
+                      const int max_listeners = 0,
+                      const int hls_segment_ms = 0,
+                      const int hls_window = 0)
         : config (playlist), host_ (host), addr_ (ip_address), port_ (port),
           sampling_rate_list_ (sampling_rate_list), bitrate_mode_list_ (bitrate_mode_list),
           station_name_ (station_name), station_genre_ (station_genre),
-          icy_metadata_enabled_ (icy_metadata_enabled)
+          icy_metadata_enabled_ (icy_metadata_enabled),
+          mount_name_ (mount_name), source_format_ (source_format),
+          bitrate_kbps_ (bitrate_kbps), max_listeners_ (max_listeners),
+          hls_segment_ms_ (hls_segment_ms), hls_window_ (hls_window)
       {
       }
 
@@ -100,6 +109,51 @@ namespace tiz
         return icy_metadata_enabled_;
       }
 
+      std::string get_mount_name () const
+      {
+        return mount_name_;
+      }
+
+      // The format of the files in the playlist: "mp3", "flac", "aac" or
+      // "opus".
+      std::string get_source_format () const
+      {
+        return source_format_;
+      }
+
+      // The bitrate of the stream, in kbps, or 0 to serve the mp3 files as
+      // they are.
+      int get_bitrate () const
+      {
+        return bitrate_kbps_;
+      }
+
+      // The maximum number of listeners, or 0 to keep the renderer's default.
+      int get_max_listeners () const
+      {
+        return max_listeners_;
+      }
+
+      // The target duration of the HLS segments, in milliseconds, or 0 if the
+      // mount point is not also served as an HLS playlist.
+      int get_hls_segment_ms () const
+      {
+        return hls_segment_ms_;
+      }
+
+      // The number of segments in the HLS playlist.
+      int get_hls_window () const
+      {
+        return hls_window_;
+      }
+
+      // Files are decoded and re-encoded to mp3 unless they are mp3 already
+      // and no specific bitrate has been requested.
+      bool is_transcoding () const
+      {
+        return (source_format_ != "mp3" || bitrate_kbps_ > 0);
+      }
+
     protected:
       const std::string host_;
       const std::string addr_;
@@ -109,6 +163,12 @@ namespace tiz
       const std::string station_name_;
       const std::string station_genre_;
       const bool icy_metadata_enabled_;
+      const std::string mount_name_;
+      const std::string source_format_;
+      const int bitrate_kbps_;
+      const int max_listeners_;
+      const int hls_segment_ms_;
+      const int hls_window_;
     };
   }  // namespace graph
 }  // namespace tiz
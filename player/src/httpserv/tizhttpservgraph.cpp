@@ -53,8 +53,11 @@ namespace graph = tiz::graph;
 //
 // httpserver
 //
-graph::httpserver::httpserver ()
+graph::httpserver::httpserver (const std::string &source_format,
+                               const bool transcode)
   : graph::graph ("httpservgraph"),
+    source_format_ (source_format),
+    transcode_ (transcode),
     fsm_ (boost::msm::back::states_
           << tiz::graph::hsfsm::fsm::configuring (&p_ops_)
           << tiz::graph::hsfsm::fsm::skipping (&p_ops_),
@@ -65,11 +68,42 @@ graph::httpserver::httpserver ()
 graph::ops *graph::httpserver::do_init ()
 {
   omx_comp_name_lst_t comp_list;
-  comp_list.push_back ("OMX.Aratelia.audio_metadata_eraser.mp3");
-  comp_list.push_back ("OMX.Aratelia.audio_renderer.http");
-
   omx_comp_role_lst_t role_list;
-  role_list.push_back ("audio_metadata_eraser.mp3");
+
+  if (transcode_)
+  {
+    // file reader -> decoder -> mp3 encoder -> http renderer
+    comp_list.push_back ("OMX.Aratelia.file_reader.binary");
+    role_list.push_back ("audio_reader.binary");
+    if (source_format_ == "flac")
+    {
+      comp_list.push_back ("OMX.Aratelia.audio_decoder.flac");
+      role_list.push_back ("audio_decoder.flac");
+    }
+    else if (source_format_ == "aac")
+    {
+      comp_list.push_back ("OMX.Aratelia.audio_decoder.aac");
+      role_list.push_back ("audio_decoder.aac");
+    }
+    else if (source_format_ == "opus")
+    {
+      comp_list.push_back ("OMX.Aratelia.audio_decoder.opusfile.opus");
+      role_list.push_back ("audio_decoder.opus");
+    }
+    else
+    {
+      comp_list.push_back ("OMX.Aratelia.audio_decoder.mp3");
+      role_list.push_back ("audio_decoder.mp3");
+    }
+    comp_list.push_back ("OMX.Aratelia.audio_encoder.mp3");
+    role_list.push_back ("audio_encoder.mp3");
+  }
+  else
+  {
+    comp_list.push_back ("OMX.Aratelia.audio_metadata_eraser.mp3");
+    role_list.push_back ("audio_metadata_eraser.mp3");
+  }
+  comp_list.push_back ("OMX.Aratelia.audio_renderer.http");
   role_list.push_back ("audio_renderer.http");
 
   return new httpservops (this, comp_list, role_list);
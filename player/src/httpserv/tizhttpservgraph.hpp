@@ -29,6 +29,8 @@
 #ifndef TIZHTTPSERVGRAPH_HPP
 #define TIZHTTPSERVGRAPH_HPP
 
+#include <string>
+
 #include "tizgraph.hpp"
 #include "tizhttpservgraphfsm.hpp"
 
@@ -44,13 +46,16 @@ namespace tiz
     {
 
     public:
-      httpserver ();
+      httpserver (const std::string &source_format = std::string ("mp3"),
+                  const bool transcode = false);
 
     protected:
       ops *do_init ();
       bool dispatch_cmd (const tiz::graph::cmd *p_cmd);
 
     protected:
+      const std::string source_format_;
+      const bool transcode_;
       hsfsm::fsm fsm_;
     };
   }  // namespace graph
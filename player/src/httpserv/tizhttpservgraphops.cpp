@@ -55,6 +55,28 @@ namespace graph = tiz::graph;
 namespace
 {
   const OMX_U32 TIZ_DEFAULT_ICY_METADATA_INTERVAL = 8192;
+  // Transcoded streams are always produced at this rate, so that listeners
+  // don't see the sampling rate change from track to track.
+  const OMX_U32 TIZ_TRANSCODING_SAMPLE_RATE = 44100;
+  const OMX_U32 TIZ_TRANSCODING_DEFAULT_BITRATE_KBPS = 128;
+
+  int source_format_to_coding (const std::string &format)
+  {
+    int coding = OMX_AUDIO_CodingMP3;
+    if (format == "flac")
+    {
+      coding = OMX_AUDIO_CodingFLAC;
+    }
+    else if (format == "aac")
+    {
+      coding = OMX_AUDIO_CodingAAC;
+    }
+    else if (format == "opus")
+    {
+      coding = OMX_AUDIO_CodingOPUS;
+    }
+    return coding;
+  }
 }
 //
 // httpservops
@@ -69,10 +91,40 @@ graph::httpservops::httpservops (graph *p_graph,
 
 void graph::httpservops::do_probe ()
 {
-  G_OPS_BAIL_IF_ERROR (
-      probe_stream (OMX_PortDomainAudio, OMX_AUDIO_CodingMP3, "http/mp3",
-                    "server", &tiz::probe::dump_mp3_info),
-      "Unable to probe the stream.");
+  if (!is_initial_configuration_)
+  {
+    // Statistics are not essential; ignore errors.
+    (void)report_mount_stats ();
+  }
+
+  if (is_transcoding ())
+  {
+    tizhttpservconfig_ptr_t srv_config
+        = boost::dynamic_pointer_cast< httpservconfig >(config_);
+    assert (srv_config);
+    const std::string &format = srv_config->get_source_format ();
+    G_OPS_BAIL_IF_ERROR (
+        probe_stream (OMX_PortDomainAudio, source_format_to_coding (format),
+                      std::string ("http/").append (format), "transcode",
+                      &tiz::probe::dump_pcm_info),
+        "Unable to probe the stream.");
+  }
+  else
+  {
+    G_OPS_BAIL_IF_ERROR (
+        probe_stream (OMX_PortDomainAudio, OMX_AUDIO_CodingMP3, "http/mp3",
+                      "server", &tiz::probe::dump_mp3_info),
+        "Unable to probe the stream.");
+  }
+}
+
+void graph::httpservops::do_exe2idle ()
+{
+  if (last_op_succeeded ())
+  {
+    (void)report_mount_stats ();
+  }
+  tiz::graph::ops::do_exe2idle ();
 }
 
 void graph::httpservops::do_exe2pause ()
@@ -112,13 +164,22 @@ void graph::httpservops::do_configure_stream ()
   G_OPS_BAIL_IF_ERROR (
       tiz::graph::util::set_content_uri (handles_[0], probe_ptr_->get_uri ()),
       "Unable to set OMX_IndexParamContentURI");
-  bool need_port_settings_changed_evt = false;  // not needed here
-  G_OPS_BAIL_IF_ERROR (
-      tiz::graph::util::set_mp3_type (
-          handles_[1], 0,
-          boost::bind (&tiz::graph::httpservops::get_mp3_codec_info, this, _1),
-          need_port_settings_changed_evt),
-      "Unable to set OMX_IndexParamAudioMp3");
+  if (is_transcoding ())
+  {
+    G_OPS_BAIL_IF_ERROR (configure_transcoder (),
+                         "Unable to configure the transcoder.");
+  }
+  else
+  {
+    bool need_port_settings_changed_evt = false;  // not needed here
+    G_OPS_BAIL_IF_ERROR (
+        tiz::graph::util::set_mp3_type (
+            handles_[renderer_index ()], 0,
+            boost::bind (&tiz::graph::httpservops::get_mp3_codec_info, this,
+                         _1),
+            need_port_settings_changed_evt),
+        "Unable to set OMX_IndexParamAudioMp3");
+  }
   G_OPS_BAIL_IF_ERROR (configure_stream_metadata (),
                        "Unable to set OMX_TizoniaIndexConfigIcecastMetadata");
 }
@@ -144,18 +205,20 @@ graph::httpservops::configure_server ()
   httpsrv.nVersion.nVersion = OMX_VERSION;
 
   tiz_check_omx (OMX_GetParameter (
-      handles_[1],
+      handles_[renderer_index ()],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpServer), &httpsrv));
 
   tizhttpservconfig_ptr_t srv_config
       = boost::dynamic_pointer_cast< httpservconfig >(config_);
   assert (srv_config);
   httpsrv.nListeningPort = srv_config->get_port ();
-  httpsrv.nMaxClients = 1;  // the http renderer component supports only one
-  // client, for now
+  if (srv_config->get_max_listeners () > 0)
+  {
+    httpsrv.nMaxClients = srv_config->get_max_listeners ();
+  }
 
   return OMX_SetParameter (
-      handles_[1],
+      handles_[renderer_index ()],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpServer), &httpsrv);
 }
 
@@ -172,14 +235,16 @@ graph::httpservops::configure_station ()
   assert (srv_config);
 
   tiz_check_omx (OMX_GetParameter (
-      handles_[1],
+      handles_[renderer_index ()],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamIcecastMountpoint),
       &mount));
 
-  snprintf ((char *)mount.cMountName, sizeof(mount.cMountName), "/");
+  snprintf ((char *)mount.cMountName, sizeof(mount.cMountName), "%s",
+            srv_config->get_mount_name ().c_str ());
   snprintf ((char *)mount.cStationName, sizeof(mount.cStationName),
-            "%s (%s:%ld)", srv_config->get_station_name ().c_str (),
-            srv_config->get_host_name ().c_str (), srv_config->get_port ());
+            "%s (%s:%ld%s)", srv_config->get_station_name ().c_str (),
+            srv_config->get_host_name ().c_str (), srv_config->get_port (),
+            srv_config->get_mount_name ().c_str ());
   snprintf ((char *)mount.cStationDescription,
             sizeof(mount.cStationDescription),
             "Tizonia Streaming Server");
@@ -195,11 +260,89 @@ graph::httpservops::configure_station ()
            mount.nIcyMetadataPeriod);
 
   mount.eEncoding = OMX_AUDIO_CodingMP3;
-  mount.nMaxClients = 1;
-  return OMX_SetParameter (
-      handles_[1],
+  if (srv_config->get_max_listeners () > 0)
+  {
+    mount.nMaxClients = srv_config->get_max_listeners ();
+  }
+  tiz_check_omx (OMX_SetParameter (
+      handles_[renderer_index ()],
       static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamIcecastMountpoint),
-      &mount);
+      &mount));
+
+  // The renderer keeps segmenting disabled unless asked otherwise
+  if (srv_config->get_hls_segment_ms () <= 0)
+  {
+    return OMX_ErrorNone;
+  }
+
+  OMX_TIZONIA_HTTPSEGMENTERTYPE segmenter;
+  segmenter.nSize = sizeof(OMX_TIZONIA_HTTPSEGMENTERTYPE);
+  segmenter.nVersion.nVersion = OMX_VERSION;
+  segmenter.nPortIndex = 0;
+
+  tiz_check_omx (OMX_GetParameter (
+      handles_[renderer_index ()],
+      static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpSegmenter),
+      &segmenter));
+
+  segmenter.bEnabled = OMX_TRUE;
+  segmenter.nSegmentDurationMs = srv_config->get_hls_segment_ms ();
+  segmenter.nWindowSegments = srv_config->get_hls_window ();
+  return OMX_SetParameter (
+      handles_[renderer_index ()],
+      static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexParamHttpSegmenter),
+      &segmenter);
+}
+
+OMX_ERRORTYPE
+graph::httpservops::configure_transcoder ()
+{
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+
+  const int decoder_index = 1;
+  const int encoder_index = 2;
+  const std::string &format = srv_config->get_source_format ();
+  bool need_port_settings_changed_evt = false;  // not needed here
+
+  if (format == "flac")
+  {
+    tiz_check_omx (tiz::graph::util::set_flac_type (
+        handles_[decoder_index], 0,
+        boost::bind (&tiz::probe::get_flac_codec_info, probe_ptr_, _1),
+        need_port_settings_changed_evt));
+  }
+  else if (format == "aac")
+  {
+    tiz_check_omx (tiz::graph::util::set_aac_type (
+        handles_[decoder_index], 0,
+        boost::bind (&tiz::probe::get_aac_codec_info, probe_ptr_, _1),
+        need_port_settings_changed_evt));
+  }
+  else if (format == "mp3")
+  {
+    tiz_check_omx (tiz::graph::util::set_mp3_type (
+        handles_[decoder_index], 0,
+        boost::bind (&tiz::probe::get_mp3_codec_info, probe_ptr_, _1),
+        need_port_settings_changed_evt));
+  }
+
+  // The encoder takes the decoder's pcm as is, and resamples it if needed
+  tiz_check_omx (tiz::graph::util::set_pcm_mode (
+      handles_[encoder_index], 0,
+      boost::bind (&tiz::probe::get_pcm_codec_info, probe_ptr_, _1)));
+
+  const OMX_U32 encoder_output_port = 1;
+  tiz_check_omx (tiz::graph::util::set_mp3_type (
+      handles_[encoder_index], encoder_output_port,
+      boost::bind (&tiz::graph::httpservops::get_encoder_mp3_info, this, _1),
+      need_port_settings_changed_evt));
+
+  return tiz::graph::util::set_mp3_type (
+      handles_[renderer_index ()], 0,
+      boost::bind (&tiz::graph::httpservops::get_encoder_mp3_info, this, _1),
+      need_port_settings_changed_evt);
 }
 
 OMX_ERRORTYPE
@@ -231,7 +374,7 @@ graph::httpservops::configure_stream_metadata ()
     TIZ_LOG (TIZ_PRIORITY_TRACE, "p_metadata->cStreamTitle [%s]...",
              p_metadata->cStreamTitle);
 
-    rc = OMX_SetConfig (handles_[1], static_cast< OMX_INDEXTYPE >(
+    rc = OMX_SetConfig (handles_[renderer_index ()], static_cast< OMX_INDEXTYPE >(
                                          OMX_TizoniaIndexConfigIcecastMetadata),
                         p_metadata);
 
@@ -242,6 +385,63 @@ graph::httpservops::configure_stream_metadata ()
   return rc;
 }
 
+OMX_ERRORTYPE
+graph::httpservops::report_mount_stats ()
+{
+  OMX_TIZONIA_ICECASTMOUNTSTATSTYPE stats;
+  TIZ_INIT_OMX_PORT_STRUCT (stats, 0);
+
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+
+  tiz_check_omx (OMX_GetConfig (
+      handles_[renderer_index ()],
+      static_cast< OMX_INDEXTYPE >(OMX_TizoniaIndexConfigIcecastMountStats),
+      &stats));
+
+  TIZ_PRINTF_CYN (
+      "     Mount %s : %u listeners (peak %u, max %u), %u rejected, "
+      "%llu bytes sent, %u underruns\n",
+      srv_config->get_mount_name ().c_str (), (unsigned int)stats.nListeners,
+      (unsigned int)stats.nPeakListeners, (unsigned int)stats.nMaxListeners,
+      (unsigned int)stats.nRejected, (unsigned long long)stats.nBytesSent,
+      (unsigned int)stats.nUnderruns);
+
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+graph::httpservops::transition_comp (const int comp_id,
+                                     const OMX_STATETYPE to_state)
+{
+  if (0 != comp_id || !is_transcoding ())
+  {
+    return tiz::graph::ops::transition_comp (comp_id, to_state);
+  }
+
+  // In a transcoding graph, the reader, the decoder and the encoder are cycled
+  // together from one track to the next, while the renderer keeps serving its
+  // listeners.
+  OMX_STATETYPE from_state = OMX_StateMax;
+  tiz_check_omx (OMX_GetState (handles_[0], &from_state));
+
+  omx_comp_handle_lst_t hdl_list (handles_.begin (),
+                                  handles_.begin () + renderer_index ());
+  OMX_ERRORTYPE rc
+      = tiz::graph::util::transition_all (hdl_list, to_state, from_state);
+  if (OMX_ErrorNone == rc)
+  {
+    clear_expected_transitions ();
+    for (omx_comp_handle_lst_t::const_iterator it = hdl_list.begin ();
+         it != hdl_list.end (); ++it)
+    {
+      add_expected_transition (*it, to_state);
+    }
+  }
+  return rc;
+}
+
 OMX_ERRORTYPE
 graph::httpservops::switch_tunnel (const int tunnel_id,
     const OMX_COMMANDTYPE to_disabled_or_enabled)
@@ -251,24 +451,29 @@ graph::httpservops::switch_tunnel (const int tunnel_id,
   assert (to_disabled_or_enabled == OMX_CommandPortDisable
           || to_disabled_or_enabled == OMX_CommandPortEnable);
 
+  // The graph fsm only ever switches the tunnel that feeds the renderer; in a
+  // transcoding graph, that is the last one.
+  const int renderer_tunnel_id
+      = is_transcoding () ? renderer_index () - 1 : tunnel_id;
+
   if (to_disabled_or_enabled == OMX_CommandPortDisable)
   {
-    rc = tiz::graph::util::disable_tunnel (handles_, tunnel_id);
+    rc = tiz::graph::util::disable_tunnel (handles_, renderer_tunnel_id);
   }
   else
   {
-    rc = tiz::graph::util::enable_tunnel (handles_, tunnel_id);
+    rc = tiz::graph::util::enable_tunnel (handles_, renderer_tunnel_id);
   }
 
   if (OMX_ErrorNone == rc)
   {
     clear_expected_port_transitions ();
-    const int file_reader_index = 0;
-    const int file_reader_input_port = 0;
-    add_expected_port_transition (handles_[file_reader_index],
-                                  file_reader_input_port,
+    const int source_index = renderer_tunnel_id;
+    const int source_output_port = (0 == renderer_tunnel_id ? 0 : 1);
+    add_expected_port_transition (handles_[source_index],
+                                  source_output_port,
                                   to_disabled_or_enabled);
-    const int http_renderer_index = 1;
+    const int http_renderer_index = renderer_index ();
     const int http_renderer_input_port = 0;
     add_expected_port_transition (handles_[http_renderer_index],
                                   http_renderer_input_port,
@@ -277,6 +482,17 @@ graph::httpservops::switch_tunnel (const int tunnel_id,
   return rc;
 }
 
+bool graph::httpservops::is_transcoding () const
+{
+  // file reader, decoder, encoder and renderer
+  return handles_.size () > 2;
+}
+
+int graph::httpservops::renderer_index () const
+{
+  return handles_.size () - 1;
+}
+
 void graph::httpservops::get_mp3_codec_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type)
 {
   if (probe_ptr_)
@@ -293,10 +509,43 @@ void graph::httpservops::get_mp3_codec_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type)
     }
 }
 
+void graph::httpservops::get_encoder_mp3_info (
+    OMX_AUDIO_PARAM_MP3TYPE &mp3type)
+{
+  tizhttpservconfig_ptr_t srv_config
+      = boost::dynamic_pointer_cast< httpservconfig >(config_);
+  assert (srv_config);
+
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (pcmtype, 0);
+  if (probe_ptr_)
+  {
+    probe_ptr_->get_pcm_codec_info (pcmtype);
+  }
+
+  const OMX_U32 kbps = srv_config->get_bitrate () > 0
+                           ? srv_config->get_bitrate ()
+                           : TIZ_TRANSCODING_DEFAULT_BITRATE_KBPS;
+  mp3type.nChannels = (1 == pcmtype.nChannels ? 1 : 2);
+  mp3type.nBitRate = kbps * 1000;
+  mp3type.nSampleRate = TIZ_TRANSCODING_SAMPLE_RATE;
+  mp3type.nAudioBandWidth = 0;
+  mp3type.eChannelMode
+      = (1 == mp3type.nChannels ? OMX_AUDIO_ChannelModeMono
+                                : OMX_AUDIO_ChannelModeStereo);
+  mp3type.eFormat = OMX_AUDIO_MP3StreamFormatMP1Layer3;
+}
+
 bool graph::httpservops::probe_stream_hook ()
 {
   bool rc = false;
-  if (probe_ptr_ && config_)
+  if (probe_ptr_ && config_ && is_transcoding ())
+  {
+    // The rate and bitrate mode filters apply to the mp3 files served as
+    // they are; transcoded streams are normalised by the encoder.
+    rc = true;
+  }
+  else if (probe_ptr_ && config_)
   {
     tizhttpservconfig_ptr_t srv_config
         = boost::dynamic_pointer_cast< httpservconfig >(config_);
@@ -45,6 +45,7 @@ namespace tiz
 
     public:
       void do_probe ();
+      void do_exe2idle ();
       void do_exe2pause ();
       void do_pause2exe ();
       void do_volume (const int step);
@@ -59,12 +60,19 @@ namespace tiz
     private:
       OMX_ERRORTYPE configure_server ();
       OMX_ERRORTYPE configure_station ();
+      OMX_ERRORTYPE configure_transcoder ();
       OMX_ERRORTYPE configure_stream_metadata ();
+      OMX_ERRORTYPE report_mount_stats ();
+      OMX_ERRORTYPE transition_comp (const int comp_id,
+                                     const OMX_STATETYPE to_state);
       OMX_ERRORTYPE switch_tunnel (const int tunnel_id,
           const OMX_COMMANDTYPE to_disabled_or_enabled);
 
     private:
+      bool is_transcoding () const;
+      int renderer_index () const;
       void get_mp3_codec_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type);
+      void get_encoder_mp3_info (OMX_AUDIO_PARAM_MP3TYPE &mp3type);
       // re-implemented from the base class
       bool probe_stream_hook ();
 
@@ -37,6 +37,7 @@
 #include <tizplatform.h>
 
 #include <tizgraphmgrcaps.hpp>
+#include "tizhttpservconfig.hpp"
 #include "tizhttpservgraph.hpp"
 #include "tizhttpservmgr.hpp"
 
@@ -106,7 +107,14 @@ tizgraph_ptr_t graphmgr::httpservmgrops::get_graph (
   tizgraph_ptr_map_t::const_iterator it = graph_registry_.find (encoding);
   if (it == graph_registry_.end ())
   {
-    g_ptr = boost::make_shared< tiz::graph::httpserver >();
+    httpservmgr *p_servermgr = dynamic_cast< httpservmgr * >(p_mgr_);
+    assert (p_servermgr);
+    tizhttpservconfig_ptr_t srv_config
+        = boost::dynamic_pointer_cast< tiz::graph::httpservconfig >(
+            p_servermgr->config_);
+    assert (srv_config);
+    g_ptr = boost::make_shared< tiz::graph::httpserver >(
+        srv_config->get_source_format (), srv_config->is_transcoding ());
     if (g_ptr)
     {
       // TODO: Check rc
@@ -76,17 +76,31 @@ const char *control::mprisif::TIZONIA_MPRIS_OBJECT_PATH
 control::mprisif::mprisif (Tiz::DBus::Connection &connection,
                            mpris_mediaplayer2_props_t props,
                            mpris_mediaplayer2_player_props_t player_props,
-                           mpris_callbacks_t cbacks)
+                           mpris_callbacks_t cbacks,
+                           position_func_t position)
   : Tiz::DBus::ObjectAdaptor (connection, TIZONIA_MPRIS_OBJECT_PATH),
     props_ (props),
     player_props_ (player_props),
-    cbacks_ (cbacks)
+    cbacks_ (cbacks),
+    position_ (position)
 {
   TIZ_LOG (TIZ_PRIORITY_DEBUG, "Constructing mprisif...");
   UpdateProps (props_);
   UpdatePlayerProps (player_props_);
 }
 
+void control::mprisif::on_get_property (Tiz::DBus::InterfaceAdaptor &interface,
+                                        const std::string &property,
+                                        Tiz::DBus::Variant &value)
+{
+  // Position is never signalled (as per the MPRIS spec); it is refreshed
+  // here, in the variant that is about to be returned to the client.
+  if (property == "Position" && position_)
+  {
+    Position = position_ ();
+  }
+}
+
 void control::mprisif::on_set_property (Tiz::DBus::InterfaceAdaptor &interface,
                                         const std::string &property,
                                         const Tiz::DBus::Variant &value)
@@ -195,3 +209,34 @@ void control::mprisif::UpdatePlayerProps (
   CanSeek = props.can_seek_;
   CanControl = props.can_control_;
 }
+
+void control::mprisif::EmitPropertiesChanged (
+    const std::string &interface_name,
+    const std::set< std::string > &properties)
+{
+  Tiz::DBus::InterfaceAdaptor *p_interface = find_interface (interface_name);
+  if (!p_interface)
+  {
+    return;
+  }
+
+  std::map< std::string, Tiz::DBus::Variant > changed;
+  BOOST_FOREACH (const std::string &property, properties)
+  {
+    const Tiz::DBus::Variant *p_value = p_interface->get_property (property);
+    if (p_value)
+    {
+      changed.insert (std::make_pair (property, *p_value));
+    }
+  }
+
+  if (!changed.empty ())
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "PropertiesChanged [%s] : %u properties",
+             interface_name.c_str (), (unsigned int)changed.size ());
+    Tiz::DBus::SignalMessage sig ("PropertiesChanged");
+    Tiz::DBus::MessageIter wi = sig.writer ();
+    wi << interface_name << changed << std::vector< std::string > ();
+    Tiz::DBus::PropertiesAdaptor::emit_signal (sig);
+  }
+}
@@ -29,6 +29,12 @@
 #ifndef TIZMPRISIF_HPP
 #define TIZMPRISIF_HPP
 
+#include <stdint.h>
+#include <set>
+#include <string>
+
+#include <boost/function.hpp>
+
 #include <dbus-c++/dbus.h>
 
 #include <mpris_dbus.hpp>
@@ -57,17 +63,25 @@ namespace tiz
     public:
       static const char * TIZONIA_MPRIS_OBJECT_PATH;
 
+    public:
+      typedef boost::function< int64_t () > position_func_t;
+
     public:
       mprisif (Tiz::DBus::Connection &connection,
                mpris_mediaplayer2_props_t props,
                mpris_mediaplayer2_player_props_t player_props,
-               mpris_callbacks_t cbacks);
+               mpris_callbacks_t cbacks,
+               position_func_t position);
 
+      void on_get_property
+      (Tiz::DBus::InterfaceAdaptor &interface, const std::string &property, Tiz::DBus::Variant &value);
       void on_set_property
       (Tiz::DBus::InterfaceAdaptor &interface, const std::string &property, const Tiz::DBus::Variant &value);
 
       void UpdateProps (const mpris_mediaplayer2_props_t &props);
       void UpdatePlayerProps (const mpris_mediaplayer2_player_props_t &props);
+      void EmitPropertiesChanged (const std::string &interface_name,
+                                  const std::set< std::string > &properties);
 
       /* Methods exported by the MediaPlayer2_adaptor */
       void Raise();
@@ -88,6 +102,7 @@ namespace tiz
       mpris_mediaplayer2_props_t props_;
       mpris_mediaplayer2_player_props_t player_props_;
       mpris_callbacks_t cbacks_;
+      position_func_t position_;
     };
   }  // namespace control
 }  // namespace tiz
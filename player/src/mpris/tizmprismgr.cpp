@@ -31,8 +31,10 @@
 
 #include <assert.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <boost/foreach.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
@@ -61,7 +63,8 @@ namespace
   // Bus name
   const char *TIZONIA_MPRIS_BUS_NAME = "org.mpris.MediaPlayer2.tizonia";
 
-  tiz::control::mpris_mediaplayer2_player_props_t * gp_player_props = NULL;
+  // Interface that holds the properties that change during playback
+  const char *TIZONIA_MPRIS_PLAYER_INTERFACE = "org.mpris.MediaPlayer2.Player";
 
   std::string get_unique_bus_name ()
   {
@@ -72,14 +75,11 @@ namespace
     return bus_name;
   }
 
-  void player_props_pipe_handler (const void *p_arg, void *p_buffer,
-                                  unsigned int nbyte)
+  int64_t monotonic_now_us ()
   {
-    tiz::control::mprisif * p_mif = static_cast< tiz::control::mprisif * >(const_cast<void *>(p_arg));
-    if  (p_mif && gp_player_props)
-      {
-        p_mif->UpdatePlayerProps (*gp_player_props);
-      }
+    struct timespec ts;
+    (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
   }
 
 }
@@ -120,27 +120,33 @@ void *control::thread_func (void *p_arg)
 control::mprismgr::mprismgr (const mpris_mediaplayer2_props_t &props,
                              const mpris_mediaplayer2_player_props_t &player_props,
                              const mpris_callbacks_t &cbacks,
-                             playback_events_t &playback_events)
+                             playback_events_t &playback_events,
+                             const int update_interval_ms)
   : props_ (props),
     player_props_ (player_props),
     cbacks_ (cbacks),
+    update_interval_ms_ (update_interval_ms),
     p_dispatcher_ (NULL),
     p_player_props_pipe_ (NULL),
     p_dbus_timeout_ (NULL),
     p_dbus_connection_ (NULL),
+    p_mif_ (NULL),
     playback_connections_ (),
     thread_ (),
     mutex_ (),
     sem_ (),
-    p_queue_ (NULL)
+    p_queue_ (NULL),
+    props_mutex_ (),
+    changed_props_ (),
+    emit_requested_ (false),
+    position_us_ (0),
+    playing_since_us_ (-1)
 {
-  gp_player_props = &player_props_;
   connect_slots (playback_events);
 }
 
 control::mprismgr::~mprismgr ()
 {
-  gp_player_props = NULL;
   delete p_dbus_timeout_;
   p_dbus_timeout_ = NULL;
   // NOTE: We need to leak this object. Its deletion produces a crash in
@@ -201,22 +207,33 @@ void control::mprismgr::deinit ()
 
 void control::mprismgr::playback_status_changed (const playback_status_t status)
 {
-  if (p_player_props_pipe_)
+  const int64_t now_us = monotonic_now_us ();
+  (void)tiz_mutex_lock (&props_mutex_);
+  if (control::Playing == status)
     {
-      if (control::Playing == status)
+      player_props_.playback_status_ = "Playing";
+      if (playing_since_us_ < 0)
         {
-          player_props_.playback_status_ = "Playing";
+          playing_since_us_ = now_us;
         }
-      else if (control::Paused == status)
-        {
-          player_props_.playback_status_ = "Paused";
-        }
-      else if (control::Stopped == status)
+    }
+  else if (control::Paused == status)
+    {
+      player_props_.playback_status_ = "Paused";
+      if (playing_since_us_ >= 0)
         {
-          player_props_.playback_status_ = "Stopped";
+          position_us_ += now_us - playing_since_us_;
+          playing_since_us_ = -1;
         }
-      p_player_props_pipe_->write(&player_props_, sizeof (player_props_));
     }
+  else if (control::Stopped == status)
+    {
+      player_props_.playback_status_ = "Stopped";
+      position_us_ = 0;
+      playing_since_us_ = -1;
+    }
+  property_changed (TIZONIA_MPRIS_PLAYER_INTERFACE, "PlaybackStatus");
+  (void)tiz_mutex_unlock (&props_mutex_);
 }
 
 void control::mprismgr::loop_status_changed (const loop_status_t status)
@@ -226,15 +243,101 @@ void control::mprismgr::loop_status_changed (const loop_status_t status)
 
 void control::mprismgr::metadata_changed (const track_metadata_map_t &metadata)
 {
+  // A new track has started; the position clock starts over.
+  const int64_t now_us = monotonic_now_us ();
+  (void)tiz_mutex_lock (&props_mutex_);
+  position_us_ = 0;
+  if (playing_since_us_ >= 0)
+    {
+      playing_since_us_ = now_us;
+    }
   // TODO
   //   player_props_.metadata_ = metadata;
-  //   p_player_props_pipe_->write(&player_props_, sizeof (player_props_));
+  //   property_changed (TIZONIA_MPRIS_PLAYER_INTERFACE, "Metadata");
+  (void)tiz_mutex_unlock (&props_mutex_);
 }
 
 void control::mprismgr::volume_changed (const double volume)
 {
+  (void)tiz_mutex_lock (&props_mutex_);
   player_props_.volume_ = volume;
-  p_player_props_pipe_->write(&player_props_, sizeof (player_props_));
+  property_changed (TIZONIA_MPRIS_PLAYER_INTERFACE, "Volume");
+  (void)tiz_mutex_unlock (&props_mutex_);
+}
+
+// Returns the playback position in microseconds, as measured by the time the
+// renderer has spent playing the current track.
+int64_t control::mprismgr::position ()
+{
+  int64_t position_us = 0;
+  const int64_t now_us = monotonic_now_us ();
+  (void)tiz_mutex_lock (&props_mutex_);
+  position_us = position_us_;
+  if (playing_since_us_ >= 0)
+    {
+      position_us += now_us - playing_since_us_;
+    }
+  (void)tiz_mutex_unlock (&props_mutex_);
+  return position_us;
+}
+
+// NOTE: The props mutex must be held by the caller
+void control::mprismgr::property_changed (const char *ap_interface,
+                                          const char *ap_property)
+{
+  assert (ap_interface);
+  assert (ap_property);
+  changed_props_[ap_interface].insert (ap_property);
+}
+
+// Runs on the dispatcher thread, every update interval. The signal is not
+// emitted from here, because the dispatcher holds its timeout list lock while
+// running this; the pipe handler emits it once this iteration completes.
+void control::mprismgr::update_timeout_expired (
+    Tiz::DBus::DefaultTimeout &timeout)
+{
+  bool request = false;
+  (void)tiz_mutex_lock (&props_mutex_);
+  request = (!changed_props_.empty () && !emit_requested_);
+  emit_requested_ = emit_requested_ || request;
+  (void)tiz_mutex_unlock (&props_mutex_);
+
+  if (request && p_player_props_pipe_)
+    {
+      const char req = 0;
+      p_player_props_pipe_->write (&req, sizeof (req));
+    }
+}
+
+void control::mprismgr::emit_changed_props ()
+{
+  changed_props_map_t changed_props;
+  (void)tiz_mutex_lock (&props_mutex_);
+  changed_props.swap (changed_props_);
+  emit_requested_ = false;
+  const mpris_mediaplayer2_player_props_t player_props (player_props_);
+  (void)tiz_mutex_unlock (&props_mutex_);
+
+  if (p_mif_)
+    {
+      p_mif_->UpdatePlayerProps (player_props);
+      BOOST_FOREACH (const changed_props_map_t::value_type &changed,
+                     changed_props)
+        {
+          p_mif_->EmitPropertiesChanged (changed.first, changed.second);
+        }
+    }
+}
+
+void control::mprismgr::changed_props_pipe_handler (const void *p_arg,
+                                                    void *p_buffer,
+                                                    unsigned int nbyte)
+{
+  mprismgr *p_mgr = static_cast< mprismgr * >(const_cast< void * >(p_arg));
+  if (p_mgr)
+    {
+      p_mgr->emit_changed_props ();
+    }
 }
 
 OMX_ERRORTYPE
@@ -243,6 +346,7 @@ control::mprismgr::init_cmd_queue ()
   tiz_check_omx_ret_oom (tiz_mutex_init (&mutex_));
   tiz_check_omx_ret_oom (tiz_sem_init (&sem_, 0));
   tiz_check_omx_ret_oom (tiz_queue_init (&p_queue_, TIZ_MPRISMGR_QUEUE_MAX_ITEMS));
+  tiz_check_omx_ret_oom (tiz_mutex_init (&props_mutex_));
   return OMX_ErrorNone;
 }
 
@@ -251,6 +355,7 @@ void control::mprismgr::deinit_cmd_queue ()
   tiz_mutex_destroy (&mutex_);
   tiz_sem_destroy (&sem_);
   tiz_queue_destroy (p_queue_);
+  tiz_mutex_destroy (&props_mutex_);
 }
 
 OMX_ERRORTYPE
@@ -279,16 +384,23 @@ bool control::mprismgr::dispatch_cmd (control::mprismgr *p_mgr,
     {
       TIZ_LOG (TIZ_PRIORITY_TRACE, "MPRIS processing START cmd...");
       Tiz::DBus::default_dispatcher = p_mgr->p_dispatcher_;
-      p_mgr->p_dbus_timeout_
-          = new Tiz::DBus::DefaultTimeout (100, false, p_mgr->p_dispatcher_);
+      p_mgr->p_dbus_timeout_ = new Tiz::DBus::DefaultTimeout (
+          p_mgr->update_interval_ms_, true, p_mgr->p_dispatcher_);
+      p_mgr->p_dbus_timeout_->expired
+          = new Tiz::DBus::Callback< mprismgr, void,
+                                     Tiz::DBus::DefaultTimeout & >(
+              p_mgr, &mprismgr::update_timeout_expired);
       p_mgr->p_dbus_connection_
           = new Tiz::DBus::Connection (Tiz::DBus::Connection::SessionBus ());
       p_mgr->p_dbus_connection_->request_name (get_unique_bus_name ().c_str ());
       mprisif mif (*(p_mgr->p_dbus_connection_), p_mgr->props_,
-                   p_mgr->player_props_, p_mgr->cbacks_);
-      p_mgr->p_player_props_pipe_
-          = p_mgr->p_dispatcher_->add_pipe (player_props_pipe_handler, &mif);
+                   p_mgr->player_props_, p_mgr->cbacks_,
+                   boost::bind (&mprismgr::position, p_mgr));
+      p_mgr->p_mif_ = &mif;
+      p_mgr->p_player_props_pipe_ = p_mgr->p_dispatcher_->add_pipe (
+          changed_props_pipe_handler, p_mgr);
       p_mgr->p_dispatcher_->enter ();
+      p_mgr->p_mif_ = NULL;
       TIZ_LOG (TIZ_PRIORITY_TRACE, "MPRIS dispatcher done...");
     }
     else if (p_cmd->is_stop ())
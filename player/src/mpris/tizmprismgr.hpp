@@ -30,6 +30,8 @@
 #define TIZMPRISMGR_HPP
 
 #include <stdint.h>
+#include <map>
+#include <set>
 #include <string>
 
 #include <boost/function.hpp>
@@ -63,6 +65,7 @@ namespace tiz
 
     // Forward declarations
     void *thread_func (void *p_arg);
+    class mprisif;
 
     struct cmd
     {
@@ -101,6 +104,9 @@ namespace tiz
      *
      *  A graph manager uses this class to instantiate an MPRIS control
      *  interface.
+     *
+     *  Property changes are merged per D-Bus interface and published with at
+     *  most one PropertiesChanged signal per update interval.
      */
     class mprismgr
     {
@@ -110,7 +116,8 @@ namespace tiz
       mprismgr (const mpris_mediaplayer2_props_t &props,
                 const mpris_mediaplayer2_player_props_t &player_props,
                 const mpris_callbacks_t &cbacks,
-                playback_events_t &playback_events);
+                playback_events_t &playback_events,
+                const int update_interval_ms);
       virtual ~mprismgr ();
 
       /**
@@ -163,15 +170,24 @@ namespace tiz
       void loop_status_changed (const loop_status_t status);
       void metadata_changed (const track_metadata_map_t &metadata);
       void volume_changed (const double volume);
+      int64_t position ();
 
     protected:
       mpris_mediaplayer2_props_t props_;
       mpris_mediaplayer2_player_props_t player_props_;
       const mpris_callbacks_t cbacks_;
+      const int update_interval_ms_;
       Tiz::DBus::BusDispatcher *p_dispatcher_;
       Tiz::DBus::Pipe *p_player_props_pipe_; // Not owned
       Tiz::DBus::DefaultTimeout *p_dbus_timeout_;
       Tiz::DBus::Connection *p_dbus_connection_;
+      mprisif *p_mif_; // Not owned
+
+    private:
+      // Interface name -> names of the properties changed since the last
+      // PropertiesChanged signal
+      typedef std::map< std::string, std::set< std::string > >
+          changed_props_map_t;
 
     private:
       OMX_ERRORTYPE init_cmd_queue ();
@@ -180,6 +196,12 @@ namespace tiz
       static bool dispatch_cmd (mprismgr *p_mgr, const cmd *p_cmd);
       void connect_slots (playback_events_t &playback_events);
       void disconnect_slots ();
+      void property_changed (const char *ap_interface, const char *ap_property);
+      void update_timeout_expired (Tiz::DBus::DefaultTimeout &timeout);
+      void emit_changed_props ();
+      static void changed_props_pipe_handler (const void *p_arg,
+                                              void *p_buffer,
+                                              unsigned int nbyte);
 
     private:
       struct playback_connections
@@ -206,6 +228,15 @@ namespace tiz
       tiz_mutex_t mutex_;
       tiz_sem_t sem_;
       tiz_queue_t *p_queue_;
+
+    private:
+      // Guards the player properties, the changed properties and the
+      // position clock, which are updated from the graph manager's thread
+      tiz_mutex_t props_mutex_;
+      changed_props_map_t changed_props_;
+      bool emit_requested_;
+      int64_t position_us_;
+      int64_t playing_since_us_;
     };
 
     typedef boost::shared_ptr< mprismgr > mprismgr_ptr_t;
@@ -343,7 +343,8 @@ graphmgr::mgr::start_mpris (const graphmgr_capabilities_t &graphmgr_caps)
     // signals, not to the original signals.
     mpris_ptr_
         = boost::shared_ptr< tiz::control::mprismgr >(new tiz::control::mprismgr (
-            props, player_props, mpris_cbacks, playback_events_));
+            props, player_props, mpris_cbacks, playback_events_,
+            graph::util::get_mpris_update_interval ()));
     tiz_check_null_ret_oom (mpris_ptr_);
 
     tiz_check_omx (mpris_ptr_->init ());
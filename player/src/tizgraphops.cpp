@@ -1012,6 +1012,15 @@ graph::ops::probe_stream (const OMX_PORTDOMAINTYPE omx_domain,
         do_ack_metadata ();
       }
 
+      // Hand the stream's ReplayGain/R128 gains to the renderer. Not every
+      // renderer does loudness normalisation, so errors are ignored.
+      if (!handles_.empty ())
+      {
+        const OMX_U32 input_port = 0;
+        (void)util::apply_loudness_gains (handles_[handles_.size () - 1],
+                                          input_port, probe_ptr_);
+      }
+
       // Everything went well..
       rc = OMX_ErrorNone;
     }
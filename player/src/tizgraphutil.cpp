@@ -30,6 +30,7 @@
 #endif
 
 #include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
 #include <string>
 
 #include <OMX_Component.h>
@@ -39,6 +40,7 @@
 #include <tizplatform.h>
 
 #include "tizgraphutil.hpp"
+#include "tizprobe.hpp"
 #include "tizomxutil.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -46,6 +48,9 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.play.graph.utils"
 #endif
 
+// The minimum time between two MPRIS property change notifications
+#define TIZ_MPRIS_DEFAULT_UPDATE_INTERVAL_MS 200
+
 namespace graph = tiz::graph;
 
 namespace  // Unnamed namespace
@@ -557,6 +562,34 @@ graph::util::apply_playlist_jump (const OMX_HANDLETYPE handle,
   return rc;
 }
 
+OMX_ERRORTYPE
+graph::util::apply_loudness_gains (const OMX_HANDLETYPE handle,
+                                   const OMX_U32 pid,
+                                   const tizprobe_ptr_t &probe_ptr)
+{
+  OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE loudness;
+  double gain_db = 0.0;
+  double peak = 0.0;
+  assert (probe_ptr);
+  TIZ_INIT_OMX_PORT_STRUCT (loudness, pid);
+  tiz_check_omx (OMX_GetConfig (
+      handle,
+      static_cast< OMX_INDEXTYPE > (OMX_TizoniaIndexConfigAudioLoudness),
+      &loudness));
+  loudness.bTrackGain
+      = probe_ptr->track_gain (gain_db, peak) ? OMX_TRUE : OMX_FALSE;
+  loudness.nTrackGainmB = static_cast< OMX_S32 > (gain_db * 100.0);
+  loudness.nTrackPeak = static_cast< OMX_U32 > (peak * 65536.0);
+  loudness.bAlbumGain
+      = probe_ptr->album_gain (gain_db, peak) ? OMX_TRUE : OMX_FALSE;
+  loudness.nAlbumGainmB = static_cast< OMX_S32 > (gain_db * 100.0);
+  loudness.nAlbumPeak = static_cast< OMX_U32 > (peak * 65536.0);
+  return OMX_SetConfig (
+      handle,
+      static_cast< OMX_INDEXTYPE > (OMX_TizoniaIndexConfigAudioLoudness),
+      &loudness);
+}
+
 OMX_ERRORTYPE
 graph::util::disable_port (const OMX_HANDLETYPE handle, const OMX_U32 port_id)
 {
@@ -663,6 +696,40 @@ graph::util::set_pcm_mode (
   return OMX_ErrorNone;
 }
 
+OMX_ERRORTYPE
+graph::util::copy_pcm_sample_format (const OMX_HANDLETYPE src_handle,
+                                     const OMX_U32 src_port_id,
+                                     const OMX_HANDLETYPE dst_handle,
+                                     const OMX_U32 dst_port_id)
+{
+  // The sample width goes first; the destination port validates the sample
+  // format against it
+  OMX_AUDIO_PARAM_PCMMODETYPE src_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (src_pcmtype, src_port_id);
+  tiz_check_omx (
+      OMX_GetParameter (src_handle, OMX_IndexParamAudioPcm, &src_pcmtype));
+
+  OMX_AUDIO_PARAM_PCMMODETYPE dst_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (dst_pcmtype, dst_port_id);
+  tiz_check_omx (
+      OMX_GetParameter (dst_handle, OMX_IndexParamAudioPcm, &dst_pcmtype));
+  dst_pcmtype.nBitPerSample = src_pcmtype.nBitPerSample;
+  tiz_check_omx (
+      OMX_SetParameter (dst_handle, OMX_IndexParamAudioPcm, &dst_pcmtype));
+
+  OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE format;
+  TIZ_INIT_OMX_PORT_STRUCT (format, src_port_id);
+  tiz_check_omx (OMX_GetParameter (
+      src_handle,
+      static_cast< OMX_INDEXTYPE > (OMX_TizoniaIndexParamAudioSampleFormat),
+      &format));
+  format.nPortIndex = dst_port_id;
+  return OMX_SetParameter (
+      dst_handle,
+      static_cast< OMX_INDEXTYPE > (OMX_TizoniaIndexParamAudioSampleFormat),
+      &format);
+}
+
 OMX_ERRORTYPE
 graph::util::set_mp3_type (
     const OMX_HANDLETYPE handle, const OMX_U32 port_id,
@@ -1072,6 +1139,29 @@ bool graph::util::is_mpris_enabled ()
   return is_enabled;
 }
 
+int graph::util::get_mpris_update_interval ()
+{
+  int interval_ms = TIZ_MPRIS_DEFAULT_UPDATE_INTERVAL_MS;
+  const char *p_interval
+      = tiz_rcfile_get_value ("tizonia", "mpris-update-interval");
+  if (p_interval)
+  {
+    try
+    {
+      interval_ms = boost::lexical_cast< int >(p_interval);
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+      interval_ms = TIZ_MPRIS_DEFAULT_UPDATE_INTERVAL_MS;
+    }
+    if (interval_ms <= 0)
+    {
+      interval_ms = TIZ_MPRIS_DEFAULT_UPDATE_INTERVAL_MS;
+    }
+  }
+  return interval_ms;
+}
+
 void graph::util::copy_omx_string (
     OMX_U8 *p_dest, const std::string &omx_string,
     const size_t max_length /*  = OMX_MAX_STRINGNAME_SIZE */
@@ -120,6 +120,10 @@ namespace tiz
       static OMX_ERRORTYPE apply_playlist_jump (const OMX_HANDLETYPE handle,
                                                 const OMX_S32 jump);
 
+      static OMX_ERRORTYPE apply_loudness_gains (
+          const OMX_HANDLETYPE handle, const OMX_U32 pid,
+          const tizprobe_ptr_t &probe_ptr);
+
       static OMX_ERRORTYPE disable_port (const OMX_HANDLETYPE handle,
                                          const OMX_U32 port_id);
       static OMX_ERRORTYPE enable_port (const OMX_HANDLETYPE handle,
@@ -165,6 +169,10 @@ namespace tiz
           const OMX_HANDLETYPE handle, const OMX_U32 port_id,
           boost::function< void(OMX_AUDIO_PARAM_PCMMODETYPE &pcmmode) > getter);
 
+      static OMX_ERRORTYPE copy_pcm_sample_format (
+          const OMX_HANDLETYPE src_handle, const OMX_U32 src_port_id,
+          const OMX_HANDLETYPE dst_handle, const OMX_U32 dst_port_id);
+
       static OMX_ERRORTYPE set_mp3_type (
           const OMX_HANDLETYPE handle, const OMX_U32 port_id,
           boost::function< void(OMX_AUDIO_PARAM_MP3TYPE &mp3type) > getter,
@@ -238,6 +246,8 @@ namespace tiz
 
       static bool is_mpris_enabled ();
 
+      static int get_mpris_update_interval ();
+
       static void copy_omx_string (OMX_U8 *p_dest,
                                    const std::string &omx_string,
                                    const size_t max_length
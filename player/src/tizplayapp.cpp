@@ -45,6 +45,7 @@
 #include <unistd.h>
 #include <string.h>
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <boost/algorithm/string/join.hpp>
@@ -780,25 +781,69 @@ tiz::playapp::serve_stream ()
   const std::vector< std::string > &bitrate_list = popts_.bitrate_list ();
   const std::string &station_name = popts_.station_name ();
   const std::string &station_genre = popts_.station_genre ();
+  const int max_listeners = popts_.max_listeners ();
+  const int hls_segment_ms
+      = popts_.hls () ? popts_.hls_segment_duration () * 1000 : 0;
+  const int hls_window = popts_.hls_window ();
 
   print_banner ();
 
-  uri_lst_t file_list;
+  // The positional uris make up the default mount point, '/', which serves
+  // mp3 files as they are. Each --mount option adds one more.
+  tiz::programopts::server_mount_lst_t mount_list;
+  if (!uri_list.empty ())
+  {
+    tiz::programopts::server_mount mount;
+    mount.name_ = "/";
+    mount.format_ = "mp3";
+    mount.port_ = port;
+    mount.bitrate_ = 0;
+    mount.max_listeners_ = max_listeners;
+    mount_list.push_back (mount);
+  }
+  mount_list.insert (mount_list.end (), popts_.mount_list ().begin (),
+                     popts_.mount_list ().end ());
+
   std::string hostname;
   std::string ip_address;
   std::string error_msg;
-  file_extension_lst_t extension_list;
-  extension_list.insert (".mp3");
 
-  // Create a playlist
-  BOOST_FOREACH (std::string uri, uri_list)
+  // Each mount point is served by its own http renderer, hence on its own
+  // port; mount points without an explicit port take the next free one.
+  std::vector< uri_lst_t > file_lists;
+  long int next_port = port;
+  BOOST_FOREACH (tiz::programopts::server_mount &mount, mount_list)
   {
-    if (!tizplaylist_t::assemble_play_list (
-            uri, shuffle, recurse, extension_list, file_list, error_msg))
+    if (0 == mount.port_)
     {
-      TIZ_PRINTF_RED ("%s (%s).\n", error_msg.c_str (), uri.c_str ());
-      player_exit_failure ();
+      mount.port_ = next_port;
     }
+    next_port = std::max (next_port, mount.port_) + 1;
+
+    file_extension_lst_t extension_list;
+    extension_list.insert (std::string (".").append (mount.format_));
+
+    uri_lst_t mount_uris;
+    if (mount.location_.empty ())
+    {
+      mount_uris = uri_list;
+    }
+    else
+    {
+      mount_uris.push_back (mount.location_);
+    }
+
+    uri_lst_t file_list;
+    BOOST_FOREACH (std::string uri, mount_uris)
+    {
+      if (!tizplaylist_t::assemble_play_list (
+              uri, shuffle, recurse, extension_list, file_list, error_msg))
+      {
+        TIZ_PRINTF_RED ("%s (%s).\n", error_msg.c_str (), uri.c_str ());
+        player_exit_failure ();
+      }
+    }
+    file_lists.push_back (file_list);
   }
 
   (void)daemonize_if_requested ();
@@ -810,8 +855,25 @@ tiz::playapp::serve_stream ()
     player_exit_failure ();
   }
 
-  fprintf (stdout, "[%s]: Server streaming on http://%s:%ld\n",
-           station_name.c_str (), hostname.c_str (), port);
+  BOOST_FOREACH (const tiz::programopts::server_mount &mount, mount_list)
+  {
+    fprintf (stdout, "[%s]: Server streaming on http://%s:%ld%s",
+             station_name.c_str (), hostname.c_str (), mount.port_,
+             mount.name_.c_str ());
+    if (mount.format_ != "mp3" || mount.bitrate_ > 0)
+    {
+      fprintf (stdout, " (%s transcoded to mp3 at %d kbps)",
+               mount.format_.c_str (),
+               mount.bitrate_ > 0 ? mount.bitrate_ : 128);
+    }
+    fprintf (stdout, "\n");
+    if (hls_segment_ms > 0)
+    {
+      fprintf (stdout, "[%s]: HLS playlist on http://%s:%ld%s.m3u8\n",
+               station_name.c_str (), hostname.c_str (), mount.port_,
+               mount.name_ == "/" ? "/stream" : mount.name_.c_str ());
+    }
+  }
 
   fprintf (stdout, "[%s]: Streaming media with sampling rates [%s].\n",
            station_name.c_str (),
@@ -824,36 +886,52 @@ tiz::playapp::serve_stream ()
   }
   fprintf (stdout, "\n");
 
-  tizplaylist_ptr_t playlist
-      = boost::make_shared< tiz::playlist > (tiz::playlist (file_list));
-
-  assert (playlist);
-  playlist->print_info ();
-
-  // Here we'll only process one encoding, that is mp3... so enable loop
-  // playback to ensure that the graph does not stop to get back to the
-  // manager at the end of the playlist.
-  playlist->set_loop_playback (true);
-
-  tizgraphconfig_ptr_t config
-      = boost::make_shared< tiz::graph::httpservconfig > (
-          playlist, hostname, ip_address, port, sampling_rate_list,
-          bitrate_list, station_name, station_genre, icy_metadata);
-
-  // Instantiate the http streaming manager
-  tiz::graphmgr::mgr_ptr_t p_mgr
-      = boost::make_shared< tiz::graphmgr::httpservmgr > (config);
-
-  // TODO: Check return codes
-  p_mgr->init (playlist, graphmgr_termination_cback ());
-  p_mgr->start ();
+  std::vector< tiz::graphmgr::mgr_ptr_t > mgr_list;
+  for (size_t i = 0; i < mount_list.size (); ++i)
+  {
+    const tiz::programopts::server_mount &mount = mount_list[i];
+    tizplaylist_ptr_t playlist
+        = boost::make_shared< tiz::playlist > (tiz::playlist (file_lists[i]));
+
+    assert (playlist);
+    playlist->print_info ();
+
+    // Here we'll only process one encoding per mount point... so enable loop
+    // playback to ensure that the graph does not stop to get back to the
+    // manager at the end of the playlist.
+    playlist->set_loop_playback (true);
+
+    tizgraphconfig_ptr_t config
+        = boost::make_shared< tiz::graph::httpservconfig > (
+            playlist, hostname, ip_address, mount.port_, sampling_rate_list,
+            bitrate_list, station_name, station_genre, icy_metadata,
+            mount.name_, mount.format_, mount.bitrate_,
+            mount.max_listeners_, hls_segment_ms, hls_window);
+
+    // Instantiate the http streaming manager
+    tiz::graphmgr::mgr_ptr_t p_mgr
+        = boost::make_shared< tiz::graphmgr::httpservmgr > (config);
+
+    // TODO: Check return codes
+    p_mgr->init (playlist, graphmgr_termination_cback ());
+    p_mgr->start ();
+    mgr_list.push_back (p_mgr);
+  }
 
-  while (ETIZPlayUserQuit != player_wait_for_user_input_while_streaming (p_mgr))
+  if (!mgr_list.empty ())
   {
+    while (ETIZPlayUserQuit
+           != player_wait_for_user_input_while_streaming (mgr_list[0]))
+    {
+    }
   }
 
-  p_mgr->quit ();
-  p_mgr->deinit ();
+  // Each graph reports its mount point's statistics on the way down
+  BOOST_FOREACH (tiz::graphmgr::mgr_ptr_t p_mgr, mgr_list)
+  {
+    p_mgr->quit ();
+    p_mgr->deinit ();
+  }
 
   return rc;
 }
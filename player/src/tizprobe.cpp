@@ -30,6 +30,8 @@
 #include <config.h>
 #endif
 
+#include <locale>
+#include <sstream>
 #include <string>
 
 #include <boost/algorithm/string/trim.hpp>
@@ -41,6 +43,8 @@
 #include <MediaInfo/MediaInfo.h>
 #include <MediaInfo/MediaInfo_Const.h>
 
+#include <tpropertymap.h>
+
 #include <tizplatform.h>
 
 #include "tizprobe.hpp"
@@ -235,6 +239,20 @@ namespace  // unnamed
     }
     return container_format;
   }
+
+  // Parses the leading number of a tag value like "-6.54 dB", regardless of
+  // the current locale
+  bool tag_value_to_double (const TagLib::StringList &values, double &value)
+  {
+    if (values.isEmpty ())
+    {
+      return false;
+    }
+    std::istringstream iss (values.front ().to8Bit ());
+    iss.imbue (std::locale::classic ());
+    iss >> value;
+    return !iss.fail ();
+  }
 }
 
 tiz::probe::probe (const std::string &uri, const bool quiet)
@@ -812,6 +830,51 @@ std::string tiz::probe::genre () const
   return retrieve_meta_data_str (&TagLib::Tag::genre);
 }
 
+bool tiz::probe::track_gain (double &gain_db, double &peak) const
+{
+  return retrieve_gain ("REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK",
+                        "R128_TRACK_GAIN", gain_db, peak);
+}
+
+bool tiz::probe::album_gain (double &gain_db, double &peak) const
+{
+  return retrieve_gain ("REPLAYGAIN_ALBUM_GAIN", "REPLAYGAIN_ALBUM_PEAK",
+                        "R128_ALBUM_GAIN", gain_db, peak);
+}
+
+bool tiz::probe::retrieve_gain (const char *p_rg_gain_key,
+                                const char *p_rg_peak_key,
+                                const char *p_r128_gain_key, double &gain_db,
+                                double &peak) const
+{
+  bool found = false;
+  gain_db = 0.0;
+  peak = 0.0;
+  if (!meta_file_.isNull () && meta_file_.file ())
+  {
+    TagLib::PropertyMap props = meta_file_.file ()->properties ();
+    TagLib::PropertyMap::Iterator it = props.find (p_rg_gain_key);
+    if (it != props.end () && tag_value_to_double (it->second, gain_db))
+    {
+      found = true;
+      it = props.find (p_rg_peak_key);
+      if (it == props.end () || !tag_value_to_double (it->second, peak))
+      {
+        peak = 0.0;
+      }
+    }
+    else if ((it = props.find (p_r128_gain_key)) != props.end ()
+             && tag_value_to_double (it->second, gain_db))
+    {
+      // R128 gains are Q7.8 dB, relative to -23 LUFS (RFC 7845); ReplayGain's
+      // reference is 5 dB louder.
+      found = true;
+      gain_db = gain_db / 256.0 + 5.0;
+    }
+  }
+  return found;
+}
+
 std::string tiz::probe::stream_length () const
 {
   std::string length_str;
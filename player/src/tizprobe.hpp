@@ -80,6 +80,12 @@ namespace tiz
     std::string get_stream_genre ();
     bool is_cbr_stream ();
 
+    /* Loudness normalisation. ReplayGain gains (in dB, relative to the
+       ReplayGain reference level; R128 tags are converted) and peaks (linear;
+       0.0 if unknown). Return false if the file has no such tags. */
+    bool track_gain (double &gain_db, double &peak) const;
+    bool album_gain (double &gain_db, double &peak) const;
+
     /* Duration */
     std::string stream_length () const;
 
@@ -120,6 +126,9 @@ namespace tiz
         TagLib::String (TagLib::Tag::*TagFunction)() const) const;
     unsigned int retrieve_meta_data_uint (
         TagLib::uint (TagLib::Tag::*TagFunction)() const) const;
+    bool retrieve_gain (const char *p_rg_gain_key, const char *p_rg_peak_key,
+                        const char *p_r128_gain_key, double &gain_db,
+                        double &peak) const;
 
   private:
     std::string uri_;
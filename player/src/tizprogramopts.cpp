@@ -146,6 +146,81 @@ namespace
     return rc;
   }
 
+  bool is_valid_server_mount_format (const std::string &format)
+  {
+    return (format == "mp3" || format == "flac" || format == "aac"
+            || format == "opus");
+  }
+
+  // NAME=LOCATION[,format=F][,bitrate=KBPS][,max-listeners=N][,port=P]
+  bool parse_server_mount (const std::string &spec, const int max_listeners,
+                           tiz::programopts::server_mount &mount)
+  {
+    std::vector< std::string > fields;
+    boost::split (fields, spec, boost::is_any_of (","));
+
+    const std::string &name_and_location = fields[0];
+    const std::string::size_type eq = name_and_location.find ('=');
+    if (std::string::npos == eq)
+    {
+      return false;
+    }
+    mount.name_ = name_and_location.substr (0, eq);
+    mount.location_ = name_and_location.substr (eq + 1);
+    mount.format_ = "mp3";
+    mount.port_ = 0;
+    mount.bitrate_ = 0;
+    mount.max_listeners_ = max_listeners;
+
+    bool rc = true;
+    for (unsigned int i = 1; i < fields.size () && rc; ++i)
+    {
+      const std::string::size_type pos = fields[i].find ('=');
+      if (std::string::npos == pos)
+      {
+        rc = false;
+        break;
+      }
+      const std::string key = fields[i].substr (0, pos);
+      const std::string value = fields[i].substr (pos + 1);
+      try
+      {
+        if (key == "format")
+        {
+          mount.format_ = value;
+          rc = is_valid_server_mount_format (value);
+        }
+        else if (key == "bitrate")
+        {
+          mount.bitrate_ = boost::lexical_cast< int > (value);
+          rc = (mount.bitrate_ >= 8 && mount.bitrate_ <= 320);
+        }
+        else if (key == "max-listeners")
+        {
+          mount.max_listeners_ = boost::lexical_cast< int > (value);
+          rc = (mount.max_listeners_ > 0);
+        }
+        else if (key == "port")
+        {
+          mount.port_ = boost::lexical_cast< long int > (value);
+          rc = (mount.port_ > 1024 && mount.port_ <= 65535);
+        }
+        else
+        {
+          rc = false;
+        }
+      }
+      catch (const boost::bad_lexical_cast &)
+      {
+        rc = false;
+      }
+    }
+
+    rc &= (!mount.name_.empty () && '/' == mount.name_[0]);
+    rc &= !mount.location_.empty ();
+    return rc;
+  }
+
   bool omx_conflicting_options (const po::variables_map &vm, const char *opt1,
                                 const char *opt2)
   {
@@ -291,6 +366,12 @@ tiz::programopts::programopts (int argc, char *argv[])
     bitrate_list_ (),
     sampling_rates_ (),
     sampling_rate_list_ (),
+    max_listeners_ (0),
+    hls_ (false),
+    hls_segment_duration_ (6),
+    hls_window_ (5),
+    mounts_ (),
+    mount_list_ (),
     uri_list_ (),
     spotify_user_ (),
     spotify_pass_ (),
@@ -559,6 +640,13 @@ void tiz::programopts::print_usage_examples () const
   printf ("    * Streams files from the '~/Music' directory.\n");
   printf ("    * File formats currently supported for streaming: mp3.\n");
   printf ("    * Sampling rates other than [44100,4800] are ignored.\n");
+  printf (
+      "\n tizonia --server ~/Music --mount /jazz=$HOME/Jazz,format=flac,"
+      "bitrate=192\n\n");
+  printf ("    * Streams mp3 files from '~/Music' on port 8010, and flac "
+          "files\n");
+  printf ("      from '~/Jazz', transcoded to mp3, on port 8011 at "
+          "/jazz.\n");
   printf ("\n");
 }
 
@@ -648,6 +736,32 @@ const std::vector< int > &tiz::programopts::sampling_rate_list () const
   return sampling_rate_list_;
 }
 
+int tiz::programopts::max_listeners () const
+{
+  return max_listeners_;
+}
+
+bool tiz::programopts::hls () const
+{
+  return hls_;
+}
+
+int tiz::programopts::hls_segment_duration () const
+{
+  return hls_segment_duration_;
+}
+
+int tiz::programopts::hls_window () const
+{
+  return hls_window_;
+}
+
+const tiz::programopts::server_mount_lst_t &tiz::programopts::mount_list ()
+    const
+{
+  return mount_list_;
+}
+
 const std::vector< std::string > &tiz::programopts::uri_list () const
 {
   return uri_list_;
@@ -1186,6 +1300,29 @@ void tiz::programopts::init_streaming_server_options ()
        "of sampling rates. Only media with these rates will in the "
        "playlist. Default: any.")
       /* TIZ_CLASS_COMMENT: */
+      ("max-listeners", po::value (&max_listeners_),
+       "The maximum number of listeners per mount point. Default: 5.")
+      /* TIZ_CLASS_COMMENT: */
+      ("hls", po::bool_switch (&hls_),
+       "Also serve each mount point as an HTTP Live Streaming playlist, "
+       "'NAME.m3u8' ('/stream.m3u8' for '/').")
+      /* TIZ_CLASS_COMMENT: */
+      ("hls-segment-duration", po::value (&hls_segment_duration_),
+       "The target duration of the HLS segments, in seconds. Default: 6.")
+      /* TIZ_CLASS_COMMENT: */
+      ("hls-window", po::value (&hls_window_),
+       "The number of segments listed in the HLS playlist. Default: 5.")
+      /* TIZ_CLASS_COMMENT: */
+      ("mount",
+       po::value< std::vector< std::string > > (&mounts_)->composing (),
+       "An additional mount point, "
+       /* TIZ_CLASS_COMMENT: */
+       "'NAME=LOCATION[,format=mp3|flac|aac|opus][,bitrate=KBPS]"
+       "[,max-listeners=N][,port=PORT]' (e.g. '/jazz=$HOME/Jazz,"
+       "format=flac,bitrate=192'). Non-mp3 files, or mp3 files with a "
+       "bitrate, are transcoded to mp3. Each mount point listens on its own "
+       "port, by default the next one after the last in use. Repeatable.")
+      /* TIZ_CLASS_COMMENT: */
       ;
 
   // Give a default value to the bitrate list
@@ -1196,7 +1333,8 @@ void tiz::programopts::init_streaming_server_options ()
   all_streaming_server_options_
       = boost::assign::list_of ("server") ("port") ("station-name") (
             "station-genre") ("no-icy-metadata") ("bitrate-modes") (
-            "sampling-rates")
+            "sampling-rates") ("max-listeners") ("hls") (
+            "hls-segment-duration") ("hls-window") ("mount")
             .convert_to_container< std::vector< std::string > > ();
 }
 
@@ -1647,7 +1785,13 @@ int tiz::programopts::consume_streaming_server_options (bool &done,
     PO_RETURN_IF_FAIL (validate_port_argument (msg));
     PO_RETURN_IF_FAIL (validate_bitrates_argument (msg));
     PO_RETURN_IF_FAIL (validate_sampling_rates_argument (msg));
+    PO_RETURN_IF_FAIL (validate_mounts_argument (msg));
     rc = consume_input_file_uris_option ();
+    if (EXIT_FAILURE == rc && !mount_list_.empty ())
+    {
+      // The positional uris are optional when mount points are given
+      rc = EXIT_SUCCESS;
+    }
     if (EXIT_SUCCESS == rc)
     {
       rc = call_handler (option_handlers_map_.find ("serve-stream"));
@@ -2436,6 +2580,51 @@ bool tiz::programopts::validate_sampling_rates_argument (std::string &msg)
   return rc;
 }
 
+bool tiz::programopts::validate_mounts_argument (std::string &msg)
+{
+  bool rc = true;
+  if (vm_.count ("max-listeners") && max_listeners_ <= 0)
+  {
+    rc = false;
+    std::ostringstream oss;
+    oss << "Invalid argument : " << max_listeners_ << "\n"
+        << "Please provide a number of listeners greater than 0";
+    msg.assign (oss.str ());
+  }
+
+  if (rc && (hls_segment_duration_ <= 0 || hls_window_ <= 0))
+  {
+    rc = false;
+    std::ostringstream oss;
+    oss << "Invalid argument : "
+        << (hls_segment_duration_ <= 0 ? hls_segment_duration_ : hls_window_)
+        << "\n"
+        << "Please provide an HLS segment duration and window greater than 0";
+    msg.assign (oss.str ());
+  }
+
+  mount_list_.clear ();
+  for (unsigned int i = 0; i < mounts_.size () && rc; ++i)
+  {
+    server_mount mount;
+    if (!parse_server_mount (mounts_[i], max_listeners_, mount))
+    {
+      rc = false;
+      std::ostringstream oss;
+      oss << "Invalid argument : " << mounts_[i] << "\n"
+          << "Valid mount point : "
+          << "NAME=LOCATION[,format=mp3|flac|aac|opus][,bitrate=8-320]"
+          << "[,max-listeners=N][,port=1025-65535]";
+      msg.assign (oss.str ());
+    }
+    else
+    {
+      mount_list_.push_back (mount);
+    }
+  }
+  return rc;
+}
+
 void tiz::programopts::register_consume_function (const consume_mem_fn_t cf)
 {
   consume_functions_.push_back (boost::bind (boost::mem_fn (cf), this, _1, _2));
@@ -46,6 +46,19 @@ namespace tiz
     typedef boost::function< OMX_ERRORTYPE () > option_handler_t;
     typedef std::map< std::string, option_handler_t > option_handlers_map_t;
 
+  public:
+    // A mount point of the streaming server, from a --mount option
+    struct server_mount
+    {
+      std::string name_;
+      std::string location_;
+      std::string format_;
+      long int port_;  // 0: next free port after --port
+      int bitrate_;    // kbps, 0: serve mp3 files as they are
+      int max_listeners_;
+    };
+    typedef std::vector< server_mount > server_mount_lst_t;
+
   public:
     programopts (int argc, char *argv[]);
 
@@ -74,6 +87,11 @@ namespace tiz
     const std::vector< std::string > &bitrate_list () const;
     const std::string &sampling_rates () const;
     const std::vector< int > &sampling_rate_list () const;
+    int max_listeners () const;
+    bool hls () const;
+    int hls_segment_duration () const;
+    int hls_window () const;
+    const server_mount_lst_t &mount_list () const;
     const std::vector< std::string > &uri_list () const;
     const std::string &spotify_user () const;
     const std::string &spotify_password () const;
@@ -148,6 +166,7 @@ namespace tiz
     bool validate_port_argument (std::string &msg) const;
     bool validate_bitrates_argument (std::string &msg);
     bool validate_sampling_rates_argument (std::string &msg);
+    bool validate_mounts_argument (std::string &msg);
 
     int call_handler (const option_handlers_map_t::const_iterator &handler_it);
 
@@ -191,6 +210,12 @@ namespace tiz
     std::vector< std::string > bitrate_list_;
     std::string sampling_rates_;
     std::vector< int > sampling_rate_list_;
+    int max_listeners_;
+    bool hls_;
+    int hls_segment_duration_;
+    int hls_window_;
+    std::vector< std::string > mounts_;
+    server_mount_lst_t mount_list_;
     std::vector< std::string > uri_list_;
     std::string spotify_user_;
     std::string spotify_pass_;
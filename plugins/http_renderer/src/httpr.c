@@ -44,6 +44,7 @@
 
 #include "httprprc.h"
 #include "httprmp3port.h"
+#include "httproggport.h"
 #include "httprcfgport.h"
 #include "httpr.h"
 
@@ -57,6 +58,7 @@
  *
  * - Component name : "OMX.Aratelia.audio_renderer.http"
  * - Implements role: "audio_renderer.http"
+ * - Implements role: "audio_renderer.http.ogg"
  *
  *@ingroup plugins
  */
@@ -94,6 +96,27 @@ instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
                       &encodings, &mp3type);
 }
 
+static OMX_PTR
+instantiate_ogg_port (OMX_HANDLETYPE ap_hdl)
+{
+  OMX_AUDIO_CODINGTYPE encodings[]
+    = {(OMX_AUDIO_CODINGTYPE) OMX_AUDIO_CodingOGA, OMX_AUDIO_CodingMax};
+  tiz_port_options_t ogg_port_opts = {
+    OMX_PortDomainAudio,
+    OMX_DirInput,
+    ARATELIA_HTTP_RENDERER_PORT_MIN_BUF_COUNT,
+    ARATELIA_HTTP_RENDERER_PORT_MIN_BUF_SIZE,
+    ARATELIA_HTTP_RENDERER_PORT_NONCONTIGUOUS,
+    ARATELIA_HTTP_RENDERER_PORT_ALIGNMENT,
+    ARATELIA_HTTP_RENDERER_PORT_SUPPLIERPREF,
+    {ARATELIA_HTTP_RENDERER_PORT_INDEX, NULL, NULL, NULL},
+    0 /* Master port */
+  };
+
+  return factory_new (tiz_get_type (ap_hdl, "httproggport"), &ogg_port_opts,
+                      &encodings);
+}
+
 static OMX_PTR
 instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
@@ -113,12 +136,15 @@ OMX_ERRORTYPE
 OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
 {
   tiz_role_factory_t role_factory;
-  const tiz_role_factory_t * rf_list[] = {&role_factory};
+  tiz_role_factory_t ogg_role_factory;
+  const tiz_role_factory_t * rf_list[] = {&role_factory, &ogg_role_factory};
   tiz_type_factory_t httprprc_type;
   tiz_type_factory_t httprmp3port_type;
+  tiz_type_factory_t httproggport_type;
   tiz_type_factory_t httprcfgport_type;
   const tiz_type_factory_t * tf_list[]
-    = {&httprprc_type, &httprmp3port_type, &httprcfgport_type};
+    = {&httprprc_type, &httprmp3port_type, &httproggport_type,
+       &httprcfgport_type};
 
   strcpy ((OMX_STRING) role_factory.role, ARATELIA_HTTP_RENDERER_DEFAULT_ROLE);
   role_factory.pf_cport = instantiate_config_port;
@@ -126,6 +152,12 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   role_factory.nports = 1;
   role_factory.pf_proc = instantiate_processor;
 
+  strcpy ((OMX_STRING) ogg_role_factory.role, ARATELIA_HTTP_RENDERER_OGG_ROLE);
+  ogg_role_factory.pf_cport = instantiate_config_port;
+  ogg_role_factory.pf_port[0] = instantiate_ogg_port;
+  ogg_role_factory.nports = 1;
+  ogg_role_factory.pf_proc = instantiate_processor;
+
   strcpy ((OMX_STRING) httprprc_type.class_name, "httprprc_class");
   httprprc_type.pf_class_init = httpr_prc_class_init;
   strcpy ((OMX_STRING) httprprc_type.object_name, "httprprc");
@@ -136,6 +168,11 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   strcpy ((OMX_STRING) httprmp3port_type.object_name, "httprmp3port");
   httprmp3port_type.pf_object_init = httpr_mp3port_init;
 
+  strcpy ((OMX_STRING) httproggport_type.class_name, "httproggport_class");
+  httproggport_type.pf_class_init = httpr_oggport_class_init;
+  strcpy ((OMX_STRING) httproggport_type.object_name, "httproggport");
+  httproggport_type.pf_object_init = httpr_oggport_init;
+
   strcpy ((OMX_STRING) httprcfgport_type.class_name, "httprcfgport_class");
   httprcfgport_type.pf_class_init = httpr_cfgport_class_init;
   strcpy ((OMX_STRING) httprcfgport_type.object_name, "httprcfgport");
@@ -145,11 +182,12 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   tiz_check_omx (
     tiz_comp_init (ap_hdl, ARATELIA_HTTP_RENDERER_COMPONENT_NAME));
 
-  /* Register the "httprprc", "httprmp3port" and "httprcfgport" classes */
-  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 3));
+  /* Register the "httprprc", "httprmp3port", "httproggport" and
+     "httprcfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 4));
 
-  /* Register this component's role */
-  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 1));
+  /* Register this component's roles */
+  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 2));
 
   return OMX_ErrorNone;
 }
@@ -38,6 +38,7 @@ extern "C" {
 #include <OMX_TizoniaExt.h>
 
 #define ARATELIA_HTTP_RENDERER_DEFAULT_ROLE "audio_renderer.http"
+#define ARATELIA_HTTP_RENDERER_OGG_ROLE "audio_renderer.http.ogg"
 #define ARATELIA_HTTP_RENDERER_COMPONENT_NAME "OMX.Aratelia.audio_renderer.http"
 #define ARATELIA_HTTP_RENDERER_PORT_INDEX \
   0 /* With libtizonia, port indexes must start at index 0 */
@@ -54,6 +55,7 @@ extern "C" {
 #define ICE_DEFAULT_HEADER_TIMEOUT 10
 #define ICE_LISTEN_QUEUE 5
 #define ICE_MIN_BURST_SIZE 1400
+#define ICE_DEFAULT_OGG_BITRATE 128000
 #define ICE_MEDIUM_BURST_SIZE 2800 /* Not used for now */
 #define ICE_MAX_BURST_SIZE 4200    /* Not used for now */
 #define ICE_LISTENER_BUF_SIZE \
@@ -61,6 +63,9 @@ extern "C" {
 
 #define ICE_SOCK_ERROR (int) -1
 
+#define HLS_DEFAULT_SEGMENT_DURATION_MS 6000
+#define HLS_DEFAULT_WINDOW_SEGMENTS 5
+
 #define goto_end_on_socket_error(expr, hdl, msg) \
   do                                             \
     {                                            \
@@ -36,6 +36,8 @@
 
 #include <tizplatform.h>
 
+#include <tizscheduler.h>
+
 #include "httpr.h"
 #include "httprmp3port.h"
 #include "httprmp3port_decls.h"
@@ -58,6 +60,8 @@ httpr_mp3port_ctor (void * ap_obj, va_list * app)
 
   tiz_port_register_index (p_obj, OMX_TizoniaIndexParamIcecastMountpoint);
   tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigIcecastMetadata);
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigIcecastMountStats);
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexParamHttpSegmenter);
 
   p_obj->mountpoint_.nSize = sizeof (OMX_TIZONIA_ICECASTMOUNTPOINTTYPE);
   p_obj->mountpoint_.nVersion.nVersion = OMX_VERSION;
@@ -81,6 +85,13 @@ httpr_mp3port_ctor (void * ap_obj, va_list * app)
   p_obj->mountpoint_.nInitialBurstSize = ICE_INITIAL_BURST_SIZE;
   p_obj->mountpoint_.nMaxClients = ICE_MAX_CLIENTS_PER_MOUNTPOINT;
 
+  p_obj->segmenter_.nSize = sizeof (OMX_TIZONIA_HTTPSEGMENTERTYPE);
+  p_obj->segmenter_.nVersion.nVersion = OMX_VERSION;
+  p_obj->segmenter_.nPortIndex = 0;
+  p_obj->segmenter_.bEnabled = OMX_FALSE;
+  p_obj->segmenter_.nSegmentDurationMs = HLS_DEFAULT_SEGMENT_DURATION_MS;
+  p_obj->segmenter_.nWindowSegments = HLS_DEFAULT_WINDOW_SEGMENTS;
+
   p_obj->p_stream_title_ = NULL;
 
   return p_obj;
@@ -115,6 +126,11 @@ httpr_mp3port_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
       memcpy (ap_struct, &(p_obj->mountpoint_),
               sizeof (OMX_TIZONIA_ICECASTMOUNTPOINTTYPE));
     }
+  else if (OMX_TizoniaIndexParamHttpSegmenter == a_index)
+    {
+      memcpy (ap_struct, &(p_obj->segmenter_),
+              sizeof (OMX_TIZONIA_HTTPSEGMENTERTYPE));
+    }
   else
     {
       /* Delegate to the base port */
@@ -148,6 +164,24 @@ httpr_mp3port_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
       TIZ_TRACE (ap_hdl, "Station Name [%s]...",
                  p_obj->mountpoint_.cStationName);
     }
+  else if (OMX_TizoniaIndexParamHttpSegmenter == a_index)
+    {
+      const OMX_TIZONIA_HTTPSEGMENTERTYPE * p_segmenter = ap_struct;
+      if (p_segmenter->nSegmentDurationMs == 0
+          || p_segmenter->nWindowSegments == 0)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          memcpy (&(p_obj->segmenter_), p_segmenter,
+                  sizeof (OMX_TIZONIA_HTTPSEGMENTERTYPE));
+          TIZ_TRACE (ap_hdl, "Segmenter [%s] : [%lu] ms x [%lu] segments",
+                     p_obj->segmenter_.bEnabled ? "ON" : "OFF",
+                     p_obj->segmenter_.nSegmentDurationMs,
+                     p_obj->segmenter_.nWindowSegments);
+        }
+    }
   else
     {
       /* Try the parent's indexes */
@@ -202,6 +236,21 @@ httpr_mp3port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
           p_metadata->cStreamTitle[0] = '\0';
         }
     }
+  else if (OMX_TizoniaIndexConfigIcecastMountStats == a_index)
+    {
+      /* Only the processor knows about the listeners. So lets get the
+         processor to fill this info for us. */
+      void * p_prc = tiz_get_prc (ap_hdl);
+      assert (p_prc);
+      if (OMX_ErrorNone
+          != (rc = tiz_api_GetConfig (p_prc, ap_hdl, a_index, ap_struct)))
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[%s] : Error retrieving [%s] "
+                     "from the processor",
+                     tiz_err_to_str (rc), tiz_idx_to_str (a_index));
+        }
+    }
   else
     {
       /* Delegate to the base port */
@@ -44,6 +44,7 @@ struct httpr_mp3port
   /* Object */
   const tiz_mp3port_t _;
   OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_;
+  OMX_TIZONIA_HTTPSEGMENTERTYPE segmenter_;
   OMX_STRING p_stream_title_;
 };
 
@@ -0,0 +1,949 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httprogg.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - HTTP renderer's Ogg page tracker
+ *
+ * Splits the incoming Ogg bitstream into pages and keeps a copy of the header
+ * pages of the current chain, so that a listener that connects mid-stream
+ * can be sent the headers first and then the live pages, starting at a page
+ * boundary. When the stream title changes, the current logical stream is
+ * ended and a new chain is started with the same codec headers and an updated
+ * comment header, i.e. metadata is delivered in-band.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+
+#include <tizplatform.h>
+
+#include "httprogg.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.http_renderer.prc.ogg"
+#endif
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_PAGE_MAX_SEGMENTS 255
+#define OGG_PAGE_MAX_SIZE \
+  (OGG_PAGE_HEADER_SIZE + OGG_PAGE_MAX_SEGMENTS + 255 * OGG_PAGE_MAX_SEGMENTS)
+#define OGG_FLAG_CONTINUED 0x01
+#define OGG_FLAG_BOS 0x02
+#define OGG_FLAG_EOS 0x04
+#define OGG_OFFSET_FLAGS 5
+#define OGG_OFFSET_GRANULE 6
+#define OGG_OFFSET_SERIAL 14
+#define OGG_OFFSET_SEQ 18
+#define OGG_OFFSET_CRC 22
+#define OGG_OFFSET_NSEGS 26
+
+#define HTTPR_OGG_OPUS_GRANULE_RATE 48000
+#define HTTPR_OGG_OPUS_HEADER_PACKETS 2
+#define HTTPR_OGG_VORBIS_HEADER_PACKETS 3
+/* Seconds of audio to see before trusting the bitrate estimate */
+#define HTTPR_OGG_BITRATE_SPAN 2
+#define HTTPR_OGG_BUFFER_SIZE (64 * 1024)
+
+struct httpr_ogg
+{
+  OMX_U8 page[OGG_PAGE_MAX_SIZE];
+  OMX_U32 page_len;
+  OMX_U8 scratch[OGG_PAGE_MAX_SIZE];
+  OMX_U32 crc_table[256];
+  tiz_buffer_t * p_out;   /* pages ready to be sent */
+  tiz_buffer_t * p_hdrs;  /* header pages of the current chain, as received */
+  tiz_buffer_t * p_intro; /* what a new listener gets before the live pages */
+  bool intro_dirty;
+  httpr_ogg_codec_t codec;
+  OMX_U32 channels;
+  OMX_U32 sample_rate;
+  OMX_U32 granule_rate;
+  bool have_stream;
+  OMX_U32 serial;
+  OMX_U32 last_seq;
+  OMX_S64 last_granule;
+  OMX_U32 hdr_packets_seen;
+  bool hdrs_complete;
+  bool prev_bos;
+  bool multiplexed;
+  bool remap;
+  OMX_U32 out_serial;
+  OMX_U32 out_seq;
+  OMX_U32 intro_pages;
+  bool chain_pending;
+  bool joining; /* a new listener waits for a page that starts a packet */
+  char * p_title;
+  OMX_S64 br_granule;
+  OMX_U64 br_bytes;
+  OMX_U32 bitrate;
+};
+
+static inline OMX_U32
+rd32 (const OMX_U8 * ap_p)
+{
+  return (OMX_U32) ap_p[0] | ((OMX_U32) ap_p[1] << 8)
+         | ((OMX_U32) ap_p[2] << 16) | ((OMX_U32) ap_p[3] << 24);
+}
+
+static inline void
+wr32 (OMX_U8 * ap_p, const OMX_U32 a_val)
+{
+  ap_p[0] = a_val & 0xff;
+  ap_p[1] = (a_val >> 8) & 0xff;
+  ap_p[2] = (a_val >> 16) & 0xff;
+  ap_p[3] = (a_val >> 24) & 0xff;
+}
+
+static inline OMX_S64
+rd64 (const OMX_U8 * ap_p)
+{
+  return (OMX_S64) ((OMX_U64) rd32 (ap_p) | ((OMX_U64) rd32 (ap_p + 4) << 32));
+}
+
+static inline void
+wr64 (OMX_U8 * ap_p, const OMX_S64 a_val)
+{
+  wr32 (ap_p, (OMX_U32) ((OMX_U64) a_val & 0xffffffff));
+  wr32 (ap_p + 4, (OMX_U32) ((OMX_U64) a_val >> 32));
+}
+
+static void
+init_crc_table (OMX_U32 * ap_table)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < 256; ++i)
+    {
+      OMX_U32 r = i << 24;
+      int j = 0;
+      for (j = 0; j < 8; ++j)
+        {
+          r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+        }
+      ap_table[i] = r;
+    }
+}
+
+/* Recomputes the checksum of a page whose header or body has been modified */
+static void
+page_checksum (const httpr_ogg_t * ap_ogg, OMX_U8 * ap_page,
+               const OMX_U32 a_len)
+{
+  OMX_U32 crc = 0;
+  OMX_U32 i = 0;
+  wr32 (ap_page + OGG_OFFSET_CRC, 0);
+  for (i = 0; i < a_len; ++i)
+    {
+      crc = (crc << 8) ^ ap_ogg->crc_table[((crc >> 24) & 0xff) ^ ap_page[i]];
+    }
+  wr32 (ap_page + OGG_OFFSET_CRC, crc);
+}
+
+static bool
+page_checksum_ok (const httpr_ogg_t * ap_ogg, OMX_U8 * ap_page,
+                  const OMX_U32 a_len)
+{
+  const OMX_U32 crc = rd32 (ap_page + OGG_OFFSET_CRC);
+  page_checksum (ap_ogg, ap_page, a_len);
+  if (rd32 (ap_page + OGG_OFFSET_CRC) != crc)
+    {
+      wr32 (ap_page + OGG_OFFSET_CRC, crc);
+      return false;
+    }
+  return true;
+}
+
+static OMX_ERRORTYPE
+push_all (tiz_buffer_t * ap_buf, const OMX_U8 * ap_data, OMX_U32 a_len)
+{
+  /* tiz_buffer_push only grows the store once per call */
+  while (a_len > 0)
+    {
+      const int pushed = tiz_buffer_push (ap_buf, ap_data, a_len);
+      if (pushed <= 0)
+        {
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_data += pushed;
+      a_len -= pushed;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_U32
+page_length (const OMX_U8 * ap_page)
+{
+  const OMX_U32 nsegs = ap_page[OGG_OFFSET_NSEGS];
+  OMX_U32 len = OGG_PAGE_HEADER_SIZE + nsegs;
+  OMX_U32 i = 0;
+  for (i = 0; i < nsegs; ++i)
+    {
+      len += ap_page[OGG_PAGE_HEADER_SIZE + i];
+    }
+  return len;
+}
+
+static OMX_U32
+page_packets_completed (const OMX_U8 * ap_page)
+{
+  const OMX_U32 nsegs = ap_page[OGG_OFFSET_NSEGS];
+  OMX_U32 count = 0;
+  OMX_U32 i = 0;
+  for (i = 0; i < nsegs; ++i)
+    {
+      if (ap_page[OGG_PAGE_HEADER_SIZE + i] < 255)
+        {
+          ++count;
+        }
+    }
+  return count;
+}
+
+static void
+identify_stream (httpr_ogg_t * ap_ogg, const OMX_U8 * ap_page)
+{
+  const OMX_U8 * p_body
+    = ap_page + OGG_PAGE_HEADER_SIZE + ap_page[OGG_OFFSET_NSEGS];
+  const OMX_U32 body_len
+    = page_length (ap_page) - OGG_PAGE_HEADER_SIZE - ap_page[OGG_OFFSET_NSEGS];
+
+  ap_ogg->codec = EHttprOggCodecUnknown;
+  ap_ogg->channels = 0;
+  ap_ogg->sample_rate = 0;
+  ap_ogg->granule_rate = 0;
+
+  if (body_len >= 19 && 0 == memcmp (p_body, "OpusHead", 8))
+    {
+      ap_ogg->codec = EHttprOggCodecOpus;
+      ap_ogg->channels = p_body[9];
+      ap_ogg->sample_rate = rd32 (p_body + 12);
+      ap_ogg->granule_rate = HTTPR_OGG_OPUS_GRANULE_RATE;
+    }
+  else if (body_len >= 30 && 0 == memcmp (p_body, "\x01vorbis", 7))
+    {
+      const OMX_S32 nominal = (OMX_S32) rd32 (p_body + 20);
+      ap_ogg->codec = EHttprOggCodecVorbis;
+      ap_ogg->channels = p_body[11];
+      ap_ogg->sample_rate = rd32 (p_body + 12);
+      ap_ogg->granule_rate = ap_ogg->sample_rate;
+      if (nominal > 0)
+        {
+          ap_ogg->bitrate = (OMX_U32) nominal;
+        }
+    }
+}
+
+static OMX_U32
+header_packets_needed (const httpr_ogg_t * ap_ogg)
+{
+  switch (ap_ogg->codec)
+    {
+      case EHttprOggCodecOpus:
+        return HTTPR_OGG_OPUS_HEADER_PACKETS;
+      case EHttprOggCodecVorbis:
+        return HTTPR_OGG_VORBIS_HEADER_PACKETS;
+      default:
+        return 0;
+    };
+}
+
+/* Builds a copy of the comment packet with its TITLE field(s) replaced. The
+ * result goes to ap_dst, which must be at least OGG_PAGE_MAX_SIZE bytes. */
+static OMX_U32
+build_comment (const httpr_ogg_t * ap_ogg, const OMX_U8 * ap_src,
+               const OMX_U32 a_src_len, OMX_U8 * ap_dst,
+               const OMX_U32 a_dst_cap)
+{
+  const bool is_opus = (EHttprOggCodecOpus == ap_ogg->codec);
+  const OMX_U32 magic_len = is_opus ? 8 : 7;
+  const OMX_U32 title_len = strlen (ap_ogg->p_title);
+  OMX_U32 src = magic_len;
+  OMX_U32 dst = 0;
+  OMX_U32 count_pos = 0;
+  OMX_U32 vendor_len = 0;
+  OMX_U32 ncomments = 0;
+  OMX_U32 kept = 0;
+  OMX_U32 i = 0;
+
+  if (a_src_len < magic_len + 8
+      || 0 != memcmp (ap_src, is_opus ? "OpusTags" : "\x03vorbis", magic_len))
+    {
+      return 0;
+    }
+
+  vendor_len = rd32 (ap_src + src);
+  if (vendor_len > a_src_len - src - 8)
+    {
+      return 0;
+    }
+  src += 4 + vendor_len + 4;
+  ncomments = rd32 (ap_src + src - 4);
+
+  if (src + title_len + 10 > a_dst_cap)
+    {
+      return 0;
+    }
+  memcpy (ap_dst, ap_src, src);
+  dst = src;
+  count_pos = dst - 4;
+
+  for (i = 0; i < ncomments; ++i)
+    {
+      OMX_U32 len = 0;
+      if (a_src_len - src < 4)
+        {
+          return 0;
+        }
+      len = rd32 (ap_src + src);
+      if (len > a_src_len - src - 4)
+        {
+          return 0;
+        }
+      if (!(len >= 6 && 0 == strncasecmp ((const char *) ap_src + src + 4,
+                                          "TITLE=", 6)))
+        {
+          if (dst + 4 + len > a_dst_cap)
+            {
+              return 0;
+            }
+          memcpy (ap_dst + dst, ap_src + src, 4 + len);
+          dst += 4 + len;
+          ++kept;
+        }
+      src += 4 + len;
+    }
+
+  if (dst + 4 + 6 + title_len + (a_src_len - src) > a_dst_cap)
+    {
+      return 0;
+    }
+  wr32 (ap_dst + dst, 6 + title_len);
+  memcpy (ap_dst + dst + 4, "TITLE=", 6);
+  memcpy (ap_dst + dst + 10, ap_ogg->p_title, title_len);
+  dst += 10 + title_len;
+  wr32 (ap_dst + count_pos, kept + 1);
+
+  /* Whatever follows the comment list: Opus padding/binary data, or the
+   * Vorbis framing bit */
+  memcpy (ap_dst + dst, ap_src + src, a_src_len - src);
+  dst += a_src_len - src;
+
+  return dst;
+}
+
+/* If the page carries the whole comment packet (the second packet of the
+ * stream), replaces it with a copy that has the current title. Returns the
+ * length of the rewritten page in ap_ogg->scratch, or 0 if the page does not
+ * need rewriting or cannot be rewritten. */
+static OMX_U32
+rewrite_comment_page (httpr_ogg_t * ap_ogg, const OMX_U8 * ap_page,
+                      const OMX_U32 a_packets_before)
+{
+  const OMX_U32 nsegs = ap_page[OGG_OFFSET_NSEGS];
+  const OMX_U8 * p_segs = ap_page + OGG_PAGE_HEADER_SIZE;
+  const OMX_U8 * p_body = p_segs + nsegs;
+  bool started_here = !(ap_page[OGG_OFFSET_FLAGS] & OGG_FLAG_CONTINUED);
+  OMX_U32 packet = a_packets_before;
+  OMX_U32 seg_start = 0;
+  OMX_U32 body_start = 0;
+  OMX_U32 body_pos = 0;
+  OMX_U32 s = 0;
+
+  for (s = 0; s < nsegs; ++s)
+    {
+      body_pos += p_segs[s];
+      if (p_segs[s] < 255)
+        {
+          if (1 == packet && started_here)
+            {
+              break;
+            }
+          ++packet;
+          started_here = true;
+          seg_start = s + 1;
+          body_start = body_pos;
+        }
+    }
+
+  if (s < nsegs)
+    {
+      /* Packet 1 spans segments [seg_start, s] and body bytes
+       * [body_start, body_pos) */
+      const OMX_U32 page_len = page_length (ap_page);
+      const OMX_U32 tail_segs = nsegs - s - 1;
+      const OMX_U32 tail_len
+        = page_len - OGG_PAGE_HEADER_SIZE - nsegs - body_pos;
+      OMX_U8 * p_comment = NULL;
+      OMX_U32 comment_len = 0;
+      OMX_U32 lacing = 0;
+      OMX_U32 new_nsegs = 0;
+      OMX_U32 pos = 0;
+      OMX_U32 i = 0;
+
+      /* Build the new packet at the end of the scratch area first */
+      p_comment
+        = ap_ogg->scratch + OGG_PAGE_HEADER_SIZE + OGG_PAGE_MAX_SEGMENTS;
+      comment_len = build_comment (
+        ap_ogg, p_body + body_start, body_pos - body_start, p_comment,
+        OGG_PAGE_MAX_SIZE - OGG_PAGE_HEADER_SIZE - OGG_PAGE_MAX_SEGMENTS);
+      lacing = comment_len / 255 + 1;
+      new_nsegs = seg_start + lacing + tail_segs;
+      if (0 == comment_len || new_nsegs > OGG_PAGE_MAX_SEGMENTS
+          || OGG_PAGE_HEADER_SIZE + new_nsegs + body_start + comment_len
+                 + tail_len
+               > OGG_PAGE_MAX_SIZE)
+        {
+          return 0;
+        }
+
+      /* Body: head, new packet, tail */
+      pos = OGG_PAGE_HEADER_SIZE + new_nsegs;
+      memmove (ap_ogg->scratch + pos + body_start, p_comment, comment_len);
+      memcpy (ap_ogg->scratch + pos, p_body, body_start);
+      memcpy (ap_ogg->scratch + pos + body_start + comment_len,
+              p_body + body_pos, tail_len);
+
+      /* Header and segment table */
+      memcpy (ap_ogg->scratch, ap_page, OGG_PAGE_HEADER_SIZE + seg_start);
+      pos = OGG_PAGE_HEADER_SIZE + seg_start;
+      for (i = 0; i + 1 < lacing; ++i)
+        {
+          ap_ogg->scratch[pos++] = 255;
+        }
+      ap_ogg->scratch[pos++] = comment_len % 255;
+      memcpy (ap_ogg->scratch + pos, p_segs + s + 1, tail_segs);
+      ap_ogg->scratch[OGG_OFFSET_NSEGS] = new_nsegs;
+
+      return OGG_PAGE_HEADER_SIZE + new_nsegs + body_start + comment_len
+             + tail_len;
+    }
+
+  return 0;
+}
+
+static OMX_ERRORTYPE
+build_intro (httpr_ogg_t * ap_ogg)
+{
+  const OMX_U8 * p_hdrs = tiz_buffer_get (ap_ogg->p_hdrs);
+  const OMX_U32 total = tiz_buffer_available (ap_ogg->p_hdrs);
+  const bool retitle
+    = (ap_ogg->p_title && ap_ogg->codec != EHttprOggCodecUnknown);
+  OMX_U32 packets = 0;
+  OMX_U32 seq = 0;
+  OMX_U32 pos = 0;
+
+  tiz_buffer_clear (ap_ogg->p_intro);
+
+  while (pos < total)
+    {
+      const OMX_U8 * p_page = p_hdrs + pos;
+      const OMX_U32 len = page_length (p_page);
+      const bool tracked
+        = (rd32 (p_page + OGG_OFFSET_SERIAL) == ap_ogg->serial);
+      OMX_U32 new_len = 0;
+
+      if (tracked && retitle)
+        {
+          new_len = rewrite_comment_page (ap_ogg, p_page, packets);
+        }
+      if (0 == new_len)
+        {
+          memcpy (ap_ogg->scratch, p_page, len);
+          new_len = len;
+        }
+      if (tracked)
+        {
+          packets += page_packets_completed (p_page);
+          if (ap_ogg->remap)
+            {
+              wr32 (ap_ogg->scratch + OGG_OFFSET_SERIAL, ap_ogg->out_serial);
+              wr32 (ap_ogg->scratch + OGG_OFFSET_SEQ, seq);
+            }
+          ++seq;
+        }
+      page_checksum (ap_ogg, ap_ogg->scratch, new_len);
+      tiz_check_omx (push_all (ap_ogg->p_intro, ap_ogg->scratch, new_len));
+      pos += len;
+    }
+
+  ap_ogg->intro_pages = seq;
+  ap_ogg->intro_dirty = false;
+  return OMX_ErrorNone;
+}
+
+/* Ends the logical stream being sent and starts a new chain, made of the
+ * current headers (with the updated comment header) and the pages that
+ * follow */
+static OMX_ERRORTYPE
+start_chain (httpr_ogg_t * ap_ogg)
+{
+  OMX_U8 * p_eos = ap_ogg->scratch;
+  OMX_U32 serial = ap_ogg->remap ? ap_ogg->out_serial : ap_ogg->serial;
+
+  /* An empty page with the EOS flag closes the current stream */
+  memcpy (p_eos, "OggS", 4);
+  p_eos[4] = 0;
+  p_eos[OGG_OFFSET_FLAGS] = OGG_FLAG_EOS;
+  wr64 (p_eos + OGG_OFFSET_GRANULE, ap_ogg->last_granule);
+  wr32 (p_eos + OGG_OFFSET_SERIAL, serial);
+  wr32 (p_eos + OGG_OFFSET_SEQ,
+        ap_ogg->remap ? ap_ogg->out_seq : ap_ogg->last_seq + 1);
+  p_eos[OGG_OFFSET_NSEGS] = 0;
+  page_checksum (ap_ogg, p_eos, OGG_PAGE_HEADER_SIZE);
+  tiz_check_omx (push_all (ap_ogg->p_out, p_eos, OGG_PAGE_HEADER_SIZE));
+
+  /* Chained streams must use a different serial number */
+  do
+    {
+      ++serial;
+    }
+  while (serial == ap_ogg->serial);
+
+  ap_ogg->remap = true;
+  ap_ogg->out_serial = serial;
+  tiz_check_omx (build_intro (ap_ogg));
+  tiz_check_omx (push_all (ap_ogg->p_out, tiz_buffer_get (ap_ogg->p_intro),
+                           tiz_buffer_available (ap_ogg->p_intro)));
+  ap_ogg->out_seq = ap_ogg->intro_pages;
+  ap_ogg->chain_pending = false;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "New chain : serial [%u] title [%s]",
+           ap_ogg->out_serial, ap_ogg->p_title);
+  return OMX_ErrorNone;
+}
+
+static void
+update_bitrate (httpr_ogg_t * ap_ogg, const OMX_S64 a_granule,
+                const OMX_U32 a_len)
+{
+  if (ap_ogg->br_granule < 0)
+    {
+      /* Start counting after the first page with a valid position */
+      if (a_granule >= 0)
+        {
+          ap_ogg->br_granule = a_granule;
+          ap_ogg->br_bytes = 0;
+        }
+      return;
+    }
+
+  ap_ogg->br_bytes += a_len;
+  if (a_granule > ap_ogg->br_granule && ap_ogg->granule_rate > 0
+      && (a_granule - ap_ogg->br_granule)
+           >= (OMX_S64) ap_ogg->granule_rate * HTTPR_OGG_BITRATE_SPAN)
+    {
+      ap_ogg->bitrate
+        = (OMX_U32) (ap_ogg->br_bytes * 8 * ap_ogg->granule_rate
+                     / (OMX_U64) (a_granule - ap_ogg->br_granule));
+    }
+}
+
+static OMX_ERRORTYPE
+process_page (httpr_ogg_t * ap_ogg, const OMX_U32 a_len)
+{
+  OMX_U8 * p_page = ap_ogg->page;
+  const OMX_U8 flags = p_page[OGG_OFFSET_FLAGS];
+  const OMX_U32 serial = rd32 (p_page + OGG_OFFSET_SERIAL);
+  const OMX_S64 granule = rd64 (p_page + OGG_OFFSET_GRANULE);
+  OMX_U32 packets_before = 0;
+  bool is_header = false;
+  bool drop = false;
+
+  if (flags & OGG_FLAG_BOS)
+    {
+      if (!ap_ogg->prev_bos)
+        {
+          /* A new chain (or the very first one) starts here */
+          tiz_buffer_clear (ap_ogg->p_hdrs);
+          ap_ogg->have_stream = true;
+          ap_ogg->serial = serial;
+          ap_ogg->hdr_packets_seen = 0;
+          ap_ogg->hdrs_complete = false;
+          ap_ogg->multiplexed = false;
+          ap_ogg->remap = false;
+          ap_ogg->chain_pending = false;
+          ap_ogg->last_granule = 0;
+          ap_ogg->br_granule = -1;
+          identify_stream (ap_ogg, p_page);
+          TIZ_LOG (TIZ_PRIORITY_TRACE,
+                   "BOS : serial [%u] codec [%d] channels [%u] rate [%u]",
+                   serial, ap_ogg->codec, ap_ogg->channels,
+                   ap_ogg->sample_rate);
+        }
+      else
+        {
+          /* Other logical streams are passed through untouched */
+          ap_ogg->multiplexed = true;
+        }
+    }
+  ap_ogg->prev_bos = (flags & OGG_FLAG_BOS);
+
+  if (ap_ogg->have_stream && !ap_ogg->hdrs_complete)
+    {
+      is_header = true;
+      if (serial == ap_ogg->serial)
+        {
+          if (EHttprOggCodecUnknown == ap_ogg->codec)
+            {
+              /* Without knowing the codec, assume that the headers are the
+               * pages that precede the first one with a position */
+              if (!(flags & OGG_FLAG_BOS) && 0 != granule)
+                {
+                  ap_ogg->hdrs_complete = true;
+                  is_header = false;
+                }
+            }
+          else
+            {
+              packets_before = ap_ogg->hdr_packets_seen;
+              ap_ogg->hdr_packets_seen += page_packets_completed (p_page);
+              ap_ogg->hdrs_complete
+                = (ap_ogg->hdr_packets_seen >= header_packets_needed (ap_ogg));
+            }
+        }
+    }
+
+  if (is_header)
+    {
+      tiz_check_omx (push_all (ap_ogg->p_hdrs, p_page, a_len));
+      ap_ogg->intro_dirty = true;
+    }
+
+  if (ap_ogg->have_stream && serial == ap_ogg->serial)
+    {
+      if (!is_header)
+        {
+          /* A page that finishes a packet begun on the previous one can
+           * neither be the first of a new chain nor the first a listener
+           * gets after the headers */
+          const bool continued = (flags & OGG_FLAG_CONTINUED);
+          drop = (ap_ogg->joining && continued);
+          ap_ogg->joining = drop;
+          if (ap_ogg->chain_pending && !ap_ogg->multiplexed && !continued)
+            {
+              tiz_check_omx (start_chain (ap_ogg));
+            }
+          update_bitrate (ap_ogg, granule, a_len);
+        }
+      if (granule >= 0)
+        {
+          ap_ogg->last_granule = granule;
+        }
+      ap_ogg->last_seq = rd32 (p_page + OGG_OFFSET_SEQ);
+      if (drop)
+        {
+          return OMX_ErrorNone;
+        }
+      if (ap_ogg->remap)
+        {
+          wr32 (p_page + OGG_OFFSET_SERIAL, ap_ogg->out_serial);
+          wr32 (p_page + OGG_OFFSET_SEQ, ap_ogg->out_seq++);
+          page_checksum (ap_ogg, p_page, a_len);
+        }
+      else if (is_header && ap_ogg->p_title
+               && EHttprOggCodecUnknown != ap_ogg->codec)
+        {
+          /* A chain that is starting now gets the current title in its
+           * comment header */
+          const OMX_U32 len
+            = rewrite_comment_page (ap_ogg, p_page, packets_before);
+          if (len > 0)
+            {
+              page_checksum (ap_ogg, ap_ogg->scratch, len);
+              return push_all (ap_ogg->p_out, ap_ogg->scratch, len);
+            }
+        }
+    }
+
+  return push_all (ap_ogg->p_out, p_page, a_len);
+}
+
+/* Drops the first byte of the assembly area and whatever follows it up to
+ * the next possible capture pattern */
+static void
+resync (httpr_ogg_t * ap_ogg)
+{
+  OMX_U32 p = 1;
+  for (p = 1; p < ap_ogg->page_len; ++p)
+    {
+      const OMX_U32 n = MIN (4, ap_ogg->page_len - p);
+      if (0 == memcmp (ap_ogg->page + p, "OggS", n))
+        {
+          break;
+        }
+    }
+  memmove (ap_ogg->page, ap_ogg->page + p, ap_ogg->page_len - p);
+  ap_ogg->page_len -= p;
+}
+
+/*
+ * httpr_ogg API
+ */
+
+OMX_ERRORTYPE
+httpr_ogg_init (httpr_ogg_t ** app_ogg)
+{
+  httpr_ogg_t * p_ogg = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  assert (app_ogg);
+
+  if ((p_ogg = tiz_mem_calloc (1, sizeof (httpr_ogg_t))))
+    {
+      init_crc_table (p_ogg->crc_table);
+      if (OMX_ErrorNone
+            == (rc = tiz_buffer_init (&(p_ogg->p_out), HTTPR_OGG_BUFFER_SIZE))
+          && OMX_ErrorNone
+               == (rc = tiz_buffer_init (&(p_ogg->p_hdrs), OGG_PAGE_MAX_SIZE))
+          && OMX_ErrorNone
+               == (rc = tiz_buffer_init (&(p_ogg->p_intro),
+                                         OGG_PAGE_MAX_SIZE)))
+        {
+          httpr_ogg_reset (p_ogg);
+        }
+      else
+        {
+          httpr_ogg_destroy (p_ogg);
+          p_ogg = NULL;
+        }
+    }
+
+  *app_ogg = p_ogg;
+  return rc;
+}
+
+void
+httpr_ogg_destroy (httpr_ogg_t * ap_ogg)
+{
+  if (ap_ogg)
+    {
+      tiz_buffer_destroy (ap_ogg->p_out);
+      tiz_buffer_destroy (ap_ogg->p_hdrs);
+      tiz_buffer_destroy (ap_ogg->p_intro);
+      tiz_mem_free (ap_ogg->p_title);
+      tiz_mem_free (ap_ogg);
+    }
+}
+
+void
+httpr_ogg_reset (httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  ap_ogg->page_len = 0;
+  tiz_buffer_clear (ap_ogg->p_out);
+  tiz_buffer_clear (ap_ogg->p_hdrs);
+  tiz_buffer_clear (ap_ogg->p_intro);
+  ap_ogg->intro_dirty = false;
+  ap_ogg->codec = EHttprOggCodecUnknown;
+  ap_ogg->channels = 0;
+  ap_ogg->sample_rate = 0;
+  ap_ogg->granule_rate = 0;
+  ap_ogg->have_stream = false;
+  ap_ogg->serial = 0;
+  ap_ogg->last_seq = 0;
+  ap_ogg->last_granule = 0;
+  ap_ogg->hdr_packets_seen = 0;
+  ap_ogg->hdrs_complete = false;
+  ap_ogg->prev_bos = false;
+  ap_ogg->multiplexed = false;
+  ap_ogg->remap = false;
+  ap_ogg->out_serial = 0;
+  ap_ogg->out_seq = 0;
+  ap_ogg->intro_pages = 0;
+  ap_ogg->chain_pending = false;
+  ap_ogg->joining = false;
+  ap_ogg->br_granule = -1;
+  ap_ogg->br_bytes = 0;
+  ap_ogg->bitrate = 0;
+}
+
+OMX_ERRORTYPE
+httpr_ogg_feed (httpr_ogg_t * ap_ogg, const OMX_U8 * ap_data,
+                const OMX_U32 a_len)
+{
+  OMX_U32 left = a_len;
+
+  assert (ap_ogg);
+  assert (ap_data || 0 == a_len);
+
+  for (;;)
+    {
+      OMX_U32 need = 4;
+
+      if (ap_ogg->page_len > 0
+          && 0 != memcmp (ap_ogg->page, "OggS", MIN (4, ap_ogg->page_len)))
+        {
+          resync (ap_ogg);
+          continue;
+        }
+
+      if (ap_ogg->page_len >= OGG_PAGE_HEADER_SIZE)
+        {
+          if (0 != ap_ogg->page[4])
+            {
+              /* Unknown stream structure version */
+              resync (ap_ogg);
+              continue;
+            }
+          need = OGG_PAGE_HEADER_SIZE + ap_ogg->page[OGG_OFFSET_NSEGS];
+          if (ap_ogg->page_len >= need)
+            {
+              need = page_length (ap_ogg->page);
+              if (ap_ogg->page_len >= need)
+                {
+                  if (!page_checksum_ok (ap_ogg, ap_ogg->page, need))
+                    {
+                      TIZ_LOG (TIZ_PRIORITY_TRACE,
+                               "Bad page checksum; resyncing");
+                      resync (ap_ogg);
+                      continue;
+                    }
+                  tiz_check_omx (process_page (ap_ogg, need));
+                  memmove (ap_ogg->page, ap_ogg->page + need,
+                           ap_ogg->page_len - need);
+                  ap_ogg->page_len -= need;
+                  continue;
+                }
+            }
+        }
+      else if (ap_ogg->page_len >= 4)
+        {
+          need = OGG_PAGE_HEADER_SIZE;
+        }
+
+      if (0 == left)
+        {
+          break;
+        }
+
+      {
+        const OMX_U32 ncopy = MIN (need - ap_ogg->page_len, left);
+        memcpy (ap_ogg->page + ap_ogg->page_len, ap_data, ncopy);
+        ap_ogg->page_len += ncopy;
+        ap_data += ncopy;
+        left -= ncopy;
+      }
+    }
+
+  return OMX_ErrorNone;
+}
+
+OMX_U32
+httpr_ogg_available (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return tiz_buffer_available (ap_ogg->p_out);
+}
+
+const OMX_U8 *
+httpr_ogg_data (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return tiz_buffer_get (ap_ogg->p_out);
+}
+
+void
+httpr_ogg_advance (httpr_ogg_t * ap_ogg, const OMX_U32 a_nbytes)
+{
+  assert (ap_ogg);
+  (void) tiz_buffer_advance (ap_ogg->p_out, a_nbytes);
+}
+
+OMX_ERRORTYPE
+httpr_ogg_start_listener (httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+
+  /* Whatever is queued may start mid-page; the new listener gets the headers
+   * and then the pages that follow, from the first one that starts a
+   * packet */
+  tiz_buffer_clear (ap_ogg->p_out);
+  ap_ogg->joining = true;
+  if (ap_ogg->intro_dirty)
+    {
+      tiz_check_omx (build_intro (ap_ogg));
+    }
+  return push_all (ap_ogg->p_out, tiz_buffer_get (ap_ogg->p_intro),
+                   tiz_buffer_available (ap_ogg->p_intro));
+}
+
+OMX_ERRORTYPE
+httpr_ogg_set_title (httpr_ogg_t * ap_ogg, const char * ap_title)
+{
+  assert (ap_ogg);
+  assert (ap_title);
+
+  if (ap_ogg->p_title && 0 == strcmp (ap_ogg->p_title, ap_title))
+    {
+      return OMX_ErrorNone;
+    }
+
+  tiz_mem_free (ap_ogg->p_title);
+  ap_ogg->p_title = NULL;
+  if (ap_title[0] != '\0')
+    {
+      ap_ogg->p_title = strdup (ap_title);
+      tiz_check_null_ret_oom (ap_ogg->p_title);
+    }
+  ap_ogg->intro_dirty = true;
+
+  /* Listeners already connected get the new title with the next chain */
+  ap_ogg->chain_pending
+    = (ap_ogg->p_title && ap_ogg->hdrs_complete
+       && EHttprOggCodecUnknown != ap_ogg->codec);
+  return OMX_ErrorNone;
+}
+
+httpr_ogg_codec_t
+httpr_ogg_codec (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return ap_ogg->codec;
+}
+
+OMX_U32
+httpr_ogg_channels (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return ap_ogg->channels;
+}
+
+OMX_U32
+httpr_ogg_sample_rate (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return ap_ogg->sample_rate;
+}
+
+OMX_U32
+httpr_ogg_bitrate (const httpr_ogg_t * ap_ogg)
+{
+  assert (ap_ogg);
+  return ap_ogg->bitrate;
+}
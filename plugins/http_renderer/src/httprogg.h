@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httprogg.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - HTTP renderer's Ogg page tracker
+ *
+ *
+ */
+
+#ifndef HTTPROGG_H
+#define HTTPROGG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef enum httpr_ogg_codec httpr_ogg_codec_t;
+enum httpr_ogg_codec
+{
+  EHttprOggCodecUnknown = 0,
+  EHttprOggCodecOpus,
+  EHttprOggCodecVorbis,
+  EHttprOggCodecMax
+};
+
+typedef struct httpr_ogg httpr_ogg_t;
+
+OMX_ERRORTYPE
+httpr_ogg_init (httpr_ogg_t ** app_ogg);
+
+void
+httpr_ogg_destroy (httpr_ogg_t * ap_ogg);
+
+void
+httpr_ogg_reset (httpr_ogg_t * ap_ogg);
+
+OMX_ERRORTYPE
+httpr_ogg_feed (httpr_ogg_t * ap_ogg, const OMX_U8 * ap_data,
+                const OMX_U32 a_len);
+
+OMX_U32
+httpr_ogg_available (const httpr_ogg_t * ap_ogg);
+
+const OMX_U8 *
+httpr_ogg_data (const httpr_ogg_t * ap_ogg);
+
+void
+httpr_ogg_advance (httpr_ogg_t * ap_ogg, const OMX_U32 a_nbytes);
+
+OMX_ERRORTYPE
+httpr_ogg_start_listener (httpr_ogg_t * ap_ogg);
+
+OMX_ERRORTYPE
+httpr_ogg_set_title (httpr_ogg_t * ap_ogg, const char * ap_title);
+
+httpr_ogg_codec_t
+httpr_ogg_codec (const httpr_ogg_t * ap_ogg);
+
+OMX_U32
+httpr_ogg_channels (const httpr_ogg_t * ap_ogg);
+
+OMX_U32
+httpr_ogg_sample_rate (const httpr_ogg_t * ap_ogg);
+
+OMX_U32
+httpr_ogg_bitrate (const httpr_ogg_t * ap_ogg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPROGG_H */
@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httproggport_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Http renderer Ogg input port class decls
+ *
+ *
+ */
+
+#ifndef HTTPROGGPORT_DECLS_H
+#define HTTPROGGPORT_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizoggport_decls.h>
+
+typedef struct httpr_oggport httpr_oggport_t;
+struct httpr_oggport
+{
+  /* Object */
+  const tiz_oggport_t _;
+  OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_;
+  OMX_STRING p_stream_title_;
+};
+
+typedef struct httpr_oggport_class httpr_oggport_class_t;
+struct httpr_oggport_class
+{
+  /* Class */
+  const tiz_oggport_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPROGGPORT_DECLS_H */
@@ -0,0 +1,405 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httproggtest.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - HTTP renderer - Ogg page tracker test
+ *
+ * Feeds a synthetic Ogg Opus stream, in which one packet spans a page
+ * boundary, to the page tracker and checks the pages that come out. A title
+ * change that arrives while the packet is split must not start the new chain
+ * until the packet is complete, and a listener that connects at that point
+ * must get the headers and then the first page that starts a packet.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "httprogg.h"
+
+#define TEST_SERIAL 0x1234
+#define TEST_PAGE_MAX (27 + 255 + 255 * 255)
+#define TEST_MAX_PAGES 32
+
+#define TEST_CONTINUED 0x01
+#define TEST_BOS 0x02
+#define TEST_EOS 0x04
+
+/* The data pages of the stream; the packet that starts at the end of
+   TEST_PAGE_SPLIT ends in TEST_PAGE_CONT */
+enum
+{
+  TEST_PAGE_A = 2,
+  TEST_PAGE_SPLIT,
+  TEST_PAGE_CONT,
+  TEST_PAGE_D
+};
+
+typedef struct test_page test_page_t;
+struct test_page
+{
+  unsigned char flags;
+  unsigned int serial;
+  unsigned int seq;
+  long long granule;
+  unsigned int len;
+  unsigned char marker; /* first body byte */
+};
+
+static unsigned int crc_table[256];
+
+static void
+init_crc (void)
+{
+  unsigned int i = 0;
+  for (i = 0; i < 256; ++i)
+    {
+      unsigned int r = i << 24;
+      int j = 0;
+      for (j = 0; j < 8; ++j)
+        {
+          r = (r & 0x80000000) ? (r << 1) ^ 0x04c11db7 : (r << 1);
+        }
+      crc_table[i] = r;
+    }
+}
+
+static void
+wr32 (unsigned char * ap_p, const unsigned int a_val)
+{
+  ap_p[0] = a_val & 0xff;
+  ap_p[1] = (a_val >> 8) & 0xff;
+  ap_p[2] = (a_val >> 16) & 0xff;
+  ap_p[3] = (a_val >> 24) & 0xff;
+}
+
+static unsigned int
+rd32 (const unsigned char * ap_p)
+{
+  return (unsigned int) ap_p[0] | ((unsigned int) ap_p[1] << 8)
+         | ((unsigned int) ap_p[2] << 16) | ((unsigned int) ap_p[3] << 24);
+}
+
+static unsigned int
+page_crc (const unsigned char * ap_page, const unsigned int a_len)
+{
+  unsigned int crc = 0;
+  unsigned int i = 0;
+  for (i = 0; i < a_len; ++i)
+    {
+      const unsigned char b = (i >= 22 && i < 26) ? 0 : ap_page[i];
+      crc = (crc << 8) ^ crc_table[((crc >> 24) & 0xff) ^ b];
+    }
+  return crc;
+}
+
+/* Builds a page with the given lacing values; the body bytes are all
+   a_marker. Returns the page length. */
+static unsigned int
+make_page (unsigned char * ap_page, const unsigned char a_flags,
+           const unsigned int a_seq, const long long a_granule,
+           const unsigned char * ap_lacing, const unsigned int a_nsegs,
+           const unsigned char a_marker)
+{
+  unsigned int body = 0;
+  unsigned int i = 0;
+
+  memcpy (ap_page, "OggS", 4);
+  ap_page[4] = 0;
+  ap_page[5] = a_flags;
+  wr32 (ap_page + 6, (unsigned int) ((unsigned long long) a_granule));
+  wr32 (ap_page + 10, (unsigned int) ((unsigned long long) a_granule >> 32));
+  wr32 (ap_page + 14, TEST_SERIAL);
+  wr32 (ap_page + 18, a_seq);
+  ap_page[26] = a_nsegs;
+  for (i = 0; i < a_nsegs; ++i)
+    {
+      ap_page[27 + i] = ap_lacing[i];
+      body += ap_lacing[i];
+    }
+  memset (ap_page + 27 + a_nsegs, a_marker, body);
+  wr32 (ap_page + 22, page_crc (ap_page, 27 + a_nsegs + body));
+  return 27 + a_nsegs + body;
+}
+
+static unsigned int
+make_opus_head (unsigned char * ap_page)
+{
+  static const unsigned char lacing[] = {19};
+  const unsigned int len
+    = make_page (ap_page, TEST_BOS, 0, 0, lacing, 1, 0);
+  unsigned char * p_body = ap_page + 28;
+  memcpy (p_body, "OpusHead", 8);
+  p_body[8] = 1;  /* version */
+  p_body[9] = 2;  /* channels */
+  p_body[10] = 0; /* pre-skip */
+  p_body[11] = 0;
+  wr32 (p_body + 12, 48000);
+  p_body[16] = 0; /* output gain */
+  p_body[17] = 0;
+  p_body[18] = 0; /* mapping family */
+  wr32 (ap_page + 22, page_crc (ap_page, len));
+  return len;
+}
+
+static unsigned int
+make_opus_tags (unsigned char * ap_page)
+{
+  static const unsigned char lacing[] = {20};
+  const unsigned int len = make_page (ap_page, 0, 1, 0, lacing, 1, 0);
+  unsigned char * p_body = ap_page + 28;
+  memcpy (p_body, "OpusTags", 8);
+  wr32 (p_body + 8, 4);
+  memcpy (p_body + 12, "test", 4);
+  wr32 (p_body + 16, 0); /* no comments */
+  wr32 (ap_page + 22, page_crc (ap_page, len));
+  return len;
+}
+
+static bool
+feed_page (httpr_ogg_t * ap_ogg, const int a_which)
+{
+  static const unsigned char whole[] = {100, 100};
+  static const unsigned char split[] = {100, 255};
+  static const unsigned char cont[] = {50, 100};
+  unsigned char page[TEST_PAGE_MAX];
+  unsigned int len = 0;
+
+  switch (a_which)
+    {
+      case 0:
+        len = make_opus_head (page);
+        break;
+      case 1:
+        len = make_opus_tags (page);
+        break;
+      case TEST_PAGE_A:
+        len = make_page (page, 0, 2, 1920, whole, 2, 'A');
+        break;
+      case TEST_PAGE_SPLIT:
+        /* The second packet goes on in the next page */
+        len = make_page (page, 0, 3, 2880, split, 2, 'S');
+        break;
+      case TEST_PAGE_CONT:
+        len = make_page (page, TEST_CONTINUED, 4, 4800, cont, 2, 'C');
+        break;
+      default:
+        len = make_page (page, 0, a_which, 960 * (a_which + 2), whole, 2,
+                         (unsigned char) ('A' + a_which - TEST_PAGE_A));
+        break;
+    };
+
+  return OMX_ErrorNone == httpr_ogg_feed (ap_ogg, page, len);
+}
+
+/* Splits what the tracker has queued into pages, and consumes it */
+static int
+drain_pages (httpr_ogg_t * ap_ogg, test_page_t * ap_pages, int a_max)
+{
+  const unsigned char * p_data = httpr_ogg_data (ap_ogg);
+  const unsigned int avail = httpr_ogg_available (ap_ogg);
+  unsigned int pos = 0;
+  int count = 0;
+
+  while (pos + 27 <= avail && count < a_max)
+    {
+      const unsigned char * p_page = p_data + pos;
+      const unsigned int nsegs = p_page[26];
+      unsigned int len = 27 + nsegs;
+      unsigned int i = 0;
+
+      if (0 != memcmp (p_page, "OggS", 4))
+        {
+          return -1;
+        }
+      for (i = 0; i < nsegs; ++i)
+        {
+          len += p_page[27 + i];
+        }
+      if (pos + len > avail || page_crc (p_page, len) != rd32 (p_page + 22))
+        {
+          return -1;
+        }
+      ap_pages[count].flags = p_page[5];
+      ap_pages[count].serial = rd32 (p_page + 14);
+      ap_pages[count].seq = rd32 (p_page + 18);
+      ap_pages[count].granule = (long long) rd32 (p_page + 6)
+                                | ((long long) rd32 (p_page + 10) << 32);
+      ap_pages[count].len = len;
+      ap_pages[count].marker = len > 27 + nsegs ? p_page[27 + nsegs] : 0;
+      ++count;
+      pos += len;
+    }
+
+  if (pos != avail)
+    {
+      return -1;
+    }
+  httpr_ogg_advance (ap_ogg, avail);
+  return count;
+}
+
+static bool
+fail (const char * ap_what)
+{
+  fprintf (stderr, "httproggtest: %s\n", ap_what);
+  return false;
+}
+
+/* The title changes while the split packet is pending. The old chain must
+   take the continuation page, and end after it. */
+static bool
+test_chain_waits_for_packet_end (void)
+{
+  httpr_ogg_t * p_ogg = NULL;
+  test_page_t pages[TEST_MAX_PAGES];
+  int n = 0;
+  bool ok = false;
+
+  if (OMX_ErrorNone != httpr_ogg_init (&p_ogg))
+    {
+      return fail ("unable to init the tracker");
+    }
+
+  if (!feed_page (p_ogg, 0) || !feed_page (p_ogg, 1)
+      || !feed_page (p_ogg, TEST_PAGE_A) || !feed_page (p_ogg, TEST_PAGE_SPLIT)
+      || drain_pages (p_ogg, pages, TEST_MAX_PAGES) != 4)
+    {
+      ok = fail ("stream start");
+    }
+  else if (OMX_ErrorNone != httpr_ogg_set_title (p_ogg, "Next")
+           || !feed_page (p_ogg, TEST_PAGE_CONT)
+           || !feed_page (p_ogg, TEST_PAGE_D)
+           || (n = drain_pages (p_ogg, pages, TEST_MAX_PAGES)) < 0)
+    {
+      ok = fail ("title change");
+    }
+  else if (n != 5)
+    {
+      /* continuation, EOS, OpusHead, OpusTags, D */
+      ok = fail ("unexpected page count after the title change");
+    }
+  else if ('C' != pages[0].marker || TEST_SERIAL != pages[0].serial
+           || !(pages[0].flags & TEST_CONTINUED))
+    {
+      ok = fail ("the continuation page left the chain of its packet");
+    }
+  else if (!(pages[1].flags & TEST_EOS) || TEST_SERIAL != pages[1].serial)
+    {
+      ok = fail ("the old chain did not end after the split packet");
+    }
+  else if (!(pages[2].flags & TEST_BOS) || TEST_SERIAL == pages[2].serial
+           || pages[3].serial != pages[2].serial
+           || pages[4].serial != pages[2].serial)
+    {
+      ok = fail ("the new chain is not a stream of its own");
+    }
+  else if ('D' != pages[4].marker || (pages[4].flags & TEST_CONTINUED)
+           || 2 != pages[4].seq)
+    {
+      ok = fail ("the new chain does not start with a whole packet");
+    }
+  else
+    {
+      ok = true;
+    }
+
+  httpr_ogg_destroy (p_ogg);
+  return ok;
+}
+
+/* A listener connects while the split packet is pending. It gets the
+   headers, then D; the continuation page is of no use to it. */
+static bool
+test_listener_waits_for_packet_end (void)
+{
+  httpr_ogg_t * p_ogg = NULL;
+  test_page_t pages[TEST_MAX_PAGES];
+  int n = 0;
+  bool ok = false;
+
+  if (OMX_ErrorNone != httpr_ogg_init (&p_ogg))
+    {
+      return fail ("unable to init the tracker");
+    }
+
+  if (!feed_page (p_ogg, 0) || !feed_page (p_ogg, 1)
+      || !feed_page (p_ogg, TEST_PAGE_A) || !feed_page (p_ogg, TEST_PAGE_SPLIT)
+      || OMX_ErrorNone != httpr_ogg_start_listener (p_ogg)
+      || !feed_page (p_ogg, TEST_PAGE_CONT) || !feed_page (p_ogg, TEST_PAGE_D)
+      || (n = drain_pages (p_ogg, pages, TEST_MAX_PAGES)) < 0)
+    {
+      ok = fail ("listener start");
+    }
+  else if (n != 3)
+    {
+      /* OpusHead, OpusTags, D */
+      ok = fail ("unexpected page count for the new listener");
+    }
+  else if (!(pages[0].flags & TEST_BOS) || 0 != pages[1].granule)
+    {
+      ok = fail ("the listener did not get the headers first");
+    }
+  else if ('D' != pages[2].marker || (pages[2].flags & TEST_CONTINUED))
+    {
+      ok = fail ("the listener got the end of a packet it never saw begin");
+    }
+  else if (!feed_page (p_ogg, TEST_PAGE_D + 1)
+           || 1 != drain_pages (p_ogg, pages, TEST_MAX_PAGES)
+           || 'E' != pages[0].marker)
+    {
+      ok = fail ("the pages that follow are not passed through");
+    }
+  else
+    {
+      ok = true;
+    }
+
+  httpr_ogg_destroy (p_ogg);
+  return ok;
+}
+
+int
+main (int argc, char ** argv)
+{
+  (void) argc;
+  (void) argv;
+
+  init_crc ();
+
+  if (!test_chain_waits_for_packet_end ()
+      || !test_listener_waits_for_packet_end ())
+    {
+      return EXIT_FAILURE;
+    }
+
+  fprintf (stderr, "httproggtest: OK\n");
+  return EXIT_SUCCESS;
+}
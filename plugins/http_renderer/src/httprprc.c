@@ -148,6 +148,53 @@ retrieve_mountpoint_settings (const void * ap_prc,
   return OMX_ErrorNone;
 }
 
+static inline OMX_ERRORTYPE
+retrieve_segmenter_settings (const void * ap_prc,
+                             OMX_TIZONIA_HTTPSEGMENTERTYPE * ap_segmenter)
+{
+  const httpr_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_segmenter);
+
+  /* Retrieve the segmenting mode settings from the input port */
+  TIZ_INIT_OMX_PORT_STRUCT (*ap_segmenter, ARATELIA_HTTP_RENDERER_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
+    OMX_TizoniaIndexParamHttpSegmenter, ap_segmenter));
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+set_stream_settings (httpr_prc_t * ap_prc)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  assert (ap_prc);
+
+  /* The input port's encoding tells which of the two roles is in use */
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_HTTP_RENDERER_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_IndexParamPortDefinition, &port_def));
+
+  if ((OMX_AUDIO_CODINGTYPE) OMX_AUDIO_CodingOGA
+      == port_def.format.audio.eEncoding)
+    {
+      tiz_check_omx (httpr_srv_set_ogg_settings (ap_prc->p_server_));
+      /* Only MP3 streams can be segmented */
+      ap_prc->segmenter_.bEnabled = OMX_FALSE;
+    }
+  else
+    {
+      tiz_check_omx (retrieve_mp3_settings (ap_prc, &(ap_prc->mp3type_)));
+      httpr_srv_set_mp3_settings (ap_prc->p_server_, ap_prc->mp3type_.nBitRate,
+                                  ap_prc->mp3type_.nChannels,
+                                  ap_prc->mp3type_.nSampleRate);
+      tiz_check_omx (
+        retrieve_segmenter_settings (ap_prc, &(ap_prc->segmenter_)));
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * httprprc
  */
@@ -214,12 +261,8 @@ httpr_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
 
   assert (p_prc);
 
-  /* Obtain mp3 settings from port */
-  tiz_check_omx (retrieve_mp3_settings (ap_prc, &(p_prc->mp3type_)));
-
-  httpr_srv_set_mp3_settings (p_prc->p_server_, p_prc->mp3type_.nBitRate,
-                              p_prc->mp3type_.nChannels,
-                              p_prc->mp3type_.nSampleRate);
+  /* Obtain the stream settings from port */
+  tiz_check_omx (set_stream_settings (p_prc));
 
   /* Obtain mount point and station-related information */
   tiz_check_omx (
@@ -235,6 +278,11 @@ httpr_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
        : 0),
     p_prc->mountpoint_.nMaxClients);
 
+  /* The segments are named after the mount point */
+  tiz_check_omx (httpr_srv_set_hls_settings (
+    p_prc->p_server_, p_prc->segmenter_.bEnabled,
+    p_prc->segmenter_.nSegmentDurationMs, p_prc->segmenter_.nWindowSegments));
+
   tiz_check_omx (
     httpr_prc_config_change (p_prc, ARATELIA_HTTP_RENDERER_PORT_INDEX,
                              OMX_TizoniaIndexConfigIcecastMetadata));
@@ -299,7 +347,7 @@ httpr_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
   assert (p_prc);
   if (p_prc->p_server_)
     {
-      rc = httpr_srv_timer_event (p_prc->p_server_);
+      rc = httpr_srv_timer_event (p_prc->p_server_, ap_ev_timer);
     }
   return rc;
 }
@@ -314,10 +362,7 @@ httpr_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
 
   p_prc->port_disabled_ = false;
 
-  tiz_check_omx (retrieve_mp3_settings (p_prc, &(p_prc->mp3type_)));
-  httpr_srv_set_mp3_settings (p_prc->p_server_, p_prc->mp3type_.nBitRate,
-                              p_prc->mp3type_.nChannels,
-                              p_prc->mp3type_.nSampleRate);
+  tiz_check_omx (set_stream_settings (p_prc));
   tiz_check_omx (
     httpr_prc_config_change (p_prc, ARATELIA_HTTP_RENDERER_PORT_INDEX,
                              OMX_TizoniaIndexConfigIcecastMetadata));
@@ -379,6 +424,28 @@ httpr_prc_config_change (const void * ap_prc, const OMX_U32 a_pid,
   return rc;
 }
 
+static OMX_ERRORTYPE
+httpr_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                     OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  httpr_prc_t * p_prc = (httpr_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigIcecastMountStats == a_index)
+    {
+      OMX_TIZONIA_ICECASTMOUNTSTATSTYPE * p_stats
+        = (OMX_TIZONIA_ICECASTMOUNTSTATSTYPE *) ap_struct;
+      if (!p_prc->p_server_)
+        {
+          /* The server only exists in the Idle and Executing states */
+          return OMX_ErrorIncorrectStateOperation;
+        }
+      httpr_srv_get_stats (p_prc->p_server_, p_stats);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * httpr_prc_class
  */
@@ -448,6 +515,8 @@ httpr_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, httpr_prc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_config_change, httpr_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, httpr_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
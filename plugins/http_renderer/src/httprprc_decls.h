@@ -55,6 +55,7 @@ struct httpr_prc
   OMX_AUDIO_PARAM_MP3TYPE mp3type_;
   OMX_TIZONIA_HTTPSERVERTYPE server_info_;
   OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_;
+  OMX_TIZONIA_HTTPSEGMENTERTYPE segmenter_;
 };
 
 typedef struct httpr_prc_class httpr_prc_class_t;
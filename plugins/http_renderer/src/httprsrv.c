@@ -23,7 +23,18 @@
  *
  * @brief Tizonia - HTTP renderer's networking functions
  *
- * NOTE: This is work in progress!!!!
+ * In MP3 mode, the stream is kept in a backlog shared by all the listeners of
+ * the mount point. Each listener reads from it at its own pace, and the
+ * listeners that reach the most recent byte pull the next ones from the
+ * current OMX buffer. A listener that falls behind by more than the whole
+ * backlog is disconnected.
+ *
+ * In segmenting mode (HTTP Live Streaming), a timer-driven pump is the only
+ * consumer of OMX buffers: it feeds the backlog and the segmenter, never more
+ * than a couple of segments ahead of the wall clock. Requests for the
+ * playlist or a segment get a one-off response with the object and are not
+ * counted as listeners; plain requests to the mount point keep streaming
+ * from the backlog.
  *
  * TODO: Better flow control
  *
@@ -35,6 +46,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -43,6 +55,7 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <time.h>
 #include <sys/ioctl.h>
@@ -53,6 +66,7 @@
 #include <OMX_TizoniaExt.h>
 
 #include "httpr.h"
+#include "httprogg.h"
 #include "httprsrv.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -66,6 +80,22 @@
 #define ICE_RENDERER_MAX_ADDR_LEN 46
 #endif
 
+/* Re-pace an Ogg stream when the measured bitrate is this far (in percent)
+ * from the one in use */
+#define ICE_OGG_BITRATE_TOLERANCE 10
+
+/* Size of the MP3 stream backlog shared by the listeners of the mount point.
+ * New listeners get their initial burst from its second half */
+#define ICE_BACKLOG_SIZE (2 * ICE_INITIAL_BURST_SIZE)
+
+/* Segmenting mode: how often the pump runs (in seconds), and how far ahead
+ * of the wall clock, in segments, it may go so that a new client finds a
+ * playlist to start with */
+#define HLS_PUMP_INTERVAL 0.1
+#define HLS_PUMP_LEAD_SEGMENTS 2
+#define HLS_PLAYLIST_EXT ".m3u8"
+#define HLS_ROOT_BASE_NAME "/stream"
+
 typedef struct httpr_connection httpr_connection_t;
 typedef struct httpr_listener httpr_listener_t;
 typedef struct httpr_listener_buffer httpr_listener_buffer_t;
@@ -115,12 +145,18 @@ struct httpr_listener
   httpr_connection_t * p_con;
   int respcode;
   long intro_offset;
-  unsigned long pos;
+  uint64_t pos; /* Stream position of the next byte to copy (MP3 mode) */
   httpr_listener_buffer_t buf;
   tiz_http_parser_t * p_parser;
   bool need_response;
   bool timer_started;
   bool want_metadata;
+  bool awaiting_data; /* Starved; resumes on the next buffer event */
+  tiz_hls_segment_t * p_segment; /* Segmenting mode: segment being sent */
+  char * p_playlist;             /* Segmenting mode: playlist being sent */
+  const char * p_object;         /* Either of the above, if any */
+  size_t object_len;
+  size_t object_sent;
 };
 
 struct httpr_server
@@ -129,8 +165,7 @@ struct httpr_server
   int lstn_sockfd;
   char * p_ip;
   tiz_event_io_t * p_srv_ev_io;
-  OMX_U32 max_clients; /* In future, more than one will be allowed;
-                          only one allowed at the moment. */
+  OMX_U32 max_clients;
   tiz_map_t * p_lstnrs;
   OMX_BUFFERHEADERTYPE * p_hdr;
   httpr_srv_release_buffer_f pf_release_buf;
@@ -146,6 +181,22 @@ struct httpr_server
   double wait_time;
   double pkts_per_sec;
   httpr_mount_t mountpoint;
+  httpr_ogg_t * p_ogg; /* Only in Ogg mode */
+  char * p_backlog;    /* Only in MP3 mode */
+  size_t backlog_size;
+  uint64_t backlog_head; /* Stream bytes received so far */
+  OMX_U32 peak_listeners;
+  OMX_U32 rejected;
+  OMX_U32 underruns;
+  uint64_t bytes_sent;
+  tiz_hls_t * p_hls; /* Only in segmenting mode */
+  OMX_U32 hls_segment_ms;
+  OMX_U32 hls_window;
+  tiz_event_timer_t * p_hls_timer;
+  bool hls_timer_started;
+  struct timespec hls_epoch; /* Wall clock time when the pump (re)started */
+  OMX_U64 hls_epoch_ms;      /* Stream time when the pump (re)started */
+  int objects;               /* Listeners being sent a playlist or segment */
 };
 
 static void
@@ -216,6 +267,15 @@ srv_get_listeners_count (const httpr_server_t * ap_server)
   return rc;
 }
 
+/* The listeners that are, or are about to be, streaming from the mount
+ * point */
+static inline OMX_U32
+srv_get_stream_listeners_count (const httpr_server_t * ap_server)
+{
+  assert (ap_server);
+  return srv_get_listeners_count (ap_server) - ap_server->objects;
+}
+
 static httpr_listener_t *
 srv_get_first_listener (const httpr_server_t * ap_server)
 {
@@ -227,6 +287,56 @@ srv_get_first_listener (const httpr_server_t * ap_server)
   return p_lstnr;
 }
 
+static httpr_listener_t *
+srv_find_listener_by_fd (const httpr_server_t * ap_server, int a_fd)
+{
+  httpr_listener_t * p_lstnr = NULL;
+  if (srv_get_listeners_count (ap_server) > 0)
+    {
+      p_lstnr = tiz_map_find (ap_server->p_lstnrs, &a_fd);
+    }
+  return p_lstnr;
+}
+
+static httpr_listener_t *
+srv_find_listener_by_timer (const httpr_server_t * ap_server,
+                            const tiz_event_timer_t * ap_ev_timer)
+{
+  int i = 0;
+  for (i = 0; i < srv_get_listeners_count (ap_server); ++i)
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      if (p_lstnr && p_lstnr->p_con
+          && ap_ev_timer == p_lstnr->p_con->p_ev_timer)
+        {
+          return p_lstnr;
+        }
+    }
+  return NULL;
+}
+
+static OMX_U32
+srv_get_max_listeners (const httpr_server_t * ap_server)
+{
+  OMX_U32 max_listeners = 0;
+  assert (ap_server);
+
+  /* The Ogg headers are queued on the shared page tracker for each new
+   * listener; an Ogg stream goes to one listener at a time */
+  if (ap_server->p_ogg)
+    {
+      return 1;
+    }
+
+  max_listeners = ap_server->mountpoint.max_clients;
+  if (ap_server->max_clients > 0
+      && (0 == max_listeners || ap_server->max_clients < max_listeners))
+    {
+      max_listeners = ap_server->max_clients;
+    }
+  return max_listeners > 0 ? max_listeners : ICE_MAX_CLIENTS_PER_MOUNTPOINT;
+}
+
 static int
 srv_set_non_blocking (const int sockfd)
 {
@@ -536,6 +646,8 @@ srv_destroy_listener (httpr_listener_t * ap_lstnr)
           tiz_http_parser_destroy (ap_lstnr->p_parser);
         }
       tiz_mem_free (ap_lstnr->buf.p_data);
+      tiz_hls_put_segment (ap_lstnr->p_segment);
+      tiz_mem_free (ap_lstnr->p_playlist);
       srv_destroy_connection (ap_lstnr->p_con);
       tiz_mem_free (ap_lstnr);
     }
@@ -556,6 +668,10 @@ srv_remove_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
            "Destroyed listener [%s] - [%d] listeners remaining",
            ap_lstnr->p_con->p_ip, nlstnrs - 1);
 
+  if (ap_lstnr->p_object)
+    {
+      ap_server->objects--;
+    }
   tiz_map_erase (ap_server->p_lstnrs, &ap_lstnr->p_con->sockfd);
   assert (nlstnrs - 1 == srv_get_listeners_count (ap_server));
 
@@ -587,7 +703,8 @@ srv_create_connection (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
   p_con->sent_total = 0;
   p_con->sent_last = 0;
   p_con->burst_bytes = 0;
-  p_con->initial_burst_bytes = ap_server->mountpoint.initial_burst_size;
+  p_con->initial_burst_bytes
+    = MIN (ap_server->mountpoint.initial_burst_size, ICE_BACKLOG_SIZE / 2);
   p_con->sockfd = connected_sockfd;
   p_con->p_host = NULL;
   p_con->p_ip = ap_ip;
@@ -652,6 +769,12 @@ srv_create_listener (httpr_server_t * ap_server, httpr_listener_t ** app_lstnr,
   p_lstnr->need_response = true;
   p_lstnr->timer_started = false;
   p_lstnr->want_metadata = false;
+  p_lstnr->awaiting_data = false;
+  p_lstnr->p_segment = NULL;
+  p_lstnr->p_playlist = NULL;
+  p_lstnr->p_object = NULL;
+  p_lstnr->object_len = 0;
+  p_lstnr->object_sent = 0;
 
   p_lstnr->buf.p_data = (char *) tiz_mem_alloc (ICE_LISTENER_BUF_SIZE);
   rc = p_lstnr->buf.p_data ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
@@ -795,11 +918,122 @@ srv_send_http_error (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
   ap_lstnr->buf.len = 0;
 }
 
+static bool
+srv_media_range_matches (const char * ap_range, const size_t a_range_len,
+                         const char * ap_type, int * ap_specificity)
+{
+  const char * p_slash = strchr (ap_type, '/');
+  assert (p_slash);
+
+  if (a_range_len == strlen (ap_type)
+      && 0 == strncasecmp (ap_range, ap_type, a_range_len))
+    {
+      *ap_specificity = 2;
+      return true;
+    }
+  if (a_range_len == (size_t) (p_slash - ap_type) + 2
+      && 0 == strncasecmp (ap_range, ap_type, p_slash - ap_type + 1)
+      && '*' == ap_range[a_range_len - 1])
+    {
+      *ap_specificity = 1;
+      return true;
+    }
+  if (3 == a_range_len && 0 == strncmp (ap_range, "*/*", 3))
+    {
+      *ap_specificity = 0;
+      return true;
+    }
+  return false;
+}
+
+static bool
+srv_is_type_acceptable (const char * ap_accept, const char * ap_type)
+{
+  const char * p_range = ap_accept;
+  int best_specificity = -1;
+  bool acceptable = false;
+
+  while (p_range && *p_range)
+    {
+      const char * p_end = strchr (p_range, ',');
+      const char * p_param = NULL;
+      size_t range_len = 0;
+      size_t item_len = 0;
+      int specificity = -1;
+      bool refused = false;
+
+      while (' ' == *p_range || '\t' == *p_range)
+        {
+          ++p_range;
+        }
+      item_len = p_end ? (size_t) (p_end - p_range) : strlen (p_range);
+      p_param = memchr (p_range, ';', item_len);
+      range_len = p_param ? (size_t) (p_param - p_range) : item_len;
+      while (range_len > 0
+             && (' ' == p_range[range_len - 1]
+                 || '\t' == p_range[range_len - 1]))
+        {
+          --range_len;
+        }
+
+      /* Only q=0 matters here: it means "not acceptable" */
+      while (p_param && p_param < p_range + item_len)
+        {
+          ++p_param;
+          while (' ' == *p_param)
+            {
+              ++p_param;
+            }
+          if (0 == strncasecmp (p_param, "q=", 2))
+            {
+              refused = (0.0 == strtod (p_param + 2, NULL));
+            }
+          p_param = memchr (p_param, ';', p_range + item_len - p_param);
+        }
+
+      if (srv_media_range_matches (p_range, range_len, ap_type, &specificity)
+          && specificity > best_specificity)
+        {
+          best_specificity = specificity;
+          acceptable = !refused;
+        }
+
+      p_range = p_end ? p_end + 1 : NULL;
+    }
+
+  return acceptable;
+}
+
+/* Picks the first of the offered media types that the client's Accept header
+ * allows, or the first offered type if the client did not send the header or
+ * accepts none of them */
+static const char *
+srv_negotiate_content_type (const httpr_server_t * ap_server,
+                            const char * ap_accept)
+{
+  static const char * mp3_types[] = {"audio/mpeg", NULL};
+  static const char * ogg_types[] = {"audio/ogg", "application/ogg", NULL};
+  const char ** pp_types = NULL;
+  size_t i = 0;
+
+  assert (ap_server);
+  pp_types = ap_server->p_ogg ? ogg_types : mp3_types;
+
+  for (i = 0; ap_accept && pp_types[i]; ++i)
+    {
+      if (srv_is_type_acceptable (ap_accept, pp_types[i]))
+        {
+          return pp_types[i];
+        }
+    }
+  return pp_types[0];
+}
+
 static ssize_t
 srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
-                                  size_t len, OMX_U32 a_bitrate,
-                                  OMX_U32 a_num_channels, OMX_U32 a_sample_rate,
-                                  bool a_want_metadata)
+                                  size_t len, const char * ap_content_type,
+                                  OMX_U32 a_bitrate, OMX_U32 a_num_channels,
+                                  OMX_U32 a_sample_rate, bool a_want_metadata)
 {
   const char * http_version = "1.0";
   char status_buffer[80];
@@ -814,13 +1048,13 @@ srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
   char icymetaint_buffer[80];
   ssize_t ret;
   const char * statusmsg = "OK";
-  const char * contenttype = "audio/mpeg";
   int status = 200;
   int pub = 0;
   bool metadata_needed = false;
 
   assert (ap_server);
   assert (ap_buf);
+  assert (ap_content_type);
 
   /* HTTP status line */
   snprintf (status_buffer, sizeof (status_buffer), "HTTP/%s %d %s\r\n",
@@ -828,7 +1062,7 @@ srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
 
   /* HTTP Content-Type header */
   snprintf (contenttype_buffer, sizeof (contenttype_buffer),
-            "Content-Type: %s\r\n", contenttype);
+            "Content-Type: %s\r\n", ap_content_type);
 
   /* icy-br header */
   snprintf (icybr_buffer, sizeof (icybr_buffer), "icy-br:%d\r\n",
@@ -896,6 +1130,174 @@ srv_send_http_response (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
   return sent_bytes;
 }
 
+/* The request path, without the query, must name the mount point, unless
+ * this is the root */
+static bool
+srv_is_mountpoint_url (const httpr_server_t * ap_server, const char * ap_url)
+{
+  const char * p_mount = NULL;
+  size_t path_len = 0;
+
+  assert (ap_server);
+  assert (ap_url);
+
+  p_mount = (const char *) ap_server->mountpoint.mount_name;
+  if ('\0' == p_mount[0] || 0 == strcmp ("/", p_mount))
+    {
+      return true;
+    }
+
+  path_len = strcspn (ap_url, "?");
+  return (path_len == strlen (p_mount)
+          && 0 == strncmp (ap_url, p_mount, path_len));
+}
+
+/* Place a new listener in the backlog so that its initial burst comes from
+ * data already received, without pulling the stream ahead of the other
+ * listeners */
+static void
+srv_set_listener_start_pos (httpr_server_t * ap_server,
+                            httpr_listener_t * ap_lstnr)
+{
+  uint64_t burst = 0;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+  assert (ap_lstnr->p_con);
+
+  if (ap_lstnr->p_con->initial_burst_bytes > 0)
+    {
+      burst = MIN ((uint64_t) ap_lstnr->p_con->initial_burst_bytes,
+                   MIN (ap_server->backlog_head, ap_server->backlog_size / 2));
+    }
+  ap_lstnr->pos = ap_server->backlog_head - burst;
+}
+
+/* The playlist of mount point '/dir/name' is '/dir/name.m3u8' and its
+ * segments are '/dir/name-<n>.mp3'; those of the root mount point are named
+ * after 'stream' */
+static void
+srv_hls_get_base_name (const httpr_server_t * ap_server, char * ap_base,
+                       const size_t a_len)
+{
+  const char * p_mount = NULL;
+  assert (ap_server);
+  assert (ap_base);
+  p_mount = (const char *) ap_server->mountpoint.mount_name;
+  if ('\0' == p_mount[0] || 0 == strcmp ("/", p_mount))
+    {
+      p_mount = HLS_ROOT_BASE_NAME;
+    }
+  snprintf (ap_base, a_len, "%s", p_mount);
+}
+
+/* Copies the path of a request for the playlist or a segment, without the
+ * query, and returns what follows the base name in it; NULL if the request
+ * is for something else */
+static const char *
+srv_hls_get_object_path (const httpr_server_t * ap_server, const char * ap_url,
+                         char * ap_path, const size_t a_len)
+{
+  char base[OMX_MAX_STRINGNAME_SIZE];
+  const size_t path_len = strcspn (ap_url, "?");
+  size_t base_len = 0;
+
+  assert (ap_server);
+  assert (ap_url);
+  assert (ap_path);
+
+  if (!ap_server->p_hls || path_len >= a_len)
+    {
+      return NULL;
+    }
+
+  srv_hls_get_base_name (ap_server, base, sizeof (base));
+  base_len = strlen (base);
+  memcpy (ap_path, ap_url, path_len);
+  ap_path[path_len] = '\0';
+  if (0 != strncmp (ap_path, base, base_len)
+      || (0 != strcmp (ap_path + base_len, HLS_PLAYLIST_EXT)
+          && '-' != ap_path[base_len]))
+    {
+      return NULL;
+    }
+  return ap_path + base_len;
+}
+
+static bool
+srv_hls_is_object_url (const httpr_server_t * ap_server, const char * ap_url)
+{
+  char path[OMX_MAX_STRINGNAME_SIZE + 32];
+  return NULL != srv_hls_get_object_path (ap_server, ap_url, path,
+                                          sizeof (path));
+}
+
+/* Attaches the requested playlist or segment to the listener and builds the
+ * response header. Returns false if there is no such object */
+static bool
+srv_hls_open_object (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
+                     const char * ap_url)
+{
+  char path[OMX_MAX_STRINGNAME_SIZE + 32];
+  char cache_control[32];
+  const char * p_suffix = NULL;
+  const char * p_type = NULL;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+  assert (!ap_lstnr->p_object);
+
+  p_suffix = srv_hls_get_object_path (ap_server, ap_url, path, sizeof (path));
+  if (!p_suffix)
+    {
+      return false;
+    }
+
+  if (0 == strcmp (p_suffix, HLS_PLAYLIST_EXT))
+    {
+      const char * p_list = tiz_hls_playlist (ap_server->p_hls);
+      const size_t len = p_list ? strlen (p_list) : 0;
+      if (!p_list || !(ap_lstnr->p_playlist = tiz_mem_alloc (len + 1)))
+        {
+          return false;
+        }
+      memcpy (ap_lstnr->p_playlist, p_list, len + 1);
+      ap_lstnr->p_object = ap_lstnr->p_playlist;
+      ap_lstnr->object_len = len;
+      p_type = "application/vnd.apple.mpegurl";
+      /* A live playlist changes with every new segment */
+      snprintf (cache_control, sizeof (cache_control), "no-cache");
+    }
+  else
+    {
+      ap_lstnr->p_segment = tiz_hls_get_segment (ap_server->p_hls, path);
+      if (!ap_lstnr->p_segment)
+        {
+          return false;
+        }
+      ap_lstnr->p_object = tiz_hls_segment_data (ap_lstnr->p_segment);
+      ap_lstnr->object_len = tiz_hls_segment_len (ap_lstnr->p_segment);
+      p_type = "audio/mpeg";
+      /* A segment never changes */
+      snprintf (
+        cache_control, sizeof (cache_control), "max-age=%lu",
+        (ap_server->hls_segment_ms / 1000 + 1) * ap_server->hls_window);
+    }
+  ap_lstnr->object_sent = 0;
+  ap_server->objects++;
+
+  snprintf (ap_lstnr->buf.p_data, ICE_LISTENER_BUF_SIZE,
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Type: %s\r\n"
+            "Content-Length: %lu\r\n"
+            "Cache-Control: %s\r\n"
+            "Access-Control-Allow-Origin: *\r\n"
+            "Connection: close\r\n"
+            "Server: Tizonia HTTP Renderer 0.1.0\r\n\r\n",
+            p_type, (unsigned long) ap_lstnr->object_len, cache_control);
+  return true;
+}
+
 static OMX_ERRORTYPE
 srv_handle_listeners_request (httpr_server_t * ap_server,
                               httpr_listener_t * ap_lstnr)
@@ -927,9 +1329,6 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
   assert (ap_lstnr->p_con);
   assert (ap_lstnr->p_parser);
 
-  some_error = (srv_get_listeners_count (ap_server) > ap_server->max_clients);
-  bail_on_request_error (some_error, 400, "Client limit reached");
-
   /*   some_error */
   /*       = (ap_lstnr->p_con->con_time + ICE_DEFAULT_HEADER_TIMEOUT <= time
    * (NULL)); */
@@ -959,8 +1358,34 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
        || (0 != strncmp ("/", parsed_string, strlen ("/"))));
   bail_on_request_error (some_error, 401, "Unathorized");
 
-  if ((parsed_string
-       = tiz_http_parser_get_header (ap_lstnr->p_parser, "Icy-MetaData"))
+  /* Playlist and segment requests get their object and are done; they don't
+   * count as listeners */
+  if (srv_hls_is_object_url (ap_server, parsed_string))
+    {
+      some_error = !srv_hls_open_object (ap_server, ap_lstnr, parsed_string);
+      bail_on_request_error (some_error, 404, "Not found");
+
+      some_error = (0 == srv_send_http_response (ap_server, ap_lstnr));
+      bail_on_request_error (some_error, 500, "Internal Server Error");
+
+      ap_lstnr->need_response = false;
+      goto end;
+    }
+
+  some_error = (srv_get_stream_listeners_count (ap_server)
+                > srv_get_max_listeners (ap_server));
+  ap_server->rejected += some_error ? 1 : 0;
+  bail_on_request_error (some_error, 400, "Client limit reached");
+
+  some_error = !srv_is_mountpoint_url (ap_server, parsed_string);
+  ap_server->rejected += some_error ? 1 : 0;
+  bail_on_request_error (some_error, 404, "Mount point not found");
+
+  /* ICY metadata would corrupt an Ogg stream; Ogg listeners get the
+   * metadata in-band, in the comment headers */
+  if (!ap_server->p_ogg
+      && (parsed_string
+          = tiz_http_parser_get_header (ap_lstnr->p_parser, "Icy-MetaData"))
       && (0 == strncmp ("1", parsed_string, strlen ("1"))))
     {
       TIZ_TRACE (handleOf (ap_server->p_parent), "ICY metadata requested");
@@ -971,6 +1396,9 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
   some_error
     = (0 == (to_write = srv_build_http_positive_response (
                ap_server, ap_lstnr->buf.p_data, ICE_LISTENER_BUF_SIZE - 1,
+               srv_negotiate_content_type (
+                 ap_server,
+                 tiz_http_parser_get_header (ap_lstnr->p_parser, "Accept")),
                ap_server->bitrate, ap_server->num_channels,
                ap_server->sample_rate, ap_lstnr->want_metadata)));
   bail_on_request_error (some_error, 500, "Internal Server Error");
@@ -980,6 +1408,9 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
 
   some_error = false;
   ap_lstnr->need_response = false;
+  srv_set_listener_start_pos (ap_server, ap_lstnr);
+  ap_server->peak_listeners = MAX (ap_server->peak_listeners,
+                                   srv_get_stream_listeners_count (ap_server));
 
 end:
   if (some_error && OMX_ErrorNone == rc)
@@ -1020,7 +1451,6 @@ srv_release_empty_buffer (httpr_server_t * ap_server,
 
   p_hdr = *app_hdr;
 
-  ap_lstnr->pos = 0;
   p_hdr->nFilledLen = 0;
   ap_server->pf_release_buf (p_hdr, ap_server->p_arg);
   *app_hdr = NULL;
@@ -1188,39 +1618,275 @@ srv_arrange_metadata (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
   }
 }
 
+/* Re-arm the timers of the listeners that are being paced, after a change in
+ * the pacing */
 static void
-srv_arrange_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                  OMX_U8 ** app_buffer, size_t * ap_len)
+srv_restart_listener_timers (httpr_server_t * ap_server)
+{
+  int i = 0;
+  assert (ap_server);
+  for (i = 0; i < srv_get_listeners_count (ap_server); ++i)
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      assert (p_lstnr);
+      if (!p_lstnr->need_response && !p_lstnr->p_object)
+        {
+          srv_stop_listener_timer_watcher (p_lstnr);
+          srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+        }
+    }
+}
+
+static void
+srv_set_ogg_pacing (httpr_server_t * ap_server, const OMX_U32 a_bitrate)
+{
+  assert (ap_server);
+  assert (a_bitrate > 0);
+
+  ap_server->bitrate = a_bitrate;
+  ap_server->burst_size = ICE_MIN_BURST_SIZE;
+  ap_server->pkts_per_sec
+    = ((double) a_bitrate / 8) / (double) ap_server->burst_size;
+  ap_server->wait_time = (1 / ap_server->pkts_per_sec);
+
+  srv_restart_listener_timers (ap_server);
+
+  TIZ_PRINTF_DBG_MAG ("Ogg bitrate [%u] burst_size [%u] wait_time [%f].\n",
+                      (unsigned int) ap_server->bitrate,
+                      (unsigned int) ap_server->burst_size,
+                      ap_server->wait_time);
+}
+
+static void
+srv_update_ogg_settings (httpr_server_t * ap_server)
+{
+  const httpr_ogg_t * p_ogg = NULL;
+  OMX_U32 bitrate = 0;
+
+  assert (ap_server);
+  assert (ap_server->p_ogg);
+  p_ogg = ap_server->p_ogg;
+
+  if (httpr_ogg_channels (p_ogg) > 0)
+    {
+      ap_server->num_channels = httpr_ogg_channels (p_ogg);
+    }
+  if (httpr_ogg_sample_rate (p_ogg) > 0)
+    {
+      ap_server->sample_rate = httpr_ogg_sample_rate (p_ogg);
+    }
+
+  /* Pace the stream with the bitrate measured from the page positions */
+  bitrate = httpr_ogg_bitrate (p_ogg);
+  if (bitrate > 0
+      && (bitrate * 100
+               > ap_server->bitrate * (100 + ICE_OGG_BITRATE_TOLERANCE)
+          || bitrate * 100
+               < ap_server->bitrate * (100 - ICE_OGG_BITRATE_TOLERANCE)))
+    {
+      srv_set_ogg_pacing (ap_server, bitrate);
+    }
+}
+
+static void
+srv_arrange_ogg_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
-  OMX_U8 * p_buffer = NULL;
-  size_t len = 0;
   httpr_listener_buffer_t * p_lstnr_buf = NULL;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  OMX_U32 to_copy = 0;
 
   assert (ap_server);
+  assert (ap_server->p_ogg);
   assert (ap_lstnr);
-  assert (app_buffer);
-  assert (ap_len);
 
   p_lstnr_buf = &ap_lstnr->buf;
   p_hdr = ap_server->p_hdr;
 
-  if (p_hdr && p_hdr->pBuffer && p_hdr->nFilledLen > 0)
+  if (ap_server->burst_size > p_lstnr_buf->len)
     {
-      int to_copy = 0;
-      if (ap_server->burst_size > p_lstnr_buf->len)
-        {
-          to_copy = ap_server->burst_size - p_lstnr_buf->len;
-        }
-      if (to_copy > p_hdr->nFilledLen)
+      to_copy = ap_server->burst_size - p_lstnr_buf->len;
+    }
+
+  /* Whole pages only leave the page tracker; only pull more data from the
+   * OMX buffer when the queued pages are not enough */
+  if (httpr_ogg_available (ap_server->p_ogg) < to_copy && p_hdr
+      && p_hdr->pBuffer && p_hdr->nFilledLen > 0)
+    {
+      OMX_ERRORTYPE rc = httpr_ogg_feed (
+        ap_server->p_ogg, p_hdr->pBuffer + p_hdr->nOffset, p_hdr->nFilledLen);
+      if (OMX_ErrorNone != rc)
         {
-          to_copy = p_hdr->nFilledLen;
+          TIZ_ERROR (handleOf (ap_server->p_parent),
+                     "[%s] : while splitting the Ogg pages",
+                     tiz_err_to_str (rc));
         }
+      p_hdr->nOffset += p_hdr->nFilledLen;
+      p_hdr->nFilledLen = 0;
+      srv_update_ogg_settings (ap_server);
+    }
+
+  to_copy = MIN (to_copy, httpr_ogg_available (ap_server->p_ogg));
+  if (to_copy > 0)
+    {
       memcpy (p_lstnr_buf->p_data + p_lstnr_buf->len,
-              p_hdr->pBuffer + p_hdr->nOffset, to_copy);
+              httpr_ogg_data (ap_server->p_ogg), to_copy);
+      httpr_ogg_advance (ap_server->p_ogg, to_copy);
+      p_lstnr_buf->len += to_copy;
+    }
+}
+
+static void
+srv_append_to_backlog (httpr_server_t * ap_server, const OMX_U8 * ap_data,
+                       size_t a_len)
+{
+  assert (ap_server);
+  assert (ap_server->p_backlog);
+  assert (ap_data);
+
+  while (a_len > 0)
+    {
+      const size_t offset = ap_server->backlog_head % ap_server->backlog_size;
+      const size_t chunk = MIN (a_len, ap_server->backlog_size - offset);
+      memcpy (ap_server->p_backlog + offset, ap_data, chunk);
+      ap_server->backlog_head += chunk;
+      ap_data += chunk;
+      a_len -= chunk;
+    }
+}
+
+static void
+srv_read_from_backlog (const httpr_server_t * ap_server, uint64_t a_pos,
+                       char * ap_dest, size_t a_len)
+{
+  assert (ap_server);
+  assert (ap_server->p_backlog);
+  assert (ap_dest);
+  assert (a_pos + a_len <= ap_server->backlog_head);
+  assert (ap_server->backlog_head - a_pos <= ap_server->backlog_size);
+
+  while (a_len > 0)
+    {
+      const size_t offset = a_pos % ap_server->backlog_size;
+      const size_t chunk = MIN (a_len, ap_server->backlog_size - offset);
+      memcpy (ap_dest, ap_server->p_backlog + offset, chunk);
+      a_pos += chunk;
+      ap_dest += chunk;
+      a_len -= chunk;
+    }
+}
+
+static void
+srv_arrange_mp3_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+{
+  httpr_listener_buffer_t * p_lstnr_buf = NULL;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  size_t to_copy = 0;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+
+  p_lstnr_buf = &ap_lstnr->buf;
+  p_hdr = ap_server->p_hdr;
+
+  if (ap_server->burst_size > p_lstnr_buf->len)
+    {
+      to_copy = ap_server->burst_size - p_lstnr_buf->len;
+    }
+
+  /* Only the listeners that have caught up with the stream pull more data
+   * from the OMX buffer into the backlog; in segmenting mode, the pump does */
+  if (to_copy > 0 && ap_lstnr->pos == ap_server->backlog_head && p_hdr
+      && p_hdr->pBuffer && p_hdr->nFilledLen > 0 && !ap_server->p_hls)
+    {
+      const size_t to_append = MIN (to_copy, p_hdr->nFilledLen);
+      srv_append_to_backlog (ap_server, p_hdr->pBuffer + p_hdr->nOffset,
+                             to_append);
+      p_hdr->nFilledLen -= to_append;
+      p_hdr->nOffset += to_append;
+    }
+
+  to_copy = MIN (to_copy, ap_server->backlog_head - ap_lstnr->pos);
+  if (to_copy > 0)
+    {
+      srv_read_from_backlog (ap_server, ap_lstnr->pos,
+                             p_lstnr_buf->p_data + p_lstnr_buf->len, to_copy);
+      ap_lstnr->pos += to_copy;
       p_lstnr_buf->len += to_copy;
-      p_hdr->nFilledLen -= to_copy;
-      p_hdr->nOffset += to_copy;
+    }
+}
+
+static bool
+srv_is_listener_too_slow (const httpr_server_t * ap_server,
+                          const httpr_listener_t * ap_lstnr)
+{
+  assert (ap_server);
+  assert (ap_lstnr);
+  if (ap_server->p_ogg || ap_lstnr->need_response || ap_lstnr->p_object
+      || ap_server->backlog_head - ap_lstnr->pos <= ap_server->backlog_size)
+    {
+      return false;
+    }
+  TIZ_WARN (handleOf (ap_server->p_parent),
+            "Will destroy listener [%s] (too slow, [%llu] bytes behind)",
+            ap_lstnr->p_con->p_ip,
+            (unsigned long long) (ap_server->backlog_head - ap_lstnr->pos));
+  return true;
+}
+
+/* Listeners whose socket stays full are not serviced, and would never be
+ * found to be too slow otherwise */
+static void
+srv_remove_slow_listeners (httpr_server_t * ap_server)
+{
+  int i = 0;
+  assert (ap_server);
+  while (i < srv_get_listeners_count (ap_server))
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      assert (p_lstnr);
+      if (srv_is_listener_too_slow (ap_server, p_lstnr))
+        {
+          srv_remove_listener (ap_server, p_lstnr);
+        }
+      else
+        {
+          ++i;
+        }
+    }
+}
+
+static inline bool
+srv_has_queued_data (const httpr_server_t * ap_server,
+                     const httpr_listener_t * ap_lstnr)
+{
+  assert (ap_server);
+  assert (ap_lstnr);
+  return (ap_server->p_ogg ? httpr_ogg_available (ap_server->p_ogg) > 0
+                           : ap_lstnr->pos < ap_server->backlog_head);
+}
+
+static void
+srv_arrange_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
+                  OMX_U8 ** app_buffer, size_t * ap_len)
+{
+  OMX_U8 * p_buffer = NULL;
+  size_t len = 0;
+  httpr_listener_buffer_t * p_lstnr_buf = NULL;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+  assert (app_buffer);
+  assert (ap_len);
+
+  p_lstnr_buf = &ap_lstnr->buf;
+
+  if (ap_server->p_ogg)
+    {
+      srv_arrange_ogg_data (ap_server, ap_lstnr);
+    }
+  else
+    {
+      srv_arrange_mp3_data (ap_server, ap_lstnr);
     }
 
   p_buffer = (OMX_U8 *) p_lstnr_buf->p_data;
@@ -1306,6 +1972,11 @@ srv_write_omx_buffer (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
       /* The socket is not valid anymore. The listener will be removed. */
       rc = OMX_ErrorNoMore;
     }
+  else if (srv_is_listener_too_slow (ap_server, ap_lstnr))
+    {
+      /* What it has not received yet is not in the backlog anymore */
+      rc = OMX_ErrorNoMore;
+    }
   else
     {
       httpr_listener_buffer_t * p_lstnr_buf = &ap_lstnr->buf;
@@ -1323,6 +1994,12 @@ srv_write_omx_buffer (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
             srv_write_to_listener (ap_server, ap_lstnr, p_buffer, len, &bytes));
           assert (bytes >= 0);
 
+          ap_server->bytes_sent += bytes;
+          if (bytes > 0)
+            {
+              ap_lstnr->awaiting_data = false;
+            }
+
           p_lstnr_buf->len
             = bytes > p_lstnr_buf->len ? 0 : (p_lstnr_buf->len - bytes);
 
@@ -1418,10 +2095,9 @@ srv_accept_connection (httpr_server_t * ap_server)
   assert (ap_server);
   p_hdl = handleOf (ap_server->p_parent);
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  if (ap_server->p_ogg && srv_get_listeners_count (ap_server) > 0)
     {
-      /* This is a simple solution to prevent more than one connection at
-       * a time. One day this could be a multi-client renderer */
+      /* An Ogg stream goes to one listener at a time; the newest one wins */
       tiz_map_for_each (ap_server->p_lstnrs, srv_remove_existing_listener,
                         ap_server);
     }
@@ -1449,6 +2125,13 @@ srv_accept_connection (httpr_server_t * ap_server)
       goto_end_on_omx_error (rc, p_hdl,
                              "Unable to add the listener to the map");
 
+      if (ap_server->p_ogg)
+        {
+          /* The new listener needs the Ogg headers before anything else */
+          rc = httpr_ogg_start_listener (ap_server->p_ogg);
+          goto_end_on_omx_error (rc, p_hdl, "Unable to queue the Ogg headers");
+        }
+
       rc = srv_start_listener_io_watcher (p_lstnr);
       goto_end_on_omx_error (rc, p_hdl,
                              "Unable to start the listener's io watcher");
@@ -1508,62 +2191,202 @@ end:
   return rc;
 }
 
+/* Restart the listeners that ran out of data; there is more now */
+static void
+srv_resume_awaiting_listeners (httpr_server_t * ap_server)
+{
+  int i = 0;
+  assert (ap_server);
+  for (i = 0; i < srv_get_listeners_count (ap_server); ++i)
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      if (p_lstnr && p_lstnr->awaiting_data)
+        {
+          (void) srv_start_listener_timer_watcher (p_lstnr,
+                                                   ap_server->wait_time);
+        }
+    }
+}
+
+/* Sends what is left of a playlist or segment, and closes the connection
+ * once it is all out */
 static OMX_ERRORTYPE
-srv_write (httpr_server_t * ap_server)
+srv_write_hls_object (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  httpr_listener_t * p_lstnr = NULL;
-  httpr_connection_t * p_con = NULL;
 
   assert (ap_server);
+  assert (ap_lstnr);
+  assert (ap_lstnr->p_object);
 
-  if (srv_get_listeners_count (ap_server) <= 0)
+  while (OMX_ErrorNone == rc && ap_lstnr->object_sent < ap_lstnr->object_len)
     {
-      return OMX_ErrorNoMore;
+      int bytes = 0;
+      rc = srv_write_to_listener (
+        ap_server, ap_lstnr, ap_lstnr->p_object + ap_lstnr->object_sent,
+        ap_lstnr->object_len - ap_lstnr->object_sent, &bytes);
+      ap_lstnr->object_sent += bytes;
+      ap_server->bytes_sent += bytes;
     }
 
-  /* Until support for multiple listeners gets implemented, there will only be
-     one listener in the map */
-  p_lstnr = srv_get_first_listener (ap_server);
-  assert (p_lstnr);
-  p_con = p_lstnr->p_con;
+  if (OMX_ErrorNotReady != rc)
+    {
+      srv_remove_listener (ap_server, ap_lstnr);
+      rc = OMX_ErrorNoMore;
+    }
+  return rc;
+}
+
+static OMX_U64
+srv_hls_elapsed_ms (const httpr_server_t * ap_server)
+{
+  struct timespec now;
+  assert (ap_server);
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (OMX_U64) ((now.tv_sec - ap_server->hls_epoch.tv_sec) * 1000
+                    + (now.tv_nsec - ap_server->hls_epoch.tv_nsec) / 1000000);
+}
+
+static void
+srv_hls_rebase (httpr_server_t * ap_server)
+{
+  assert (ap_server);
+  assert (ap_server->p_hls);
+  clock_gettime (CLOCK_MONOTONIC, &(ap_server->hls_epoch));
+  ap_server->hls_epoch_ms = tiz_hls_duration_ms (ap_server->p_hls);
+}
+
+/* Moves the stream from the OMX buffers to the backlog and the segmenter, in
+ * real time */
+static OMX_ERRORTYPE
+srv_hls_pump (httpr_server_t * ap_server)
+{
+  OMX_U64 lead_ms = 0;
+  OMX_U64 elapsed_ms = 0;
+  bool pumped = false;
+
+  assert (ap_server);
+  assert (ap_server->p_hls);
+
+  lead_ms = (OMX_U64) ap_server->hls_segment_ms * HLS_PUMP_LEAD_SEGMENTS;
+  elapsed_ms = srv_hls_elapsed_ms (ap_server);
+
+  /* After a stall upstream, carry on in real time instead of catching up */
+  if (tiz_hls_duration_ms (ap_server->p_hls) - ap_server->hls_epoch_ms
+        + ap_server->hls_segment_ms
+      < elapsed_ms)
+    {
+      srv_hls_rebase (ap_server);
+      elapsed_ms = 0;
+    }
+
+  while (tiz_hls_duration_ms (ap_server->p_hls) - ap_server->hls_epoch_ms
+         < elapsed_ms + lead_ms)
+    {
+      OMX_BUFFERHEADERTYPE * p_hdr = ap_server->p_hdr;
+      if (!p_hdr && !(p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
+        {
+          ap_server->need_more_data = true;
+          break;
+        }
+      ap_server->need_more_data = false;
+      ap_server->p_hdr = p_hdr;
+
+      if (p_hdr->pBuffer && p_hdr->nFilledLen > 0)
+        {
+          const OMX_U8 * p_data = p_hdr->pBuffer + p_hdr->nOffset;
+          srv_append_to_backlog (ap_server, p_data, p_hdr->nFilledLen);
+          tiz_check_omx (
+            tiz_hls_write (ap_server->p_hls, p_data, p_hdr->nFilledLen));
+          pumped = true;
+        }
+      if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          /* Publish the last bit of the stream */
+          tiz_check_omx (tiz_hls_flush (ap_server->p_hls));
+        }
+
+      p_hdr->nFilledLen = 0;
+      ap_server->pf_release_buf (p_hdr, ap_server->p_arg);
+      ap_server->p_hdr = NULL;
+    }
+
+  if (pumped)
+    {
+      srv_resume_awaiting_listeners (ap_server);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+srv_write (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  httpr_connection_t * p_con = NULL;
+
+  assert (ap_server);
+  assert (ap_lstnr);
+  p_con = ap_lstnr->p_con;
   assert (p_con);
 
-  srv_stop_listener_io_watcher (p_lstnr);
-  if (!srv_is_listener_ready (ap_server, p_lstnr))
+  srv_stop_listener_io_watcher (ap_lstnr);
+  if (!srv_is_listener_ready (ap_server, ap_lstnr))
     {
       return OMX_ErrorNotReady;
     }
 
-  srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+  if (ap_lstnr->p_object)
+    {
+      return srv_write_hls_object (ap_server, ap_lstnr);
+    }
+
+  srv_start_listener_timer_watcher (ap_lstnr, ap_server->wait_time);
 
   if (p_con->initial_burst_bytes <= 0)
     {
       p_con->burst_bytes = 0;
     }
 
+  p_hdr = ap_server->p_hdr;
   while (1)
     {
       if (NULL == p_hdr)
         {
-          if (NULL == (p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
+          /* In segmenting mode, only the pump takes buffers */
+          if (ap_server->p_hls
+              || NULL
+                   == (p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
             {
               /* no more buffers available at the moment */
-              ap_server->need_more_data = true;
-              srv_stop_listener_timer_watcher (p_lstnr);
-              rc = OMX_ErrorNone;
-              break;
+              ap_server->need_more_data = !ap_server->p_hls;
+              if (!srv_has_queued_data (ap_server, ap_lstnr))
+                {
+                  if (!ap_lstnr->awaiting_data
+                      && p_con->initial_burst_bytes <= 0)
+                    {
+                      /* Ran out of data while streaming in real time */
+                      ap_server->underruns++;
+                    }
+                  ap_lstnr->awaiting_data = true;
+                  srv_stop_listener_timer_watcher (ap_lstnr);
+                  rc = OMX_ErrorNone;
+                  break;
+                }
+            }
+          else
+            {
+              ap_server->need_more_data = false;
+              ap_server->p_hdr = p_hdr;
+              srv_resume_awaiting_listeners (ap_server);
             }
-          ap_server->need_more_data = false;
-          ap_server->p_hdr = p_hdr;
         }
 
-      rc = srv_write_omx_buffer (ap_server, p_lstnr);
+      rc = srv_write_omx_buffer (ap_server, ap_lstnr);
 
       if (OMX_ErrorNoMore == rc)
         {
-          srv_remove_listener (ap_server, p_lstnr);
+          srv_remove_listener (ap_server, ap_lstnr);
           break;
         }
 
@@ -1575,11 +2398,10 @@ srv_write (httpr_server_t * ap_server)
           break;
         }
 
-      /*       if (p_lstnr->pos == ap_server->p_hdr->nFilledLen) */
-      if (0 == ap_server->p_hdr->nFilledLen)
+      if (p_hdr && 0 == ap_server->p_hdr->nFilledLen)
         {
           /* Buffer emptied */
-          (void) srv_release_empty_buffer (ap_server, p_lstnr, &p_hdr);
+          (void) srv_release_empty_buffer (ap_server, ap_lstnr, &p_hdr);
         }
     };
 
@@ -1587,12 +2409,13 @@ srv_write (httpr_server_t * ap_server)
 }
 
 static OMX_ERRORTYPE
-srv_stream_to_client (httpr_server_t * ap_server)
+srv_stream_to_client (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_server);
+  assert (ap_lstnr);
 
-  rc = srv_write (ap_server);
+  rc = srv_write (ap_server, ap_lstnr);
   switch (rc)
     {
       case OMX_ErrorNone:
@@ -1601,7 +2424,6 @@ srv_stream_to_client (httpr_server_t * ap_server)
          reached */
       case OMX_ErrorNotReady:
         {
-          /* No connected clients just yet */
           rc = OMX_ErrorNone;
         }
         break;
@@ -1640,11 +2462,20 @@ httpr_srv_destroy (httpr_server_t * ap_server)
         }
 
       tiz_mem_free (ap_server->p_ip);
+      tiz_mem_free (ap_server->p_backlog);
+      httpr_ogg_destroy (ap_server->p_ogg);
       if (ap_server->p_lstnrs)
         {
           tiz_map_clear (ap_server->p_lstnrs);
           tiz_map_destroy (ap_server->p_lstnrs);
         }
+      /* Segments still attached to a listener were released above */
+      tiz_hls_destroy (ap_server->p_hls);
+      if (ap_server->p_hls_timer)
+        {
+          tiz_srv_timer_watcher_destroy (ap_server->p_parent,
+                                         ap_server->p_hls_timer);
+        }
       tiz_mem_free (ap_server);
     }
 }
@@ -1694,7 +2525,26 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   tiz_mem_set (&(p_server->mountpoint), 0, sizeof (httpr_mount_t));
   p_server->mountpoint.metadata_period = ICE_DEFAULT_METADATA_INTERVAL;
   p_server->mountpoint.initial_burst_size = ICE_INITIAL_BURST_SIZE;
-  p_server->mountpoint.max_clients = 1;
+  p_server->mountpoint.max_clients = ICE_MAX_CLIENTS_PER_MOUNTPOINT;
+  p_server->p_ogg = NULL;
+  p_server->backlog_size = ICE_BACKLOG_SIZE;
+  p_server->backlog_head = 0;
+  p_server->peak_listeners = 0;
+  p_server->rejected = 0;
+  p_server->underruns = 0;
+  p_server->bytes_sent = 0;
+  p_server->p_hls = NULL;
+  p_server->hls_segment_ms = 0;
+  p_server->hls_window = 0;
+  p_server->p_hls_timer = NULL;
+  p_server->hls_timer_started = false;
+  p_server->hls_epoch_ms = 0;
+  p_server->objects = 0;
+
+  p_server->p_backlog = (char *) tiz_mem_alloc (p_server->backlog_size);
+  rc = p_server->p_backlog ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
+  goto_end_on_omx_error (rc, handleOf (ap_parent),
+                         "Unable to alloc the stream backlog");
 
   if (a_address)
     {
@@ -1754,6 +2604,16 @@ httpr_srv_start (httpr_server_t * ap_server)
   rc = srv_start_server_io_watcher (ap_server);
   goto_end_on_omx_error (rc, p_hdl, "Unable to start the server io watcher");
 
+  if (ap_server->p_hls)
+    {
+      srv_hls_rebase (ap_server);
+      rc = tiz_srv_timer_watcher_start (ap_server->p_parent,
+                                        ap_server->p_hls_timer,
+                                        HLS_PUMP_INTERVAL, HLS_PUMP_INTERVAL);
+      goto_end_on_omx_error (rc, p_hdl, "Unable to start the segmenter pump");
+      ap_server->hls_timer_started = true;
+    }
+
   /* so far so good */
   ap_server->running = true;
   all_ok = true;
@@ -1772,17 +2632,24 @@ httpr_srv_stop (httpr_server_t * ap_server)
   httpr_listener_t * p_lstnr = NULL;
   assert (ap_server);
   (void) srv_stop_server_io_watcher (ap_server);
-  if (ap_server->p_lstnrs)
+  if (ap_server->hls_timer_started)
     {
-      /* Until support for multiple listeners gets implemented, there will only
-         be one listener in the map */
-      p_lstnr = srv_get_first_listener (ap_server);
-      if (p_lstnr)
-        {
-          srv_stop_listener_io_watcher (p_lstnr);
-          srv_stop_listener_timer_watcher (p_lstnr);
-          srv_remove_listener (ap_server, p_lstnr);
-        }
+      (void) tiz_srv_timer_watcher_stop (ap_server->p_parent,
+                                         ap_server->p_hls_timer);
+      ap_server->hls_timer_started = false;
+    }
+  while ((p_lstnr = srv_get_first_listener (ap_server)))
+    {
+      srv_stop_listener_io_watcher (p_lstnr);
+      srv_stop_listener_timer_watcher (p_lstnr);
+      srv_remove_listener (ap_server, p_lstnr);
+    }
+  /* The stream will start over; the statistics are kept */
+  ap_server->backlog_head = 0;
+  if (ap_server->p_ogg)
+    {
+      /* The stream will start over, with new headers */
+      httpr_ogg_reset (ap_server->p_ogg);
     }
   ap_server->running = false;
   ap_server->need_more_data = false;
@@ -1821,13 +2688,7 @@ httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_bitrate,
 
   ap_server->wait_time = (1 / ap_server->pkts_per_sec);
 
-  if (srv_get_listeners_count (ap_server) > 0)
-    {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
-    }
+  srv_restart_listener_timers (ap_server);
 
   TIZ_PRINTF_DBG_MAG (
     "burst [%d] sample rate [%u] bitrate [%u] "
@@ -1840,6 +2701,66 @@ httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_bitrate,
     ap_server->pkts_per_sec);
 }
 
+OMX_ERRORTYPE
+httpr_srv_set_hls_settings (httpr_server_t * ap_server,
+                            const OMX_BOOL a_enabled,
+                            const OMX_U32 a_segment_ms,
+                            const OMX_U32 a_window)
+{
+  char base[OMX_MAX_STRINGNAME_SIZE];
+  const char * p_name = NULL;
+
+  assert (ap_server);
+  assert (!ap_server->running);
+
+  /* The segments start over with the stream */
+  tiz_hls_destroy (ap_server->p_hls);
+  ap_server->p_hls = NULL;
+
+  if (OMX_TRUE != a_enabled)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (!ap_server->p_hls_timer)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_init (ap_server->p_parent,
+                                                 &(ap_server->p_hls_timer)));
+    }
+
+  /* Segments are named after the last component of the mount point, so that
+   * the playlist can refer to them relative to its own location */
+  srv_hls_get_base_name (ap_server, base, sizeof (base));
+  p_name = strrchr (base, '/');
+  p_name = p_name ? p_name + 1 : base;
+  tiz_check_omx (
+    tiz_hls_init (&(ap_server->p_hls), p_name, a_segment_ms, a_window));
+  ap_server->hls_segment_ms = a_segment_ms;
+  ap_server->hls_window = a_window;
+
+  TIZ_NOTICE (handleOf (ap_server->p_parent),
+              "Segmenting mode: [%s%s] [%lu] ms x [%lu] segments", base,
+              HLS_PLAYLIST_EXT, a_segment_ms, a_window);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+httpr_srv_set_ogg_settings (httpr_server_t * ap_server)
+{
+  assert (ap_server);
+
+  if (!ap_server->p_ogg)
+    {
+      tiz_check_omx (httpr_ogg_init (&(ap_server->p_ogg)));
+    }
+
+  /* Until the stream headers arrive and the bitrate has been measured */
+  ap_server->num_channels = 2;
+  ap_server->sample_rate = 48000;
+  srv_set_ogg_pacing (ap_server, ICE_DEFAULT_OGG_BITRATE);
+  return OMX_ErrorNone;
+}
+
 void
 httpr_srv_set_mountpoint_settings (
   httpr_server_t * ap_server, OMX_U8 * ap_mount_name, OMX_U8 * ap_station_name,
@@ -1904,26 +2825,94 @@ httpr_srv_set_stream_title (httpr_server_t * ap_server,
            OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
   p_mount->stream_title[OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE - 1] = '\0';
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  if (ap_server->p_ogg)
     {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      assert (p_lstnr->p_con);
-      p_lstnr->p_con->metadata_delivered = false;
-      p_lstnr->p_con->initial_burst_bytes
-        = ap_server->mountpoint.initial_burst_size * 0.1;
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+      /* The title comes formatted as ICY metadata, i.e.
+       * StreamTitle='...'; */
+      char title[OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE];
+      const char * p_title = (const char *) p_mount->stream_title;
+      size_t title_len = strlen (p_title);
+      if (0 == strncmp (p_title, "StreamTitle='", 13) && title_len >= 15
+          && 0 == strcmp (p_title + title_len - 2, "';"))
+        {
+          p_title += 13;
+          title_len -= 15;
+        }
+      memcpy (title, p_title, title_len);
+      title[title_len] = '\0';
+      if (OMX_ErrorNone != httpr_ogg_set_title (ap_server->p_ogg, title))
+        {
+          TIZ_ERROR (handleOf (ap_server->p_parent),
+                     "Unable to update the Ogg stream title");
+        }
     }
+
+  {
+    int i = 0;
+    for (i = 0; i < srv_get_listeners_count (ap_server); ++i)
+      {
+        httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+        assert (p_lstnr);
+        assert (p_lstnr->p_con);
+        p_lstnr->p_con->metadata_delivered = false;
+        p_lstnr->p_con->initial_burst_bytes
+          = ap_server->mountpoint.initial_burst_size * 0.1;
+      }
+  }
+  srv_restart_listener_timers (ap_server);
+}
+
+void
+httpr_srv_get_stats (const httpr_server_t * ap_server,
+                     OMX_TIZONIA_ICECASTMOUNTSTATSTYPE * ap_stats)
+{
+  assert (ap_server);
+  assert (ap_stats);
+  ap_stats->nListeners = srv_get_stream_listeners_count (ap_server);
+  ap_stats->nPeakListeners = ap_server->peak_listeners;
+  ap_stats->nMaxListeners = srv_get_max_listeners (ap_server);
+  ap_stats->nRejected = ap_server->rejected;
+  ap_stats->nBytesSent = ap_server->bytes_sent;
+  ap_stats->nUnderruns = ap_server->underruns;
 }
 
 OMX_ERRORTYPE
 httpr_srv_buffer_event (httpr_server_t * ap_server)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  int i = 0;
   assert (ap_server);
-  return ((ap_server->running && ap_server->need_more_data)
-            ? srv_stream_to_client (ap_server)
-            : OMX_ErrorNone);
+
+  if (!ap_server->running || !ap_server->need_more_data)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (ap_server->p_hls)
+    {
+      /* The pump wakes up the listeners once it has moved the data */
+      return srv_hls_pump (ap_server);
+    }
+
+  srv_remove_slow_listeners (ap_server);
+
+  /* Wake up the listeners that ran out of data. A listener may be removed
+   * while writing to it, in which case the next one takes its place */
+  while (OMX_ErrorNone == rc && i < srv_get_listeners_count (ap_server))
+    {
+      httpr_listener_t * p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, i);
+      const int nlstnrs = srv_get_listeners_count (ap_server);
+      assert (p_lstnr);
+      if (p_lstnr->awaiting_data)
+        {
+          rc = srv_stream_to_client (ap_server, p_lstnr);
+        }
+      if (nlstnrs == srv_get_listeners_count (ap_server))
+        {
+          ++i;
+        }
+    }
+  return rc;
 }
 
 OMX_ERRORTYPE
@@ -1944,16 +2933,40 @@ httpr_srv_io_event (httpr_server_t * ap_server, const int a_fd)
         }
       else
         {
-          /* The client socket is ready */
-          rc = srv_stream_to_client (ap_server);
+          /* A client socket is ready */
+          httpr_listener_t * p_lstnr
+            = srv_find_listener_by_fd (ap_server, a_fd);
+          if (p_lstnr)
+            {
+              rc = srv_stream_to_client (ap_server, p_lstnr);
+            }
         }
     }
   return rc;
 }
 
 OMX_ERRORTYPE
-httpr_srv_timer_event (httpr_server_t * ap_server)
+httpr_srv_timer_event (httpr_server_t * ap_server,
+                       tiz_event_timer_t * ap_ev_timer)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_server);
-  return ap_server->running ? srv_stream_to_client (ap_server) : OMX_ErrorNone;
+  if (ap_server->running)
+    {
+      httpr_listener_t * p_lstnr = NULL;
+      srv_remove_slow_listeners (ap_server);
+      if (ap_ev_timer == ap_server->p_hls_timer)
+        {
+          rc = srv_hls_pump (ap_server);
+        }
+      else
+        {
+          p_lstnr = srv_find_listener_by_timer (ap_server, ap_ev_timer);
+          if (p_lstnr)
+            {
+              rc = srv_stream_to_client (ap_server, p_lstnr);
+            }
+        }
+    }
+  return rc;
 }
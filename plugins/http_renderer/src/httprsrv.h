@@ -35,6 +35,9 @@ extern "C" {
 
 #include <OMX_Core.h>
 #include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizplatform.h>
 
 typedef struct httpr_server httpr_server_t;
 
@@ -65,6 +68,15 @@ httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_bitrate,
                             const OMX_U32 a_num_channels,
                             const OMX_U32 a_sample_rate);
 
+OMX_ERRORTYPE
+httpr_srv_set_ogg_settings (httpr_server_t * ap_server);
+
+OMX_ERRORTYPE
+httpr_srv_set_hls_settings (httpr_server_t * ap_server,
+                            const OMX_BOOL a_enabled,
+                            const OMX_U32 a_segment_ms,
+                            const OMX_U32 a_window);
+
 void
 httpr_srv_set_mountpoint_settings (
   httpr_server_t * ap_server, OMX_U8 * ap_mount_name, OMX_U8 * ap_station_name,
@@ -76,12 +88,17 @@ void
 httpr_srv_set_stream_title (httpr_server_t * ap_server,
                             OMX_U8 * ap_stream_title);
 
+void
+httpr_srv_get_stats (const httpr_server_t * ap_server,
+                     OMX_TIZONIA_ICECASTMOUNTSTATSTYPE * ap_stats);
+
 OMX_ERRORTYPE
 httpr_srv_buffer_event (httpr_server_t * ap_server);
 OMX_ERRORTYPE
 httpr_srv_io_event (httpr_server_t * ap_server, const int a_fd);
 OMX_ERRORTYPE
-httpr_srv_timer_event (httpr_server_t * ap_server);
+httpr_srv_timer_event (httpr_server_t * ap_server,
+                       tiz_event_timer_t * ap_ev_timer);
 
 #ifdef __cplusplus
 }
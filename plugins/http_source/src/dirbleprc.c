@@ -191,6 +191,8 @@ update_cache_size (dirble_prc_t * ap_prc)
     {
       tiz_urltrans_set_internal_buffer_size (ap_prc->p_trans_,
                                              ap_prc->cache_bytes_);
+      tiz_urltrans_set_stream_rate (ap_prc->p_trans_,
+                                    (ap_prc->bitrate_ * 1000) / 8);
     }
 }
 
@@ -765,6 +767,7 @@ dirble_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
   p_prc->eos_ = false;
   tiz_urltrans_cancel (p_prc->p_trans_);
   tiz_urltrans_set_internal_buffer_size (p_prc->p_trans_, p_prc->cache_bytes_);
+  tiz_urltrans_set_stream_rate (p_prc->p_trans_, (p_prc->bitrate_ * 1000) / 8);
   return prepare_for_port_auto_detection (p_prc);
 }
 
@@ -925,6 +928,23 @@ dirble_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
   return rc;
 }
 
+static OMX_ERRORTYPE
+dirble_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                       OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  dirble_prc_t * p_prc = (dirble_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigAudioSourceBufferHealth == a_index)
+    {
+      tiz_urltrans_get_buffer_health_config (
+        p_prc->p_trans_,
+        (OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * dirble_prc_class
  */
@@ -1000,6 +1020,8 @@ dirble_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_enable, dirble_prc_port_enable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_config_change, dirble_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, dirble_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -36,6 +36,8 @@
 
 #include <tizplatform.h>
 
+#include <tizscheduler.h>
+
 #include "httpsrc.h"
 #include "httpsrcport.h"
 #include "httpsrcport_decls.h"
@@ -59,6 +61,8 @@ httpsrc_port_ctor (void * ap_obj, va_list * app)
   tiz_port_register_index (p_obj, OMX_IndexParamAudioMp3);
   tiz_port_register_index (p_obj, OMX_IndexParamAudioAac);
   tiz_port_register_index (p_obj, OMX_TizoniaIndexParamAudioOpus);
+  tiz_port_register_index (p_obj,
+                           OMX_TizoniaIndexConfigAudioSourceBufferHealth);
 
   p_obj->mp3type_.nSize = sizeof (OMX_AUDIO_PARAM_MP3TYPE);
   p_obj->mp3type_.nVersion.nVersion = OMX_VERSION;
@@ -325,6 +329,46 @@ httpsrc_port_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   return rc;
 }
 
+static OMX_ERRORTYPE
+httpsrc_port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                        OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "PORT [%d] GetConfig [%s]...", tiz_port_index (ap_obj),
+             tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigAudioSourceBufferHealth == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE * p_health
+        = (OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE *) ap_struct;
+      void * p_prc = tiz_get_prc (ap_hdl);
+      if (ARATELIA_HTTP_SOURCE_PORT_INDEX != p_health->nPortIndex)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      /* Only the processor knows the state of the transfer. So lets get the
+         processor to fill this info for us. */
+      assert (p_prc);
+      if (OMX_ErrorNone
+          != (rc = tiz_api_GetConfig (p_prc, ap_hdl, a_index, ap_struct)))
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[%s] : Error retrieving [%s] "
+                     "from the processor",
+                     tiz_err_to_str (rc), tiz_idx_to_str (a_index));
+        }
+    }
+  else
+    {
+      /* Try the parent's indexes */
+      rc = super_GetConfig (typeOf (ap_obj, "httpsrcport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
 static bool
 httpsrc_port_check_tunnel_compat (const void * ap_obj,
                                   OMX_PARAM_PORTDEFINITIONTYPE * ap_this_def,
@@ -621,6 +665,8 @@ httpsrc_port_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_api_SetParameter, httpsrc_port_SetParameter,
      /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, httpsrc_port_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
      tiz_port_check_tunnel_compat, httpsrc_port_check_tunnel_compat,
      /* TIZ_CLASS_COMMENT: */
      tiz_port_apply_slaving_behaviour, httpsrc_port_apply_slaving_behaviour,
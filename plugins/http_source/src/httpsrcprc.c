@@ -390,6 +390,8 @@ update_cache_size (httpsrc_prc_t * ap_prc)
     {
       tiz_urltrans_set_internal_buffer_size (ap_prc->p_trans_,
                                              ap_prc->cache_bytes_);
+      tiz_urltrans_set_stream_rate (ap_prc->p_trans_,
+                                    (ap_prc->bitrate_ * 1000) / 8);
     }
 }
 
@@ -821,6 +823,7 @@ httpsrc_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
   p_prc->eos_ = false;
   tiz_urltrans_cancel (p_prc->p_trans_);
   tiz_urltrans_set_internal_buffer_size (p_prc->p_trans_, p_prc->cache_bytes_);
+  tiz_urltrans_set_stream_rate (p_prc->p_trans_, (p_prc->bitrate_ * 1000) / 8);
   return prepare_for_port_auto_detection (p_prc);
 }
 
@@ -936,6 +939,23 @@ httpsrc_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
   return rc;
 }
 
+static OMX_ERRORTYPE
+httpsrc_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                       OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  httpsrc_prc_t * p_prc = (httpsrc_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigAudioSourceBufferHealth == a_index)
+    {
+      tiz_urltrans_get_buffer_health_config (
+        p_prc->p_trans_,
+        (OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * httpsrc_prc_class
  */
@@ -1009,6 +1029,8 @@ httpsrc_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, httpsrc_prc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_port_enable, httpsrc_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, httpsrc_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -974,6 +974,23 @@ plex_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
   return rc;
 }
 
+static OMX_ERRORTYPE
+plex_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                    OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  plex_prc_t * p_prc = (plex_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigAudioSourceBufferHealth == a_index)
+    {
+      tiz_urltrans_get_buffer_health_config (
+        p_prc->p_trans_,
+        (OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * plex_prc_class
  */
@@ -1049,6 +1066,8 @@ plex_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_enable, plex_prc_port_enable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_config_change, plex_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, plex_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
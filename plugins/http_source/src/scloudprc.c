@@ -899,6 +899,23 @@ scloud_prc_config_change (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid),
   return rc;
 }
 
+static OMX_ERRORTYPE
+scloud_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  scloud_prc_t * p_prc = (scloud_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigAudioSourceBufferHealth == a_index)
+    {
+      tiz_urltrans_get_buffer_health_config (
+        p_prc->p_trans_,
+        (OMX_TIZONIA_AUDIO_CONFIG_SOURCEBUFFERHEALTHTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * scloud_prc_class
  */
@@ -974,6 +991,8 @@ scloud_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_enable, scloud_prc_port_enable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_config_change, scloud_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, scloud_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -0,0 +1,346 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   inprocbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Shared-memory ring reader - round-trip benchmark
+ *
+ * Pushes a byte stream from the application through a shared-memory ring
+ * into the inproc reader, which is tunnelled to the file writer, and prints
+ * the end-to-end throughput and the time it takes for the end-of-stream
+ * marker to come out at the other end. 'make bench' runs it with the default
+ * settings.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <OMX_Component.h>
+#include <OMX_Core.h>
+
+#include <tizplatform.h>
+
+#include "inprocsrc.h"
+
+#define BENCH_FILE_WRITER_NAME "OMX.Aratelia.file_writer.binary"
+#define BENCH_CHUNK_SIZE 4096
+#define BENCH_TIMEOUT_MS 30000
+
+typedef struct bench_comp bench_comp_t;
+struct bench_comp
+{
+  OMX_HANDLETYPE p_hdl;
+  OMX_STATETYPE state;
+  bool eos;
+  bool error;
+};
+
+static tiz_mutex_t g_mutex;
+static tiz_cond_t g_cond;
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static OMX_ERRORTYPE
+event_handler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+               OMX_EVENTTYPE a_event, OMX_U32 a_data1, OMX_U32 a_data2,
+               OMX_PTR ap_event_data)
+{
+  bench_comp_t * p_comp = ap_app_data;
+  (void) tiz_mutex_lock (&g_mutex);
+  if (OMX_EventCmdComplete == a_event && OMX_CommandStateSet == a_data1)
+    {
+      p_comp->state = (OMX_STATETYPE) a_data2;
+    }
+  else if (OMX_EventBufferFlag == a_event
+           && (a_data2 & OMX_BUFFERFLAG_EOS) != 0)
+    {
+      p_comp->eos = true;
+    }
+  else if (OMX_EventError == a_event)
+    {
+      fprintf (stderr, "Component error [%s]\n",
+               tiz_err_to_str ((OMX_ERRORTYPE) a_data1));
+      p_comp->error = true;
+    }
+  (void) tiz_cond_broadcast (&g_cond);
+  (void) tiz_mutex_unlock (&g_mutex);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+buffer_done (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+             OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  /* All the buffers are tunnelled */
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE g_callbacks
+  = {event_handler, buffer_done, buffer_done};
+
+static bool
+wait_for (bench_comp_t * ap_comps, const size_t a_ncomps,
+          const OMX_STATETYPE a_state, const bool a_eos)
+{
+  const double deadline = now_secs () + BENCH_TIMEOUT_MS / 1000.0;
+  bool done = false;
+  size_t i = 0;
+
+  (void) tiz_mutex_lock (&g_mutex);
+  while (!done && now_secs () < deadline)
+    {
+      done = true;
+      for (i = 0; i < a_ncomps; ++i)
+        {
+          if (ap_comps[i].error)
+            {
+              (void) tiz_mutex_unlock (&g_mutex);
+              return false;
+            }
+          done = done
+                 && (a_eos ? ap_comps[i].eos : ap_comps[i].state == a_state);
+        }
+      if (!done)
+        {
+          (void) tiz_cond_timedwait (&g_cond, &g_mutex, 100);
+        }
+    }
+  (void) tiz_mutex_unlock (&g_mutex);
+  return done;
+}
+
+static OMX_ERRORTYPE
+set_uri (OMX_HANDLETYPE ap_hdl, const char * ap_uri)
+{
+  const size_t len = strlen (ap_uri);
+  OMX_PARAM_CONTENTURITYPE * p_uri
+    = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + len + 1);
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+
+  if (p_uri)
+    {
+      p_uri->nSize = sizeof (OMX_PARAM_CONTENTURITYPE) + len + 1;
+      p_uri->nVersion.nVersion = OMX_VERSION;
+      memcpy (p_uri->contentURI, ap_uri, len + 1);
+      rc = OMX_SetParameter (ap_hdl, OMX_IndexParamContentURI, p_uri);
+      free (p_uri);
+    }
+  return rc;
+}
+
+static bool
+set_state (bench_comp_t * ap_comps, const size_t a_ncomps,
+           const OMX_STATETYPE a_state)
+{
+  size_t i = 0;
+  /* Sink first on the way up, source first on the way down */
+  const bool sink_first = (a_state == OMX_StateExecuting);
+  for (i = 0; i < a_ncomps; ++i)
+    {
+      bench_comp_t * p_comp = &ap_comps[sink_first ? a_ncomps - 1 - i : i];
+      if (OMX_ErrorNone
+          != OMX_SendCommand (p_comp->p_hdl, OMX_CommandStateSet, a_state,
+                              NULL))
+        {
+          return false;
+        }
+    }
+  return wait_for (ap_comps, a_ncomps, a_state, false);
+}
+
+static int
+run (const char * ap_out, const size_t a_total, const size_t a_ring_size)
+{
+  bench_comp_t comps[2];
+  char name[64];
+  char uri[128];
+  char chunk[BENCH_CHUNK_SIZE];
+  tiz_shmring_t * p_ring = NULL;
+  size_t written = 0;
+  double t_start = 0, t_eos_in = 0, t_eos_out = 0;
+  struct stat st;
+  int rc = EXIT_FAILURE;
+  size_t i = 0;
+
+  memset (comps, 0, sizeof (comps));
+  memset (chunk, 0xA5, sizeof (chunk));
+  snprintf (name, sizeof (name), "bench-%ld", (long) getpid ());
+  snprintf (uri, sizeof (uri), "%s%s", ARATELIA_INPROC_READER_URI_SCHEME,
+            name);
+
+  if (OMX_ErrorNone
+      != OMX_GetHandle (&comps[0].p_hdl,
+                        ARATELIA_INPROC_READER_COMPONENT_NAME, &comps[0],
+                        &g_callbacks)
+      || OMX_ErrorNone
+           != OMX_GetHandle (&comps[1].p_hdl, BENCH_FILE_WRITER_NAME,
+                             &comps[1], &g_callbacks))
+    {
+      fprintf (stderr, "Could not instantiate the components\n");
+      goto end;
+    }
+
+  if (OMX_ErrorNone != set_uri (comps[0].p_hdl, uri)
+      || OMX_ErrorNone != set_uri (comps[1].p_hdl, ap_out)
+      || OMX_ErrorNone
+           != OMX_SetupTunnel (comps[0].p_hdl, 0, comps[1].p_hdl, 0)
+      || OMX_ErrorNone != tiz_shmring_open (&p_ring, name, a_ring_size))
+    {
+      fprintf (stderr, "Could not set up the graph\n");
+      goto end;
+    }
+
+  if (!set_state (comps, 2, OMX_StateIdle)
+      || !set_state (comps, 2, OMX_StateExecuting))
+    {
+      fprintf (stderr, "Could not start the graph\n");
+      goto end;
+    }
+
+  /* A full ring blocks us here until the graph catches up */
+  t_start = now_secs ();
+  while (written < a_total)
+    {
+      const size_t len = MIN (sizeof (chunk), a_total - written);
+      written += tiz_shmring_write (p_ring, chunk, len, BENCH_TIMEOUT_MS);
+    }
+  (void) tiz_shmring_write_eos (p_ring, BENCH_TIMEOUT_MS);
+  t_eos_in = now_secs ();
+
+  if (!wait_for (&comps[1], 1, OMX_StateMax, true))
+    {
+      fprintf (stderr, "Timed out waiting for the end of stream\n");
+      goto end;
+    }
+  t_eos_out = now_secs ();
+
+  if (0 != stat (ap_out, &st) || (size_t) st.st_size != a_total)
+    {
+      fprintf (stderr, "Output size mismatch (expected %lu bytes)\n",
+               (unsigned long) a_total);
+      goto end;
+    }
+
+  printf ("ring %7lu KiB  %8.1f MiB  %8.1f MiB/s  eos latency %7.3f ms\n",
+          (unsigned long) (tiz_shmring_capacity (p_ring) / 1024),
+          a_total / 1048576.0,
+          a_total / 1048576.0 / (t_eos_out - t_start),
+          (t_eos_out - t_eos_in) * 1000.0);
+  rc = EXIT_SUCCESS;
+
+end:
+
+  if (comps[0].p_hdl && comps[1].p_hdl)
+    {
+      if (OMX_StateExecuting == comps[0].state)
+        {
+          (void) set_state (comps, 2, OMX_StateIdle);
+        }
+      if (OMX_StateIdle == comps[0].state)
+        {
+          (void) set_state (comps, 2, OMX_StateLoaded);
+        }
+    }
+  for (i = 0; i < 2; ++i)
+    {
+      if (comps[i].p_hdl)
+        {
+          (void) OMX_FreeHandle (comps[i].p_hdl);
+        }
+    }
+  if (p_ring)
+    {
+      tiz_shmring_close (p_ring);
+    }
+  (void) unlink (ap_out);
+  return rc;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr, "Usage: %s [-m megabytes] [-r ring-kib] [-o output]\n",
+           ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  size_t total = 256 * 1024 * 1024;
+  size_t ring_size = ARATELIA_INPROC_READER_DEFAULT_RING_SIZE;
+  const char * p_out = "/tmp/inprocbench.out";
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "m:r:o:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'm':
+            total = (size_t) strtoul (optarg, NULL, 10) * 1024 * 1024;
+            break;
+          case 'r':
+            ring_size = (size_t) strtoul (optarg, NULL, 10) * 1024;
+            break;
+          case 'o':
+            p_out = optarg;
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (0 == total || 0 == ring_size)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (OMX_ErrorNone != tiz_mutex_init (&g_mutex)
+      || OMX_ErrorNone != tiz_cond_init (&g_cond)
+      || OMX_ErrorNone != OMX_Init ())
+    {
+      return EXIT_FAILURE;
+    }
+
+  rc = run (p_out, total, ring_size);
+
+  (void) OMX_Deinit ();
+  (void) tiz_cond_destroy (&g_cond);
+  (void) tiz_mutex_destroy (&g_mutex);
+  return rc;
+}
@@ -21,7 +21,7 @@
  * @file   inprocsrc.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader constants
+ * @brief  Tizonia - Shared-memory ring reader constants
  *
  *
  */
@@ -47,6 +47,11 @@ extern "C"
 #define ARATELIA_INPROC_READER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_READER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_READER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_READER_URI_SCHEME         "inproc://"
+#define ARATELIA_INPROC_READER_DEFAULT_RING_NAME  "tizonia"
+#define ARATELIA_INPROC_READER_DEFAULT_RING_SIZE  (1024 * 1024)
+#define ARATELIA_INPROC_READER_DEFAULT_POLL_MS    5
+#define ARATELIA_INPROC_READER_MAX_POLL_MS        1000
 
 #ifdef __cplusplus
 }
@@ -21,7 +21,7 @@
  * @file   inprocsrcprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Shared-memory ring reader
  *
  *
  */
@@ -31,6 +31,10 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,62 +50,414 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_reader.prc"
 #endif
 
+/* Forward declarations */
+static OMX_ERRORTYPE
+inprocsrc_prc_deallocate_resources (void *);
+
+static size_t
+config_value (const char * ap_key, const size_t a_default, const size_t a_max)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  const char * p_value = NULL;
+
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_INPROC_READER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  if (p_value)
+    {
+      char * p_end = NULL;
+      const unsigned long value = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value && value > 0 && value <= a_max)
+        {
+          return (size_t) value;
+        }
+    }
+  return a_default;
+}
+
+static OMX_ERRORTYPE
+obtain_uri (inprocsrc_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const long pathname_max = PATH_MAX + NAME_MAX;
+
+  assert (ap_prc);
+  assert (NULL == ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_
+    = tiz_mem_calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + pathname_max + 1);
+
+  if (NULL == ap_prc->p_uri_param_)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "Error allocating memory for the content uri struct");
+      rc = OMX_ErrorInsufficientResources;
+    }
+  else
+    {
+      ap_prc->p_uri_param_->nSize
+        = sizeof (OMX_PARAM_CONTENTURITYPE) + pathname_max + 1;
+      ap_prc->p_uri_param_->nVersion.nVersion = OMX_VERSION;
+
+      if (OMX_ErrorNone
+          != (rc = tiz_api_GetParameter (
+                tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                OMX_IndexParamContentURI, ap_prc->p_uri_param_)))
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[%s] : Error retrieving the URI param from port",
+                     tiz_err_to_str (rc));
+        }
+      else
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "URI [%s]",
+                      ap_prc->p_uri_param_->contentURI);
+        }
+    }
+
+  return rc;
+}
+
+static const char *
+ring_name (const inprocsrc_prc_t * ap_prc)
+{
+  const char * p_name = NULL;
+  const size_t scheme_len = strlen (ARATELIA_INPROC_READER_URI_SCHEME);
+  assert (ap_prc);
+  assert (ap_prc->p_uri_param_);
+
+  /* Both "inproc://name" and a plain "name" are accepted */
+  p_name = (const char *) ap_prc->p_uri_param_->contentURI;
+  if (0 == strncmp (p_name, ARATELIA_INPROC_READER_URI_SCHEME, scheme_len))
+    {
+      p_name += scheme_len;
+    }
+  return strlen (p_name) > 0 ? p_name
+                             : ARATELIA_INPROC_READER_DEFAULT_RING_NAME;
+}
+
+static OMX_ERRORTYPE
+start_timer (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && !ap_prc->timer_on_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_start (
+        ap_prc, ap_prc->p_ev_timer_, ap_prc->poll_interval_,
+        ap_prc->poll_interval_));
+      ap_prc->timer_on_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+stop_timer (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && ap_prc->timer_on_)
+    {
+      (void) tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+      ap_prc->timer_on_ = false;
+    }
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (!ap_prc->port_disabled_ && !ap_prc->p_outhdr_)
+    {
+      (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_INPROC_READER_PORT_INDEX, 0,
+                                   &ap_prc->p_outhdr_);
+      if (ap_prc->p_outhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFilledLen = 0;
+        }
+    }
+  return ap_prc->p_outhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_outhdr_)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] nFilledLen [%d]",
+                 ap_prc->p_outhdr_, ap_prc->p_outhdr_->nFilledLen);
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                             ARATELIA_INPROC_READER_PORT_INDEX,
+                                             ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+set_format_on_port (inprocsrc_prc_t * ap_prc,
+                    const tiz_shmring_format_t * ap_format)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_U32 * p_encoding = NULL;
+  assert (ap_prc);
+  assert (ap_format);
+
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_INPROC_READER_PORT_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                          OMX_IndexParamPortDefinition, &port_def));
+
+  if (ap_format->domain != (uint32_t) port_def.eDomain)
+    {
+      TIZ_WARN (handleOf (ap_prc),
+                "Ignoring format in domain [%u] (port domain is [%d])",
+                ap_format->domain, port_def.eDomain);
+      return OMX_ErrorNone;
+    }
+
+  switch (port_def.eDomain)
+    {
+      case OMX_PortDomainAudio:
+        p_encoding = (OMX_U32 *) &port_def.format.audio.eEncoding;
+        break;
+      case OMX_PortDomainVideo:
+        p_encoding = (OMX_U32 *) &port_def.format.video.eCompressionFormat;
+        break;
+      case OMX_PortDomainImage:
+        p_encoding = (OMX_U32 *) &port_def.format.image.eCompressionFormat;
+        break;
+      default:
+        p_encoding = (OMX_U32 *) &port_def.format.other.eFormat;
+        break;
+    };
+
+  if (*p_encoding != ap_format->encoding)
+    {
+      /* Set the new value */
+      *p_encoding = ap_format->encoding;
+      tiz_check_omx (tiz_krn_SetParameter_internal (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_IndexParamPortDefinition, &port_def));
+
+      TIZ_DEBUG (handleOf (ap_prc), "Issuing OMX_EventPortFormatDetected");
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventPortFormatDetected, 0, 0,
+                           NULL);
+      TIZ_DEBUG (handleOf (ap_prc), "Issuing OMX_EventPortSettingsChanged");
+      tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventPortSettingsChanged,
+                           ARATELIA_INPROC_READER_PORT_INDEX,
+                           OMX_IndexParamPortDefinition, NULL);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+read_from_ring (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  bool ring_empty = false;
+  assert (ap_prc);
+
+  if (!ap_prc->p_ring_ || ap_prc->paused_ || ap_prc->stopped_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  /* Leaving data in the ring when we run out of buffers is what throttles
+     the producer */
+  while (!ring_empty && !ap_prc->eos_ && (p_hdr = get_header (ap_prc)))
+    {
+      switch (tiz_shmring_next (ap_prc->p_ring_, 0))
+        {
+          case ETIZShmRingEventData:
+            {
+              const OMX_U32 used = p_hdr->nOffset + p_hdr->nFilledLen;
+              const size_t nbytes = tiz_shmring_read (
+                ap_prc->p_ring_, p_hdr->pBuffer + used,
+                p_hdr->nAllocLen - used);
+              p_hdr->nFilledLen += nbytes;
+              ap_prc->bytes_read_ += nbytes;
+              if (p_hdr->nOffset + p_hdr->nFilledLen == p_hdr->nAllocLen)
+                {
+                  tiz_check_omx (release_header (ap_prc));
+                }
+            }
+            break;
+
+          case ETIZShmRingEventFormat:
+            {
+              tiz_shmring_format_t format;
+              if (p_hdr->nFilledLen > 0)
+                {
+                  /* Data in the old format goes out first */
+                  tiz_check_omx (release_header (ap_prc));
+                }
+              else
+                {
+                  tiz_check_omx (
+                    tiz_shmring_read_format (ap_prc->p_ring_, &format));
+                  tiz_check_omx (set_format_on_port (ap_prc, &format));
+                }
+            }
+            break;
+
+          case ETIZShmRingEventEos:
+            {
+              tiz_check_omx (tiz_shmring_read_eos (ap_prc->p_ring_));
+              TIZ_NOTICE (handleOf (ap_prc),
+                          "End of stream after [%u] bytes, EOS in HEADER [%p]",
+                          ap_prc->bytes_read_, p_hdr);
+              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+              stop_timer (ap_prc);
+              tiz_check_omx (release_header (ap_prc));
+            }
+            break;
+
+          default:
+            {
+              /* Don't sit on partially filled buffers, as that would only
+                 add latency */
+              ring_empty = true;
+              if (p_hdr->nFilledLen > 0)
+                {
+                  tiz_check_omx (release_header (ap_prc));
+                }
+            }
+            break;
+        };
+    }
+
+  return OMX_ErrorNone;
+}
+
 /*
  * inprocsrcprc
  */
 
 static void *
-inprocsrc_prc_ctor (void *ap_obj, va_list * app)
+inprocsrc_prc_ctor (void * ap_obj, va_list * app)
 {
-  inprocsrc_prc_t *p_obj = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
-  p_obj->eos_ = false;
-  return p_obj;
+  inprocsrc_prc_t * p_prc
+    = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
+  assert (p_prc);
+  p_prc->p_uri_param_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->p_ev_timer_ = NULL;
+  p_prc->p_outhdr_ = NULL;
+  p_prc->ring_size_ = ARATELIA_INPROC_READER_DEFAULT_RING_SIZE;
+  p_prc->poll_interval_
+    = (double) ARATELIA_INPROC_READER_DEFAULT_POLL_MS / 1000.0;
+  p_prc->bytes_read_ = 0;
+  p_prc->eos_ = false;
+  p_prc->port_disabled_ = false;
+  p_prc->paused_ = false;
+  p_prc->stopped_ = true;
+  p_prc->timer_on_ = false;
+  return p_prc;
 }
 
 static void *
-inprocsrc_prc_dtor (void *ap_obj)
+inprocsrc_prc_dtor (void * ap_obj)
 {
+  (void) inprocsrc_prc_deallocate_resources (ap_obj);
   return super_dtor (typeOf (ap_obj, "inprocsrcprc"), ap_obj);
 }
 
-static OMX_ERRORTYPE
-inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
-{
-  return OMX_ErrorNone;
-}
-
 /*
  * from tizsrv class
  */
 
 static OMX_ERRORTYPE
-inprocsrc_prc_allocate_resources (void *ap_obj, OMX_U32 a_pid)
+inprocsrc_prc_allocate_resources (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  inprocsrc_prc_t * p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  assert (NULL == p_prc->p_ring_);
+
+  p_prc->ring_size_
+    = config_value ("ring_size", ARATELIA_INPROC_READER_DEFAULT_RING_SIZE,
+                    SIZE_MAX / 2);
+  p_prc->poll_interval_
+    = (double) config_value ("poll_interval",
+                             ARATELIA_INPROC_READER_DEFAULT_POLL_MS,
+                             ARATELIA_INPROC_READER_MAX_POLL_MS)
+      / 1000.0;
+
+  tiz_check_omx (obtain_uri (p_prc));
+  tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+
+  if (OMX_ErrorNone
+      != (rc = tiz_shmring_open (&(p_prc->p_ring_), ring_name (p_prc),
+                                 p_prc->ring_size_)))
+    {
+      TIZ_ERROR (handleOf (p_prc), "[%s] : Error opening ring [%s]",
+                 tiz_err_to_str (rc), ring_name (p_prc));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  TIZ_NOTICE (handleOf (p_prc), "Ring [%s] capacity [%lu] poll [%.3f s]",
+              ring_name (p_prc),
+              (unsigned long) tiz_shmring_capacity (p_prc->p_ring_),
+              p_prc->poll_interval_);
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-inprocsrc_prc_deallocate_resources (void *ap_obj)
+inprocsrc_prc_deallocate_resources (void * ap_obj)
 {
+  inprocsrc_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_ev_timer_)
+    {
+      stop_timer (p_prc);
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
+    }
+  if (p_prc->p_ring_)
+    {
+      tiz_shmring_close (p_prc->p_ring_);
+      p_prc->p_ring_ = NULL;
+    }
+  tiz_mem_free (p_prc->p_uri_param_);
+  p_prc->p_uri_param_ = NULL;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-inprocsrc_prc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
+inprocsrc_prc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  inprocsrc_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->bytes_read_ = 0;
+  p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-inprocsrc_prc_transfer_and_process (void *ap_obj, OMX_U32 a_pid)
+inprocsrc_prc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  tiz_check_omx (start_timer (p_prc));
+  return read_from_ring (p_prc);
 }
 
 static OMX_ERRORTYPE
-inprocsrc_prc_stop_and_return (void *ap_obj)
+inprocsrc_prc_stop_and_return (void * ap_obj)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  stop_timer (p_prc);
+  return release_header (p_prc);
 }
 
 /*
@@ -109,8 +465,71 @@ inprocsrc_prc_stop_and_return (void *ap_obj)
  */
 
 static OMX_ERRORTYPE
-inprocsrc_prc_buffers_ready (const void *ap_obj)
+inprocsrc_prc_buffers_ready (const void * ap_obj)
+{
+  return read_from_ring ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_timer_ready (void * ap_obj, tiz_event_timer_t * ap_ev_timer,
+                           void * ap_arg, const uint32_t a_id)
+{
+  return read_from_ring (ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_pause (const void * ap_obj)
 {
+  inprocsrc_prc_t * p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_timer (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_resume (const void * ap_obj)
+{
+  inprocsrc_prc_t * p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  if (!p_prc->eos_)
+    {
+      tiz_check_omx (start_timer (p_prc));
+    }
+  return read_from_ring (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  return release_header ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  inprocsrc_prc_t * p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_timer (p_prc);
+  /* Release any buffers held  */
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_enable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
+{
+  inprocsrc_prc_t * p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  if (p_prc->port_disabled_)
+    {
+      p_prc->port_disabled_ = false;
+      if (!p_prc->stopped_ && !p_prc->paused_ && !p_prc->eos_)
+        {
+          tiz_check_omx (start_timer (p_prc));
+        }
+    }
   return OMX_ErrorNone;
 }
 
@@ -119,7 +538,7 @@ inprocsrc_prc_buffers_ready (const void *ap_obj)
  */
 
 static void *
-inprocsrc_prc_class_ctor (void *ap_obj, va_list * app)
+inprocsrc_prc_class_ctor (void * ap_obj, va_list * app)
 {
   /* NOTE: Class methods might be added in the future. None for now. */
   return super_ctor (typeOf (ap_obj, "inprocsrcprc_class"), ap_obj, app);
@@ -135,7 +554,8 @@ inprocsrc_prc_class_init (void * ap_tos, void * ap_hdl)
   void * tizprc = tiz_get_type (ap_hdl, "tizprc");
   void * inprocsrcprc_class = factory_new
     /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
-    (classOf (tizprc), "inprocsrcprc_class", classOf (tizprc), sizeof (inprocsrc_prc_class_t),
+    (classOf (tizprc), "inprocsrcprc_class", classOf (tizprc),
+     sizeof (inprocsrc_prc_class_t),
      /* TIZ_CLASS_COMMENT: */
      ap_tos, ap_hdl,
      /* TIZ_CLASS_COMMENT: class constructor */
@@ -171,7 +591,19 @@ inprocsrc_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, inprocsrc_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_timer_ready, inprocsrc_prc_timer_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, inprocsrc_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, inprocsrc_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, inprocsrc_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, inprocsrc_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, inprocsrc_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, inprocsrc_prc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -20,7 +20,7 @@
  * @file   inprocsrcprc_decls.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader declarations
+ * @brief  Tizonia - Shared-memory ring reader declarations
  *
  *
  */
@@ -35,8 +35,11 @@ extern "C"
 
 #include <stdbool.h>
 
+#include <OMX_Component.h>
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
   typedef struct inprocsrc_prc inprocsrc_prc_t;
@@ -44,7 +47,18 @@ extern "C"
   {
     /* Object */
     const tiz_prc_t _;
+    OMX_PARAM_CONTENTURITYPE * p_uri_param_;
+    tiz_shmring_t * p_ring_;
+    tiz_event_timer_t * p_ev_timer_;
+    OMX_BUFFERHEADERTYPE * p_outhdr_;
+    size_t ring_size_;
+    double poll_interval_;
+    OMX_U32 bytes_read_;
     bool eos_;
+    bool port_disabled_;
+    bool paused_;
+    bool stopped_;
+    bool timer_on_;
   };
 
   typedef struct inprocsrc_prc_class inprocsrc_prc_class_t;
@@ -21,7 +21,7 @@
  * @file   inprocrnd.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer
+ * @brief  Tizonia - Shared-memory ring writer
  *
  *
  */
@@ -136,7 +136,7 @@ instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 static OMX_PTR
 instantiate_processor (OMX_HANDLETYPE ap_hdl)
 {
-  return factory_new (tiz_get_type (ap_hdl, "inprocrnd_prc"));
+  return factory_new (tiz_get_type (ap_hdl, "inprocrndprc"));
 }
 
 OMX_ERRORTYPE
@@ -183,15 +183,15 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   other_role.nports     = 1;
   other_role.pf_proc    = instantiate_processor;
 
-  strcpy ((OMX_STRING) inprocrnd_prc_type.class_name, "inprocrnd_prc_class");
+  strcpy ((OMX_STRING) inprocrnd_prc_type.class_name, "inprocrndprc_class");
   inprocrnd_prc_type.pf_class_init = inprocrnd_prc_class_init;
-  strcpy ((OMX_STRING) inprocrnd_prc_type.object_name, "inprocrnd_prc");
+  strcpy ((OMX_STRING) inprocrnd_prc_type.object_name, "inprocrndprc");
   inprocrnd_prc_type.pf_object_init = inprocrnd_prc_init;
 
   /* Initialize the component infrastructure */
   tiz_check_omx (tiz_comp_init (ap_hdl, ARATELIA_INPROC_WRITER_COMPONENT_NAME));
 
-  /* Register the "inprocrnd_prc" class */
+  /* Register the "inprocrndprc" class */
   tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
 
   /* Register the various roles */
@@ -21,7 +21,7 @@
  * @file   inprocrndprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer processor
+ * @brief  Tizonia - Shared-memory ring writer processor
  *
  *
  */
@@ -31,6 +31,10 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,27 +50,111 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_writer.prc"
 #endif
 
-#define goto_end_on_zmq_null_pointer(expr, prc, msg)  \
-  do                                                  \
-    {                                                 \
-      if (NULL == (expr))                             \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
-
-#define goto_end_on_zmq_error(expr, prc, msg)         \
-  do                                                  \
-    {                                                 \
-      if (0 != (expr))                                \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
+/* Forward declarations */
+static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *);
+
+static size_t config_value (const char *ap_key, const size_t a_default,
+                            const size_t a_max)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  const char *p_value = NULL;
+
+  snprintf (key, sizeof(key), "%s.%s", ARATELIA_INPROC_WRITER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  if (p_value)
+    {
+      char *p_end = NULL;
+      const unsigned long value = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value && value > 0 && value <= a_max)
+        {
+          return (size_t)value;
+        }
+    }
+  return a_default;
+}
+
+static OMX_ERRORTYPE obtain_uri (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const long pathname_max = PATH_MAX + NAME_MAX;
+
+  assert (ap_prc);
+  assert (NULL == ap_prc->p_uri_param_);
+
+  ap_prc->p_uri_param_ = tiz_mem_calloc (
+    1, sizeof (OMX_PARAM_CONTENTURITYPE) + pathname_max + 1);
+
+  if (NULL == ap_prc->p_uri_param_)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "Error allocating memory for the content uri struct");
+      rc = OMX_ErrorInsufficientResources;
+    }
+  else
+    {
+      ap_prc->p_uri_param_->nSize
+          = sizeof(OMX_PARAM_CONTENTURITYPE) + pathname_max + 1;
+      ap_prc->p_uri_param_->nVersion.nVersion = OMX_VERSION;
+
+      if (OMX_ErrorNone
+          != (rc = tiz_api_GetParameter (
+                  tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                  OMX_IndexParamContentURI, ap_prc->p_uri_param_)))
+        {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[%s] : Error retrieving the URI param from port",
+                     tiz_err_to_str (rc));
+        }
+      else
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "URI [%s]",
+                      ap_prc->p_uri_param_->contentURI);
+        }
+    }
+
+  return rc;
+}
+
+static const char *ring_name (const inprocrnd_prc_t *ap_prc)
+{
+  const char *p_name = NULL;
+  const size_t scheme_len = strlen (ARATELIA_INPROC_WRITER_URI_SCHEME);
+  assert (ap_prc);
+  assert (ap_prc->p_uri_param_);
+
+  /* Both "inproc://name" and a plain "name" are accepted */
+  p_name = (const char *)ap_prc->p_uri_param_->contentURI;
+  if (0 == strncmp (p_name, ARATELIA_INPROC_WRITER_URI_SCHEME, scheme_len))
+    {
+      p_name += scheme_len;
+    }
+  return strlen (p_name) > 0 ? p_name
+                             : ARATELIA_INPROC_WRITER_DEFAULT_RING_NAME;
+}
+
+static OMX_ERRORTYPE start_timer (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && !ap_prc->timer_on_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_start (ap_prc, ap_prc->p_ev_timer_,
+                                                  ap_prc->poll_interval_,
+                                                  ap_prc->poll_interval_));
+      ap_prc->timer_on_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+static void stop_timer (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_ev_timer_ && ap_prc->timer_on_)
+    {
+      (void)tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+      ap_prc->timer_on_ = false;
+    }
+}
 
 static OMX_BUFFERHEADERTYPE *get_header (inprocrnd_prc_t *ap_prc)
 {
@@ -100,31 +188,7 @@ static bool ready_to_process (inprocrnd_prc_t *ap_prc)
              ap_prc->port_disabled_ ? "YES" : "NO",
              ap_prc->stopped_ ? "YES" : "NO");
   return (!ap_prc->paused_ && !ap_prc->port_disabled_ && !ap_prc->stopped_
-          && get_header (ap_prc));
-}
-
-static bool ready_to_write_to_zmq_sock (inprocrnd_prc_t *ap_prc)
-{
-  int zmq_rc = 0;
-  int zevents = 0;
-  size_t zevents_len = sizeof(zevents);
-  bool sock_ready = false;
-  assert (ap_prc);
-
-  if (ap_prc->p_zmq_sock_)
-    {
-      zmq_rc = zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_EVENTS, &zevents,
-                               &zevents_len);
-      if (!zmq_rc)
-        {
-          if (zevents & ZMQ_POLLOUT)
-            {
-              // We can write to the ZeroMQ socket
-              sock_ready = true;
-            }
-        }
-    }
-  return sock_ready;
+          && ap_prc->p_ring_ && get_header (ap_prc));
 }
 
 static OMX_ERRORTYPE release_header (inprocrnd_prc_t *ap_prc)
@@ -162,26 +226,84 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
   return release_header (ap_prc);
 }
 
+static OMX_ERRORTYPE send_format (inprocrnd_prc_t *ap_prc)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  tiz_shmring_format_t format;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_INPROC_WRITER_PORT_INDEX);
+  tiz_check_omx (
+      tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                            OMX_IndexParamPortDefinition, &port_def));
+
+  /* Binary ports only know about the domain and the encoding */
+  memset (&format, 0, sizeof(format));
+  format.domain = port_def.eDomain;
+  switch (port_def.eDomain)
+    {
+      case OMX_PortDomainAudio:
+        format.encoding = port_def.format.audio.eEncoding;
+        break;
+      case OMX_PortDomainVideo:
+        format.encoding = port_def.format.video.eCompressionFormat;
+        break;
+      case OMX_PortDomainImage:
+        format.encoding = port_def.format.image.eCompressionFormat;
+        break;
+      default:
+        format.encoding = port_def.format.other.eFormat;
+        break;
+    };
+
+  if (OMX_ErrorNone == tiz_shmring_write_format (ap_prc->p_ring_, &format, 0))
+    {
+      ap_prc->format_sent_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   assert (ap_prc);
 
-  while ((p_hdr = get_header (ap_prc)))
+  if (!ap_prc->format_sent_)
+    {
+      tiz_check_omx (send_format (ap_prc));
+    }
+
+  /* A full ring leaves the header with us; the timer retries later */
+  while (ap_prc->format_sent_ && (p_hdr = get_header (ap_prc)))
     {
       if (p_hdr->nFilledLen > 0)
         {
-          const int bytes_to_write = 0;
-          p_hdr->nFilledLen -= bytes_to_write;
-          p_hdr->nOffset += bytes_to_write;
+          const size_t bytes_written = tiz_shmring_write (
+              ap_prc->p_ring_, p_hdr->pBuffer + p_hdr->nOffset,
+              p_hdr->nFilledLen, 0);
+          p_hdr->nFilledLen -= bytes_written;
+          p_hdr->nOffset += bytes_written;
+          ap_prc->bytes_written_ += bytes_written;
+          if (p_hdr->nFilledLen > 0)
+            {
+              break;
+            }
         }
 
-      if (0 == p_hdr->nFilledLen)
+      if ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0 && !ap_prc->eos_)
         {
-          rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          if (OMX_ErrorNone != tiz_shmring_write_eos (ap_prc->p_ring_, 0))
+            {
+              break;
+            }
+          TIZ_NOTICE (handleOf (ap_prc), "End of stream after [%u] bytes",
+                      ap_prc->bytes_written_);
+          ap_prc->eos_ = true;
         }
+
+      rc = buffer_emptied (ap_prc);
+      p_hdr = NULL;
     }
 
   return rc;
@@ -195,18 +317,26 @@ static void *inprocrnd_prc_ctor (void *ap_prc, va_list *app)
 {
   inprocrnd_prc_t *p_prc
       = super_ctor (typeOf (ap_prc, "inprocrndprc"), ap_prc, app);
+  p_prc->p_inhdr_ = NULL;
+  p_prc->p_uri_param_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->p_ev_timer_ = NULL;
+  p_prc->ring_size_ = ARATELIA_INPROC_WRITER_DEFAULT_RING_SIZE;
+  p_prc->poll_interval_
+      = (double)ARATELIA_INPROC_WRITER_DEFAULT_POLL_MS / 1000.0;
+  p_prc->bytes_written_ = 0;
   p_prc->port_disabled_ = false;
   p_prc->paused_ = false;
   p_prc->stopped_ = true;
-  p_prc->p_zmq_ctx_ = NULL;
-  p_prc->p_zmq_sock_ = NULL;
-  p_prc->zmq_fd_ = -1;
+  p_prc->timer_on_ = false;
+  p_prc->format_sent_ = false;
   p_prc->eos_ = false;
   return p_prc;
 }
 
 static void *inprocrnd_prc_dtor (void *ap_prc)
 {
+  (void)inprocrnd_prc_deallocate_resources (ap_prc);
   return super_dtor (typeOf (ap_prc, "inprocrndprc"), ap_prc);
 }
 
@@ -218,48 +348,54 @@ static OMX_ERRORTYPE inprocrnd_prc_allocate_resources (void *ap_prc,
                                                        OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
+  assert (NULL == p_prc->p_ring_);
+
+  p_prc->ring_size_ = config_value (
+      "ring_size", ARATELIA_INPROC_WRITER_DEFAULT_RING_SIZE, SIZE_MAX / 2);
+  p_prc->poll_interval_
+      = (double)config_value ("poll_interval",
+                              ARATELIA_INPROC_WRITER_DEFAULT_POLL_MS,
+                              ARATELIA_INPROC_WRITER_MAX_POLL_MS)
+        / 1000.0;
+
+  tiz_check_omx (obtain_uri (p_prc));
+  tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+
+  if (OMX_ErrorNone != (rc = tiz_shmring_open (&(p_prc->p_ring_),
+                                               ring_name (p_prc),
+                                               p_prc->ring_size_)))
+    {
+      TIZ_ERROR (handleOf (p_prc), "[%s] : Error opening ring [%s]",
+                 tiz_err_to_str (rc), ring_name (p_prc));
+      return OMX_ErrorInsufficientResources;
+    }
 
-  /* Create the zmq context */
-  p_prc->p_zmq_ctx_ = zmq_ctx_new ();
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_ctx_, p_prc, zmq_strerror (errno));
-
-  /* No need for io threads (since inproc transport) */
-  zmq_ctx_set (p_prc->p_zmq_ctx_, ZMQ_IO_THREADS, 0);
-
-  /* Create the zmq PUB socket */
-  p_prc->p_zmq_sock_ = zmq_socket (p_prc->p_zmq_ctx_, ZMQ_PUB);
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_sock_, p_prc,
-                                zmq_strerror (errno));
-
-  /* Bind the socket to the inproc address */
-  zmq_rc = zmq_bind (p_prc->p_zmq_sock_, "inproc://broadcast");
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All good */
-  rc = OMX_ErrorNone;
-
-end:
-
-  return rc;
+  TIZ_NOTICE (handleOf (p_prc), "Ring [%s] capacity [%lu] poll [%.3f s]",
+              ring_name (p_prc),
+              (unsigned long)tiz_shmring_capacity (p_prc->p_ring_),
+              p_prc->poll_interval_);
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
   assert (p_prc);
-  if (p_prc->p_zmq_sock_)
+  if (p_prc->p_ev_timer_)
     {
-      zmq_close (p_prc->p_zmq_sock_);
-      p_prc->p_zmq_sock_ = NULL;
+      stop_timer (p_prc);
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
     }
-  if (p_prc->p_zmq_ctx_)
+  if (p_prc->p_ring_)
     {
-      zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
-      p_prc->p_zmq_ctx_ = NULL;
+      tiz_shmring_close (p_prc->p_ring_);
+      p_prc->p_ring_ = NULL;
     }
+  tiz_mem_free (p_prc->p_uri_param_);
+  p_prc->p_uri_param_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -267,47 +403,44 @@ static OMX_ERRORTYPE inprocrnd_prc_prepare_to_transfer (void *ap_prc,
                                                         OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
-  size_t fd_len = 0;
   assert (p_prc);
-
-  fd_len = sizeof(p_prc->zmq_fd_);
-  zmq_rc
-      = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_, &fd_len);
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All goood */
-  rc = OMX_ErrorNone;
-
-end:
-
-  return rc;
+  p_prc->bytes_written_ = 0;
+  p_prc->format_sent_ = false;
+  p_prc->eos_ = false;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_transfer_and_process (void *ap_prc,
                                                          OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  return start_timer (p_prc);
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_stop_and_return (void *ap_prc)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  stop_timer (p_prc);
+  return release_header (p_prc);
 }
 
 /*
  * from tizprc class
  */
 
-static OMX_ERRORTYPE inprocrnd_prc_io_ready (void *ap_prc,
-                                             tiz_event_io_t *ap_ev_io, int a_fd,
-                                             int a_events)
+static OMX_ERRORTYPE inprocrnd_prc_timer_ready (void *ap_prc,
+                                                tiz_event_timer_t *ap_ev_timer,
+                                                void *ap_arg,
+                                                const uint32_t a_id)
 {
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
+  if (ready_to_process (p_prc))
     {
       rc = write_buffer (p_prc);
     }
@@ -326,6 +459,59 @@ static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE inprocrnd_prc_pause (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = true;
+  stop_timer (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_resume (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  tiz_check_omx (start_timer (p_prc));
+  return inprocrnd_prc_buffers_ready (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_flush (const void *ap_prc,
+                                               OMX_U32 a_pid)
+{
+  return release_header ((inprocrnd_prc_t *)ap_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_disable (const void *ap_prc,
+                                                 OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_timer (p_prc);
+  /* Release any buffers held  */
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_enable (const void *ap_prc,
+                                                OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  if (p_prc->port_disabled_)
+    {
+      p_prc->port_disabled_ = false;
+      /* The port definition may have changed while the port was disabled */
+      p_prc->format_sent_ = false;
+      if (!p_prc->stopped_ && !p_prc->paused_)
+        {
+          tiz_check_omx (start_timer (p_prc));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * inprocrnd_prc_class
  */
@@ -381,9 +567,19 @@ void *inprocrnd_prc_init (void *ap_tos, void *ap_hdl)
        /* TIZ_CLASS_COMMENT: */
        tiz_srv_stop_and_return, inprocrnd_prc_stop_and_return,
        /* TIZ_CLASS_COMMENT: */
-       tiz_srv_io_ready, inprocrnd_prc_io_ready,
+       tiz_srv_timer_ready, inprocrnd_prc_timer_ready,
        /* TIZ_CLASS_COMMENT: */
        tiz_prc_buffers_ready, inprocrnd_prc_buffers_ready,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_pause, inprocrnd_prc_pause,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_resume, inprocrnd_prc_resume,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_flush, inprocrnd_prc_port_flush,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_disable, inprocrnd_prc_port_disable,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_enable, inprocrnd_prc_port_enable,
        /* TIZ_CLASS_COMMENT: stop value */
        0);
 
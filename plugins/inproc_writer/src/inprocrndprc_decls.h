@@ -20,7 +20,7 @@
  * @file   inprocrndprc_decls.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer class declarations
+ * @brief  Tizonia - Shared-memory ring writer class declarations
  *
  *
  */
@@ -35,11 +35,11 @@ extern "C"
 
 #include <stdbool.h>
 
-#include <zmq.h>
-#include <zmq_utils.h>
-
+#include <OMX_Component.h>
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
   typedef struct inprocrnd_prc inprocrnd_prc_t;
@@ -48,12 +48,17 @@ extern "C"
     /* Object */
     const tiz_prc_t _;
     OMX_BUFFERHEADERTYPE *p_inhdr_;
+    OMX_PARAM_CONTENTURITYPE *p_uri_param_;
+    tiz_shmring_t *p_ring_;
+    tiz_event_timer_t *p_ev_timer_;
+    size_t ring_size_;
+    double poll_interval_;
+    OMX_U32 bytes_written_;
     bool port_disabled_;
     bool paused_;
     bool stopped_;
-    void * p_zmq_ctx_;
-    void * p_zmq_sock_;
-    int zmq_fd_;
+    bool timer_on_;
+    bool format_sent_;
     bool eos_;
   };
 
@@ -45,6 +45,8 @@
 #include <tizscheduler.h>
 
 #include "mp3eprc.h"
+#include "mp3efanprc.h"
+#include "mp3ecfgport.h"
 #include "mp3e.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -57,6 +59,8 @@
  *
  * - Component name : "OMX.Aratelia.audio_encoder.mp3"
  * - Implements role: "audio_encoder.mp3"
+ * - Implements role: "audio_encoder.mp3.fanout" (one PCM input, several MP3
+ *   outputs with their own bit rate and sample rate)
  *
  *@ingroup plugins
  */
@@ -114,7 +118,8 @@ instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
 }
 
 static OMX_PTR
-instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
+instantiate_mp3_output_port (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid,
+                             const OMX_U32 a_bitrate)
 {
   OMX_AUDIO_PARAM_MP3TYPE mp3type;
   OMX_AUDIO_CODINGTYPE encodings[] = {OMX_AUDIO_CodingMP3, OMX_AUDIO_CodingMax};
@@ -126,15 +131,15 @@ instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_MP3_ENCODER_PORT_NONCONTIGUOUS,
     ARATELIA_MP3_ENCODER_PORT_ALIGNMENT,
     ARATELIA_MP3_ENCODER_PORT_SUPPLIERPREF,
-    {ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX, NULL, NULL, NULL},
+    {a_pid, NULL, NULL, NULL},
     0 /* Master port */
   };
 
   mp3type.nSize = sizeof (OMX_AUDIO_PARAM_MP3TYPE);
   mp3type.nVersion.nVersion = OMX_VERSION;
-  mp3type.nPortIndex = ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX;
+  mp3type.nPortIndex = a_pid;
   mp3type.nChannels = 2;
-  mp3type.nBitRate = 0;
+  mp3type.nBitRate = a_bitrate;
   mp3type.nSampleRate = 0;
   mp3type.nAudioBandWidth = 0;
   mp3type.eChannelMode = OMX_AUDIO_ChannelModeStereo;
@@ -144,10 +149,41 @@ instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
                       &encodings, &mp3type);
 }
 
+static OMX_PTR
+instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_mp3_output_port (
+    ap_hdl, ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX, 0);
+}
+
+static OMX_PTR
+instantiate_rendition_port_0 (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_mp3_output_port (
+    ap_hdl, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (0),
+    ARATELIA_MP3_ENCODER_RENDITION_0_BITRATE);
+}
+
+static OMX_PTR
+instantiate_rendition_port_1 (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_mp3_output_port (
+    ap_hdl, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (1),
+    ARATELIA_MP3_ENCODER_RENDITION_1_BITRATE);
+}
+
+static OMX_PTR
+instantiate_rendition_port_2 (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_mp3_output_port (
+    ap_hdl, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (2),
+    ARATELIA_MP3_ENCODER_RENDITION_2_BITRATE);
+}
+
 static OMX_PTR
 instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
-  return factory_new (tiz_get_type (ap_hdl, "tizconfigport"),
+  return factory_new (tiz_get_type (ap_hdl, "mp3ecfgport"),
                       NULL, /* this port does not take options */
                       ARATELIA_MP3_ENCODER_COMPONENT_NAME, mp3_encoder_version);
 }
@@ -158,13 +194,23 @@ instantiate_processor (OMX_HANDLETYPE ap_hdl)
   return factory_new (tiz_get_type (ap_hdl, "mp3eprc"));
 }
 
+static OMX_PTR
+instantiate_fanout_processor (OMX_HANDLETYPE ap_hdl)
+{
+  return factory_new (tiz_get_type (ap_hdl, "mp3efanprc"));
+}
+
 OMX_ERRORTYPE
 OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
 {
   tiz_role_factory_t role_factory;
-  const tiz_role_factory_t * rf_list[] = {&role_factory};
+  tiz_role_factory_t fanout_role_factory;
+  const tiz_role_factory_t * rf_list[] = {&role_factory, &fanout_role_factory};
   tiz_type_factory_t mp3eprc_type;
-  const tiz_type_factory_t * tf_list[] = {&mp3eprc_type};
+  tiz_type_factory_t mp3efanprc_type;
+  tiz_type_factory_t mp3ecfgport_type;
+  const tiz_type_factory_t * tf_list[]
+    = {&mp3eprc_type, &mp3efanprc_type, &mp3ecfgport_type};
 
   TIZ_LOG (TIZ_PRIORITY_TRACE,
            "OMX_ComponentInit: "
@@ -178,19 +224,42 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   role_factory.nports = 2;
   role_factory.pf_proc = instantiate_processor;
 
+  /* One factory per rendition; see ARATELIA_MP3_ENCODER_RENDITION_COUNT */
+  assert (3 == ARATELIA_MP3_ENCODER_RENDITION_COUNT);
+
+  strcpy ((OMX_STRING) fanout_role_factory.role,
+          ARATELIA_MP3_ENCODER_FANOUT_ROLE);
+  fanout_role_factory.pf_cport = instantiate_config_port;
+  fanout_role_factory.pf_port[0] = instantiate_pcm_port;
+  fanout_role_factory.pf_port[1] = instantiate_rendition_port_0;
+  fanout_role_factory.pf_port[2] = instantiate_rendition_port_1;
+  fanout_role_factory.pf_port[3] = instantiate_rendition_port_2;
+  fanout_role_factory.nports = ARATELIA_MP3_ENCODER_RENDITION_COUNT + 1;
+  fanout_role_factory.pf_proc = instantiate_fanout_processor;
+
   strcpy ((OMX_STRING) mp3eprc_type.class_name, "mp3eprc_class");
   mp3eprc_type.pf_class_init = mp3e_prc_class_init;
   strcpy ((OMX_STRING) mp3eprc_type.object_name, "mp3eprc");
   mp3eprc_type.pf_object_init = mp3e_prc_init;
 
+  strcpy ((OMX_STRING) mp3efanprc_type.class_name, "mp3efanprc_class");
+  mp3efanprc_type.pf_class_init = mp3e_fanprc_class_init;
+  strcpy ((OMX_STRING) mp3efanprc_type.object_name, "mp3efanprc");
+  mp3efanprc_type.pf_object_init = mp3e_fanprc_init;
+
+  strcpy ((OMX_STRING) mp3ecfgport_type.class_name, "mp3ecfgport_class");
+  mp3ecfgport_type.pf_class_init = mp3e_cfgport_class_init;
+  strcpy ((OMX_STRING) mp3ecfgport_type.object_name, "mp3ecfgport");
+  mp3ecfgport_type.pf_object_init = mp3e_cfgport_init;
+
   /* Initialize the component infrastructure */
   tiz_check_omx (tiz_comp_init (ap_hdl, ARATELIA_MP3_ENCODER_COMPONENT_NAME));
 
-  /* Register the "mp3eprc" class */
-  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
+  /* Register the "mp3eprc", "mp3efanprc" and "mp3ecfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 3));
 
-  /* Register the component role */
-  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 1));
+  /* Register the component roles */
+  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 2));
 
   return OMX_ErrorNone;
 }
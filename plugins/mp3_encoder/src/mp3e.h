@@ -34,12 +34,17 @@ extern "C" {
 
 #include <OMX_Core.h>
 #include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
 
 #define ARATELIA_MP3_ENCODER_DEFAULT_ROLE "audio_encoder.mp3"
+#define ARATELIA_MP3_ENCODER_FANOUT_ROLE "audio_encoder.mp3.fanout"
 #define ARATELIA_MP3_ENCODER_COMPONENT_NAME "OMX.Aratelia.audio_encoder.mp3"
 /* With libtizonia, port indexes must start at index 0 */
 #define ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX 0
 #define ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX 1
+/* Fan-out role: one MP3 output port per rendition, from index 1 */
+#define ARATELIA_MP3_ENCODER_RENDITION_COUNT 3
+#define ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX(i) (1 + (i))
 #define ARATELIA_MP3_ENCODER_PORT_MIN_BUF_COUNT 2
 /* Assuming worst case of 16 bit per sample per channel adn 48khz, lets try to
    fit 25ms of audio (1200 samples per channel) */
@@ -49,6 +54,16 @@ extern "C" {
 #define ARATELIA_MP3_ENCODER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_MP3_ENCODER_PORT_ALIGNMENT 0
 #define ARATELIA_MP3_ENCODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_MP3_ENCODER_DEFAULT_QUALITY 2 /* 2=high  5 = medium  7=low */
+#define ARATELIA_MP3_ENCODER_DEFAULT_VBR_QUALITY 4
+#define ARATELIA_MP3_ENCODER_DEFAULT_WORKERS 1
+/* Around 10 seconds of audio at 44.1 kHz */
+#define ARATELIA_MP3_ENCODER_DEFAULT_SEGMENT_FRAMES 400
+#define ARATELIA_MP3_ENCODER_MAX_WORKERS 64
+/* Default bit rates of the fan-out renditions, in bits per second */
+#define ARATELIA_MP3_ENCODER_RENDITION_0_BITRATE 320000
+#define ARATELIA_MP3_ENCODER_RENDITION_1_BITRATE 128000
+#define ARATELIA_MP3_ENCODER_RENDITION_2_BITRATE 64000
 
 #ifdef __cplusplus
 }
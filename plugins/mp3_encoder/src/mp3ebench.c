@@ -0,0 +1,402 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3ebench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 encoder - batch mode throughput benchmark
+ *
+ * Encodes a synthetic signal with a single LAME instance and then with the
+ * segment pool, doubling the number of workers up to the number of CPUs, and
+ * prints the throughput and the speed-up of each run.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "mp3e.h"
+#include "mp3epool.h"
+
+/* Roughly what the component gets per buffer */
+#define BENCH_CHUNK_FRAMES 4096
+
+static const char * rate_control_names[] = {"cbr", "abr", "vbr"};
+
+typedef struct bench_output bench_output_t;
+struct bench_output
+{
+  OMX_U8 * p_data;
+  size_t len;
+  size_t cap;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static bool
+reserve (bench_output_t * ap_out, const size_t a_len)
+{
+  if (ap_out->cap - ap_out->len < a_len)
+    {
+      const size_t cap = (ap_out->len + a_len) * 2;
+      OMX_U8 * p_data = realloc (ap_out->p_data, cap);
+      if (!p_data)
+        {
+          return false;
+        }
+      ap_out->p_data = p_data;
+      ap_out->cap = cap;
+    }
+  return true;
+}
+
+/* A few partials with a slow vibrato over some noise, so that the
+   psychoacoustic model has something to do */
+static short *
+make_signal (const OMX_U32 a_frames, const OMX_U32 a_channels,
+             const OMX_U32 a_rate)
+{
+  short * p_pcm = malloc ((size_t) a_frames * a_channels * sizeof (short));
+  uint32_t seed = 1;
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+
+  for (i = 0; p_pcm && i < a_frames; ++i)
+    {
+      const double t = (double) i / a_rate;
+      for (c = 0; c < a_channels; ++c)
+        {
+          const double f0
+            = 220.0 * (c + 1) * (1.0 + 0.01 * sin (2.0 * M_PI * t));
+          double v = 0.0;
+          int h = 0;
+          for (h = 1; h <= 4; ++h)
+            {
+              v += 0.15 / h * sin (2.0 * M_PI * f0 * h * t);
+            }
+          seed = seed * 1664525u + 1013904223u;
+          v += 0.02 * ((double) (seed >> 8) / (1 << 24) - 0.5);
+          p_pcm[(size_t) i * a_channels + c] = (short) lrint (v * 32767.0);
+        }
+    }
+  return p_pcm;
+}
+
+static bool
+encode_single (const mp3e_settings_t * ap_settings, const short * ap_pcm,
+               const OMX_U32 a_frames, bench_output_t * ap_out)
+{
+  lame_t lame = lame_init ();
+  OMX_U32 done = 0;
+  int n = 0;
+
+  if (!lame)
+    {
+      return false;
+    }
+
+  mp3e_lame_configure (lame, ap_settings);
+  (void) lame_set_bWriteVbrTag (lame, 0);
+  if (lame_init_params (lame) < 0)
+    {
+      (void) lame_close (lame);
+      return false;
+    }
+
+  while (n >= 0 && done < a_frames)
+    {
+      const int chunk = (int) MIN (a_frames - done, BENCH_CHUNK_FRAMES);
+      short * p_pcm = (short *) ap_pcm + (size_t) done * ap_settings->channels;
+      if (!reserve (ap_out, chunk * 5 / 4 + 7200))
+        {
+          n = -1;
+          break;
+        }
+      n = (1 == ap_settings->channels)
+            ? lame_encode_buffer (lame, p_pcm, p_pcm, chunk,
+                                  ap_out->p_data + ap_out->len,
+                                  ap_out->cap - ap_out->len)
+            : lame_encode_buffer_interleaved (lame, p_pcm, chunk,
+                                              ap_out->p_data + ap_out->len,
+                                              ap_out->cap - ap_out->len);
+      ap_out->len += n > 0 ? n : 0;
+      done += chunk;
+    }
+
+  if (n >= 0 && reserve (ap_out, 7200))
+    {
+      n = lame_encode_flush (lame, ap_out->p_data + ap_out->len,
+                             ap_out->cap - ap_out->len);
+      ap_out->len += n > 0 ? n : 0;
+    }
+
+  (void) lame_close (lame);
+  return n >= 0;
+}
+
+/* Drives the pool the way the component does: write what it takes, read
+   what is ready, and wait for a worker otherwise */
+static bool
+encode_pool (const mp3e_settings_t * ap_settings, const short * ap_pcm,
+             const OMX_U32 a_frames, bench_output_t * ap_out,
+             OMX_U32 * ap_unsafe_joins)
+{
+  mp3e_pool_t * p_pool = NULL;
+  OMX_U32 written = 0;
+  bool rc = true;
+
+  if (OMX_ErrorNone != mp3e_pool_init (&p_pool, ap_settings))
+    {
+      return false;
+    }
+
+  if (0 == a_frames)
+    {
+      mp3e_pool_finish (p_pool);
+    }
+
+  while (rc && !mp3e_pool_eos (p_pool))
+    {
+      struct pollfd pfd = {mp3e_pool_notify_fd (p_pool), POLLIN, 0};
+      bool progress = false;
+      OMX_U32 nread = 0;
+
+      if (written < a_frames)
+        {
+          const OMX_U32 accepted = mp3e_pool_write (
+            p_pool, ap_pcm + (size_t) written * ap_settings->channels,
+            MIN (a_frames - written, BENCH_CHUNK_FRAMES));
+          written += accepted;
+          progress = (accepted > 0);
+          if (written == a_frames)
+            {
+              mp3e_pool_finish (p_pool);
+            }
+        }
+
+      do
+        {
+          rc = reserve (ap_out, 65536)
+               && OMX_ErrorNone
+                    == mp3e_pool_read (p_pool, ap_out->p_data + ap_out->len,
+                                       ap_out->cap - ap_out->len, &nread);
+          ap_out->len += rc ? nread : 0;
+        }
+      while (rc && nread > 0);
+
+      if (rc && !progress && !mp3e_pool_eos (p_pool))
+        {
+          (void) poll (&pfd, 1, -1);
+          mp3e_pool_clear_notifications (p_pool);
+        }
+    }
+
+  *ap_unsafe_joins = mp3e_pool_unsafe_joins (p_pool);
+  mp3e_pool_destroy (p_pool);
+  return rc;
+}
+
+static int
+run (const mp3e_settings_t * ap_settings, const short * ap_pcm,
+     const OMX_U32 a_frames, const double a_secs, double * ap_single_secs,
+     const char * ap_out_path)
+{
+  bench_output_t out = {NULL, 0, 0};
+  OMX_U32 unsafe_joins = 0;
+  double start = now_secs ();
+  double elapsed = 0.0;
+  bool rc = (0 == ap_settings->workers)
+              ? encode_single (ap_settings, ap_pcm, a_frames, &out)
+              : encode_pool (ap_settings, ap_pcm, a_frames, &out,
+                             &unsafe_joins);
+
+  elapsed = now_secs () - start;
+  if (!rc)
+    {
+      fprintf (stderr, "mp3ebench: encoding failed\n");
+      free (out.p_data);
+      return EXIT_FAILURE;
+    }
+
+  if (0 == ap_settings->workers)
+    {
+      *ap_single_secs = elapsed;
+    }
+
+  printf ("%-7s %2u worker(s)  %7.1fx realtime  speed-up %5.2f  %9zu bytes  "
+          "%u unsafe joins\n",
+          ap_settings->workers ? "pool" : "single",
+          (unsigned) MAX (ap_settings->workers, 1),
+          elapsed > 0.0 ? a_secs / elapsed : 0.0,
+          elapsed > 0.0 ? *ap_single_secs / elapsed : 0.0, out.len,
+          (unsigned) unsafe_joins);
+
+  if (ap_out_path)
+    {
+      FILE * p_file = fopen (ap_out_path, "wb");
+      if (!p_file || out.len != fwrite (out.p_data, 1, out.len, p_file))
+        {
+          fprintf (stderr, "mp3ebench: unable to write %s\n", ap_out_path);
+        }
+      if (p_file)
+        {
+          fclose (p_file);
+        }
+    }
+
+  free (out.p_data);
+  return EXIT_SUCCESS;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr,
+           "Usage: %s [-s seconds] [-r rate] [-c channels] [-m cbr|abr|vbr] "
+           "[-b kbps] [-q quality] [-v vbr-quality] [-w max-workers] "
+           "[-f segment-frames] [-o output.mp3]\n",
+           ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  mp3e_settings_t settings;
+  const long ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+  OMX_U32 max_workers = ncpus > 0 ? (OMX_U32) ncpus : 1;
+  const char * p_out_path = NULL;
+  double secs = 300.0;
+  double single_secs = 0.0;
+  short * p_pcm = NULL;
+  OMX_U32 frames = 0;
+  OMX_U32 workers = 0;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+  int i = 0;
+
+  memset (&settings, 0, sizeof (settings));
+  settings.channels = 2;
+  settings.sample_rate = 44100;
+  settings.mode = JOINT_STEREO;
+  settings.bitrate_kbps = 192;
+  settings.quality = ARATELIA_MP3_ENCODER_DEFAULT_QUALITY;
+  settings.rate_control = OMX_AUDIO_Mp3RateControlCBR;
+  settings.vbr_quality = ARATELIA_MP3_ENCODER_DEFAULT_VBR_QUALITY;
+  settings.segment_frames = ARATELIA_MP3_ENCODER_DEFAULT_SEGMENT_FRAMES;
+
+  while ((opt = getopt (argc, argv, "s:r:c:m:b:q:v:w:f:o:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            secs = strtod (optarg, NULL);
+            break;
+          case 'r':
+            settings.sample_rate = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'c':
+            settings.channels = (OMX_U32) strtoul (optarg, NULL, 10);
+            settings.mode = (1 == settings.channels) ? MONO : JOINT_STEREO;
+            break;
+          case 'm':
+            for (i = 0; i < 3; ++i)
+              {
+                if (0 == strcasecmp (optarg, rate_control_names[i]))
+                  {
+                    settings.rate_control
+                      = (OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE) i;
+                  }
+              }
+            break;
+          case 'b':
+            settings.bitrate_kbps = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'q':
+            settings.quality = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'v':
+            settings.vbr_quality = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'w':
+            max_workers = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'f':
+            settings.segment_frames = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'o':
+            p_out_path = optarg;
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (secs <= 0.0 || settings.channels < 1 || settings.channels > 2
+      || 0 == settings.sample_rate || 0 == max_workers)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  frames = (OMX_U32) (secs * settings.sample_rate);
+  if (!(p_pcm = make_signal (frames, settings.channels, settings.sample_rate)))
+    {
+      return EXIT_FAILURE;
+    }
+
+  printf ("%.0f s, %u Hz, %u ch, %s, %u kbps, quality %u, %u frames per "
+          "segment\n",
+          secs, (unsigned) settings.sample_rate, (unsigned) settings.channels,
+          rate_control_names[settings.rate_control],
+          (unsigned) settings.bitrate_kbps, (unsigned) settings.quality,
+          (unsigned) settings.segment_frames);
+
+  /* 0 workers: a single LAME instance, the reference for the speed-ups */
+  for (workers = 0; EXIT_SUCCESS == rc && workers <= max_workers;
+       workers = workers ? workers * 2 : 1)
+    {
+      settings.workers = workers;
+      rc = run (&settings, p_pcm, frames, secs, &single_secs,
+                workers * 2 > max_workers ? p_out_path : NULL);
+    }
+
+  free (p_pcm);
+  return rc;
+}
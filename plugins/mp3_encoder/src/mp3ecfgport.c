@@ -0,0 +1,252 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3ecfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 encoder config port
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <tizplatform.h>
+
+#include "mp3e.h"
+#include "mp3epool.h"
+#include "mp3ecfgport.h"
+#include "mp3ecfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.mp3_encoder.cfgport"
+#endif
+
+static OMX_U32
+default_value (const char * ap_key, const OMX_U32 a_default,
+               const OMX_U32 a_max)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  const char * p_value = NULL;
+
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_MP3_ENCODER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  if (p_value)
+    {
+      char * p_end = NULL;
+      const unsigned long value = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value && value <= a_max)
+        {
+          return (OMX_U32) value;
+        }
+    }
+  return a_default;
+}
+
+static OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE
+default_rate_control (void)
+{
+  static const char * rate_control_names[] = {"cbr", "abr", "vbr"};
+  const char * p_rate_control = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_MP3_ENCODER_COMPONENT_NAME ".rate_control");
+  OMX_U32 i = 0;
+
+  if (p_rate_control)
+    {
+      for (i = 0;
+           i < sizeof (rate_control_names) / sizeof (rate_control_names[0]);
+           ++i)
+        {
+          if (0 == strcasecmp (p_rate_control, rate_control_names[i]))
+            {
+              return (OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE) i;
+            }
+        }
+    }
+  return OMX_AUDIO_Mp3RateControlCBR;
+}
+
+/*
+ * mp3ecfgport class
+ */
+
+static void *
+mp3e_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  mp3e_cfgport_t * p_obj
+    = super_ctor (typeOf (ap_obj, "mp3ecfgport"), ap_obj, app);
+
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexParamAudioMp3Encoder);
+  p_obj->encoder_.nSize = sizeof (OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE);
+  p_obj->encoder_.nVersion.nVersion = OMX_VERSION;
+  p_obj->encoder_.nQuality
+    = default_value ("quality", ARATELIA_MP3_ENCODER_DEFAULT_QUALITY, 9);
+  p_obj->encoder_.eRateControl = default_rate_control ();
+  p_obj->encoder_.nVbrQuality = default_value (
+    "vbr_quality", ARATELIA_MP3_ENCODER_DEFAULT_VBR_QUALITY, 9);
+  p_obj->encoder_.nWorkers
+    = default_value ("workers", ARATELIA_MP3_ENCODER_DEFAULT_WORKERS,
+                     ARATELIA_MP3_ENCODER_MAX_WORKERS);
+  p_obj->encoder_.nSegmentFrames
+    = MAX (default_value ("segment_frames",
+                          ARATELIA_MP3_ENCODER_DEFAULT_SEGMENT_FRAMES,
+                          UINT32_MAX),
+           MP3E_POOL_MIN_SEGMENT_FRAMES);
+
+  return p_obj;
+}
+
+static void *
+mp3e_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "mp3ecfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+mp3e_cfgport_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const mp3e_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexParamAudioMp3Encoder == a_index)
+    {
+      OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE * p_encoder
+        = (OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE *) ap_struct;
+
+      *p_encoder = p_obj->encoder_;
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetParameter (typeOf (ap_obj, "mp3ecfgport"), ap_obj, ap_hdl,
+                               a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+mp3e_cfgport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  mp3e_cfgport_t * p_obj = (mp3e_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexParamAudioMp3Encoder == a_index)
+    {
+      OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE * p_encoder
+        = (OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE *) ap_struct;
+
+      if (p_encoder->nQuality > 9
+          || p_encoder->eRateControl > OMX_AUDIO_Mp3RateControlVBR
+          || p_encoder->nVbrQuality > 9
+          || p_encoder->nWorkers > ARATELIA_MP3_ENCODER_MAX_WORKERS
+          || p_encoder->nSegmentFrames < MP3E_POOL_MIN_SEGMENT_FRAMES)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          p_obj->encoder_ = *p_encoder;
+          TIZ_TRACE (ap_hdl,
+                     "nQuality [%d] eRateControl [%d] nVbrQuality [%d] "
+                     "nWorkers [%d] nSegmentFrames [%d]",
+                     p_obj->encoder_.nQuality, p_obj->encoder_.eRateControl,
+                     p_obj->encoder_.nVbrQuality, p_obj->encoder_.nWorkers,
+                     p_obj->encoder_.nSegmentFrames);
+        }
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetParameter (typeOf (ap_obj, "mp3ecfgport"), ap_obj, ap_hdl,
+                               a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * mp3e_cfgport_class
+ */
+
+static void *
+mp3e_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "mp3ecfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+mp3e_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * mp3ecfgport_class
+    = factory_new (classOf (tizconfigport), "mp3ecfgport_class",
+                   classOf (tizconfigport), sizeof (mp3e_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, mp3e_cfgport_class_ctor, 0);
+  return mp3ecfgport_class;
+}
+
+void *
+mp3e_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * mp3ecfgport_class = tiz_get_type (ap_hdl, "mp3ecfgport_class");
+  TIZ_LOG_CLASS (mp3ecfgport_class);
+  void * mp3ecfgport = factory_new (
+    mp3ecfgport_class, "mp3ecfgport", tizconfigport, sizeof (mp3e_cfgport_t),
+    ap_tos, ap_hdl, ctor, mp3e_cfgport_ctor, dtor, mp3e_cfgport_dtor,
+    tiz_api_GetParameter, mp3e_cfgport_GetParameter, tiz_api_SetParameter,
+    mp3e_cfgport_SetParameter, 0);
+
+  return mp3ecfgport;
+}
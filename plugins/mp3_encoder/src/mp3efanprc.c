@@ -0,0 +1,652 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3efanprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 Encoder fan-out processor class
+ *
+ * One PCM input, several MP3 outputs (renditions), each with its own bit rate,
+ * sample rate and channel mode. The input is read once, in chunks that are
+ * split into channel planes once and then handed to one LAME instance per
+ * rendition; a chunk is done when every enabled rendition has encoded it. The
+ * slowest output therefore paces the others. Disabled output ports are simply
+ * not encoded.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "mp3e.h"
+#include "mp3efanprc.h"
+#include "mp3efanprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.mp3_encoder.fanprc"
+#endif
+
+/* One MPEG-1 frame's worth of input per chunk */
+#define MP3EFAN_CHUNK_FRAMES 1152
+/* LAME's worst case output size for n input frames */
+#define MP3EFAN_MP3_BUF_SIZE(n) ((n) * 5 / 4 + 7200)
+
+/* Forward declarations */
+static OMX_ERRORTYPE
+mp3e_fanprc_deallocate_resources (void *);
+
+static inline bool
+is_rendition_enabled (mp3e_fanprc_t * ap_prc, const OMX_U32 a_idx)
+{
+  return tiz_filter_prc_is_port_enabled (
+    ap_prc, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (a_idx));
+}
+
+static inline OMX_U32
+output_room (const OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  return ap_hdr->nAllocLen - ap_hdr->nOffset - ap_hdr->nFilledLen;
+}
+
+static void
+close_renditions (mp3e_fanprc_t * ap_prc)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+    {
+      if (ap_prc->renditions_[i].lame_)
+        {
+          (void) lame_close (ap_prc->renditions_[i].lame_);
+          ap_prc->renditions_[i].lame_ = NULL;
+        }
+    }
+}
+
+static void
+reset_stream_parameters (mp3e_fanprc_t * ap_prc)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+    {
+      ap_prc->renditions_[i].pending_ = false;
+      ap_prc->renditions_[i].flushed_ = false;
+    }
+  ap_prc->chunk_frames_ = 0;
+  ap_prc->chunk_ready_ = false;
+  ap_prc->in_frames_ = 0;
+  ap_prc->eos_ = false;
+}
+
+static OMX_ERRORTYPE
+prepare_rendition (mp3e_fanprc_t * ap_prc, const OMX_U32 a_idx)
+{
+  mp3e_rendition_t * p_rend = NULL;
+  mp3e_settings_t settings;
+
+  assert (ap_prc);
+  assert (a_idx < ARATELIA_MP3_ENCODER_RENDITION_COUNT);
+
+  p_rend = &(ap_prc->renditions_[a_idx]);
+  if (p_rend->lame_)
+    {
+      (void) lame_close (p_rend->lame_);
+      p_rend->lame_ = NULL;
+    }
+
+  p_rend->mp3type_.nSize = sizeof (OMX_AUDIO_PARAM_MP3TYPE);
+  p_rend->mp3type_.nVersion.nVersion = OMX_VERSION;
+  p_rend->mp3type_.nPortIndex
+    = ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (a_idx);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc), OMX_IndexParamAudioMp3,
+    &p_rend->mp3type_));
+
+  settings = ap_prc->settings_;
+  settings.out_sample_rate = p_rend->mp3type_.nSampleRate;
+  /* nBitRate is in bits per second; small values are taken to be kbps */
+  settings.bitrate_kbps = p_rend->mp3type_.nBitRate >= 1000
+                            ? p_rend->mp3type_.nBitRate / 1000
+                            : p_rend->mp3type_.nBitRate;
+  settings.mode = (1 == settings.channels)
+                    ? MONO
+                    : mp3e_lame_mode (p_rend->mp3type_.eChannelMode);
+
+  p_rend->lame_ = lame_init ();
+  tiz_check_null_ret_oom (p_rend->lame_);
+  mp3e_lame_configure (p_rend->lame_, &settings);
+  if (OMX_AUDIO_Mp3RateControlVBR == settings.rate_control
+      && settings.bitrate_kbps)
+    {
+      /* Otherwise, all the VBR renditions would be the same */
+      (void) lame_set_VBR_max_bitrate_kbps (p_rend->lame_,
+                                            settings.bitrate_kbps);
+    }
+
+  if (lame_init_params (p_rend->lame_) < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : "
+                 "Error returned by lame during initialization "
+                 "(rendition [%d])",
+                 a_idx);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_rend->pending_ = false;
+  p_rend->flushed_ = false;
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "rendition [%d] : [%d] kbps - [%d] -> [%d] Hz - mode [%d]", a_idx,
+             settings.bitrate_kbps, settings.sample_rate,
+             lame_get_out_samplerate (p_rend->lame_), settings.mode);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+prepare_encoder (mp3e_fanprc_t * ap_prc)
+{
+  OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE encoder;
+  OMX_U32 i = 0;
+
+  assert (ap_prc);
+
+  /* Retrieve the pcm params from the input port */
+  ap_prc->pcmmode_.nSize = sizeof (OMX_AUDIO_PARAM_PCMMODETYPE);
+  ap_prc->pcmmode_.nVersion.nVersion = OMX_VERSION;
+  ap_prc->pcmmode_.nPortIndex = ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX;
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                       handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm,
+                                       &ap_prc->pcmmode_));
+
+  if (16 != ap_prc->pcmmode_.nBitPerSample || ap_prc->pcmmode_.nChannels < 1
+      || ap_prc->pcmmode_.nChannels > 2)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorBadParameter] : unsupported pcm format "
+                 "(nChannels [%d] nBitPerSample [%d])",
+                 ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample);
+      return OMX_ErrorBadParameter;
+    }
+
+  /* The encoder params from the config port apply to all the renditions */
+  encoder.nSize = sizeof (OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE);
+  encoder.nVersion.nVersion = OMX_VERSION;
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                       handleOf (ap_prc),
+                                       OMX_TizoniaIndexParamAudioMp3Encoder,
+                                       &encoder));
+
+  memset (&ap_prc->settings_, 0, sizeof (ap_prc->settings_));
+  ap_prc->settings_.channels = ap_prc->pcmmode_.nChannels;
+  ap_prc->settings_.sample_rate = ap_prc->pcmmode_.nSamplingRate;
+  ap_prc->settings_.quality = encoder.nQuality;
+  ap_prc->settings_.rate_control = encoder.eRateControl;
+  ap_prc->settings_.vbr_quality = encoder.nVbrQuality;
+  ap_prc->settings_.workers = 1;
+
+  for (i = 0; i < 2; ++i)
+    {
+      if (!ap_prc->p_planes_[i])
+        {
+          ap_prc->p_planes_[i]
+            = tiz_mem_alloc (MP3EFAN_CHUNK_FRAMES * sizeof (short));
+          tiz_check_null_ret_oom (ap_prc->p_planes_[i]);
+        }
+    }
+
+  /* Disabled renditions are set up too, so that they can be enabled while
+     the others are running */
+  for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+    {
+      tiz_check_omx (prepare_rendition (ap_prc, i));
+    }
+
+  reset_stream_parameters (ap_prc);
+  return OMX_ErrorNone;
+}
+
+/* The shared stage: split the next chunk of the input buffer into channel
+   planes and mark it pending on every enabled rendition */
+static void
+split_chunk (mp3e_fanprc_t * ap_prc, const OMX_BUFFERHEADERTYPE * ap_in,
+             const OMX_U32 a_frames)
+{
+  const OMX_U32 channels = ap_prc->settings_.channels;
+  const short * p_pcm = (const short *) (ap_in->pBuffer + ap_in->nOffset)
+                        + (size_t) ap_prc->in_frames_ * channels;
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+
+  for (i = 0; i < a_frames; ++i)
+    {
+      for (c = 0; c < channels; ++c)
+        {
+          ap_prc->p_planes_[c][i] = p_pcm[(size_t) i * channels + c];
+        }
+    }
+
+  for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+    {
+      ap_prc->renditions_[i].pending_ = is_rendition_enabled (ap_prc, i);
+    }
+
+  ap_prc->chunk_frames_ = a_frames;
+  ap_prc->chunk_ready_ = true;
+}
+
+/* An output header with at least a_len bytes of room; a header that is too
+   full is returned first */
+static OMX_BUFFERHEADERTYPE *
+get_output (mp3e_fanprc_t * ap_prc, const OMX_U32 a_idx, const OMX_U32 a_len,
+            OMX_ERRORTYPE * ap_rc)
+{
+  const OMX_U32 pid = ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (a_idx);
+  OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (ap_prc, pid);
+
+  if (p_out && output_room (p_out) < a_len && p_out->nFilledLen > 0)
+    {
+      *ap_rc = tiz_filter_prc_release_header (ap_prc, pid);
+      p_out = tiz_filter_prc_get_header (ap_prc, pid);
+    }
+
+  return (p_out && output_room (p_out) >= a_len) ? p_out : NULL;
+}
+
+static bool
+encode_chunk (mp3e_fanprc_t * ap_prc, const OMX_U32 a_idx,
+              OMX_ERRORTYPE * ap_rc)
+{
+  mp3e_rendition_t * p_rend = &(ap_prc->renditions_[a_idx]);
+  short * p_right = ap_prc->p_planes_[ap_prc->settings_.channels - 1];
+  OMX_BUFFERHEADERTYPE * p_out = get_output (
+    ap_prc, a_idx, MP3EFAN_MP3_BUF_SIZE (ap_prc->chunk_frames_), ap_rc);
+  int n = 0;
+
+  if (!p_out)
+    {
+      return false;
+    }
+
+  n = lame_encode_buffer (p_rend->lame_, ap_prc->p_planes_[0], p_right,
+                          ap_prc->chunk_frames_,
+                          p_out->pBuffer + p_out->nOffset + p_out->nFilledLen,
+                          output_room (p_out));
+  if (n < 0)
+    {
+      /* The chunk is lost for this rendition only */
+      TIZ_ERROR (handleOf (ap_prc), "rendition [%d] : lame error [%d]", a_idx,
+                 n);
+      n = 0;
+    }
+
+  p_out->nFilledLen += n;
+  p_rend->pending_ = false;
+
+  if (output_room (p_out) < MP3EFAN_MP3_BUF_SIZE (MP3EFAN_CHUNK_FRAMES))
+    {
+      *ap_rc = tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (a_idx));
+    }
+  return true;
+}
+
+/* Drain every enabled rendition and propagate EOS. Once all of them are done,
+   fresh encoders are set up for the next stream. */
+static bool
+flush_renditions (mp3e_fanprc_t * ap_prc, OMX_ERRORTYPE * ap_rc)
+{
+  bool progress = false;
+  bool done = true;
+  OMX_U32 i = 0;
+
+  for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+    {
+      mp3e_rendition_t * p_rend = &(ap_prc->renditions_[i]);
+      OMX_BUFFERHEADERTYPE * p_out = NULL;
+      int n = 0;
+
+      if (p_rend->flushed_ || !is_rendition_enabled (ap_prc, i))
+        {
+          continue;
+        }
+
+      if (!(p_out = get_output (ap_prc, i, MP3EFAN_MP3_BUF_SIZE (0), ap_rc)))
+        {
+          done = false;
+          continue;
+        }
+
+      n = lame_encode_flush (p_rend->lame_, p_out->pBuffer + p_out->nOffset
+                                              + p_out->nFilledLen,
+                             output_room (p_out));
+      p_out->nFilledLen += n > 0 ? n : 0;
+      p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+      TIZ_TRACE (handleOf (ap_prc), "rendition [%d] : EOS HEADER [%p]", i,
+                 p_out);
+      *ap_rc = tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_MP3_ENCODER_RENDITION_PORT_INDEX (i));
+      p_rend->flushed_ = true;
+      progress = true;
+    }
+
+  if (done && OMX_ErrorNone == *ap_rc)
+    {
+      for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT
+                  && OMX_ErrorNone == *ap_rc;
+           ++i)
+        {
+          *ap_rc = prepare_rendition (ap_prc, i);
+        }
+      reset_stream_parameters (ap_prc);
+      progress = true;
+    }
+
+  return progress;
+}
+
+/*
+ * mp3efanprc
+ */
+
+static void *
+mp3e_fanprc_ctor (void * ap_obj, va_list * app)
+{
+  mp3e_fanprc_t * p_prc
+    = super_ctor (typeOf (ap_obj, "mp3efanprc"), ap_obj, app);
+  assert (p_prc);
+  memset (p_prc->renditions_, 0, sizeof (p_prc->renditions_));
+  memset (&p_prc->settings_, 0, sizeof (p_prc->settings_));
+  p_prc->p_planes_[0] = NULL;
+  p_prc->p_planes_[1] = NULL;
+  reset_stream_parameters (p_prc);
+  return p_prc;
+}
+
+static void *
+mp3e_fanprc_dtor (void * ap_obj)
+{
+  (void) mp3e_fanprc_deallocate_resources (ap_obj);
+  return super_dtor (typeOf (ap_obj, "mp3efanprc"), ap_obj);
+}
+
+/*
+ * from tizsrv class
+ */
+
+static OMX_ERRORTYPE
+mp3e_fanprc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  /* The encoders depend on the port settings; they are created in
+     prepare_to_transfer */
+  TIZ_TRACE (handleOf (ap_obj), "lame encoder version [%s]",
+             get_lame_version ());
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_deallocate_resources (void * ap_obj)
+{
+  mp3e_fanprc_t * p_prc = ap_obj;
+  assert (p_prc);
+  close_renditions (p_prc);
+  tiz_mem_free (p_prc->p_planes_[0]);
+  tiz_mem_free (p_prc->p_planes_[1]);
+  p_prc->p_planes_[0] = NULL;
+  p_prc->p_planes_[1] = NULL;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
+{
+  return prepare_encoder (ap_obj);
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_stop_and_return (void * ap_obj)
+{
+  reset_stream_parameters (ap_obj);
+  return tiz_filter_prc_release_all_headers (ap_obj);
+}
+
+/*
+ * from tizprc class
+ */
+
+static OMX_ERRORTYPE
+mp3e_fanprc_buffers_ready (const void * ap_obj)
+{
+  mp3e_fanprc_t * p_prc = (mp3e_fanprc_t *) ap_obj;
+  const OMX_U32 frame_len = p_prc->settings_.channels * sizeof (short);
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  bool progress = true;
+  OMX_U32 i = 0;
+
+  assert (p_prc);
+
+  if (!p_prc->p_planes_[0])
+    {
+      return OMX_ErrorNone;
+    }
+
+  while (progress && OMX_ErrorNone == rc)
+    {
+      bool pending = false;
+
+      progress = false;
+
+      if (p_prc->eos_)
+        {
+          progress = flush_renditions (p_prc, &rc);
+          continue;
+        }
+
+      if (!p_prc->chunk_ready_)
+        {
+          OMX_BUFFERHEADERTYPE * p_in = tiz_filter_prc_get_header (
+            p_prc, ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX);
+          OMX_U32 left = 0;
+
+          if (!p_in)
+            {
+              break;
+            }
+
+          left = p_in->nFilledLen / frame_len - p_prc->in_frames_;
+          if (0 == left)
+            {
+              /* Every rendition has encoded the whole buffer */
+              p_prc->eos_ = ((p_in->nFlags & OMX_BUFFERFLAG_EOS) != 0);
+              p_prc->in_frames_ = 0;
+              p_in->nFilledLen = 0;
+              rc = tiz_filter_prc_release_header (
+                p_prc, ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX);
+              progress = true;
+              continue;
+            }
+
+          split_chunk (p_prc, p_in, MIN (left, MP3EFAN_CHUNK_FRAMES));
+        }
+
+      for (i = 0; i < ARATELIA_MP3_ENCODER_RENDITION_COUNT; ++i)
+        {
+          mp3e_rendition_t * p_rend = &(p_prc->renditions_[i]);
+          if (p_rend->pending_ && !is_rendition_enabled (p_prc, i))
+            {
+              p_rend->pending_ = false;
+            }
+          if (p_rend->pending_ && encode_chunk (p_prc, i, &rc))
+            {
+              progress = true;
+            }
+          pending = pending || p_rend->pending_;
+        }
+
+      if (!pending)
+        {
+          p_prc->in_frames_ += p_prc->chunk_frames_;
+          p_prc->chunk_ready_ = false;
+          progress = true;
+        }
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_port_flush (const void * ap_obj, OMX_U32 a_pid)
+{
+  mp3e_fanprc_t * p_prc = (mp3e_fanprc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid || ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX == a_pid)
+    {
+      reset_stream_parameters (p_prc);
+    }
+  /* Release any buffers held  */
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_port_disable (const void * ap_obj, OMX_U32 a_pid)
+{
+  mp3e_fanprc_t * p_prc = (mp3e_fanprc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid || ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX == a_pid)
+    {
+      reset_stream_parameters (p_prc);
+    }
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, true);
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+mp3e_fanprc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  mp3e_fanprc_t * p_prc = (mp3e_fanprc_t *) ap_obj;
+  assert (p_prc);
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, false);
+  if (!p_prc->p_planes_[0])
+    {
+      /* Not transferring yet; prepare_to_transfer will set things up */
+      return OMX_ErrorNone;
+    }
+  if (OMX_ALL == a_pid || ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX == a_pid)
+    {
+      /* The input settings may have changed; start over */
+      return prepare_encoder (p_prc);
+    }
+  if (a_pid > ARATELIA_MP3_ENCODER_RENDITION_COUNT)
+    {
+      return OMX_ErrorNone;
+    }
+  /* A rendition joining the others, possibly with new settings; it starts
+     with the next chunk */
+  return prepare_rendition (p_prc, a_pid - 1);
+}
+
+/*
+ * mp3e_fanprc_class
+ */
+
+static void *
+mp3e_fanprc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "mp3efanprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+mp3e_fanprc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * mp3efanprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizfilterprc), "mp3efanprc_class", classOf (tizfilterprc),
+     sizeof (mp3e_fanprc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, mp3e_fanprc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return mp3efanprc_class;
+}
+
+void *
+mp3e_fanprc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * mp3efanprc_class = tiz_get_type (ap_hdl, "mp3efanprc_class");
+  TIZ_LOG_CLASS (mp3efanprc_class);
+  void * mp3efanprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (mp3efanprc_class, "mp3efanprc", tizfilterprc, sizeof (mp3e_fanprc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, mp3e_fanprc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, mp3e_fanprc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, mp3e_fanprc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, mp3e_fanprc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, mp3e_fanprc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, mp3e_fanprc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, mp3e_fanprc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, mp3e_fanprc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, mp3e_fanprc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, mp3e_fanprc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, mp3e_fanprc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return mp3efanprc;
+}
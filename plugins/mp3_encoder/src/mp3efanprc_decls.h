@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3efanprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 Encoder fan-out processor class decls
+ *
+ *
+ */
+
+#ifndef MP3EFANPRC_DECLS_H
+#define MP3EFANPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <lame/lame.h>
+
+#include <OMX_Audio.h>
+
+#include <tizfilterprc.h>
+#include <tizfilterprc_decls.h>
+
+#include "mp3e.h"
+#include "mp3epool.h"
+
+typedef struct mp3e_rendition mp3e_rendition_t;
+struct mp3e_rendition
+{
+  lame_t lame_;
+  OMX_AUDIO_PARAM_MP3TYPE mp3type_;
+  /* The rendition still has to encode the current chunk */
+  bool pending_;
+  bool flushed_;
+};
+
+typedef struct mp3e_fanprc mp3e_fanprc_t;
+struct mp3e_fanprc
+{
+  /* Object */
+  const tiz_filter_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  /* Input and encoder settings, common to all the renditions */
+  mp3e_settings_t settings_;
+  mp3e_rendition_t renditions_[ARATELIA_MP3_ENCODER_RENDITION_COUNT];
+  /* The chunk of input being encoded, split into channel planes once and
+     handed to every rendition */
+  short * p_planes_[2];
+  OMX_U32 chunk_frames_;
+  bool chunk_ready_;
+  /* Frames of the current input buffer already encoded by all renditions */
+  OMX_U32 in_frames_;
+  bool eos_;
+};
+
+typedef struct mp3e_fanprc_class mp3e_fanprc_class_t;
+struct mp3e_fanprc_class
+{
+  /* Class */
+  const tiz_filter_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3EFANPRC_DECLS_H */
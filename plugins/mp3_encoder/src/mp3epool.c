@@ -0,0 +1,933 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3epool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 encoder - parallel segment encoder
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "mp3epool.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.mp3_encoder.pool"
+#endif
+
+/* PCM frames handed to LAME per call */
+#define MP3E_POOL_CHUNK 8192
+/* LAME's worst case output size for a_samples, see lame.h */
+#define MP3E_POOL_MP3_BUF_SIZE(a_samples) ((a_samples) * 5 / 4 + 7200)
+
+typedef enum mp3e_seg_state mp3e_seg_state_t;
+enum mp3e_seg_state
+{
+  EMp3eSegFree,
+  EMp3eSegFilling,
+  EMp3eSegQueued,
+  EMp3eSegEncoding,
+  EMp3eSegDone,
+  EMp3eSegFailed
+};
+
+typedef struct mp3e_frame mp3e_frame_t;
+struct mp3e_frame
+{
+  size_t off;    /* Offset of the frame header */
+  size_t len;    /* Length of the whole frame */
+  size_t md_off; /* Offset of the main data, after the side info */
+  OMX_U32 mdb;   /* main_data_begin: reservoir bytes from earlier frames */
+};
+
+typedef struct mp3e_seg mp3e_seg_t;
+struct mp3e_seg
+{
+  mp3e_seg_state_t state;
+  OMX_U64 index;
+  /* PCM frame range fed to the encoder, and the first PCM frame owned */
+  OMX_U64 in_start;
+  OMX_U64 in_end;
+  OMX_U64 owned_start;
+  short * p_pcm;
+  OMX_U8 * p_mp3;
+  size_t mp3_len;
+  size_t mp3_cap;
+  mp3e_frame_t * p_frames;
+  OMX_U32 nframes;
+  OMX_U32 frames_cap;
+  /* Stream-wide number of the encoder's first MP3 frame */
+  OMX_U64 base;
+  /* Frames [first, end) of this segment make it to the output */
+  OMX_U32 first;
+  OMX_U32 end;
+  bool end_known;
+  size_t out_pos;
+};
+
+struct mp3e_pool
+{
+  mp3e_settings_t settings;
+  OMX_U32 frame_size; /* PCM frames per MP3 frame */
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  bool sync_init;
+  tiz_thread_t * p_threads;
+  OMX_U32 nthreads;
+  mp3e_seg_t * p_segs;
+  OMX_U32 nsegs;
+  int fds[2];
+  bool quit;
+  bool finished;
+  OMX_U64 pos;        /* PCM frames written */
+  OMX_U64 next_index; /* Segments [out_index, next_index) are in use */
+  OMX_U64 next_start; /* in_start of segment next_index */
+  OMX_U64 fill_index; /* Segments [fill_index, next_index) are filling */
+  OMX_U64 out_index;
+  OMX_U32 unsafe_joins;
+};
+
+static inline mp3e_seg_t *
+seg_at (const mp3e_pool_t * ap_pool, const OMX_U64 a_index)
+{
+  return &ap_pool->p_segs[a_index % ap_pool->nsegs];
+}
+
+static mp3e_seg_state_t
+seg_state (mp3e_pool_t * ap_pool, const mp3e_seg_t * ap_seg)
+{
+  mp3e_seg_state_t state = EMp3eSegFree;
+  (void) tiz_mutex_lock (&ap_pool->mutex);
+  state = ap_seg->state;
+  (void) tiz_mutex_unlock (&ap_pool->mutex);
+  return state;
+}
+
+static void
+set_seg_state (mp3e_pool_t * ap_pool, mp3e_seg_t * ap_seg,
+               const mp3e_seg_state_t a_state)
+{
+  (void) tiz_mutex_lock (&ap_pool->mutex);
+  ap_seg->state = a_state;
+  if (EMp3eSegQueued == a_state)
+    {
+      (void) tiz_cond_signal (&ap_pool->cond);
+    }
+  (void) tiz_mutex_unlock (&ap_pool->mutex);
+}
+
+static bool
+parse_frame (const OMX_U8 * ap_data, const size_t a_avail,
+             mp3e_frame_t * ap_frame)
+{
+  static const OMX_U32 bitrates[2][16]
+    = {{0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+       {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0}};
+  static const OMX_U32 rates[3][3]
+    = {{11025, 12000, 8000}, {22050, 24000, 16000}, {44100, 48000, 32000}};
+  OMX_U32 version = 0; /* 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5 */
+  OMX_U32 br_idx = 0;
+  OMX_U32 sr_idx = 0;
+  bool mpeg1 = false;
+  bool mono = false;
+  size_t hdr_len = 4;
+  size_t side_len = 0;
+  size_t len = 0;
+
+  if (a_avail < 4 || 0xFF != ap_data[0] || 0xE0 != (ap_data[1] & 0xE0))
+    {
+      return false;
+    }
+
+  version = (ap_data[1] >> 3) & 0x03;
+  br_idx = ap_data[2] >> 4;
+  sr_idx = (ap_data[2] >> 2) & 0x03;
+  if (1 == version || 1 != ((ap_data[1] >> 1) & 0x03) || 0 == br_idx
+      || 15 == br_idx || 3 == sr_idx)
+    {
+      /* Not layer III, or free format */
+      return false;
+    }
+
+  mpeg1 = (3 == version);
+  mono = (3 == (ap_data[3] >> 6));
+  hdr_len += (ap_data[1] & 0x01) ? 0 : 2; /* CRC */
+  side_len = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+  len = (mpeg1 ? 144000 : 72000) * bitrates[mpeg1][br_idx]
+          / rates[mpeg1 ? 2 : (2 == version ? 1 : 0)][sr_idx]
+        + ((ap_data[2] >> 1) & 0x01);
+
+  if (len < hdr_len + side_len || len > a_avail)
+    {
+      return false;
+    }
+
+  ap_frame->len = len;
+  ap_frame->md_off = ap_frame->off + hdr_len + side_len;
+  ap_frame->mdb
+    = mpeg1 ? ((ap_data[hdr_len] << 1) | (ap_data[hdr_len + 1] >> 7))
+            : ap_data[hdr_len];
+  return true;
+}
+
+static bool
+index_frames (mp3e_seg_t * ap_seg)
+{
+  size_t off = 0;
+
+  ap_seg->nframes = 0;
+  while (off < ap_seg->mp3_len)
+    {
+      mp3e_frame_t frame;
+      if (ap_seg->nframes == ap_seg->frames_cap)
+        {
+          const OMX_U32 cap
+            = ap_seg->frames_cap ? ap_seg->frames_cap * 2 : 512;
+          mp3e_frame_t * p_frames
+            = tiz_mem_realloc (ap_seg->p_frames, cap * sizeof (mp3e_frame_t));
+          if (!p_frames)
+            {
+              return false;
+            }
+          ap_seg->p_frames = p_frames;
+          ap_seg->frames_cap = cap;
+        }
+      frame.off = off;
+      if (!parse_frame (ap_seg->p_mp3 + off, ap_seg->mp3_len - off, &frame))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "segment [%llu] : invalid MP3 frame at offset [%zu]",
+                   (unsigned long long) ap_seg->index, off);
+          return false;
+        }
+      ap_seg->p_frames[ap_seg->nframes++] = frame;
+      off += frame.len;
+    }
+  return true;
+}
+
+static bool
+reserve_mp3 (mp3e_seg_t * ap_seg, const size_t a_len)
+{
+  if (ap_seg->mp3_cap - ap_seg->mp3_len < a_len)
+    {
+      const size_t cap = MAX (ap_seg->mp3_cap * 2, ap_seg->mp3_len + a_len);
+      OMX_U8 * p_mp3 = tiz_mem_realloc (ap_seg->p_mp3, cap);
+      if (!p_mp3)
+        {
+          return false;
+        }
+      ap_seg->p_mp3 = p_mp3;
+      ap_seg->mp3_cap = cap;
+    }
+  return true;
+}
+
+static bool
+encode_segment (const mp3e_pool_t * ap_pool, mp3e_seg_t * ap_seg)
+{
+  const OMX_U32 channels = ap_pool->settings.channels;
+  const OMX_U64 nsamples = ap_seg->in_end - ap_seg->in_start;
+  OMX_U64 done = 0;
+  lame_t lame = NULL;
+  bool rc = false;
+  int n = 0;
+
+  ap_seg->mp3_len = 0;
+  if (!(lame = lame_init ()))
+    {
+      return false;
+    }
+
+  mp3e_lame_configure (lame, &ap_pool->settings);
+  /* The join logic relies on every encoder producing the same frames */
+  (void) lame_set_bWriteVbrTag (lame, 0);
+
+  if (lame_init_params (lame) >= 0)
+    {
+      rc = true;
+      while (rc && done < nsamples)
+        {
+          const int chunk = (int) MIN (nsamples - done, MP3E_POOL_CHUNK);
+          short * p_pcm = ap_seg->p_pcm + done * channels;
+          rc = reserve_mp3 (ap_seg, MP3E_POOL_MP3_BUF_SIZE (chunk));
+          if (rc)
+            {
+              /* lame_encode_buffer_interleaved always expects two channels */
+              n = (1 == channels)
+                    ? lame_encode_buffer (lame, p_pcm, p_pcm, chunk,
+                                          ap_seg->p_mp3 + ap_seg->mp3_len,
+                                          ap_seg->mp3_cap - ap_seg->mp3_len)
+                    : lame_encode_buffer_interleaved (
+                        lame, p_pcm, chunk, ap_seg->p_mp3 + ap_seg->mp3_len,
+                        ap_seg->mp3_cap - ap_seg->mp3_len);
+              rc = (n >= 0);
+              ap_seg->mp3_len += rc ? n : 0;
+              done += chunk;
+            }
+        }
+
+      if (rc && (rc = reserve_mp3 (ap_seg, MP3E_POOL_MP3_BUF_SIZE (0))))
+        {
+          n = lame_encode_flush (lame, ap_seg->p_mp3 + ap_seg->mp3_len,
+                                 ap_seg->mp3_cap - ap_seg->mp3_len);
+          rc = (n >= 0);
+          ap_seg->mp3_len += rc ? n : 0;
+        }
+    }
+
+  (void) lame_close (lame);
+  return rc && index_frames (ap_seg);
+}
+
+static void *
+worker_thread (void * ap_arg)
+{
+  mp3e_pool_t * p_pool = ap_arg;
+
+  assert (p_pool);
+
+  (void) tiz_mutex_lock (&p_pool->mutex);
+  while (!p_pool->quit)
+    {
+      mp3e_seg_t * p_seg = NULL;
+      OMX_U32 i = 0;
+
+      /* Lowest numbered segment first: that is the one the output waits on */
+      for (i = 0; i < p_pool->nsegs; ++i)
+        {
+          mp3e_seg_t * p_cand = &p_pool->p_segs[i];
+          if (EMp3eSegQueued == p_cand->state
+              && (!p_seg || p_cand->index < p_seg->index))
+            {
+              p_seg = p_cand;
+            }
+        }
+
+      if (!p_seg)
+        {
+          (void) tiz_cond_wait (&p_pool->cond, &p_pool->mutex);
+          continue;
+        }
+
+      p_seg->state = EMp3eSegEncoding;
+      (void) tiz_mutex_unlock (&p_pool->mutex);
+      {
+        const bool ok = encode_segment (p_pool, p_seg);
+        (void) tiz_mutex_lock (&p_pool->mutex);
+        p_seg->state = ok ? EMp3eSegDone : EMp3eSegFailed;
+      }
+      /* Wake up the component; a full pipe already does the job */
+      if (write (p_pool->fds[1], "", 1) < 0 && EAGAIN != errno)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "notification : %s", strerror (errno));
+        }
+    }
+  (void) tiz_mutex_unlock (&p_pool->mutex);
+
+  return NULL;
+}
+
+/* Offset of the main data byte that sits a_back bytes before the main data
+   of frame a_frame, or -1 if the segment does not go back that far */
+static long
+reservoir_byte (const mp3e_seg_t * ap_seg, OMX_U32 a_frame, size_t a_back)
+{
+  while (a_frame-- > 0)
+    {
+      const mp3e_frame_t * p_frame = &ap_seg->p_frames[a_frame];
+      const size_t md_len = p_frame->off + p_frame->len - p_frame->md_off;
+      if (a_back <= md_len)
+        {
+          return (long) (p_frame->md_off + md_len - a_back);
+        }
+      a_back -= md_len;
+    }
+  return -1;
+}
+
+/* Joins two consecutive segments at MP3 frame a_join (stream-wide number).
+   The first frame taken from ap_next may start its main data up to 511
+   bytes back, in the reservoir of ap_next's previous frames. Those bytes are
+   copied to the same place in ap_prev's stream, where they are unused as
+   long as ap_prev's own reservoir at a_join is at least as large. */
+static void
+join_at (mp3e_seg_t * ap_prev, mp3e_seg_t * ap_next, const OMX_U64 a_join)
+{
+  const OMX_U32 prev_idx = (OMX_U32) (a_join - ap_prev->base);
+  const OMX_U32 next_idx = (OMX_U32) (a_join - ap_next->base);
+  const size_t nbytes = MIN (ap_next->p_frames[next_idx].mdb,
+                             prev_idx < ap_prev->nframes
+                               ? ap_prev->p_frames[prev_idx].mdb
+                               : 0);
+  size_t i = 0;
+
+  for (i = 1; i <= nbytes; ++i)
+    {
+      const long dst = reservoir_byte (ap_prev, prev_idx, i);
+      const long src = reservoir_byte (ap_next, next_idx, i);
+      if (dst < 0 || src < 0)
+        {
+          break;
+        }
+      ap_prev->p_mp3[dst] = ap_next->p_mp3[src];
+    }
+
+  ap_prev->end = MIN (prev_idx, ap_prev->nframes);
+  ap_prev->end_known = true;
+  ap_next->first = next_idx;
+}
+
+static void
+join_segments (mp3e_pool_t * ap_pool, mp3e_seg_t * ap_prev,
+               mp3e_seg_t * ap_next)
+{
+  const OMX_U64 boundary = ap_next->index * ap_pool->settings.segment_frames;
+  const OMX_U64 half = MP3E_POOL_OVERLAP_FRAMES / 2;
+  OMX_U64 best = 0;
+  long best_deficit = LONG_MAX;
+  OMX_U64 i = 0;
+
+  /* Look for a frame, as close to the boundary as possible, that is past the
+     next segment's warm-up and whose reservoir fits in the previous
+     segment's */
+  for (i = 0; i < 2 * half; ++i)
+    {
+      const OMX_U64 n = (i % 2) ? boundary - (i + 1) / 2 : boundary + i / 2;
+      long deficit = 0;
+
+      if (n < ap_next->base + half || n >= ap_next->base + ap_next->nframes
+          || n <= ap_prev->base + ap_prev->first
+          || n >= ap_prev->base + ap_prev->nframes)
+        {
+          continue;
+        }
+
+      deficit = (long) ap_next->p_frames[n - ap_next->base].mdb
+                - (long) ap_prev->p_frames[n - ap_prev->base].mdb;
+      if (deficit < best_deficit)
+        {
+          best = n;
+          best_deficit = deficit;
+        }
+      if (deficit <= 0)
+        {
+          break;
+        }
+    }
+
+  if (LONG_MAX == best_deficit)
+    {
+      /* A very short tail segment; join where the previous segment ends */
+      best = MAX (ap_prev->base + ap_prev->nframes, ap_next->base);
+      best = MIN (best, ap_next->base + ap_next->nframes);
+    }
+
+  if (best_deficit > 0)
+    {
+      ap_pool->unsafe_joins++;
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "segments [%llu] and [%llu] : no reservoir-safe join",
+               (unsigned long long) ap_prev->index,
+               (unsigned long long) ap_next->index);
+    }
+
+  if (best < ap_next->base + ap_next->nframes)
+    {
+      join_at (ap_prev, ap_next, best);
+    }
+  else
+    {
+      ap_prev->end = (OMX_U32) MIN (best - ap_prev->base, ap_prev->nframes);
+      ap_prev->end_known = true;
+      ap_next->first = ap_next->nframes;
+    }
+}
+
+static bool
+start_segment (mp3e_pool_t * ap_pool)
+{
+  const OMX_U64 seg_frames = ap_pool->settings.segment_frames;
+  const OMX_U64 overlap = MP3E_POOL_OVERLAP_FRAMES * ap_pool->frame_size;
+  mp3e_seg_t * p_seg = NULL;
+
+  if (ap_pool->next_index - ap_pool->out_index >= ap_pool->nsegs)
+    {
+      /* All the segments are in use */
+      return false;
+    }
+
+  p_seg = seg_at (ap_pool, ap_pool->next_index);
+  if (!p_seg->p_pcm
+      && !(p_seg->p_pcm = tiz_mem_alloc (
+             (size_t) (seg_frames * ap_pool->frame_size + 2 * overlap)
+             * ap_pool->settings.channels * sizeof (short))))
+    {
+      return false;
+    }
+
+  p_seg->index = ap_pool->next_index;
+  p_seg->owned_start = p_seg->index * seg_frames * ap_pool->frame_size;
+  p_seg->in_start = p_seg->index ? p_seg->owned_start - overlap : 0;
+  p_seg->in_end
+    = p_seg->owned_start + seg_frames * ap_pool->frame_size + overlap;
+  p_seg->base = p_seg->index ? p_seg->index * seg_frames
+                                 - MP3E_POOL_OVERLAP_FRAMES
+                             : 0;
+  p_seg->mp3_len = 0;
+  p_seg->nframes = 0;
+  p_seg->first = 0;
+  p_seg->end = 0;
+  p_seg->end_known = false;
+  p_seg->out_pos = 0;
+  set_seg_state (ap_pool, p_seg, EMp3eSegFilling);
+
+  ap_pool->next_index++;
+  ap_pool->next_start
+    = ap_pool->next_index * seg_frames * ap_pool->frame_size - overlap;
+  return true;
+}
+
+static void
+fill_segment (mp3e_pool_t * ap_pool, mp3e_seg_t * ap_seg, const short * ap_pcm,
+              const OMX_U64 a_start, const OMX_U64 a_end)
+{
+  const OMX_U32 channels = ap_pool->settings.channels;
+  const OMX_U64 from = MAX (a_start, ap_seg->in_start);
+  const OMX_U64 to = MIN (a_end, ap_seg->in_end);
+
+  if (from < to)
+    {
+      memcpy (ap_seg->p_pcm + (from - ap_seg->in_start) * channels,
+              ap_pcm + (from - a_start) * channels,
+              (size_t) (to - from) * channels * sizeof (short));
+    }
+
+  if (a_end >= ap_seg->in_end)
+    {
+      assert (ap_seg->index == ap_pool->fill_index);
+      ap_pool->fill_index++;
+      set_seg_state (ap_pool, ap_seg, EMp3eSegQueued);
+    }
+}
+
+static void
+release_pool (mp3e_pool_t * ap_pool)
+{
+  OMX_U32 i = 0;
+
+  if (ap_pool->sync_init)
+    {
+      (void) tiz_mutex_lock (&ap_pool->mutex);
+      ap_pool->quit = true;
+      (void) tiz_cond_broadcast (&ap_pool->cond);
+      (void) tiz_mutex_unlock (&ap_pool->mutex);
+    }
+
+  for (i = 0; i < ap_pool->nthreads; ++i)
+    {
+      void * p_result = NULL;
+      (void) tiz_thread_join (&ap_pool->p_threads[i], &p_result);
+    }
+
+  if (ap_pool->sync_init)
+    {
+      (void) tiz_cond_destroy (&ap_pool->cond);
+      (void) tiz_mutex_destroy (&ap_pool->mutex);
+    }
+
+  for (i = 0; ap_pool->p_segs && i < ap_pool->nsegs; ++i)
+    {
+      tiz_mem_free (ap_pool->p_segs[i].p_pcm);
+      tiz_mem_free (ap_pool->p_segs[i].p_mp3);
+      tiz_mem_free (ap_pool->p_segs[i].p_frames);
+    }
+
+  for (i = 0; i < 2; ++i)
+    {
+      if (ap_pool->fds[i] >= 0)
+        {
+          (void) close (ap_pool->fds[i]);
+        }
+    }
+
+  tiz_mem_free (ap_pool->p_segs);
+  tiz_mem_free (ap_pool->p_threads);
+  tiz_mem_free (ap_pool);
+}
+
+void
+mp3e_lame_configure (lame_t ap_lame, const mp3e_settings_t * ap_settings)
+{
+  assert (ap_lame);
+  assert (ap_settings);
+
+  (void) lame_set_num_channels (ap_lame, ap_settings->channels);
+  (void) lame_set_in_samplerate (ap_lame, ap_settings->sample_rate);
+  if (ap_settings->out_sample_rate)
+    {
+      (void) lame_set_out_samplerate (ap_lame, ap_settings->out_sample_rate);
+    }
+  (void) lame_set_mode (ap_lame, ap_settings->mode);
+  (void) lame_set_quality (ap_lame, ap_settings->quality);
+
+  switch (ap_settings->rate_control)
+    {
+      case OMX_AUDIO_Mp3RateControlABR:
+        {
+          (void) lame_set_VBR (ap_lame, vbr_abr);
+          (void) lame_set_VBR_mean_bitrate_kbps (ap_lame,
+                                                 ap_settings->bitrate_kbps);
+        }
+        break;
+      case OMX_AUDIO_Mp3RateControlVBR:
+        {
+          (void) lame_set_VBR (ap_lame, vbr_default);
+          (void) lame_set_VBR_quality (ap_lame,
+                                       (float) ap_settings->vbr_quality);
+        }
+        break;
+      default:
+        {
+          (void) lame_set_VBR (ap_lame, vbr_off);
+          if (ap_settings->bitrate_kbps)
+            {
+              (void) lame_set_brate (ap_lame, ap_settings->bitrate_kbps);
+            }
+        }
+        break;
+    };
+}
+
+MPEG_mode
+mp3e_lame_mode (const OMX_AUDIO_CHANNELMODETYPE a_channel_mode)
+{
+  switch (a_channel_mode)
+    {
+      case OMX_AUDIO_ChannelModeStereo:
+      case OMX_AUDIO_ChannelModeDual:
+        {
+          return STEREO;
+        }
+      case OMX_AUDIO_ChannelModeJointStereo:
+        {
+          return JOINT_STEREO;
+        }
+      default:
+        {
+          return MONO;
+        }
+    };
+}
+
+OMX_ERRORTYPE
+mp3e_pool_init (mp3e_pool_t ** app_pool, const mp3e_settings_t * ap_settings)
+{
+  mp3e_pool_t * p_pool = NULL;
+  lame_t lame = NULL;
+  OMX_U32 i = 0;
+
+  assert (app_pool);
+  assert (ap_settings);
+
+  if (0 == ap_settings->workers || ap_settings->channels < 1
+      || ap_settings->channels > 2
+      || ap_settings->segment_frames < MP3E_POOL_MIN_SEGMENT_FRAMES
+      || (ap_settings->out_sample_rate
+          && ap_settings->out_sample_rate != ap_settings->sample_rate))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  p_pool = tiz_mem_calloc (1, sizeof (mp3e_pool_t));
+  tiz_check_null_ret_oom (p_pool);
+  p_pool->settings = *ap_settings;
+  /* Segments are cut on the PCM side, so there must be no resampling */
+  p_pool->settings.out_sample_rate = ap_settings->sample_rate;
+  p_pool->fds[0] = p_pool->fds[1] = -1;
+
+  /* Find out the frame size, and whether LAME likes the settings */
+  if (!(lame = lame_init ()))
+    {
+      tiz_mem_free (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+  mp3e_lame_configure (lame, &p_pool->settings);
+  p_pool->frame_size
+    = (lame_init_params (lame) < 0) ? 0 : (OMX_U32) lame_get_framesize (lame);
+  (void) lame_close (lame);
+  if (0 == p_pool->frame_size)
+    {
+      tiz_mem_free (p_pool);
+      return OMX_ErrorBadParameter;
+    }
+
+  /* Enough segments to keep every worker busy while the output drains */
+  p_pool->nsegs = 2 * ap_settings->workers + 2;
+  if (!(p_pool->p_segs = tiz_mem_calloc (p_pool->nsegs, sizeof (mp3e_seg_t)))
+      || !(p_pool->p_threads
+           = tiz_mem_calloc (ap_settings->workers, sizeof (tiz_thread_t)))
+      || 0 != pipe (p_pool->fds))
+    {
+      release_pool (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < 2; ++i)
+    {
+      (void) fcntl (p_pool->fds[i], F_SETFL,
+                    fcntl (p_pool->fds[i], F_GETFL) | O_NONBLOCK);
+    }
+
+  if (OMX_ErrorNone != tiz_mutex_init (&p_pool->mutex))
+    {
+      release_pool (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+  if (OMX_ErrorNone != tiz_cond_init (&p_pool->cond))
+    {
+      (void) tiz_mutex_destroy (&p_pool->mutex);
+      release_pool (p_pool);
+      return OMX_ErrorInsufficientResources;
+    }
+  p_pool->sync_init = true;
+
+  for (i = 0; i < ap_settings->workers; ++i)
+    {
+      if (OMX_ErrorNone
+          != tiz_thread_create (&p_pool->p_threads[i], 0, 0, worker_thread,
+                                p_pool))
+        {
+          release_pool (p_pool);
+          return OMX_ErrorInsufficientResources;
+        }
+      p_pool->nthreads++;
+      (void) tiz_thread_setname (&p_pool->p_threads[i],
+                                 (OMX_STRING) "tizmp3epool");
+    }
+
+  *app_pool = p_pool;
+  return OMX_ErrorNone;
+}
+
+void
+mp3e_pool_destroy (mp3e_pool_t * ap_pool)
+{
+  if (ap_pool)
+    {
+      release_pool (ap_pool);
+    }
+}
+
+int
+mp3e_pool_notify_fd (const mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->fds[0];
+}
+
+void
+mp3e_pool_clear_notifications (mp3e_pool_t * ap_pool)
+{
+  char buf[64];
+  assert (ap_pool);
+  while (read (ap_pool->fds[0], buf, sizeof (buf)) > 0)
+    {
+    }
+}
+
+OMX_U32
+mp3e_pool_write (mp3e_pool_t * ap_pool, const short * ap_pcm,
+                 const OMX_U32 a_frames)
+{
+  OMX_U32 done = 0;
+
+  assert (ap_pool);
+  assert (!ap_pool->finished);
+
+  while (done < a_frames)
+    {
+      const OMX_U64 start = ap_pool->pos;
+      OMX_U64 end = start + (a_frames - done);
+      OMX_U64 i = 0;
+
+      if (start >= ap_pool->next_start && !start_segment (ap_pool))
+        {
+          break;
+        }
+
+      /* Samples from the next segment's start on also go to that segment */
+      end = MIN (end, ap_pool->next_start);
+      for (i = ap_pool->fill_index; i < ap_pool->next_index; ++i)
+        {
+          fill_segment (ap_pool, seg_at (ap_pool, i),
+                        ap_pcm + (size_t) done * ap_pool->settings.channels,
+                        start, end);
+        }
+
+      done += (OMX_U32) (end - start);
+      ap_pool->pos = end;
+    }
+
+  return done;
+}
+
+void
+mp3e_pool_finish (mp3e_pool_t * ap_pool)
+{
+  OMX_U64 i = 0;
+
+  assert (ap_pool);
+
+  if (ap_pool->finished)
+    {
+      return;
+    }
+
+  /* The newest segment may only have received its lead-in */
+  if (ap_pool->next_index > ap_pool->fill_index
+      && seg_at (ap_pool, ap_pool->next_index - 1)->owned_start
+           >= ap_pool->pos)
+    {
+      set_seg_state (ap_pool, seg_at (ap_pool, --ap_pool->next_index),
+                     EMp3eSegFree);
+    }
+
+  for (i = ap_pool->fill_index; i < ap_pool->next_index; ++i)
+    {
+      mp3e_seg_t * p_seg = seg_at (ap_pool, i);
+      p_seg->in_end = ap_pool->pos;
+      set_seg_state (ap_pool, p_seg, EMp3eSegQueued);
+    }
+
+  ap_pool->fill_index = ap_pool->next_index;
+  ap_pool->finished = true;
+}
+
+OMX_ERRORTYPE
+mp3e_pool_read (mp3e_pool_t * ap_pool, OMX_U8 * ap_out, const OMX_U32 a_len,
+                OMX_U32 * ap_read)
+{
+  assert (ap_pool);
+  assert (ap_out);
+  assert (ap_read);
+
+  *ap_read = 0;
+  while (*ap_read < a_len && ap_pool->out_index < ap_pool->next_index)
+    {
+      mp3e_seg_t * p_seg = seg_at (ap_pool, ap_pool->out_index);
+      mp3e_seg_state_t state = seg_state (ap_pool, p_seg);
+      size_t from = 0;
+      size_t to = 0;
+      size_t n = 0;
+
+      if (EMp3eSegDone != state)
+        {
+          break;
+        }
+
+      if (!p_seg->end_known)
+        {
+          if (ap_pool->finished
+              && ap_pool->out_index + 1 == ap_pool->next_index)
+            {
+              p_seg->end = p_seg->nframes;
+              p_seg->end_known = true;
+            }
+          else if (ap_pool->out_index + 1 < ap_pool->next_index)
+            {
+              mp3e_seg_t * p_next = seg_at (ap_pool, ap_pool->out_index + 1);
+              state = seg_state (ap_pool, p_next);
+              if (EMp3eSegDone != state)
+                {
+                  break;
+                }
+              join_segments (ap_pool, p_seg, p_next);
+            }
+          else
+            {
+              break;
+            }
+        }
+
+      if (p_seg->first < p_seg->end)
+        {
+          from = p_seg->p_frames[p_seg->first].off;
+          to = p_seg->p_frames[p_seg->end - 1].off
+               + p_seg->p_frames[p_seg->end - 1].len;
+        }
+
+      n = MIN (a_len - *ap_read, to - from - p_seg->out_pos);
+      if (n > 0)
+        {
+          memcpy (ap_out + *ap_read, p_seg->p_mp3 + from + p_seg->out_pos, n);
+          p_seg->out_pos += n;
+          *ap_read += n;
+        }
+
+      if (p_seg->out_pos == to - from)
+        {
+          set_seg_state (ap_pool, p_seg, EMp3eSegFree);
+          ap_pool->out_index++;
+        }
+    }
+
+  /* A failed segment can't be skipped without breaking the stream */
+  if (ap_pool->out_index < ap_pool->next_index
+      && (EMp3eSegFailed
+            == seg_state (ap_pool, seg_at (ap_pool, ap_pool->out_index))
+          || (ap_pool->out_index + 1 < ap_pool->next_index
+              && EMp3eSegFailed
+                   == seg_state (ap_pool,
+                                 seg_at (ap_pool, ap_pool->out_index + 1)))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  return OMX_ErrorNone;
+}
+
+bool
+mp3e_pool_eos (const mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->finished && ap_pool->out_index == ap_pool->next_index;
+}
+
+OMX_U32
+mp3e_pool_unsafe_joins (const mp3e_pool_t * ap_pool)
+{
+  assert (ap_pool);
+  return ap_pool->unsafe_joins;
+}
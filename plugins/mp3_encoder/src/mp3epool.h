@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mp3epool.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Mp3 encoder - parallel segment encoder
+ *
+ * The PCM stream is cut into segments of 'segment_frames' MP3 frames. Each
+ * segment is encoded by its own LAME instance on one of the worker threads,
+ * starting a few frames early (so that the psychoacoustic model and the bit
+ * reservoir have settled) and running a few frames late. Adjacent segments
+ * are joined at a frame where the bit reservoir of the later segment fits in
+ * the reservoir of the earlier one; the reservoir bytes the joining frame
+ * needs are copied across, so the result is a valid MP3 stream.
+ *
+ */
+
+#ifndef MP3EPOOL_H
+#define MP3EPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <lame/lame.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+/* MP3 frames encoded before and after the frames a segment owns. Segments are
+   joined within +/- half of this around their boundary. */
+#define MP3E_POOL_OVERLAP_FRAMES 16
+#define MP3E_POOL_MIN_SEGMENT_FRAMES (4 * MP3E_POOL_OVERLAP_FRAMES)
+
+typedef struct mp3e_settings mp3e_settings_t;
+struct mp3e_settings
+{
+  OMX_U32 channels;
+  OMX_U32 sample_rate;
+  OMX_U32 out_sample_rate; /* 0: LAME's choice */
+  MPEG_mode mode;
+  OMX_U32 bitrate_kbps;
+  OMX_U32 quality;
+  OMX_TIZONIA_AUDIO_MP3RATECONTROLTYPE rate_control;
+  OMX_U32 vbr_quality;
+  OMX_U32 workers;
+  OMX_U32 segment_frames;
+};
+
+typedef struct mp3e_pool mp3e_pool_t;
+
+/**
+ * Apply the encoding settings to a LAME instance (before lame_init_params).
+ */
+void
+mp3e_lame_configure (lame_t ap_lame, const mp3e_settings_t * ap_settings);
+
+/**
+ * The LAME mode for an IL channel mode (dual channel is encoded as stereo).
+ */
+MPEG_mode
+mp3e_lame_mode (const OMX_AUDIO_CHANNELMODETYPE a_channel_mode);
+
+OMX_ERRORTYPE
+mp3e_pool_init (mp3e_pool_t ** app_pool, const mp3e_settings_t * ap_settings);
+
+void
+mp3e_pool_destroy (mp3e_pool_t * ap_pool);
+
+/**
+ * A descriptor that becomes readable whenever a segment has been encoded.
+ */
+int
+mp3e_pool_notify_fd (const mp3e_pool_t * ap_pool);
+
+void
+mp3e_pool_clear_notifications (mp3e_pool_t * ap_pool);
+
+/**
+ * Queue up to a_frames interleaved S16 PCM frames. Returns the number of
+ * frames accepted; fewer than a_frames when all the segments are in use.
+ */
+OMX_U32
+mp3e_pool_write (mp3e_pool_t * ap_pool, const short * ap_pcm,
+                 const OMX_U32 a_frames);
+
+/**
+ * End of stream: encode whatever has been queued.
+ */
+void
+mp3e_pool_finish (mp3e_pool_t * ap_pool);
+
+/**
+ * Copy up to a_len bytes of the stitched MP3 stream into ap_out. *ap_read
+ * holds the number of bytes copied, which is zero while the next segment is
+ * still being encoded.
+ */
+OMX_ERRORTYPE
+mp3e_pool_read (mp3e_pool_t * ap_pool, OMX_U8 * ap_out, const OMX_U32 a_len,
+                OMX_U32 * ap_read);
+
+/**
+ * True once mp3e_pool_finish has been called and the whole stream has been
+ * read.
+ */
+bool
+mp3e_pool_eos (const mp3e_pool_t * ap_pool);
+
+/**
+ * Number of joins where no reservoir-safe frame was found (the join is then
+ * made at the frame with the smallest reservoir deficit).
+ */
+OMX_U32
+mp3e_pool_unsafe_joins (const mp3e_pool_t * ap_pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3EPOOL_H */
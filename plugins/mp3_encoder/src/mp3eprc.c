@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <tizplatform.h>
 
@@ -276,6 +277,9 @@ set_lame_pcm_settings (void * ap_obj, OMX_HANDLETYPE ap_hdl, void * ap_krn)
              p_prc->pcmmode_.bInterleaved ? "OMX_TRUE" : "OMX_FALSE",
              p_prc->pcmmode_.ePCMMode);
 
+  p_prc->settings_.channels = p_prc->pcmmode_.nChannels;
+  p_prc->settings_.sample_rate = p_prc->pcmmode_.nSamplingRate;
+
   return ret_val;
 }
 
@@ -284,7 +288,6 @@ set_lame_mp3_settings (void * ap_obj, OMX_HANDLETYPE ap_hdl, void * ap_krn)
 {
   mp3e_prc_t * p_prc = ap_obj;
   OMX_ERRORTYPE ret_val = OMX_ErrorNone;
-  int lame_mode = 0;
 
   assert (p_prc);
   assert (ap_hdl);
@@ -312,44 +315,190 @@ set_lame_mp3_settings (void * ap_obj, OMX_HANDLETYPE ap_hdl, void * ap_krn)
              p_prc->mp3type_.nSampleRate, p_prc->mp3type_.nAudioBandWidth,
              p_prc->mp3type_.eChannelMode, p_prc->mp3type_.eFormat);
 
-  (void) lame_set_num_channels (p_prc->lame_, p_prc->mp3type_.nChannels);
-  (void) lame_set_in_samplerate (p_prc->lame_, p_prc->mp3type_.nSampleRate);
-  (void) lame_set_brate (p_prc->lame_, p_prc->mp3type_.nBitRate);
+  p_prc->settings_.out_sample_rate = p_prc->mp3type_.nSampleRate;
+  /* nBitRate is in bits per second; small values are taken to be kbps */
+  p_prc->settings_.bitrate_kbps = p_prc->mp3type_.nBitRate >= 1000
+                                    ? p_prc->mp3type_.nBitRate / 1000
+                                    : p_prc->mp3type_.nBitRate;
+
+  p_prc->settings_.mode = mp3e_lame_mode (p_prc->mp3type_.eChannelMode);
+
+  return ret_val;
+}
+
+static OMX_ERRORTYPE
+set_lame_encoder_settings (void * ap_obj, OMX_HANDLETYPE ap_hdl, void * ap_krn)
+{
+  mp3e_prc_t * p_prc = ap_obj;
+  OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE encoder;
+  OMX_ERRORTYPE ret_val = OMX_ErrorNone;
+  OMX_U32 workers = 0;
+
+  assert (p_prc);
+  assert (ap_hdl);
+  assert (ap_krn);
 
-  switch (p_prc->mp3type_.eChannelMode)
+  /* Retrieve the encoder params from the config port */
+  encoder.nSize = sizeof (OMX_TIZONIA_AUDIO_PARAM_MP3ENCODERTYPE);
+  encoder.nVersion.nVersion = OMX_VERSION;
+  if (OMX_ErrorNone
+      != (ret_val = tiz_api_GetParameter (
+            ap_krn, ap_hdl, OMX_TizoniaIndexParamAudioMp3Encoder, &encoder)))
     {
-      case OMX_AUDIO_ChannelModeStereo:
-        {
-          lame_mode = 0;
-        }
-        break;
-      case OMX_AUDIO_ChannelModeJointStereo:
-        {
-          lame_mode = 1;
-        }
-        break;
-      case OMX_AUDIO_ChannelModeDual:
-        {
-          /* Not supported, default to 0 (stereo) */
-          lame_mode = 0;
-        }
-        break;
-      case OMX_AUDIO_ChannelModeMono:
+      TIZ_ERROR (handleOf (p_prc),
+                 "[%s] : Error retrieving encoder params from config port",
+                 tiz_err_to_str (ret_val));
+      return ret_val;
+    }
+
+  workers = encoder.nWorkers;
+  if (0 == workers)
+    {
+      const long ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+      workers = ncpus > 0 ? MIN ((OMX_U32) ncpus,
+                                 ARATELIA_MP3_ENCODER_MAX_WORKERS)
+                          : 1;
+    }
+
+  if (workers > 1 && p_prc->settings_.out_sample_rate
+      && p_prc->settings_.out_sample_rate != p_prc->settings_.sample_rate)
+    {
+      /* Segments are cut on the PCM side; they can't be when resampling */
+      TIZ_NOTICE (handleOf (p_prc),
+                  "Batch mode disabled: resampling from [%d] to [%d] Hz",
+                  p_prc->settings_.sample_rate,
+                  p_prc->settings_.out_sample_rate);
+      workers = 1;
+    }
+
+  p_prc->settings_.quality = encoder.nQuality;
+  p_prc->settings_.rate_control = encoder.eRateControl;
+  p_prc->settings_.vbr_quality = encoder.nVbrQuality;
+  p_prc->settings_.workers = workers;
+  p_prc->settings_.segment_frames = encoder.nSegmentFrames;
+
+  TIZ_TRACE (handleOf (p_prc),
+             "nQuality = [%d] eRateControl = [%d] nVbrQuality = [%d] "
+             "workers = [%d] nSegmentFrames = [%d]",
+             encoder.nQuality, encoder.eRateControl, encoder.nVbrQuality,
+             workers, encoder.nSegmentFrames);
+
+  return ret_val;
+}
+
+static OMX_ERRORTYPE
+start_pool (mp3e_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (!ap_prc->p_pool_);
+
+  tiz_check_omx (mp3e_pool_init (&ap_prc->p_pool_, &ap_prc->settings_));
+  tiz_check_omx (tiz_srv_io_watcher_init (
+    ap_prc, &ap_prc->p_ev_io_, mp3e_pool_notify_fd (ap_prc->p_pool_),
+    TIZ_EVENT_READ, false));
+  return tiz_srv_io_watcher_start (ap_prc, ap_prc->p_ev_io_);
+}
+
+static void
+stop_pool (mp3e_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_ev_io_)
+    {
+      (void) tiz_srv_io_watcher_stop (ap_prc, ap_prc->p_ev_io_);
+      tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_io_);
+      ap_prc->p_ev_io_ = NULL;
+    }
+
+  if (ap_prc->p_pool_)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "unsafe segment joins [%d]",
+                 mp3e_pool_unsafe_joins (ap_prc->p_pool_));
+      mp3e_pool_destroy (ap_prc->p_pool_);
+      ap_prc->p_pool_ = NULL;
+    }
+}
+
+static OMX_ERRORTYPE
+encode_batch (mp3e_prc_t * ap_prc)
+{
+  const OMX_U32 frame_len = ap_prc->settings_.channels * sizeof (short);
+  bool progress = true;
+
+  assert (ap_prc);
+  assert (ap_prc->p_pool_);
+
+  while (progress)
+    {
+      progress = false;
+
+      if (ap_prc->p_outhdr_ || claim_output (ap_prc))
         {
-          lame_mode = 3;
+          OMX_BUFFERHEADERTYPE * p_out = ap_prc->p_outhdr_;
+          OMX_U32 nread = 0;
+
+          tiz_check_omx (mp3e_pool_read (
+            ap_prc->p_pool_, p_out->pBuffer + p_out->nFilledLen,
+            p_out->nAllocLen - p_out->nFilledLen, &nread));
+          p_out->nFilledLen += nread;
+          progress = (nread > 0);
+
+          if (mp3e_pool_eos (ap_prc->p_pool_))
+            {
+              /* All the input data has been encoded; propagate the EOS flag
+                 and get ready for the next stream */
+              TIZ_TRACE (handleOf (ap_prc), "p_prc->eos OUTPUT HEADER [%p]...",
+                         p_out);
+              p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+              tiz_check_omx (tiz_krn_release_buffer (
+                tiz_get_krn (handleOf (ap_prc)),
+                ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX, p_out));
+              ap_prc->p_outhdr_ = NULL;
+              ap_prc->eos_ = false;
+              stop_pool (ap_prc);
+              return start_pool (ap_prc);
+            }
+
+          if (p_out->nFilledLen == p_out->nAllocLen)
+            {
+              tiz_check_omx (tiz_krn_release_buffer (
+                tiz_get_krn (handleOf (ap_prc)),
+                ARATELIA_MP3_ENCODER_OUTPUT_PORT_INDEX, p_out));
+              ap_prc->p_outhdr_ = NULL;
+            }
         }
-        break;
 
-      default:
+      if (!ap_prc->eos_ && (ap_prc->p_inhdr_ || claim_input (ap_prc)))
         {
-          lame_mode = 3;
-        }
-    };
+          OMX_BUFFERHEADERTYPE * p_in = ap_prc->p_inhdr_;
+          const OMX_U32 accepted = mp3e_pool_write (
+            ap_prc->p_pool_, (short *) (p_in->pBuffer + p_in->nOffset),
+            p_in->nFilledLen / frame_len);
 
-  (void) lame_set_mode (p_prc->lame_, lame_mode);
-  (void) lame_set_quality (p_prc->lame_, 2); /* 2=high  5 = medium  7=low */
+          p_in->nOffset += accepted * frame_len;
+          p_in->nFilledLen -= accepted * frame_len;
+          progress = progress || (accepted > 0);
 
-  return ret_val;
+          if (p_in->nFilledLen < frame_len)
+            {
+              if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+                {
+                  ap_prc->eos_ = true;
+                  mp3e_pool_finish (ap_prc->p_pool_);
+                }
+              p_in->nFilledLen = 0;
+              p_in->nOffset = 0;
+              tiz_check_omx (tiz_krn_release_buffer (
+                tiz_get_krn (handleOf (ap_prc)),
+                ARATELIA_MP3_ENCODER_INPUT_PORT_INDEX, p_in));
+              ap_prc->p_inhdr_ = NULL;
+              progress = true;
+            }
+        }
+    }
+
+  return OMX_ErrorNone;
 }
 
 /*
@@ -362,6 +511,8 @@ mp3e_proc_ctor (void * ap_obj, va_list * app)
   mp3e_prc_t * p_prc = super_ctor (typeOf (ap_obj, "mp3eprc"), ap_obj, app);
   assert (p_prc);
   p_prc->lame_ = NULL;
+  p_prc->p_pool_ = NULL;
+  p_prc->p_ev_io_ = NULL;
   p_prc->frame_size_ = 0;
   p_prc->p_inhdr_ = 0;
   p_prc->p_outhdr_ = 0;
@@ -376,6 +527,8 @@ mp3e_proc_dtor (void * ap_obj)
   mp3e_prc_t * p_prc = ap_obj;
   assert (p_prc);
 
+  stop_pool (p_prc);
+
   if (p_prc->lame_)
     {
       lame_close (p_prc->lame_);
@@ -419,6 +572,8 @@ mp3e_proc_deallocate_resources (void * ap_obj)
   mp3e_prc_t * p_prc = ap_obj;
   assert (p_prc);
 
+  stop_pool (p_prc);
+
   if (p_prc->lame_)
     {
       lame_close (p_prc->lame_);
@@ -455,6 +610,20 @@ mp3e_proc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
       return ret_val;
     }
 
+  if (OMX_ErrorNone
+      != (ret_val = set_lame_encoder_settings (
+            p_prc, handleOf (p_prc), tiz_get_krn (handleOf (p_prc)))))
+    {
+      return ret_val;
+    }
+
+  if (p_prc->settings_.workers > 1)
+    {
+      /* Batch mode; the streaming encoder is not used */
+      return start_pool (p_prc);
+    }
+
+  mp3e_lame_configure (p_prc->lame_, &p_prc->settings_);
   if (-1 == lame_init_params (p_prc->lame_))
     {
       TIZ_ERROR (handleOf (p_prc),
@@ -477,6 +646,9 @@ mp3e_proc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 static OMX_ERRORTYPE
 mp3e_proc_stop_and_return (void * ap_obj)
 {
+  mp3e_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  stop_pool (p_prc);
   return release_buffers (ap_obj);
 }
 
@@ -490,6 +662,11 @@ mp3e_proc_buffers_ready (const void * ap_obj)
   mp3e_prc_t * p_prc = (mp3e_prc_t *) ap_obj;
   assert (p_prc);
 
+  if (p_prc->p_pool_)
+    {
+      return encode_batch (p_prc);
+    }
+
   while (1)
     {
 
@@ -539,10 +716,34 @@ mp3e_proc_buffers_ready (const void * ap_obj)
 static OMX_ERRORTYPE
 mp3e_proc_port_flush (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  mp3e_prc_t * p_prc = (mp3e_prc_t *) ap_obj;
+  assert (p_prc);
+  if (p_prc->p_pool_)
+    {
+      /* Drop the segments in flight and start over */
+      stop_pool (p_prc);
+      p_prc->eos_ = false;
+      tiz_check_omx (start_pool (p_prc));
+    }
   /* Release all buffers, regardless of the port this is received on */
   return release_buffers (ap_obj);
 }
 
+static OMX_ERRORTYPE
+mp3e_proc_io_ready (void * ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                    int a_events)
+{
+  mp3e_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_pool_)
+    {
+      /* A segment has been encoded */
+      mp3e_pool_clear_notifications (p_prc->p_pool_);
+      return mp3e_proc_buffers_ready (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 mp3e_proc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
@@ -621,6 +822,8 @@ mp3e_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, mp3e_proc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_port_enable, mp3e_proc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, mp3e_proc_io_ready,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
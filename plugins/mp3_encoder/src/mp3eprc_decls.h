@@ -41,6 +41,10 @@ extern "C" {
 #include <stdbool.h>
 #include <lame/lame.h>
 
+#include <tizplatform.h>
+
+#include "mp3epool.h"
+
 #define INPUT_BUFFER_SIZE (5 * 8192)
 #define OUTPUT_BUFFER_SIZE 8192 /* Must be an integer multiple of 4. */
 
@@ -51,7 +55,10 @@ struct mp3e_prc
   const tiz_prc_t _;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   OMX_AUDIO_PARAM_MP3TYPE mp3type_;
+  mp3e_settings_t settings_;
   lame_t lame_;
+  mp3e_pool_t * p_pool_;
+  tiz_event_io_t * p_ev_io_;
   int frame_size_;
   OMX_BUFFERHEADERTYPE * p_inhdr_;
   OMX_BUFFERHEADERTYPE * p_outhdr_;
@@ -124,9 +124,31 @@ static OMX_PTR instantiate_mp2_port (OMX_HANDLETYPE ap_hdl)
                       &encodings, &mp2type);
 }
 
+static OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE sample_format_from_rc (void)
+{
+  OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE format = OMX_AUDIO_SampleFormatS16;
+  const char *p_value = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      ARATELIA_MPG123_DECODER_COMPONENT_NAME ".sample_format");
+  if (p_value)
+    {
+      if (0 == strncmp (p_value, "s32", strlen ("s32")))
+        {
+          format = OMX_AUDIO_SampleFormatS32;
+        }
+      else if (0 == strncmp (p_value, "f32", strlen ("f32")))
+        {
+          format = OMX_AUDIO_SampleFormatF32;
+        }
+    }
+  return format;
+}
+
 static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
 {
+  OMX_PTR p_port = NULL;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+  OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE sampleformat;
   OMX_AUDIO_CONFIG_VOLUMETYPE volume;
   OMX_AUDIO_CONFIG_MUTETYPE mute;
   OMX_AUDIO_CODINGTYPE encodings[]
@@ -151,7 +173,7 @@ static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
   pcmmode.eNumData = OMX_NumericalDataSigned;
   pcmmode.eEndian = OMX_EndianLittle;
   pcmmode.bInterleaved = OMX_TRUE;
-  pcmmode.nBitPerSample = 16;
+  pcmmode.nBitPerSample = ARATELIA_MPG123_DECODER_DEFAULT_BIT_PER_SAMPLE;
   pcmmode.nSamplingRate = 48000;
   pcmmode.ePCMMode = OMX_AUDIO_PCMModeLinear;
   pcmmode.eChannelMapping[0] = OMX_AUDIO_ChannelLF;
@@ -170,8 +192,27 @@ static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
   mute.nPortIndex = ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX;
   mute.bMute = OMX_FALSE;
 
-  return factory_new (tiz_get_type (ap_hdl, "tizpcmport"), &pcm_port_opts,
-                      &encodings, &pcmmode, &volume, &mute);
+  sampleformat.nSize = sizeof(OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE);
+  sampleformat.nVersion.nVersion = OMX_VERSION;
+  sampleformat.nPortIndex = ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX;
+  sampleformat.eFormat = sample_format_from_rc ();
+
+  if (OMX_AUDIO_SampleFormatS16 != sampleformat.eFormat)
+    {
+      pcmmode.nBitPerSample = 32;
+    }
+
+  p_port = factory_new (tiz_get_type (ap_hdl, "tizpcmport"), &pcm_port_opts,
+                        &encodings, &pcmmode, &volume, &mute);
+  if (p_port)
+    {
+      /* The processor picks the mpg123 output encoding from this */
+      (void)tiz_api_SetParameter (
+          p_port, ap_hdl,
+          (OMX_INDEXTYPE)OMX_TizoniaIndexParamAudioSampleFormat,
+          &sampleformat);
+    }
+  return p_port;
 }
 
 static OMX_PTR instantiate_config_port (OMX_HANDLETYPE ap_hdl)
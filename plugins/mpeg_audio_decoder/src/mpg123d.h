@@ -48,6 +48,7 @@ extern "C"
 #define ARATELIA_MPG123_DECODER_PORT_NONCONTIGUOUS       OMX_FALSE
 #define ARATELIA_MPG123_DECODER_PORT_ALIGNMENT           0
 #define ARATELIA_MPG123_DECODER_PORT_SUPPLIERPREF        OMX_BufferSupplyInput
+#define ARATELIA_MPG123_DECODER_DEFAULT_BIT_PER_SAMPLE   16
 
 #define ARATELIA_MPG123_DECODER_BUF_FILL_THRESHOLD       2 * ARATELIA_MPG123_DECODER_PORT_MIN_INPUT_BUF_SIZE
 
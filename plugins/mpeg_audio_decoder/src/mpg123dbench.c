@@ -0,0 +1,262 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   mpg123dbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - MPEG audio decoder - output encoding benchmark
+ *
+ * Decodes an MPEG audio file with libmpg123's feed API, the way the
+ * component does (fixed-size input chunks, mpg123_read into a fixed-size
+ * output buffer), once per output encoding, and prints the throughput of
+ * each one.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mpg123.h>
+
+#include "mpg123d.h"
+
+typedef struct bench_encoding bench_encoding_t;
+struct bench_encoding
+{
+  const char *p_name;
+  int encoding;
+};
+
+static const bench_encoding_t encodings[]
+    = { { "s16", MPG123_ENC_SIGNED_16 },
+        { "s32", MPG123_ENC_SIGNED_32 },
+        { "f32", MPG123_ENC_FLOAT_32 } };
+
+static double now_secs (void)
+{
+  struct timespec ts;
+  (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static unsigned char *load_file (const char *ap_path, size_t *ap_len)
+{
+  unsigned char *p_data = NULL;
+  FILE *p_file = fopen (ap_path, "rb");
+  long len = 0;
+
+  if (!p_file)
+    {
+      return NULL;
+    }
+  if (0 == fseek (p_file, 0, SEEK_END) && (len = ftell (p_file)) > 0
+      && 0 == fseek (p_file, 0, SEEK_SET)
+      && (p_data = malloc ((size_t)len)))
+    {
+      if (fread (p_data, 1, (size_t)len, p_file) != (size_t)len)
+        {
+          free (p_data);
+          p_data = NULL;
+        }
+    }
+  fclose (p_file);
+  *ap_len = (size_t)len;
+  return p_data;
+}
+
+static bool is_encoding_supported (const int encoding)
+{
+  const int *p_encodings = NULL;
+  size_t num_encodings = 0;
+  size_t i = 0;
+  mpg123_encodings (&p_encodings, &num_encodings);
+  for (i = 0; i < num_encodings; ++i)
+    {
+      if (encoding == p_encodings[i])
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+static int run (const unsigned char *ap_data, const size_t a_len,
+                const bench_encoding_t *ap_enc, const int a_rounds)
+{
+  static unsigned char out[ARATELIA_MPG123_DECODER_PORT_MIN_OUTPUT_BUF_SIZE];
+  mpg123_handle *p_mh = NULL;
+  const long *p_rates = NULL;
+  size_t num_rates = 0;
+  size_t i = 0;
+  size_t bytes_out = 0;
+  long rate = 0;
+  int channels = 0;
+  int encoding = 0;
+  double elapsed = 0.0;
+  double audio_secs = 0.0;
+  int round = 0;
+  int ret = MPG123_OK;
+
+  if (!is_encoding_supported (ap_enc->encoding))
+    {
+      printf ("%-4s  not supported by this libmpg123\n", ap_enc->p_name);
+      return EXIT_SUCCESS;
+    }
+
+  mpg123_rates (&p_rates, &num_rates);
+
+  for (round = 0; round < a_rounds && MPG123_OK == ret; ++round)
+    {
+      size_t fed = 0;
+      double start = 0.0;
+
+      if (!(p_mh = mpg123_new (NULL, &ret))
+          || MPG123_OK != (ret = mpg123_open_feed (p_mh))
+          || MPG123_OK != (ret = mpg123_format_none (p_mh)))
+        {
+          break;
+        }
+      for (i = 0; i < num_rates && MPG123_OK == ret; ++i)
+        {
+          ret = mpg123_format (p_mh, p_rates[i], MPG123_MONO | MPG123_STEREO,
+                               ap_enc->encoding);
+        }
+
+      start = now_secs ();
+      while (MPG123_OK == ret)
+        {
+          size_t done = 0;
+          ret = mpg123_read (p_mh, out, sizeof (out), &done);
+          bytes_out += done;
+          if (MPG123_NEW_FORMAT == ret)
+            {
+              (void)mpg123_getformat (p_mh, &rate, &channels, &encoding);
+              ret = MPG123_OK;
+            }
+          else if (MPG123_NEED_MORE == ret && fed < a_len)
+            {
+              size_t chunk = a_len - fed;
+              if (chunk > ARATELIA_MPG123_DECODER_PORT_MIN_INPUT_BUF_SIZE)
+                {
+                  chunk = ARATELIA_MPG123_DECODER_PORT_MIN_INPUT_BUF_SIZE;
+                }
+              ret = mpg123_feed (p_mh, ap_data + fed, chunk);
+              fed += chunk;
+            }
+        }
+      elapsed += now_secs () - start;
+      mpg123_delete (p_mh);
+      p_mh = NULL;
+      if (MPG123_NEED_MORE == ret || MPG123_DONE == ret)
+        {
+          ret = MPG123_OK;
+        }
+    }
+
+  if (MPG123_OK != ret || 0 == rate || 0 == channels)
+    {
+      fprintf (stderr, "mpg123dbench: %s : %s\n", ap_enc->p_name,
+               mpg123_plain_strerror (ret));
+      mpg123_delete (p_mh);
+      return EXIT_FAILURE;
+    }
+
+  audio_secs = (double)bytes_out / mpg123_encsize (encoding) / channels
+               / rate;
+  printf ("%-4s  %6ld Hz %d ch  %8.2f Mframes/s  %7.1fx realtime  "
+          "%9.1f MB/s out\n",
+          ap_enc->p_name, rate, channels,
+          elapsed > 0.0 ? audio_secs * rate / elapsed / 1e6 : 0.0,
+          elapsed > 0.0 ? audio_secs / elapsed : 0.0,
+          elapsed > 0.0 ? bytes_out / elapsed / 1e6 : 0.0);
+  return EXIT_SUCCESS;
+}
+
+static void usage (const char *ap_prg)
+{
+  fprintf (stderr, "Usage: %s [-f s16|s32|f32] [-r rounds] file\n", ap_prg);
+}
+
+int main (int argc, char **argv)
+{
+  const size_t num_encodings = sizeof (encodings) / sizeof (encodings[0]);
+  const char *p_format = NULL;
+  unsigned char *p_data = NULL;
+  size_t len = 0;
+  size_t i = 0;
+  int rounds = 5;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "f:r:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'f':
+            p_format = optarg;
+            break;
+          case 'r':
+            rounds = atoi (optarg);
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (optind >= argc || rounds <= 0)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (!(p_data = load_file (argv[optind], &len)))
+    {
+      fprintf (stderr, "mpg123dbench: unable to read %s\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  if (MPG123_OK != mpg123_init ())
+    {
+      fprintf (stderr, "mpg123dbench: unable to initialise libmpg123\n");
+      free (p_data);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < num_encodings && EXIT_SUCCESS == rc; ++i)
+    {
+      if (!p_format || 0 == strcmp (p_format, encodings[i].p_name))
+        {
+          rc = run (p_data, len, &encodings[i], rounds);
+        }
+    }
+
+  mpg123_exit ();
+  free (p_data);
+  return rc;
+}
@@ -34,6 +34,8 @@
 #include <limits.h>
 #include <string.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include <tizkernel.h>
@@ -263,6 +265,99 @@ static void retrieve_stream_format (mpg123d_prc_t *ap_prc)
              channels, mpeg_output_encoding_to_str (encoding));
 }
 
+static int output_encoding (mpg123d_prc_t *ap_prc)
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+  OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE sampleformat;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (pcmmode,
+                            ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+  TIZ_INIT_OMX_PORT_STRUCT (sampleformat,
+                            ARATELIA_MPG123_DECODER_OUTPUT_PORT_INDEX);
+  rc = tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                             handleOf (ap_prc), OMX_IndexParamAudioPcm,
+                             &pcmmode);
+  if (OMX_ErrorNone == rc)
+    {
+      rc = tiz_api_GetParameter (
+          tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+          (OMX_INDEXTYPE)OMX_TizoniaIndexParamAudioSampleFormat,
+          &sampleformat);
+    }
+
+  if (OMX_ErrorNone != rc || 32 != pcmmode.nBitPerSample)
+    {
+      return MPG123_ENC_SIGNED_16;
+    }
+
+  return OMX_AUDIO_SampleFormatS32 == sampleformat.eFormat
+             ? MPG123_ENC_SIGNED_32
+             : MPG123_ENC_FLOAT_32;
+}
+
+static bool is_encoding_supported (const int encoding)
+{
+  const int *p_encodings = NULL;
+  size_t num_encodings = 0;
+  size_t i = 0;
+  mpg123_encodings (&p_encodings, &num_encodings);
+  for (i = 0; i < num_encodings; ++i)
+    {
+      if (encoding == p_encodings[i])
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Restrict libmpg123's output to the encoding of the pcm port, at any rate.
+   mpg123_read then writes samples in that encoding straight into the output
+   buffer headers. */
+static OMX_ERRORTYPE set_output_encoding (mpg123d_prc_t *ap_prc)
+{
+  const int encoding = output_encoding (ap_prc);
+  const long *p_rates = NULL;
+  size_t num_rates = 0;
+  size_t i = 0;
+  int ret = MPG123_OK;
+
+  assert (ap_prc);
+  assert (ap_prc->p_mpg123_);
+
+  if (!is_encoding_supported (encoding))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "libmpg123 does not support [%s] output",
+                 mpeg_output_encoding_to_str (encoding));
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  ret = mpg123_format_none (ap_prc->p_mpg123_);
+  mpg123_rates (&p_rates, &num_rates);
+  for (i = 0; i < num_rates && MPG123_OK == ret; ++i)
+    {
+      ret = mpg123_format (ap_prc->p_mpg123_, p_rates[i],
+                           MPG123_MONO | MPG123_STEREO, encoding);
+    }
+
+  if (MPG123_OK != ret)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorInsufficientResources] : mpg123_format : [%s]",
+                 mpg123_plain_strerror (ret));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  TIZ_TRACE (handleOf (ap_prc), "output encoding [%s]",
+             mpeg_output_encoding_to_str (encoding));
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE consume_decoded_data (mpg123d_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
@@ -455,12 +550,11 @@ static OMX_ERRORTYPE mpg123d_prc_allocate_resources (void *ap_prc,
   ret = mpg123_open_feed (p_prc->p_mpg123_);
   goto_end_on_mpg123_error (ret);
 
-  /* Everything went well  */
-  rc = OMX_ErrorNone;
+  rc = set_output_encoding (p_prc);
 
 end:
 
-  if (OMX_ErrorInsufficientResources == rc)
+  if (OMX_ErrorNone != rc)
     {
       mpg123_delete (p_prc->p_mpg123_); /* Closes, too. */
       p_prc->p_mpg123_ = NULL;
@@ -54,6 +54,9 @@ extern "C" {
 #define ARATELIA_OGG_MUXER_OGG_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_OGG_MUXER_OGG_PORT_ALIGNMENT 0
 #define ARATELIA_OGG_MUXER_OGG_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+/* Filter role - page fill policy (see oggmuxpage.h) */
+#define ARATELIA_OGG_MUXER_DEFAULT_PAGE_SIZE 4096
+#define ARATELIA_OGG_MUXER_DEFAULT_PAGE_DURATION_MS 1000
 
 /* Sink/filter audio input port */
 #define ARATELIA_OGG_MUXER_AUDIO_PORT_MIN_BUF_COUNT 2
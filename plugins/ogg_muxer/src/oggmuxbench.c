@@ -0,0 +1,426 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   oggmuxbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Ogg muxer - page fill throughput benchmark
+ *
+ * Muxes a synthetic Opus stream, once with one packet per page (the old
+ * behaviour) and once with the page fill policy, and prints the throughput
+ * and the container overhead of each run. Each output is then read back with
+ * oggz's reader, as the ogg_demuxer does, and checked packet by packet.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "oggmux.h"
+#include "oggmuxpage.h"
+
+/* The size of the muxer's output buffers */
+#define BENCH_OUT_CHUNK ARATELIA_OGG_MUXER_OGG_PORT_MIN_BUF_SIZE
+#define BENCH_HEAD_PACKETS 2
+
+typedef struct bench_packet bench_packet_t;
+struct bench_packet
+{
+  OMX_U8 * p_data;
+  OMX_U32 len;
+};
+
+typedef struct bench_stream bench_stream_t;
+struct bench_stream
+{
+  bench_packet_t * p_packets;
+  OMX_U32 count;
+  OMX_U64 payload;
+};
+
+typedef struct bench_check bench_check_t;
+struct bench_check
+{
+  const bench_stream_t * p_stream;
+  OMX_U32 next;
+  bool ok;
+  bool eos;
+  bool opus;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static inline void
+le32 (OMX_U8 * p, const OMX_U32 v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+/* OpusHead and OpusTags, as the muxer writes them, followed by CELT
+   fullband stereo packets of a_frame_ms, of random sizes around
+   a_packet_bytes */
+static bool
+make_stream (bench_stream_t * ap_stream, const double a_secs,
+             const OMX_U32 a_frame_ms, const OMX_U32 a_packet_bytes)
+{
+  /* CELT configurations 28 to 31: 2.5, 5, 10 and 20 ms */
+  const OMX_U8 toc = ((a_frame_ms >= 20 ? 31 : (a_frame_ms >= 10 ? 30 : 29))
+                      << 3)
+                     | 0x4;
+  const OMX_U32 frame_ms = a_frame_ms >= 20 ? 20 : (a_frame_ms >= 10 ? 10 : 5);
+  uint32_t seed = 1;
+  OMX_U32 i = 0;
+  OMX_U32 j = 0;
+
+  ap_stream->count = BENCH_HEAD_PACKETS + (OMX_U32) (a_secs * 1000 / frame_ms);
+  ap_stream->payload = 0;
+  ap_stream->p_packets = calloc (ap_stream->count, sizeof (bench_packet_t));
+  if (!ap_stream->p_packets)
+    {
+      return false;
+    }
+
+  for (i = 0; i < ap_stream->count; ++i)
+    {
+      bench_packet_t * p_pkt = &(ap_stream->p_packets[i]);
+      seed = seed * 1664525u + 1013904223u;
+      p_pkt->len
+        = 0 == i ? 19
+                 : (1 == i ? 8 + 4 + 7 + 4
+                           : a_packet_bytes * 3 / 4
+                               + (seed >> 8) % (a_packet_bytes / 2 + 1));
+      if (!(p_pkt->p_data = calloc (1, p_pkt->len)))
+        {
+          return false;
+        }
+      if (0 == i)
+        {
+          memcpy (p_pkt->p_data, "OpusHead", 8);
+          p_pkt->p_data[8] = 1;
+          p_pkt->p_data[9] = 2;
+          le32 (p_pkt->p_data + 12, 48000);
+        }
+      else if (1 == i)
+        {
+          memcpy (p_pkt->p_data, "OpusTags", 8);
+          le32 (p_pkt->p_data + 8, 7);
+          memcpy (p_pkt->p_data + 12, "Tizonia", 7);
+        }
+      else
+        {
+          p_pkt->p_data[0] = toc;
+          for (j = 1; j < p_pkt->len; ++j)
+            {
+              seed = seed * 1664525u + 1013904223u;
+              p_pkt->p_data[j] = (OMX_U8) (seed >> 24);
+            }
+        }
+      ap_stream->payload += p_pkt->len;
+    }
+  return true;
+}
+
+static void
+free_stream (bench_stream_t * ap_stream)
+{
+  OMX_U32 i = 0;
+  for (i = 0; ap_stream->p_packets && i < ap_stream->count; ++i)
+    {
+      free (ap_stream->p_packets[i].p_data);
+    }
+  free (ap_stream->p_packets);
+}
+
+/* The muxer's write path: feed a packet, then pull the completed pages into
+   output-buffer-sized chunks */
+static long
+mux (const bench_stream_t * ap_stream, const oggmux_page_policy_t * ap_policy,
+     OMX_U8 * ap_out, const long a_cap)
+{
+  OGGZ * p_oggz = oggz_new (OGGZ_WRITE);
+  oggmux_page_stream_t page;
+  ogg_int64_t granulepos = 0;
+  long len = 0;
+  long n = 0;
+  OMX_U32 i = 0;
+
+  if (!p_oggz)
+    {
+      return -1;
+    }
+
+  oggmux_page_stream_reset (&page, oggz_serialno_new (p_oggz));
+  for (i = 0; i < ap_stream->count && len >= 0; ++i)
+    {
+      const bench_packet_t * p_pkt = &(ap_stream->p_packets[i]);
+      const OMX_U32 samples
+        = i < BENCH_HEAD_PACKETS
+            ? 0
+            : oggmux_opus_packet_samples (p_pkt->p_data, p_pkt->len);
+      ogg_packet op;
+
+      granulepos += samples;
+      op.packet = p_pkt->p_data;
+      op.bytes = p_pkt->len;
+      op.granulepos = granulepos;
+      op.packetno = i;
+      op.b_o_s = (0 == i);
+      op.e_o_s = (ap_stream->count - 1 == i);
+      if (OGGZ_ERR_OK
+          != oggmux_page_feed (p_oggz, &page, ap_policy, &op,
+                               samples * 1000 / 48, i < BENCH_HEAD_PACKETS))
+        {
+          len = -1;
+          break;
+        }
+
+      while (len >= 0
+             && (n = oggz_write_output (
+                   p_oggz, ap_out + len,
+                   MIN (BENCH_OUT_CHUNK - len % BENCH_OUT_CHUNK, a_cap - len)))
+                  > 0)
+        {
+          len += n;
+        }
+      len = n < 0 ? -1 : len;
+    }
+
+  (void) oggz_close (p_oggz);
+  return len;
+}
+
+static OMX_U32
+count_pages (const OMX_U8 * ap_data, const long a_len)
+{
+  OMX_U32 pages = 0;
+  long pos = 0;
+  while (pos + 27 <= a_len && 0 == memcmp (ap_data + pos, "OggS", 4))
+    {
+      const OMX_U8 nsegs = ap_data[pos + 26];
+      long body = 0;
+      OMX_U8 s = 0;
+      for (s = 0; s < nsegs && pos + 27 + s < a_len; ++s)
+        {
+          body += ap_data[pos + 27 + s];
+        }
+      pos += 27 + nsegs + body;
+      ++pages;
+    }
+  return pos == a_len ? pages : 0;
+}
+
+static int
+check_packet (OGGZ * ap_oggz, oggz_packet * ap_zp, long serialno,
+              void * ap_user_data)
+{
+  bench_check_t * p_check = ap_user_data;
+  const ogg_packet * p_op = &(ap_zp->op);
+  const bench_packet_t * p_pkt = NULL;
+
+  if (p_check->next >= p_check->p_stream->count)
+    {
+      p_check->ok = false;
+      return OGGZ_STOP_ERR;
+    }
+
+  p_pkt = &(p_check->p_stream->p_packets[p_check->next]);
+  if (p_op->bytes != (long) p_pkt->len
+      || 0 != memcmp (p_op->packet, p_pkt->p_data, p_pkt->len)
+      || (0 == p_check->next) != (p_op->b_o_s != 0))
+    {
+      p_check->ok = false;
+      return OGGZ_STOP_ERR;
+    }
+
+  if (0 == p_check->next)
+    {
+      /* What the demuxer looks at to pick the audio stream */
+      p_check->opus
+        = (OGGZ_CONTENT_OPUS == oggz_stream_get_content (ap_oggz, serialno));
+    }
+  p_check->eos = (p_op->e_o_s != 0);
+  p_check->next++;
+  return OGGZ_CONTINUE;
+}
+
+static bool
+demux_check (const bench_stream_t * ap_stream, OMX_U8 * ap_data,
+             const long a_len)
+{
+  OGGZ * p_oggz = oggz_new (OGGZ_READ);
+  bench_check_t check = {ap_stream, 0, true, false, false};
+  long pos = 0;
+
+  if (!p_oggz
+      || oggz_set_read_callback (p_oggz, -1, check_packet, &check) < 0)
+    {
+      return false;
+    }
+
+  while (check.ok && pos < a_len)
+    {
+      const long n = MIN (4096, a_len - pos);
+      if (oggz_read_input (p_oggz, ap_data + pos, n) < 0)
+        {
+          check.ok = false;
+        }
+      pos += n;
+    }
+
+  (void) oggz_close (p_oggz);
+  return check.ok && check.opus && check.eos && check.next == ap_stream->count;
+}
+
+static int
+run (const char * ap_label, const bench_stream_t * ap_stream,
+     const oggmux_page_policy_t * ap_policy, const double a_secs)
+{
+  /* Pages add at most 27 + 255 bytes each; one packet per page is the worst
+     case */
+  const long cap = (long) ap_stream->payload + (long) ap_stream->count * 300;
+  OMX_U8 * p_out = malloc (cap);
+  double start = 0.0;
+  double elapsed = 0.0;
+  OMX_U32 pages = 0;
+  long len = 0;
+  bool ok = false;
+
+  if (!p_out)
+    {
+      return EXIT_FAILURE;
+    }
+
+  start = now_secs ();
+  len = mux (ap_stream, ap_policy, p_out, cap);
+  elapsed = now_secs () - start;
+
+  if (len < 0)
+    {
+      fprintf (stderr, "oggmuxbench: muxing failed\n");
+      free (p_out);
+      return EXIT_FAILURE;
+    }
+
+  pages = count_pages (p_out, len);
+  ok = pages > 0 && demux_check (ap_stream, p_out, len);
+
+  printf ("%-12s %6u B %5u ms  %8.1f MB/s  %9.0f packets/s  %7u pages  "
+          "%5.0f B/page  overhead %5.2f%%  demux %s\n",
+          ap_label, (unsigned) ap_policy->page_size,
+          (unsigned) ap_policy->page_duration_ms,
+          elapsed > 0.0 ? len / elapsed / 1e6 : 0.0,
+          elapsed > 0.0 ? ap_stream->count / elapsed : 0.0, (unsigned) pages,
+          pages ? (double) len / pages : 0.0,
+          100.0 * (len - (double) ap_stream->payload) / len,
+          ok ? "OK" : "FAILED");
+
+  free (p_out);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr,
+           "Usage: %s [-s seconds] [-f frame-ms] [-b packet-bytes] "
+           "[-p page-size] [-d page-duration-ms]\n",
+           ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  const oggmux_page_policy_t per_packet = {0, 0};
+  oggmux_page_policy_t policy = {ARATELIA_OGG_MUXER_DEFAULT_PAGE_SIZE,
+                                 ARATELIA_OGG_MUXER_DEFAULT_PAGE_DURATION_MS};
+  bench_stream_t stream = {NULL, 0, 0};
+  double secs = 3600.0;
+  OMX_U32 frame_ms = 20;
+  OMX_U32 packet_bytes = 160;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "s:f:b:p:d:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            secs = strtod (optarg, NULL);
+            break;
+          case 'f':
+            frame_ms = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'b':
+            packet_bytes = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'p':
+            policy.page_size = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'd':
+            policy.page_duration_ms = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (secs <= 0.0 || 0 == packet_bytes || packet_bytes > 1275 * 3)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (!make_stream (&stream, secs, frame_ms, packet_bytes))
+    {
+      free_stream (&stream);
+      return EXIT_FAILURE;
+    }
+
+  printf ("%.0f s of %u ms Opus packets, ~%u bytes each\n", secs,
+          (unsigned) frame_ms, (unsigned) packet_bytes);
+  rc = run ("per-packet", &stream, &per_packet, secs);
+  if (EXIT_SUCCESS == rc)
+    {
+      rc = run ("page-fill", &stream, &policy, secs);
+    }
+
+  free_stream (&stream);
+  return rc;
+}
@@ -33,6 +33,8 @@
 #include <alloca.h>
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
@@ -161,9 +163,10 @@ enqueue_opus_head (oggmuxflt_prc_t * ap_prc)
   op.packetno = 0;
 
   assert (ap_prc);
-  on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                              ap_prc->oggz_audio_serialno_,
-                                              OGGZ_FLUSH_AFTER, NULL));
+  on_oggz_error_ret_omx_oom (oggmux_page_feed (ap_prc->p_oggz_,
+                                               &ap_prc->audio_page_,
+                                               &ap_prc->page_policy_, &op, 0,
+                                               true));
   ap_prc->oggz_audio_packetno_++;
 
   tiz_mem_free (data);
@@ -198,9 +201,10 @@ enqueue_opus_tags (oggmuxflt_prc_t * ap_prc)
   op.packetno = 1;
 
   assert (ap_prc);
-  on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                              ap_prc->oggz_audio_serialno_,
-                                              OGGZ_FLUSH_AFTER, NULL));
+  on_oggz_error_ret_omx_oom (oggmux_page_feed (ap_prc->p_oggz_,
+                                               &ap_prc->audio_page_,
+                                               &ap_prc->page_policy_, &op, 0,
+                                               true));
   ap_prc->oggz_audio_packetno_++;
 
   tiz_mem_free (data);
@@ -218,6 +222,10 @@ enqueue_opus_packet (oggmuxflt_prc_t * ap_prc)
   OGGMUXFLT_LOG_STATE (ap_prc);
   if (p_hdr)
     {
+      const OMX_U32 samples = oggmux_opus_packet_samples (
+        p_hdr->pBuffer + p_hdr->nOffset, p_hdr->nFilledLen);
+      /* The granule position of an Opus packet is its last 48 kHz sample */
+      ap_prc->oggz_audio_granulepos_ += samples;
       op.packet = p_hdr->pBuffer + p_hdr->nOffset;
       op.bytes = p_hdr->nFilledLen;
       op.granulepos = ap_prc->oggz_audio_granulepos_;
@@ -225,13 +233,12 @@ enqueue_opus_packet (oggmuxflt_prc_t * ap_prc)
       op.b_o_s = 0;
       op.e_o_s = (((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0) ? 1 : 0);
       TIZ_DEBUG (handleOf (ap_prc), "written [%d]", op.bytes);
-      on_oggz_error_ret_omx_oom (oggz_write_feed (ap_prc->p_oggz_, &op,
-                                                  ap_prc->oggz_audio_serialno_,
-                                                  OGGZ_FLUSH_AFTER, NULL));
+      on_oggz_error_ret_omx_oom (oggmux_page_feed (
+        ap_prc->p_oggz_, &ap_prc->audio_page_, &ap_prc->page_policy_, &op,
+        samples * 1000 / 48, false));
       p_hdr->nFilledLen = 0;
       rc = release_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_0_INDEX,
                                  p_hdr);
-      ap_prc->oggz_audio_granulepos_ += 100;
       ap_prc->oggz_audio_packetno_++;
     }
 
@@ -239,7 +246,7 @@ enqueue_opus_packet (oggmuxflt_prc_t * ap_prc)
 }
 
 static OMX_ERRORTYPE
-audio_hungry (oggmuxflt_prc_t * ap_prc)
+feed_audio (oggmuxflt_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_prc);
@@ -260,7 +267,7 @@ audio_hungry (oggmuxflt_prc_t * ap_prc)
 }
 
 static OMX_ERRORTYPE
-video_hungry (oggmuxflt_prc_t * ap_prc)
+feed_video (oggmuxflt_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNotReady;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
@@ -274,8 +281,9 @@ video_hungry (oggmuxflt_prc_t * ap_prc)
       op.packetno = ap_prc->oggz_video_packetno_;
       op.b_o_s = (0 == ap_prc->oggz_video_packetno_ ? 1 : 0);
       op.e_o_s = (((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0) ? 1 : 0);
-      oggz_write_feed (ap_prc->p_oggz_, &op, ap_prc->oggz_video_serialno_,
-                       OGGZ_FLUSH_AFTER, NULL);
+      on_oggz_error_ret_omx_oom (oggmux_page_feed (
+        ap_prc->p_oggz_, &ap_prc->video_page_, &ap_prc->page_policy_, &op,
+        ap_prc->video_frame_us_, false));
       p_hdr->nFilledLen = 0;
       rc = release_input_header (ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX,
                                  p_hdr);
@@ -285,115 +293,57 @@ video_hungry (oggmuxflt_prc_t * ap_prc)
   return rc;
 }
 
-/**
- * This is callback which Oggz will call when oggz is hungry.
- *
- * \param oggz The OGGZ handle
- * \param empty A value of 1 indicates that the packet queue is currently
- *        empty. A value of 0 indicates that the packet queue is not empty.
- * \param user_data A generic pointer provided to oggz
- * \retval 0 Continue
- * \retval non-zero Instruct Oggz to stop.
- */
-static int
-og_hungry (OGGZ * oggz, int empty, void * user_data)
-{
-  OMX_ERRORTYPE audio_rc = OMX_ErrorNone;
-  OMX_ERRORTYPE video_rc = OMX_ErrorNone;
-  int oggz_rc = OGGZ_ERR_STOP_ERR;
-  oggmuxflt_prc_t * p_prc = user_data;
-  assert (p_prc);
-  TIZ_DEBUG (handleOf (p_prc), "ogg queue is [%s]",
-             (empty == 0 ? "NOT EMPTY" : "EMPTY"));
-  audio_rc = audio_hungry (p_prc);
-  video_rc = video_hungry (p_prc);
-  if (OMX_ErrorNone == audio_rc || OMX_ErrorNone == video_rc)
-    {
-      oggz_rc = OGGZ_ERR_OK; /* this tells oggz to continue writing */
-    }
-  else if (OMX_ErrorNotReady == audio_rc && OMX_ErrorNotReady == video_rc)
-    {
-      if (tiz_filter_prc_is_eos (p_prc))
-        {
-          oggz_rc = OGGZ_ERR_EOS; /* this tells oggz to stop for now */
-        }
-      else
-        {
-          oggz_rc = OGGZ_ERR_STOP_OK; /* this tells oggz to stop for now */
-        }
-    }
-  else
-    {
-      oggz_rc = OGGZ_ERR_STOP_ERR; /* this tells oggz to stop permenently */
-    }
-  return oggz_rc;
-}
-
-static size_t
-og_io_write (void * ap_user_handle, void * ap_buf, size_t n)
-{
-  oggmuxflt_prc_t * p_prc = ap_user_handle;
-  ssize_t bytes_written = 0;
-
-  OGGMUXFLT_LOG_STATE (p_prc);
-
-  if (n > 0 && ap_buf)
-    {
-      OMX_BUFFERHEADERTYPE * p_hdr = p_hdr = get_out_hdr (p_prc);
-
-      assert (p_prc);
-
-      if (p_hdr)
-        {
-          bytes_written = MIN (n, TIZ_OMX_BUF_AVAIL (p_hdr));
-          (void) memcpy (TIZ_OMX_BUF_PTR (p_hdr) + p_hdr->nFilledLen, ap_buf,
-                         bytes_written);
-          p_hdr->nFilledLen += bytes_written;
-          TIZ_DEBUG (handleOf (p_prc), "bytes - n [%d] nFilledLen [%d]", n,
-                     p_hdr->nFilledLen);
-          if (0 == TIZ_OMX_BUF_AVAIL (p_hdr) || tiz_filter_prc_is_eos(p_prc))
-            {
-              release_output_header (p_prc, p_hdr);
-            }
-        }
-      else
-        {
-          TIZ_DEBUG (handleOf (p_prc), "No output headers available");
-        }
-    }
-  return bytes_written;
-}
-
-static int
-og_io_flush (void * ap_user_handle)
-{
-  return 0;
-}
-
 static OMX_ERRORTYPE
 alloc_oggz (oggmuxflt_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_prc);
 
-  /* Allocate the oggz object */
+  /* Allocate the oggz object. Pages are pulled straight into the output
+     buffers with oggz_write_output, so no io or 'hungry' callbacks are
+     needed. */
   tiz_check_null_ret_oom ((ap_prc->p_oggz_ = oggz_new (OGGZ_WRITE)));
 
   /* Obtain the serial numbers */
   ap_prc->oggz_audio_serialno_ = oggz_serialno_new (ap_prc->p_oggz_);
   ap_prc->oggz_video_serialno_ = oggz_serialno_new (ap_prc->p_oggz_);
+  oggmux_page_stream_reset (&ap_prc->audio_page_,
+                            ap_prc->oggz_audio_serialno_);
+  oggmux_page_stream_reset (&ap_prc->video_page_,
+                            ap_prc->oggz_video_serialno_);
 
-  /* Set the 'hungry' callback */
-  on_oggz_error_ret_omx_oom (
-    oggz_write_set_hungry_callback (ap_prc->p_oggz_, og_hungry, 1, ap_prc));
+  return rc;
+}
 
-  /* Set the io callbacks */
-  on_oggz_error_ret_omx_oom (
-    oggz_io_set_write (ap_prc->p_oggz_, og_io_write, ap_prc));
-  on_oggz_error_ret_omx_oom (
-    oggz_io_set_flush (ap_prc->p_oggz_, og_io_flush, ap_prc));
+static OMX_U32
+page_policy_value (const char * ap_key, const OMX_U32 a_default)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE * 2];
+  const char * p_value = NULL;
+  (void) snprintf (key, sizeof (key), "%s.%s",
+                   ARATELIA_OGG_MUXER_COMPONENT_NAME, ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  return p_value ? (OMX_U32) strtoul (p_value, NULL, 10) : a_default;
+}
 
-  return rc;
+static OMX_ERRORTYPE
+retrieve_video_frame_duration (oggmuxflt_prc_t * ap_prc)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_OGG_MUXER_FILTER_PORT_1_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                          OMX_IndexParamPortDefinition, &port_def));
+
+  /* xFramerate is Q16; with no frame rate, only the size limit applies */
+  ap_prc->video_frame_us_
+    = port_def.format.video.xFramerate > 0
+        ? (OMX_U32) (((OMX_U64) 1000000 << 16)
+                     / port_def.format.video.xFramerate)
+        : 0;
+  return OMX_ErrorNone;
 }
 
 static bool
@@ -503,38 +453,53 @@ mux_streams (oggmuxflt_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  long oggz_rc = OGGZ_ERR_OK;
-  while ((OGGZ_ERR_OK == oggz_rc) && (p_hdr = get_out_hdr (ap_prc)))
+
+  while (OMX_ErrorNone == rc && (p_hdr = get_out_hdr (ap_prc)))
     {
-      long n = MIN (32, TIZ_OMX_BUF_AVAIL (p_hdr));
-      oggz_rc = oggz_write (ap_prc->p_oggz_, n);
-      if (oggz_rc > 0)
-        {
-          oggz_rc = OGGZ_ERR_OK;
-          TIZ_DEBUG (handleOf (ap_prc), "OGGZ_ERR_OK written [%d]", oggz_rc);
-        }
-      else if (0 == oggz_rc)
-        {
-          /* eos */
-          rc = OMX_ErrorNotReady;
-          TIZ_DEBUG (handleOf (ap_prc), "eos, OMX_ErrorNotReady");
-        }
-      else if (OGGZ_ERR_STOP_OK == oggz_rc)
+      /* Completed pages go straight into the output buffer */
+      long n = oggz_write_output (ap_prc->p_oggz_,
+                                  TIZ_OMX_BUF_PTR (p_hdr) + p_hdr->nFilledLen,
+                                  TIZ_OMX_BUF_AVAIL (p_hdr));
+      if (n > 0)
         {
-          rc = OMX_ErrorNotReady;
-          TIZ_DEBUG (handleOf (ap_prc), "OGGZ_ERR_STOP_OK, OMX_ErrorNotReady");
+          p_hdr->nFilledLen += n;
+          TIZ_DEBUG (handleOf (ap_prc), "written [%ld] nFilledLen [%d]", n,
+                     p_hdr->nFilledLen);
+          if (0 == TIZ_OMX_BUF_AVAIL (p_hdr))
+            {
+              rc = tiz_filter_prc_release_header (
+                ap_prc, ARATELIA_OGG_MUXER_FILTER_PORT_2_INDEX);
+            }
         }
-      else if (OGGZ_ERR_STOP_ERR == oggz_rc)
+      else if (n < 0)
         {
+          TIZ_ERROR (handleOf (ap_prc),
+                     "[OMX_ErrorInsufficientResources] : oggz error (%ld)", n);
           rc = OMX_ErrorInsufficientResources;
-          TIZ_DEBUG (handleOf (ap_prc),
-                     "OGGZ_ERR_STOP_ERR, OMX_ErrorInsufficientResources");
         }
       else
         {
-          rc = OMX_ErrorInsufficientResources;
-          TIZ_DEBUG (handleOf (ap_prc),
-                     "OGGZ_ERR_?, OMX_ErrorInsufficientResources");
+          /* No complete pages left; queue more packets */
+          const OMX_ERRORTYPE audio_rc = feed_audio (ap_prc);
+          const OMX_ERRORTYPE video_rc = feed_video (ap_prc);
+          if (OMX_ErrorNotReady == audio_rc && OMX_ErrorNotReady == video_rc)
+            {
+              if (tiz_filter_prc_is_eos (ap_prc))
+                {
+                  /* The last page is out. If it exactly filled the previous
+                     buffer, this one goes out empty, just to carry the EOS
+                     flag downstream */
+                  rc = release_output_header (ap_prc, p_hdr);
+                }
+              rc = (OMX_ErrorNone == rc) ? OMX_ErrorNotReady : rc;
+            }
+          else
+            {
+              rc = (OMX_ErrorNone != audio_rc && OMX_ErrorNotReady != audio_rc)
+                     ? audio_rc
+                     : video_rc;
+              rc = (OMX_ErrorNotReady == rc) ? OMX_ErrorNone : rc;
+            }
         }
       OGGMUXFLT_LOG_STATE (ap_prc);
     }
@@ -558,6 +523,13 @@ oggmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->oggz_video_granulepos_ = 0;
   p_prc->oggz_audio_packetno_ = 0;
   p_prc->oggz_video_packetno_ = 0;
+  p_prc->page_policy_.page_size = page_policy_value (
+    "page_size", ARATELIA_OGG_MUXER_DEFAULT_PAGE_SIZE);
+  p_prc->page_policy_.page_duration_ms = page_policy_value (
+    "page_duration_ms", ARATELIA_OGG_MUXER_DEFAULT_PAGE_DURATION_MS);
+  oggmux_page_stream_reset (&p_prc->audio_page_, 0);
+  oggmux_page_stream_reset (&p_prc->video_page_, 0);
+  p_prc->video_frame_us_ = 0;
   reset_stream_parameters (p_prc);
   return p_prc;
 }
@@ -594,7 +566,12 @@ oggmuxflt_prc_deallocate_resources (void * ap_prc)
 static OMX_ERRORTYPE
 oggmuxflt_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  oggmuxflt_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  TIZ_TRACE (handleOf (p_prc), "page size [%d] page duration [%d] ms",
+             p_prc->page_policy_.page_size,
+             p_prc->page_policy_.page_duration_ms);
+  return retrieve_video_frame_duration (p_prc);
 }
 
 static OMX_ERRORTYPE
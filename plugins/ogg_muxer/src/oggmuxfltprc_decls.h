@@ -43,6 +43,8 @@ extern "C" {
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
 
+#include "oggmuxpage.h"
+
 typedef struct oggmuxflt_prc oggmuxflt_prc_t;
 struct oggmuxflt_prc
 {
@@ -55,6 +57,10 @@ struct oggmuxflt_prc
   long oggz_video_granulepos_;
   long oggz_audio_packetno_;
   long oggz_video_packetno_;
+  oggmux_page_policy_t page_policy_;
+  oggmux_page_stream_t audio_page_;
+  oggmux_page_stream_t video_page_;
+  OMX_U32 video_frame_us_;
 };
 
 typedef struct oggmuxflt_prc_class oggmuxflt_prc_class_t;
@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   oggmuxpage.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Ogg muxer - page fill policy
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+
+#include "oggmuxpage.h"
+
+/* The longest Opus packet is 120 ms */
+#define OGGMUX_OPUS_MAX_PACKET_SAMPLES 5760
+
+void
+oggmux_page_stream_reset (oggmux_page_stream_t * ap_stream,
+                          const long a_serialno)
+{
+  assert (ap_stream);
+  ap_stream->serialno = a_serialno;
+  ap_stream->bytes = 0;
+  ap_stream->duration_us = 0;
+}
+
+int
+oggmux_page_feed (OGGZ * ap_oggz, oggmux_page_stream_t * ap_stream,
+                  const oggmux_page_policy_t * ap_policy, ogg_packet * ap_op,
+                  const OMX_U32 a_duration_us, const bool a_close)
+{
+  bool close = a_close;
+  int rc = 0;
+
+  assert (ap_oggz);
+  assert (ap_stream);
+  assert (ap_policy);
+  assert (ap_op);
+
+  ap_stream->bytes += ap_op->bytes;
+  ap_stream->duration_us += a_duration_us;
+
+  /* Headers go on pages of their own and the last page is not held back */
+  close = close || ap_op->b_o_s || ap_op->e_o_s || 0 == ap_policy->page_size
+          || ap_stream->bytes >= ap_policy->page_size
+          || (ap_policy->page_duration_ms > 0
+              && ap_stream->duration_us
+                   >= (OMX_U64) ap_policy->page_duration_ms * 1000);
+
+  rc = oggz_write_feed (ap_oggz, ap_op, ap_stream->serialno,
+                        close ? OGGZ_FLUSH_AFTER : 0, NULL);
+
+  if (close)
+    {
+      ap_stream->bytes = 0;
+      ap_stream->duration_us = 0;
+    }
+
+  return rc;
+}
+
+OMX_U32
+oggmux_opus_packet_samples (const OMX_U8 * ap_data, const OMX_U32 a_len)
+{
+  /* Frame sizes per configuration, at 48 kHz: SILK (0-11), Hybrid (12-15)
+     and CELT (16-31) */
+  static const OMX_U32 silk_sizes[] = {480, 960, 1920, 2880};
+  static const OMX_U32 hybrid_sizes[] = {480, 960};
+  static const OMX_U32 celt_sizes[] = {120, 240, 480, 960};
+  OMX_U32 config = 0;
+  OMX_U32 frame_size = 0;
+  OMX_U32 frames = 0;
+
+  if (!ap_data || 0 == a_len)
+    {
+      return 0;
+    }
+
+  config = ap_data[0] >> 3;
+  frame_size = config < 12 ? silk_sizes[config & 3]
+                           : (config < 16 ? hybrid_sizes[config & 1]
+                                          : celt_sizes[config & 3]);
+
+  switch (ap_data[0] & 3)
+    {
+      case 0:
+        {
+          frames = 1;
+        }
+        break;
+      case 1:
+      case 2:
+        {
+          frames = 2;
+        }
+        break;
+      default:
+        {
+          /* Code 3: the frame count is in the second byte */
+          frames = a_len > 1 ? (ap_data[1] & 0x3F) : 0;
+        }
+        break;
+    };
+
+  return frames * frame_size <= OGGMUX_OPUS_MAX_PACKET_SAMPLES
+           ? frames * frame_size
+           : 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   oggmuxpage.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Ogg muxer - page fill policy
+ *
+ * Packets are fed to oggz without a flush request, so that several packets
+ * share a page, until the page being filled reaches a target size or a
+ * maximum duration. Stream headers and the last packet always close their
+ * page. Note that libogg closes pages at about 4 KB regardless, so larger
+ * targets behave like 4 KB.
+ *
+ */
+
+#ifndef OGGMUXPAGE_H
+#define OGGMUXPAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <oggz/oggz.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct oggmux_page_policy oggmux_page_policy_t;
+struct oggmux_page_policy
+{
+  /* Close a page once it holds this many bytes; 0: one packet per page */
+  OMX_U32 page_size;
+  /* ... or this much media time, in milliseconds; 0: no limit */
+  OMX_U32 page_duration_ms;
+};
+
+typedef struct oggmux_page_stream oggmux_page_stream_t;
+struct oggmux_page_stream
+{
+  long serialno;
+  /* Contents of the page being filled */
+  OMX_U32 bytes;
+  OMX_U64 duration_us;
+};
+
+void
+oggmux_page_stream_reset (oggmux_page_stream_t * ap_stream,
+                          const long a_serialno);
+
+/**
+ * Queue a packet on oggz, closing the page when the policy says so, or when
+ * a_close is set. a_duration_us is the packet's duration (0 if unknown).
+ * Returns an oggz error code.
+ */
+int
+oggmux_page_feed (OGGZ * ap_oggz, oggmux_page_stream_t * ap_stream,
+                  const oggmux_page_policy_t * ap_policy, ogg_packet * ap_op,
+                  const OMX_U32 a_duration_us, const bool a_close);
+
+/**
+ * Number of 48 kHz samples in an Opus packet, from its TOC byte (RFC 6716,
+ * section 3.1); 0 if the packet is malformed.
+ */
+OMX_U32
+oggmux_opus_packet_samples (const OMX_U8 * ap_data, const OMX_U32 a_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OGGMUXPAGE_H */
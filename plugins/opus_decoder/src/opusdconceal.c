@@ -0,0 +1,169 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opusdconceal.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus decoder - lost packet concealment
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "opusdconceal.h"
+
+static int
+round_to_quantum (const int a_frames)
+{
+  return a_frames - (a_frames % OPUSD_CONCEAL_QUANTUM);
+}
+
+int
+opusd_conceal (OpusMSDecoder * ap_dec, int * ap_lost,
+               const unsigned char * ap_next, const opus_int32 a_next_len,
+               float * ap_pcm, const int a_max_frames, bool * ap_used_fec)
+{
+  int next_frames = 0;
+  int chunk = 0;
+  int rc = 0;
+
+  assert (ap_dec);
+  assert (ap_lost);
+  assert (ap_pcm);
+  assert (ap_used_fec);
+
+  *ap_used_fec = false;
+
+  if (ap_next && a_next_len > 0)
+    {
+      next_frames
+        = opus_packet_get_nb_samples (ap_next, a_next_len, OPUSD_CONCEAL_RATE);
+      if (next_frames < 0)
+        {
+          /* The next packet is unusable; conceal only */
+          next_frames = 0;
+        }
+    }
+
+  if (next_frames > 0 && *ap_lost <= next_frames && *ap_lost <= a_max_frames)
+    {
+      /* The tail of the gap: the next packet may carry it */
+      chunk = round_to_quantum (*ap_lost);
+      *ap_used_fec = true;
+    }
+  else
+    {
+      /* Leave the tail of the gap for FEC */
+      const int plc_frames = next_frames > 0 && *ap_lost > next_frames
+                               ? *ap_lost - next_frames
+                               : *ap_lost;
+      chunk = round_to_quantum (plc_frames < a_max_frames ? plc_frames
+                                                          : a_max_frames);
+    }
+
+  if (chunk <= 0)
+    {
+      /* Less than a quantum is left; drop it */
+      *ap_lost = 0;
+      return 0;
+    }
+
+  rc = *ap_used_fec
+         ? opus_multistream_decode_float (ap_dec, ap_next, a_next_len, ap_pcm,
+                                          chunk, 1)
+         : opus_multistream_decode_float (ap_dec, NULL, 0, ap_pcm, chunk, 0);
+
+  if (rc < 0)
+    {
+      *ap_lost = 0;
+      return rc;
+    }
+
+  *ap_lost = *ap_used_fec ? 0 : *ap_lost - chunk;
+  return rc;
+}
+
+int
+opusd_conceal_gap_frames (const opus_int64 a_gap_us)
+{
+  int frames = 0;
+  if (a_gap_us <= 0 || a_gap_us > (opus_int64) OPUSD_CONCEAL_MAX_MS * 1000)
+    {
+      return 0;
+    }
+  frames = (int) ((a_gap_us * OPUSD_CONCEAL_RATE + 500000) / 1000000);
+  return round_to_quantum (frames);
+}
+
+void
+opusd_conceal_clock_reset (opusd_conceal_clock_t * ap_clock)
+{
+  assert (ap_clock);
+  ap_clock->next_us = 0;
+  ap_clock->next_valid = false;
+  ap_clock->reliable = false;
+}
+
+int
+opusd_conceal_clock_gap (opusd_conceal_clock_t * ap_clock,
+                         const opus_int64 a_ts_us)
+{
+  const opus_int64 tolerance = 1000000 / 400 / 2; /* half a quantum */
+  opus_int64 delta = 0;
+
+  assert (ap_clock);
+
+  if (!ap_clock->next_valid)
+    {
+      return 0;
+    }
+
+  delta = a_ts_us - ap_clock->next_us;
+  if (!ap_clock->reliable)
+    {
+      ap_clock->reliable = (delta > -tolerance && delta < tolerance);
+      return 0;
+    }
+
+  if (delta < tolerance)
+    {
+      return 0;
+    }
+
+  /* The packet is where the stream continues once the gap is filled */
+  ap_clock->next_us = a_ts_us;
+  return opusd_conceal_gap_frames (delta);
+}
+
+void
+opusd_conceal_clock_advance (opusd_conceal_clock_t * ap_clock,
+                             const opus_int64 a_ts_us, const int a_frames)
+{
+  assert (ap_clock);
+  ap_clock->next_us
+    = a_ts_us + ((opus_int64) a_frames * 1000000) / OPUSD_CONCEAL_RATE;
+  ap_clock->next_valid = true;
+}
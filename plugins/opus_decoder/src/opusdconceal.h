@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opusdconceal.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus decoder - lost packet concealment
+ *
+ * Audio missing from the stream is synthesised by the decoder itself: the
+ * part of the gap that ends where the next packet starts is recovered from
+ * the redundancy (LBRR) that the encoder may have embedded in that packet
+ * (in-band FEC); the rest is filled by the decoder's packet-loss concealment.
+ * Without LBRR data, FEC decoding falls back to concealment too.
+ *
+ */
+
+#ifndef OPUSDCONCEAL_H
+#define OPUSDCONCEAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <opus.h>
+#include <opus_multistream.h>
+
+/* The decoder always runs at 48 kHz */
+#define OPUSD_CONCEAL_RATE 48000
+/* Concealed chunks are multiples of the shortest Opus frame (2.5 ms) */
+#define OPUSD_CONCEAL_QUANTUM (OPUSD_CONCEAL_RATE / 400)
+/* Longer gaps are treated as discontinuities, not concealed */
+#define OPUSD_CONCEAL_MAX_MS 1000
+
+/**
+ * Synthesise up to a_max_frames frames of the *ap_lost frames missing before
+ * the packet ap_next (NULL if it has not arrived yet, e.g. at EOS) into
+ * ap_pcm, and decrement *ap_lost accordingly. Call repeatedly until *ap_lost
+ * is zero, then decode ap_next normally. *ap_used_fec tells whether the chunk
+ * was recovered with in-band FEC. Returns the number of frames produced, or a
+ * negative libopus error code.
+ */
+int
+opusd_conceal (OpusMSDecoder * ap_dec, int * ap_lost,
+               const unsigned char * ap_next, const opus_int32 a_next_len,
+               float * ap_pcm, const int a_max_frames, bool * ap_used_fec);
+
+/**
+ * Number of frames (at 48 kHz) needed to cover a gap of a_gap_us
+ * microseconds, rounded to the concealment quantum; 0 if the gap is too
+ * short or too long to conceal.
+ */
+int
+opusd_conceal_gap_frames (const opus_int64 a_gap_us);
+
+/* Sources that timestamp every packet reveal gaps in the stream. Timestamps
+   are only trusted once two consecutive packets agree with each other. */
+typedef struct opusd_conceal_clock opusd_conceal_clock_t;
+struct opusd_conceal_clock
+{
+  opus_int64 next_us; /* where the next packet is expected */
+  bool next_valid;
+  bool reliable;
+};
+
+/**
+ * Forget everything known about the stream's timestamps.
+ */
+void
+opusd_conceal_clock_reset (opusd_conceal_clock_t * ap_clock);
+
+/**
+ * Number of frames missing before a packet stamped a_ts_us, or 0 if there is
+ * no gap (or no way to tell yet). The gap is accounted for once reported:
+ * asking again about the same packet, e.g. while the gap is being concealed,
+ * returns 0.
+ */
+int
+opusd_conceal_clock_gap (opusd_conceal_clock_t * ap_clock,
+                         const opus_int64 a_ts_us);
+
+/**
+ * A packet stamped a_ts_us with a_frames frames has been decoded.
+ */
+void
+opusd_conceal_clock_advance (opusd_conceal_clock_t * ap_clock,
+                             const opus_int64 a_ts_us, const int a_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OPUSDCONCEAL_H */
@@ -0,0 +1,537 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   opusdlosssim.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Opus decoder - packet loss simulator
+ *
+ * Decodes a packet stream, drops packets from it and conceals the losses the
+ * way the decoder component does, once with in-band FEC and once with packet
+ * loss concealment only. The output is compared with a decode of the
+ * complete stream. The losses are either flagged, like packets a source
+ * knows to be missing, or (with -g) silent, and only revealed by the
+ * timestamp of the next packet; in that case every gap must be concealed
+ * with exactly the frames that went missing. The packet stream is either
+ * encoded on the fly from a test signal (with FEC enabled) or read from a
+ * file recorded with -w.
+ *
+ * Recorded stream format: "OPKT", channels, streams, coupled streams and the
+ * channel mapping (one byte each), then every packet as a 16-bit little
+ * endian length followed by the packet data.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "opusd.h"
+#include "opusdconceal.h"
+
+#define SIM_FRAME_SIZE 960 /* 20 ms */
+#define SIM_MAX_PACKET 1500
+#define SIM_MAX_CHANNELS 8
+
+typedef struct sim_stream sim_stream_t;
+struct sim_stream
+{
+  int channels;
+  int streams;
+  int coupled;
+  unsigned char mapping[SIM_MAX_CHANNELS];
+  unsigned char ** pp_packets;
+  int * p_lens;
+  int count;
+};
+
+typedef struct sim_pcm sim_pcm_t;
+struct sim_pcm
+{
+  float * p_data;
+  size_t frames;
+  size_t cap;
+  int channels;
+};
+
+static uint32_t sim_seed = 1;
+
+static uint32_t
+sim_rand (void)
+{
+  sim_seed = sim_seed * 1664525u + 1013904223u;
+  return sim_seed >> 8;
+}
+
+static bool
+add_packet (sim_stream_t * ap_st, const unsigned char * ap_data,
+            const int a_len)
+{
+  unsigned char ** pp_packets = NULL;
+  int * p_lens = NULL;
+  if (!(pp_packets = realloc (ap_st->pp_packets,
+                              (ap_st->count + 1) * sizeof (unsigned char *)))
+      || !(ap_st->pp_packets = pp_packets,
+           p_lens = realloc (ap_st->p_lens, (ap_st->count + 1) * sizeof (int)))
+      || !(ap_st->p_lens = p_lens,
+           ap_st->pp_packets[ap_st->count] = malloc ((size_t) a_len)))
+    {
+      return false;
+    }
+  memcpy (ap_st->pp_packets[ap_st->count], ap_data, (size_t) a_len);
+  ap_st->p_lens[ap_st->count++] = a_len;
+  return true;
+}
+
+static bool
+encode_test_signal (sim_stream_t * ap_st, const int a_channels,
+                    const double a_secs)
+{
+  float pcm[SIM_FRAME_SIZE * SIM_MAX_CHANNELS];
+  unsigned char packet[SIM_MAX_PACKET];
+  OpusMSEncoder * p_enc = NULL;
+  const int nframes = (int) (a_secs * OPUSD_CONCEAL_RATE / SIM_FRAME_SIZE);
+  long n = 0;
+  int err = 0;
+  int f = 0;
+  int i = 0;
+  int c = 0;
+
+  ap_st->channels = a_channels;
+  p_enc = opus_multistream_surround_encoder_create (
+    OPUSD_CONCEAL_RATE, a_channels, a_channels > 2 ? 1 : 0, &ap_st->streams,
+    &ap_st->coupled, ap_st->mapping, OPUS_APPLICATION_AUDIO, &err);
+  if (!p_enc || OPUS_OK != err)
+    {
+      fprintf (stderr, "opusdlosssim: encoder : %s\n", opus_strerror (err));
+      return false;
+    }
+
+  (void) opus_multistream_encoder_ctl (p_enc, OPUS_SET_INBAND_FEC (1));
+  (void) opus_multistream_encoder_ctl (p_enc, OPUS_SET_PACKET_LOSS_PERC (20));
+
+  for (f = 0; f < nframes; ++f)
+    {
+      for (i = 0; i < SIM_FRAME_SIZE; ++i, ++n)
+        {
+          for (c = 0; c < a_channels; ++c)
+            {
+              /* A slow glide per channel, so that concealment has to guess */
+              const double hz = 220.0 * (c + 1) + 110.0 * sin (n / 24000.0);
+              pcm[i * a_channels + c] = (float) (
+                0.3 * sin (2.0 * M_PI * hz * n / OPUSD_CONCEAL_RATE));
+            }
+        }
+      err = opus_multistream_encode_float (p_enc, pcm, SIM_FRAME_SIZE, packet,
+                                           SIM_MAX_PACKET);
+      if (err < 0 || !add_packet (ap_st, packet, err))
+        {
+          opus_multistream_encoder_destroy (p_enc);
+          return false;
+        }
+    }
+
+  opus_multistream_encoder_destroy (p_enc);
+  return true;
+}
+
+static bool
+read_stream (sim_stream_t * ap_st, const char * ap_path)
+{
+  unsigned char hdr[7];
+  unsigned char packet[65536];
+  bool rc = false;
+  FILE * p_file = fopen (ap_path, "rb");
+
+  if (p_file && 7 == fread (hdr, 1, 7, p_file) && 0 == memcmp (hdr, "OPKT", 4)
+      && hdr[4] > 0 && hdr[4] <= SIM_MAX_CHANNELS)
+    {
+      ap_st->channels = hdr[4];
+      ap_st->streams = hdr[5];
+      ap_st->coupled = hdr[6];
+      rc = ((size_t) ap_st->channels
+            == fread (ap_st->mapping, 1, ap_st->channels, p_file));
+      while (rc && 2 == fread (hdr, 1, 2, p_file))
+        {
+          const int len = hdr[0] | (hdr[1] << 8);
+          rc = ((size_t) len == fread (packet, 1, len, p_file))
+               && add_packet (ap_st, packet, len);
+        }
+    }
+  if (p_file)
+    {
+      fclose (p_file);
+    }
+  return rc && ap_st->count > 0;
+}
+
+static bool
+write_stream (const sim_stream_t * ap_st, const char * ap_path)
+{
+  unsigned char hdr[7] = {'O', 'P', 'K', 'T'};
+  bool rc = false;
+  int i = 0;
+  FILE * p_file = fopen (ap_path, "wb");
+
+  if (p_file)
+    {
+      hdr[4] = (unsigned char) ap_st->channels;
+      hdr[5] = (unsigned char) ap_st->streams;
+      hdr[6] = (unsigned char) ap_st->coupled;
+      rc = (7 == fwrite (hdr, 1, 7, p_file))
+           && ((size_t) ap_st->channels
+               == fwrite (ap_st->mapping, 1, ap_st->channels, p_file));
+      for (i = 0; i < ap_st->count && rc; ++i)
+        {
+          hdr[0] = ap_st->p_lens[i] & 0xff;
+          hdr[1] = (ap_st->p_lens[i] >> 8) & 0xff;
+          rc = (2 == fwrite (hdr, 1, 2, p_file))
+               && ((size_t) ap_st->p_lens[i]
+                   == fwrite (ap_st->pp_packets[i], 1, ap_st->p_lens[i],
+                              p_file));
+        }
+      rc = (0 == fclose (p_file)) && rc;
+    }
+  return rc;
+}
+
+static bool
+append_pcm (sim_pcm_t * ap_pcm, const float * ap_data, const int a_frames)
+{
+  if (ap_pcm->frames + a_frames > ap_pcm->cap)
+    {
+      const size_t cap = (ap_pcm->cap + a_frames) * 2;
+      float * p_data
+        = realloc (ap_pcm->p_data, cap * ap_pcm->channels * sizeof (float));
+      if (!p_data)
+        {
+          return false;
+        }
+      ap_pcm->p_data = p_data;
+      ap_pcm->cap = cap;
+    }
+  memcpy (ap_pcm->p_data + ap_pcm->frames * ap_pcm->channels, ap_data,
+          (size_t) a_frames * ap_pcm->channels * sizeof (float));
+  ap_pcm->frames += a_frames;
+  return true;
+}
+
+/* Mirrors the decoder component: a flagged loss adds the duration of the
+   last decoded packet to the gap, a silent one is found from the next
+   packet's timestamp, and the gap is filled before that packet is decoded.
+   Like the component, the timestamp is looked at again every time a chunk of
+   the gap has been concealed. */
+static bool
+decode_stream (const sim_stream_t * ap_st, const bool * ap_dropped,
+               const bool a_use_fec, const bool a_stamped, sim_pcm_t * ap_out,
+               int * ap_plc, int * ap_fec)
+{
+  float * p_buf = malloc ((size_t) OPUS_MAX_FRAME_SIZE * ap_st->channels
+                          * sizeof (float));
+  OpusMSDecoder * p_dec = NULL;
+  opusd_conceal_clock_t clock;
+  opus_int64 ts = 0; /* of the next packet, in microseconds */
+  int last_frame_size = SIM_FRAME_SIZE;
+  int lost = 0;
+  int err = 0;
+  int i = 0;
+
+  opusd_conceal_clock_reset (&clock);
+
+  p_dec = opus_multistream_decoder_create (OPUSD_CONCEAL_RATE, ap_st->channels,
+                                           ap_st->streams, ap_st->coupled,
+                                           ap_st->mapping, &err);
+  if (!p_buf || !p_dec || OPUS_OK != err)
+    {
+      free (p_buf);
+      return false;
+    }
+
+  ap_out->channels = ap_st->channels;
+  for (i = 0; i <= ap_st->count && err >= 0; ++i)
+    {
+      const bool at_end = (i == ap_st->count);
+      const unsigned char * p_next = at_end ? NULL : ap_st->pp_packets[i];
+      const int next_len = at_end ? 0 : ap_st->p_lens[i];
+      const opus_int64 next_ts = ts;
+      int concealed = 0;
+
+      if (!at_end)
+        {
+          ts += (opus_int64) opus_packet_get_nb_samples (p_next, next_len,
+                                                         OPUSD_CONCEAL_RATE)
+                * 1000000 / OPUSD_CONCEAL_RATE;
+        }
+
+      if (!at_end && ap_dropped && ap_dropped[i])
+        {
+          lost += a_stamped ? 0 : last_frame_size;
+          continue;
+        }
+
+      while (err >= 0)
+        {
+          bool used_fec = false;
+          if (a_stamped && !at_end)
+            {
+              lost += opusd_conceal_clock_gap (&clock, next_ts);
+            }
+          if (lost <= 0)
+            {
+              break;
+            }
+          if (concealed > OPUSD_CONCEAL_RATE * OPUSD_CONCEAL_MAX_MS / 1000)
+            {
+              fprintf (stderr, "opusdlosssim: gap before packet %d keeps "
+                       "growing\n", i);
+              err = -1;
+              break;
+            }
+          err = opusd_conceal (p_dec, &lost, a_use_fec ? p_next : NULL,
+                               next_len, p_buf, OPUS_MAX_FRAME_SIZE,
+                               &used_fec);
+          if (err > 0)
+            {
+              *(used_fec ? ap_fec : ap_plc) += 1;
+              concealed += err;
+              err = append_pcm (ap_out, p_buf, err) ? err : -1;
+            }
+        }
+
+      if (!at_end && err >= 0)
+        {
+          err = opus_multistream_decode_float (p_dec, p_next, next_len, p_buf,
+                                               OPUS_MAX_FRAME_SIZE, 0);
+          if (err > 0)
+            {
+              last_frame_size = err;
+              opusd_conceal_clock_advance (&clock, next_ts, err);
+              err = append_pcm (ap_out, p_buf, err) ? err : -1;
+            }
+        }
+    }
+
+  opus_multistream_decoder_destroy (p_dec);
+  free (p_buf);
+  return err >= 0;
+}
+
+static double
+snr_db (const sim_pcm_t * ap_ref, const sim_pcm_t * ap_out)
+{
+  const size_t n = (ap_ref->frames < ap_out->frames ? ap_ref->frames
+                                                    : ap_out->frames)
+                   * ap_ref->channels;
+  double signal = 0.0;
+  double noise = 0.0;
+  size_t i = 0;
+  for (i = 0; i < n; ++i)
+    {
+      const double err = ap_out->p_data[i] - ap_ref->p_data[i];
+      signal += (double) ap_ref->p_data[i] * ap_ref->p_data[i];
+      noise += err * err;
+    }
+  return noise > 0.0 ? 10.0 * log10 (signal / noise) : 999.0;
+}
+
+static int
+run (const sim_stream_t * ap_st, const sim_pcm_t * ap_ref,
+     const double a_loss_pct, const int a_burst, const bool a_stamped)
+{
+  bool * p_dropped = calloc ((size_t) ap_st->count, sizeof (bool));
+  /* Never drop the first packet: there is nothing to conceal from yet. A
+     silent loss is only found once the timestamps are trusted, after the
+     first two packets, and only if a packet follows it. */
+  const int first = a_stamped ? 2 : 1;
+  const int end = a_stamped ? ap_st->count - 1 : ap_st->count;
+  int rc = EXIT_SUCCESS;
+  int dropped = 0;
+  int i = 0;
+  int mode = 0;
+
+  if (!p_dropped)
+    {
+      return EXIT_FAILURE;
+    }
+
+  for (i = first; i < end; ++i)
+    {
+      if ((sim_rand () % 10000) < a_loss_pct * 100.0 / a_burst)
+        {
+          int b = 0;
+          for (b = 0; b < a_burst && i < end; ++b, ++i)
+            {
+              p_dropped[i] = true;
+              dropped++;
+            }
+        }
+    }
+
+  for (mode = 0; mode < 2; ++mode)
+    {
+      sim_pcm_t out = {NULL, 0, 0, 0};
+      int plc = 0;
+      int fec = 0;
+      if (!decode_stream (ap_st, p_dropped, 0 == mode, a_stamped, &out, &plc,
+                          &fec))
+        {
+          fprintf (stderr, "opusdlosssim: decoding failed\n");
+          free (out.p_data);
+          free (p_dropped);
+          return EXIT_FAILURE;
+        }
+      printf ("loss %5.1f%% burst %d  %-8s  dropped %5d/%d  plc %5d  fec %5d  "
+              "frames %s  SNR %6.2f dB\n",
+              a_loss_pct, a_burst, 0 == mode ? "fec+plc" : "plc", dropped,
+              ap_st->count, plc, fec,
+              out.frames == ap_ref->frames ? "ok" : "MISMATCH",
+              snr_db (ap_ref, &out));
+      if (a_stamped && out.frames != ap_ref->frames)
+        {
+          /* Timestamps give the exact size of every gap */
+          rc = EXIT_FAILURE;
+        }
+      free (out.p_data);
+    }
+
+  free (p_dropped);
+  return rc;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr,
+           "Usage: %s [-c channels] [-s seconds] [-l loss-percent] "
+           "[-b burst] [-g] [-r seed] [-i stream] [-w stream]\n",
+           ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  static const double default_losses[] = {1.0, 5.0, 10.0, 20.0};
+  sim_stream_t st;
+  sim_pcm_t ref = {NULL, 0, 0, 0};
+  const char * p_in = NULL;
+  const char * p_out = NULL;
+  double loss = -1.0;
+  double secs = 20.0;
+  int channels = 2;
+  int burst = 1;
+  bool stamped = false;
+  int plc = 0;
+  int fec = 0;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+  int i = 0;
+
+  memset (&st, 0, sizeof (st));
+
+  while ((opt = getopt (argc, argv, "c:s:l:b:gr:i:w:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'c':
+            channels = atoi (optarg);
+            break;
+          case 's':
+            secs = strtod (optarg, NULL);
+            break;
+          case 'l':
+            loss = strtod (optarg, NULL);
+            break;
+          case 'b':
+            burst = atoi (optarg);
+            break;
+          case 'g':
+            stamped = true;
+            break;
+          case 'r':
+            sim_seed = (uint32_t) strtoul (optarg, NULL, 10);
+            break;
+          case 'i':
+            p_in = optarg;
+            break;
+          case 'w':
+            p_out = optarg;
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (channels < 1 || channels > SIM_MAX_CHANNELS || secs <= 0.0 || burst < 1
+      || loss > 100.0)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (p_in ? !read_stream (&st, p_in)
+           : !encode_test_signal (&st, channels, secs))
+    {
+      fprintf (stderr, "opusdlosssim: no packet stream\n");
+      return EXIT_FAILURE;
+    }
+
+  if (p_out && !write_stream (&st, p_out))
+    {
+      fprintf (stderr, "opusdlosssim: unable to write %s\n", p_out);
+      rc = EXIT_FAILURE;
+    }
+
+  if (EXIT_SUCCESS == rc
+      && !decode_stream (&st, NULL, true, false, &ref, &plc, &fec))
+    {
+      fprintf (stderr, "opusdlosssim: unable to decode the stream\n");
+      rc = EXIT_FAILURE;
+    }
+
+  printf ("%d packets, %d channels (%d streams, %d coupled)\n", st.count,
+          st.channels, st.streams, st.coupled);
+
+  for (i = 0; EXIT_SUCCESS == rc && i < 4; ++i)
+    {
+      if (loss < 0.0 || 0 == i)
+        {
+          rc = run (&st, &ref, loss < 0.0 ? default_losses[i] : loss, burst,
+                    stamped);
+        }
+    }
+
+  for (i = 0; i < st.count; ++i)
+    {
+      free (st.pp_packets[i]);
+    }
+  free (st.pp_packets);
+  free (st.p_lens);
+  free (ref.p_data);
+  return rc;
+}
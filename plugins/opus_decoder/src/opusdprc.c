@@ -41,6 +41,7 @@
 
 #include "opusd.h"
 #include "opusutils.h"
+#include "opusdconceal.h"
 #include "opusdprc.h"
 #include "opusdprc_decls.h"
 
@@ -153,12 +154,13 @@ release_header (opusd_prc_t * ap_prc, const OMX_U32 a_pid)
 }
 
 static inline bool
-headers_available (opusd_prc_t * ap_prc)
+may_transform (opusd_prc_t * ap_prc)
 {
-  bool rc = true;
-  rc &= (NULL != get_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
-  rc &= (NULL != get_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX));
-  return rc;
+  /* Decoded frames may still be waiting for an output buffer */
+  return (NULL != get_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX))
+         && (ap_prc->out_frames_ > 0 || ap_prc->eos_pending_
+             || NULL != get_header (ap_prc,
+                                    ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
 }
 
 static OMX_ERRORTYPE
@@ -233,6 +235,39 @@ store_stream_metadata (opusd_prc_t * ap_prc)
                               NULL);
 }
 
+/* Channel order of mapping families 0 and 1 (the Vorbis order) */
+static void
+set_channel_mapping (OMX_AUDIO_PARAM_PCMMODETYPE * ap_pcmmode)
+{
+  static const OMX_AUDIO_CHANNELTYPE vorbis_order[8][8] = {
+    {OMX_AUDIO_ChannelCF},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelRF, OMX_AUDIO_ChannelLR,
+     OMX_AUDIO_ChannelRR},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+     OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+     OMX_AUDIO_ChannelLR, OMX_AUDIO_ChannelRR, OMX_AUDIO_ChannelLFE},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+     OMX_AUDIO_ChannelLS, OMX_AUDIO_ChannelRS, OMX_AUDIO_ChannelCS,
+     OMX_AUDIO_ChannelLFE},
+    {OMX_AUDIO_ChannelLF, OMX_AUDIO_ChannelCF, OMX_AUDIO_ChannelRF,
+     OMX_AUDIO_ChannelLS, OMX_AUDIO_ChannelRS, OMX_AUDIO_ChannelLR,
+     OMX_AUDIO_ChannelRR, OMX_AUDIO_ChannelLFE}};
+  OMX_U32 i = 0;
+
+  assert (ap_pcmmode);
+
+  for (i = 0; i < OMX_AUDIO_MAXCHANNELS; ++i)
+    {
+      ap_pcmmode->eChannelMapping[i]
+        = (ap_pcmmode->nChannels <= 8 && i < ap_pcmmode->nChannels)
+            ? vorbis_order[ap_pcmmode->nChannels - 1][i]
+            : OMX_AUDIO_ChannelNone;
+    }
+}
+
 static OMX_ERRORTYPE
 update_pcm_mode (opusd_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  const OMX_U32 a_channels)
@@ -249,6 +284,10 @@ update_pcm_mode (opusd_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  ap_prc->pcmmode_.nChannels, a_channels);
       ap_prc->pcmmode_.nSamplingRate = a_samplerate;
       ap_prc->pcmmode_.nChannels = a_channels;
+      if (ap_prc->mapping_family_ <= 1)
+        {
+          set_channel_mapping (&(ap_prc->pcmmode_));
+        }
       tiz_check_omx (tiz_krn_SetParameter_internal (
         tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
         OMX_IndexParamAudioPcm, &(ap_prc->pcmmode_)));
@@ -262,6 +301,51 @@ update_pcm_mode (opusd_prc_t * ap_prc, const OMX_U32 a_samplerate,
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+allocate_output_buffer (opusd_prc_t * ap_prc)
+{
+  size_t len = 0;
+  assert (ap_prc);
+  len = (size_t) OPUS_MAX_FRAME_SIZE
+        * (ap_prc->channels_ > 2 ? ap_prc->channels_ : 2);
+  if (!ap_prc->p_out_buf_ || ap_prc->out_buf_len_ < len)
+    {
+      tiz_mem_free (ap_prc->p_out_buf_);
+      ap_prc->out_buf_len_ = 0;
+      if (!(ap_prc->p_out_buf_ = tiz_mem_calloc (len, sizeof (float))))
+        {
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_prc->out_buf_len_ = len;
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+deallocate_output_buffer (opusd_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_out_buf_)
+    {
+      tiz_mem_free (ap_prc->p_out_buf_);
+      ap_prc->p_out_buf_ = NULL;
+      ap_prc->out_buf_len_ = 0;
+    }
+}
+
+static void
+reset_output_buffer (opusd_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->out_frames_ = 0;
+  ap_prc->out_offset_ = 0;
+  if (ap_prc->p_out_buf_)
+    {
+      tiz_mem_set (ap_prc->p_out_buf_, 0,
+                   sizeof (float) * ap_prc->out_buf_len_);
+    }
+}
+
 static OMX_ERRORTYPE
 init_opus_decoder (opusd_prc_t * ap_prc)
 {
@@ -316,6 +400,9 @@ init_opus_decoder (opusd_prc_t * ap_prc)
                ap_prc->rate_, ap_prc->mapping_family_, ap_prc->channels_,
                ap_prc->preskip_, gain, streams);
 
+    /* Room for the longest Opus frame, whatever the number of channels */
+    tiz_check_omx (allocate_output_buffer (ap_prc));
+
     store_stream_metadata (ap_prc);
     (void) update_pcm_mode (ap_prc, ap_prc->rate_, ap_prc->channels_);
 
@@ -383,133 +470,244 @@ release_headers (opusd_prc_t * ap_prc, const OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+static bool
+is_lost_packet (const OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_hdr);
+  /* Sources flag packets they know to be damaged or missing */
+  return (ap_hdr->nFlags & OMX_BUFFERFLAG_DATACORRUPT) > 0;
+}
+
+/* This runs every time the header comes around, including while the gap
+   in front of it is being concealed; the clock reports a gap only once */
+static void
+detect_timestamp_gap (opusd_prc_t * ap_prc,
+                      const OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  if ((ap_hdr->nFlags & OMX_BUFFERFLAG_TIMESTAMPINVALID) > 0)
+    {
+      opusd_conceal_clock_reset (&(ap_prc->clock_));
+    }
+  else
+    {
+      const int frames
+        = opusd_conceal_clock_gap (&(ap_prc->clock_), ap_hdr->nTimeStamp);
+      if (frames > 0)
+        {
+          TIZ_DEBUG (handleOf (ap_prc),
+                     "gap before [%lld] us : concealing [%d]",
+                     (long long) ap_hdr->nTimeStamp, frames);
+          ap_prc->lost_frames_ += frames;
+        }
+    }
+}
+
+static void
+update_next_timestamp (opusd_prc_t * ap_prc,
+                       const OMX_BUFFERHEADERTYPE * ap_hdr,
+                       const int a_frame_size)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+  if ((ap_hdr->nFlags & OMX_BUFFERFLAG_TIMESTAMPINVALID) > 0)
+    {
+      ap_prc->clock_.next_valid = false;
+    }
+  else
+    {
+      opusd_conceal_clock_advance (&(ap_prc->clock_), ap_hdr->nTimeStamp,
+                                   a_frame_size);
+    }
+}
+
 static OMX_ERRORTYPE
-transform_buffer (opusd_prc_t * ap_prc)
+deliver_decoded_frames (opusd_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_out)
 {
-  OMX_BUFFERHEADERTYPE * p_in
-    = get_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX);
-  OMX_BUFFERHEADERTYPE * p_out
-    = get_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+  const int channels = ap_prc->channels_;
+  const int capacity
+    = (int) ((ap_out->nAllocLen - ap_out->nOffset - ap_out->nFilledLen)
+             / (channels * sizeof (short)));
+  const int nframes
+    = ap_prc->out_frames_ < capacity ? ap_prc->out_frames_ : capacity;
+  const float * p_pcm
+    = ap_prc->p_out_buf_ + (size_t) ap_prc->out_offset_ * channels;
+  short * p_dst = (short *) (ap_out->pBuffer + ap_out->nOffset
+                             + ap_out->nFilledLen);
+  int i = 0;
 
   assert (ap_prc);
+  assert (ap_out);
 
-  if (!p_in || !p_out)
+  for (i = 0; i < nframes * channels; ++i)
     {
-      TIZ_TRACE (handleOf (ap_prc), "IN HEADER [%p] OUT HEADER [%p]", p_in,
-                 p_out);
-      return OMX_ErrorNone;
+      p_dst[i] = (short) float2int (
+        fmaxf (-32768, fminf (p_pcm[i] * 32768.f, 32767)));
     }
 
-  if (0 == p_in->nFilledLen)
+  ap_out->nFilledLen += nframes * channels * sizeof (short);
+  ap_prc->out_offset_ += nframes;
+  ap_prc->out_frames_ -= nframes;
+
+  if (0 == ap_prc->out_frames_ && ap_prc->eos_pending_)
     {
-      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
-                 p_in->nFlags);
-      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+      /* Propagate EOS flag to output */
+      ap_out->nFlags |= OMX_BUFFERFLAG_EOS;
+      ap_prc->eos_pending_ = false;
+    }
+
+  return release_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+}
+
+static OMX_ERRORTYPE
+conceal_lost_frames (opusd_prc_t * ap_prc, const OMX_BUFFERHEADERTYPE * ap_in)
+{
+  const unsigned char * p_next
+    = ap_in ? ap_in->pBuffer + ap_in->nOffset : NULL;
+  const opus_int32 next_len = ap_in ? (opus_int32) ap_in->nFilledLen : 0;
+  bool used_fec = false;
+  int frames = 0;
+
+  assert (ap_prc);
+
+  frames = opusd_conceal (ap_prc->p_opus_dec_, &(ap_prc->lost_frames_), p_next,
+                          next_len, ap_prc->p_out_buf_, OPUS_MAX_FRAME_SIZE,
+                          &used_fec);
+  if (frames < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "[OMX_ErrorInsufficientResources] : [%s]",
+                 opus_strerror (frames));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (frames > 0)
+    {
+      if (used_fec)
         {
-          /* Propagate EOS flag to output */
-          p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-          p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
-          tiz_check_omx (
-            release_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX));
+          ap_prc->fec_count_++;
         }
-      tiz_check_omx (
-        release_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
-      return OMX_ErrorNone;
+      else
+        {
+          ap_prc->plc_count_++;
+        }
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "%s : [%d] frames - plc [%d] fec [%d] - still lost [%d]",
+                 used_fec ? "FEC" : "PLC", frames, ap_prc->plc_count_,
+                 ap_prc->fec_count_, ap_prc->lost_frames_);
     }
 
-  {
-    const unsigned char * p_data = p_in->pBuffer + p_in->nOffset;
-    opus_int32 len = p_in->nFilledLen;
-    int fec = 0;
-    float * output = NULL;
-    short * out = NULL;
-    unsigned out_len = 0;
-    int i = 0;
-    int tmp_skip = 0;
-    int frame_size = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data,
-                                                    len, ap_prc->p_out_buf_,
-                                                    OPUS_MAX_FRAME_SIZE, fec);
-
-    if (frame_size < 0)
-      {
-        TIZ_ERROR (handleOf (ap_prc), "[OMX_ErrorInsufficientResources] : [%s]",
-                   opus_strerror (frame_size));
-        return OMX_ErrorInsufficientResources;
-      }
-    else
-      {
-        tmp_skip
-          = (ap_prc->preskip_ > frame_size) ? frame_size : ap_prc->preskip_;
-        ap_prc->preskip_ -= tmp_skip;
-        output = ap_prc->p_out_buf_ + ap_prc->channels_ * tmp_skip;
-        out_len = frame_size - tmp_skip;
-
-        /* Convert to short and save to output file */
-        out = (short *) (p_out->pBuffer + p_out->nOffset);
-        for (i = 0; i < (int) out_len * ap_prc->channels_; ++i)
-          {
-            out[i] = (short) float2int (
-              fmaxf (-32768, fminf (output[i] * 32768.f, 32767)));
-          }
-
-        if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
-          {
-            /* Propagate EOS flag to output */
-            p_out->nFlags |= OMX_BUFFERFLAG_EOS;
-            p_in->nFlags &= ~(1 << OMX_BUFFERFLAG_EOS);
-          }
-
-        p_out->nFilledLen = out_len * ap_prc->channels_ * 2;
-        TIZ_TRACE (handleOf (ap_prc),
-                   "frame_size [%d] len [%d] - error [%s] nFilledLen [%d]",
-                   frame_size, len, opus_strerror (frame_size),
-                   p_out->nFilledLen);
-        p_in->nFilledLen = 0;
-        tiz_check_omx (
-          release_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
-        tiz_check_omx (
-          release_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX));
-      }
-  }
+  ap_prc->out_offset_ = 0;
+  ap_prc->out_frames_ = frames;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-allocate_output_buffer (opusd_prc_t * ap_prc)
+decode_packet (opusd_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_in)
 {
+  const unsigned char * p_data = ap_in->pBuffer + ap_in->nOffset;
+  const opus_int32 len = ap_in->nFilledLen;
+  int tmp_skip = 0;
+  int frame_size = 0;
+
   assert (ap_prc);
-  if (!ap_prc->p_out_buf_)
+  assert (ap_in);
+
+  frame_size = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data, len,
+                                              ap_prc->p_out_buf_,
+                                              OPUS_MAX_FRAME_SIZE, 0);
+
+  if (frame_size < 0)
     {
-      if (!(ap_prc->p_out_buf_ = tiz_mem_alloc (
-              sizeof (float) * ARATELIA_OPUS_DECODER_PORT_MIN_OUTPUT_BUF_SIZE)))
-        {
-          return OMX_ErrorInsufficientResources;
-        }
+      TIZ_ERROR (handleOf (ap_prc), "[OMX_ErrorInsufficientResources] : [%s]",
+                 opus_strerror (frame_size));
+      return OMX_ErrorInsufficientResources;
     }
+
+  tmp_skip = (ap_prc->preskip_ > frame_size) ? frame_size : ap_prc->preskip_;
+  ap_prc->preskip_ -= tmp_skip;
+  ap_prc->out_offset_ = tmp_skip;
+  ap_prc->out_frames_ = frame_size - tmp_skip;
+  ap_prc->last_frame_size_ = frame_size;
+  update_next_timestamp (ap_prc, ap_in, frame_size);
+
+  TIZ_TRACE (handleOf (ap_prc), "frame_size [%d] len [%d]", frame_size, len);
   return OMX_ErrorNone;
 }
 
-static void
-deallocate_output_buffer (opusd_prc_t * ap_prc)
+static OMX_ERRORTYPE
+consume_input_header (opusd_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_in)
 {
   assert (ap_prc);
-  if (ap_prc->p_out_buf_)
+  assert (ap_in);
+  if ((ap_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
     {
-      tiz_mem_free (ap_prc->p_out_buf_);
-      ap_prc->p_out_buf_ = NULL;
+      ap_prc->eos_pending_ = true;
+      ap_in->nFlags &= ~OMX_BUFFERFLAG_EOS;
     }
+  ap_in->nFilledLen = 0;
+  return release_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX);
 }
 
-static void
-reset_output_buffer (opusd_prc_t * ap_prc)
+static OMX_ERRORTYPE
+transform_buffer (opusd_prc_t * ap_prc)
 {
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  OMX_BUFFERHEADERTYPE * p_out
+    = get_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+
   assert (ap_prc);
-  if (ap_prc->p_out_buf_)
+
+  if (!p_out)
+    {
+      return OMX_ErrorNone;
+    }
+
+  /* Frames decoded earlier go first */
+  if (ap_prc->out_frames_ > 0
+      || (ap_prc->eos_pending_ && 0 == ap_prc->lost_frames_))
+    {
+      return deliver_decoded_frames (ap_prc, p_out);
+    }
+
+  if (ap_prc->eos_pending_)
+    {
+      /* The stream ends with a gap; fill it before EOS */
+      return conceal_lost_frames (ap_prc, NULL);
+    }
+
+  if (!(p_in = get_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX)))
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (is_lost_packet (p_in))
     {
-      tiz_mem_set (
-        ap_prc->p_out_buf_, 0,
-        sizeof (float) * ARATELIA_OPUS_DECODER_PORT_MIN_OUTPUT_BUF_SIZE);
+      TIZ_DEBUG (handleOf (ap_prc), "lost packet [%p] - [%d] frames", p_in,
+                 ap_prc->last_frame_size_);
+      ap_prc->lost_frames_ += ap_prc->last_frame_size_;
+      ap_prc->clock_.next_valid = false;
+      return consume_input_header (ap_prc, p_in);
     }
+
+  if (0 == p_in->nFilledLen)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
+                 p_in->nFlags);
+      return consume_input_header (ap_prc, p_in);
+    }
+
+  detect_timestamp_gap (ap_prc, p_in);
+
+  if (ap_prc->lost_frames_ > 0)
+    {
+      /* The input header stays with us until the gap is filled */
+      return conceal_lost_frames (ap_prc, p_in);
+    }
+
+  tiz_check_omx (decode_packet (ap_prc, p_in));
+  return consume_input_header (ap_prc, p_in);
 }
 
 static void
@@ -523,16 +721,19 @@ reset_stream_parameters (opusd_prc_t * ap_prc)
   ap_prc->channels_ = 0;
   ap_prc->preskip_ = 0;
   ap_prc->eos_ = false;
+  ap_prc->eos_pending_ = false;
+  ap_prc->lost_frames_ = 0;
+  ap_prc->last_frame_size_ = OPUSD_CONCEAL_RATE / 50; /* 20 ms */
+  opusd_conceal_clock_reset (&(ap_prc->clock_));
+  ap_prc->plc_count_ = 0;
+  ap_prc->fec_count_ = 0;
   ap_prc->opus_header_parsed_ = false;
   ap_prc->opus_comments_parsed_ = false;
   if (ap_prc->p_opus_dec_)
     {
       opus_multistream_decoder_ctl (ap_prc->p_opus_dec_, OPUS_RESET_STATE);
     }
-  if (ap_prc->p_out_buf_)
-    {
-      reset_output_buffer (ap_prc);
-    }
+  reset_output_buffer (ap_prc);
 }
 
 /*
@@ -548,6 +749,7 @@ opusd_prc_ctor (void * ap_obj, va_list * app)
   p_prc->p_in_hdr_ = NULL;
   p_prc->p_out_hdr_ = NULL;
   p_prc->p_out_buf_ = NULL;
+  p_prc->out_buf_len_ = 0;
   reset_stream_parameters (p_prc);
   p_prc->in_port_disabled_ = false;
   p_prc->out_port_disabled_ = false;
@@ -649,7 +851,7 @@ opusd_prc_buffers_ready (const void * ap_obj)
           p_prc->opus_header_parsed_ = true;
         }
 
-      while (headers_available (p_prc) && OMX_ErrorNone == rc)
+      while (may_transform (p_prc) && OMX_ErrorNone == rc)
         {
           rc = transform_buffer (p_prc);
         }
@@ -662,6 +864,12 @@ static OMX_ERRORTYPE
 opusd_prc_port_flush (const void * ap_obj, OMX_U32 a_pid)
 {
   opusd_prc_t * p_obj = (opusd_prc_t *) ap_obj;
+  assert (p_obj);
+  /* Whatever was pending or missing belongs to the old position */
+  reset_output_buffer (p_obj);
+  p_obj->lost_frames_ = 0;
+  p_obj->eos_pending_ = false;
+  p_obj->clock_.next_valid = false;
   return release_headers (p_obj, a_pid);
 }
 
@@ -37,6 +37,8 @@ extern "C" {
 #include <opus.h>
 #include <opus_multistream.h>
 
+#include "opusdconceal.h"
+
 #include <tizprc_decls.h>
 
 typedef struct opusd_prc opusd_prc_t;
@@ -49,12 +51,21 @@ struct opusd_prc
   OMX_BUFFERHEADERTYPE * p_out_hdr_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   float * p_out_buf_;
+  size_t out_buf_len_;
+  int out_offset_;
+  int out_frames_;
   opus_int64 packet_count_;
   int rate_;
   int mapping_family_;
   int channels_;
   int preskip_;
+  int last_frame_size_;
+  int lost_frames_;
+  int plc_count_;
+  int fec_count_;
+  opusd_conceal_clock_t clock_;
   bool eos_;
+  bool eos_pending_;
   bool in_port_disabled_;
   bool out_port_disabled_;
   bool opus_header_parsed_;
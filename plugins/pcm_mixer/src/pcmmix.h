@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmix.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer component constants
+ *
+ *
+ */
+#ifndef PCMMIX_H
+#define PCMMIX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_RoleNames.h>
+#include <OMX_TizoniaExt.h>
+
+#define ARATELIA_PCM_MIXER_DEFAULT_ROLE OMX_ROLE_AUDIO_MIXER_PCM
+#define ARATELIA_PCM_MIXER_COMPONENT_NAME "OMX.Aratelia.audio_mixer.pcm"
+/* With libtizonia, port indexes must start at index 0. Ports 0 to
+   ARATELIA_PCM_MIXER_INPUT_PORT_COUNT - 1 are inputs; the output port
+   follows. */
+#define ARATELIA_PCM_MIXER_INPUT_PORT_COUNT 4
+#define ARATELIA_PCM_MIXER_OUTPUT_PORT_INDEX \
+  ARATELIA_PCM_MIXER_INPUT_PORT_COUNT
+#define ARATELIA_PCM_MIXER_PORT_MIN_BUF_COUNT 2
+#define ARATELIA_PCM_MIXER_PORT_MIN_BUF_SIZE 8192
+#define ARATELIA_PCM_MIXER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_PCM_MIXER_PORT_ALIGNMENT 0
+#define ARATELIA_PCM_MIXER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_PCM_MIXER_DEFAULT_RAMP_MS 50
+#define ARATELIA_PCM_MIXER_MAX_RAMP_MS 10000
+#define ARATELIA_PCM_MIXER_DEFAULT_DUCK_MB -1200
+#define ARATELIA_PCM_MIXER_DEFAULT_JITTER_MS 200
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PCMMIX_H */
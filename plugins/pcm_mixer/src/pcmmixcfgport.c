@@ -0,0 +1,246 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmixcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer config port implementation
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "pcmmix.h"
+#include "pcmmixcfgport.h"
+#include "pcmmixcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_mixer.cfgport"
+#endif
+
+static OMX_S32
+rc_value (const char * ap_key, const OMX_S32 a_default)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? (OMX_S32) strtol (p_value, NULL, 10) : a_default;
+}
+
+/*
+ * pcmmixcfgport class
+ */
+
+static void *
+pcmmix_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  pcmmix_cfgport_t * p_obj
+    = super_ctor (typeOf (ap_obj, "pcmmixcfgport"), ap_obj, app);
+  const OMX_S32 ramp_ms
+    = rc_value (ARATELIA_PCM_MIXER_COMPONENT_NAME ".ramp_ms",
+                ARATELIA_PCM_MIXER_DEFAULT_RAMP_MS);
+  const OMX_S32 duck_mb
+    = rc_value (ARATELIA_PCM_MIXER_COMPONENT_NAME ".duck_attenuation_mb",
+                ARATELIA_PCM_MIXER_DEFAULT_DUCK_MB);
+  OMX_U32 i = 0;
+
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigAudioMixerRamp);
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigAudioMixerDuck);
+
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE * p_ramp = &(p_obj->ramp_[i]);
+      OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE * p_duck = &(p_obj->duck_[i]);
+
+      p_ramp->nSize = sizeof (OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE);
+      p_ramp->nVersion.nVersion = OMX_VERSION;
+      p_ramp->nPortIndex = i;
+      p_ramp->nDurationMs
+        = (ramp_ms >= 0 && ramp_ms <= ARATELIA_PCM_MIXER_MAX_RAMP_MS)
+            ? ramp_ms
+            : ARATELIA_PCM_MIXER_DEFAULT_RAMP_MS;
+
+      p_duck->nSize = sizeof (OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE);
+      p_duck->nVersion.nVersion = OMX_VERSION;
+      p_duck->nPortIndex = i;
+      p_duck->bDucker = OMX_FALSE;
+      p_duck->nAttenuationmB
+        = duck_mb <= 0 ? duck_mb : ARATELIA_PCM_MIXER_DEFAULT_DUCK_MB;
+    }
+
+  return p_obj;
+}
+
+static void *
+pcmmix_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "pcmmixcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+pcmmix_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                          OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const pcmmix_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioMixerRamp == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE * p_ramp
+        = (OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE *) ap_struct;
+      if (p_ramp->nPortIndex >= ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      *p_ramp = p_obj->ramp_[p_ramp->nPortIndex];
+    }
+  else if (OMX_TizoniaIndexConfigAudioMixerDuck == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE * p_duck
+        = (OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE *) ap_struct;
+      if (p_duck->nPortIndex >= ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      *p_duck = p_obj->duck_[p_duck->nPortIndex];
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "pcmmixcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+pcmmix_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                          OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  pcmmix_cfgport_t * p_obj = (pcmmix_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioMixerRamp == a_index)
+    {
+      const OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE * p_ramp
+        = (OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE *) ap_struct;
+      if (p_ramp->nPortIndex >= ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      if (p_ramp->nDurationMs > ARATELIA_PCM_MIXER_MAX_RAMP_MS)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      p_obj->ramp_[p_ramp->nPortIndex] = *p_ramp;
+      TIZ_TRACE (ap_hdl, "port [%d] nDurationMs [%d]", p_ramp->nPortIndex,
+                 p_ramp->nDurationMs);
+    }
+  else if (OMX_TizoniaIndexConfigAudioMixerDuck == a_index)
+    {
+      const OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE * p_duck
+        = (OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE *) ap_struct;
+      if (p_duck->nPortIndex >= ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      if (p_duck->nAttenuationmB > 0)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      p_obj->duck_[p_duck->nPortIndex] = *p_duck;
+      TIZ_TRACE (ap_hdl, "port [%d] bDucker [%s] nAttenuationmB [%d]",
+                 p_duck->nPortIndex, p_duck->bDucker ? "TRUE" : "FALSE",
+                 p_duck->nAttenuationmB);
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "pcmmixcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * pcmmix_cfgport_class
+ */
+
+static void *
+pcmmix_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "pcmmixcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+pcmmix_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * pcmmixcfgport_class
+    = factory_new (classOf (tizconfigport), "pcmmixcfgport_class",
+                   classOf (tizconfigport), sizeof (pcmmix_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, pcmmix_cfgport_class_ctor, 0);
+  return pcmmixcfgport_class;
+}
+
+void *
+pcmmix_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * pcmmixcfgport_class = tiz_get_type (ap_hdl, "pcmmixcfgport_class");
+  TIZ_LOG_CLASS (pcmmixcfgport_class);
+  void * pcmmixcfgport = factory_new (
+    pcmmixcfgport_class, "pcmmixcfgport", tizconfigport,
+    sizeof (pcmmix_cfgport_t), ap_tos, ap_hdl, ctor, pcmmix_cfgport_ctor, dtor,
+    pcmmix_cfgport_dtor, tiz_api_GetConfig, pcmmix_cfgport_GetConfig,
+    tiz_api_SetConfig, pcmmix_cfgport_SetConfig, 0);
+
+  return pcmmixcfgport;
+}
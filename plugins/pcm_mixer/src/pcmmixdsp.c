@@ -0,0 +1,285 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmixdsp.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer - sample conversion and summing loops
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcmmixdsp.h"
+
+#if !defined(PCMMIX_DISABLE_SIMD)
+#if defined(__SSE2__)
+#define PCMMIX_HAVE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCMMIX_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#define PCMMIX_S16_SCALE 32768.0f
+/* 1.5 * 2^23: adding and subtracting it rounds a float of magnitude below
+   2^22 to the nearest integer, ties to even, as _mm_cvtps_epi32 and lrintf
+   do in the default rounding mode */
+#define PCMMIX_ROUND_MAGIC 12582912.0f
+
+OMX_U32
+pcmmix_dsp_sample_size (const pcmmix_format_t a_fmt)
+{
+  return EPcmMixFormatS16 == a_fmt ? sizeof (int16_t) : sizeof (float);
+}
+
+void
+pcmmix_dsp_to_float (const void * ap_src, const pcmmix_format_t a_fmt,
+                     float * ap_dst, const OMX_U32 a_samples)
+{
+  const int16_t * p_s16 = ap_src;
+  OMX_U32 i = 0;
+
+  assert (ap_src);
+  assert (ap_dst);
+
+  if (EPcmMixFormatF32 == a_fmt)
+    {
+      memcpy (ap_dst, ap_src, a_samples * sizeof (float));
+      return;
+    }
+
+#if defined(PCMMIX_HAVE_SSE2)
+  {
+    const __m128 scale = _mm_set1_ps (1.0f / PCMMIX_S16_SCALE);
+    for (; i + 8 <= a_samples; i += 8)
+      {
+        const __m128i s = _mm_loadu_si128 ((const __m128i *) (p_s16 + i));
+        /* Sign-extend to 32 bits by unpacking into the upper halves */
+        const __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (s, s), 16);
+        const __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (s, s), 16);
+        _mm_storeu_ps (ap_dst + i, _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+        _mm_storeu_ps (ap_dst + i + 4,
+                       _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+      }
+  }
+#elif defined(PCMMIX_HAVE_NEON)
+  {
+    const float32x4_t scale = vdupq_n_f32 (1.0f / PCMMIX_S16_SCALE);
+    for (; i + 8 <= a_samples; i += 8)
+      {
+        const int16x8_t s = vld1q_s16 (p_s16 + i);
+        const int32x4_t lo = vmovl_s16 (vget_low_s16 (s));
+        const int32x4_t hi = vmovl_s16 (vget_high_s16 (s));
+        vst1q_f32 (ap_dst + i, vmulq_f32 (vcvtq_f32_s32 (lo), scale));
+        vst1q_f32 (ap_dst + i + 4, vmulq_f32 (vcvtq_f32_s32 (hi), scale));
+      }
+  }
+#endif
+
+  for (; i < a_samples; ++i)
+    {
+      ap_dst[i] = p_s16[i] / PCMMIX_S16_SCALE;
+    }
+}
+
+void
+pcmmix_dsp_mix (float * ap_dst, const float * ap_src, const OMX_U32 a_samples,
+                const float a_gain)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_dst);
+  assert (ap_src);
+
+#if defined(PCMMIX_HAVE_SSE2)
+  {
+    const __m128 g = _mm_set1_ps (a_gain);
+    for (; i + 8 <= a_samples; i += 8)
+      {
+        const __m128 a = _mm_loadu_ps (ap_src + i);
+        const __m128 b = _mm_loadu_ps (ap_src + i + 4);
+        _mm_storeu_ps (
+          ap_dst + i,
+          _mm_add_ps (_mm_loadu_ps (ap_dst + i), _mm_mul_ps (a, g)));
+        _mm_storeu_ps (
+          ap_dst + i + 4,
+          _mm_add_ps (_mm_loadu_ps (ap_dst + i + 4), _mm_mul_ps (b, g)));
+      }
+  }
+#elif defined(PCMMIX_HAVE_NEON)
+  {
+    const float32x4_t g = vdupq_n_f32 (a_gain);
+    for (; i + 8 <= a_samples; i += 8)
+      {
+        vst1q_f32 (ap_dst + i, vmlaq_f32 (vld1q_f32 (ap_dst + i),
+                                          vld1q_f32 (ap_src + i), g));
+        vst1q_f32 (ap_dst + i + 4, vmlaq_f32 (vld1q_f32 (ap_dst + i + 4),
+                                              vld1q_f32 (ap_src + i + 4), g));
+      }
+  }
+#endif
+
+  for (; i < a_samples; ++i)
+    {
+      ap_dst[i] += ap_src[i] * a_gain;
+    }
+}
+
+float
+pcmmix_dsp_mix_ramp (float * ap_dst, const float * ap_src,
+                     const OMX_U32 a_frames, const OMX_U32 a_channels,
+                     float a_gain, const float a_step)
+{
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+
+  assert (ap_dst);
+  assert (ap_src);
+
+  /* Ramps are short and rare; the scalar loop is good enough */
+  for (i = 0; i < a_frames; ++i)
+    {
+      for (c = 0; c < a_channels; ++c)
+        {
+          *ap_dst++ += *ap_src++ * a_gain;
+        }
+      a_gain += a_step;
+    }
+  return a_gain;
+}
+
+void
+pcmmix_dsp_from_float (const float * ap_src, const pcmmix_format_t a_fmt,
+                       void * ap_dst, const OMX_U32 a_samples)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_src);
+  assert (ap_dst);
+
+  if (EPcmMixFormatF32 == a_fmt)
+    {
+      float * p_f32 = ap_dst;
+#if defined(PCMMIX_HAVE_SSE2)
+      {
+        const __m128 lo = _mm_set1_ps (-1.0f);
+        const __m128 hi = _mm_set1_ps (1.0f);
+        for (; i + 4 <= a_samples; i += 4)
+          {
+            _mm_storeu_ps (
+              p_f32 + i,
+              _mm_min_ps (_mm_max_ps (_mm_loadu_ps (ap_src + i), lo), hi));
+          }
+      }
+#elif defined(PCMMIX_HAVE_NEON)
+      {
+        const float32x4_t lo = vdupq_n_f32 (-1.0f);
+        const float32x4_t hi = vdupq_n_f32 (1.0f);
+        for (; i + 4 <= a_samples; i += 4)
+          {
+            vst1q_f32 (p_f32 + i,
+                       vminq_f32 (vmaxq_f32 (vld1q_f32 (ap_src + i), lo), hi));
+          }
+      }
+#endif
+      for (; i < a_samples; ++i)
+        {
+          const float v = ap_src[i];
+          p_f32[i] = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+        }
+    }
+  else
+    {
+      int16_t * p_s16 = ap_dst;
+#if defined(PCMMIX_HAVE_SSE2)
+      {
+        /* Clamping first keeps the float to int32 conversion in range; the
+           pack then saturates +1.0 (32768) to 32767 */
+        const __m128 lo = _mm_set1_ps (-1.0f);
+        const __m128 hi = _mm_set1_ps (1.0f);
+        const __m128 scale = _mm_set1_ps (PCMMIX_S16_SCALE);
+        for (; i + 8 <= a_samples; i += 8)
+          {
+            const __m128 a = _mm_min_ps (
+              _mm_max_ps (_mm_loadu_ps (ap_src + i), lo), hi);
+            const __m128 b = _mm_min_ps (
+              _mm_max_ps (_mm_loadu_ps (ap_src + i + 4), lo), hi);
+            const __m128i ia = _mm_cvtps_epi32 (_mm_mul_ps (a, scale));
+            const __m128i ib = _mm_cvtps_epi32 (_mm_mul_ps (b, scale));
+            _mm_storeu_si128 ((__m128i *) (p_s16 + i),
+                              _mm_packs_epi32 (ia, ib));
+          }
+      }
+#elif defined(PCMMIX_HAVE_NEON)
+      {
+        /* vcvtq truncates, so the samples are rounded first, the same way
+           as in the other paths; vqmovn then saturates +1.0 to 32767 */
+        const float32x4_t lo = vdupq_n_f32 (-1.0f);
+        const float32x4_t hi = vdupq_n_f32 (1.0f);
+        const float32x4_t scale = vdupq_n_f32 (PCMMIX_S16_SCALE);
+        const float32x4_t magic = vdupq_n_f32 (PCMMIX_ROUND_MAGIC);
+        for (; i + 8 <= a_samples; i += 8)
+          {
+            const float32x4_t a = vmulq_f32 (
+              vminq_f32 (vmaxq_f32 (vld1q_f32 (ap_src + i), lo), hi), scale);
+            const float32x4_t b = vmulq_f32 (
+              vminq_f32 (vmaxq_f32 (vld1q_f32 (ap_src + i + 4), lo), hi),
+              scale);
+            const int32x4_t ia
+              = vcvtq_s32_f32 (vsubq_f32 (vaddq_f32 (a, magic), magic));
+            const int32x4_t ib
+              = vcvtq_s32_f32 (vsubq_f32 (vaddq_f32 (b, magic), magic));
+            vst1q_s16 (p_s16 + i,
+                       vcombine_s16 (vqmovn_s32 (ia), vqmovn_s32 (ib)));
+          }
+      }
+#endif
+      for (; i < a_samples; ++i)
+        {
+          const float f = ap_src[i];
+          const long v = lrintf (
+            (f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f)) * PCMMIX_S16_SCALE);
+          p_s16[i]
+            = v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v);
+        }
+    }
+}
+
+const char *
+pcmmix_dsp_simd_name (void)
+{
+#if defined(PCMMIX_HAVE_SSE2)
+  return "sse2";
+#elif defined(PCMMIX_HAVE_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmixdsp.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer - sample conversion and summing loops
+ *
+ * Inputs are converted to float when queued and summed into a float
+ * accumulator. The accumulator is clipped to [-1.0, 1.0] and, for 16-bit
+ * output, converted with a saturating pack, so overloads clip instead of
+ * wrapping around.
+ *
+ */
+
+#ifndef PCMMIXDSP_H
+#define PCMMIXDSP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Types.h>
+
+typedef enum pcmmix_format pcmmix_format_t;
+enum pcmmix_format
+{
+  EPcmMixFormatS16,
+  EPcmMixFormatF32,
+  EPcmMixFormatMax
+};
+
+/**
+ * Number of bytes per sample of a format.
+ */
+OMX_U32
+pcmmix_dsp_sample_size (const pcmmix_format_t a_fmt);
+
+void
+pcmmix_dsp_to_float (const void * ap_src, const pcmmix_format_t a_fmt,
+                     float * ap_dst, const OMX_U32 a_samples);
+
+/**
+ * ap_dst[i] += ap_src[i] * a_gain
+ */
+void
+pcmmix_dsp_mix (float * ap_dst, const float * ap_src, const OMX_U32 a_samples,
+                const float a_gain);
+
+/**
+ * Like pcmmix_dsp_mix, but the gain changes by a_step after every frame.
+ * Returns the gain that follows the last frame.
+ */
+float
+pcmmix_dsp_mix_ramp (float * ap_dst, const float * ap_src,
+                     const OMX_U32 a_frames, const OMX_U32 a_channels,
+                     float a_gain, const float a_step);
+
+void
+pcmmix_dsp_from_float (const float * ap_src, const pcmmix_format_t a_fmt,
+                       void * ap_dst, const OMX_U32 a_samples);
+
+/**
+ * The loop flavour in use: "sse2", "neon" or "scalar".
+ */
+const char *
+pcmmix_dsp_simd_name (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PCMMIXDSP_H */
@@ -0,0 +1,842 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmixprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer processor class
+ *
+ * Every enabled input port feeds a jitter queue. Output is produced only when
+ * all the inputs that are still playing have audio queued, so the mixer is
+ * paced by its inputs and needs no clock. An input leaves the mix once it
+ * has reached EOS and its queue is empty; the output gets EOS when every
+ * enabled input has. Disabled input ports are simply not mixed.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "pcmmix.h"
+#include "pcmmixprc.h"
+#include "pcmmixprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_mixer.prc"
+#endif
+
+/* Frames summed per pass */
+#define PCMMIX_BLOCK_FRAMES 1024
+/* The jitter queues hold at least this many frames, whatever the configured
+   depth */
+#define PCMMIX_MIN_QUEUE_FRAMES (2 * PCMMIX_BLOCK_FRAMES)
+
+/* Forward declarations */
+static OMX_ERRORTYPE
+pcmmix_prc_deallocate_resources (void *);
+
+static inline float
+mb_to_gain (const OMX_S32 a_mb)
+{
+  return powf (10.0f, (float) a_mb / 2000.0f);
+}
+
+static float
+volume_to_gain (const OMX_AUDIO_CONFIG_VOLUMETYPE * ap_volume)
+{
+  assert (ap_volume);
+  if (OMX_TRUE == ap_volume->bLinear)
+    {
+      /* 0 to 100, 100 being unity gain */
+      return ap_volume->sVolume.nValue > 0 ? ap_volume->sVolume.nValue / 100.0f
+                                           : 0.0f;
+    }
+  /* Millibels, as per the IL spec */
+  return mb_to_gain (ap_volume->sVolume.nValue);
+}
+
+static inline bool
+is_input_enabled (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  return tiz_filter_prc_is_port_enabled (ap_prc, a_pid);
+}
+
+/* An input is playing when it is enabled and has not yet drained after
+   EOS */
+static inline bool
+is_input_playing (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  const pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  return is_input_enabled (ap_prc, a_pid)
+         && !(p_in->eos_ && 0 == p_in->frames_);
+}
+
+static void
+reset_input_queue (pcmmix_input_t * ap_in)
+{
+  assert (ap_in);
+  ap_in->head_ = 0;
+  ap_in->frames_ = 0;
+  ap_in->eos_ = false;
+}
+
+static void
+free_input_queues (pcmmix_prc_t * ap_prc)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      tiz_mem_free (ap_prc->inputs_[i].p_queue_);
+      ap_prc->inputs_[i].p_queue_ = NULL;
+      ap_prc->inputs_[i].capacity_ = 0;
+      reset_input_queue (&(ap_prc->inputs_[i]));
+    }
+  tiz_mem_free (ap_prc->p_mix_);
+  ap_prc->p_mix_ = NULL;
+}
+
+static OMX_ERRORTYPE
+resolve_format (pcmmix_prc_t * ap_prc,
+                const OMX_AUDIO_PARAM_PCMMODETYPE * ap_pcmmode,
+                pcmmix_format_t * ap_fmt)
+{
+  assert (ap_prc);
+  assert (ap_pcmmode);
+  assert (ap_fmt);
+
+  /* As elsewhere in Tizonia, 32-bit PCM is float */
+  if ((16 != ap_pcmmode->nBitPerSample && 32 != ap_pcmmode->nBitPerSample)
+      || OMX_EndianLittle != ap_pcmmode->eEndian
+      || OMX_TRUE != ap_pcmmode->bInterleaved)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : port [%d] : "
+                 "nBitPerSample [%d] eEndian [%d] bInterleaved [%s]",
+                 ap_pcmmode->nPortIndex, ap_pcmmode->nBitPerSample,
+                 ap_pcmmode->eEndian,
+                 ap_pcmmode->bInterleaved ? "OMX_TRUE" : "OMX_FALSE");
+      return OMX_ErrorUnsupportedSetting;
+    }
+  *ap_fmt = 16 == ap_pcmmode->nBitPerSample ? EPcmMixFormatS16
+                                            : EPcmMixFormatF32;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+retrieve_output_settings (pcmmix_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->out_pcmmode_,
+                            ARATELIA_PCM_MIXER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc), OMX_IndexParamAudioPcm,
+    &(ap_prc->out_pcmmode_)));
+  tiz_check_omx (
+    resolve_format (ap_prc, &(ap_prc->out_pcmmode_), &(ap_prc->out_fmt_)));
+  ap_prc->out_frame_size_ = ap_prc->out_pcmmode_.nChannels
+                            * pcmmix_dsp_sample_size (ap_prc->out_fmt_);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+retrieve_input_settings (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+
+  assert (a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT);
+
+  TIZ_INIT_OMX_PORT_STRUCT (pcmmode, a_pid);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                                       handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm, &pcmmode));
+
+  /* Rate and channel conversions are left to other components (e.g. the PCM
+     resampler) */
+  if (pcmmode.nSamplingRate != ap_prc->out_pcmmode_.nSamplingRate
+      || pcmmode.nChannels != ap_prc->out_pcmmode_.nChannels)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : port [%d] : [%d] Hz [%d] ch "
+                 "- output is [%d] Hz [%d] ch",
+                 a_pid, pcmmode.nSamplingRate, pcmmode.nChannels,
+                 ap_prc->out_pcmmode_.nSamplingRate,
+                 ap_prc->out_pcmmode_.nChannels);
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  tiz_check_omx (resolve_format (ap_prc, &pcmmode, &(p_in->fmt_)));
+  p_in->frame_size_
+    = pcmmode.nChannels * pcmmix_dsp_sample_size (p_in->fmt_);
+  return OMX_ErrorNone;
+}
+
+static void
+start_ramp (pcmmix_input_t * ap_in, const float a_target)
+{
+  assert (ap_in);
+  if (a_target != ap_in->target_)
+    {
+      ap_in->target_ = a_target;
+      ap_in->ramp_left_ = ap_in->ramp_frames_;
+      if (0 == ap_in->ramp_left_)
+        {
+          ap_in->gain_ = a_target;
+          ap_in->step_ = 0.0f;
+        }
+      else
+        {
+          ap_in->step_ = (a_target - ap_in->gain_) / ap_in->ramp_left_;
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+retrieve_input_gains (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  void * p_krn = tiz_get_krn (handleOf (ap_prc));
+  OMX_AUDIO_CONFIG_VOLUMETYPE volume;
+  OMX_AUDIO_CONFIG_MUTETYPE mute;
+  OMX_TIZONIA_AUDIO_CONFIG_MIXERRAMPTYPE ramp;
+  OMX_TIZONIA_AUDIO_CONFIG_MIXERDUCKTYPE duck;
+
+  assert (a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT);
+
+  TIZ_INIT_OMX_PORT_STRUCT (volume, a_pid);
+  tiz_check_omx (tiz_api_GetConfig (p_krn, handleOf (ap_prc),
+                                    OMX_IndexConfigAudioVolume, &volume));
+  TIZ_INIT_OMX_PORT_STRUCT (mute, a_pid);
+  tiz_check_omx (tiz_api_GetConfig (p_krn, handleOf (ap_prc),
+                                    OMX_IndexConfigAudioMute, &mute));
+  TIZ_INIT_OMX_PORT_STRUCT (ramp, a_pid);
+  tiz_check_omx (tiz_api_GetConfig (
+    p_krn, handleOf (ap_prc),
+    (OMX_INDEXTYPE) OMX_TizoniaIndexConfigAudioMixerRamp, &ramp));
+  TIZ_INIT_OMX_PORT_STRUCT (duck, a_pid);
+  tiz_check_omx (tiz_api_GetConfig (
+    p_krn, handleOf (ap_prc),
+    (OMX_INDEXTYPE) OMX_TizoniaIndexConfigAudioMixerDuck, &duck));
+
+  p_in->volume_ = volume_to_gain (&volume);
+  p_in->muted_ = (OMX_TRUE == mute.bMute);
+  p_in->ramp_frames_ = (OMX_U32) (
+    ((OMX_U64) ramp.nDurationMs * ap_prc->out_pcmmode_.nSamplingRate) / 1000);
+  p_in->ducker_ = (OMX_TRUE == duck.bDucker);
+  p_in->duck_gain_ = mb_to_gain (duck.nAttenuationmB);
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "port [%d] volume [%f] muted [%s] ramp [%d] frames ducker [%s] "
+             "duck gain [%f]",
+             a_pid, p_in->volume_, p_in->muted_ ? "YES" : "NO",
+             p_in->ramp_frames_, p_in->ducker_ ? "YES" : "NO",
+             p_in->duck_gain_);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+prepare_input (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  OMX_U32 capacity = 0;
+
+  tiz_check_omx (retrieve_input_settings (ap_prc, a_pid));
+  tiz_check_omx (retrieve_input_gains (ap_prc, a_pid));
+
+  capacity = (OMX_U32) (((OMX_U64) ap_prc->jitter_ms_
+                         * ap_prc->out_pcmmode_.nSamplingRate)
+                        / 1000);
+  capacity = MAX (capacity, PCMMIX_MIN_QUEUE_FRAMES);
+  if (capacity != p_in->capacity_)
+    {
+      tiz_mem_free (p_in->p_queue_);
+      p_in->capacity_ = 0;
+      p_in->p_queue_ = tiz_mem_alloc (capacity * ap_prc->out_pcmmode_.nChannels
+                                      * sizeof (float));
+      tiz_check_null_ret_oom (p_in->p_queue_);
+      p_in->capacity_ = capacity;
+    }
+
+  reset_input_queue (p_in);
+  /* Start at the configured gain, without a ramp */
+  p_in->gain_ = p_in->target_ = p_in->muted_ ? 0.0f : p_in->volume_;
+  p_in->step_ = 0.0f;
+  p_in->ramp_left_ = 0;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+prepare_mixer (pcmmix_prc_t * ap_prc)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_prc);
+
+  free_input_queues (ap_prc);
+  ap_prc->eos_sent_ = false;
+
+  tiz_check_omx (retrieve_output_settings (ap_prc));
+
+  ap_prc->p_mix_ = tiz_mem_alloc (PCMMIX_BLOCK_FRAMES
+                                  * ap_prc->out_pcmmode_.nChannels
+                                  * sizeof (float));
+  tiz_check_null_ret_oom (ap_prc->p_mix_);
+
+  /* Disabled inputs are set up when they are enabled */
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      if (is_input_enabled (ap_prc, i))
+        {
+          tiz_check_omx (prepare_input (ap_prc, i));
+        }
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "[%d] Hz [%d] ch [%d] bits - [%d] ms jitter queues - loops [%s]",
+              ap_prc->out_pcmmode_.nSamplingRate,
+              ap_prc->out_pcmmode_.nChannels,
+              ap_prc->out_pcmmode_.nBitPerSample, ap_prc->jitter_ms_,
+              pcmmix_dsp_simd_name ());
+  return OMX_ErrorNone;
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_out_hdr (pcmmix_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE ** pp_out = tiz_filter_prc_get_header_ptr (
+    ap_prc, ARATELIA_PCM_MIXER_OUTPUT_PORT_INDEX);
+  const bool fresh = (NULL == *pp_out);
+  OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
+    ap_prc, ARATELIA_PCM_MIXER_OUTPUT_PORT_INDEX);
+  if (p_out && fresh)
+    {
+      /* Output buffers are filled over several passes */
+      p_out->nFilledLen = 0;
+      p_out->nOffset = 0;
+    }
+  return p_out;
+}
+
+static OMX_ERRORTYPE
+release_out_hdr (pcmmix_prc_t * ap_prc, const bool a_eos)
+{
+  OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
+  assert (ap_prc);
+  if (p_out)
+    {
+      if (a_eos)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Propagating EOS flag");
+          tiz_util_set_eos_flag (p_out);
+        }
+      tiz_check_omx (tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_PCM_MIXER_OUTPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+/* Moves as much audio as fits from the input port's buffers into its jitter
+   queue. Returns true if anything was queued or a buffer returned. */
+static bool
+fill_queue (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  const OMX_U32 channels = ap_prc->out_pcmmode_.nChannels;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  bool progress = false;
+
+  while (NULL != (p_hdr = tiz_filter_prc_get_header (ap_prc, a_pid)))
+    {
+      const OMX_U32 space = p_in->capacity_ - p_in->frames_;
+      OMX_U32 frames = MIN (p_hdr->nFilledLen / p_in->frame_size_, space);
+      const OMX_U8 * p_src = p_hdr->pBuffer + p_hdr->nOffset;
+
+      if (frames > 0)
+        {
+          /* The queue may wrap around, so copy in up to two runs */
+          OMX_U32 tail = (p_in->head_ + p_in->frames_) % p_in->capacity_;
+          OMX_U32 run = MIN (frames, p_in->capacity_ - tail);
+          pcmmix_dsp_to_float (p_src, p_in->fmt_,
+                               p_in->p_queue_ + tail * channels,
+                               run * channels);
+          if (frames > run)
+            {
+              pcmmix_dsp_to_float (p_src + run * p_in->frame_size_,
+                                   p_in->fmt_, p_in->p_queue_,
+                                   (frames - run) * channels);
+            }
+          p_in->frames_ += frames;
+          p_hdr->nOffset += frames * p_in->frame_size_;
+          p_hdr->nFilledLen -= frames * p_in->frame_size_;
+          /* New audio after an EOS starts a new stream on this input */
+          p_in->eos_ = false;
+          ap_prc->eos_sent_ = false;
+          progress = true;
+        }
+
+      if (p_hdr->nFilledLen >= p_in->frame_size_)
+        {
+          /* The queue is full */
+          break;
+        }
+
+      if ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "EOS on input port [%d]", a_pid);
+          p_in->eos_ = true;
+          tiz_util_reset_eos_flag (p_hdr);
+        }
+      /* Any trailing partial frame is dropped */
+      (void) tiz_filter_prc_release_header (ap_prc, a_pid);
+      progress = true;
+    }
+
+  return progress;
+}
+
+static void
+update_gains (pcmmix_prc_t * ap_prc)
+{
+  float duck = 1.0f;
+  OMX_U32 i = 0;
+
+  /* Duckers attenuate the other inputs for as long as they have audio */
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      const pcmmix_input_t * p_in = &(ap_prc->inputs_[i]);
+      if (p_in->ducker_ && p_in->frames_ > 0 && is_input_enabled (ap_prc, i))
+        {
+          duck = MIN (duck, p_in->duck_gain_);
+        }
+    }
+
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      pcmmix_input_t * p_in = &(ap_prc->inputs_[i]);
+      float target = p_in->muted_ ? 0.0f : p_in->volume_;
+      if (!p_in->ducker_)
+        {
+          target *= duck;
+        }
+      start_ramp (p_in, target);
+    }
+}
+
+static void
+mix_run (pcmmix_input_t * ap_in, float * ap_dst, const float * ap_src,
+         OMX_U32 a_frames, const OMX_U32 a_channels)
+{
+  if (ap_in->ramp_left_ > 0)
+    {
+      const OMX_U32 ramp = MIN (a_frames, ap_in->ramp_left_);
+      ap_in->gain_ = pcmmix_dsp_mix_ramp (ap_dst, ap_src, ramp, a_channels,
+                                          ap_in->gain_, ap_in->step_);
+      ap_in->ramp_left_ -= ramp;
+      if (0 == ap_in->ramp_left_)
+        {
+          ap_in->gain_ = ap_in->target_;
+        }
+      ap_dst += ramp * a_channels;
+      ap_src += ramp * a_channels;
+      a_frames -= ramp;
+    }
+
+  if (a_frames > 0 && ap_in->gain_ != 0.0f)
+    {
+      pcmmix_dsp_mix (ap_dst, ap_src, a_frames * a_channels, ap_in->gain_);
+    }
+}
+
+static void
+mix_input (pcmmix_prc_t * ap_prc, const OMX_U32 a_pid, const OMX_U32 a_frames)
+{
+  pcmmix_input_t * p_in = &(ap_prc->inputs_[a_pid]);
+  const OMX_U32 channels = ap_prc->out_pcmmode_.nChannels;
+  const OMX_U32 run = MIN (a_frames, p_in->capacity_ - p_in->head_);
+
+  assert (a_frames <= p_in->frames_);
+
+  mix_run (p_in, ap_prc->p_mix_, p_in->p_queue_ + p_in->head_ * channels, run,
+           channels);
+  if (a_frames > run)
+    {
+      mix_run (p_in, ap_prc->p_mix_ + run * channels, p_in->p_queue_,
+               a_frames - run, channels);
+    }
+  p_in->head_ = (p_in->head_ + a_frames) % p_in->capacity_;
+  p_in->frames_ -= a_frames;
+}
+
+/* Mixes one block into the output buffer. Returns true if any output was
+   produced or the output buffer was returned. */
+static bool
+mix_block (pcmmix_prc_t * ap_prc, OMX_ERRORTYPE * ap_rc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
+  OMX_U32 frames = 0;
+  bool playing = false;
+  bool eos = false;
+  OMX_U32 i = 0;
+
+  *ap_rc = OMX_ErrorNone;
+
+  if (!p_out)
+    {
+      return false;
+    }
+
+  frames = MIN (PCMMIX_BLOCK_FRAMES,
+                (p_out->nAllocLen - p_out->nOffset - p_out->nFilledLen)
+                  / ap_prc->out_frame_size_);
+
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      if (is_input_playing (ap_prc, i))
+        {
+          /* Wait for every playing input */
+          playing = true;
+          frames = MIN (frames, ap_prc->inputs_[i].frames_);
+        }
+      else if (is_input_enabled (ap_prc, i))
+        {
+          eos = true;
+        }
+    }
+
+  if (!playing)
+    {
+      if (eos && !ap_prc->eos_sent_)
+        {
+          /* Every enabled input has finished */
+          ap_prc->eos_sent_ = true;
+          *ap_rc = release_out_hdr (ap_prc, true);
+          return true;
+        }
+      return false;
+    }
+
+  if (0 == frames)
+    {
+      return false;
+    }
+
+  update_gains (ap_prc);
+  memset (ap_prc->p_mix_, 0,
+          frames * ap_prc->out_pcmmode_.nChannels * sizeof (float));
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      if (is_input_playing (ap_prc, i))
+        {
+          mix_input (ap_prc, i, frames);
+        }
+    }
+
+  pcmmix_dsp_from_float (ap_prc->p_mix_, ap_prc->out_fmt_,
+                         p_out->pBuffer + p_out->nOffset + p_out->nFilledLen,
+                         frames * ap_prc->out_pcmmode_.nChannels);
+  p_out->nFilledLen += frames * ap_prc->out_frame_size_;
+
+  if (p_out->nAllocLen - p_out->nOffset - p_out->nFilledLen
+      < ap_prc->out_frame_size_)
+    {
+      *ap_rc = release_out_hdr (ap_prc, false);
+    }
+  return true;
+}
+
+static void
+reset_stream_parameters (pcmmix_prc_t * ap_prc)
+{
+  OMX_U32 i = 0;
+  assert (ap_prc);
+  for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+    {
+      reset_input_queue (&(ap_prc->inputs_[i]));
+    }
+  ap_prc->eos_sent_ = false;
+}
+
+/*
+ * pcmmixprc
+ */
+
+static void *
+pcmmix_prc_ctor (void * ap_obj, va_list * app)
+{
+  pcmmix_prc_t * p_prc
+    = super_ctor (typeOf (ap_obj, "pcmmixprc"), ap_obj, app);
+  const char * p_jitter = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_PCM_MIXER_COMPONENT_NAME ".jitter_ms");
+  assert (p_prc);
+  memset (p_prc->inputs_, 0, sizeof (p_prc->inputs_));
+  p_prc->out_fmt_ = EPcmMixFormatS16;
+  p_prc->out_frame_size_ = 0;
+  p_prc->p_mix_ = NULL;
+  p_prc->jitter_ms_ = p_jitter ? strtoul (p_jitter, NULL, 10)
+                               : ARATELIA_PCM_MIXER_DEFAULT_JITTER_MS;
+  p_prc->eos_sent_ = false;
+  return p_prc;
+}
+
+static void *
+pcmmix_prc_dtor (void * ap_obj)
+{
+  (void) pcmmix_prc_deallocate_resources (ap_obj);
+  return super_dtor (typeOf (ap_obj, "pcmmixprc"), ap_obj);
+}
+
+/*
+ * from tizsrv class
+ */
+
+static OMX_ERRORTYPE
+pcmmix_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  /* The queues depend on the port settings; they are allocated in
+     prepare_to_transfer */
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_deallocate_resources (void * ap_obj)
+{
+  free_input_queues (ap_obj);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
+{
+  return prepare_mixer (ap_obj);
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_stop_and_return (void * ap_obj)
+{
+  reset_stream_parameters (ap_obj);
+  return tiz_filter_prc_release_all_headers (ap_obj);
+}
+
+/*
+ * from tizprc class
+ */
+
+static OMX_ERRORTYPE
+pcmmix_prc_buffers_ready (const void * ap_obj)
+{
+  pcmmix_prc_t * p_prc = (pcmmix_prc_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  bool progress = true;
+  OMX_U32 i = 0;
+
+  assert (p_prc);
+
+  if (!p_prc->p_mix_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  while (progress && OMX_ErrorNone == rc)
+    {
+      progress = false;
+      for (i = 0; i < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT; ++i)
+        {
+          if (fill_queue (p_prc, i))
+            {
+              progress = true;
+            }
+        }
+      if (mix_block (p_prc, &rc))
+        {
+          progress = true;
+        }
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_port_flush (const void * ap_obj, OMX_U32 a_pid)
+{
+  pcmmix_prc_t * p_prc = (pcmmix_prc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid)
+    {
+      reset_stream_parameters (p_prc);
+    }
+  else if (a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+    {
+      reset_input_queue (&(p_prc->inputs_[a_pid]));
+    }
+  /* Release any buffers held  */
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_port_disable (const void * ap_obj, OMX_U32 a_pid)
+{
+  pcmmix_prc_t * p_prc = (pcmmix_prc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid)
+    {
+      reset_stream_parameters (p_prc);
+    }
+  else if (a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+    {
+      reset_input_queue (&(p_prc->inputs_[a_pid]));
+    }
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, true);
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  pcmmix_prc_t * p_prc = (pcmmix_prc_t *) ap_obj;
+  assert (p_prc);
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, false);
+  if (!p_prc->p_mix_)
+    {
+      /* Not transferring yet; prepare_to_transfer will set things up */
+      return OMX_ErrorNone;
+    }
+  if (a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT)
+    {
+      /* An input joining the mix, e.g. to play an announcement */
+      return prepare_input (p_prc, a_pid);
+    }
+  /* The output settings may have changed; start over */
+  return prepare_mixer (p_prc);
+}
+
+static OMX_ERRORTYPE
+pcmmix_prc_config_change (void * ap_obj, OMX_U32 a_pid,
+                          OMX_INDEXTYPE a_config_idx)
+{
+  pcmmix_prc_t * p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+
+  if (p_prc->p_mix_ && a_pid < ARATELIA_PCM_MIXER_INPUT_PORT_COUNT
+      && (OMX_IndexConfigAudioVolume == a_config_idx
+          || OMX_IndexConfigAudioMute == a_config_idx
+          || OMX_TizoniaIndexConfigAudioMixerRamp == a_config_idx
+          || OMX_TizoniaIndexConfigAudioMixerDuck == a_config_idx))
+    {
+      TIZ_TRACE (handleOf (p_prc), "[%s] : port [%d]",
+                 tiz_idx_to_str (a_config_idx), a_pid);
+      /* The new gains are ramped to on the next block */
+      rc = retrieve_input_gains (p_prc, a_pid);
+    }
+  return rc;
+}
+
+/*
+ * pcmmix_prc_class
+ */
+
+static void *
+pcmmix_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "pcmmixprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+pcmmix_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * pcmmixprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizfilterprc), "pcmmixprc_class", classOf (tizfilterprc),
+     sizeof (pcmmix_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, pcmmix_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return pcmmixprc_class;
+}
+
+void *
+pcmmix_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * pcmmixprc_class = tiz_get_type (ap_hdl, "pcmmixprc_class");
+  TIZ_LOG_CLASS (pcmmixprc_class);
+  void * pcmmixprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (pcmmixprc_class, "pcmmixprc", tizfilterprc, sizeof (pcmmix_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, pcmmix_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, pcmmix_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, pcmmix_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, pcmmix_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, pcmmix_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, pcmmix_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, pcmmix_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, pcmmix_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, pcmmix_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, pcmmix_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, pcmmix_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_config_change, pcmmix_prc_config_change,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return pcmmixprc;
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pcmmixprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM mixer processor class
+ *
+ *
+ */
+
+#ifndef PCMMIXPRC_DECLS_H
+#define PCMMIXPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Audio.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizfilterprc.h>
+#include <tizfilterprc_decls.h>
+
+#include "pcmmix.h"
+#include "pcmmixdsp.h"
+
+typedef struct pcmmix_input pcmmix_input_t;
+struct pcmmix_input
+{
+  /* Jitter queue: a ring of interleaved float frames. Input buffers are
+     copied here and returned straight away, so that inputs with different
+     buffer sizes and cadences can be mixed. */
+  float * p_queue_;
+  OMX_U32 capacity_;
+  OMX_U32 head_;
+  OMX_U32 frames_;
+  pcmmix_format_t fmt_;
+  OMX_U32 frame_size_;
+  /* EOS seen; the input leaves the mix once its queue is empty */
+  bool eos_;
+  float volume_;
+  bool muted_;
+  OMX_U32 ramp_frames_;
+  bool ducker_;
+  float duck_gain_;
+  /* Gain ramp state */
+  float gain_;
+  float target_;
+  float step_;
+  OMX_U32 ramp_left_;
+};
+
+typedef struct pcmmix_prc pcmmix_prc_t;
+struct pcmmix_prc
+{
+  /* Object */
+  const tiz_filter_prc_t _;
+  pcmmix_input_t inputs_[ARATELIA_PCM_MIXER_INPUT_PORT_COUNT];
+  OMX_AUDIO_PARAM_PCMMODETYPE out_pcmmode_;
+  pcmmix_format_t out_fmt_;
+  OMX_U32 out_frame_size_;
+  float * p_mix_;
+  OMX_U32 jitter_ms_;
+  bool eos_sent_;
+};
+
+typedef struct pcmmix_prc_class pcmmix_prc_class_t;
+struct pcmmix_prc_class
+{
+  /* Class */
+  const tiz_filter_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PCMMIXPRC_DECLS_H */
@@ -47,7 +47,6 @@ extern "C" {
 #define ARATELIA_AUDIO_RENDERER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
 #define ARATELIA_AUDIO_RENDERER_MAX_GAIN_VALUE 11.0f   /* 11.00 dB ~ 150% */
 #define ARATELIA_AUDIO_RENDERER_MIN_GAIN_VALUE -100.0f /* -100.00 dB ~ 2% */
-#define ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE 0.f /* 0 dB = 100% */
 #define ARATELIA_AUDIO_RENDERER_MAX_VOLUME_VALUE 100
 #define ARATELIA_AUDIO_RENDERER_MIN_VOLUME_VALUE 0
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_VOLUME_VALUE 75
@@ -55,9 +54,16 @@ extern "C" {
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_DEVICE \
   ARATELIA_AUDIO_RENDERER_NULL_ALSA_DEVICE
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_MIXER "Master"
+/* Explicit ALSA ring sizing, in microseconds */
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME 100000
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME 25000
 
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT 20
 
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_LOUDNESS_TARGET -18000 /* mLUFS */
+#define ARATELIA_AUDIO_RENDERER_MIN_LOUDNESS_TARGET -40000
+#define ARATELIA_AUDIO_RENDERER_MAX_LOUDNESS_TARGET -5000
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,241 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA Audio Renderer config port implementation
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "ar.h"
+#include "arcfgport.h"
+#include "arcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.audio_renderer.cfgport"
+#endif
+
+static OMX_TIZONIA_AUDIO_LOUDNESSMODETYPE
+loudness_mode_from_rc (void)
+{
+  OMX_TIZONIA_AUDIO_LOUDNESSMODETYPE mode = OMX_AUDIO_LoudnessOff;
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".loudness");
+  if (p_value)
+    {
+      if (0 == strncmp (p_value, "track", strlen ("track")))
+        {
+          mode = OMX_AUDIO_LoudnessTrack;
+        }
+      else if (0 == strncmp (p_value, "album", strlen ("album")))
+        {
+          mode = OMX_AUDIO_LoudnessAlbum;
+        }
+      else if (0 == strncmp (p_value, "measure", strlen ("measure")))
+        {
+          mode = OMX_AUDIO_LoudnessMeasure;
+        }
+    }
+  return mode;
+}
+
+static OMX_S32
+loudness_target_from_rc (void)
+{
+  OMX_S32 target = ARATELIA_AUDIO_RENDERER_DEFAULT_LOUDNESS_TARGET;
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_AUDIO_RENDERER_COMPONENT_NAME ".loudness_target");
+  if (p_value)
+    {
+      /* The rc file value is in LUFS */
+      target = (OMX_S32) (strtod (p_value, NULL) * 1000.0);
+    }
+  if (target < ARATELIA_AUDIO_RENDERER_MIN_LOUDNESS_TARGET
+      || target > ARATELIA_AUDIO_RENDERER_MAX_LOUDNESS_TARGET)
+    {
+      target = ARATELIA_AUDIO_RENDERER_DEFAULT_LOUDNESS_TARGET;
+    }
+  return target;
+}
+
+/*
+ * arcfgport class
+ */
+
+static void *
+ar_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  ar_cfgport_t * p_obj
+    = super_ctor (typeOf (ap_obj, "arcfgport"), ap_obj, app);
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigAudioLoudness);
+
+  TIZ_INIT_OMX_PORT_STRUCT (p_obj->loudness_,
+                            ARATELIA_AUDIO_RENDERER_PORT_INDEX);
+  p_obj->loudness_.eMode = loudness_mode_from_rc ();
+  p_obj->loudness_.nTargetmLUFS = loudness_target_from_rc ();
+  p_obj->loudness_.bTrackGain = OMX_FALSE;
+  p_obj->loudness_.bAlbumGain = OMX_FALSE;
+
+  return p_obj;
+}
+
+static void *
+ar_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "arcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+ar_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const ar_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioLoudness == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE * p_loudness
+        = (OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE *) ap_struct;
+      if (ARATELIA_AUDIO_RENDERER_PORT_INDEX != p_loudness->nPortIndex)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      *p_loudness = p_obj->loudness_;
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "arcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+ar_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  ar_cfgport_t * p_obj = (ar_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioLoudness == a_index)
+    {
+      const OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE * p_loudness
+        = (OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE *) ap_struct;
+      if (ARATELIA_AUDIO_RENDERER_PORT_INDEX != p_loudness->nPortIndex)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      if (p_loudness->eMode > OMX_AUDIO_LoudnessMeasure
+          || p_loudness->nTargetmLUFS
+               < ARATELIA_AUDIO_RENDERER_MIN_LOUDNESS_TARGET
+          || p_loudness->nTargetmLUFS
+               > ARATELIA_AUDIO_RENDERER_MAX_LOUDNESS_TARGET)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      p_obj->loudness_ = *p_loudness;
+      TIZ_TRACE (ap_hdl,
+                 "eMode [%d] nTargetmLUFS [%d] track [%s:%d] album [%s:%d]",
+                 p_loudness->eMode, p_loudness->nTargetmLUFS,
+                 p_loudness->bTrackGain ? "TRUE" : "FALSE",
+                 p_loudness->nTrackGainmB,
+                 p_loudness->bAlbumGain ? "TRUE" : "FALSE",
+                 p_loudness->nAlbumGainmB);
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "arcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * ar_cfgport_class
+ */
+
+static void *
+ar_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "arcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+ar_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * arcfgport_class
+    = factory_new (classOf (tizconfigport), "arcfgport_class",
+                   classOf (tizconfigport), sizeof (ar_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, ar_cfgport_class_ctor, 0);
+  return arcfgport_class;
+}
+
+void *
+ar_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * arcfgport_class = tiz_get_type (ap_hdl, "arcfgport_class");
+  TIZ_LOG_CLASS (arcfgport_class);
+  void * arcfgport = factory_new (
+    arcfgport_class, "arcfgport", tizconfigport, sizeof (ar_cfgport_t), ap_tos,
+    ap_hdl, ctor, ar_cfgport_ctor, dtor, ar_cfgport_dtor, tiz_api_GetConfig,
+    ar_cfgport_GetConfig, tiz_api_SetConfig, ar_cfgport_SetConfig, 0);
+
+  return arcfgport;
+}
@@ -0,0 +1,572 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arloudness.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA Audio Renderer - loudness normalisation
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "arloudness.h"
+
+/* -1 dBFS */
+#define AR_LOUDNESS_CEILING 0.891251f
+/* Gating blocks are 400 ms long and overlap by 75%, i.e. every 100 ms
+   sub-block completes a new gating block */
+#define AR_LOUDNESS_SUBBLOCK_MS 100
+#define AR_LOUDNESS_SUBBLOCKS_PER_BLOCK 4
+#define AR_LOUDNESS_ABSOLUTE_GATE -70.0
+#define AR_LOUDNESS_RELATIVE_GATE -10.0
+/* 0.1 LU bins from the absolute gate up to +10 LUFS */
+#define AR_LOUDNESS_HIST_BINS 800
+/* Gating blocks needed (~1.3 s) before the measurement is trusted */
+#define AR_LOUDNESS_MIN_BLOCKS 10
+#define AR_LOUDNESS_MAX_BOOST_DB 12.0
+#define AR_LOUDNESS_MAX_CUT_DB -24.0
+/* Largest gain change per sub-block while measuring. The gain follows the
+   measurement quickly during the first seconds of a track, and slowly after
+   that, to avoid audible pumping. */
+#define AR_LOUDNESS_FAST_SLEW_DB 0.3
+#define AR_LOUDNESS_SLOW_SLEW_DB 0.05
+#define AR_LOUDNESS_FAST_SUBBLOCKS 50
+#define AR_LOUDNESS_RELEASE_MS 80
+
+typedef struct ar_loudness_biquad ar_loudness_biquad_t;
+struct ar_loudness_biquad
+{
+  double b0, b1, b2, a1, a2;
+};
+
+struct ar_loudness
+{
+  OMX_U32 channels_;
+  /* K-weighting filter: a high shelf and a high pass, with two state values
+     per stage and channel */
+  ar_loudness_biquad_t shelf_;
+  ar_loudness_biquad_t hpf_;
+  double * p_state_;
+  /* Measurement */
+  OMX_U32 subblock_frames_;
+  OMX_U32 subblock_pos_;
+  double subblock_sum_;
+  double subblocks_[AR_LOUDNESS_SUBBLOCKS_PER_BLOCK];
+  OMX_U32 subblock_count_;
+  OMX_U32 hist_[AR_LOUDNESS_HIST_BINS];
+  double bin_energy_[AR_LOUDNESS_HIST_BINS];
+  double gated_sum_;
+  OMX_U32 gated_count_;
+  bool measuring_;
+  double target_db_;
+  /* Gain, ramped linearly over one sub-block */
+  double gain_db_;
+  double desired_db_;
+  float gain_;
+  float gain_target_;
+  float gain_step_;
+  OMX_U32 ramp_left_;
+  /* Limiter: the signal is delayed by delay_frames_; the gain applied to each
+     frame is the moving average (over window_ frames) of the sliding minimum
+     (over window_ frames) of the gain each frame needs, which guarantees the
+     ceiling while ramping smoothly into every peak. */
+  OMX_U32 delay_frames_;
+  OMX_U32 window_;
+  float * p_delay_;
+  OMX_U32 delay_pos_;
+  OMX_U64 frame_idx_;
+  OMX_U64 * p_dq_idx_;
+  float * p_dq_val_;
+  OMX_U32 dq_head_;
+  OMX_U32 dq_count_;
+  float * p_box_;
+  OMX_U32 box_pos_;
+  double box_sum_;
+  float env_;
+  float release_coef_;
+  float * p_frame_;
+};
+
+static void
+init_biquads (ar_loudness_t * ap_ld, const OMX_U32 a_rate)
+{
+  /* ITU-R BS.1770 K-weighting, re-derived for any sample rate */
+  const double f0_shelf = 1681.974450955533;
+  const double g_shelf = 3.999843853973347;
+  const double q_shelf = 0.7071752369554196;
+  const double f0_hpf = 38.13547087602444;
+  const double q_hpf = 0.5003270373238773;
+  double k = tan (M_PI * f0_shelf / a_rate);
+  double vh = pow (10.0, g_shelf / 20.0);
+  double vb = pow (vh, 0.4996667741545416);
+  double a0 = 1.0 + k / q_shelf + k * k;
+
+  ap_ld->shelf_.b0 = (vh + vb * k / q_shelf + k * k) / a0;
+  ap_ld->shelf_.b1 = 2.0 * (k * k - vh) / a0;
+  ap_ld->shelf_.b2 = (vh - vb * k / q_shelf + k * k) / a0;
+  ap_ld->shelf_.a1 = 2.0 * (k * k - 1.0) / a0;
+  ap_ld->shelf_.a2 = (1.0 - k / q_shelf + k * k) / a0;
+
+  k = tan (M_PI * f0_hpf / a_rate);
+  a0 = 1.0 + k / q_hpf + k * k;
+  ap_ld->hpf_.b0 = 1.0;
+  ap_ld->hpf_.b1 = -2.0;
+  ap_ld->hpf_.b2 = 1.0;
+  ap_ld->hpf_.a1 = 2.0 * (k * k - 1.0) / a0;
+  ap_ld->hpf_.a2 = (1.0 - k / q_hpf + k * k) / a0;
+}
+
+static inline double
+biquad (const ar_loudness_biquad_t * ap_bq, double * ap_z, const double a_x)
+{
+  const double y = ap_bq->b0 * a_x + ap_z[0];
+  ap_z[0] = ap_bq->b1 * a_x - ap_bq->a1 * y + ap_z[1];
+  ap_z[1] = ap_bq->b2 * a_x - ap_bq->a2 * y;
+  return y;
+}
+
+static inline double
+energy_to_lufs (const double a_energy)
+{
+  return -0.691 + 10.0 * log10 (a_energy);
+}
+
+static void
+reset_measurement (ar_loudness_t * ap_ld)
+{
+  assert (ap_ld);
+  ap_ld->subblock_pos_ = 0;
+  ap_ld->subblock_sum_ = 0.0;
+  ap_ld->subblock_count_ = 0;
+  ap_ld->gated_sum_ = 0.0;
+  ap_ld->gated_count_ = 0;
+  memset (ap_ld->subblocks_, 0, sizeof (ap_ld->subblocks_));
+  memset (ap_ld->hist_, 0, sizeof (ap_ld->hist_));
+  memset (ap_ld->p_state_, 0, sizeof (double) * 4 * ap_ld->channels_);
+}
+
+static void
+start_gain_ramp (ar_loudness_t * ap_ld)
+{
+  double max_step = 0.0;
+  double step = 0.0;
+
+  assert (ap_ld);
+
+  if (!ap_ld->measuring_)
+    {
+      /* Fixed gains are reached in one sub-block */
+      ap_ld->gain_db_ = ap_ld->desired_db_;
+    }
+  else
+    {
+      max_step = ap_ld->subblock_count_ < AR_LOUDNESS_FAST_SUBBLOCKS
+                   ? AR_LOUDNESS_FAST_SLEW_DB
+                   : AR_LOUDNESS_SLOW_SLEW_DB;
+      step = ap_ld->desired_db_ - ap_ld->gain_db_;
+      step = step > max_step ? max_step
+                             : (step < -max_step ? -max_step : step);
+      ap_ld->gain_db_ += step;
+    }
+
+  ap_ld->gain_target_ = (float) pow (10.0, ap_ld->gain_db_ / 20.0);
+  ap_ld->gain_step_ = (ap_ld->gain_target_ - ap_ld->gain_)
+                      / (float) ap_ld->subblock_frames_;
+  ap_ld->ramp_left_ = ap_ld->subblock_frames_;
+}
+
+static void
+end_subblock (ar_loudness_t * ap_ld)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_ld);
+
+  memmove (ap_ld->subblocks_, ap_ld->subblocks_ + 1,
+           sizeof (double) * (AR_LOUDNESS_SUBBLOCKS_PER_BLOCK - 1));
+  ap_ld->subblocks_[AR_LOUDNESS_SUBBLOCKS_PER_BLOCK - 1]
+    = ap_ld->subblock_sum_ / ap_ld->subblock_frames_;
+  ap_ld->subblock_sum_ = 0.0;
+  ap_ld->subblock_pos_ = 0;
+  ap_ld->subblock_count_++;
+
+  if (ap_ld->subblock_count_ >= AR_LOUDNESS_SUBBLOCKS_PER_BLOCK)
+    {
+      double energy = 0.0;
+      double lufs = 0.0;
+      for (i = 0; i < AR_LOUDNESS_SUBBLOCKS_PER_BLOCK; ++i)
+        {
+          energy += ap_ld->subblocks_[i];
+        }
+      energy /= AR_LOUDNESS_SUBBLOCKS_PER_BLOCK;
+      lufs = energy > 0.0 ? energy_to_lufs (energy) : -HUGE_VAL;
+      if (lufs > AR_LOUDNESS_ABSOLUTE_GATE)
+        {
+          int bin = (int) ((lufs - AR_LOUDNESS_ABSOLUTE_GATE) * 10.0);
+          ap_ld->hist_[MIN (bin, AR_LOUDNESS_HIST_BINS - 1)]++;
+          ap_ld->gated_sum_ += energy;
+          ap_ld->gated_count_++;
+        }
+    }
+
+  if (ap_ld->measuring_ && ap_ld->gated_count_ >= AR_LOUDNESS_MIN_BLOCKS)
+    {
+      const double gain = ap_ld->target_db_ - ar_loudness_integrated (ap_ld);
+      ap_ld->desired_db_ = MAX (AR_LOUDNESS_MAX_CUT_DB,
+                                MIN (AR_LOUDNESS_MAX_BOOST_DB, gain));
+    }
+
+  if (ap_ld->desired_db_ != ap_ld->gain_db_)
+    {
+      start_gain_ramp (ap_ld);
+    }
+}
+
+static inline float
+limiter_gain (ar_loudness_t * ap_ld, const float a_peak)
+{
+  const float need
+    = a_peak > AR_LOUDNESS_CEILING ? AR_LOUDNESS_CEILING / a_peak : 1.0f;
+  const OMX_U32 cap = ap_ld->window_;
+  float avg = 0.0f;
+
+  /* Sliding minimum: a monotonic queue of (frame, gain) pairs */
+  if (ap_ld->dq_count_ > 0
+      && ap_ld->p_dq_idx_[ap_ld->dq_head_] + cap <= ap_ld->frame_idx_)
+    {
+      ap_ld->dq_head_ = (ap_ld->dq_head_ + 1) % cap;
+      ap_ld->dq_count_--;
+    }
+  while (ap_ld->dq_count_ > 0
+         && ap_ld->p_dq_val_[(ap_ld->dq_head_ + ap_ld->dq_count_ - 1) % cap]
+              >= need)
+    {
+      ap_ld->dq_count_--;
+    }
+  ap_ld->p_dq_idx_[(ap_ld->dq_head_ + ap_ld->dq_count_) % cap]
+    = ap_ld->frame_idx_;
+  ap_ld->p_dq_val_[(ap_ld->dq_head_ + ap_ld->dq_count_) % cap] = need;
+  ap_ld->dq_count_++;
+  ap_ld->frame_idx_++;
+
+  /* Moving average of the minimum */
+  ap_ld->box_sum_ += ap_ld->p_dq_val_[ap_ld->dq_head_]
+                     - ap_ld->p_box_[ap_ld->box_pos_];
+  ap_ld->p_box_[ap_ld->box_pos_] = ap_ld->p_dq_val_[ap_ld->dq_head_];
+  ap_ld->box_pos_ = (ap_ld->box_pos_ + 1) % cap;
+  avg = (float) (ap_ld->box_sum_ / cap);
+
+  /* Attack is already smooth; slow down the release */
+  if (avg < ap_ld->env_)
+    {
+      ap_ld->env_ = avg;
+    }
+  else
+    {
+      ap_ld->env_ += (avg - ap_ld->env_) * ap_ld->release_coef_;
+    }
+  return ap_ld->env_;
+}
+
+static inline void
+process_frame (ar_loudness_t * ap_ld, float * ap_frame)
+{
+  const OMX_U32 channels = ap_ld->channels_;
+  float * p_delayed = ap_ld->p_delay_ + ap_ld->delay_pos_ * channels;
+  double energy = 0.0;
+  float peak = 0.0f;
+  float env = 1.0f;
+  OMX_U32 c = 0;
+
+  for (c = 0; c < channels; ++c)
+    {
+      double * p_z = ap_ld->p_state_ + c * 4;
+      const double y = biquad (&ap_ld->hpf_, p_z + 2,
+                               biquad (&ap_ld->shelf_, p_z, ap_frame[c]));
+      energy += y * y;
+    }
+  ap_ld->subblock_sum_ += energy;
+
+  if (ap_ld->ramp_left_ > 0)
+    {
+      ap_ld->gain_ = --ap_ld->ramp_left_ > 0
+                       ? ap_ld->gain_ + ap_ld->gain_step_
+                       : ap_ld->gain_target_;
+    }
+
+  for (c = 0; c < channels; ++c)
+    {
+      const float x = ap_frame[c] * ap_ld->gain_;
+      const float a = fabsf (x);
+      peak = a > peak ? a : peak;
+      ap_frame[c] = x;
+    }
+
+  env = limiter_gain (ap_ld, peak);
+
+  for (c = 0; c < channels; ++c)
+    {
+      const float x = ap_frame[c];
+      ap_frame[c] = p_delayed[c] * env;
+      p_delayed[c] = x;
+    }
+  ap_ld->delay_pos_ = (ap_ld->delay_pos_ + 1) % ap_ld->delay_frames_;
+
+  if (++ap_ld->subblock_pos_ == ap_ld->subblock_frames_)
+    {
+      end_subblock (ap_ld);
+    }
+}
+
+OMX_ERRORTYPE
+ar_loudness_init (ar_loudness_t ** app_ld, const OMX_U32 a_rate,
+                  const OMX_U32 a_channels)
+{
+  ar_loudness_t * p_ld = NULL;
+  OMX_U32 i = 0;
+
+  assert (app_ld);
+  assert (a_rate > 0);
+  assert (a_channels > 0);
+
+  p_ld = tiz_mem_calloc (1, sizeof (ar_loudness_t));
+  tiz_check_null_ret_oom (p_ld);
+
+  p_ld->channels_ = a_channels;
+  p_ld->subblock_frames_ = MAX (1, a_rate * AR_LOUDNESS_SUBBLOCK_MS / 1000);
+  p_ld->delay_frames_ = MAX (1, a_rate * AR_LOUDNESS_LOOKAHEAD_MS / 1000);
+  p_ld->window_ = p_ld->delay_frames_ + 1;
+  p_ld->release_coef_
+    = 1.0f - expf (-1.0f / (a_rate * AR_LOUDNESS_RELEASE_MS / 1000.0f));
+  p_ld->gain_ = p_ld->gain_target_ = 1.0f;
+  p_ld->env_ = 1.0f;
+  p_ld->target_db_ = AR_LOUDNESS_REFERENCE_MLUFS / 1000.0;
+
+  p_ld->p_state_ = tiz_mem_calloc (4 * a_channels, sizeof (double));
+  p_ld->p_delay_
+    = tiz_mem_calloc (p_ld->delay_frames_ * a_channels, sizeof (float));
+  p_ld->p_dq_idx_ = tiz_mem_calloc (p_ld->window_, sizeof (OMX_U64));
+  p_ld->p_dq_val_ = tiz_mem_calloc (p_ld->window_, sizeof (float));
+  p_ld->p_box_ = tiz_mem_calloc (p_ld->window_, sizeof (float));
+  p_ld->p_frame_ = tiz_mem_calloc (a_channels, sizeof (float));
+  if (!p_ld->p_state_ || !p_ld->p_delay_ || !p_ld->p_dq_idx_
+      || !p_ld->p_dq_val_ || !p_ld->p_box_ || !p_ld->p_frame_)
+    {
+      ar_loudness_destroy (p_ld);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  init_biquads (p_ld, a_rate);
+  for (i = 0; i < AR_LOUDNESS_HIST_BINS; ++i)
+    {
+      /* The energy at the centre of each bin */
+      p_ld->bin_energy_[i]
+        = pow (10.0, (AR_LOUDNESS_ABSOLUTE_GATE + (i + 0.5) / 10.0 + 0.691)
+                       / 10.0);
+    }
+  ar_loudness_reset (p_ld);
+
+  *app_ld = p_ld;
+  return OMX_ErrorNone;
+}
+
+void
+ar_loudness_destroy (ar_loudness_t * ap_ld)
+{
+  if (ap_ld)
+    {
+      tiz_mem_free (ap_ld->p_state_);
+      tiz_mem_free (ap_ld->p_delay_);
+      tiz_mem_free (ap_ld->p_dq_idx_);
+      tiz_mem_free (ap_ld->p_dq_val_);
+      tiz_mem_free (ap_ld->p_box_);
+      tiz_mem_free (ap_ld->p_frame_);
+      tiz_mem_free (ap_ld);
+    }
+}
+
+void
+ar_loudness_reset (ar_loudness_t * ap_ld)
+{
+  OMX_U32 i = 0;
+  assert (ap_ld);
+  reset_measurement (ap_ld);
+  memset (ap_ld->p_delay_, 0,
+          sizeof (float) * ap_ld->delay_frames_ * ap_ld->channels_);
+  ap_ld->delay_pos_ = 0;
+  ap_ld->frame_idx_ = 0;
+  ap_ld->dq_head_ = 0;
+  ap_ld->dq_count_ = 0;
+  for (i = 0; i < ap_ld->window_; ++i)
+    {
+      ap_ld->p_box_[i] = 1.0f;
+    }
+  ap_ld->box_pos_ = 0;
+  ap_ld->box_sum_ = ap_ld->window_;
+  ap_ld->env_ = 1.0f;
+}
+
+void
+ar_loudness_set_gain (ar_loudness_t * ap_ld, const OMX_S32 a_gain_mb,
+                      const double a_peak)
+{
+  double gain_db = a_gain_mb / 100.0;
+  assert (ap_ld);
+  if (a_peak > 0.0)
+    {
+      /* Don't let the known peak hit the limiter */
+      const double headroom_db
+        = 20.0 * log10 (AR_LOUDNESS_CEILING / a_peak);
+      gain_db = MIN (gain_db, headroom_db);
+    }
+  ap_ld->measuring_ = false;
+  ap_ld->desired_db_ = MAX (AR_LOUDNESS_MAX_CUT_DB,
+                            MIN (AR_LOUDNESS_MAX_BOOST_DB, gain_db));
+  reset_measurement (ap_ld);
+}
+
+void
+ar_loudness_set_target (ar_loudness_t * ap_ld, const OMX_S32 a_target_mlufs)
+{
+  assert (ap_ld);
+  /* The current gain is kept until the new track has been measured for a
+     while; consecutive tracks tend to have similar loudness. */
+  ap_ld->measuring_ = true;
+  ap_ld->target_db_ = a_target_mlufs / 1000.0;
+  reset_measurement (ap_ld);
+}
+
+void
+ar_loudness_process_s16 (ar_loudness_t * ap_ld, OMX_S16 * ap_pcm,
+                         const OMX_U32 a_frames)
+{
+  const OMX_U32 channels = ap_ld->channels_;
+  float * p_frame = ap_ld->p_frame_;
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+
+  assert (ap_ld);
+  assert (ap_pcm);
+
+  for (i = 0; i < a_frames; ++i, ap_pcm += channels)
+    {
+      for (c = 0; c < channels; ++c)
+        {
+          p_frame[c] = ap_pcm[c] * (1.0f / 32768.0f);
+        }
+      process_frame (ap_ld, p_frame);
+      for (c = 0; c < channels; ++c)
+        {
+          const long v = lrintf (p_frame[c] * 32768.0f);
+          ap_pcm[c]
+            = (OMX_S16) (v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+        }
+    }
+}
+
+void
+ar_loudness_process_s32 (ar_loudness_t * ap_ld, int32_t * ap_pcm,
+                         const OMX_U32 a_frames)
+{
+  const OMX_U32 channels = ap_ld->channels_;
+  float * p_frame = ap_ld->p_frame_;
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+
+  assert (ap_ld);
+  assert (ap_pcm);
+
+  for (i = 0; i < a_frames; ++i, ap_pcm += channels)
+    {
+      for (c = 0; c < channels; ++c)
+        {
+          p_frame[c] = (float) (ap_pcm[c] * (1.0 / 2147483648.0));
+        }
+      process_frame (ap_ld, p_frame);
+      for (c = 0; c < channels; ++c)
+        {
+          const double v = p_frame[c] * 2147483648.0;
+          ap_pcm[c] = (int32_t) (v >= 2147483647.0
+                                   ? 2147483647
+                                   : (v <= -2147483648.0 ? -2147483647 - 1
+                                                         : llrint (v)));
+        }
+    }
+}
+
+void
+ar_loudness_process_f32 (ar_loudness_t * ap_ld, float * ap_pcm,
+                         const OMX_U32 a_frames)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_ld);
+  assert (ap_pcm);
+
+  for (i = 0; i < a_frames; ++i, ap_pcm += ap_ld->channels_)
+    {
+      process_frame (ap_ld, ap_pcm);
+    }
+}
+
+double
+ar_loudness_integrated (const ar_loudness_t * ap_ld)
+{
+  double relative_gate = 0.0;
+  double energy = 0.0;
+  OMX_U32 count = 0;
+  int i = 0;
+
+  assert (ap_ld);
+
+  if (0 == ap_ld->gated_count_)
+    {
+      return -HUGE_VAL;
+    }
+
+  relative_gate = energy_to_lufs (ap_ld->gated_sum_ / ap_ld->gated_count_)
+                  + AR_LOUDNESS_RELATIVE_GATE;
+  i = (int) ceil ((relative_gate - AR_LOUDNESS_ABSOLUTE_GATE) * 10.0);
+  for (i = MAX (i, 0); i < AR_LOUDNESS_HIST_BINS; ++i)
+    {
+      energy += ap_ld->hist_[i] * ap_ld->bin_energy_[i];
+      count += ap_ld->hist_[i];
+    }
+
+  return count > 0 ? energy_to_lufs (energy / count) : -HUGE_VAL;
+}
+
+double
+ar_loudness_gain_db (const ar_loudness_t * ap_ld)
+{
+  assert (ap_ld);
+  return ap_ld->gain_db_;
+}
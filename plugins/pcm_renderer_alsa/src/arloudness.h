@@ -0,0 +1,112 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arloudness.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA Audio Renderer - loudness normalisation
+ *
+ * Applies a gain to the PCM stream followed by a look-ahead peak limiter. The
+ * gain is either fixed (e.g. from ReplayGain or R128 tags) or derived from
+ * the integrated loudness of the stream (ITU-R BS.1770 / EBU R128), measured
+ * as it plays with a 0.1 LU gating histogram. The limiter delays the signal by
+ * AR_LOUDNESS_LOOKAHEAD_MS.
+ *
+ */
+
+#ifndef ARLOUDNESS_H
+#define ARLOUDNESS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#define AR_LOUDNESS_LOOKAHEAD_MS 5
+/* ReplayGain 2.0 reference level */
+#define AR_LOUDNESS_REFERENCE_MLUFS -18000
+
+typedef struct ar_loudness ar_loudness_t;
+
+OMX_ERRORTYPE
+ar_loudness_init (ar_loudness_t ** app_ld, const OMX_U32 a_rate,
+                  const OMX_U32 a_channels);
+
+void
+ar_loudness_destroy (ar_loudness_t * ap_ld);
+
+/**
+ * Discard the measurement and the look-ahead delay line (e.g. on flush). The
+ * current gain is kept.
+ */
+void
+ar_loudness_reset (ar_loudness_t * ap_ld);
+
+/**
+ * Apply a fixed gain, in millibels. If a_peak (linear, 1.0 = full scale) is
+ * known, the gain is reduced so that the peak does not exceed the limiter's
+ * ceiling.
+ */
+void
+ar_loudness_set_gain (ar_loudness_t * ap_ld, const OMX_S32 a_gain_mb,
+                      const double a_peak);
+
+/**
+ * Start measuring a new track and bring it to a_target_mlufs.
+ */
+void
+ar_loudness_set_target (ar_loudness_t * ap_ld, const OMX_S32 a_target_mlufs);
+
+/**
+ * In-place processing of interleaved frames.
+ */
+void
+ar_loudness_process_s16 (ar_loudness_t * ap_ld, OMX_S16 * ap_pcm,
+                         const OMX_U32 a_frames);
+
+void
+ar_loudness_process_s32 (ar_loudness_t * ap_ld, int32_t * ap_pcm,
+                         const OMX_U32 a_frames);
+
+void
+ar_loudness_process_f32 (ar_loudness_t * ap_ld, float * ap_pcm,
+                         const OMX_U32 a_frames);
+
+/**
+ * Integrated loudness measured so far, in LUFS; -HUGE_VAL if none yet.
+ */
+double
+ar_loudness_integrated (const ar_loudness_t * ap_ld);
+
+/**
+ * The gain currently applied, in dB.
+ */
+double
+ar_loudness_gain_db (const ar_loudness_t * ap_ld);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARLOUDNESS_H */
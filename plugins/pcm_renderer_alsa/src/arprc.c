@@ -32,14 +32,19 @@
 
 #include <assert.h>
 #include <errno.h>
-#include <math.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <byteswap.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include <tizutils.h>
 #include <tizkernel.h>
+#include <tizstats.h>
 
 #include "ar.h"
 #include "arprc.h"
@@ -198,6 +203,16 @@ check_alsa_support_pcm_format (ar_prc_t * ap_prc,
               *ap_snd_pcm_format = SND_PCM_FORMAT_FLOAT_LE;
             }
             break;
+          case SND_PCM_FORMAT_S32_LE:
+            {
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S32_BE;
+            }
+            break;
+          case SND_PCM_FORMAT_S32_BE:
+            {
+              *ap_snd_pcm_format = SND_PCM_FORMAT_S32_LE;
+            }
+            break;
           case SND_PCM_FORMAT_S24:
             {
               *ap_snd_pcm_format = SND_PCM_FORMAT_S24_BE;
@@ -272,12 +287,29 @@ retrieve_alsa_pcm_format_and_num_channels (ar_prc_t * ap_prc,
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamAudioPcm, &ap_prc->pcmmode_));
 
+  {
+    OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE sampleformat;
+    TIZ_INIT_OMX_PORT_STRUCT (sampleformat,
+                              ARATELIA_AUDIO_RENDERER_PORT_INDEX);
+    tiz_check_omx (tiz_api_GetParameter (
+      tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+      OMX_TizoniaIndexParamAudioSampleFormat, &sampleformat));
+    ap_prc->sample_format_ = sampleformat.eFormat;
+  }
+
   if (ap_prc->pcmmode_.nBitPerSample == 24)
     {
       *ap_snd_pcm_format = ap_prc->pcmmode_.eEndian == OMX_EndianLittle
                              ? SND_PCM_FORMAT_S24
                              : SND_PCM_FORMAT_S24_BE;
     }
+  else if (ap_prc->pcmmode_.nBitPerSample == 32
+           && OMX_AUDIO_SampleFormatS32 == ap_prc->sample_format_)
+    {
+      *ap_snd_pcm_format = ap_prc->pcmmode_.eEndian == OMX_EndianLittle
+                             ? SND_PCM_FORMAT_S32_LE
+                             : SND_PCM_FORMAT_S32_BE;
+    }
   /* NOTE: this is to allow float pcm streams coming from the the vorbis or
      opusfile decoders */
   else if (ap_prc->pcmmode_.nBitPerSample == 32)
@@ -370,6 +402,39 @@ get_alsa_mixer (ar_prc_t * ap_prc)
                                  : ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_MIXER;
 }
 
+static unsigned int
+get_alsa_time_setting (const char * ap_key, const unsigned int a_default)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  const char * p_value = NULL;
+
+  assert (ap_key);
+
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_AUDIO_RENDERER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  if (p_value)
+    {
+      char * p_end = NULL;
+      const unsigned long value = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value && value > 0 && value <= UINT_MAX)
+        {
+          return (unsigned int) value;
+        }
+    }
+  return a_default;
+}
+
+static bool
+want_mmap_access (void)
+{
+  const char * p_mode
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            ARATELIA_AUDIO_RENDERER_COMPONENT_NAME
+                            ".access_mode");
+  return (p_mode && 0 == strcasecmp (p_mode, "mmap"));
+}
+
 static bool
 using_null_alsa_device (ar_prc_t * ap_prc)
 {
@@ -379,6 +444,104 @@ using_null_alsa_device (ar_prc_t * ap_prc)
                       OMX_MAX_STRINGNAME_SIZE));
 }
 
+static OMX_ERRORTYPE
+set_alsa_pcm_params (ar_prc_t * ap_prc,
+                     const snd_pcm_format_t a_snd_pcm_format)
+{
+  snd_pcm_t * p_pcm = NULL;
+  snd_pcm_hw_params_t * p_hw_params = NULL;
+  snd_pcm_sw_params_t * p_sw_params = NULL;
+  unsigned int rate = 0;
+  unsigned int buffer_time = 0;
+  unsigned int period_time = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_pcm_);
+  assert (ap_prc->p_hw_params_);
+
+  p_pcm = ap_prc->p_pcm_;
+  p_hw_params = ap_prc->p_hw_params_;
+  rate = ap_prc->pcmmode_.nSamplingRate;
+  buffer_time = get_alsa_time_setting (
+    "buffer_time", ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME);
+  period_time = get_alsa_time_setting (
+    "period_time", ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME);
+  if (period_time > buffer_time / 2)
+    {
+      period_time = buffer_time / 2;
+    }
+
+  /* Allow alsa-lib resampling */
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_set_rate_resample (p_pcm, p_hw_params, 1));
+
+  ap_prc->mmap_access_ = false;
+  if (want_mmap_access ())
+    {
+      if (0
+          == snd_pcm_hw_params_set_access (p_pcm, p_hw_params,
+                                           SND_PCM_ACCESS_MMAP_INTERLEAVED))
+        {
+          ap_prc->mmap_access_ = true;
+        }
+      else
+        {
+          TIZ_NOTICE (handleOf (ap_prc),
+                      "mmap access not supported by [%s]; using read/write",
+                      get_alsa_device (ap_prc));
+        }
+    }
+  if (!ap_prc->mmap_access_)
+    {
+      bail_on_snd_pcm_error (snd_pcm_hw_params_set_access (
+        p_pcm, p_hw_params, SND_PCM_ACCESS_RW_INTERLEAVED));
+    }
+
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_set_format (p_pcm, p_hw_params, a_snd_pcm_format));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_channels (
+    p_pcm, p_hw_params, ap_prc->num_channels_supported_));
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_set_rate_near (p_pcm, p_hw_params, &rate, 0));
+  if (rate != ap_prc->pcmmode_.nSamplingRate)
+    {
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "Sampling rate [%u] not available; using [%u]",
+                  (unsigned int) ap_prc->pcmmode_.nSamplingRate, rate);
+    }
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_buffer_time_near (
+    p_pcm, p_hw_params, &buffer_time, 0));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_period_time_near (
+    p_pcm, p_hw_params, &period_time, 0));
+  bail_on_snd_pcm_error (snd_pcm_hw_params (p_pcm, p_hw_params));
+
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_get_buffer_size (p_hw_params, &ap_prc->buffer_size_));
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_get_period_size (p_hw_params, &ap_prc->period_size_, 0));
+
+  /* Start once the ring is full (in whole periods) and wake up whenever there
+     is room for a period */
+  ap_prc->start_threshold_
+    = (ap_prc->buffer_size_ / ap_prc->period_size_) * ap_prc->period_size_;
+  snd_pcm_sw_params_alloca (&p_sw_params);
+  bail_on_snd_pcm_error (snd_pcm_sw_params_current (p_pcm, p_sw_params));
+  bail_on_snd_pcm_error (snd_pcm_sw_params_set_start_threshold (
+    p_pcm, p_sw_params, ap_prc->start_threshold_));
+  bail_on_snd_pcm_error (snd_pcm_sw_params_set_avail_min (
+    p_pcm, p_sw_params, ap_prc->period_size_));
+  bail_on_snd_pcm_error (snd_pcm_sw_params (p_pcm, p_sw_params));
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "access [%s] buffer [%lu frames - %u us] "
+              "period [%lu frames - %u us]",
+              ap_prc->mmap_access_ ? "mmap" : "rw",
+              (unsigned long) ap_prc->buffer_size_, buffer_time,
+              (unsigned long) ap_prc->period_size_, period_time);
+
+  return OMX_ErrorNone;
+}
+
 static inline OMX_ERRORTYPE
 start_io_watcher (ar_prc_t * ap_prc)
 {
@@ -418,6 +581,7 @@ release_header (ar_prc_t * ap_prc)
                                              ARATELIA_AUDIO_RENDERER_PORT_INDEX,
                                              ap_prc->p_inhdr_));
       ap_prc->p_inhdr_ = NULL;
+      ap_prc->inhdr_processed_ = false;
     }
   return OMX_ErrorNone;
 }
@@ -432,68 +596,124 @@ do_flush (ar_prc_t * ap_prc)
     {
       (void) snd_pcm_drop (ap_prc->p_pcm_);
     }
+  if (ap_prc->p_loudness_)
+    {
+      ar_loudness_reset (ap_prc->p_loudness_);
+    }
   /* Release any buffers held  */
   return release_header (ap_prc);
 }
 
-static float
-sint_to_float (const int a_sample)
+static void
+process_loudness (ar_prc_t * ap_prc, OMX_U8 * ap_pcm,
+                  const snd_pcm_uframes_t a_frames)
 {
-  float f;
-  if (a_sample >= 0)
+  if (32 == ap_prc->pcmmode_.nBitPerSample
+      && OMX_AUDIO_SampleFormatS32 == ap_prc->sample_format_)
+    {
+      ar_loudness_process_s32 (ap_prc->p_loudness_, (int32_t *) ap_pcm,
+                               a_frames);
+    }
+  else if (32 == ap_prc->pcmmode_.nBitPerSample)
     {
-      f = a_sample / 32767.0;
+      ar_loudness_process_f32 (ap_prc->p_loudness_, (float *) ap_pcm,
+                               a_frames);
     }
   else
     {
-      f = a_sample / 32768.0;
+      ar_loudness_process_s16 (ap_prc->p_loudness_, (OMX_S16 *) ap_pcm,
+                               a_frames);
     }
-  return f;
 }
 
-static int
-float_to_sint (const float a_sample)
+static void
+apply_loudness (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
+                const snd_pcm_uframes_t a_samples_per_channel)
 {
-  float f;
-  f = a_sample * 32767;
-  if (f < -32768)
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  if (ap_prc->loudness_on_)
+    {
+      process_loudness (ap_prc, ap_hdr->pBuffer + ap_hdr->nOffset,
+                        a_samples_per_channel);
+    }
+}
+
+static OMX_ERRORTYPE
+apply_loudness_config (ar_prc_t * ap_prc)
+{
+  OMX_TIZONIA_AUDIO_CONFIG_LOUDNESSTYPE loudness;
+  OMX_S32 shift_mb = 0;
+  bool use_album = false;
+  bool use_track = false;
+
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (loudness, ARATELIA_AUDIO_RENDERER_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetConfig (
+    tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+    OMX_TizoniaIndexConfigAudioLoudness, &loudness));
+
+  ap_prc->loudness_on_ = false;
+  if (!ap_prc->p_loudness_ || OMX_AUDIO_LoudnessOff == loudness.eMode)
+    {
+      return OMX_ErrorNone;
+    }
+
+  /* Tag gains take the track to the ReplayGain reference level */
+  shift_mb = (loudness.nTargetmLUFS - AR_LOUDNESS_REFERENCE_MLUFS) / 10;
+  use_album = loudness.bAlbumGain
+              && (OMX_AUDIO_LoudnessAlbum == loudness.eMode
+                  || (OMX_AUDIO_LoudnessTrack == loudness.eMode
+                      && !loudness.bTrackGain));
+  use_track = !use_album && loudness.bTrackGain
+              && OMX_AUDIO_LoudnessMeasure != loudness.eMode;
+
+  if (use_album)
+    {
+      ar_loudness_set_gain (ap_prc->p_loudness_,
+                            loudness.nAlbumGainmB + shift_mb,
+                            loudness.nAlbumPeak / 65536.0);
+    }
+  else if (use_track)
     {
-      f = -32768;
+      ar_loudness_set_gain (ap_prc->p_loudness_,
+                            loudness.nTrackGainmB + shift_mb,
+                            loudness.nTrackPeak / 65536.0);
     }
-  if (f > 32767)
+  else
     {
-      f = 32767;
+      ar_loudness_set_target (ap_prc->p_loudness_, loudness.nTargetmLUFS);
     }
-  return (int) f;
+  ap_prc->loudness_on_ = true;
+
+  TIZ_NOTICE (handleOf (ap_prc), "Loudness : %s (target %d mLUFS)",
+              use_album ? "album gain"
+                        : (use_track ? "track gain" : "measuring"),
+              loudness.nTargetmLUFS);
+  return OMX_ErrorNone;
 }
 
-static void
-adjust_gain (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
-             const snd_pcm_uframes_t a_samples_per_channel)
+static OMX_ERRORTYPE
+init_loudness (ar_prc_t * ap_prc)
 {
   assert (ap_prc);
-  assert (ap_hdr);
 
-  if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE != ap_prc->gain_)
+  ar_loudness_destroy (ap_prc->p_loudness_);
+  ap_prc->p_loudness_ = NULL;
+  ap_prc->loudness_on_ = false;
+
+  /* S16, S32 and F32 only (see retrieve_alsa_pcm_format_and_num_channels) */
+  if ((16 == ap_prc->pcmmode_.nBitPerSample
+       || 32 == ap_prc->pcmmode_.nBitPerSample)
+      && OMX_EndianLittle == ap_prc->pcmmode_.eEndian)
     {
-      int i;
-      int gainadj = (int) (ap_prc->gain_ * 256.);
-      float gain = pow (10., gainadj / 5120.);
-      /*       gain = 3.1f; */
-      /*       fprintf (stderr, "%f samples %ld\n", gain, a_samples_per_channel); */
-      OMX_S16 * pcm = (OMX_S16 *) (ap_hdr->pBuffer + ap_hdr->nOffset);
-      for (i = 0; i < a_samples_per_channel; i++)
-        {
-          float f = sint_to_float (*pcm);
-          f *= gain;
-          int v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-          f = sint_to_float (*pcm);
-          f *= gain;
-          v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-        }
+      tiz_check_omx (ar_loudness_init (&ap_prc->p_loudness_,
+                                       ap_prc->pcmmode_.nSamplingRate,
+                                       ap_prc->pcmmode_.nChannels));
     }
+  return apply_loudness_config (ap_prc);
 }
 
 static void
@@ -515,6 +735,26 @@ swap_byte_order_s16 (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
   }
 }
 
+static void
+swap_byte_order_s32 (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
+                     const int a_samples)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+  assert (ap_hdr->pBuffer);
+
+  {
+    /* S32 and float samples alike: only the bytes move */
+    uint32_t * p_pcm = (uint32_t *) (ap_hdr->pBuffer + ap_hdr->nOffset);
+    int i = 0;
+    for (i = 0; i < a_samples; ++i)
+      {
+        *p_pcm = bswap_32 (*p_pcm);
+        p_pcm++;
+      }
+  }
+}
+
 static void
 swap_byte_order (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
@@ -540,6 +780,11 @@ swap_byte_order (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
               swap_byte_order_s16 (ap_prc, ap_hdr, samples);
             }
             break;
+          case 32:
+            {
+              swap_byte_order_s32 (ap_prc, ap_hdr, samples);
+            }
+            break;
           default:
             {
             }
@@ -851,6 +1096,28 @@ arrange_samples_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+recover_alsa_pcm (ar_prc_t * ap_prc, const int a_err)
+{
+  int err = 0;
+  assert (ap_prc);
+
+  /* This should handle -EINTR (interrupted system call), -EPIPE
+   * (overrun or underrun) and -ESTRPIPE (stream is suspended) */
+  if (-EPIPE == a_err)
+    {
+      tiz_stats_underrun (handleOf (ap_prc));
+    }
+  err = snd_pcm_recover (ap_prc->p_pcm_, a_err, 0);
+  if (err < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "snd_pcm_recover error: %s",
+                 snd_strerror (err));
+      return OMX_ErrorUnderflow;
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
@@ -867,8 +1134,14 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
   assert (ap_hdr->nFilledLen > 0);
   samples_per_channel = ap_hdr->nFilledLen / step;
 
-  adjust_gain (ap_prc, ap_hdr, samples_per_channel);
-  swap_byte_order (ap_prc, ap_hdr);
+  /* A header may take several writes to render; process its samples only
+     once */
+  if (!ap_prc->inhdr_processed_)
+    {
+      apply_loudness (ap_prc, ap_hdr, samples_per_channel);
+      swap_byte_order (ap_prc, ap_hdr);
+      ap_prc->inhdr_processed_ = true;
+    }
 
   while (samples_per_channel > 0 && OMX_ErrorNone == rc)
     {
@@ -887,15 +1160,7 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
         }
       else if (err < 0)
         {
-          /* This should handle -EINTR (interrupted system call), -EPIPE
-           * (overrun or underrun) and -ESTRPIPE (stream is suspended) */
-          err = snd_pcm_recover (ap_prc->p_pcm_, (int) err, 0);
-          if (err < 0)
-            {
-              TIZ_ERROR (handleOf (ap_prc), "snd_pcm_recover error: %s",
-                         snd_strerror ((int) err));
-              rc = OMX_ErrorUnderflow;
-            }
+          rc = recover_alsa_pcm (ap_prc, (int) err);
         }
       else
         {
@@ -908,6 +1173,159 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
   return rc;
 }
 
+/* Copies a_frames frames from the header into the mmap'ed ring, applying the
+   channel up-mix and, if requested, the byte swap on the way */
+static void
+copy_to_area (const ar_prc_t * ap_prc, const OMX_U8 * ap_src,
+              const snd_pcm_channel_area_t * ap_areas,
+              const snd_pcm_uframes_t a_offset,
+              const snd_pcm_uframes_t a_frames, const bool a_swap)
+{
+  const size_t sample_size = ap_prc->pcmmode_.nBitPerSample / 8;
+  const size_t step = sample_size * ap_prc->pcmmode_.nChannels;
+  const bool upmix
+    = ap_prc->pcmmode_.nChannels < ap_prc->num_channels_supported_;
+  unsigned int c = 0;
+
+  for (c = 0; c < ap_prc->num_channels_supported_; ++c)
+    {
+      const snd_pcm_channel_area_t * p_area = &ap_areas[c];
+      const size_t dst_step = p_area->step / 8;
+      OMX_U8 * p_dst = (OMX_U8 *) p_area->addr + p_area->first / 8
+                       + a_offset * dst_step;
+      /* As in arrange_samples_buffer, an up-mix repeats the first channel */
+      const OMX_U8 * p_src = ap_src + (upmix ? 0 : c * sample_size);
+      snd_pcm_uframes_t i = 0;
+
+      if (2 == sample_size)
+        {
+          for (i = 0; i < a_frames; ++i, p_src += step, p_dst += dst_step)
+            {
+              const OMX_S16 v = *((const OMX_S16 *) p_src);
+              *((OMX_S16 *) p_dst) = a_swap ? (OMX_S16) bswap_16 (v) : v;
+            }
+        }
+      else if (4 == sample_size)
+        {
+          for (i = 0; i < a_frames; ++i, p_src += step, p_dst += dst_step)
+            {
+              const uint32_t v = *((const uint32_t *) p_src);
+              *((uint32_t *) p_dst) = a_swap ? bswap_32 (v) : v;
+            }
+        }
+      else
+        {
+          for (i = 0; i < a_frames; ++i, p_src += step, p_dst += dst_step)
+            {
+              memcpy (p_dst, p_src, sample_size);
+            }
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+start_alsa_pcm (ar_prc_t * ap_prc, const bool a_force)
+{
+  assert (ap_prc);
+
+  /* The stream starts by itself once start_threshold_ frames are queued;
+     with mmap access, or at the end of a short stream, it is started here */
+  if (SND_PCM_STATE_PREPARED == snd_pcm_state (ap_prc->p_pcm_))
+    {
+      const snd_pcm_sframes_t avail = snd_pcm_avail_update (ap_prc->p_pcm_);
+      if (a_force
+          || (avail >= 0
+              && ap_prc->buffer_size_ - (snd_pcm_uframes_t) avail
+                   >= ap_prc->start_threshold_))
+        {
+          bail_on_snd_pcm_error (snd_pcm_start (ap_prc->p_pcm_));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+render_buffer_mmap (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  unsigned long int step = 0;
+  snd_pcm_uframes_t frames_left = 0;
+
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  step = (ap_prc->pcmmode_.nBitPerSample / 8) * ap_prc->pcmmode_.nChannels;
+  assert (ap_hdr->nFilledLen > 0);
+  frames_left = ap_hdr->nFilledLen / step;
+
+  if (SND_PCM_STATE_SETUP == snd_pcm_state (ap_prc->p_pcm_))
+    {
+      /* e.g. after a flush */
+      bail_on_snd_pcm_error (snd_pcm_prepare (ap_prc->p_pcm_));
+    }
+
+  /* As in render_buffer, the loudness processor sees every frame exactly
+     once, however many mmap transfers (and retries after a failed commit)
+     the header takes. It runs in the header, in native byte order and with
+     the stream's channel count; the swap and the up-mix are done on the way
+     into the ring */
+  if (!ap_prc->inhdr_processed_)
+    {
+      apply_loudness (ap_prc, ap_hdr, frames_left);
+      ap_prc->inhdr_processed_ = true;
+    }
+
+  while (frames_left > 0 && OMX_ErrorNone == rc)
+    {
+      const snd_pcm_channel_area_t * p_areas = NULL;
+      snd_pcm_uframes_t offset = 0;
+      snd_pcm_uframes_t frames = 0;
+      snd_pcm_sframes_t err = snd_pcm_avail_update (ap_prc->p_pcm_);
+
+      if (err < 0)
+        {
+          rc = recover_alsa_pcm (ap_prc, (int) err);
+          continue;
+        }
+      if (0 == err)
+        {
+          /* the ring is full */
+          tiz_check_omx (start_alsa_pcm (ap_prc, false));
+          rc = OMX_ErrorNoMore;
+          break;
+        }
+
+      frames = MIN (frames_left, (snd_pcm_uframes_t) err);
+      err = snd_pcm_mmap_begin (ap_prc->p_pcm_, &p_areas, &offset, &frames);
+      if (err < 0)
+        {
+          rc = recover_alsa_pcm (ap_prc, (int) err);
+          continue;
+        }
+
+      copy_to_area (ap_prc, ap_hdr->pBuffer + ap_hdr->nOffset, p_areas,
+                    offset, frames, ap_prc->swap_byte_order_);
+
+      err = snd_pcm_mmap_commit (ap_prc->p_pcm_, offset, frames);
+      if (err < 0 || (snd_pcm_uframes_t) err != frames)
+        {
+          rc = recover_alsa_pcm (ap_prc, err < 0 ? (int) err : -EPIPE);
+          continue;
+        }
+
+      ap_hdr->nOffset += frames * step;
+      ap_hdr->nFilledLen -= frames * step;
+      frames_left -= frames;
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      tiz_check_omx (start_alsa_pcm (ap_prc, false));
+    }
+
+  return rc;
+}
+
 static OMX_BUFFERHEADERTYPE *
 get_header (ar_prc_t * ap_prc)
 {
@@ -974,11 +1392,18 @@ render_pcm_data (ar_prc_t * ap_prc)
     {
       if (p_hdr->nFilledLen > 0)
         {
-          rc = render_buffer (ap_prc, p_hdr);
+          rc = ap_prc->mmap_access_ ? render_buffer_mmap (ap_prc, p_hdr)
+                                    : render_buffer (ap_prc, p_hdr);
         }
 
       if (0 == p_hdr->nFilledLen)
         {
+          if ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+            {
+              /* Short streams never reach the start threshold; this also
+                 covers an EOS header that arrives with no data */
+              tiz_check_omx (start_alsa_pcm (ap_prc, true));
+            }
           tiz_check_omx (buffer_emptied (ap_prc));
           p_hdr = NULL;
         }
@@ -1005,6 +1430,10 @@ ar_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_pcm_name_ = NULL;
   p_prc->p_mixer_name_ = NULL;
   p_prc->swap_byte_order_ = false;
+  p_prc->mmap_access_ = false;
+  p_prc->buffer_size_ = 0;
+  p_prc->period_size_ = 0;
+  p_prc->start_threshold_ = 0;
   p_prc->num_channels_supported_ = 0;
   p_prc->p_sample_buf_ = NULL;
   p_prc->descriptor_count_ = 0;
@@ -1016,12 +1445,14 @@ ar_prc_ctor (void * ap_prc, va_list * app)
   p_prc->port_disabled_ = false;
   p_prc->awaiting_io_ev_ = false;
   p_prc->nflags_ = 0;
-  p_prc->gain_ = ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE;
   p_prc->volume_ = ARATELIA_AUDIO_RENDERER_DEFAULT_VOLUME_VALUE;
   p_prc->ramp_enabled_ = false;
   p_prc->ramp_step_ = 0;
   p_prc->ramp_step_count_ = ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT;
   p_prc->ramp_volume_ = 0;
+  p_prc->p_loudness_ = NULL;
+  p_prc->loudness_on_ = false;
+  p_prc->inhdr_processed_ = false;
   return p_prc;
 }
 
@@ -1115,13 +1546,15 @@ ar_prc_prepare_to_transfer (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       tiz_check_omx (retrieve_alsa_pcm_format_and_num_channels (
         p_prc, &snd_pcm_format, &p_prc->num_channels_supported_));
 
-      /* This sets the hardware and software parameters in a convenient way. */
-      bail_on_snd_pcm_error (snd_pcm_set_params (
-        p_prc->p_pcm_, snd_pcm_format, SND_PCM_ACCESS_RW_INTERLEAVED,
-        (unsigned int) p_prc->num_channels_supported_,
-        p_prc->pcmmode_.nSamplingRate, 0, /* allow alsa-lib resampling */
-        100000                            /* overall latency in us */
-        ));
+      if (OMX_ErrorNone != init_loudness (p_prc))
+        {
+          /* Not a big deal, the stream is rendered as-is */
+          TIZ_NOTICE (handleOf (p_prc),
+                      "Could not set up loudness normalisation");
+        }
+
+      /* Access mode, ring and period sizes */
+      tiz_check_omx (set_alsa_pcm_params (p_prc, snd_pcm_format));
 
       bail_on_snd_pcm_error (snd_pcm_poll_descriptors (
         p_prc->p_pcm_, p_prc->p_fds_, p_prc->descriptor_count_));
@@ -1205,6 +1638,10 @@ ar_prc_deallocate_resources (void * ap_prc)
   tiz_buffer_destroy (p_prc->p_sample_buf_);
   p_prc->p_sample_buf_ = NULL;
 
+  ar_loudness_destroy (p_prc->p_loudness_);
+  p_prc->p_loudness_ = NULL;
+  p_prc->loudness_on_ = false;
+
   tiz_mem_free (p_prc->p_pcm_name_);
   p_prc->p_pcm_name_ = NULL;
 
@@ -1405,6 +1842,10 @@ ar_prc_config_change (void * ap_prc, OMX_U32 a_pid, OMX_INDEXTYPE a_config_idx)
                      (mute.bMute == OMX_FALSE ? "FALSE" : "TRUE"));
           toggle_mute (p_prc, mute.bMute == OMX_TRUE ? true : false);
         }
+      else if (OMX_TizoniaIndexConfigAudioLoudness == a_config_idx)
+        {
+          rc = apply_loudness_config (p_prc);
+        }
     }
   return rc;
 }
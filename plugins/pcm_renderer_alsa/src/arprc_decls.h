@@ -38,20 +38,28 @@ extern "C" {
 #include <poll.h>
 
 #include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
 
 #include <tizprc_decls.h>
 
+#include "arloudness.h"
+
 typedef struct ar_prc ar_prc_t;
 struct ar_prc
 {
   /* Object */
   const tiz_prc_t _;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE sample_format_;
   snd_pcm_t * p_pcm_;
   snd_pcm_hw_params_t * p_hw_params_;
   char * p_pcm_name_;
   char * p_mixer_name_;
   bool swap_byte_order_;
+  bool mmap_access_;
+  snd_pcm_uframes_t buffer_size_;
+  snd_pcm_uframes_t period_size_;
+  snd_pcm_uframes_t start_threshold_;
   unsigned int num_channels_supported_;
   tiz_buffer_t * p_sample_buf_;
   int descriptor_count_;
@@ -63,12 +71,14 @@ struct ar_prc
   bool port_disabled_;
   bool awaiting_io_ev_;
   OMX_U32 nflags_;
-  float gain_;
   long volume_;
   bool ramp_enabled_;
   long ramp_step_;
   long ramp_step_count_;
   long ramp_volume_;
+  ar_loudness_t * p_loudness_;
+  bool loudness_on_;
+  bool inhdr_processed_;
 };
 
 typedef struct ar_prc_class ar_prc_class_t;
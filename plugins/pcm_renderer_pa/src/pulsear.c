@@ -43,6 +43,7 @@
 #include <tizscheduler.h>
 
 #include "pulsearprc.h"
+#include "pulsearcfgport.h"
 #include "pulsear.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -114,7 +115,7 @@ static OMX_PTR instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
 
 static OMX_PTR instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
-  return factory_new (tiz_get_type (ap_hdl, "tizconfigport"),
+  return factory_new (tiz_get_type (ap_hdl, "pulsearcfgport"),
                       NULL, /* this port does not take options */
                       ARATELIA_PCM_RENDERER_COMPONENT_NAME,
                       pcm_renderer_version);
@@ -131,7 +132,9 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   tiz_role_factory_t role_factory;
   const tiz_role_factory_t *rf_list[] = { &role_factory };
   tiz_type_factory_t pulsearprc_type;
-  const tiz_type_factory_t *tf_list[] = { &pulsearprc_type };
+  tiz_type_factory_t pulsearcfgport_type;
+  const tiz_type_factory_t *tf_list[] = { &pulsearprc_type,
+                                          &pulsearcfgport_type };
 
   strcpy ((OMX_STRING)role_factory.role, ARATELIA_PCM_RENDERER_DEFAULT_ROLE);
   role_factory.pf_cport = instantiate_config_port;
@@ -144,12 +147,17 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   strcpy ((OMX_STRING)pulsearprc_type.object_name, "pulsearprc");
   pulsearprc_type.pf_object_init = pulsear_prc_init;
 
+  strcpy ((OMX_STRING)pulsearcfgport_type.class_name, "pulsearcfgport_class");
+  pulsearcfgport_type.pf_class_init = pulsear_cfgport_class_init;
+  strcpy ((OMX_STRING)pulsearcfgport_type.object_name, "pulsearcfgport");
+  pulsearcfgport_type.pf_object_init = pulsear_cfgport_init;
+
   /* Initialize the component infrastructure */
   tiz_check_omx (
       tiz_comp_init (ap_hdl, ARATELIA_PCM_RENDERER_COMPONENT_NAME));
 
-  /* Register the "pulsearprc" class */
-  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
+  /* Register the "pulsearprc" and "pulsearcfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 2));
 
   /* Register the component role(s) */
   tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 1));
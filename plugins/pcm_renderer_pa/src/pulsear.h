@@ -54,6 +54,13 @@ extern "C"
 #define ARATELIA_PCM_RENDERER_DEFAULT_VOLUME_VALUE    75
 #define ARATELIA_PCM_RENDERER_DEFAULT_RAMP_STEP_COUNT 10
 
+/* Stream buffering, in microseconds. A prebuffer of 0 means "server
+   default" */
+#define ARATELIA_PCM_RENDERER_DEFAULT_TARGET_LATENCY_US 100000
+#define ARATELIA_PCM_RENDERER_DEFAULT_MIN_REQUEST_US    25000
+#define ARATELIA_PCM_RENDERER_DEFAULT_PREBUFFER_US      0
+#define ARATELIA_PCM_RENDERER_MAX_LATENCY_US            2000000
+
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_APP_NAME    "Tizonia PulseAudio PCM Renderer"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_STREAM_NAME "Tizonia Pulseadio PCM renderer (playback stream)"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME   NULL
@@ -0,0 +1,237 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   pulsearcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PulseAudio PCM Renderer config port implementation
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizscheduler.h>
+
+#include "pulsear.h"
+#include "pulsearcfgport.h"
+#include "pulsearcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_renderer.cfgport"
+#endif
+
+static OMX_U32
+default_value (const char * ap_key, const OMX_U32 a_default)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE];
+  const char * p_value = NULL;
+
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_PCM_RENDERER_COMPONENT_NAME,
+            ap_key);
+  p_value = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+  if (p_value)
+    {
+      char * p_end = NULL;
+      const unsigned long value = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value
+          && value <= ARATELIA_PCM_RENDERER_MAX_LATENCY_US)
+        {
+          return (OMX_U32) value;
+        }
+    }
+  return a_default;
+}
+
+/*
+ * pulsearcfgport class
+ */
+
+static void *
+pulsear_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  pulsear_cfgport_t * p_obj
+    = super_ctor (typeOf (ap_obj, "pulsearcfgport"), ap_obj, app);
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigAudioRendererLatency);
+
+  TIZ_INIT_OMX_PORT_STRUCT (p_obj->latency_,
+                            ARATELIA_PCM_RENDERER_PORT_INDEX);
+  p_obj->latency_.nTargetLatencyUs = default_value (
+    "target_latency", ARATELIA_PCM_RENDERER_DEFAULT_TARGET_LATENCY_US);
+  p_obj->latency_.nMinRequestUs = default_value (
+    "min_request", ARATELIA_PCM_RENDERER_DEFAULT_MIN_REQUEST_US);
+  p_obj->latency_.nPrebufferUs = default_value (
+    "prebuffer", ARATELIA_PCM_RENDERER_DEFAULT_PREBUFFER_US);
+  p_obj->latency_.nLatencyUs = 0;
+  p_obj->latency_.nUnderruns = 0;
+
+  return p_obj;
+}
+
+static void *
+pulsear_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "pulsearcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+pulsear_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const pulsear_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioRendererLatency == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE * p_latency
+        = (OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE *) ap_struct;
+      void * p_prc = tiz_get_prc (ap_hdl);
+      if (ARATELIA_PCM_RENDERER_PORT_INDEX != p_latency->nPortIndex)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      *p_latency = p_obj->latency_;
+      /* Only the processor knows about the stream's current latency and
+         underrun count. So lets get the processor to fill this info for
+         us. */
+      assert (p_prc);
+      if (OMX_ErrorNone
+          != (rc = tiz_api_GetConfig (p_prc, ap_hdl, a_index, ap_struct)))
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[%s] : Error retrieving [%s] "
+                     "from the processor",
+                     tiz_err_to_str (rc), tiz_idx_to_str (a_index));
+        }
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "pulsearcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+pulsear_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  pulsear_cfgport_t * p_obj = (pulsear_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexConfigAudioRendererLatency == a_index)
+    {
+      const OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE * p_latency
+        = (OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE *) ap_struct;
+      if (ARATELIA_PCM_RENDERER_PORT_INDEX != p_latency->nPortIndex)
+        {
+          return OMX_ErrorBadPortIndex;
+        }
+      if (p_latency->nTargetLatencyUs > ARATELIA_PCM_RENDERER_MAX_LATENCY_US
+          || p_latency->nMinRequestUs > ARATELIA_PCM_RENDERER_MAX_LATENCY_US
+          || p_latency->nPrebufferUs > ARATELIA_PCM_RENDERER_MAX_LATENCY_US)
+        {
+          return OMX_ErrorBadParameter;
+        }
+      /* nLatencyUs and nUnderruns are read-only */
+      p_obj->latency_.nTargetLatencyUs = p_latency->nTargetLatencyUs;
+      p_obj->latency_.nMinRequestUs = p_latency->nMinRequestUs;
+      p_obj->latency_.nPrebufferUs = p_latency->nPrebufferUs;
+      TIZ_TRACE (ap_hdl,
+                 "nTargetLatencyUs [%u] nMinRequestUs [%u] nPrebufferUs [%u]",
+                 p_latency->nTargetLatencyUs, p_latency->nMinRequestUs,
+                 p_latency->nPrebufferUs);
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "pulsearcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * pulsear_cfgport_class
+ */
+
+static void *
+pulsear_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "pulsearcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+pulsear_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * pulsearcfgport_class
+    = factory_new (classOf (tizconfigport), "pulsearcfgport_class",
+                   classOf (tizconfigport), sizeof (pulsear_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, pulsear_cfgport_class_ctor, 0);
+  return pulsearcfgport_class;
+}
+
+void *
+pulsear_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * pulsearcfgport_class = tiz_get_type (ap_hdl, "pulsearcfgport_class");
+  TIZ_LOG_CLASS (pulsearcfgport_class);
+  void * pulsearcfgport = factory_new (
+    pulsearcfgport_class, "pulsearcfgport", tizconfigport,
+    sizeof (pulsear_cfgport_t), ap_tos, ap_hdl, ctor, pulsear_cfgport_ctor,
+    dtor, pulsear_cfgport_dtor, tiz_api_GetConfig, pulsear_cfgport_GetConfig,
+    tiz_api_SetConfig, pulsear_cfgport_SetConfig, 0);
+
+  return pulsearcfgport;
+}
@@ -30,13 +30,18 @@
 #include <config.h>
 #endif
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include <tizkernel.h>
 #include <tizscheduler.h>
+#include <tizstats.h>
 
 #include "pulsear.h"
 #include "pulsearprc.h"
@@ -47,6 +52,9 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.pcm_renderer.prc"
 #endif
 
+/* Emptied headers held back while the mainloop lock is taken */
+#define PULSEAR_MAX_EMPTIED_HEADERS 8
+
 /* This macro assumes the existence of an "ap_prc" local variable */
 #define goto_end_on_pa_error(expr)                         \
   do                                                       \
@@ -208,57 +216,122 @@ release_header (pulsear_prc_t * ap_prc)
 }
 
 static OMX_ERRORTYPE
-buffer_emptied (pulsear_prc_t * ap_prc)
+buffer_emptied (pulsear_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
   assert (ap_prc);
-  assert (ap_prc->p_inhdr_);
-  assert (ap_prc->p_inhdr_->nFilledLen == 0);
+  assert (ap_hdr);
+  assert (ap_hdr->nFilledLen == 0);
 
-  if ((ap_prc->p_inhdr_->nFlags & OMX_BUFFERFLAG_EOS) != 0)
+  if ((ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
     {
       TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
-                 ap_prc->p_inhdr_);
+                 ap_hdr);
       tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag, 0,
-                           ap_prc->p_inhdr_->nFlags, NULL);
+                           ap_hdr->nFlags, NULL);
     }
 
-  return release_header (ap_prc);
+  TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] emptied", ap_hdr);
+  ap_hdr->nOffset = 0;
+  return tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                 ARATELIA_PCM_RENDERER_PORT_INDEX, ap_hdr);
 }
 
+/* Writes as much as the server has asked for, holding the mainloop lock for
+   the whole batch. The headers emptied on the way are only handed back to
+   the kernel once the lock is released. */
 static OMX_ERRORTYPE
-render_pcm_data (pulsear_prc_t * ap_prc)
+write_pcm_data (pulsear_prc_t * ap_prc, OMX_BUFFERHEADERTYPE ** app_emptied,
+                size_t * ap_nemptied)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
   assert (ap_prc);
+  assert (app_emptied);
+  assert (ap_nemptied);
 
-  while ((p_hdr = get_header (ap_prc)) && ap_prc->pa_nbytes_ > 0)
+  /* The data is copied straight into the memory block that
+     pa_stream_begin_write hands out (shared with the server when possible),
+     so libpulse doesn't need to make a copy of its own. */
+  pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
+  while (*ap_nemptied < PULSEAR_MAX_EMPTIED_HEADERS
+         && (p_hdr = get_header (ap_prc)) && ap_prc->pa_nbytes_ > 0)
     {
       if (p_hdr->nFilledLen > 0)
         {
-          const int bytes_to_write
-            = MIN (ap_prc->pa_nbytes_, p_hdr->nFilledLen);
-          assert (ap_prc->p_pa_loop_);
-          assert (ap_prc->p_pa_context_);
-
-          pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
-          int result = pa_stream_write (
-            ap_prc->p_pa_stream_, p_hdr->pBuffer + p_hdr->nOffset,
-            bytes_to_write, NULL, 0, PA_SEEK_RELATIVE);
-          /* TODO : Check return code */
-          (void) result;
-          pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
+          void * p_data = NULL;
+          size_t bytes_to_write = MIN (ap_prc->pa_nbytes_, p_hdr->nFilledLen);
+          if (pa_stream_begin_write (ap_prc->p_pa_stream_, &p_data,
+                                     &bytes_to_write)
+                < 0
+              || !p_data)
+            {
+              TIZ_ERROR (handleOf (ap_prc),
+                         "[OMX_ErrorInsufficientResources] : "
+                         "pa_stream_begin_write : %s",
+                         pa_strerror (
+                           pa_context_errno (ap_prc->p_pa_context_)));
+              rc = OMX_ErrorInsufficientResources;
+              break;
+            }
+          /* The server may offer less than we asked for */
+          bytes_to_write = MIN (bytes_to_write, p_hdr->nFilledLen);
+          memcpy (p_data, p_hdr->pBuffer + p_hdr->nOffset, bytes_to_write);
+          if (pa_stream_write (ap_prc->p_pa_stream_, p_data, bytes_to_write,
+                               NULL, 0, PA_SEEK_RELATIVE)
+              < 0)
+            {
+              TIZ_ERROR (handleOf (ap_prc),
+                         "[OMX_ErrorInsufficientResources] : "
+                         "pa_stream_write : %s",
+                         pa_strerror (
+                           pa_context_errno (ap_prc->p_pa_context_)));
+              pa_stream_cancel_write (ap_prc->p_pa_stream_);
+              rc = OMX_ErrorInsufficientResources;
+              break;
+            }
           p_hdr->nFilledLen -= bytes_to_write;
           p_hdr->nOffset += bytes_to_write;
-          ap_prc->pa_nbytes_ -= bytes_to_write;
+          ap_prc->pa_nbytes_ -= MIN (ap_prc->pa_nbytes_, bytes_to_write);
         }
 
       if (0 == p_hdr->nFilledLen)
         {
-          rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          app_emptied[(*ap_nemptied)++] = p_hdr;
+          ap_prc->p_inhdr_ = NULL;
         }
     }
+  pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+render_pcm_data (pulsear_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_BUFFERHEADERTYPE * emptied[PULSEAR_MAX_EMPTIED_HEADERS];
+  size_t nemptied = 0;
+  assert (ap_prc);
+  assert (ap_prc->p_pa_loop_);
+  assert (ap_prc->p_pa_context_);
+
+  do
+    {
+      size_t i = 0;
+      nemptied = 0;
+      rc = write_pcm_data (ap_prc, emptied, &nemptied);
+      /* Releasing a header calls back into the kernel, which must not
+         happen with the mainloop lock held */
+      for (i = 0; i < nemptied; ++i)
+        {
+          const OMX_ERRORTYPE release_rc = buffer_emptied (ap_prc, emptied[i]);
+          if (OMX_ErrorNone == rc)
+            {
+              rc = release_rc;
+            }
+        }
+    }
+  while (OMX_ErrorNone == rc && PULSEAR_MAX_EMPTIED_HEADERS == nemptied);
 
   return rc;
 }
@@ -405,6 +478,27 @@ pulseaudio_stream_write_cback (pa_stream * stream, size_t nbytes,
     }
 }
 
+static void
+pulseaudio_stream_underflow_cback (pa_stream * stream, void * userdata)
+{
+  pulsear_prc_t * p_prc = userdata;
+  assert (p_prc);
+  /* Called from the PA mainloop thread; the stats counters are atomic */
+  TIZ_DEBUG (handleOf (p_prc), "PA STREAM UNDERFLOW");
+  (void) __atomic_add_fetch (&(p_prc->pa_underruns_), 1, __ATOMIC_RELAXED);
+  tiz_stats_underrun (handleOf (p_prc));
+}
+
+static void
+pulseaudio_stream_overflow_cback (pa_stream * stream, void * userdata)
+{
+  pulsear_prc_t * p_prc = userdata;
+  assert (p_prc);
+  /* The server's buffer was full and some of the written data was dropped */
+  TIZ_DEBUG (handleOf (p_prc), "PA STREAM OVERFLOW");
+  tiz_stats_overrun (handleOf (p_prc));
+}
+
 static void
 pulseaudio_stream_success_cback (pa_stream * s, int success, void * userdata)
 {
@@ -424,6 +518,8 @@ deinit_pulseaudio_stream (pulsear_prc_t * ap_prc)
       pa_stream_set_suspended_callback (ap_prc->p_pa_stream_, NULL, NULL);
       pa_stream_set_state_callback (ap_prc->p_pa_stream_, NULL, NULL);
       pa_stream_set_write_callback (ap_prc->p_pa_stream_, NULL, NULL);
+      pa_stream_set_underflow_callback (ap_prc->p_pa_stream_, NULL, NULL);
+      pa_stream_set_overflow_callback (ap_prc->p_pa_stream_, NULL, NULL);
       pa_stream_disconnect (ap_prc->p_pa_stream_);
       pa_stream_unref (ap_prc->p_pa_stream_);
       ap_prc->p_pa_stream_ = NULL;
@@ -518,6 +614,7 @@ end:
 static int
 init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
 {
+  OMX_TIZONIA_AUDIO_PARAM_SAMPLEFORMATTYPE sampleformat;
   OMX_ERRORTYPE omx_rc = OMX_ErrorNone;
   int rc = PA_ERR_UNKNOWN;
 
@@ -526,9 +623,14 @@ init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
 
   /* Retrieve pcm params from the input port */
   TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_, ARATELIA_PCM_RENDERER_PORT_INDEX);
+  TIZ_INIT_OMX_PORT_STRUCT (sampleformat, ARATELIA_PCM_RENDERER_PORT_INDEX);
   if (OMX_ErrorNone != (omx_rc = tiz_api_GetParameter (
                           tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
-                          OMX_IndexParamAudioPcm, &ap_prc->pcmmode_)))
+                          OMX_IndexParamAudioPcm, &ap_prc->pcmmode_))
+      || OMX_ErrorNone
+           != (omx_rc = tiz_api_GetParameter (
+                 tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                 OMX_TizoniaIndexParamAudioSampleFormat, &sampleformat)))
     {
       TIZ_ERROR (handleOf (ap_prc), "[%s]", tiz_err_to_str (omx_rc));
     }
@@ -557,6 +659,13 @@ init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
                               ? PA_SAMPLE_S24BE
                               : PA_SAMPLE_S24LE;
         }
+      else if (ap_prc->pcmmode_.nBitPerSample == 32
+               && OMX_AUDIO_SampleFormatS32 == sampleformat.eFormat)
+        {
+          ap_spec->format = ap_prc->pcmmode_.eEndian == OMX_EndianBig
+                              ? PA_SAMPLE_S32BE
+                              : PA_SAMPLE_S32LE;
+        }
       else if (ap_prc->pcmmode_.nBitPerSample == 32)
         {
           ap_spec->format = ap_prc->pcmmode_.eEndian == OMX_EndianBig
@@ -580,6 +689,38 @@ init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
   return rc;
 }
 
+static uint32_t
+latency_usec_to_bytes (const OMX_U32 a_usec, const pa_sample_spec * ap_spec)
+{
+  /* 0 lets the server pick a value */
+  return a_usec > 0 ? (uint32_t) pa_usec_to_bytes (a_usec, ap_spec)
+                    : (uint32_t) -1;
+}
+
+static void
+init_pulseaudio_buffer_attr (pulsear_prc_t * ap_prc,
+                             const pa_sample_spec * ap_spec,
+                             pa_buffer_attr * ap_attr)
+{
+  assert (ap_prc);
+  assert (ap_spec);
+  assert (ap_attr);
+
+  ap_attr->maxlength = (uint32_t) -1;
+  ap_attr->tlength
+    = latency_usec_to_bytes (ap_prc->latency_.nTargetLatencyUs, ap_spec);
+  ap_attr->prebuf
+    = latency_usec_to_bytes (ap_prc->latency_.nPrebufferUs, ap_spec);
+  ap_attr->minreq
+    = latency_usec_to_bytes (ap_prc->latency_.nMinRequestUs, ap_spec);
+  ap_attr->fragsize = (uint32_t) -1; /* Recording only */
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "target latency [%u us] min request [%u us] prebuffer [%u us]",
+              ap_prc->latency_.nTargetLatencyUs,
+              ap_prc->latency_.nMinRequestUs, ap_prc->latency_.nPrebufferUs);
+}
+
 /* Pulseaudio mainloop lock must have been acquired before calling this
    function */
 static int
@@ -602,6 +743,7 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
 
   {
     pa_sample_spec spec;
+    pa_buffer_attr attr;
     switch (pa_context_get_state (ap_prc->p_pa_context_))
       {
         case PA_CONTEXT_UNCONNECTED:
@@ -621,6 +763,7 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
     goto_end_on_pa_error (await_pulseaudio_context_connection (ap_prc));
 
     goto_end_on_pa_error (init_pulseaudio_sample_spec (ap_prc, &spec));
+    init_pulseaudio_buffer_attr (ap_prc, &spec, &attr);
 
     ap_prc->p_pa_stream_ = pa_stream_new (
       ap_prc->p_pa_context_, ARATELIA_PCM_RENDERER_PULSEAUDIO_STREAM_NAME,
@@ -633,14 +776,20 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
                                   pulseaudio_stream_state_cback, ap_prc);
     pa_stream_set_write_callback (ap_prc->p_pa_stream_,
                                   pulseaudio_stream_write_cback, ap_prc);
+    pa_stream_set_underflow_callback (
+      ap_prc->p_pa_stream_, pulseaudio_stream_underflow_cback, ap_prc);
+    pa_stream_set_overflow_callback (ap_prc->p_pa_stream_,
+                                     pulseaudio_stream_overflow_cback, ap_prc);
 
     goto_end_on_pa_error (pa_stream_connect_playback (
       ap_prc->p_pa_stream_,
       ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME, /* Name of the sink to
                                                        connect to, or NULL for
                                                        default */
-      NULL,   /* Buffering attributes, or NULL for default */
-      0,      /* Additional flags, or 0 for default */
+      &attr, /* Buffering attributes, or NULL for default */
+      PA_STREAM_ADJUST_LATENCY | PA_STREAM_INTERPOLATE_TIMING
+        | PA_STREAM_AUTO_TIMING_UPDATE, /* tlength is the overall latency;
+                                           keep the timing info current */
       NULL,   /* Initial volume, or NULL for default */
       NULL)); /* Synchronize this stream with the specified one, or NULL for
                    a standalone stream  */
@@ -803,6 +952,44 @@ do_flush (pulsear_prc_t * ap_prc)
   return release_header (ap_prc);
 }
 
+static OMX_ERRORTYPE
+retrieve_latency_config (pulsear_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->latency_,
+                            ARATELIA_PCM_RENDERER_PORT_INDEX);
+  return tiz_api_GetConfig (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                            OMX_TizoniaIndexConfigAudioRendererLatency,
+                            &ap_prc->latency_);
+}
+
+static OMX_ERRORTYPE
+apply_latency_config (pulsear_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  tiz_check_omx (retrieve_latency_config (ap_prc));
+  if (ap_prc->p_pa_loop_ && ap_prc->p_pa_stream_
+      && PA_STREAM_READY == ap_prc->pa_stream_state_)
+    {
+      pa_buffer_attr attr;
+      pa_operation * p_op = NULL;
+      pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
+      init_pulseaudio_buffer_attr (
+        ap_prc, pa_stream_get_sample_spec (ap_prc->p_pa_stream_), &attr);
+      p_op = pa_stream_set_buffer_attr (
+        ap_prc->p_pa_stream_, &attr, pulseaudio_stream_success_cback, ap_prc);
+      if (p_op)
+        {
+          if (!pulseaudio_wait_for_operation (ap_prc, p_op))
+            {
+              TIZ_ERROR (handleOf (ap_prc), "Operation wait failed.");
+            }
+        }
+      pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
+    }
+  return OMX_ErrorNone;
+}
+
 static bool
 set_pa_sink_volume (pulsear_prc_t * ap_prc, const long a_volume)
 {
@@ -973,6 +1160,8 @@ pulsear_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_pa_stream_ = NULL;
   p_prc->pa_stream_state_ = PA_STREAM_UNCONNECTED;
   p_prc->pa_nbytes_ = 0;
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->latency_, ARATELIA_PCM_RENDERER_PORT_INDEX);
+  p_prc->pa_underruns_ = 0;
   p_prc->p_ev_timer_ = NULL;
   p_prc->gain_ = ARATELIA_PCM_RENDERER_DEFAULT_GAIN_VALUE;
   p_prc->volume_ = ARATELIA_PCM_RENDERER_DEFAULT_VOLUME_VALUE;
@@ -1006,6 +1195,7 @@ pulsear_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
   if (!(p_prc->p_ev_timer_))
     {
       set_volume (ap_prc, p_prc->volume_);
+      tiz_check_omx (retrieve_latency_config (p_prc));
       tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
       rc = init_pulseaudio (ap_prc);
     }
@@ -1046,6 +1236,7 @@ pulsear_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid)
   pulsear_prc_t * p_prc = ap_prc;
   assert (ap_prc);
   p_prc->stopped_ = false;
+  __atomic_store_n (&(p_prc->pa_underruns_), 0, __ATOMIC_RELAXED);
   prepare_volume_ramp (p_prc);
   tiz_check_omx (start_volume_ramp (p_prc));
   tiz_check_omx (apply_ramp_step (p_prc));
@@ -1253,10 +1444,51 @@ pulsear_prc_config_change (void * ap_obj, OMX_U32 a_pid,
                      (mute.bMute == OMX_FALSE ? "FALSE" : "TRUE"));
           toggle_mute (p_prc, mute.bMute == OMX_TRUE ? true : false);
         }
+      else if (OMX_TizoniaIndexConfigAudioRendererLatency == a_config_idx)
+        {
+          rc = apply_latency_config (p_prc);
+        }
     }
   return rc;
 }
 
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+pulsear_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                       OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  pulsear_prc_t * p_prc = (pulsear_prc_t *) ap_obj;
+  assert (p_prc);
+
+  if (OMX_TizoniaIndexConfigAudioRendererLatency == a_index)
+    {
+      OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE * p_latency
+        = (OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE *) ap_struct;
+      pa_usec_t latency = 0;
+      int negative = 0;
+      p_latency->nLatencyUs = 0;
+      if (p_prc->p_pa_loop_ && p_prc->p_pa_stream_
+          && PA_STREAM_READY == p_prc->pa_stream_state_)
+        {
+          pa_threaded_mainloop_lock (p_prc->p_pa_loop_);
+          if (0 == pa_stream_get_latency (p_prc->p_pa_stream_, &latency,
+                                          &negative)
+              && !negative)
+            {
+              p_latency->nLatencyUs = (OMX_U32) MIN (latency, UINT32_MAX);
+            }
+          pa_threaded_mainloop_unlock (p_prc->p_pa_loop_);
+        }
+      p_latency->nUnderruns
+        = __atomic_load_n (&(p_prc->pa_underruns_), __ATOMIC_RELAXED);
+      return OMX_ErrorNone;
+    }
+  return OMX_ErrorUnsupportedIndex;
+}
+
 /*
  * pulsear_prc_class
  */
@@ -1330,6 +1562,8 @@ pulsear_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_enable, pulsear_prc_port_enable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_config_change, pulsear_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, pulsear_prc_GetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -44,6 +44,7 @@ extern "C" {
 #include <pulse/version.h>
 
 #include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
 
 #include <tizprc_decls.h>
 
@@ -63,6 +64,8 @@ struct pulsear_prc
   struct pa_cvolume pa_vol_;
   pa_stream_state_t pa_stream_state_;
   size_t pa_nbytes_;
+  OMX_TIZONIA_AUDIO_CONFIG_RENDERERLATENCYTYPE latency_;
+  OMX_U32 pa_underruns_; /* Updated from the PA mainloop thread */
   tiz_event_timer_t *p_ev_timer_;
   float gain_;
   long volume_;
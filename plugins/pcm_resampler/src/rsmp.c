@@ -0,0 +1,179 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmp.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler component
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizscheduler.h>
+#include <tizport.h>
+
+#include "rsmp.h"
+#include "rsmpcfgport.h"
+#include "rsmpprc.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_resampler"
+#endif
+
+/**
+ *@defgroup libtizpcmrsmp 'libtizpcmrsmp' : OpenMAX IL PCM resampler
+ *
+ * - Component name : "OMX.Aratelia.audio_processor.pcm.resampler"
+ * - Implements role: "audio_processor.pcm.resampler"
+ *
+ *@ingroup plugins
+ */
+
+static OMX_VERSIONTYPE pcm_resampler_version = {{1, 0, 0, 0}};
+
+static OMX_PTR
+instantiate_pcm_port (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid,
+                      const OMX_DIRTYPE a_dir)
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
+  OMX_AUDIO_CONFIG_VOLUMETYPE volume;
+  OMX_AUDIO_CONFIG_MUTETYPE mute;
+  OMX_AUDIO_CODINGTYPE encodings[]
+    = {OMX_AUDIO_CodingPCM, OMX_AUDIO_CodingMax};
+  tiz_port_options_t pcm_port_opts = {
+    OMX_PortDomainAudio,
+    a_dir,
+    ARATELIA_PCM_RESAMPLER_PORT_MIN_BUF_COUNT,
+    a_dir == OMX_DirInput ? ARATELIA_PCM_RESAMPLER_PORT_MIN_INPUT_BUF_SIZE
+                          : ARATELIA_PCM_RESAMPLER_PORT_MIN_OUTPUT_BUF_SIZE,
+    ARATELIA_PCM_RESAMPLER_PORT_NONCONTIGUOUS,
+    ARATELIA_PCM_RESAMPLER_PORT_ALIGNMENT,
+    ARATELIA_PCM_RESAMPLER_PORT_SUPPLIERPREF,
+    {a_pid, NULL, NULL, NULL},
+    -1 /* The ports are not slaved: their sampling rates differ */
+  };
+
+  pcmmode.nSize = sizeof (OMX_AUDIO_PARAM_PCMMODETYPE);
+  pcmmode.nVersion.nVersion = OMX_VERSION;
+  pcmmode.nPortIndex = a_pid;
+  pcmmode.nChannels = 2;
+  pcmmode.eNumData = OMX_NumericalDataSigned;
+  pcmmode.eEndian = OMX_EndianLittle;
+  pcmmode.bInterleaved = OMX_TRUE;
+  pcmmode.nBitPerSample = 16;
+  pcmmode.nSamplingRate = a_dir == OMX_DirInput ? 44100 : 48000;
+  pcmmode.ePCMMode = OMX_AUDIO_PCMModeLinear;
+  pcmmode.eChannelMapping[0] = OMX_AUDIO_ChannelLF;
+  pcmmode.eChannelMapping[1] = OMX_AUDIO_ChannelRF;
+
+  volume.nSize = sizeof (OMX_AUDIO_CONFIG_VOLUMETYPE);
+  volume.nVersion.nVersion = OMX_VERSION;
+  volume.nPortIndex = a_pid;
+  volume.bLinear = OMX_FALSE;
+  volume.sVolume.nValue = 50;
+  volume.sVolume.nMin = 0;
+  volume.sVolume.nMax = 100;
+
+  mute.nSize = sizeof (OMX_AUDIO_CONFIG_MUTETYPE);
+  mute.nVersion.nVersion = OMX_VERSION;
+  mute.nPortIndex = a_pid;
+  mute.bMute = OMX_FALSE;
+
+  return factory_new (tiz_get_type (ap_hdl, "tizpcmport"), &pcm_port_opts,
+                      &encodings, &pcmmode, &volume, &mute);
+}
+
+static OMX_PTR
+instantiate_input_port (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_pcm_port (ap_hdl, ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX,
+                               OMX_DirInput);
+}
+
+static OMX_PTR
+instantiate_output_port (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_pcm_port (
+    ap_hdl, ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX, OMX_DirOutput);
+}
+
+static OMX_PTR
+instantiate_config_port (OMX_HANDLETYPE ap_hdl)
+{
+  return factory_new (tiz_get_type (ap_hdl, "rsmpcfgport"),
+                      NULL, /* this port does not take options */
+                      ARATELIA_PCM_RESAMPLER_COMPONENT_NAME,
+                      pcm_resampler_version);
+}
+
+static OMX_PTR
+instantiate_processor (OMX_HANDLETYPE ap_hdl)
+{
+  return factory_new (tiz_get_type (ap_hdl, "rsmpprc"));
+}
+
+OMX_ERRORTYPE
+OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
+{
+  tiz_role_factory_t role_factory;
+  const tiz_role_factory_t * rf_list[] = {&role_factory};
+  tiz_type_factory_t rsmpprc_type;
+  tiz_type_factory_t rsmpcfgport_type;
+  const tiz_type_factory_t * tf_list[] = {&rsmpprc_type, &rsmpcfgport_type};
+
+  strcpy ((OMX_STRING) role_factory.role, ARATELIA_PCM_RESAMPLER_DEFAULT_ROLE);
+  role_factory.pf_cport = instantiate_config_port;
+  role_factory.pf_port[0] = instantiate_input_port;
+  role_factory.pf_port[1] = instantiate_output_port;
+  role_factory.nports = 2;
+  role_factory.pf_proc = instantiate_processor;
+
+  strcpy ((OMX_STRING) rsmpprc_type.class_name, "rsmpprc_class");
+  rsmpprc_type.pf_class_init = rsmp_prc_class_init;
+  strcpy ((OMX_STRING) rsmpprc_type.object_name, "rsmpprc");
+  rsmpprc_type.pf_object_init = rsmp_prc_init;
+
+  strcpy ((OMX_STRING) rsmpcfgport_type.class_name, "rsmpcfgport_class");
+  rsmpcfgport_type.pf_class_init = rsmp_cfgport_class_init;
+  strcpy ((OMX_STRING) rsmpcfgport_type.object_name, "rsmpcfgport");
+  rsmpcfgport_type.pf_object_init = rsmp_cfgport_init;
+
+  /* Initialize the component infrastructure */
+  tiz_check_omx (
+    tiz_comp_init (ap_hdl, ARATELIA_PCM_RESAMPLER_COMPONENT_NAME));
+
+  /* Register the "rsmpprc" and "rsmpcfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 2));
+
+  /* Register the component role */
+  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 1));
+
+  return OMX_ErrorNone;
+}
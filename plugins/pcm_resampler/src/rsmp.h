@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmp.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler component constants
+ *
+ *
+ */
+#ifndef RSMP_H
+#define RSMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+#define ARATELIA_PCM_RESAMPLER_DEFAULT_ROLE \
+  OMX_ROLE_AUDIO_PROCESSOR_PCM_RESAMPLER
+#define ARATELIA_PCM_RESAMPLER_COMPONENT_NAME \
+  "OMX.Aratelia.audio_processor.pcm.resampler"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX 0
+#define ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX 1
+#define ARATELIA_PCM_RESAMPLER_PORT_MIN_BUF_COUNT 2
+#define ARATELIA_PCM_RESAMPLER_PORT_MIN_INPUT_BUF_SIZE 8192
+/* Large enough for one input buffer upsampled 2x; a full output buffer is
+   always released, the remaining input is kept for the next one */
+#define ARATELIA_PCM_RESAMPLER_PORT_MIN_OUTPUT_BUF_SIZE 16384
+#define ARATELIA_PCM_RESAMPLER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_PCM_RESAMPLER_PORT_ALIGNMENT 0
+#define ARATELIA_PCM_RESAMPLER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_PCM_RESAMPLER_DEFAULT_QUALITY OMX_AUDIO_ResamplerQualityMedium
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RSMP_H */
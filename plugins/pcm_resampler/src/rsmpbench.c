@@ -0,0 +1,271 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler - filter throughput benchmark
+ *
+ * Converts a few seconds of a 1 kHz tone with every quality preset and
+ * prints the throughput and the signal-to-noise ratio of the result. 'make
+ * bench' builds this program twice, with and without the SIMD loops, and runs
+ * both.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "rsmpfilter.h"
+
+#define BENCH_TONE_HZ 1000.0
+#define BENCH_TONE_AMPLITUDE 0.5
+/* Roughly what a component gets per buffer */
+#define BENCH_CHUNK_FRAMES 1024
+
+static const char * quality_names[ERsmpQualityMax]
+  = {"low", "medium", "high", "best"};
+
+static const char * format_names[ERsmpFormatMax] = {"s16", "s32", "f32"};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static double
+load (const void * ap_buf, const rsmp_format_t a_fmt, const size_t a_idx)
+{
+  switch (a_fmt)
+    {
+      case ERsmpFormatS16:
+        return ((const int16_t *) ap_buf)[a_idx] / 32768.0;
+      case ERsmpFormatS32:
+        return ((const int32_t *) ap_buf)[a_idx] / 2147483648.0;
+      default:
+        return ((const float *) ap_buf)[a_idx];
+    };
+}
+
+static void
+store (void * ap_buf, const rsmp_format_t a_fmt, const size_t a_idx,
+       const double a_val)
+{
+  switch (a_fmt)
+    {
+      case ERsmpFormatS16:
+        ((int16_t *) ap_buf)[a_idx] = (int16_t) lrint (a_val * 32767.0);
+        break;
+      case ERsmpFormatS32:
+        ((int32_t *) ap_buf)[a_idx] = (int32_t) lrint (a_val * 2147483647.0);
+        break;
+      default:
+        ((float *) ap_buf)[a_idx] = (float) a_val;
+        break;
+    };
+}
+
+static int
+run (const rsmp_quality_t a_quality, const OMX_U32 a_in_rate,
+     const OMX_U32 a_out_rate, const OMX_U32 a_channels,
+     const rsmp_format_t a_fmt, const double a_secs)
+{
+  const OMX_U32 in_frames = (OMX_U32) (a_secs * a_in_rate);
+  const OMX_U32 out_cap = (OMX_U32) (((OMX_U64) in_frames * a_out_rate)
+                                     / a_in_rate)
+                          + BENCH_CHUNK_FRAMES;
+  const size_t ssize = rsmp_filter_sample_size (a_fmt);
+  rsmp_filter_t * p_flt = NULL;
+  char * p_in = malloc ((size_t) in_frames * a_channels * ssize);
+  char * p_out = malloc ((size_t) out_cap * a_channels * ssize);
+  OMX_U32 consumed = 0;
+  OMX_U32 produced = 0;
+  OMX_U32 i = 0;
+  OMX_U32 c = 0;
+  double start = 0.0;
+  double elapsed = 0.0;
+  double signal = 0.0;
+  double noise = 0.0;
+
+  if (!p_in || !p_out
+      || OMX_ErrorNone != rsmp_filter_init (&p_flt, a_channels, a_in_rate,
+                                            a_out_rate, a_quality))
+    {
+      fprintf (stderr, "rsmpbench: unable to set up the filter\n");
+      free (p_in);
+      free (p_out);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < in_frames; ++i)
+    {
+      const double v = BENCH_TONE_AMPLITUDE
+                       * sin (2.0 * M_PI * BENCH_TONE_HZ * i / a_in_rate);
+      for (c = 0; c < a_channels; ++c)
+        {
+          store (p_in, a_fmt, (size_t) i * a_channels + c, v);
+        }
+    }
+
+  start = now_secs ();
+  while (consumed < in_frames)
+    {
+      OMX_U32 nin = MIN (BENCH_CHUNK_FRAMES, in_frames - consumed);
+      OMX_U32 nout = out_cap - produced;
+      rsmp_filter_process (p_flt,
+                           p_in + (size_t) consumed * a_channels * ssize,
+                           a_fmt, &nin,
+                           p_out + (size_t) produced * a_channels * ssize,
+                           a_fmt, &nout);
+      consumed += nin;
+      produced += nout;
+    }
+  for (;;)
+    {
+      OMX_U32 nout = out_cap - produced;
+      rsmp_filter_drain (p_flt, p_out + (size_t) produced * a_channels * ssize,
+                         a_fmt, &nout);
+      if (0 == nout)
+        {
+          break;
+        }
+      produced += nout;
+    }
+  elapsed = now_secs () - start;
+
+  /* Compare against the ideal tone at the output rate, away from the edges */
+  for (i = produced / 10; i < produced - produced / 10; ++i)
+    {
+      const double ref = BENCH_TONE_AMPLITUDE
+                         * sin (2.0 * M_PI * BENCH_TONE_HZ * i / a_out_rate);
+      const double err = load (p_out, a_fmt, (size_t) i * a_channels) - ref;
+      signal += ref * ref;
+      noise += err * err;
+    }
+
+  printf ("%-6s %-7s %6u -> %6u  %u ch %s  %8.2f Mframes/s  %7.1fx "
+          "realtime  SNR %6.1f dB  (%u frames out)\n",
+          rsmp_filter_simd_name (), quality_names[a_quality],
+          (unsigned) a_in_rate, (unsigned) a_out_rate, (unsigned) a_channels,
+          format_names[a_fmt],
+          elapsed > 0.0 ? in_frames / elapsed / 1e6 : 0.0,
+          elapsed > 0.0 ? a_secs / elapsed : 0.0,
+          noise > 0.0 ? 10.0 * log10 (signal / noise) : 999.0,
+          (unsigned) produced);
+
+  rsmp_filter_destroy (p_flt);
+  free (p_in);
+  free (p_out);
+  return EXIT_SUCCESS;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr,
+           "Usage: %s [-i in-rate] [-o out-rate] [-c channels] "
+           "[-f s16|s32|f32] [-q low|medium|high|best] [-s seconds]\n",
+           ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  OMX_U32 in_rate = 44100;
+  OMX_U32 out_rate = 48000;
+  OMX_U32 channels = 2;
+  rsmp_format_t fmt = ERsmpFormatS16;
+  int quality = -1;
+  double secs = 10.0;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+  int i = 0;
+
+  while ((opt = getopt (argc, argv, "i:o:c:f:q:s:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'i':
+            in_rate = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'o':
+            out_rate = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 'c':
+            channels = (OMX_U32) strtoul (optarg, NULL, 10);
+            break;
+          case 's':
+            secs = strtod (optarg, NULL);
+            break;
+          case 'f':
+            for (i = 0; i < ERsmpFormatMax; ++i)
+              {
+                if (0 == strcmp (optarg, format_names[i]))
+                  {
+                    fmt = (rsmp_format_t) i;
+                  }
+              }
+            break;
+          case 'q':
+            for (i = 0; i < ERsmpQualityMax; ++i)
+              {
+                if (0 == strcmp (optarg, quality_names[i]))
+                  {
+                    quality = i;
+                  }
+              }
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (0 == in_rate || 0 == out_rate || 0 == channels || secs <= 0.0)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < ERsmpQualityMax && EXIT_SUCCESS == rc; ++i)
+    {
+      if (quality < 0 || quality == i)
+        {
+          rc = run ((rsmp_quality_t) i, in_rate, out_rate, channels, fmt,
+                    secs);
+        }
+    }
+
+  return rc;
+}
@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler config port
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+#include <strings.h>
+
+#include <tizplatform.h>
+
+#include "rsmp.h"
+#include "rsmpcfgport.h"
+#include "rsmpcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_resampler.cfgport"
+#endif
+
+static OMX_TIZONIA_AUDIO_RESAMPLERQUALITYTYPE
+default_quality (void)
+{
+  static const char * quality_names[]
+    = {"low", "medium", "high", "best"};
+  const char * p_quality
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            ARATELIA_PCM_RESAMPLER_COMPONENT_NAME ".quality");
+  OMX_U32 i = 0;
+
+  if (p_quality)
+    {
+      for (i = 0; i < sizeof (quality_names) / sizeof (quality_names[0]); ++i)
+        {
+          if (0 == strcasecmp (p_quality, quality_names[i]))
+            {
+              return (OMX_TIZONIA_AUDIO_RESAMPLERQUALITYTYPE) i;
+            }
+        }
+    }
+  return ARATELIA_PCM_RESAMPLER_DEFAULT_QUALITY;
+}
+
+/*
+ * rsmpcfgport class
+ */
+
+static void *
+rsmp_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  rsmp_cfgport_t * p_obj
+    = super_ctor (typeOf (ap_obj, "rsmpcfgport"), ap_obj, app);
+
+  assert (p_obj);
+
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexParamAudioResampler);
+  p_obj->resampler_.nSize = sizeof (OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE);
+  p_obj->resampler_.nVersion.nVersion = OMX_VERSION;
+  p_obj->resampler_.eQuality = default_quality ();
+  p_obj->resampler_.eInputFormat = OMX_AUDIO_SampleFormatAuto;
+  p_obj->resampler_.eOutputFormat = OMX_AUDIO_SampleFormatAuto;
+
+  return p_obj;
+}
+
+static void *
+rsmp_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "rsmpcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+rsmp_cfgport_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const rsmp_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexParamAudioResampler == a_index)
+    {
+      OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE * p_resampler
+        = (OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE *) ap_struct;
+
+      *p_resampler = p_obj->resampler_;
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetParameter (typeOf (ap_obj, "rsmpcfgport"), ap_obj, ap_hdl,
+                               a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+rsmp_cfgport_SetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  rsmp_cfgport_t * p_obj = (rsmp_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  TIZ_TRACE (ap_hdl, "[%s]...", tiz_idx_to_str (a_index));
+
+  assert (p_obj);
+
+  if (OMX_TizoniaIndexParamAudioResampler == a_index)
+    {
+      OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE * p_resampler
+        = (OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE *) ap_struct;
+
+      if (p_resampler->eQuality > OMX_AUDIO_ResamplerQualityBest
+          || p_resampler->eInputFormat > OMX_AUDIO_SampleFormatF32
+          || p_resampler->eOutputFormat > OMX_AUDIO_SampleFormatF32)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          p_obj->resampler_ = *p_resampler;
+          TIZ_TRACE (ap_hdl,
+                     "eQuality [%d] eInputFormat [%d] eOutputFormat [%d]",
+                     p_obj->resampler_.eQuality,
+                     p_obj->resampler_.eInputFormat,
+                     p_obj->resampler_.eOutputFormat);
+        }
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetParameter (typeOf (ap_obj, "rsmpcfgport"), ap_obj, ap_hdl,
+                               a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * rsmp_cfgport_class
+ */
+
+static void *
+rsmp_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "rsmpcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+rsmp_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * rsmpcfgport_class
+    = factory_new (classOf (tizconfigport), "rsmpcfgport_class",
+                   classOf (tizconfigport), sizeof (rsmp_cfgport_class_t),
+                   ap_tos, ap_hdl, ctor, rsmp_cfgport_class_ctor, 0);
+  return rsmpcfgport_class;
+}
+
+void *
+rsmp_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizconfigport = tiz_get_type (ap_hdl, "tizconfigport");
+  void * rsmpcfgport_class = tiz_get_type (ap_hdl, "rsmpcfgport_class");
+  TIZ_LOG_CLASS (rsmpcfgport_class);
+  void * rsmpcfgport = factory_new (
+    rsmpcfgport_class, "rsmpcfgport", tizconfigport, sizeof (rsmp_cfgport_t),
+    ap_tos, ap_hdl, ctor, rsmp_cfgport_ctor, dtor, rsmp_cfgport_dtor,
+    tiz_api_GetParameter, rsmp_cfgport_GetParameter, tiz_api_SetParameter,
+    rsmp_cfgport_SetParameter, 0);
+
+  return rsmpcfgport;
+}
@@ -0,0 +1,718 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpfilter.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler - polyphase windowed-sinc filter
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "rsmpfilter.h"
+
+#if !defined(RSMP_DISABLE_SIMD)
+#if defined(__SSE__)
+#define RSMP_HAVE_SSE 1
+#include <xmmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* AVX is selected at run time, so that distro builds for baseline x86-64 still
+   use it where available */
+#define RSMP_HAVE_AVX 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RSMP_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+/* All filter lengths are a multiple of this, so that the SIMD loops need no
+   tail handling */
+#define RSMP_TAPS_ALIGN 16
+/* Byte alignment of the coefficient table rows */
+#define RSMP_COEFFS_ALIGN 64
+/* Frames of input buffered per channel on top of the filter length */
+#define RSMP_BLOCK_FRAMES 1024
+/* Largest table (in coefficients) for which one row per output phase is
+   built; beyond this, rows are interpolated */
+#define RSMP_MAX_EXACT_COEFFS (256 * 1024)
+/* When downsampling, the filter is stretched by the conversion ratio, up to
+   this many times its nominal length */
+#define RSMP_MAX_STRETCH 8
+
+typedef float (*rsmp_dot_f) (const float * ap_x, const float * ap_h,
+                             const OMX_U32 a_taps);
+
+typedef struct rsmp_preset rsmp_preset_t;
+struct rsmp_preset
+{
+  OMX_U32 taps;
+  OMX_U32 phases; /* table rows in interpolated mode */
+  double beta;    /* Kaiser window shape */
+  double rolloff; /* cut-off, relative to the lower Nyquist frequency */
+};
+
+static const rsmp_preset_t rsmp_presets[ERsmpQualityMax] = {
+  {16, 64, 5.0, 0.80},   /* ERsmpQualityLow */
+  {32, 128, 7.0, 0.90},  /* ERsmpQualityMedium */
+  {64, 256, 9.0, 0.94},  /* ERsmpQualityHigh */
+  {128, 512, 11.5, 0.96} /* ERsmpQualityBest */
+};
+
+struct rsmp_filter
+{
+  OMX_U32 channels;
+  OMX_U32 in_rate;
+  OMX_U32 out_rate;
+  bool bypass;
+  /* in_rate / out_rate == num / den, in lowest terms */
+  OMX_U32 num;
+  OMX_U32 den;
+  OMX_U32 int_step;
+  OMX_U32 frac_step;
+  /* Coefficient table */
+  bool exact;
+  OMX_U32 taps;
+  OMX_U32 phases;
+  void * p_coeffs_mem;
+  float * p_coeffs;
+  /* Planar history; channel c starts at p_hist + c * cap */
+  float * p_hist;
+  OMX_U32 cap;
+  OMX_U32 fill;
+  /* First history frame under the filter, and output phase (0 <= acc <
+     den) */
+  OMX_U32 ipos;
+  OMX_U32 acc;
+  OMX_U64 in_total;
+  OMX_U64 out_total;
+  rsmp_dot_f pf_dot;
+};
+
+/*
+ * Inner loops. 'a_taps' is always a multiple of RSMP_TAPS_ALIGN and the
+ * coefficients are RSMP_COEFFS_ALIGN-aligned; the history is not aligned.
+ */
+
+static float
+dot_scalar (const float * ap_x, const float * ap_h, const OMX_U32 a_taps)
+{
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  OMX_U32 i = 0;
+  for (i = 0; i < a_taps; i += 4)
+    {
+      s0 += ap_x[i] * ap_h[i];
+      s1 += ap_x[i + 1] * ap_h[i + 1];
+      s2 += ap_x[i + 2] * ap_h[i + 2];
+      s3 += ap_x[i + 3] * ap_h[i + 3];
+    }
+  return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef RSMP_HAVE_SSE
+static float
+dot_sse (const float * ap_x, const float * ap_h, const OMX_U32 a_taps)
+{
+  __m128 acc0 = _mm_setzero_ps ();
+  __m128 acc1 = _mm_setzero_ps ();
+  float sum[4];
+  OMX_U32 i = 0;
+  for (i = 0; i < a_taps; i += 8)
+    {
+      acc0 = _mm_add_ps (
+        acc0, _mm_mul_ps (_mm_loadu_ps (ap_x + i), _mm_load_ps (ap_h + i)));
+      acc1 = _mm_add_ps (acc1, _mm_mul_ps (_mm_loadu_ps (ap_x + i + 4),
+                                           _mm_load_ps (ap_h + i + 4)));
+    }
+  _mm_storeu_ps (sum, _mm_add_ps (acc0, acc1));
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+#endif
+
+#ifdef RSMP_HAVE_AVX
+__attribute__ ((target ("avx"))) static float
+dot_avx (const float * ap_x, const float * ap_h, const OMX_U32 a_taps)
+{
+  __m256 acc0 = _mm256_setzero_ps ();
+  __m256 acc1 = _mm256_setzero_ps ();
+  __m128 acc = _mm_setzero_ps ();
+  float sum[4];
+  OMX_U32 i = 0;
+  for (i = 0; i < a_taps; i += 16)
+    {
+      acc0 = _mm256_add_ps (acc0, _mm256_mul_ps (_mm256_loadu_ps (ap_x + i),
+                                                 _mm256_load_ps (ap_h + i)));
+      acc1 = _mm256_add_ps (acc1,
+                            _mm256_mul_ps (_mm256_loadu_ps (ap_x + i + 8),
+                                           _mm256_load_ps (ap_h + i + 8)));
+    }
+  acc0 = _mm256_add_ps (acc0, acc1);
+  acc = _mm_add_ps (_mm256_castps256_ps128 (acc0),
+                    _mm256_extractf128_ps (acc0, 1));
+  _mm_storeu_ps (sum, acc);
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+#endif
+
+#ifdef RSMP_HAVE_NEON
+static float
+dot_neon (const float * ap_x, const float * ap_h, const OMX_U32 a_taps)
+{
+  float32x4_t acc0 = vdupq_n_f32 (0.0f);
+  float32x4_t acc1 = vdupq_n_f32 (0.0f);
+  float32x2_t acc;
+  OMX_U32 i = 0;
+  for (i = 0; i < a_taps; i += 8)
+    {
+      acc0 = vmlaq_f32 (acc0, vld1q_f32 (ap_x + i), vld1q_f32 (ap_h + i));
+      acc1 = vmlaq_f32 (acc1, vld1q_f32 (ap_x + i + 4),
+                        vld1q_f32 (ap_h + i + 4));
+    }
+  acc0 = vaddq_f32 (acc0, acc1);
+  acc = vadd_f32 (vget_low_f32 (acc0), vget_high_f32 (acc0));
+  return vget_lane_f32 (vpadd_f32 (acc, acc), 0);
+}
+#endif
+
+static rsmp_dot_f
+select_dot (const char ** app_name)
+{
+  const char * p_name = "scalar";
+  rsmp_dot_f pf_dot = dot_scalar;
+#if defined(RSMP_HAVE_AVX)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx"))
+    {
+      p_name = "avx";
+      pf_dot = dot_avx;
+    }
+  else
+    {
+      p_name = "sse";
+      pf_dot = dot_sse;
+    }
+#elif defined(RSMP_HAVE_SSE)
+  p_name = "sse";
+  pf_dot = dot_sse;
+#elif defined(RSMP_HAVE_NEON)
+  p_name = "neon";
+  pf_dot = dot_neon;
+#endif
+  if (app_name)
+    {
+      *app_name = p_name;
+    }
+  return pf_dot;
+}
+
+/*
+ * Filter design
+ */
+
+static OMX_U32
+gcd (OMX_U32 a, OMX_U32 b)
+{
+  while (b)
+    {
+      const OMX_U32 t = a % b;
+      a = b;
+      b = t;
+    }
+  return a;
+}
+
+static double
+bessel_i0 (const double a_x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  const double q = a_x * a_x / 4.0;
+  int k = 1;
+  for (k = 1; k < 64 && term > sum * 1e-12; ++k)
+    {
+      term *= q / ((double) k * (double) k);
+      sum += term;
+    }
+  return sum;
+}
+
+static void
+design_row (float * ap_row, const OMX_U32 a_taps, const double a_frac,
+            const double a_fc, const double a_beta)
+{
+  const double half = (double) a_taps / 2.0;
+  const double i0_beta = bessel_i0 (a_beta);
+  double sum = 0.0;
+  OMX_U32 j = 0;
+
+  for (j = 0; j < a_taps; ++j)
+    {
+      /* Distance from the output instant, in input samples */
+      const double d = (double) j - (half - 1.0) - a_frac;
+      const double x = d / half;
+      double h = 0.0;
+      if (fabs (x) < 1.0)
+        {
+          const double arg = M_PI * a_fc * d;
+          const double sinc = fabs (arg) < 1e-9 ? 1.0 : sin (arg) / arg;
+          h = a_fc * sinc * bessel_i0 (a_beta * sqrt (1.0 - x * x)) / i0_beta;
+        }
+      ap_row[j] = (float) h;
+      sum += h;
+    }
+
+  /* Unity gain at DC for every phase */
+  if (sum > 1e-9)
+    {
+      for (j = 0; j < a_taps; ++j)
+        {
+          ap_row[j] = (float) (ap_row[j] / sum);
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+design_filter (rsmp_filter_t * ap_flt, const rsmp_quality_t a_quality)
+{
+  const rsmp_preset_t * p_preset = &(rsmp_presets[a_quality]);
+  double fc = p_preset->rolloff;
+  OMX_U32 taps = p_preset->taps;
+  OMX_U32 rows = 0;
+  OMX_U32 p = 0;
+
+  assert (ap_flt);
+
+  if (ap_flt->out_rate < ap_flt->in_rate)
+    {
+      /* Downsampling: lower the cut-off below the output Nyquist frequency,
+         and stretch the filter to keep the same transition band */
+      const double ratio = (double) ap_flt->out_rate / ap_flt->in_rate;
+      fc *= ratio;
+      taps = (OMX_U32) ceil (taps / ratio);
+      taps = MIN (taps, p_preset->taps * RSMP_MAX_STRETCH);
+    }
+  taps = (taps + RSMP_TAPS_ALIGN - 1) / RSMP_TAPS_ALIGN * RSMP_TAPS_ALIGN;
+
+  ap_flt->taps = taps;
+  ap_flt->exact = ((OMX_U64) ap_flt->den * taps <= RSMP_MAX_EXACT_COEFFS);
+  ap_flt->phases = ap_flt->exact ? ap_flt->den : p_preset->phases;
+  /* Interpolation reads one row past the last phase */
+  rows = ap_flt->exact ? ap_flt->phases : ap_flt->phases + 1;
+
+  ap_flt->p_coeffs_mem = tiz_mem_alloc (
+    (size_t) rows * taps * sizeof (float) + RSMP_COEFFS_ALIGN);
+  tiz_check_null_ret_oom (ap_flt->p_coeffs_mem);
+  ap_flt->p_coeffs
+    = (float *) (((uintptr_t) ap_flt->p_coeffs_mem + RSMP_COEFFS_ALIGN - 1)
+                 & ~((uintptr_t) RSMP_COEFFS_ALIGN - 1));
+
+  for (p = 0; p < rows; ++p)
+    {
+      design_row (ap_flt->p_coeffs + (size_t) p * taps, taps,
+                  (double) p / ap_flt->phases, fc, p_preset->beta);
+    }
+
+  return OMX_ErrorNone;
+}
+
+/*
+ * Sample conversion
+ */
+
+static inline float
+s16_to_float (const int16_t a_sample)
+{
+  return (float) a_sample * (1.0f / 32768.0f);
+}
+
+static inline float
+s32_to_float (const int32_t a_sample)
+{
+  return (float) a_sample * (1.0f / 2147483648.0f);
+}
+
+static inline int16_t
+float_to_s16 (const float a_sample)
+{
+  const float v = a_sample * 32768.0f;
+  return v >= 32767.0f ? INT16_MAX
+                       : (v <= -32768.0f ? INT16_MIN : (int16_t) lrintf (v));
+}
+
+static inline int32_t
+float_to_s32 (const float a_sample)
+{
+  const double v = (double) a_sample * 2147483648.0;
+  return v >= 2147483647.0 ? INT32_MAX
+                           : (v <= -2147483648.0 ? INT32_MIN
+                                                 : (int32_t) lrint (v));
+}
+
+static inline float
+load_sample (const void * ap_buf, const rsmp_format_t a_fmt,
+             const size_t a_idx)
+{
+  switch (a_fmt)
+    {
+      case ERsmpFormatS16:
+        return s16_to_float (((const int16_t *) ap_buf)[a_idx]);
+      case ERsmpFormatS32:
+        return s32_to_float (((const int32_t *) ap_buf)[a_idx]);
+      default:
+        return ((const float *) ap_buf)[a_idx];
+    };
+}
+
+static inline void
+store_sample (void * ap_buf, const rsmp_format_t a_fmt, const size_t a_idx,
+              const float a_sample)
+{
+  switch (a_fmt)
+    {
+      case ERsmpFormatS16:
+        ((int16_t *) ap_buf)[a_idx] = float_to_s16 (a_sample);
+        break;
+      case ERsmpFormatS32:
+        ((int32_t *) ap_buf)[a_idx] = float_to_s32 (a_sample);
+        break;
+      default:
+        ((float *) ap_buf)[a_idx] = a_sample;
+        break;
+    };
+}
+
+/* Deinterleave 'a_frames' frames into the history; a NULL input appends
+   silence */
+static void
+append_input (rsmp_filter_t * ap_flt, const void * ap_in,
+              const rsmp_format_t a_fmt, const OMX_U32 a_first,
+              const OMX_U32 a_frames)
+{
+  const OMX_U32 nch = ap_flt->channels;
+  OMX_U32 c = 0;
+  OMX_U32 i = 0;
+
+  for (c = 0; c < nch; ++c)
+    {
+      float * p_dst = ap_flt->p_hist + (size_t) c * ap_flt->cap + ap_flt->fill;
+      if (!ap_in)
+        {
+          (void) memset (p_dst, 0, a_frames * sizeof (float));
+          continue;
+        }
+      for (i = 0; i < a_frames; ++i)
+        {
+          p_dst[i]
+            = load_sample (ap_in, a_fmt, (size_t) (a_first + i) * nch + c);
+        }
+    }
+  ap_flt->fill += a_frames;
+}
+
+/* Drop the history frames that the filter has moved past */
+static void
+compact_history (rsmp_filter_t * ap_flt)
+{
+  if (ap_flt->ipos >= ap_flt->fill)
+    {
+      /* Downsampling may step over frames that have not arrived yet */
+      ap_flt->ipos -= ap_flt->fill;
+      ap_flt->fill = 0;
+    }
+  else if (ap_flt->ipos > 0)
+    {
+      const OMX_U32 keep = ap_flt->fill - ap_flt->ipos;
+      OMX_U32 c = 0;
+      for (c = 0; c < ap_flt->channels; ++c)
+        {
+          float * p_ch = ap_flt->p_hist + (size_t) c * ap_flt->cap;
+          (void) memmove (p_ch, p_ch + ap_flt->ipos, keep * sizeof (float));
+        }
+      ap_flt->fill = keep;
+      ap_flt->ipos = 0;
+    }
+}
+
+static inline float
+filter_channel (const rsmp_filter_t * ap_flt, const float * ap_x)
+{
+  const OMX_U32 taps = ap_flt->taps;
+  if (ap_flt->exact)
+    {
+      return ap_flt->pf_dot (
+        ap_x, ap_flt->p_coeffs + (size_t) ap_flt->acc * taps, taps);
+    }
+  else
+    {
+      const OMX_U64 pos = (OMX_U64) ap_flt->acc * ap_flt->phases;
+      const OMX_U32 row = (OMX_U32) (pos / ap_flt->den);
+      const float w = (float) (pos % ap_flt->den) / (float) ap_flt->den;
+      const float * p_h = ap_flt->p_coeffs + (size_t) row * taps;
+      const float y0 = ap_flt->pf_dot (ap_x, p_h, taps);
+      const float y1 = ap_flt->pf_dot (ap_x, p_h + taps, taps);
+      return y0 + w * (y1 - y0);
+    }
+}
+
+static void
+convert (rsmp_filter_t * ap_flt, const void * ap_in,
+         const rsmp_format_t a_in_fmt, OMX_U32 * ap_in_frames, void * ap_out,
+         const rsmp_format_t a_out_fmt, OMX_U32 * ap_out_frames)
+{
+  const OMX_U32 nch = ap_flt->channels;
+  const OMX_U32 in_avail = *ap_in_frames;
+  const OMX_U32 out_avail = *ap_out_frames;
+  OMX_U32 in_used = 0;
+  OMX_U32 produced = 0;
+
+  for (;;)
+    {
+      while (produced < out_avail
+             && ap_flt->ipos + ap_flt->taps <= ap_flt->fill)
+        {
+          OMX_U32 c = 0;
+          for (c = 0; c < nch; ++c)
+            {
+              const float * p_x
+                = ap_flt->p_hist + (size_t) c * ap_flt->cap + ap_flt->ipos;
+              store_sample (ap_out, a_out_fmt, (size_t) produced * nch + c,
+                            filter_channel (ap_flt, p_x));
+            }
+          ++produced;
+          ap_flt->ipos += ap_flt->int_step;
+          ap_flt->acc += ap_flt->frac_step;
+          if (ap_flt->acc >= ap_flt->den)
+            {
+              ap_flt->acc -= ap_flt->den;
+              ++ap_flt->ipos;
+            }
+        }
+
+      if (produced == out_avail)
+        {
+          break;
+        }
+
+      compact_history (ap_flt);
+
+      if (in_used == in_avail)
+        {
+          break;
+        }
+
+      {
+        const OMX_U32 n = MIN (in_avail - in_used, ap_flt->cap - ap_flt->fill);
+        append_input (ap_flt, ap_in, a_in_fmt, in_used, n);
+        in_used += n;
+      }
+    }
+
+  *ap_in_frames = in_used;
+  *ap_out_frames = produced;
+}
+
+static void
+convert_bypass (const rsmp_filter_t * ap_flt, const void * ap_in,
+                const rsmp_format_t a_in_fmt, OMX_U32 * ap_in_frames,
+                void * ap_out, const rsmp_format_t a_out_fmt,
+                OMX_U32 * ap_out_frames)
+{
+  const OMX_U32 frames = MIN (*ap_in_frames, *ap_out_frames);
+  const size_t nsamples = (size_t) frames * ap_flt->channels;
+
+  if (a_in_fmt == a_out_fmt)
+    {
+      (void) memcpy (ap_out, ap_in,
+                     nsamples * rsmp_filter_sample_size (a_in_fmt));
+    }
+  else
+    {
+      size_t i = 0;
+      for (i = 0; i < nsamples; ++i)
+        {
+          store_sample (ap_out, a_out_fmt, i,
+                        load_sample (ap_in, a_in_fmt, i));
+        }
+    }
+
+  *ap_in_frames = frames;
+  *ap_out_frames = frames;
+}
+
+OMX_ERRORTYPE
+rsmp_filter_init (rsmp_filter_t ** app_flt, const OMX_U32 a_channels,
+                  const OMX_U32 a_in_rate, const OMX_U32 a_out_rate,
+                  const rsmp_quality_t a_quality)
+{
+  rsmp_filter_t * p_flt = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 g = 0;
+
+  assert (app_flt);
+
+  if (0 == a_channels || 0 == a_in_rate || 0 == a_out_rate
+      || a_quality >= ERsmpQualityMax)
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  p_flt = tiz_mem_calloc (1, sizeof (rsmp_filter_t));
+  tiz_check_null_ret_oom (p_flt);
+
+  g = gcd (a_in_rate, a_out_rate);
+  p_flt->channels = a_channels;
+  p_flt->in_rate = a_in_rate;
+  p_flt->out_rate = a_out_rate;
+  p_flt->bypass = (a_in_rate == a_out_rate);
+  p_flt->num = a_in_rate / g;
+  p_flt->den = a_out_rate / g;
+  p_flt->int_step = p_flt->num / p_flt->den;
+  p_flt->frac_step = p_flt->num % p_flt->den;
+  p_flt->pf_dot = select_dot (NULL);
+
+  if (!p_flt->bypass)
+    {
+      if (OMX_ErrorNone != (rc = design_filter (p_flt, a_quality)))
+        {
+          rsmp_filter_destroy (p_flt);
+          return rc;
+        }
+      p_flt->cap = p_flt->taps + RSMP_BLOCK_FRAMES;
+      p_flt->p_hist
+        = tiz_mem_alloc ((size_t) p_flt->cap * a_channels * sizeof (float));
+      if (!p_flt->p_hist)
+        {
+          rsmp_filter_destroy (p_flt);
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+
+  rsmp_filter_reset (p_flt);
+  *app_flt = p_flt;
+  return OMX_ErrorNone;
+}
+
+void
+rsmp_filter_destroy (rsmp_filter_t * ap_flt)
+{
+  if (ap_flt)
+    {
+      tiz_mem_free (ap_flt->p_hist);
+      tiz_mem_free (ap_flt->p_coeffs_mem);
+      tiz_mem_free (ap_flt);
+    }
+}
+
+void
+rsmp_filter_reset (rsmp_filter_t * ap_flt)
+{
+  assert (ap_flt);
+  ap_flt->ipos = 0;
+  ap_flt->acc = 0;
+  ap_flt->in_total = 0;
+  ap_flt->out_total = 0;
+  ap_flt->fill = 0;
+  if (!ap_flt->bypass)
+    {
+      /* Centre the filter on the first input frame, so that the output is not
+         delayed */
+      append_input (ap_flt, NULL, ERsmpFormatF32, 0, ap_flt->taps / 2 - 1);
+    }
+}
+
+void
+rsmp_filter_process (rsmp_filter_t * ap_flt, const void * ap_in,
+                     const rsmp_format_t a_in_fmt, OMX_U32 * ap_in_frames,
+                     void * ap_out, const rsmp_format_t a_out_fmt,
+                     OMX_U32 * ap_out_frames)
+{
+  assert (ap_flt);
+  assert (ap_in);
+  assert (ap_out);
+  assert (ap_in_frames);
+  assert (ap_out_frames);
+
+  if (ap_flt->bypass)
+    {
+      convert_bypass (ap_flt, ap_in, a_in_fmt, ap_in_frames, ap_out, a_out_fmt,
+                      ap_out_frames);
+    }
+  else
+    {
+      convert (ap_flt, ap_in, a_in_fmt, ap_in_frames, ap_out, a_out_fmt,
+               ap_out_frames);
+    }
+  ap_flt->in_total += *ap_in_frames;
+  ap_flt->out_total += *ap_out_frames;
+}
+
+void
+rsmp_filter_drain (rsmp_filter_t * ap_flt, void * ap_out,
+                   const rsmp_format_t a_out_fmt, OMX_U32 * ap_out_frames)
+{
+  OMX_U64 expected = 0;
+  OMX_U32 in_frames = UINT32_MAX;
+
+  assert (ap_flt);
+  assert (ap_out_frames);
+
+  /* The output is trimmed to the exact length of the input, once converted */
+  expected
+    = (ap_flt->in_total * ap_flt->den + ap_flt->num - 1) / ap_flt->num;
+
+  if (ap_flt->bypass || ap_flt->out_total >= expected)
+    {
+      *ap_out_frames = 0;
+      return;
+    }
+
+  *ap_out_frames
+    = (OMX_U32) MIN ((OMX_U64) *ap_out_frames, expected - ap_flt->out_total);
+  convert (ap_flt, NULL, ERsmpFormatF32, &in_frames, ap_out, a_out_fmt,
+           ap_out_frames);
+  ap_flt->out_total += *ap_out_frames;
+}
+
+OMX_U32
+rsmp_filter_sample_size (const rsmp_format_t a_fmt)
+{
+  return ERsmpFormatS16 == a_fmt ? sizeof (int16_t) : sizeof (int32_t);
+}
+
+const char *
+rsmp_filter_simd_name (void)
+{
+  const char * p_name = NULL;
+  (void) select_dot (&p_name);
+  return p_name;
+}
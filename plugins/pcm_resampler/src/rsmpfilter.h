@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpfilter.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler - polyphase windowed-sinc filter
+ *
+ * The filter keeps a planar float history per channel. Each output frame is
+ * the dot product of 'taps' history samples with one row (phase) of a
+ * Kaiser-windowed sinc table. When the reduced output rate is small enough,
+ * the table has one row per output phase and the conversion is exact;
+ * otherwise, two adjacent rows are interpolated. Input and output are
+ * interleaved S16, S32 or F32.
+ *
+ */
+
+#ifndef RSMPFILTER_H
+#define RSMPFILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef enum rsmp_format rsmp_format_t;
+enum rsmp_format
+{
+  ERsmpFormatS16,
+  ERsmpFormatS32,
+  ERsmpFormatF32,
+  ERsmpFormatMax
+};
+
+typedef enum rsmp_quality rsmp_quality_t;
+enum rsmp_quality
+{
+  ERsmpQualityLow,
+  ERsmpQualityMedium,
+  ERsmpQualityHigh,
+  ERsmpQualityBest,
+  ERsmpQualityMax
+};
+
+typedef struct rsmp_filter rsmp_filter_t;
+
+OMX_ERRORTYPE
+rsmp_filter_init (rsmp_filter_t ** app_flt, const OMX_U32 a_channels,
+                  const OMX_U32 a_in_rate, const OMX_U32 a_out_rate,
+                  const rsmp_quality_t a_quality);
+
+void
+rsmp_filter_destroy (rsmp_filter_t * ap_flt);
+
+/**
+ * Discard the history and start a new stream.
+ */
+void
+rsmp_filter_reset (rsmp_filter_t * ap_flt);
+
+/**
+ * Convert up to *ap_in_frames input frames into up to *ap_out_frames output
+ * frames. On return, *ap_in_frames holds the number of input frames consumed
+ * and *ap_out_frames the number of output frames produced. Input that can not
+ * be used yet stays in the filter history.
+ */
+void
+rsmp_filter_process (rsmp_filter_t * ap_flt, const void * ap_in,
+                     const rsmp_format_t a_in_fmt, OMX_U32 * ap_in_frames,
+                     void * ap_out, const rsmp_format_t a_out_fmt,
+                     OMX_U32 * ap_out_frames);
+
+/**
+ * Flush the tail of the stream at EOS. Produces at most *ap_out_frames
+ * frames; once it produces none, the stream has been completely converted.
+ */
+void
+rsmp_filter_drain (rsmp_filter_t * ap_flt, void * ap_out,
+                   const rsmp_format_t a_out_fmt, OMX_U32 * ap_out_frames);
+
+/**
+ * Number of bytes per sample of a format.
+ */
+OMX_U32
+rsmp_filter_sample_size (const rsmp_format_t a_fmt);
+
+/**
+ * The inner loop flavour in use: "avx", "sse", "neon" or "scalar".
+ */
+const char *
+rsmp_filter_simd_name (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RSMPFILTER_H */
@@ -0,0 +1,521 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler processor class
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "rsmp.h"
+#include "rsmpprc.h"
+#include "rsmpprc_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.pcm_resampler.prc"
+#endif
+
+/* Forward declarations */
+static OMX_ERRORTYPE
+rsmp_prc_deallocate_resources (void *);
+
+static inline OMX_BUFFERHEADERTYPE *
+get_in_hdr (rsmp_prc_t * ap_prc)
+{
+  return tiz_filter_prc_get_header (ap_prc,
+                                    ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX);
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_out_hdr (rsmp_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE ** pp_out = tiz_filter_prc_get_header_ptr (
+    ap_prc, ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX);
+  const bool fresh = (NULL == *pp_out);
+  OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
+    ap_prc, ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX);
+  if (p_out && fresh)
+    {
+      /* Output buffers are filled over several input buffers */
+      p_out->nFilledLen = 0;
+      p_out->nOffset = 0;
+    }
+  return p_out;
+}
+
+static OMX_ERRORTYPE
+release_in_hdr (rsmp_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_in = get_in_hdr (ap_prc);
+  assert (ap_prc);
+  if (p_in)
+    {
+      if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "EOS flag received");
+          /* The filter's tail is flushed before EOS is propagated */
+          ap_prc->draining_ = true;
+          tiz_util_reset_eos_flag (p_in);
+        }
+      tiz_check_omx (tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+release_out_hdr (rsmp_prc_t * ap_prc, const bool a_eos)
+{
+  OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
+  assert (ap_prc);
+  if (p_out)
+    {
+      if (a_eos)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Propagating EOS flag");
+          tiz_util_set_eos_flag (p_out);
+        }
+      TIZ_TRACE (handleOf (ap_prc),
+                 "Releasing OUT HEADER [%p] nFilledLen [%d] nAllocLen [%d]",
+                 p_out, p_out->nFilledLen, p_out->nAllocLen);
+      tiz_check_omx (tiz_filter_prc_release_header (
+        ap_prc, ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX));
+    }
+  return OMX_ErrorNone;
+}
+
+static inline OMX_U32
+out_frames_free (const rsmp_prc_t * ap_prc,
+                 const OMX_BUFFERHEADERTYPE * ap_out)
+{
+  return (ap_out->nAllocLen - ap_out->nOffset - ap_out->nFilledLen)
+         / ap_prc->out_frame_size_;
+}
+
+static inline OMX_U8 *
+out_write_ptr (const OMX_BUFFERHEADERTYPE * ap_out)
+{
+  return ap_out->pBuffer + ap_out->nOffset + ap_out->nFilledLen;
+}
+
+static OMX_ERRORTYPE
+resolve_format (rsmp_prc_t * ap_prc,
+                const OMX_AUDIO_PARAM_PCMMODETYPE * ap_pcmmode,
+                const OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE a_setting,
+                rsmp_format_t * ap_fmt)
+{
+  OMX_TIZONIA_AUDIO_SAMPLEFORMATTYPE fmt = a_setting;
+
+  if (OMX_AUDIO_SampleFormatAuto == fmt)
+    {
+      /* 32-bit PCM is float unless told otherwise (see OMX_TizoniaExt.h) */
+      fmt = (16 == ap_pcmmode->nBitPerSample) ? OMX_AUDIO_SampleFormatS16
+                                              : OMX_AUDIO_SampleFormatF32;
+    }
+
+  if ((OMX_AUDIO_SampleFormatS16 == fmt && 16 != ap_pcmmode->nBitPerSample)
+      || (OMX_AUDIO_SampleFormatS16 != fmt && 32 != ap_pcmmode->nBitPerSample)
+      || OMX_EndianLittle != ap_pcmmode->eEndian
+      || OMX_TRUE != ap_pcmmode->bInterleaved)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : port [%d] : "
+                 "nBitPerSample [%d] eEndian [%d] bInterleaved [%s]",
+                 ap_pcmmode->nPortIndex, ap_pcmmode->nBitPerSample,
+                 ap_pcmmode->eEndian,
+                 ap_pcmmode->bInterleaved ? "OMX_TRUE" : "OMX_FALSE");
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  *ap_fmt = (OMX_AUDIO_SampleFormatS16 == fmt)
+              ? ERsmpFormatS16
+              : (OMX_AUDIO_SampleFormatS32 == fmt ? ERsmpFormatS32
+                                                  : ERsmpFormatF32);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+retrieve_stream_settings (rsmp_prc_t * ap_prc)
+{
+  void * p_krn = tiz_get_krn (handleOf (ap_prc));
+
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->in_pcmmode_,
+                            ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (p_krn, handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm,
+                                       &(ap_prc->in_pcmmode_)));
+
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->out_pcmmode_,
+                            ARATELIA_PCM_RESAMPLER_OUTPUT_PORT_INDEX);
+  tiz_check_omx (tiz_api_GetParameter (p_krn, handleOf (ap_prc),
+                                       OMX_IndexParamAudioPcm,
+                                       &(ap_prc->out_pcmmode_)));
+
+  TIZ_INIT_OMX_STRUCT (ap_prc->resampler_);
+  tiz_check_omx (tiz_api_GetParameter (
+    p_krn, handleOf (ap_prc),
+    (OMX_INDEXTYPE) OMX_TizoniaIndexParamAudioResampler,
+    &(ap_prc->resampler_)));
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "in: [%d] Hz [%d] ch [%d] bits - out: [%d] Hz [%d] ch [%d] bits "
+              "- quality [%d]",
+              ap_prc->in_pcmmode_.nSamplingRate, ap_prc->in_pcmmode_.nChannels,
+              ap_prc->in_pcmmode_.nBitPerSample,
+              ap_prc->out_pcmmode_.nSamplingRate,
+              ap_prc->out_pcmmode_.nChannels,
+              ap_prc->out_pcmmode_.nBitPerSample, ap_prc->resampler_.eQuality);
+
+  if (ap_prc->in_pcmmode_.nChannels != ap_prc->out_pcmmode_.nChannels)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : channel count mismatch "
+                 "in [%d] out [%d]",
+                 ap_prc->in_pcmmode_.nChannels,
+                 ap_prc->out_pcmmode_.nChannels);
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  tiz_check_omx (resolve_format (ap_prc, &(ap_prc->in_pcmmode_),
+                                 ap_prc->resampler_.eInputFormat,
+                                 &(ap_prc->in_fmt_)));
+  tiz_check_omx (resolve_format (ap_prc, &(ap_prc->out_pcmmode_),
+                                 ap_prc->resampler_.eOutputFormat,
+                                 &(ap_prc->out_fmt_)));
+
+  ap_prc->in_frame_size_ = ap_prc->in_pcmmode_.nChannels
+                           * rsmp_filter_sample_size (ap_prc->in_fmt_);
+  ap_prc->out_frame_size_ = ap_prc->out_pcmmode_.nChannels
+                            * rsmp_filter_sample_size (ap_prc->out_fmt_);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+init_filter (rsmp_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  rsmp_filter_destroy (ap_prc->p_flt_);
+  ap_prc->p_flt_ = NULL;
+  ap_prc->draining_ = false;
+
+  tiz_check_omx (retrieve_stream_settings (ap_prc));
+  tiz_check_omx (rsmp_filter_init (
+    &(ap_prc->p_flt_), ap_prc->in_pcmmode_.nChannels,
+    ap_prc->in_pcmmode_.nSamplingRate, ap_prc->out_pcmmode_.nSamplingRate,
+    (rsmp_quality_t) ap_prc->resampler_.eQuality));
+
+  TIZ_TRACE (handleOf (ap_prc), "filter loops [%s]", rsmp_filter_simd_name ());
+  return OMX_ErrorNone;
+}
+
+static void
+reset_stream_parameters (rsmp_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->draining_ = false;
+  if (ap_prc->p_flt_)
+    {
+      rsmp_filter_reset (ap_prc->p_flt_);
+    }
+}
+
+static OMX_ERRORTYPE
+transform_buffer (rsmp_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
+  OMX_BUFFERHEADERTYPE * p_in = NULL;
+  OMX_U32 in_frames = 0;
+  OMX_U32 out_frames = 0;
+
+  if (!p_out || !(p_in = get_in_hdr (ap_prc)))
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  in_frames = p_in->nFilledLen / ap_prc->in_frame_size_;
+  out_frames = out_frames_free (ap_prc, p_out);
+
+  if (in_frames > 0 && out_frames > 0)
+    {
+      rsmp_filter_process (ap_prc->p_flt_, p_in->pBuffer + p_in->nOffset,
+                           ap_prc->in_fmt_, &in_frames, out_write_ptr (p_out),
+                           ap_prc->out_fmt_, &out_frames);
+      p_in->nOffset += in_frames * ap_prc->in_frame_size_;
+      p_in->nFilledLen -= in_frames * ap_prc->in_frame_size_;
+      p_out->nFilledLen += out_frames * ap_prc->out_frame_size_;
+    }
+
+  if (p_in->nFilledLen < ap_prc->in_frame_size_)
+    {
+      /* Any trailing partial frame is dropped */
+      tiz_check_omx (release_in_hdr (ap_prc));
+    }
+
+  if (out_frames_free (ap_prc, p_out) == 0)
+    {
+      tiz_check_omx (release_out_hdr (ap_prc, false));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+drain_filter (rsmp_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_out = get_out_hdr (ap_prc);
+  OMX_U32 out_frames = 0;
+
+  if (!p_out)
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  out_frames = out_frames_free (ap_prc, p_out);
+  rsmp_filter_drain (ap_prc->p_flt_, out_write_ptr (p_out), ap_prc->out_fmt_,
+                     &out_frames);
+  p_out->nFilledLen += out_frames * ap_prc->out_frame_size_;
+
+  if (0 == out_frames)
+    {
+      /* Nothing left in the filter: end of stream */
+      ap_prc->draining_ = false;
+      tiz_check_omx (release_out_hdr (ap_prc, true));
+      rsmp_filter_reset (ap_prc->p_flt_);
+    }
+  else if (out_frames_free (ap_prc, p_out) == 0)
+    {
+      tiz_check_omx (release_out_hdr (ap_prc, false));
+    }
+
+  return OMX_ErrorNone;
+}
+
+/*
+ * rsmpprc
+ */
+
+static void *
+rsmp_prc_ctor (void * ap_obj, va_list * app)
+{
+  rsmp_prc_t * p_prc = super_ctor (typeOf (ap_obj, "rsmpprc"), ap_obj, app);
+  assert (p_prc);
+  p_prc->p_flt_ = NULL;
+  p_prc->in_fmt_ = ERsmpFormatS16;
+  p_prc->out_fmt_ = ERsmpFormatS16;
+  p_prc->in_frame_size_ = 0;
+  p_prc->out_frame_size_ = 0;
+  p_prc->draining_ = false;
+  return p_prc;
+}
+
+static void *
+rsmp_prc_dtor (void * ap_obj)
+{
+  (void) rsmp_prc_deallocate_resources (ap_obj);
+  return super_dtor (typeOf (ap_obj, "rsmpprc"), ap_obj);
+}
+
+/*
+ * from tizsrv class
+ */
+
+static OMX_ERRORTYPE
+rsmp_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  /* The filter depends on the port settings; it is built in
+     prepare_to_transfer */
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_deallocate_resources (void * ap_obj)
+{
+  rsmp_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  rsmp_filter_destroy (p_prc->p_flt_);
+  p_prc->p_flt_ = NULL;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
+{
+  return init_filter (ap_obj);
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_stop_and_return (void * ap_obj)
+{
+  reset_stream_parameters (ap_obj);
+  return tiz_filter_prc_release_all_headers (ap_obj);
+}
+
+/*
+ * from tizprc class
+ */
+
+static OMX_ERRORTYPE
+rsmp_prc_buffers_ready (const void * ap_obj)
+{
+  rsmp_prc_t * p_prc = (rsmp_prc_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+
+  if (!p_prc->p_flt_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  while (OMX_ErrorNone == rc)
+    {
+      rc = p_prc->draining_ ? drain_filter (p_prc) : transform_buffer (p_prc);
+    }
+
+  return (OMX_ErrorNotReady == rc) ? OMX_ErrorNone : rc;
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_port_flush (const void * ap_obj, OMX_U32 a_pid)
+{
+  rsmp_prc_t * p_prc = (rsmp_prc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid || ARATELIA_PCM_RESAMPLER_INPUT_PORT_INDEX == a_pid)
+    {
+      reset_stream_parameters (p_prc);
+    }
+  /* Release any buffers held  */
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_port_disable (const void * ap_obj, OMX_U32 a_pid)
+{
+  rsmp_prc_t * p_prc = (rsmp_prc_t *) ap_obj;
+  assert (p_prc);
+  reset_stream_parameters (p_prc);
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, true);
+  return tiz_filter_prc_release_header (p_prc, a_pid);
+}
+
+static OMX_ERRORTYPE
+rsmp_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  rsmp_prc_t * p_prc = (rsmp_prc_t *) ap_obj;
+  assert (p_prc);
+  tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, false);
+  /* Ports are typically disabled and re-enabled when the input rate changes;
+     the filter is redesigned for the new settings */
+  return init_filter (p_prc);
+}
+
+/*
+ * rsmp_prc_class
+ */
+
+static void *
+rsmp_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "rsmpprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+rsmp_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * rsmpprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizfilterprc), "rsmpprc_class", classOf (tizfilterprc),
+     sizeof (rsmp_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, rsmp_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return rsmpprc_class;
+}
+
+void *
+rsmp_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizfilterprc = tiz_get_type (ap_hdl, "tizfilterprc");
+  void * rsmpprc_class = tiz_get_type (ap_hdl, "rsmpprc_class");
+  TIZ_LOG_CLASS (rsmpprc_class);
+  void * rsmpprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (rsmpprc_class, "rsmpprc", tizfilterprc, sizeof (rsmp_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, rsmp_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, rsmp_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, rsmp_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, rsmp_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, rsmp_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, rsmp_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, rsmp_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, rsmp_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, rsmp_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, rsmp_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, rsmp_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return rsmpprc;
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   rsmpprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - PCM resampler processor class decls
+ *
+ *
+ */
+
+#ifndef RSMPPRC_DECLS_H
+#define RSMPPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Audio.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizfilterprc.h>
+#include <tizfilterprc_decls.h>
+
+#include "rsmpfilter.h"
+
+typedef struct rsmp_prc rsmp_prc_t;
+struct rsmp_prc
+{
+  /* Object */
+  const tiz_filter_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE in_pcmmode_;
+  OMX_AUDIO_PARAM_PCMMODETYPE out_pcmmode_;
+  OMX_TIZONIA_AUDIO_PARAM_RESAMPLERTYPE resampler_;
+  rsmp_filter_t * p_flt_;
+  rsmp_format_t in_fmt_;
+  rsmp_format_t out_fmt_;
+  OMX_U32 in_frame_size_;
+  OMX_U32 out_frame_size_;
+  bool draining_;
+};
+
+typedef struct rsmp_prc_class rsmp_prc_class_t;
+struct rsmp_prc_class
+{
+  /* Class */
+  const tiz_filter_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RSMPPRC_DECLS_H */
@@ -51,8 +51,8 @@ extern "C" {
 #define ARATELIA_SPOTIFY_SOURCE_MIN_VOLUME_VALUE 0
 #define ARATELIA_SPOTIFY_SOURCE_DEFAULT_BIT_RATE_KBITS 320
 #define ARATELIA_SPOTIFY_SOURCE_DEFAULT_CACHE_SECONDS 6
-#define ARATELIA_SPOTIFY_SOURCE_MIN_CACHE_SECONDS 7
 #define ARATELIA_SPOTIFY_SOURCE_MAX_CACHE_SECONDS 12
+#define ARATELIA_SPOTIFY_SOURCE_PCM_BYTES_PER_SECOND (44100 * 2 * 2)
 
 #ifdef __cplusplus
 }
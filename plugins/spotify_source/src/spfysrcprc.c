@@ -57,6 +57,9 @@
 
 #define SPFYSRC_MIN_QUEUE_UNUSED_SPACES 5
 #define SPFYSRC_MAX_STRING_SIZE 2 * OMX_MAX_STRINGNAME_SIZE
+/* Ring space that music delivery leaves free, so that a format or an
+   end-of-stream marker always fits */
+#define SPFYSRC_RING_RESERVE_BYTES 64
 
 /* This macro assumes the existence of an "ap_prc" local variable */
 #define goto_end_on_sp_error(expr)                         \
@@ -82,21 +85,14 @@ omx_preferred_bitrate_to_spfy (
   const OMX_TIZONIA_AUDIO_SPOTIFYBITRATETYPE a_bitrate_type, int * ap_bitrate);
 static void
 end_of_track_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event);
+static void
+music_delivery_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event);
 
 /* The application key, specific to each project. */
 extern const uint8_t g_appkey[];
 /* The size of the application key. */
 extern const size_t g_appkey_size;
 
-typedef struct spfy_music_delivery_data spfy_music_delivery_data_t;
-struct spfy_music_delivery_data
-{
-  sp_session * p_sess;
-  sp_audioformat format;
-  void * p_frames;
-  int num_frames;
-};
-
 static OMX_S32
 ready_playlist_map_compare_func (OMX_PTR ap_key1, OMX_PTR ap_key2)
 {
@@ -240,11 +236,35 @@ playlist_name_match (spfysrc_prc_t * ap_prc, const char * ap_pl_name,
   return outcome;
 }
 
+static void
+discard_cache (spfysrc_prc_t * ap_prc)
+{
+  OMX_U8 sink[4096];
+  tiz_shmring_event_t next = ETIZShmRingEventNone;
+  assert (ap_prc);
+
+  /* Drop the queued audio, but keep any format markers */
+  while (ap_prc->p_ring_
+         && ((next = tiz_shmring_next (ap_prc->p_ring_, 0))
+               == ETIZShmRingEventData
+             || next == ETIZShmRingEventEos))
+    {
+      if (ETIZShmRingEventEos == next)
+        {
+          (void) tiz_shmring_read_eos (ap_prc->p_ring_);
+        }
+      else
+        {
+          (void) tiz_shmring_read (ap_prc->p_ring_, sink, sizeof (sink));
+        }
+    }
+}
+
 static void
 reset_stream_parameters (spfysrc_prc_t * ap_prc)
 {
   assert (ap_prc);
-  tiz_buffer_clear (ap_prc->p_store_);
+  discard_cache (ap_prc);
   ap_prc->initial_cache_bytes_
     = ((ARATELIA_SPOTIFY_SOURCE_DEFAULT_BIT_RATE_KBITS * 1000) / 8)
       * ARATELIA_SPOTIFY_SOURCE_DEFAULT_CACHE_SECONDS;
@@ -723,12 +743,6 @@ set_spotify_session_options (spfysrc_prc_t * ap_prc)
   goto_end_on_sp_error (
     sp_session_set_private_session (ap_prc->p_sp_session_, private_session));
 
-  ap_prc->min_cache_bytes_
-    = ((bitrate * 1000) / 8) * ARATELIA_SPOTIFY_SOURCE_MIN_CACHE_SECONDS;
-
-  ap_prc->max_cache_bytes_
-    = ((bitrate * 1000) / 8) * ARATELIA_SPOTIFY_SOURCE_MAX_CACHE_SECONDS;
-
   /* All OK */
   rc = OMX_ErrorNone;
 
@@ -740,40 +754,27 @@ end:
 static OMX_ERRORTYPE
 allocate_temp_data_store (spfysrc_prc_t * ap_prc)
 {
-  OMX_PARAM_PORTDEFINITIONTYPE port_def;
   assert (ap_prc);
-  TIZ_INIT_OMX_PORT_STRUCT (port_def, ARATELIA_SPOTIFY_SOURCE_PORT_INDEX);
-  tiz_check_omx (
-    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
-                          OMX_IndexParamPortDefinition, &port_def));
-  assert (ap_prc->p_store_ == NULL);
-  return tiz_buffer_init (&(ap_prc->p_store_), port_def.nBufferSize);
+  assert (ap_prc->p_ring_ == NULL);
+  /* A process-private ring: libspotify's delivery thread writes PCM
+     straight into it, and the processor drains it into the omx buffers */
+  return tiz_shmring_open (&(ap_prc->p_ring_), NULL,
+                           ARATELIA_SPOTIFY_SOURCE_PCM_BYTES_PER_SECOND
+                             * ARATELIA_SPOTIFY_SOURCE_MAX_CACHE_SECONDS);
 }
 
 static inline void
 deallocate_temp_data_store (
   /*@special@ */ spfysrc_prc_t * ap_prc)
-/*@releases ap_prc->p_store_@ */
-/*@ensures isnull ap_prc->p_store_@ */
+/*@releases ap_prc->p_ring_@ */
+/*@ensures isnull ap_prc->p_ring_@ */
 {
   assert (ap_prc);
-  tiz_buffer_destroy (ap_prc->p_store_);
-  ap_prc->p_store_ = NULL;
-}
-
-static inline int
-copy_to_omx_buffer (OMX_BUFFERHEADERTYPE * ap_hdr, const void * ap_src,
-                    const int nbytes)
-{
-  int n = MIN (nbytes, ap_hdr->nAllocLen - ap_hdr->nFilledLen);
-  assert (n > 0);
-  (void) memcpy (ap_hdr->pBuffer + ap_hdr->nOffset, ap_src, n);
-  ap_hdr->nFilledLen += n;
-  ap_hdr->nOffset += n;
-  TIZ_PRINTF_DBG_YEL (
-    "HEADER [%p] nbytes [%d] alloc [%d] fill [%d] offset [%d]\n", ap_hdr, n,
-    ap_hdr->nAllocLen, ap_hdr->nFilledLen, ap_hdr->nOffset);
-  return n;
+  if (ap_prc->p_ring_)
+    {
+      tiz_shmring_close (ap_prc->p_ring_);
+      ap_prc->p_ring_ = NULL;
+    }
 }
 
 static OMX_ERRORTYPE
@@ -784,16 +785,6 @@ release_buffer (spfysrc_prc_t * ap_prc)
   if (ap_prc->p_outhdr_)
     {
       OMX_BUFFERHEADERTYPE * p_hdr = ap_prc->p_outhdr_;
-      if (ap_prc->eos_)
-        {
-          ap_prc->bytes_till_eos_ -= p_hdr->nFilledLen;
-          if (ap_prc->bytes_till_eos_ <= 0)
-            {
-              ap_prc->bytes_till_eos_ = 0;
-              ap_prc->eos_ = false;
-              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
-            }
-        }
       p_hdr->nOffset = 0;
       tiz_check_omx (
         tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)), 0, p_hdr));
@@ -824,6 +815,9 @@ buffer_needed (spfysrc_prc_t * ap_prc)
               if (ap_prc->p_outhdr_)
                 {
                   p_hdr = ap_prc->p_outhdr_;
+                  p_hdr->nFilledLen = 0;
+                  p_hdr->nOffset = 0;
+                  p_hdr->nFlags = 0;
                 }
             }
         }
@@ -879,64 +873,123 @@ stop_spotify (spfysrc_prc_t * ap_prc)
     }
 }
 
-/* Decide if spotify music delivery needs pause/re-start */
 static void
-reevaluate_cache (spfysrc_prc_t * ap_prc)
+update_pcm_format (spfysrc_prc_t * ap_prc,
+                   const tiz_shmring_format_t * ap_format)
 {
   assert (ap_prc);
-
-  if (ap_prc->p_sp_session_ && !ap_prc->initial_cache_bytes_)
+  assert (ap_format);
+  if (ap_prc->auto_detect_on_ || ap_prc->num_channels_ != ap_format->channels
+      || ap_prc->samplerate_ != ap_format->sample_rate)
     {
-      const int current_cache_bytes = tiz_buffer_available (ap_prc->p_store_);
-      if (current_cache_bytes > ap_prc->max_cache_bytes_
-          && !ap_prc->spotify_paused_)
-        {
-          /* Temporarily pause spotify music delivery */
-          pause_spotify (ap_prc);
-        }
-      else if (current_cache_bytes <= ap_prc->min_cache_bytes_
-               && ap_prc->spotify_paused_)
-        {
-          /* Re-start spotify music delivery */
-          start_spotify (ap_prc);
-        }
+      ap_prc->auto_detect_on_ = false;
+      ap_prc->num_channels_ = ap_format->channels;
+      ap_prc->samplerate_ = ap_format->sample_rate;
+      ap_prc->audio_coding_type_ = OMX_AUDIO_CodingPCM;
+      set_audio_coding_on_port (ap_prc);
+      set_pcm_audio_info_on_port (ap_prc);
+      /* And now trigger the OMX_EventPortFormatDetected and
+         OMX_EventPortSettingsChanged events or a
+         OMX_ErrorFormatNotDetected event */
+      send_port_auto_detect_events (ap_prc);
     }
 }
 
+/* Ask music delivery for a wake-up call once there are a_nbytes in the ring.
+   Returns true if they arrived while the request was being made, in which
+   case no call will come. */
+static bool
+wait_for_cache (spfysrc_prc_t * ap_prc, const int a_nbytes)
+{
+  int wake_bytes = a_nbytes;
+  assert (ap_prc);
+  assert (a_nbytes > 0);
+  __atomic_store_n (&(ap_prc->wake_bytes_), a_nbytes, __ATOMIC_SEQ_CST);
+  return (tiz_shmring_used (ap_prc->p_ring_) >= (size_t) a_nbytes
+          && __atomic_compare_exchange_n (&(ap_prc->wake_bytes_), &wake_bytes,
+                                          0, false, __ATOMIC_SEQ_CST,
+                                          __ATOMIC_SEQ_CST));
+}
+
 static OMX_ERRORTYPE
 consume_cache (spfysrc_prc_t * ap_prc)
 {
+  OMX_BUFFERHEADERTYPE * p_out = NULL;
+  bool done = false;
   assert (ap_prc);
 
-  /* Also, control here the delivery of the next eos flag */
-  if (ap_prc->eos_ && ap_prc->bytes_till_eos_ <= 0)
+  if (!ap_prc->p_ring_)
     {
-      ap_prc->bytes_till_eos_ = tiz_buffer_available (ap_prc->p_store_);
+      return OMX_ErrorNone;
     }
 
-  TIZ_TRACE (handleOf (ap_prc),
-             "store [%d] initial_cache [%d] min_cache [%d] max_cache [%d]",
-             tiz_buffer_available (ap_prc->p_store_),
-             ap_prc->initial_cache_bytes_, ap_prc->min_cache_bytes_,
-             ap_prc->max_cache_bytes_);
+  TIZ_TRACE (handleOf (ap_prc), "ring [%lu] initial_cache [%d]",
+             (unsigned long) tiz_shmring_used (ap_prc->p_ring_),
+             ap_prc->initial_cache_bytes_);
 
-  if (tiz_buffer_available (ap_prc->p_store_) > ap_prc->initial_cache_bytes_)
+  if (ap_prc->initial_cache_bytes_ > 0)
     {
-      int nbytes_stored = 0;
-      OMX_BUFFERHEADERTYPE * p_out = NULL;
-
+      if (tiz_shmring_used (ap_prc->p_ring_)
+            <= (size_t) ap_prc->initial_cache_bytes_
+          && !wait_for_cache (ap_prc, ap_prc->initial_cache_bytes_ + 1))
+        {
+          return OMX_ErrorNone;
+        }
       /* Reset the initial size */
       ap_prc->initial_cache_bytes_ = 0;
+    }
 
-      while ((nbytes_stored = tiz_buffer_available (ap_prc->p_store_)) > 0
-             && (p_out = buffer_needed (ap_prc)) != NULL)
+  while (!done && (p_out = buffer_needed (ap_prc)) != NULL)
+    {
+      switch (tiz_shmring_next (ap_prc->p_ring_, 0))
         {
-          int nbytes_copied = copy_to_omx_buffer (
-            p_out, tiz_buffer_get (ap_prc->p_store_), nbytes_stored);
-          tiz_check_omx (release_buffer (ap_prc));
-          (void) tiz_buffer_advance (ap_prc->p_store_, nbytes_copied);
-          p_out = NULL;
-        }
+          case ETIZShmRingEventData:
+            {
+              p_out->nFilledLen += tiz_shmring_read (
+                ap_prc->p_ring_, p_out->pBuffer + p_out->nFilledLen,
+                p_out->nAllocLen - p_out->nFilledLen);
+              if (p_out->nFilledLen == p_out->nAllocLen)
+                {
+                  tiz_check_omx (release_buffer (ap_prc));
+                }
+            }
+            break;
+
+          case ETIZShmRingEventFormat:
+            {
+              tiz_shmring_format_t format;
+              if (p_out->nFilledLen > 0)
+                {
+                  /* The old format's data goes out first */
+                  tiz_check_omx (release_buffer (ap_prc));
+                }
+              else
+                {
+                  tiz_check_omx (
+                    tiz_shmring_read_format (ap_prc->p_ring_, &format));
+                  update_pcm_format (ap_prc, &format);
+                }
+            }
+            break;
+
+          case ETIZShmRingEventEos:
+            {
+              tiz_check_omx (tiz_shmring_read_eos (ap_prc->p_ring_));
+              p_out->nFlags |= OMX_BUFFERFLAG_EOS;
+              tiz_check_omx (release_buffer (ap_prc));
+            }
+            break;
+
+          default:
+            {
+              if (p_out->nFilledLen > 0)
+                {
+                  tiz_check_omx (release_buffer (ap_prc));
+                }
+              done = !wait_for_cache (ap_prc, 1);
+            }
+            break;
+        };
     }
   return OMX_ErrorNone;
 }
@@ -1034,8 +1087,7 @@ start_playback (spfysrc_prc_t * ap_prc)
                               sp_track_name (ap_prc->p_sp_track_));
 
               /* Let's process a fake end of track event */
-              process_spotify_event (ap_prc, end_of_track_handler,
-                                     ap_prc->p_sp_session_);
+              process_spotify_event (ap_prc, end_of_track_handler, ap_prc);
             }
         }
     }
@@ -1128,123 +1180,117 @@ static void
 music_delivery_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
 {
   spfysrc_prc_t * p_prc = ap_prc;
-
   assert (p_prc);
   assert (ap_event);
-
-  TIZ_TRACE (handleOf (ap_prc), "p_data [%p] ", ap_event->p_data);
-
-  /* Decide if spotify music delivery needs pause/re-start */
-  reevaluate_cache (ap_prc);
-
-  if (!p_prc->stopping_ && ap_event->p_data)
+  if (!p_prc->stopping_)
     {
-      spfy_music_delivery_data_t * p_data = ap_event->p_data;
-      int nbytes
-        = p_data->num_frames * sizeof (int16_t) * p_data->format.channels;
-      OMX_U8 * p_in = (OMX_U8 *) p_data->p_frames;
-      OMX_BUFFERHEADERTYPE * p_out = NULL;
-
-      TIZ_TRACE (handleOf (ap_prc),
-                 "nbytes [%d] spotify_paused_ [%s] store [%d]", nbytes,
-                 p_prc->spotify_paused_ ? "YES" : "NO",
-                 tiz_buffer_available (p_prc->p_store_));
+      (void) consume_cache (p_prc);
+    }
+  tiz_mem_free (ap_event);
+}
 
-      consume_cache (p_prc);
-      if (!p_prc->spotify_paused_)
-        {
-          while (nbytes > 0 && (p_out = buffer_needed (p_prc)) != NULL
-                 && !p_prc->initial_cache_bytes_)
-            {
-              int nbytes_copied = copy_to_omx_buffer (p_out, p_in, nbytes);
-              (void) release_buffer (p_prc);
-              nbytes -= nbytes_copied;
-              p_in += nbytes_copied;
-            }
-        }
+/* Post a music_delivery_handler event if the processor asked for one and the
+   ring now holds what it was waiting for. */
+static void
+wake_consumer (spfysrc_prc_t * ap_prc)
+{
+  int wake_bytes = 0;
+  assert (ap_prc);
+  wake_bytes = __atomic_load_n (&(ap_prc->wake_bytes_), __ATOMIC_SEQ_CST);
+  if (wake_bytes > 0
+      && tiz_shmring_used (ap_prc->p_ring_) >= (size_t) wake_bytes
+      && __atomic_compare_exchange_n (&(ap_prc->wake_bytes_), &wake_bytes, 0,
+                                      false, __ATOMIC_SEQ_CST,
+                                      __ATOMIC_SEQ_CST))
+    {
+      post_spotify_event (ap_prc, music_delivery_handler, ap_prc);
+    }
+}
 
-      if (nbytes > 0)
-        {
-          int nbytes_stored = 0;
-          if ((nbytes_stored = tiz_buffer_push (p_prc->p_store_, p_in, nbytes))
-              < nbytes)
-            {
-              TIZ_ERROR (handleOf (p_prc),
-                         "Unable to store all the data (wanted %d, "
-                         "stored %d).",
-                         nbytes, nbytes_stored);
-              assert (0);
-            }
-          nbytes -= nbytes_stored;
-        }
-      if (p_prc->auto_detect_on_
-          || p_prc->num_channels_ != p_data->format.channels
-          || p_prc->samplerate_ != p_data->format.sample_rate)
+/* Write the end-of-stream marker that the processor has asked for, if any.
+   The ring has a single producer, libspotify's delivery thread, so the
+   processor never writes the marker itself. */
+static bool
+write_pending_eos (spfysrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (__atomic_load_n (&(ap_prc->eos_pending_), __ATOMIC_SEQ_CST))
+    {
+      if (OMX_ErrorNone != tiz_shmring_write_eos (ap_prc->p_ring_, 0))
         {
-          p_prc->auto_detect_on_ = false;
-          p_prc->num_channels_ = p_data->format.channels;
-          p_prc->samplerate_ = p_data->format.sample_rate;
-          p_prc->audio_coding_type_ = OMX_AUDIO_CodingPCM;
-          set_audio_coding_on_port (p_prc);
-          set_pcm_audio_info_on_port (p_prc);
-          /* And now trigger the OMX_EventPortFormatDetected and
-             OMX_EventPortSettingsChanged events or a
-             OMX_ErrorFormatNotDetected event */
-          send_port_auto_detect_events (p_prc);
+          return false;
         }
-      tiz_mem_free (p_data->p_frames);
-      tiz_mem_free (ap_event->p_data);
+      __atomic_store_n (&(ap_prc->eos_pending_), 0, __ATOMIC_SEQ_CST);
     }
-  tiz_mem_free (ap_event);
+  return true;
 }
 
 /**
  * This callback is used from libspotify whenever there is PCM data available.
  *
+ * The frames are copied straight into the ring. If the ring does not have
+ * room for all of them, only those that fit are taken and libspotify will
+ * deliver the rest again later.
+ *
  * @note This function is called from an internal session thread!
  */
 static int
 music_delivery (sp_session * sess, const sp_audioformat * format,
                 const void * frames, int num_frames)
 {
+  spfysrc_prc_t * p_prc = sp_session_userdata (sess);
+  size_t frame_size = 0;
+  size_t writable = 0;
+  size_t written = 0;
   int num_frames_delivered = 0;
-  if (num_frames > 0)
-    {
-      /* We'll only send another pluggable event into the component's main
-         event queue if there are a few spaces available. Otherwise, we'll ask
-         Spotify to wait a little. */
-      if (tiz_comp_event_queue_unused_spaces (
-            handleOf (sp_session_userdata (sess)))
-          >= SPFYSRC_MIN_QUEUE_UNUSED_SPACES)
+
+  assert (p_prc);
+  assert (format);
+
+  if (num_frames <= 0 || !p_prc->p_ring_ || !write_pending_eos (p_prc))
+    {
+      return 0;
+    }
+
+  if (p_prc->delivery_channels_ != format->channels
+      || p_prc->delivery_samplerate_ != format->sample_rate)
+    {
+      tiz_shmring_format_t ring_format;
+      ring_format.domain = OMX_PortDomainAudio;
+      ring_format.encoding = OMX_AUDIO_CodingPCM;
+      ring_format.sample_rate = format->sample_rate;
+      ring_format.channels = format->channels;
+      ring_format.bits_per_sample = 16;
+      ring_format.big_endian = 0;
+      if (tiz_shmring_writable (p_prc->p_ring_)
+            < SPFYSRC_RING_RESERVE_BYTES + sizeof (ring_format)
+          || OMX_ErrorNone
+               != tiz_shmring_write_format (p_prc->p_ring_, &ring_format, 0))
         {
-          spfy_music_delivery_data_t * p_data
-            = tiz_mem_calloc (1, sizeof (spfy_music_delivery_data_t));
-          if (p_data)
-            {
-              size_t pcm_buffer_len
-                = num_frames * sizeof (int16_t) * format->channels;
-              assert (sess);
-              assert (format);
-              assert (frames);
-              p_data->p_sess = sess;
-              p_data->format.sample_type = format->sample_type;
-              p_data->format.sample_rate = format->sample_rate;
-              p_data->format.channels = format->channels;
-              p_data->p_frames = tiz_mem_alloc (pcm_buffer_len);
-              memcpy (p_data->p_frames, frames, pcm_buffer_len);
-              p_data->num_frames = num_frames;
-              TIZ_PRINTF_DBG_YEL (
-                "music_delivery - num frames : %d pcm_buffer_len : %d - "
-                "spaces %d\n",
-                num_frames, pcm_buffer_len,
-                tiz_comp_event_queue_unused_spaces (
-                  handleOf (sp_session_userdata (sess))));
-              post_spotify_event (sp_session_userdata (sess),
-                                  music_delivery_handler, p_data);
-              num_frames_delivered = num_frames;
-            }
+          return 0;
         }
+      p_prc->delivery_channels_ = format->channels;
+      p_prc->delivery_samplerate_ = format->sample_rate;
     }
+
+  frame_size = sizeof (int16_t) * format->channels;
+  writable = tiz_shmring_writable (p_prc->p_ring_);
+  if (writable > SPFYSRC_RING_RESERVE_BYTES + frame_size)
+    {
+      assert (frames);
+      written = tiz_shmring_write (
+        p_prc->p_ring_, frames,
+        MIN ((size_t) num_frames,
+             (writable - SPFYSRC_RING_RESERVE_BYTES) / frame_size)
+          * frame_size,
+        0);
+      num_frames_delivered = (int) (written / frame_size);
+    }
+
+  TIZ_PRINTF_DBG_YEL ("music_delivery - num frames : %d delivered : %d\n",
+                      num_frames, num_frames_delivered);
+
+  wake_consumer (p_prc);
   return num_frames_delivered;
 }
 
@@ -1258,7 +1304,6 @@ end_of_track_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
   if (!p_prc->stopping_ && ap_event->p_data)
     {
       int tracks = 0;
-      p_prc->eos_ = true;
 
       if (p_prc->p_sp_track_)
         {
@@ -1276,6 +1321,14 @@ end_of_track_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
             }
         }
 
+      if (ap_event->p_data == p_prc)
+        {
+          /* A fake end of track. Music delivery writes the marker ahead of
+             the next track's first frames */
+          __atomic_store_n (&(p_prc->eos_pending_), 1, __ATOMIC_SEQ_CST);
+        }
+      (void) consume_cache (p_prc);
+
       start_playback (p_prc);
       (void) process_spotify_session_events (p_prc);
     }
@@ -1290,8 +1343,15 @@ end_of_track_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
 static void
 end_of_track (sp_session * sess)
 {
+  spfysrc_prc_t * p_prc = sp_session_userdata (sess);
+  assert (p_prc);
+
   TIZ_PRINTF_DBG_YEL ("end_of_track\n");
 
+  /* The marker follows the track's last frames in the ring */
+  (void) write_pending_eos (p_prc);
+  (void) tiz_shmring_write_eos (p_prc->p_ring_, 0);
+  wake_consumer (p_prc);
   post_spotify_event (sp_session_userdata (sess), end_of_track_handler, sess);
 }
 
@@ -1638,17 +1698,17 @@ spfysrc_prc_ctor (void * ap_obj, va_list * app)
 
   p_prc->p_outhdr_ = NULL;
   p_prc->p_uri_param_ = NULL;
-  p_prc->eos_ = false;
-  p_prc->bytes_till_eos_ = 0;
   p_prc->transfering_ = false;
   p_prc->stopping_ = false;
   p_prc->port_disabled_ = false;
   p_prc->spotify_inited_ = false;
   p_prc->spotify_paused_ = false;
   p_prc->initial_cache_bytes_ = 0;
-  p_prc->min_cache_bytes_ = 0;
-  p_prc->max_cache_bytes_ = 0;
-  p_prc->p_store_ = NULL;
+  p_prc->p_ring_ = NULL;
+  p_prc->wake_bytes_ = 0;
+  p_prc->delivery_channels_ = 0;
+  p_prc->delivery_samplerate_ = 0;
+  p_prc->eos_pending_ = 0;
   p_prc->p_ev_timer_ = NULL;
   p_prc->p_shuffle_lst_ = NULL;
   TIZ_INIT_OMX_STRUCT (p_prc->session_);
@@ -1822,6 +1882,12 @@ spfysrc_prc_deallocate_resources (void * ap_prc)
 static OMX_ERRORTYPE
 spfysrc_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
 {
+  spfysrc_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  /* Music delivery will announce the format again */
+  p_prc->delivery_channels_ = 0;
+  p_prc->delivery_samplerate_ = 0;
+  __atomic_store_n (&(p_prc->eos_pending_), 0, __ATOMIC_SEQ_CST);
   reset_stream_parameters (ap_obj);
   return prepare_for_port_auto_detection (ap_obj);
 }
@@ -1860,13 +1926,11 @@ spfysrc_prc_buffers_ready (const void * ap_obj)
     {
       start_playback (p_prc);
     }
-  if (p_prc->transfering_ && p_prc->spotify_paused_)
+  if (p_prc->transfering_)
     {
       rc = consume_cache (p_prc);
-      /* Decide if spotify music delivery needs pause/re-start */
-      reevaluate_cache (p_prc);
     }
-  else
+  if (OMX_ErrorNone == rc)
     {
       rc = process_spotify_session_events (p_prc);
     }
@@ -1971,7 +2035,7 @@ spfysrc_prc_config_change (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid),
         }
 
       /* Let's process a fake end of track event */
-      process_spotify_event (p_prc, end_of_track_handler, p_prc->p_sp_session_);
+      process_spotify_event (p_prc, end_of_track_handler, p_prc);
     }
   return rc;
 }
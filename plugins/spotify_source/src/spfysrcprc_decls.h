@@ -47,17 +47,20 @@ struct spfysrc_prc
   const tiz_prc_t _;
   OMX_BUFFERHEADERTYPE * p_outhdr_;
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
-  bool eos_;
-  int bytes_till_eos_;
   bool transfering_;
   bool stopping_;
   bool port_disabled_;
   bool spotify_inited_;
   bool spotify_paused_;
   int initial_cache_bytes_;
-  int min_cache_bytes_;
-  int max_cache_bytes_;
-  tiz_buffer_t * p_store_; /* The component's pcm buffer */
+  tiz_shmring_t * p_ring_; /* The component's pcm ring, filled directly by
+                              libspotify's music delivery callback */
+  int wake_bytes_; /* Ring occupancy that music delivery must notify the
+                      processor about; 0 if the processor is not waiting */
+  int delivery_channels_;   /* Last format announced by music delivery */
+  int delivery_samplerate_;
+  int eos_pending_; /* A fake end of track that music delivery has yet to
+                       write to the ring */
   tiz_event_timer_t * p_ev_timer_;
   tiz_shuffle_lst_t * p_shuffle_lst_;
   OMX_TIZONIA_AUDIO_PARAM_SPOTIFYSESSIONTYPE session_;
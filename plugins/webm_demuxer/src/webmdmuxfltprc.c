@@ -25,7 +25,6 @@
  *
  * TODO: Support for video demuxing (VP8/VP9 demuxing no handled yet).
  * TODO: Finalise support for audio demuxer (VORBIS not handled yet, only OPUS demuxing).
- * TODO: Seek support.
  *
  */
 
@@ -471,6 +470,31 @@ prepare_port_auto_detection (webmdmuxflt_prc_t * ap_prc)
   return OMX_ErrorNone;
 }
 
+static inline OMX_U64
+stored_bytes (const webmdmuxflt_prc_t * ap_prc)
+{
+  return tiz_buffer_offset (ap_prc->p_webm_store_)
+         + tiz_buffer_available (ap_prc->p_webm_store_);
+}
+
+static OMX_ERRORTYPE
+update_seek_index (webmdmuxflt_prc_t * ap_prc)
+{
+  const OMX_U8 * p_start = NULL;
+  assert (ap_prc);
+
+  /* The store is seekable, so it holds every byte received so far */
+  p_start = (const OMX_U8 *) tiz_buffer_get (ap_prc->p_webm_store_)
+            - tiz_buffer_offset (ap_prc->p_webm_store_);
+  tiz_check_omx (
+    webmdmux_idx_scan (ap_prc->p_idx_, p_start, stored_bytes (ap_prc)));
+  if (tiz_filter_prc_is_eos (ap_prc))
+    {
+      webmdmux_idx_set_complete (ap_prc->p_idx_);
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 store_data (webmdmuxflt_prc_t * ap_prc)
 {
@@ -490,6 +514,10 @@ store_data (webmdmuxflt_prc_t * ap_prc)
       tiz_check_true_ret_val ((pushed == p_in->nFilledLen),
                               OMX_ErrorInsufficientResources);
       rc = release_input_header (ap_prc);
+      if (OMX_ErrorNone == rc)
+        {
+          rc = update_seek_index (ap_prc);
+        }
     }
   return rc;
 }
@@ -619,6 +647,34 @@ able_to_demux (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+/* After an accurate seek, the audio packets that start before the target are
+   dropped. Video is left alone: it has to be decoded from the cluster's
+   keyframe. */
+static bool
+skip_packet (webmdmuxflt_prc_t * ap_prc, const unsigned int a_track)
+{
+  const bool timeline_track
+    = a_track == ap_prc->ne_audio_track_
+      || (NESTEGG_TRACK_UNKNOWN == ap_prc->ne_audio_track_
+          && a_track == ap_prc->ne_video_track_);
+  uint64_t tstamp = 0;
+
+  if (!timeline_track
+      || 0 != nestegg_packet_tstamp (ap_prc->p_ne_pkt_, &tstamp))
+    {
+      return false;
+    }
+
+  if (tstamp < ap_prc->seek_skip_ns_ && a_track == ap_prc->ne_audio_track_)
+    {
+      return true;
+    }
+
+  ap_prc->seek_skip_ns_ = 0;
+  ap_prc->position_ = (OMX_TICKS) (tstamp / 1000);
+  return false;
+}
+
 static OMX_ERRORTYPE
 read_packet (webmdmuxflt_prc_t * ap_prc)
 {
@@ -642,6 +698,13 @@ read_packet (webmdmuxflt_prc_t * ap_prc)
 
       nestegg_packet_track (ap_prc->p_ne_pkt_, &track);
 
+      if (0 == ap_prc->ne_chunk_ && skip_packet (ap_prc, track))
+        {
+          nestegg_free_packet (ap_prc->p_ne_pkt_);
+          ap_prc->p_ne_pkt_ = NULL;
+          return rc;
+        }
+
       tiz_check_omx (extract_track_audio_data (ap_prc, track));
       tiz_check_omx (extract_track_video_data (ap_prc, track));
 
@@ -678,6 +741,62 @@ demux_stream (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+seek_stream (webmdmuxflt_prc_t * ap_prc)
+{
+  const uint64_t target_ns = (uint64_t) ap_prc->seek_target_ * 1000;
+  webmdmux_idx_entry_t entry;
+
+  assert (ap_prc);
+  assert (ap_prc->p_ne_);
+
+  /* Wait until the cluster that holds the target has arrived */
+  if (!webmdmux_idx_covers (ap_prc->p_idx_, target_ns)
+      || (webmdmux_idx_lookup (ap_prc->p_idx_, target_ns, &entry)
+          && entry.offset >= stored_bytes (ap_prc)))
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  ap_prc->seek_pending_ = false;
+
+  if (!webmdmux_idx_lookup (ap_prc->p_idx_, target_ns, &entry))
+    {
+      TIZ_WARN (handleOf (ap_prc), "No clusters found; ignoring seek");
+      return OMX_ErrorNone;
+    }
+
+  TIZ_DEBUG (handleOf (ap_prc),
+             "seek to [%lld] us - cluster at [%llu] time [%llu] ns "
+             "(%u entries%s)",
+             ap_prc->seek_target_, entry.offset, entry.time_ns,
+             webmdmux_idx_length (ap_prc->p_idx_),
+             webmdmux_idx_has_cues (ap_prc->p_idx_) ? ", cues" : "");
+
+  if (ap_prc->ne_read_err_ < 0)
+    {
+      ap_prc->ne_read_err_ = 0;
+      nestegg_read_reset (ap_prc->p_ne_);
+    }
+
+  if (ap_prc->p_ne_pkt_)
+    {
+      nestegg_free_packet (ap_prc->p_ne_pkt_);
+      ap_prc->p_ne_pkt_ = NULL;
+      ap_prc->ne_chunk_ = 0;
+    }
+
+  on_nestegg_error_ret_omx_oom (
+    nestegg_offset_seek (ap_prc->p_ne_, entry.offset));
+
+  ap_prc->seek_skip_ns_
+    = OMX_TIME_SeekModeAccurate == ap_prc->seek_mode_ ? target_ns : 0;
+  ap_prc->position_ = OMX_TIME_SeekModeAccurate == ap_prc->seek_mode_
+                        ? ap_prc->seek_target_
+                        : (OMX_TICKS) (entry.time_ns / 1000);
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 alloc_input_store (webmdmuxflt_prc_t * ap_prc)
 {
@@ -772,6 +891,10 @@ reset_nestegg_members (webmdmuxflt_prc_t * ap_prc)
   ap_prc->ne_read_err_ = 0;
   ap_prc->ne_last_read_len_ = 0;
   ap_prc->ne_failed_init_count_ = 0;
+  ap_prc->seek_pending_ = false;
+  ap_prc->seek_target_ = 0;
+  ap_prc->seek_skip_ns_ = 0;
+  ap_prc->position_ = 0;
 }
 
 static void
@@ -795,6 +918,7 @@ reset_stream_parameters (webmdmuxflt_prc_t * ap_prc)
   tiz_buffer_clear (ap_prc->p_vid_store_);
   tiz_vector_clear (ap_prc->p_aud_header_lengths_);
   tiz_vector_clear (ap_prc->p_vid_header_lengths_);
+  webmdmux_idx_reset (ap_prc->p_idx_);
 
   tiz_filter_prc_update_eos_flag (ap_prc, false);
 }
@@ -1131,6 +1255,8 @@ webmdmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_vid_store_ = NULL;
   p_prc->p_aud_header_lengths_ = NULL;
   p_prc->p_vid_header_lengths_ = NULL;
+  p_prc->p_idx_ = NULL;
+  p_prc->seek_mode_ = OMX_TIME_SeekModeFast;
   reset_stream_parameters (p_prc);
   g_handle = handleOf (ap_prc);
   return p_prc;
@@ -1155,6 +1281,8 @@ webmdmuxflt_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
   assert (p_prc);
   tiz_check_omx (alloc_input_store (p_prc));
   tiz_check_omx (alloc_output_stores (p_prc));
+  assert (!p_prc->p_idx_);
+  tiz_check_omx (webmdmux_idx_init (&(p_prc->p_idx_)));
   return OMX_ErrorNone;
 }
 
@@ -1166,6 +1294,8 @@ webmdmuxflt_prc_deallocate_resources (void * ap_prc)
   dealloc_output_stores (p_prc);
   dealloc_input_store (p_prc);
   dealloc_nestegg (p_prc);
+  webmdmux_idx_destroy (p_prc->p_idx_);
+  p_prc->p_idx_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -1238,7 +1368,11 @@ webmdmuxflt_prc_buffers_ready (const void * ap_prc)
               || tiz_filter_prc_is_port_disabled (
                    p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX)))
         {
-          rc = demux_stream (p_prc);
+          rc = p_prc->seek_pending_ ? seek_stream (p_prc) : OMX_ErrorNone;
+          if (!p_prc->seek_pending_ && OMX_ErrorNone == rc)
+            {
+              rc = demux_stream (p_prc);
+            }
           if (OMX_ErrorNotReady == rc)
             {
               rc = OMX_ErrorNone;
@@ -1289,6 +1423,106 @@ webmdmuxflt_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+webmdmuxflt_prc_config_change (const void * ap_prc, OMX_U32 a_pid,
+                               OMX_INDEXTYPE a_config_idx)
+{
+  const webmdmuxflt_prc_t * p_prc = ap_prc;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  if (OMX_IndexConfigTimePosition == a_config_idx && p_prc->ne_inited_)
+    {
+      /* Try the seek now, rather than on the next buffer event */
+      rc = webmdmuxflt_prc_buffers_ready (ap_prc);
+    }
+  return rc;
+}
+
+/*
+ * from tizapi class
+ */
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const webmdmuxflt_prc_t * p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      OMX_TIME_CONFIG_TIMESTAMPTYPE * p_timestamp
+        = (OMX_TIME_CONFIG_TIMESTAMPTYPE *) ap_struct;
+      p_timestamp->nTimestamp
+        = p_prc->seek_pending_ ? p_prc->seek_target_ : p_prc->position_;
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      OMX_TIME_CONFIG_SEEKMODETYPE * p_seek_mode
+        = (OMX_TIME_CONFIG_SEEKMODETYPE *) ap_struct;
+      p_seek_mode->eType = p_prc->seek_mode_;
+    }
+  else
+    {
+      rc = super_GetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  webmdmuxflt_prc_t * p_prc = (webmdmuxflt_prc_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_prc);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      const OMX_TIME_CONFIG_TIMESTAMPTYPE * p_timestamp
+        = (OMX_TIME_CONFIG_TIMESTAMPTYPE *) ap_struct;
+      if (p_timestamp->nTimestamp < 0)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          p_prc->seek_target_ = p_timestamp->nTimestamp;
+          p_prc->seek_pending_ = true;
+          /* This queues a config change message; the seek is done from
+             there, or as soon as the target cluster has been received */
+          rc = super_SetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj,
+                                ap_hdl, a_index, ap_struct);
+        }
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      const OMX_TIME_CONFIG_SEEKMODETYPE * p_seek_mode
+        = (OMX_TIME_CONFIG_SEEKMODETYPE *) ap_struct;
+      if (OMX_TIME_SeekModeFast != p_seek_mode->eType
+          && OMX_TIME_SeekModeAccurate != p_seek_mode->eType)
+        {
+          rc = OMX_ErrorBadParameter;
+        }
+      else
+        {
+          p_prc->seek_mode_ = p_seek_mode->eType;
+        }
+    }
+  else
+    {
+      rc = super_SetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
 /*
  * webmdmuxflt_prc_class
  */
@@ -1359,6 +1593,12 @@ webmdmuxflt_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, webmdmuxflt_prc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_port_enable, webmdmuxflt_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_config_change, webmdmuxflt_prc_config_change,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, webmdmuxflt_prc_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, webmdmuxflt_prc_SetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -35,6 +35,7 @@ extern "C" {
 #include <stdbool.h>
 
 #include <OMX_Core.h>
+#include <OMX_Other.h>
 
 #include <tizplatform.h>
 
@@ -42,6 +43,7 @@ extern "C" {
 #include <tizfilterprc_decls.h>
 
 #include "nestegg.h"
+#include "webmdmuxidx.h"
 
 typedef struct webmdmuxflt_prc webmdmuxflt_prc_t;
 struct webmdmuxflt_prc
@@ -72,6 +74,12 @@ struct webmdmuxflt_prc
   int ne_read_err_;
   int ne_last_read_len_;
   int ne_failed_init_count_;
+  webmdmux_idx_t * p_idx_;
+  bool seek_pending_;
+  OMX_TICKS seek_target_;
+  OMX_TIME_SEEKMODETYPE seek_mode_;
+  uint64_t seek_skip_ns_;
+  OMX_TICKS position_;
 };
 
 typedef struct webmdmuxflt_prc_class webmdmuxflt_prc_class_t;
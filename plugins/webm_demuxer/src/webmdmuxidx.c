@@ -0,0 +1,492 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   webmdmuxidx.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - WebM Demuxer seek index
+ *
+ * A cluster index built from the bytes of the stream as they arrive. Only the
+ * element headers are looked at: the scanner descends into the Segment and
+ * its Clusters (whose size may be unknown, as in live streams), records each
+ * Cluster's offset and Timecode, and skips everything else. When the Cues
+ * element shows up (it may be placed before or after the clusters) its cue
+ * points are merged into the index, which is then complete.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <tizplatform.h>
+
+#include "webmdmuxidx.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.webm_demuxer.idx"
+#endif
+
+/* Matroska element ids */
+#define WEBMDMUX_IDX_ID_SEGMENT 0x18538067
+#define WEBMDMUX_IDX_ID_INFO 0x1549A966
+#define WEBMDMUX_IDX_ID_TIMECODE_SCALE 0x2AD7B1
+#define WEBMDMUX_IDX_ID_CLUSTER 0x1F43B675
+#define WEBMDMUX_IDX_ID_TIMECODE 0xE7
+#define WEBMDMUX_IDX_ID_CUES 0x1C53BB6B
+#define WEBMDMUX_IDX_ID_CUE_POINT 0xBB
+#define WEBMDMUX_IDX_ID_CUE_TIME 0xB3
+#define WEBMDMUX_IDX_ID_CUE_TRACK_POSITIONS 0xB7
+#define WEBMDMUX_IDX_ID_CUE_CLUSTER_POSITION 0xF1
+
+#define WEBMDMUX_IDX_UNKNOWN_SIZE UINT64_MAX
+#define WEBMDMUX_IDX_DEFAULT_TIMECODE_SCALE 1000000
+
+struct webmdmux_idx
+{
+  tiz_vector_t * p_entries_; /* webmdmux_idx_entry_t, ordered by offset */
+  OMX_U64 next_;             /* Offset of the next element header */
+  OMX_U64 segment_;          /* Offset of the Segment's payload */
+  OMX_U64 cluster_;          /* Offset of the last Cluster seen */
+  bool timecode_pending_;
+  OMX_U64 scale_;
+  bool has_cues_;
+  bool complete_;
+  bool failed_;
+};
+
+/* Returns the length of the vint, 0 if more data is needed, or -1 */
+static int
+read_vint (const OMX_U8 * ap_data, const OMX_U64 a_avail, const bool a_size,
+           OMX_U64 * ap_value)
+{
+  OMX_U8 mask = 0x80;
+  OMX_U64 value = 0;
+  bool all_ones = false;
+  int len = 1;
+  int i = 0;
+
+  if (0 == a_avail)
+    {
+      return 0;
+    }
+
+  while (len <= 8 && !(ap_data[0] & mask))
+    {
+      mask >>= 1;
+      ++len;
+    }
+
+  if (len > 8)
+    {
+      return -1;
+    }
+
+  if ((OMX_U64) len > a_avail)
+    {
+      return 0;
+    }
+
+  /* Ids keep their length marker, sizes don't */
+  value = a_size ? (OMX_U64) (ap_data[0] & (mask - 1)) : ap_data[0];
+  all_ones = (value == (OMX_U64) (mask - 1));
+  for (i = 1; i < len; ++i)
+    {
+      value = (value << 8) | ap_data[i];
+      all_ones = all_ones && 0xFF == ap_data[i];
+    }
+
+  *ap_value = (a_size && all_ones) ? WEBMDMUX_IDX_UNKNOWN_SIZE : value;
+  return len;
+}
+
+static int
+read_header (const OMX_U8 * ap_data, const OMX_U64 a_avail, OMX_U64 * ap_id,
+             OMX_U64 * ap_size)
+{
+  const int id_len = read_vint (ap_data, a_avail, false, ap_id);
+  int size_len = 0;
+  if (id_len <= 0)
+    {
+      return id_len;
+    }
+  size_len = read_vint (ap_data + id_len, a_avail - id_len, true, ap_size);
+  return size_len <= 0 ? size_len : id_len + size_len;
+}
+
+static OMX_U64
+read_uint (const OMX_U8 * ap_data, const OMX_U64 a_size)
+{
+  OMX_U64 value = 0;
+  OMX_U64 i = 0;
+  for (i = 0; i < a_size; ++i)
+    {
+      value = (value << 8) | ap_data[i];
+    }
+  return value;
+}
+
+/* Iterates over the children of an element that is entirely in memory */
+static bool
+next_child (const OMX_U8 * ap_data, const OMX_U64 a_size, OMX_U64 * ap_pos,
+            OMX_U64 * ap_id, const OMX_U8 ** app_payload,
+            OMX_U64 * ap_payload_size)
+{
+  OMX_U64 size = 0;
+  const int hlen
+    = *ap_pos < a_size
+        ? read_header (ap_data + *ap_pos, a_size - *ap_pos, ap_id, &size)
+        : 0;
+
+  if (hlen <= 0 || size > a_size - *ap_pos - hlen)
+    {
+      return false;
+    }
+
+  *app_payload = ap_data + *ap_pos + hlen;
+  *ap_payload_size = size;
+  *ap_pos += hlen + size;
+  return true;
+}
+
+static inline webmdmux_idx_entry_t *
+entry_at (const webmdmux_idx_t * ap_idx, const OMX_S32 a_pos)
+{
+  return tiz_vector_at (ap_idx->p_entries_, a_pos);
+}
+
+static OMX_ERRORTYPE
+add_entry (webmdmux_idx_t * ap_idx, const OMX_U64 a_offset,
+           const OMX_U64 a_time_ns)
+{
+  webmdmux_idx_entry_t entry = {a_offset, a_time_ns};
+  const OMX_S32 len = tiz_vector_length (ap_idx->p_entries_);
+  OMX_S32 lo = 0;
+  OMX_S32 hi = len;
+
+  /* Clusters are scanned in order, but cue points may land in between */
+  while (lo < hi)
+    {
+      const OMX_S32 mid = lo + (hi - lo) / 2;
+      if (entry_at (ap_idx, mid)->offset < a_offset)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  if (lo < len && entry_at (ap_idx, lo)->offset == a_offset)
+    {
+      /* A cue time may be later than its cluster's timecode */
+      webmdmux_idx_entry_t * p_entry = entry_at (ap_idx, lo);
+      p_entry->time_ns = MIN (p_entry->time_ns, a_time_ns);
+      return OMX_ErrorNone;
+    }
+
+  return lo == len ? tiz_vector_push_back (ap_idx->p_entries_, &entry)
+                   : tiz_vector_insert (ap_idx->p_entries_, &entry, lo);
+}
+
+static void
+read_info (webmdmux_idx_t * ap_idx, const OMX_U8 * ap_data,
+           const OMX_U64 a_size)
+{
+  const OMX_U8 * p_payload = NULL;
+  OMX_U64 payload_size = 0;
+  OMX_U64 pos = 0;
+  OMX_U64 id = 0;
+
+  while (next_child (ap_data, a_size, &pos, &id, &p_payload, &payload_size))
+    {
+      if (WEBMDMUX_IDX_ID_TIMECODE_SCALE == id && payload_size <= 8
+          && read_uint (p_payload, payload_size) > 0)
+        {
+          ap_idx->scale_ = read_uint (p_payload, payload_size);
+        }
+    }
+}
+
+static OMX_U64
+read_cue_cluster_position (const OMX_U8 * ap_data, const OMX_U64 a_size)
+{
+  const OMX_U8 * p_payload = NULL;
+  OMX_U64 payload_size = 0;
+  OMX_U64 pos = 0;
+  OMX_U64 id = 0;
+
+  while (next_child (ap_data, a_size, &pos, &id, &p_payload, &payload_size))
+    {
+      if (WEBMDMUX_IDX_ID_CUE_CLUSTER_POSITION == id && payload_size <= 8)
+        {
+          return read_uint (p_payload, payload_size);
+        }
+    }
+  return WEBMDMUX_IDX_UNKNOWN_SIZE;
+}
+
+static OMX_ERRORTYPE
+read_cues (webmdmux_idx_t * ap_idx, const OMX_U8 * ap_data,
+           const OMX_U64 a_size)
+{
+  const OMX_U8 * p_point = NULL;
+  OMX_U64 point_size = 0;
+  OMX_U64 pos = 0;
+  OMX_U64 id = 0;
+
+  while (next_child (ap_data, a_size, &pos, &id, &p_point, &point_size))
+    {
+      const OMX_U8 * p_payload = NULL;
+      OMX_U64 payload_size = 0;
+      OMX_U64 child_pos = 0;
+      OMX_U64 child_id = 0;
+      OMX_U64 time = WEBMDMUX_IDX_UNKNOWN_SIZE;
+      OMX_U64 cluster = WEBMDMUX_IDX_UNKNOWN_SIZE;
+
+      if (WEBMDMUX_IDX_ID_CUE_POINT != id)
+        {
+          continue;
+        }
+
+      while (next_child (p_point, point_size, &child_pos, &child_id,
+                         &p_payload, &payload_size))
+        {
+          if (WEBMDMUX_IDX_ID_CUE_TIME == child_id && payload_size <= 8)
+            {
+              time = read_uint (p_payload, payload_size);
+            }
+          else if (WEBMDMUX_IDX_ID_CUE_TRACK_POSITIONS == child_id
+                   && WEBMDMUX_IDX_UNKNOWN_SIZE == cluster)
+            {
+              cluster = read_cue_cluster_position (p_payload, payload_size);
+            }
+        }
+
+      if (WEBMDMUX_IDX_UNKNOWN_SIZE != time
+          && WEBMDMUX_IDX_UNKNOWN_SIZE != cluster)
+        {
+          /* Cluster positions are relative to the Segment's payload */
+          tiz_check_omx (add_entry (ap_idx, ap_idx->segment_ + cluster,
+                                    time * ap_idx->scale_));
+        }
+    }
+
+  ap_idx->has_cues_ = true;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+webmdmux_idx_init (webmdmux_idx_t ** app_idx)
+{
+  webmdmux_idx_t * p_idx = NULL;
+
+  assert (app_idx);
+
+  tiz_check_null_ret_oom (
+    (p_idx = (webmdmux_idx_t *) tiz_mem_calloc (1, sizeof (webmdmux_idx_t))));
+
+  if (OMX_ErrorNone
+      != tiz_vector_init (&(p_idx->p_entries_), sizeof (webmdmux_idx_entry_t)))
+    {
+      tiz_mem_free (p_idx);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  webmdmux_idx_reset (p_idx);
+  *app_idx = p_idx;
+  return OMX_ErrorNone;
+}
+
+void
+webmdmux_idx_destroy (webmdmux_idx_t * ap_idx)
+{
+  if (ap_idx)
+    {
+      tiz_vector_destroy (ap_idx->p_entries_);
+      tiz_mem_free (ap_idx);
+    }
+}
+
+void
+webmdmux_idx_reset (webmdmux_idx_t * ap_idx)
+{
+  if (ap_idx)
+    {
+      tiz_vector_clear (ap_idx->p_entries_);
+      ap_idx->next_ = 0;
+      ap_idx->segment_ = 0;
+      ap_idx->cluster_ = 0;
+      ap_idx->timecode_pending_ = false;
+      ap_idx->scale_ = WEBMDMUX_IDX_DEFAULT_TIMECODE_SCALE;
+      ap_idx->has_cues_ = false;
+      ap_idx->complete_ = false;
+      ap_idx->failed_ = false;
+    }
+}
+
+OMX_ERRORTYPE
+webmdmux_idx_scan (webmdmux_idx_t * ap_idx, const OMX_U8 * ap_data,
+                   const OMX_U64 a_len)
+{
+  assert (ap_idx);
+  assert (ap_data || 0 == a_len);
+
+  while (!ap_idx->failed_ && !ap_idx->complete_ && ap_idx->next_ < a_len)
+    {
+      const OMX_U64 start = ap_idx->next_;
+      OMX_U64 id = 0;
+      OMX_U64 size = 0;
+      const int hlen
+        = read_header (ap_data + start, a_len - start, &id, &size);
+      const OMX_U64 payload = start + (hlen > 0 ? hlen : 0);
+
+      if (hlen < 0)
+        {
+          ap_idx->failed_ = true;
+        }
+      else if (0 == hlen)
+        {
+          /* Wait for the rest of the header */
+          break;
+        }
+      else if (WEBMDMUX_IDX_ID_SEGMENT == id)
+        {
+          ap_idx->segment_ = payload;
+          ap_idx->next_ = payload;
+        }
+      else if (WEBMDMUX_IDX_ID_CLUSTER == id)
+        {
+          /* Walk the cluster's children: its size may be unknown */
+          ap_idx->cluster_ = start;
+          ap_idx->timecode_pending_ = true;
+          ap_idx->next_ = payload;
+        }
+      else if (WEBMDMUX_IDX_UNKNOWN_SIZE == size
+               || (WEBMDMUX_IDX_ID_TIMECODE == id && size > 8))
+        {
+          ap_idx->failed_ = true;
+        }
+      else if ((WEBMDMUX_IDX_ID_TIMECODE == id || WEBMDMUX_IDX_ID_INFO == id
+                || WEBMDMUX_IDX_ID_CUES == id)
+               && payload + size > a_len)
+        {
+          /* These are only parsed once they are entirely in memory */
+          break;
+        }
+      else
+        {
+          if (WEBMDMUX_IDX_ID_TIMECODE == id && ap_idx->timecode_pending_)
+            {
+              tiz_check_omx (add_entry (
+                ap_idx, ap_idx->cluster_,
+                read_uint (ap_data + payload, size) * ap_idx->scale_));
+              ap_idx->timecode_pending_ = false;
+            }
+          else if (WEBMDMUX_IDX_ID_INFO == id)
+            {
+              read_info (ap_idx, ap_data + payload, size);
+            }
+          else if (WEBMDMUX_IDX_ID_CUES == id)
+            {
+              tiz_check_omx (read_cues (ap_idx, ap_data + payload, size));
+            }
+          ap_idx->next_ = payload + size;
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+bool
+webmdmux_idx_complete (const webmdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  return ap_idx->complete_ || ap_idx->has_cues_;
+}
+
+bool
+webmdmux_idx_has_cues (const webmdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  return ap_idx->has_cues_;
+}
+
+OMX_U32
+webmdmux_idx_length (const webmdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  return tiz_vector_length (ap_idx->p_entries_);
+}
+
+bool
+webmdmux_idx_covers (const webmdmux_idx_t * ap_idx, const OMX_U64 a_time_ns)
+{
+  const OMX_S32 len = tiz_vector_length (ap_idx->p_entries_);
+  assert (ap_idx);
+  return webmdmux_idx_complete (ap_idx)
+         || (len > 0 && entry_at (ap_idx, len - 1)->time_ns > a_time_ns);
+}
+
+bool
+webmdmux_idx_lookup (const webmdmux_idx_t * ap_idx, const OMX_U64 a_time_ns,
+                     webmdmux_idx_entry_t * ap_entry)
+{
+  const OMX_S32 len = tiz_vector_length (ap_idx->p_entries_);
+  OMX_S32 lo = 0;
+  OMX_S32 hi = len;
+
+  assert (ap_idx);
+  assert (ap_entry);
+
+  if (0 == len)
+    {
+      return false;
+    }
+
+  /* Find the first entry after a_time_ns */
+  while (lo < hi)
+    {
+      const OMX_S32 mid = lo + (hi - lo) / 2;
+      if (entry_at (ap_idx, mid)->time_ns <= a_time_ns)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  *ap_entry = *entry_at (ap_idx, lo > 0 ? lo - 1 : 0);
+  return true;
+}
+
+void
+webmdmux_idx_set_complete (webmdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  ap_idx->complete_ = true;
+}
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   webmdmuxidx.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - WebM Demuxer seek index
+ *
+ *
+ */
+
+#ifndef WEBMDMUXIDX_H
+#define WEBMDMUXIDX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct webmdmux_idx webmdmux_idx_t;
+
+typedef struct webmdmux_idx_entry webmdmux_idx_entry_t;
+struct webmdmux_idx_entry
+{
+  OMX_U64 offset;  /* Byte offset of the Cluster element */
+  OMX_U64 time_ns; /* Cluster (or cue) time */
+};
+
+OMX_ERRORTYPE
+webmdmux_idx_init (webmdmux_idx_t ** app_idx);
+
+void
+webmdmux_idx_destroy (webmdmux_idx_t * ap_idx);
+
+void
+webmdmux_idx_reset (webmdmux_idx_t * ap_idx);
+
+/* Index the stream, ap_data holding its first a_len bytes. Each call resumes
+   the scan where the previous one stopped. */
+OMX_ERRORTYPE
+webmdmux_idx_scan (webmdmux_idx_t * ap_idx, const OMX_U8 * ap_data,
+                   const OMX_U64 a_len);
+
+/* True once the whole stream has been scanned, or after the Cues element has
+   been read */
+bool
+webmdmux_idx_complete (const webmdmux_idx_t * ap_idx);
+
+bool
+webmdmux_idx_has_cues (const webmdmux_idx_t * ap_idx);
+
+OMX_U32
+webmdmux_idx_length (const webmdmux_idx_t * ap_idx);
+
+/* True when the cluster containing a_time_ns is known, i.e. either the
+   index is complete or a later cluster has already been indexed */
+bool
+webmdmux_idx_covers (const webmdmux_idx_t * ap_idx, const OMX_U64 a_time_ns);
+
+/* The last entry at or before a_time_ns (or the first entry) */
+bool
+webmdmux_idx_lookup (const webmdmux_idx_t * ap_idx, const OMX_U64 a_time_ns,
+                     webmdmux_idx_entry_t * ap_entry);
+
+/* To be called at end of stream */
+void
+webmdmux_idx_set_complete (webmdmux_idx_t * ap_idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WEBMDMUXIDX_H */
@@ -0,0 +1,663 @@
+/**
+ * Copyright (C) 2011-2018 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   webmdmuxidxbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - WebM Demuxer - seek index benchmark
+ *
+ * Builds a few hours of synthetic WebM audio in memory, with the Cues before
+ * the clusters, after them, without Cues, and with clusters of unknown size,
+ * as live streams have. Each file is indexed incrementally as if it arrived
+ * in input buffers, and every lookup is checked against the clusters that
+ * were written. Finally nestegg is repositioned at the indexed offsets to
+ * check that it resumes at the expected timestamps.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "nestegg.h"
+#include "webmdmux.h"
+#include "webmdmuxidx.h"
+
+#define BENCH_BLOCK_MS 20
+#define BENCH_BLOCK_BYTES 40
+#define BENCH_LOOKUPS 100000
+#define BENCH_SEEKS 200
+/* What the filter's input port gets per buffer */
+#define BENCH_CHUNK_BYTES (ARATELIA_WEBM_DEMUXER_WEBM_PORT_MIN_BUF_SIZE)
+
+typedef enum bench_layout bench_layout_t;
+enum bench_layout
+{
+  EBenchCuesFront,
+  EBenchCuesEnd,
+  EBenchNoCues,
+  EBenchLive,
+  EBenchLayoutMax
+};
+
+static const char * layout_names[EBenchLayoutMax]
+  = {"cues-front", "cues-end", "no-cues", "live"};
+
+typedef struct bench_buf bench_buf_t;
+struct bench_buf
+{
+  OMX_U8 * p_data;
+  size_t len;
+  size_t cap;
+};
+
+typedef struct bench_file bench_file_t;
+struct bench_file
+{
+  bench_buf_t data;
+  OMX_U64 * p_offsets; /* Cluster offsets */
+  OMX_U64 * p_times;   /* Cluster times, ns */
+  OMX_U32 nclusters;
+  OMX_U64 duration_ns;
+  size_t clusters_start;
+  size_t clusters_end;
+};
+
+typedef struct bench_io bench_io_t;
+struct bench_io
+{
+  const bench_buf_t * p_buf;
+  size_t pos;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static uint32_t
+next_rand (uint32_t * ap_seed)
+{
+  *ap_seed = *ap_seed * 1664525u + 1013904223u;
+  return *ap_seed >> 8;
+}
+
+/*
+ * A minimal EBML writer
+ */
+
+static void
+put (bench_buf_t * ap_buf, const void * ap_data, const size_t a_len)
+{
+  if (ap_buf->len + a_len > ap_buf->cap)
+    {
+      ap_buf->cap = MAX (ap_buf->cap * 2, ap_buf->len + a_len);
+      ap_buf->p_data = realloc (ap_buf->p_data, ap_buf->cap);
+      if (!ap_buf->p_data)
+        {
+          fprintf (stderr, "webmdmuxidxbench: out of memory\n");
+          exit (EXIT_FAILURE);
+        }
+    }
+  memcpy (ap_buf->p_data + ap_buf->len, ap_data, a_len);
+  ap_buf->len += a_len;
+}
+
+static void
+put_be (bench_buf_t * ap_buf, const OMX_U64 a_value, const int a_len)
+{
+  OMX_U8 bytes[8];
+  int i = 0;
+  for (i = 0; i < a_len; ++i)
+    {
+      bytes[i] = (OMX_U8) (a_value >> (8 * (a_len - 1 - i)));
+    }
+  put (ap_buf, bytes, a_len);
+}
+
+static void
+put_id (bench_buf_t * ap_buf, const OMX_U32 a_id)
+{
+  put_be (ap_buf, a_id,
+          a_id > 0xFFFFFF ? 4 : (a_id > 0xFFFF ? 3 : (a_id > 0xFF ? 2 : 1)));
+}
+
+/* Sizes are always written with 8 bytes, which keeps element sizes
+   independent of the values they hold */
+static void
+put_size (bench_buf_t * ap_buf, const OMX_U64 a_size)
+{
+  put_be (ap_buf, 0x0100000000000000ULL | a_size, 8);
+}
+
+static void
+put_uint (bench_buf_t * ap_buf, const OMX_U32 a_id, const OMX_U64 a_value)
+{
+  put_id (ap_buf, a_id);
+  put_size (ap_buf, 8);
+  put_be (ap_buf, a_value, 8);
+}
+
+static void
+put_float (bench_buf_t * ap_buf, const OMX_U32 a_id, const double a_value)
+{
+  OMX_U64 bits = 0;
+  memcpy (&bits, &a_value, sizeof (bits));
+  put_id (ap_buf, a_id);
+  put_size (ap_buf, 8);
+  put_be (ap_buf, bits, 8);
+}
+
+static void
+put_bin (bench_buf_t * ap_buf, const OMX_U32 a_id, const void * ap_data,
+         const size_t a_len)
+{
+  put_id (ap_buf, a_id);
+  put_size (ap_buf, a_len);
+  put (ap_buf, ap_data, a_len);
+}
+
+static size_t
+begin (bench_buf_t * ap_buf, const OMX_U32 a_id)
+{
+  put_id (ap_buf, a_id);
+  put_size (ap_buf, 0);
+  return ap_buf->len;
+}
+
+static void
+end (bench_buf_t * ap_buf, const size_t a_payload)
+{
+  const OMX_U64 size = ap_buf->len - a_payload;
+  int i = 0;
+  for (i = 1; i < 8; ++i)
+    {
+      ap_buf->p_data[a_payload - 8 + i] = (OMX_U8) (size >> (8 * (7 - i)));
+    }
+}
+
+static void
+put_head (bench_buf_t * ap_buf, const OMX_U64 a_duration_ns)
+{
+  static const OMX_U8 opus_head[19]
+    = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 2, 0x38, 0x01, 0x80, 0xBB};
+  size_t info = 0;
+  size_t tracks = 0;
+  size_t entry = 0;
+  size_t audio = 0;
+
+  info = begin (ap_buf, 0x1549A966);
+  put_uint (ap_buf, 0x2AD7B1, 1000000);
+  put_float (ap_buf, 0x4489, (double) a_duration_ns / 1e6);
+  end (ap_buf, info);
+
+  tracks = begin (ap_buf, 0x1654AE6B);
+  entry = begin (ap_buf, 0xAE);
+  put_uint (ap_buf, 0xD7, 1);
+  put_uint (ap_buf, 0x73C5, 1);
+  put_uint (ap_buf, 0x83, 2);
+  put_bin (ap_buf, 0x86, "A_OPUS", 6);
+  put_bin (ap_buf, 0x63A2, opus_head, sizeof (opus_head));
+  audio = begin (ap_buf, 0xE1);
+  put_float (ap_buf, 0xB5, 48000.0);
+  put_uint (ap_buf, 0x9F, 2);
+  end (ap_buf, audio);
+  end (ap_buf, entry);
+  end (ap_buf, tracks);
+}
+
+static void
+put_cues (bench_buf_t * ap_buf, const bench_file_t * ap_file,
+          const OMX_U64 a_base)
+{
+  const size_t cues = begin (ap_buf, 0x1C53BB6B);
+  OMX_U32 i = 0;
+  for (i = 0; i < ap_file->nclusters; ++i)
+    {
+      const size_t point = begin (ap_buf, 0xBB);
+      size_t positions = 0;
+      put_uint (ap_buf, 0xB3, ap_file->p_times[i] / 1000000);
+      positions = begin (ap_buf, 0xB7);
+      put_uint (ap_buf, 0xF7, 1);
+      put_uint (ap_buf, 0xF1, a_base + ap_file->p_offsets[i]);
+      end (ap_buf, positions);
+      end (ap_buf, point);
+    }
+  end (ap_buf, cues);
+}
+
+/* Clusters of 1 to 10 seconds of 20 ms blocks; cluster offsets are first
+   recorded relative to the start of the clusters */
+static void
+put_clusters (bench_buf_t * ap_buf, bench_file_t * ap_file,
+              const double a_secs, const bool a_unknown_size)
+{
+  const OMX_U64 total_ms = (OMX_U64) (a_secs * 1000);
+  OMX_U8 block[4 + BENCH_BLOCK_BYTES];
+  uint32_t seed = 7;
+  OMX_U64 ms = 0;
+
+  ap_file->nclusters = 0;
+  ap_file->p_offsets = calloc (total_ms / 1000 + 1, sizeof (OMX_U64));
+  ap_file->p_times = calloc (total_ms / 1000 + 1, sizeof (OMX_U64));
+  if (!ap_file->p_offsets || !ap_file->p_times)
+    {
+      fprintf (stderr, "webmdmuxidxbench: out of memory\n");
+      exit (EXIT_FAILURE);
+    }
+
+  while (ms < total_ms)
+    {
+      const OMX_U64 cluster_ms
+        = MIN ((1 + next_rand (&seed) % 10) * 1000, total_ms - ms);
+      size_t cluster = 0;
+      OMX_U64 t = 0;
+
+      ap_file->p_offsets[ap_file->nclusters] = ap_buf->len;
+      ap_file->p_times[ap_file->nclusters] = ms * 1000000;
+      ap_file->nclusters++;
+
+      if (a_unknown_size)
+        {
+          put_id (ap_buf, 0x1F43B675);
+          put_be (ap_buf, 0x01FFFFFFFFFFFFFFULL, 8);
+        }
+      else
+        {
+          cluster = begin (ap_buf, 0x1F43B675);
+        }
+      put_uint (ap_buf, 0xE7, ms);
+      for (t = 0; t < cluster_ms; t += BENCH_BLOCK_MS)
+        {
+          size_t i = 0;
+          block[0] = 0x81; /* track 1 */
+          block[1] = (OMX_U8) (t >> 8);
+          block[2] = (OMX_U8) t;
+          block[3] = 0x80; /* keyframe */
+          block[4] = 0xFC; /* CELT 20 ms stereo TOC */
+          for (i = 5; i < sizeof (block); ++i)
+            {
+              block[i] = (OMX_U8) next_rand (&seed);
+            }
+          put_bin (ap_buf, 0xA3, block, sizeof (block));
+        }
+      if (!a_unknown_size)
+        {
+          end (ap_buf, cluster);
+        }
+      ms += cluster_ms;
+    }
+  ap_file->duration_ns = ms * 1000000;
+}
+
+static void
+make_file (bench_file_t * ap_file, const bench_layout_t a_layout,
+           const double a_secs)
+{
+  bench_buf_t head = {NULL, 0, 0};
+  bench_buf_t clusters = {NULL, 0, 0};
+  bench_buf_t cues = {NULL, 0, 0};
+  bench_buf_t * p_out = &(ap_file->data);
+  OMX_U64 base = 0;
+  OMX_U32 i = 0;
+  size_t segment = 0;
+
+  memset (ap_file, 0, sizeof (*ap_file));
+  put_clusters (&clusters, ap_file, a_secs, EBenchLive == a_layout);
+  put_head (&head, ap_file->duration_ns);
+
+  /* Cue positions are relative to the Segment's payload; the size of the
+     Cues does not depend on them */
+  put_cues (&cues, ap_file, 0);
+  base = head.len + (EBenchCuesFront == a_layout ? cues.len : 0);
+  cues.len = 0;
+  put_cues (&cues, ap_file, base);
+
+  /* EBML header, DocType webm */
+  {
+    const size_t ebml = begin (p_out, 0x1A45DFA3);
+    put_uint (p_out, 0x4286, 1);
+    put_uint (p_out, 0x42F7, 1);
+    put_uint (p_out, 0x42F2, 4);
+    put_uint (p_out, 0x42F3, 8);
+    put_bin (p_out, 0x4282, "webm", 4);
+    put_uint (p_out, 0x4287, 2);
+    put_uint (p_out, 0x4285, 2);
+    end (p_out, ebml);
+  }
+
+  segment = begin (p_out, 0x18538067);
+  put (p_out, head.p_data, head.len);
+  if (EBenchCuesFront == a_layout)
+    {
+      put (p_out, cues.p_data, cues.len);
+    }
+  ap_file->clusters_start = p_out->len;
+  put (p_out, clusters.p_data, clusters.len);
+  ap_file->clusters_end = p_out->len;
+  if (EBenchCuesEnd == a_layout)
+    {
+      put (p_out, cues.p_data, cues.len);
+    }
+  end (p_out, segment);
+
+  for (i = 0; i < ap_file->nclusters; ++i)
+    {
+      ap_file->p_offsets[i] += ap_file->clusters_start;
+    }
+
+  free (head.p_data);
+  free (clusters.p_data);
+  free (cues.p_data);
+}
+
+static void
+free_file (bench_file_t * ap_file)
+{
+  free (ap_file->data.p_data);
+  free (ap_file->p_offsets);
+  free (ap_file->p_times);
+}
+
+/* The cluster that contains a_time_ns */
+static OMX_U32
+expected_cluster (const bench_file_t * ap_file, const OMX_U64 a_time_ns)
+{
+  OMX_U32 lo = 0;
+  OMX_U32 hi = ap_file->nclusters;
+  while (lo < hi)
+    {
+      const OMX_U32 mid = lo + (hi - lo) / 2;
+      if (ap_file->p_times[mid] <= a_time_ns)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+  return lo > 0 ? lo - 1 : 0;
+}
+
+static bool
+check_lookup (const webmdmux_idx_t * ap_idx, const bench_file_t * ap_file,
+              const OMX_U64 a_time_ns)
+{
+  const OMX_U32 c = expected_cluster (ap_file, a_time_ns);
+  webmdmux_idx_entry_t entry;
+  if (!webmdmux_idx_lookup (ap_idx, a_time_ns, &entry)
+      || entry.offset != ap_file->p_offsets[c]
+      || entry.time_ns != ap_file->p_times[c])
+    {
+      fprintf (stderr,
+               "webmdmuxidxbench: lookup %llu ns: got %llu @ %llu, "
+               "expected %llu @ %llu\n",
+               (unsigned long long) a_time_ns,
+               (unsigned long long) entry.time_ns,
+               (unsigned long long) entry.offset,
+               (unsigned long long) ap_file->p_times[c],
+               (unsigned long long) ap_file->p_offsets[c]);
+      return false;
+    }
+  return true;
+}
+
+/* Every target the index claims to cover must resolve to the right
+   cluster */
+static bool
+check_covered (const webmdmux_idx_t * ap_idx, const bench_file_t * ap_file,
+               uint32_t * ap_seed, const OMX_U32 a_count)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      const OMX_U64 t = (OMX_U64) next_rand (ap_seed) * 1000
+                        % (ap_file->duration_ns / 1000) * 1000;
+      if (webmdmux_idx_covers (ap_idx, t)
+          && !check_lookup (ap_idx, ap_file, t))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static int
+bench_io_read (void * ap_buffer, size_t a_length, void * ap_userdata)
+{
+  bench_io_t * p_io = ap_userdata;
+  if (p_io->pos + a_length > p_io->p_buf->len)
+    {
+      return 0;
+    }
+  memcpy (ap_buffer, p_io->p_buf->p_data + p_io->pos, a_length);
+  p_io->pos += a_length;
+  return 1;
+}
+
+static int
+bench_io_seek (int64_t a_offset, int a_whence, void * ap_userdata)
+{
+  bench_io_t * p_io = ap_userdata;
+  const int64_t base
+    = NESTEGG_SEEK_SET == a_whence
+        ? 0
+        : (NESTEGG_SEEK_CUR == a_whence ? (int64_t) p_io->pos
+                                        : (int64_t) p_io->p_buf->len);
+  if (base + a_offset < 0 || base + a_offset > (int64_t) p_io->p_buf->len)
+    {
+      return -1;
+    }
+  p_io->pos = (size_t) (base + a_offset);
+  return 0;
+}
+
+static int64_t
+bench_io_tell (void * ap_userdata)
+{
+  return ((bench_io_t *) ap_userdata)->pos;
+}
+
+/* Reposition nestegg at indexed clusters, as the demuxer does */
+static bool
+check_seeks (const webmdmux_idx_t * ap_idx, const bench_file_t * ap_file,
+             uint32_t * ap_seed, double * ap_elapsed)
+{
+  bench_io_t io_state = {&(ap_file->data), 0};
+  nestegg_io io = {bench_io_read, bench_io_seek, bench_io_tell, &io_state};
+  nestegg * p_ne = NULL;
+  bool ok = true;
+  OMX_U32 i = 0;
+  double start = 0.0;
+
+  if (0 != nestegg_init (&p_ne, io, NULL, -1))
+    {
+      fprintf (stderr, "webmdmuxidxbench: nestegg_init failed\n");
+      return false;
+    }
+
+  start = now_secs ();
+  for (i = 0; i < BENCH_SEEKS && ok; ++i)
+    {
+      const OMX_U64 t = (OMX_U64) next_rand (ap_seed) * 1000
+                        % (ap_file->duration_ns / 1000) * 1000;
+      nestegg_packet * p_pkt = NULL;
+      webmdmux_idx_entry_t entry;
+      uint64_t tstamp = 0;
+
+      ok = webmdmux_idx_lookup (ap_idx, t, &entry)
+           && 0 == nestegg_offset_seek (p_ne, entry.offset)
+           && 1 == nestegg_read_packet (p_ne, &p_pkt)
+           && 0 == nestegg_packet_tstamp (p_pkt, &tstamp)
+           && tstamp == entry.time_ns && tstamp <= t;
+      if (p_pkt)
+        {
+          nestegg_free_packet (p_pkt);
+        }
+      if (!ok)
+        {
+          fprintf (stderr,
+                   "webmdmuxidxbench: seek to %llu ns resumed at %llu ns\n",
+                   (unsigned long long) t, (unsigned long long) tstamp);
+        }
+    }
+  *ap_elapsed = now_secs () - start;
+
+  nestegg_destroy (p_ne);
+  return ok;
+}
+
+static int
+run (const bench_layout_t a_layout, const double a_secs)
+{
+  bench_file_t file;
+  webmdmux_idx_t * p_idx = NULL;
+  uint32_t seed = 11;
+  size_t fed = 0;
+  bool ok = true;
+  bool halfway_checked = false;
+  double start = 0.0;
+  double scan_secs = 0.0;
+  double lookup_secs = 0.0;
+  double seek_secs = 0.0;
+  OMX_U32 i = 0;
+
+  make_file (&file, a_layout, a_secs);
+  if (OMX_ErrorNone != webmdmux_idx_init (&p_idx))
+    {
+      free_file (&file);
+      return EXIT_FAILURE;
+    }
+
+  /* Index the file one input buffer at a time */
+  while (ok && fed < file.data.len)
+    {
+      fed = MIN (fed + BENCH_CHUNK_BYTES, file.data.len);
+      start = now_secs ();
+      ok = (OMX_ErrorNone
+            == webmdmux_idx_scan (p_idx, file.data.p_data, fed));
+      scan_secs += now_secs () - start;
+
+      if (ok && EBenchCuesFront == a_layout && fed < file.clusters_start)
+        {
+          ok = !webmdmux_idx_complete (p_idx);
+        }
+      else if (ok && EBenchCuesFront == a_layout)
+        {
+          /* Everything is seekable before any cluster has arrived */
+          ok = webmdmux_idx_has_cues (p_idx)
+               && webmdmux_idx_covers (p_idx, file.duration_ns - 1);
+        }
+      else if (ok && !halfway_checked && fed > file.data.len / 2)
+        {
+          /* Halfway through, only what has arrived is covered */
+          ok = !webmdmux_idx_complete (p_idx)
+               && !webmdmux_idx_covers (p_idx, file.duration_ns - 1)
+               && check_covered (p_idx, &file, &seed, 1000);
+          halfway_checked = true;
+        }
+    }
+
+  if (ok && EBenchCuesEnd != a_layout && EBenchCuesFront != a_layout)
+    {
+      ok = !webmdmux_idx_complete (p_idx);
+      webmdmux_idx_set_complete (p_idx);
+    }
+
+  ok = ok && webmdmux_idx_complete (p_idx)
+       && webmdmux_idx_length (p_idx) == file.nclusters;
+
+  start = now_secs ();
+  for (i = 0; i < BENCH_LOOKUPS && ok; ++i)
+    {
+      ok = check_lookup (p_idx, &file,
+                         (OMX_U64) next_rand (&seed) * 1000
+                           % (file.duration_ns / 1000) * 1000);
+    }
+  lookup_secs = now_secs () - start;
+
+  ok = ok && check_seeks (p_idx, &file, &seed, &seek_secs);
+
+  printf ("%-10s %5.1f h  %6.1f MB  %5u clusters  %5u entries  "
+          "scan %7.1f MB/s  lookup %5.0f ns  seek %6.1f us  %s\n",
+          layout_names[a_layout], a_secs / 3600.0, file.data.len / 1e6,
+          (unsigned) file.nclusters, (unsigned) webmdmux_idx_length (p_idx),
+          scan_secs > 0.0 ? file.data.len / scan_secs / 1e6 : 0.0,
+          lookup_secs * 1e9 / BENCH_LOOKUPS, seek_secs * 1e6 / BENCH_SEEKS,
+          ok ? "OK" : "FAILED");
+
+  webmdmux_idx_destroy (p_idx);
+  free_file (&file);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void
+usage (const char * ap_prg)
+{
+  fprintf (stderr, "Usage: %s [-s seconds]\n", ap_prg);
+}
+
+int
+main (int argc, char ** argv)
+{
+  double secs = 4 * 3600.0;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+  int i = 0;
+
+  while ((opt = getopt (argc, argv, "s:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            secs = strtod (optarg, NULL);
+            break;
+          default:
+            usage (argv[0]);
+            return EXIT_FAILURE;
+        };
+    }
+
+  if (secs < 1.0)
+    {
+      usage (argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < EBenchLayoutMax && EXIT_SUCCESS == rc; ++i)
+    {
+      rc = run ((bench_layout_t) i, secs);
+    }
+
+  return rc;
+}